@@ -43,6 +43,7 @@
 #define __AUDACITY_EFFECTINTERFACE_H__
 
 #include <functional>
+#include <memory>
 
 #include "audacity/Types.h"
 #include "audacity/ComponentInterface.h"
@@ -172,6 +173,13 @@ public:
    virtual bool ProcessFinalize() /* noexcept */ = 0;
    virtual size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) = 0;
 
+   // A NEW client of the same plug-in, which processes other tracks on
+   // another thread at the same time.  The host gives it the settings of
+   // this one.  The default returns null, for processing the tracks one
+   // after another.
+   virtual std::unique_ptr<EffectClientInterface> MakeParallelClient()
+      { return {}; }
+
    virtual bool RealtimeInitialize() = 0;
    virtual bool RealtimeAddProcessor(unsigned numChannels, float sampleRate) = 0;
    virtual bool RealtimeFinalize() = 0;
@@ -124,6 +124,11 @@ public:
       const RegistrationCallback &callback )
          = 0;
 
+   // Called before DiscoverPluginsAtPath() is called for each of many paths,
+   // so that the module may examine them all at once, for instance in
+   // several worker processes.  The default does nothing.
+   virtual void PrepareDiscovery(const PluginPaths & WXUNUSED(paths)) {}
+
    // For modules providing an interface to other dynamically loaded plugins,
    // the module returns true if the plugin is still valid, otherwise false.
    virtual bool IsPluginValid(const PluginPath & path, bool bFast) = 0;
@@ -91,6 +91,12 @@ void InitFFT()
    }
 }
 
+void InitFFT3()
+{
+   if (!gFFTBitTable3)
+      InitFFT();
+}
+
 inline int FastReverseBits3(int i, int NumBits)
 {
    if (NumBits <= MaxFastBits)
@@ -69,6 +69,13 @@ void PowerSpectrum3(int NumSamples, float *In, float *Out);
 void RealFFT3(int NumSamples,
              float *RealIn, float *RealOut, float *ImagOut);
 
+/*
+ * The routines build shared tables when first called.  Call this
+ * before calling them from several threads at once.
+ */
+
+void InitFFT3();
+
 /*
  * Computes a FFT of complex input and returns complex output.
  * Currently this is the only function here that supports the
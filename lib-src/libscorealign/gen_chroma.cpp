@@ -2,6 +2,9 @@
 #ifdef _WIN32
     #include "malloc.h"
 #endif
+// before fft3/FFT3.h, which defines true and false
+#include <thread>
+#include <vector>
 #include "stdlib.h" // for OSX compatibility, malloc.h -> stdlib.h
 #include "stdio.h"
 #include "assert.h"
@@ -174,6 +177,105 @@ static void normalize(float *cv)
 }
 
 
+/* CHROMA_FRAME -- compute one chroma vector from a window of samples
+ */
+/*
+    The parameters of gen_chroma_audio that are the same for every
+    frame.  Frames are computed by several threads, each passing its
+    own fft_dataR and fft_dataI, of length full_data_size.
+*/
+struct Chroma_params {
+    int samples_per_frame;
+    int full_data_size;
+    int low_bin;
+    int high_bin;
+    const int *bin_map;
+    const float *hamming;
+    double silence_threshold;
+};
+
+
+static void chroma_frame(const Chroma_params &p, float *full_data,
+        float *fft_dataR, float *fft_dataI, float *cv)
+{
+    int i;
+    //fill out array with 0's till next power of 2
+#ifdef SA_VERBOSE
+    fprintf(dbf, "samples_per_frame %d sample %g\n",
+            p.samples_per_frame, full_data[0]);
+#endif
+    for (i = p.samples_per_frame; i < p.full_data_size; i++)
+        full_data[i] = 0;
+
+#ifdef SA_VERBOSE
+    fprintf(dbf, "preFFT: full_data[1000] %g\n", full_data[1000]);
+#endif
+
+    // compute the RMS, then apply the Hamming window to the data
+    float rms = 0.0f;
+    for (i = 0; i < p.samples_per_frame; i++) {
+        float x = full_data[i];
+        rms += x * x;
+        full_data[i] = x * p.hamming[i];
+    }
+    rms = sqrt(rms / p.samples_per_frame);
+
+#ifdef SA_VERBOSE
+    fprintf(dbf, "preFFT: hammingData[1000] %g\n",
+            full_data[1000]);
+#endif
+    if (p.high_bin <= p.full_data_size / 2) {
+        // the input is real, so the real FFT of half the size gives the
+        // same bins below the Nyquist frequency
+        RealFFT3(p.full_data_size, full_data, fft_dataR, fft_dataI);
+        // RealFFT3 packs the Nyquist bin in here; bin 0 has no phase
+        fft_dataI[0] = 0;
+    } else
+        FFT3(p.full_data_size, 0, full_data, NULL, fft_dataR, fft_dataI);
+
+    //given the fft, compute the energy of each point
+    gen_Magnitude(fft_dataR, fft_dataI, p.low_bin, p.high_bin, full_data);
+
+    /*-------------------------------------
+      GENERATE BINS AND PUT
+      THE CORRECT ENERGY IN
+      EACH BIN, CORRESPONDING
+      TO THE CORRECT PITCH
+      -------------------------------------*/
+
+    float binEnergy[CHROMA_BIN_COUNT];
+    int binCount[CHROMA_BIN_COUNT];
+
+    for (i = 0; i < CHROMA_BIN_COUNT; i++) {
+        binCount[i] = 0;
+        binEnergy[i] = 0.0;
+    }
+
+    for (i = p.low_bin; i < p.high_bin; i++) {
+        int mod_bin = p.bin_map[i];
+        binEnergy[mod_bin] += full_data[i];
+        binCount[mod_bin]++;
+    }
+
+    /*-------------------------------------
+      END OF BIN GENERATION
+      -------------------------------------*/
+
+    //put chrom energy into the returned array
+    for (i = 0;  i < CHROMA_BIN_COUNT; i++) {
+        cv[i] = binEnergy[i] / binCount[i];
+    }
+    if (rms < p.silence_threshold) {
+        // "silence" flag
+        cv[CHROMA_BIN_COUNT] = 1.0f;
+    } else {
+        cv[CHROMA_BIN_COUNT] = 0.0f;
+        // normalize the non-silent frames
+        normalize(cv);
+    }
+}
+
+
 /* GEN_CHROMA_AUDIO -- compute chroma for an audio file 
  */
 /*
@@ -223,18 +325,6 @@ int Scorealign::gen_chroma_audio(Audio_reader &reader, int hcutoff,
         printf("   fft size %d\n", full_data_size);
     }
 
-    float *full_data = ALLOC(float, full_data_size);
-    float *fft_dataR = ALLOC(float, full_data_size);
-    float *fft_dataI = ALLOC(float, full_data_size);	
-    //set to zero
-    memset(full_data, 0, full_data_size * sizeof(float));
-    memset(fft_dataR, 0, full_data_size * sizeof(float));	
-    memset(fft_dataI, 0, full_data_size * sizeof(float));
-    //check to see if memory has been allocated
-    assert(full_data != NULL);
-    assert(fft_dataR != NULL);
-    assert(fft_dataI != NULL);
-   
     int *bin_map = ALLOC(int, full_data_size);
 	
     //set up the chrom_energy array;
@@ -277,131 +367,84 @@ int Scorealign::gen_chroma_audio(Audio_reader &reader, int hcutoff,
     float *hamming = ALLOC(float, reader.samples_per_frame);
     gen_Hamming(hamming, reader.samples_per_frame);
 
-    while (reader.read_window(full_data)) {
-        //fill out array with 0's till next power of 2
-#ifdef SA_VERBOSE
-        fprintf(dbf, "samples_per_frame %d sample %g\n", 
-                reader.samples_per_frame, full_data[0]);
-#endif
-        for (i = reader.samples_per_frame; i < full_data_size; i++) 
-            full_data[i] = 0;
-
-#ifdef SA_VERBOSE
-        fprintf(dbf, "preFFT: full_data[1000] %g\n", full_data[1000]);
-#endif
-
-        // compute the RMS, then apply the Hamming window to the data
-        float rms = 0.0f;
-        for (i = 0; i < reader.samples_per_frame; i++) {
-            float x = full_data[i];
-            rms += x * x;
-            full_data[i] = x * hamming[i];
-        }
-        rms = sqrt(rms / reader.samples_per_frame);
-
-#ifdef SA_VERBOSE
-        fprintf(dbf, "preFFT: hammingData[1000] %g\n", 
-                full_data[1000]);
-#endif
-        FFT3(full_data_size, 0, full_data, NULL, fft_dataR, fft_dataI); //fft3
-      
-        //given the fft, compute the energy of each point
-        gen_Magnitude(fft_dataR, fft_dataI, low_bin, high_bin, full_data);
-      
-        /*-------------------------------------
-          GENERATE BINS AND PUT
-          THE CORRECT ENERGY IN
-          EACH BIN, CORRESPONDING
-          TO THE CORRECT PITCH
-          -------------------------------------*/
-
-        float binEnergy[CHROMA_BIN_COUNT];
-        int binCount[CHROMA_BIN_COUNT];
-
-        for (i = 0; i < CHROMA_BIN_COUNT; i++) {
-            binCount[i] = 0; 
-            binEnergy[i] = 0.0;
-        }
-      
-        for (i = low_bin; i < high_bin; i++) {
-            int mod_bin = bin_map[i];
-            binEnergy[mod_bin] += full_data[i];
-            binCount[mod_bin]++;
+    Chroma_params params;
+    params.samples_per_frame = reader.samples_per_frame;
+    params.full_data_size = full_data_size;
+    params.low_bin = low_bin;
+    params.high_bin = high_bin;
+    params.bin_map = bin_map;
+    params.hamming = hamming;
+    params.silence_threshold = silence_threshold;
+
+    // Windows are read in order, a batch at a time, and the frames of a
+    // batch are computed by several threads, each with its own FFT buffers
+    unsigned n_threads = std::thread::hardware_concurrency();
+    if (n_threads < 1) n_threads = 1;
+    int batch_size = 16 * n_threads;
+    float *batch = ALLOC(float, batch_size * full_data_size);
+    assert(batch != NULL);
+    std::vector<float *> fft_data(2 * n_threads);
+    for (i = 0; i < (int) fft_data.size(); i++) {
+        fft_data[i] = ALLOC(float, full_data_size);
+        assert(fft_data[i] != NULL);
+        memset(fft_data[i], 0, full_data_size * sizeof(float));
+    }
+    // build the shared FFT tables before the threads use them
+    InitFFT3();
+
+    bool more = true;
+    while (more) {
+        int n = 0;
+        while (n < batch_size &&
+               reader.read_window(batch + n * full_data_size))
+            n++;
+        more = (n == batch_size);
+        if (n == 0)
+            break;
+        assert(cv_index + n <= reader.frame_count);
+
+        float *chroma = AREF1(*chrom_energy, cv_index);
+        int n_workers = min((int) n_threads, n);
+        auto work = [&](int w) {
+            for (int f = w; f < n; f += n_workers)
+                chroma_frame(params, batch + f * full_data_size,
+                             fft_data[2 * w], fft_data[2 * w + 1],
+                             chroma + f * (CHROMA_BIN_COUNT + 1));
+        };
+        if (n_workers <= 1)
+            work(0);
+        else {
+            std::vector<std::thread> threads;
+            for (int w = 1; w < n_workers; w++)
+                threads.push_back(std::thread(work, w));
+            work(0);
+            for (auto &thread : threads)
+                thread.join();
         }
 
-        /*-------------------------------------
-          END OF BIN GENERATION
-          -------------------------------------*/
-        /* THE FOLLOWING LOOKS LIKE SOME OLD CODE TO COMPUTE
-         * CHROMA FLUX, BUT IT IS NOT IN USE NOW 
-         
-        if (PRINT_BIN_ENERGY) {
-            float mao1;
-            float sum=0.;
-         
-            for (i = 0; i < CHROMA_BIN_COUNT; i++) {
-                reg12[i]=binEnergy[i] / binCount[i];
-            }
-       
-            if (reg11[0]==-999){
-                printf("Chroma Flux \n\n");
-            } else {
-                for (i = 0; i < CHROMA_BIN_COUNT; i++) {
-                }
-                for (int k = 0; k < CHROMA_BIN_COUNT; k++) {
-                    float x = reg11[k];
-                    float y = reg12[k];
-                    float diff = x - y;
-                    sum += diff * diff;
-                }
-                mao1 = sqrt(sum);         
-                sequence++;      
-                sum = 0.;
-                mao1 = 0.;
-            }
-            for (i = 0; i < CHROMA_BIN_COUNT; i++) {
-                reg11[i]=reg12[i];
+        for (int f = 0; f < n; f++) {
+#if DEBUG_LOG
+            float *cv = AREF1(*chrom_energy, cv_index);
+            fprintf(dbf, "%d@%g) ", cv_index,
+                    cv_index * reader.actual_frame_period);
+            for (int i = 0; i < CHROMA_BIN_COUNT; i++) {
+              fprintf(dbf, "%d:%g ", i, cv[i]);
             }
-            //fclose(Pointer);
-          }
-        */
-        //put chrom energy into the returned array
-
-#ifdef SA_VERBOSE
-        fprintf(dbf, "cv_index %d\n", cv_index);
+            fprintf(dbf, " sil?:%g\n\n", cv[CHROMA_BIN_COUNT]);
 #endif
-        assert(cv_index < reader.frame_count);
-        float *cv = AREF1(*chrom_energy, cv_index);
-        for (i = 0;  i < CHROMA_BIN_COUNT; i++) {
-            cv[i] = binEnergy[i] / binCount[i];
+            cv_index++;
         }
-        if (rms < silence_threshold) {
-            // "silence" flag
-            cv[CHROMA_BIN_COUNT] = 1.0f;
-        } else {
-            cv[CHROMA_BIN_COUNT] = 0.0f;
-            // normalize the non-silent frames
-            normalize(cv);
-        }
-#if DEBUG_LOG
-        fprintf(dbf, "%d@%g) ", cv_index, cv_index * reader.actual_frame_period);
-        for (int i = 0; i < CHROMA_BIN_COUNT; i++) {
-          fprintf(dbf, "%d:%g ", i, cv[i]);
-        }
-        fprintf(dbf, " sil?:%g\n\n", cv[CHROMA_BIN_COUNT]);
-#endif
-        cv_index++;
-        if (progress && cv_index % 10 == 0 && 
+        if (progress && 
             !progress->set_feature_progress(
                     float(cv_index * reader.actual_frame_period))) {
             break;
         }
-    } // end of while ((readcount = read_mono_floats...
+    }
 
+    for (i = 0; i < (int) fft_data.size(); i++)
+        free(fft_data[i]);
+    free(batch);
     free(hamming);
-    free(fft_dataI);
-    free(fft_dataR);
-    free(full_data);
     if (verbose)
         printf("\nGenerated Chroma. file%d_frames is %i\n", id, file0_frames);
     return cv_index;
@@ -36,10 +36,20 @@
 // for presmoothing, how near does a point have to be to be "on the line"
 #define NEAR 1.5
 
-// path is file0_frames by file1_frames array, so first index
-// (rows) is in [0 .. file0_frames]. Array is sequence of rows.
-// columns (j) ranges from [0 .. file1_frames]
-#define PATH(i,j) (path[(i) * file1_frames + (j)])
+// The DP keeps only two columns of costs, but records for each cell of
+// the sub-matrix [first_x .. last_x] by [first_y .. last_y] which
+// neighbor the optimal path came from, in 2 bits, 4 cells per byte.
+// Cells are indexed by column (x), then row (y), like the costs were.
+#define STEP_DIAG 0
+#define STEP_X 1 // came from x - 1
+#define STEP_Y 2 // came from y - 1
+#define STEP_INDEX(i,j) \
+    ((size_t) ((i) - first_x) * (last_y - first_y + 1) + ((j) - first_y))
+#define GET_STEP(i,j) \
+    ((steps[STEP_INDEX(i,j) >> 2] >> ((STEP_INDEX(i,j) & 3) * 2)) & 3)
+#define SET_STEP(i,j,s) \
+    (steps[STEP_INDEX(i,j) >> 2] |= (unsigned char) \
+        ((s) << ((STEP_INDEX(i,j) & 3) * 2)))
 
 /*===========================================================================*/
 
@@ -239,11 +249,6 @@ Perform Dynamic Programming to find optimal alignment
 */
 int Scorealign::compare_chroma()
 {
-    float *path;
-    
-    /* Allocate the distance matrix */
-    path = (float *) calloc(file0_frames * file1_frames, sizeof(float));
-    
     /* skip over initial silence in signals */
     if (ignore_silence) {
         first_x = frames_of_init_silence(chrom_energy0, file0_frames);
@@ -261,34 +266,71 @@ int Scorealign::compare_chroma()
         return SA_TOOSHORT;
     }
 
+    /* Allocate the costs of the previous and current columns, the costs
+     * of the last row, and the steps of the path */
+    float *prev = ALLOC(float, file1_frames);
+    float *cur = ALLOC(float, file1_frames);
+    float *last_row = ALLOC(float, file0_frames);
+    size_t cells = STEP_INDEX(last_x, last_y) + 1;
+    unsigned char *steps = (unsigned char *) calloc((cells + 3) / 4, 1);
+    assert(prev != NULL);
+    assert(cur != NULL);
+    assert(last_row != NULL);
+    assert(steps != NULL);
+
     /* Initialize first row and column */
     if (verbose) printf("Performing DP\n"); 
-    PATH(first_x, first_y) = gen_dist(first_x, first_y);
-    for (int x = first_x + 1; x <= last_x; x++)
-        PATH(x, first_y) = gen_dist(x, first_y) + PATH(x - 1, first_y);
-    for (int y = 1; y <= last_y; y++)
-        PATH(first_x, y) = gen_dist(first_x, y) + PATH(first_x, y - 1);
+    // The first row accumulates from the distance at (first_x, first_y)
+    float row_cost = gen_dist(first_x, first_y);
+    // The first column accumulates from row 1 over the (zero) cost of row
+    // 0, unless first_y is 0, and its cost replaces the one at
+    // (first_x, first_y) for the rest of the DP
+    float col_cost = (first_y == 0 ? gen_dist(first_x, 0) : 0);
+    for (int y = 1; y <= first_y; y++)
+        col_cost = gen_dist(first_x, y) + col_cost;
+    prev[first_y] = col_cost;
+    for (int y = first_y + 1; y <= last_y; y++)
+        prev[y] = gen_dist(first_x, y) + prev[y - 1];
+    last_row[first_x] = prev[last_y];
 
 #if DEBUG_LOG
     fprintf(dbf, "DISTANCE MATRIX ***************************\n");
 #endif
     /* Perform DP for the rest of the matrix */
     for (int x = first_x + 1; x <= last_x; x++) {
+        row_cost = gen_dist(x, first_y) + row_cost;
+        cur[first_y] = row_cost;
         for (int y = first_y + 1; y <= last_y; y++) {
-            PATH(x, y) = gen_dist(x, y) +
-                    float(min3(PATH(x-1, y-1), PATH(x-1, y), PATH(x, y-1))); 
+            float diag = prev[y - 1], left = prev[y], down = cur[y - 1];
+            cur[y] = gen_dist(x, y) + float(min3(diag, left, down));
+            // the same choice the backtrace made from the costs
+            if (diag <= left && diag <= down)
+                SET_STEP(x, y, STEP_DIAG);
+            else if (left <= down)
+                SET_STEP(x, y, STEP_X);
+            else
+                SET_STEP(x, y, STEP_Y);
 #if DEBUG_LOG
-            fprintf(dbf, "(%d %d %g) ", x, y, gen_dist(x, y), PATH(x, y));
+            fprintf(dbf, "(%d %d %g) ", x, y, gen_dist(x, y), cur[y]);
 #endif
         }
 #if DEBUG_LOG
         fprintf(dbf, "\n");
 #endif
+        last_row[x] = cur[last_y];
+        float *temp = prev;
+        prev = cur;
+        cur = temp;
         // report progress for each file0_frame (column)
         // This is not quite right if we are ignoring silence because
         // then only a sub-matrix is computed.
-        if (progress && !progress->set_matrix_progress(file1_frames)) 
+        if (progress && !progress->set_matrix_progress(file1_frames)) {
+            free(steps);
+            free(last_row);
+            free(cur);
+            free(prev);
             return SA_CANCEL;
+        }
     }
 #if DEBUG_LOG
     fprintf(dbf, "END OF DISTANCE MATRIX ********************\n");
@@ -317,18 +359,18 @@ int Scorealign::compare_chroma()
         fprintf(dbf, "\nOptimal Path: ");
 #endif
         // find end point, the lowest cost matrix value at one of the
-        // sequence endings
+        // sequence endings; prev now holds the last column
         float min_cost = 1.0E10;
         for (int i = first_x; i <= last_x; i++) {
-            if (PATH(i, last_y) <= min_cost) {
-                min_cost = PATH(i, last_y);
+            if (last_row[i] <= min_cost) {
+                min_cost = last_row[i];
                 x = i;
                 y = last_y;
             }
         }
         for (int j = first_y; j <= last_y; j++) {
-            if (PATH(last_x, j) <= min_cost) {
-                min_cost = PATH(last_x, j);
+            if (prev[j] <= min_cost) {
+                min_cost = prev[j];
                 x = last_x;
                 y = j;
             }
@@ -341,13 +383,13 @@ int Scorealign::compare_chroma()
     while ((x != first_x) || (y != first_y)) {
         path_step(x, y);
 
-        /* Check for the optimal path backwards*/
-        if (x > first_x && y > first_y && PATH(x-1, y-1) <= PATH(x-1, y) &&
-            PATH(x-1, y-1) <= PATH(x, y-1)) {
-            x--;
-            y--;
-        } else if (x > first_x && y > first_y && PATH(x-1, y) <= PATH(x, y-1)) {
-            x--;
+        /* Follow the optimal path backwards*/
+        if (x > first_x && y > first_y) {
+            int step = GET_STEP(x, y);
+            if (step != STEP_Y)
+                x--;
+            if (step != STEP_X)
+                y--;
         } else if (y > first_y) {
             y--;
         } else if (x > first_x) {
@@ -356,7 +398,10 @@ int Scorealign::compare_chroma()
     }
     path_step(x, y);
     path_reverse();
-    free(path);
+    free(steps);
+    free(last_row);
+    free(cur);
+    free(prev);
     return SA_SUCCESS; // success
 }
 
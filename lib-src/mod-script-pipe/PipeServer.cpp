@@ -109,24 +109,176 @@ void PipeServer()
 #else
 
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <string>
 
 const char fifotmpl[] = "/tmp/audacity_script_pipe.%s.%d";
+const char sockettmpl[] = "/tmp/audacity_script_socket.%d";
 
 const int nBuff = 1024;
 
 extern "C" int DoSrv( char * pIn );
 extern "C" int DoSrvMore( char * pOut, int nMax );
 
+// Reads lines from a descriptor, and can tell whether another whole line
+// is already waiting, so that a script may send many commands without
+// waiting for each response
+class LineReader
+{
+public:
+   explicit LineReader(int fd) : mFd(fd), mStart(0) {}
+
+   // Get the next line without its newline; false at the end of input
+   bool Next(std::string &line)
+   {
+      size_t end;
+      while ((end = mBuffer.find('\n', mStart)) == std::string::npos)
+      {
+         mBuffer.erase(0, mStart);
+         mStart = 0;
+         char buf[nBuff];
+         ssize_t got = read(mFd, buf, sizeof(buf));
+         if (got < 0 && errno == EINTR)
+            continue;
+         if (got <= 0)
+            return false;
+         mBuffer.append(buf, got);
+      }
+      line.assign(mBuffer, mStart, end - mStart);
+      mStart = end + 1;
+      return true;
+   }
+
+   bool HasLine() const
+   {
+      return mBuffer.find('\n', mStart) != std::string::npos;
+   }
+
+private:
+   int mFd;
+   std::string mBuffer;
+   size_t mStart;
+};
+
+// Serve commands, one per line, until the input ends.
+// A command may be prefixed with "@<id> "; then its response is preceded
+// by a line "@<id>", so that a script with several commands in flight can
+// match the responses, which come in order.
+// Responses are flushed only when no further command is already waiting.
+static void ServeStream(int in, FILE *out)
+{
+   LineReader reader(in);
+   std::string line;
+   char buf[nBuff];
+   while (reader.Next(line))
+   {
+      if (!line.empty() && line[line.size() - 1] == '\r')
+         line.erase(line.size() - 1);
+      if (line.empty())
+         continue;
+
+      if (line[0] == '@')
+      {
+         size_t space = line.find(' ');
+         std::string id = line.substr(1,
+            space == std::string::npos ? std::string::npos : space - 1);
+         line.erase(0, space == std::string::npos ? line.size() : space + 1);
+         fprintf(out, "@%s\n", id.c_str());
+      }
+
+      DoSrv(&line[0]);
+
+      while (true)
+      {
+         int len = DoSrvMore(buf, nBuff);
+         if (len <= 1)
+         {
+            break;
+         }
+
+         // len - 1 because we do not send the null character
+         fwrite(buf, 1, len - 1, out);
+      }
+
+      if (!reader.HasLine())
+         fflush(out);
+   }
+   fflush(out);
+}
+
+// Accept scripts, one at a time, on a Unix domain socket that only this
+// user may connect to
+static void SocketServer()
+{
+   struct sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   snprintf(addr.sun_path, sizeof(addr.sun_path), sockettmpl, getuid());
+
+   int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (listener < 0)
+   {
+      perror("Unable to create script socket");
+      return;
+   }
+
+   unlink(addr.sun_path);
+   if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       chmod(addr.sun_path, S_IRWXU) < 0 ||
+       listen(listener, 1) < 0)
+   {
+      perror("Unable to listen on script socket");
+      close(listener);
+      return;
+   }
+
+   for (;;)
+   {
+      int fd = accept(listener, NULL, NULL);
+      if (fd < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         perror("Unable to accept on script socket");
+         break;
+      }
+
+      int outFd = dup(fd);
+      FILE *out = outFd < 0 ? NULL : fdopen(outFd, "w");
+      if (out != NULL)
+      {
+         ServeStream(fd, out);
+         fclose(out);
+      }
+      else if (outFd >= 0)
+         close(outFd);
+      close(fd);
+   }
+
+   close(listener);
+   unlink(addr.sun_path);
+}
+
 void PipeServer()
 {
+   // The socket replaces the fifos, if the environment asks for it
+   if (getenv("AUDACITY_SCRIPT_SOCKET") != NULL)
+   {
+      SocketServer();
+      return;
+   }
+
    FILE *fromFifo = NULL;
-   FILE *toFifo = NULL;
+   int toFifo = -1;
    int rc;
-   char buf[nBuff];
    char toFifoName[nBuff];
    char fromFifoName[nBuff];
 
@@ -147,12 +299,10 @@ void PipeServer()
    }
 
    // open to (incoming) pipe first.  
-   toFifo = fopen(toFifoName, "r");
-   if (toFifo == NULL)
+   toFifo = open(toFifoName, O_RDONLY);
+   if (toFifo < 0)
    {
       perror("Unable to open fifo to server from script");
-      if (fromFifo != NULL)
-         fclose(fromFifo);
       return;
    }
 
@@ -161,44 +311,16 @@ void PipeServer()
    if (fromFifo == NULL)
    {
       perror("Unable to open fifo from server to script");
+      close(toFifo);
       return;
    }
 
-   while (fgets(buf, sizeof(buf), toFifo) != NULL)
-   {
-      int len = strlen(buf);
-      if (len <= 1)
-      {
-         continue;
-      }
-
-      buf[len - 1] = '\0';
-
-      printf("Server received %s\n", buf);
-      DoSrv(buf);
-
-      while (true)
-      {
-         len = DoSrvMore(buf, nBuff);
-         if (len <= 1)
-         {
-            break;
-         }
-         printf("Server sending %s",buf);
-
-         // len - 1 because we do not send the null character
-         fwrite(buf, 1, len - 1, fromFifo);
-      }
-      fflush(fromFifo);
-   }
+   ServeStream(toFifo, fromFifo);
 
    printf("Read failed on fifo, quitting\n");
 
-   if (toFifo != NULL)
-      fclose(toFifo);
-
-   if (fromFifo != NULL)
-      fclose(fromFifo);
+   close(toFifo);
+   fclose(fromFifo);
 
    unlink(toFifoName);
    unlink(fromFifoName);
@@ -441,12 +441,14 @@ void AColor::Solo(wxDC * dc, bool on, bool selected)
 }
 
 bool AColor::gradient_inited = 0;
+unsigned AColor::gradient_generation = 0;
 
 void AColor::ReInit()
 {
    inited=false;
    Init();
    gradient_inited=0;
+   ++gradient_generation;
    PreComputeGradient();
 }
 
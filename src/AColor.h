@@ -123,6 +123,8 @@ class AColor {
    static wxBrush tooltipBrush;
 
    static bool gradient_inited;
+   // Changes whenever gradient_pre is recomputed for another theme
+   static unsigned gradient_generation;
    static const int gradientSteps = 512;
    static unsigned char gradient_pre[ColorGradientTotal][2][gradientSteps][3];
 
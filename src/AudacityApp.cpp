@@ -69,9 +69,13 @@ It handles initialization and termination by subclassing wxApp.
 #include "AboutDialog.h"
 #include "AColor.h"
 #include "AudioIO.h"
+#include "BatchCommands.h"
 #include "Benchmark.h"
+#include "BlockSampleCache.h"
+#include "CacheBudget.h"
 #include "Clipboard.h"
 #include "CrashReport.h"
+#include "DeviceManager.h"
 #include "DirManager.h"
 #include "commands/CommandHandler.h"
 #include "commands/AppCommandEvent.h"
@@ -92,6 +96,7 @@ It handles initialization and termination by subclassing wxApp.
 #include "ProjectWindow.h"
 #include "Screenshot.h"
 #include "Sequence.h"
+#include "StartupTimer.h"
 #include "WaveTrack.h"
 #include "prefs/PrefsDialog.h"
 #include "Theme.h"
@@ -1347,6 +1352,13 @@ bool AudacityApp::OnInit()
          UnwritablePreferencesErrorMessage( configFileName ) );
       return false;
    }
+   CacheBudget::UpdatePrefs();
+   BlockSampleCache::UpdatePrefs();
+   StartupTimer::Mark( XO("Preferences") );
+
+   // Open the audio devices to count their sources meanwhile; AudioIO::Init
+   // waits for it
+   DeviceManager::Instance()->StartInitialScan();
 
 #if defined(__WXMSW__) && !defined(__WXUNIVERSAL__) && !defined(__CYGWIN__)
    this->AssociateFileTypes();
@@ -1356,6 +1368,7 @@ bool AudacityApp::OnInit()
 
    // AColor depends on theTheme.
    AColor::Init();
+   StartupTimer::Mark( XO("Theme") );
 
    // Init DirManager, which initializes the temp directory
    // If this fails, we must exit the program.
@@ -1369,14 +1382,18 @@ bool AudacityApp::OnInit()
    // If we're waiitng in a dialog before then we can very easily
    // start multiple instances, defeating the single instance checker.
 
+   StartupTimer::Mark( XO("Temporary directory") );
+
    // Initialize the CommandHandler
    InitCommandHandler();
 
    // Initialize the PluginManager
    PluginManager::Get().Initialize();
+   StartupTimer::Mark( XO("Plug-in registry") );
 
    // Initialize the ModuleManager, including loading found modules
    ModuleManager::Get().Initialize(*mCmdHandler);
+   StartupTimer::Mark( XO("Modules") );
 
    // Parse command line and handle options that might require
    // immediate exit...no need to initialize all of the audio
@@ -1472,6 +1489,7 @@ bool AudacityApp::OnInit()
 
       InitDitherers();
       AudioIO::Init();
+      StartupTimer::Mark( XO("Audio I/O") );
 
 #ifdef __WXMAC__
 
@@ -1514,8 +1532,16 @@ bool AudacityApp::OnInit()
    // creating the project.
    // Root cause is problem with wxSplashScreen and other dialogs co-existing, that
    // seemed to arrive with wx3.
+   wxString macroName, benchmarkPath, benchmarkLimitsPath;
+   const bool benchmarkMode = parser->Found(wxT("j"), &benchmarkPath);
+   parser->Found(wxT("benchmark-limits"), &benchmarkLimitsPath);
+   const bool batchMode =
+      parser->Found(wxT("m"), &macroName) || benchmarkMode;
    {
       project = ProjectManager::New();
+      if (batchMode)
+         // Process the files without a visible project window
+         GetProjectFrame( *project ).Show(false);
       wxWindow * pWnd = MakeHijackPanel();
       if (pWnd)
       {
@@ -1526,8 +1552,9 @@ bool AudacityApp::OnInit()
          pWnd->Show(true);
       }
    }
+   StartupTimer::Mark( XO("First project window") );
 
-   if( ProjectSettings::Get( *project ).GetShowSplashScreen() ){
+   if( !batchMode && ProjectSettings::Get( *project ).GetShowSplashScreen() ){
       // This may do a check-for-updates at every start up.
       // Mainly this is to tell users of ALPHAS who don't know that they have an ALPHA.
       // Disabled for now, after discussion.
@@ -1540,6 +1567,7 @@ bool AudacityApp::OnInit()
    #endif
 
    Importer::Get().Initialize();
+   StartupTimer::Mark( XO("Importers") );
 
    // Bug1561: delay the recovery dialog, to avoid crashes.
    CallAfter( [=] () mutable {
@@ -1566,6 +1594,42 @@ bool AudacityApp::OnInit()
       //
       if (!didRecoverAnything)
       {
+         if (benchmarkMode)
+         {
+            if (!RunHeadlessBenchmark(
+                  *project, benchmarkPath, benchmarkLimitsPath ))
+               wxPrintf(_("Benchmark failed\n"));
+            QuitAudacity(true);
+            return;
+         }
+
+         if (batchMode)
+         {
+            MacroCommands macroCommands{ *project };
+            if (!macroCommands.ReadMacro(macroName))
+            {
+               wxPrintf(_("Macro '%s' not found\n"), macroName);
+               QuitAudacity(true);
+               return;
+            }
+
+            wxArrayString files;
+            for (size_t i = 0, cnt = parser->GetParamCount(); i < cnt; i++)
+               files.push_back(parser->GetParam(i));
+
+            MacroCommandsCatalog catalog{ project };
+            const auto done = macroCommands.ApplyMacroToFiles(
+               catalog, files, [&](size_t i){
+                  wxPrintf(wxT("%s\n"), files[i]);
+                  return true;
+               } );
+            if (done < files.size())
+               wxPrintf(_("Macro failed on file %s\n"), files[done]);
+
+            QuitAudacity(true);
+            return;
+         }
+
          if (parser->Found(wxT("t")))
          {
             RunBenchmark( nullptr, ProjectSettings::Get( *project ) );
@@ -2065,6 +2129,26 @@ std::unique_ptr<wxCmdLineParser> AudacityApp::ParseCommandLine()
    parser->AddOption(wxT("d"), wxT("decode"), _("decode an autosave file"),
                      wxCMD_LINE_VAL_STRING);
 
+   /*i18n-hint: This applies a macro to each of the files named on the
+    *           command line, without showing the project window, and then
+    *           exits */
+   parser->AddOption(wxT("m"), wxT("macro"),
+                     _("apply the named macro to the files, then exit"),
+                     wxCMD_LINE_VAL_STRING);
+
+   /*i18n-hint: This runs the speed tests without showing the project
+    *           window, writes their timings to the named file, and then
+    *           exits */
+   parser->AddOption(wxT("j"), wxT("benchmark"),
+                     _("run the benchmarks, write JSON results to the file, then exit"),
+                     wxCMD_LINE_VAL_STRING);
+
+   /*i18n-hint: This names a file of the longest allowed times of the
+    *           speed tests */
+   parser->AddOption(wxT(""), wxT("benchmark-limits"),
+                     _("fail the benchmarks whose median times exceed the limits in the file"),
+                     wxCMD_LINE_VAL_STRING);
+
    /*i18n-hint: This displays a list of available options */
    parser->AddSwitch(wxT("h"), wxT("help"), _("this help message"),
                      wxCMD_LINE_OPTION_HELP);
@@ -61,7 +61,10 @@ to the meters.
   latency to the output device allows Audacity to stop audio output
   quickly. We want the same behavior for MIDI, but there is not
   periodic callback from PortMidi (because MIDI is asynchronous), so
-  this function is performed by the MidiThread class.
+  this function is performed by the MidiThread class.  It does not poll:
+  after each pass it sleeps until the next event falls due, computed
+  from the event times, and is woken early when the stream starts or
+  pauses.
 
   \par
   When Audio is running, MIDI is synchronized to Audio. Globals are set
@@ -427,6 +430,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 #include <math.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <limits>
 
 #ifdef __WXMSW__
 #include <malloc.h>
@@ -453,16 +457,21 @@ time warp info and AudioIOListener and whether the playback is looped.
 #include <wx/power.h>
 #endif
 
+#include "LatencyMeasurement.h"
 #include "MissingAliasFileDialog.h"
 #include "Mix.h"
+#include "RealtimeSafety.h"
+#include "RealtimeScheduling.h"
 #include "Resample.h"
 #include "RingBuffer.h"
 #include "prefs/GUISettings.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "Project.h"
 #include "WaveTrack.h"
 #include "AutoRecovery.h"
 
+#include "blockfile/SimpleBlockFile.h"
 #include "effects/RealtimeEffectManager.h"
 #include "prefs/QualityPrefs.h"
 #include "prefs/RecordingPrefs.h"
@@ -473,6 +482,10 @@ time warp info and AudioIOListener and whether the playback is looped.
 
 #ifdef EXPERIMENTAL_MIDI_OUT
    #define MIDI_SLEEP 10 /* milliseconds */
+   // the MIDI thread sleeps until the next event is due, but at most
+   // this long, and at least one millisecond, since AudioTime() only
+   // advances with each callback
+   #define MIDI_MAX_WAIT 50 /* milliseconds */
    // how long do we think the thread that fills MIDI buffers,
    // if it is separate from the portaudio thread,
    // might be delayed due to other threads?
@@ -534,6 +547,25 @@ constexpr size_t TimeQueueGrainSize = 2000;
 #include "pa_linux_alsa.h"
 #endif
 
+namespace {
+// Read at each start of a stream
+Setting<long> RecordChannelsSetting{ wxT("/AudioIO/RecordChannels"), 2L };
+Setting<bool> SoftwarePlaythroughSetting{ wxT("/AudioIO/SWPlaythrough"), false };
+Setting<bool> SoundActivatedRecordSetting{
+   wxT("/AudioIO/SoundActivatedRecord"), false };
+Setting<bool> MicrofadesSetting{ wxT("/AudioIO/Microfades"), false };
+Setting<int> SilenceLevelSetting{ wxT("/AudioIO/SilenceLevel"), -50 };
+Setting<int> SoundActivationAttackSetting{
+   wxT("/AudioIO/SoundActivationAttack"), 0 };
+Setting<int> SoundActivationHoldSetting{
+   wxT("/AudioIO/SoundActivationHold"), 500 };
+Setting<int> EnvdBRangeSetting{ ENV_DB_KEY, ENV_DB_RANGE };
+Setting<double> LatencyCorrectionSetting{
+   wxT("/AudioIO/LatencyCorrection"), DEFAULT_LATENCY_CORRECTION };
+#ifdef __WXGTK__
+Setting<wxString> HostSetting{ wxT("/AudioIO/Host"), wxString{} };
+#endif
+}
 
 struct AudioIoCallback::ScrubState
 {
@@ -551,8 +583,23 @@ struct AudioIoCallback::ScrubState
    {
       // Called by another thread
       mMessage.Write({ end, options });
+      mUpdates.fetch_add( 1, std::memory_order_release );
    }
 
+   // Called by the thread that calls AudioIO::FillBuffers:  whether there
+   // was an Update since the last call
+   bool TakeUpdate()
+   {
+      const auto updates = mUpdates.load( std::memory_order_acquire );
+      const bool fresh = ( updates != mTakenUpdates );
+      mTakenUpdates = updates;
+      return fresh;
+   }
+
+   // Whether the options at the last Get were for seeking, in which every
+   // stutter must be produced at once
+   bool IsSeeking() const { return mSeeking; }
+
    void Get(sampleCount &startSample, sampleCount &endSample,
          sampleCount inDuration, sampleCount &duration)
    {
@@ -561,6 +608,7 @@ struct AudioIoCallback::ScrubState
       sampleCount s0Init;
 
       Message message( mMessage.Read() );
+      mSeeking = message.options.adjustStart;
       if ( !mStarted ) {
          s0Init = llrint( mRate *
             std::max( message.options.minTime,
@@ -801,6 +849,9 @@ private:
    };
    MessageBuffer<Message> mMessage;
    sampleCount mAccumulatedSeekDuration{};
+   std::atomic<unsigned> mUpdates{ 0 };
+   unsigned mTakenUpdates{ 0 };
+   bool mSeeking{ false };
 };
 #endif
 
@@ -888,6 +939,12 @@ class AudioThread /* not final */ : public wxThread {
 
 #endif
 
+// Drains the capture buffers
+class CaptureThread final : public AudioThread {
+ public:
+   ExitCode Entry() override;
+};
+
 #ifdef EXPERIMENTAL_MIDI_OUT
 class MidiThread final : public AudioThread {
  public:
@@ -904,8 +961,14 @@ class MidiThread final : public AudioThread {
 
 void AudioIO::Init()
 {
+   // The first scan of devices may still be using PortAudio
+   auto &deviceManager = *DeviceManager::Instance();
+   deviceManager.WaitForInitialScan();
    ugAudioIO.reset(safenew AudioIO());
+   // Now PortAudio stays initialized by AudioIO
+   deviceManager.ReleaseInitialScan();
    Get()->mThread->Run();
+   Get()->mCaptureThread->Run();
 #ifdef EXPERIMENTAL_MIDI_OUT
 #ifdef USE_MIDI_THREAD
    Get()->mMidiThread->Run();
@@ -966,6 +1029,8 @@ AudioIO::AudioIO()
    mAudioThreadShouldCallFillBuffersOnce = false;
    mAudioThreadFillBuffersLoopRunning = false;
    mAudioThreadFillBuffersLoopActive = false;
+   mCaptureThreadLoopActive = false;
+   mProAudioMode = false;
    mPortStreamV19 = NULL;
 
 #ifdef EXPERIMENTAL_MIDI_OUT
@@ -991,6 +1056,11 @@ AudioIO::AudioIO()
    mNumCaptureChannels = 0;
    mPaused = false;
    mSilenceLevel = 0.0;
+   mSoundActivationAttack = 0.0;
+   mSoundActivationHold = 0.0;
+   mFramesAboveSilence = 0;
+   mFramesBelowSilence = 0;
+   mSoundActivationPending = false;
 
    mUpdateMeters = false;
    mUpdatingMeters = false;
@@ -1049,6 +1119,8 @@ AudioIO::AudioIO()
    // Start thread
    mThread = std::make_unique<AudioThread>();
    mThread->Create();
+   mCaptureThread = std::make_unique<CaptureThread>();
+   mCaptureThread->Create();
 
 #if defined(USE_PORTMIXER)
    mPortMixer = NULL;
@@ -1107,6 +1179,8 @@ AudioIO::~AudioIO()
 
    mThread->Delete();
    mThread.reset();
+   mCaptureThread->Delete();
+   mCaptureThread.reset();
 }
 
 void AudioIO::SetMixer(int inputSource, float recordVolume,
@@ -1426,9 +1500,144 @@ bool AudioIO::StartPortAudioStream(const AudioIOStartStreamOptions &options,
    }
 #endif
 
+   // The stream does not run yet, so the callback can't be using the old
+   if (mPortStreamV19 != NULL && mLastPaError == paNoError)
+      AllocateCallbackScratch();
+
    return (mLastPaError == paNoError);
 }
 
+struct AudioIoCallback::CallbackScratch
+{
+   // The most frames per buffer the rest is sized for
+   size_t frames{ 0 };
+
+   // For AudioCallback
+   Floats tempFloats;
+   Floats outputMeterFloats;
+
+   // For FillOutputBuffers, by playback channel
+   ArrayOf<WaveTrack*> chans;
+   ArrayOf<size_t> chanTracks;
+   ArrayOf<float*> tempBufs;
+   FloatBuffers scratchBufs;
+   ArrayOf<float*> scratchPtrs;
+   ArrayOf<RingBuffer*> toConsume;
+
+   // For FillOutputBuffers, by playback track
+   ArrayOf<RealtimeEffectManager::Job> jobs;
+   ArrayOf<bool> jobDrops;
+   ArrayOf<WaveTrack*> jobTracks;
+   ArrayOf<size_t> jobTrackIndices;
+   ArrayOf<float*> jobBufs;
+   ArrayOf<RingBuffer*> jobConsume;
+};
+
+void AudioIO::AllocateCallbackScratch()
+{
+   // With paFramesPerBufferUnspecified, the host decides the buffer size,
+   // which should not much exceed the latency it reports.  A callback with
+   // more frames still than this falls back to the stack.
+   const auto info = Pa_GetStreamInfo( mPortStreamV19 );
+   const auto latency = info
+      ? std::max( info->inputLatency, info->outputLatency ) : 0.0;
+   const size_t frames =
+      std::max<size_t>( 16384, lrint( 2 * latency * mRate ) );
+
+   const auto numPlaybackChannels = mNumPlaybackChannels;
+   const auto numCaptureChannels = mNumCaptureChannels;
+   const auto numPlaybackTracks = mPlaybackTracks.size();
+
+   auto scratch = std::make_unique<CallbackScratch>();
+   scratch->frames = frames;
+   scratch->tempFloats.reinit(
+      frames * std::max( numCaptureChannels, numPlaybackChannels ) );
+   scratch->outputMeterFloats.reinit( frames * numPlaybackChannels );
+
+   scratch->chans.reinit( numPlaybackChannels );
+   scratch->chanTracks.reinit( numPlaybackChannels );
+   scratch->tempBufs.reinit( numPlaybackChannels );
+   scratch->scratchBufs.reinit( numPlaybackChannels, frames );
+   scratch->scratchPtrs.reinit( numPlaybackChannels );
+   for (unsigned c = 0; c < numPlaybackChannels; c++)
+      scratch->scratchPtrs[c] = scratch->scratchBufs[c].get();
+   scratch->toConsume.reinit( numPlaybackChannels );
+
+   scratch->jobs.reinit( numPlaybackTracks );
+   scratch->jobDrops.reinit( numPlaybackTracks );
+   scratch->jobTracks.reinit( numPlaybackTracks );
+   scratch->jobTrackIndices.reinit( numPlaybackTracks );
+   scratch->jobBufs.reinit( numPlaybackTracks );
+   scratch->jobConsume.reinit( numPlaybackTracks );
+
+   mCallbackScratch = std::move( scratch );
+   mPlaybackLevels.reinit( numPlaybackTracks );
+}
+
+bool AudioIO::TakePlaybackLevels(
+   const WaveTrack &leader, PlaybackLevels::Levels &levels)
+{
+   const auto numPlaybackTracks = mPlaybackTracks.size();
+   if (!mPlaybackLevels)
+      return false;
+   size_t t = 0;
+   while (t < numPlaybackTracks && mPlaybackTracks[t].get() != &leader)
+      ++t;
+   if (t == numPlaybackTracks)
+      return false;
+
+   // Each channel of the group feeds one output channel, or a mono track
+   // both; so combining them adds nothing up twice
+   levels = mPlaybackLevels[t].Take();
+   while (++t < numPlaybackTracks && !mPlaybackTracks[t]->IsLeader()) {
+      const auto more = mPlaybackLevels[t].Take();
+      levels.frames = std::max(levels.frames, more.frames);
+      for (unsigned c = 0; c < 2; ++c) {
+         levels.peak[c] = std::max(levels.peak[c], more.peak[c]);
+         levels.rms[c] = sqrt(
+            levels.rms[c] * levels.rms[c] + more.rms[c] * more.rms[c]);
+         levels.clipped[c] += more.clipped[c];
+      }
+   }
+   return true;
+}
+
+struct AudioIoCallback::CaptureScratch
+{
+   // The most frames taken from mCaptureBuffer at once
+   size_t frames{ 0 };
+
+   // By capture track, its channel apart in mCaptureFormat
+   FloatBuffers channels;
+   ArrayOf<samplePtr> channelPtrs;
+
+   // For one track at a time, converted to float, and resampled
+   Floats floats;
+   Floats resampled;
+};
+
+void AudioIO::AllocateCaptureScratch()
+{
+   // Chunks of the tracks' block size fill their append buffers in few
+   // steps; this also bounds the scratch to the size of the ring buffer
+   size_t frames = mCaptureBuffer->AvailForPut() / mNumCaptureChannels;
+   for (const auto &track : mCaptureTracks)
+      frames = std::min( frames, track->GetMaxBlockSize() );
+   frames = std::max<size_t>( frames, 1 );
+
+   const auto numCaptureTracks = mCaptureTracks.size();
+
+   auto scratch = std::make_unique<CaptureScratch>();
+   scratch->frames = frames;
+   // Samples of the capture format fit where floats do
+   scratch->channels.reinit( numCaptureTracks, frames );
+   scratch->channelPtrs.reinit( numCaptureTracks );
+   scratch->floats.reinit( frames );
+   scratch->resampled.reinit( lrint( frames * mFactor ) + 1 );
+
+   mCaptureScratch = std::move( scratch );
+}
+
 wxString AudioIO::LastPaErrorString()
 {
    return wxString::Format(wxT("%d %s."), (int) mLastPaError, Pa_GetErrorText(mLastPaError));
@@ -1442,8 +1651,8 @@ void AudioIO::StartMonitoring( const AudioIOStartStreamOptions &options )
    bool success;
    long captureChannels;
    auto captureFormat = QualityPrefs::SampleFormatChoice();
-   gPrefs->Read(wxT("/AudioIO/RecordChannels"), &captureChannels, 2L);
-   gPrefs->Read(wxT("/AudioIO/SWPlaythrough"), &mSoftwarePlaythrough, false);
+   captureChannels = RecordChannelsSetting.Read();
+   mSoftwarePlaythrough = SoftwarePlaythroughSetting.Read();
    int playbackChannels = 0;
 
    if (mSoftwarePlaythrough)
@@ -1520,16 +1729,15 @@ int AudioIO::StartStream(const TransportTracks &tracks,
 #ifdef __WXGTK__
    // Detect whether ALSA is the chosen host, and do the various involved MIDI
    // timing compensations only then.
-   mUsingAlsa = (gPrefs->Read(wxT("/AudioIO/Host"), wxT("")) == "ALSA");
+   mUsingAlsa = (HostSetting.Read() == "ALSA");
 #endif
 
-   gPrefs->Read(wxT("/AudioIO/SWPlaythrough"), &mSoftwarePlaythrough, false);
-   gPrefs->Read(wxT("/AudioIO/SoundActivatedRecord"), &mPauseRec, false);
-   gPrefs->Read(wxT("/AudioIO/Microfades"), &mbMicroFades, false);
-   int silenceLevelDB;
-   gPrefs->Read(wxT("/AudioIO/SilenceLevel"), &silenceLevelDB, -50);
-   int dBRange;
-   dBRange = gPrefs->Read(ENV_DB_KEY, ENV_DB_RANGE);
+   mSoftwarePlaythrough = SoftwarePlaythroughSetting.Read();
+   mPauseRec = SoundActivatedRecordSetting.Read();
+   mbMicroFades = MicrofadesSetting.Read();
+   mProAudioMode = RealtimeScheduling::IsEnabled();
+   int silenceLevelDB = SilenceLevelSetting.Read();
+   int dBRange = EnvdBRangeSetting.Read();
    if(silenceLevelDB < -dBRange)
    {
       silenceLevelDB = -dBRange + 3;
@@ -1543,16 +1751,26 @@ int AudioIO::StartStream(const TransportTracks &tracks,
       // gPrefs->Write(wxT("/AudioIO/SilenceLevel"), silenceLevelDB);
       // gPrefs->Flush();
    }
-   mSilenceLevel = (silenceLevelDB + dBRange)/(double)dBRange;  // meter goes -dBRange dB -> 0dB
+   // Compared with the peaks of the input buffers, not of the meter, which
+   // may show a linear scale and lags by its refresh rate
+   mSilenceLevel = DB_TO_LINEAR(silenceLevelDB);
+   mSoundActivationAttack =
+      std::max(0, SoundActivationAttackSetting.Read()) / 1000.0;
+   mSoundActivationHold =
+      std::max(0, SoundActivationHoldSetting.Read()) / 1000.0;
+   mFramesAboveSilence = mFramesBelowSilence = 0;
+   mSoundActivationPending = false;
 
    // Clamp pre-roll so we don't play before time 0
    const auto preRoll = std::max(0.0, std::min(t0, options.preRoll));
    mRecordingSchedule = {};
    mRecordingSchedule.mPreRoll = preRoll;
-   mRecordingSchedule.mLatencyCorrection =
-      (gPrefs->ReadDouble(wxT("/AudioIO/LatencyCorrection"),
-                   DEFAULT_LATENCY_CORRECTION))
-         / 1000.0;
+   // A loopback measurement for these devices takes precedence over the
+   // compensation entered by hand
+   double latencyCorrection;
+   if (!LatencyMeasurement::GetStored(latencyCorrection))
+      latencyCorrection = LatencyCorrectionSetting.Read();
+   mRecordingSchedule.mLatencyCorrection = latencyCorrection / 1000.0;
    mRecordingSchedule.mDuration = t1 - t0;
    if (options.pCrossfadeData)
       mRecordingSchedule.mCrossfadeData.swap( *options.pCrossfadeData );
@@ -1561,6 +1779,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    mRate    = options.rate;
 
    mSeek    = 0;
+   mPositionStamp.Reset();
    mLastRecordingOffset = 0;
    mCaptureTracks = tracks.captureTracks;
    mPlaybackTracks = tracks.playbackTracks;
@@ -1585,7 +1804,8 @@ int AudioIO::StartStream(const TransportTracks &tracks,
 
    mPlaybackBuffers.reset();
    mPlaybackMixers.reset();
-   mCaptureBuffers.reset();
+   mCaptureBuffer.reset();
+   mCaptureScratch.reset();
    mResample.reset();
    mTimeQueue.mData.reset();
 
@@ -1734,6 +1954,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    // audio thread call FillBuffers here makes the code more predictable, since
    // FillBuffers will ALWAYS get called from the Audio thread.
    mAudioThreadShouldCallFillBuffersOnce = true;
+   WakeAudioThread();
 
    while( mAudioThreadShouldCallFillBuffersOnce ) {
       auto interval = 50ull;
@@ -1775,6 +1996,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
       // Probably not needed so urgently before portaudio thread start for usual
       // playback, since our ring buffers have been primed already with 4 sec
       // of audio, but then we might be scrubbing, so do it.
+      mMetrics.Reset( mRate );
       mAudioThreadFillBuffersLoopRunning = true;
 
       // Now start the PortAudio stream!
@@ -1910,6 +2132,13 @@ bool AudioIO::AllocateBuffers(
             mPlaybackQueueMinimum =
                std::min( mPlaybackQueueMinimum, playbackBufferSize );
 
+            // Mouse scrubbing without seeking keeps a queue of two polls of
+            // the mouse, enough to ride out a late one
+            mScrubQueueMinimum = 0;
+            if (scrubbing)
+               mScrubQueueMinimum = std::min( playbackBufferSize,
+                  std::max<size_t>( 1, 2 * mPlaybackSamplesToCopy ) );
+
             for (unsigned int i = 0; i < mPlaybackTracks.size(); i++)
             {
                // Bug 1763 - We must fade in from zero to avoid a click on starting.
@@ -1956,8 +2185,8 @@ bool AudioIO::AllocateBuffers(
 
          if( mNumCaptureChannels > 0 )
          {
-            // Allocate input buffers.  For every input track we allocate
-            // a ring buffer of five seconds
+            // Allocate input buffers.  One ring buffer holds five seconds
+            // of all the input channels
             auto captureBufferSize =
                (size_t)(mRate * mCaptureRingBufferSecs + 0.5);
 
@@ -1969,18 +2198,21 @@ bool AudioIO::AllocateBuffers(
                return false;
             }
 
-            mCaptureBuffers.reinit(mCaptureTracks.size());
+            // The callback copies into it in the device's format; its size
+            // is a whole number of frames, and so are all reads and writes
+            mCaptureBuffer = std::make_unique<RingBuffer>(
+               mCaptureFormat, captureBufferSize * mNumCaptureChannels );
             mResample.reinit(mCaptureTracks.size());
             mFactor = sampleRate / mRate;
 
             for( unsigned int i = 0; i < mCaptureTracks.size(); i++ )
             {
-               mCaptureBuffers[i] = std::make_unique<RingBuffer>(
-                  mCaptureTracks[i]->GetSampleFormat(), captureBufferSize );
                mResample[i] =
                   std::make_unique<Resample>(true, mFactor, mFactor);
                   // constant rate resampling
             }
+
+            AllocateCaptureScratch();
          }
       }
       catch(std::bad_alloc&)
@@ -2005,6 +2237,31 @@ bool AudioIO::AllocateBuffers(
          }
       }
    } while(!bDone);
+
+   if (mProAudioMode) {
+      // Keep what the audio threads and the callback touch out of the page
+      // file; the locks go with the buffers in StartStreamCleanup
+      size_t locked = 0, total = 0;
+      for (unsigned int i = 0; i < mPlaybackTracks.size(); i++) {
+         total += 2;
+         locked += mPlaybackBuffers[i]->LockMemory();
+         locked += mPlaybackMixers[i]->LockMemory();
+      }
+      if (mCaptureBuffer) {
+         ++total;
+         locked += mCaptureBuffer->LockMemory();
+      }
+      RealtimeScheduling::RecordMemoryLocks( locked, total );
+   }
+
+   // Nothing is done with less than a batch, so the callback need not wake
+   // the threads any sooner
+   mAudioThreadWaker.Reset( mPlaybackTracks.empty()
+      ? std::numeric_limits<size_t>::max()
+      : mPlaybackSamplesToCopy );
+   mCaptureThreadWaker.Reset( mCaptureTracks.empty()
+      ? std::numeric_limits<size_t>::max()
+      : std::max<size_t>(1, mMinCaptureSecsToCopy * mRate) );
    
    success = true;
    return true;
@@ -2019,7 +2276,8 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
 
    mPlaybackBuffers.reset();
    mPlaybackMixers.reset();
-   mCaptureBuffers.reset();
+   mCaptureBuffer.reset();
+   mCaptureScratch.reset();
    mResample.reset();
    mTimeQueue.mData.reset();
 
@@ -2131,6 +2389,9 @@ bool AudioIO::StartPortMidiStream()
       Pm_Synchronize(mMidiStream); // start using timestamps
       // start midi output flowing (pending first audio callback)
       mMidiThreadFillBuffersLoopRunning = true;
+#ifdef USE_MIDI_THREAD
+      mMidiThreadWaker.Wake();
+#endif
    }
    return (mLastPmError == pmNoError);
 }
@@ -2156,6 +2417,7 @@ void AudioIO::StopStream()
    auto cleanup = finally ( [this] {
       ClearRecordingException();
       mRecordingSchedule.mCrossfadeData.clear(); // free arrays
+      SimpleBlockFile::SetWriteThrottled(false);
    } );
 
    if( mPortStreamV19 == NULL
@@ -2312,7 +2574,14 @@ void AudioIO::StopStream()
       // to the target WaveTrack.  To do this, we ask the audio thread to
       // call FillBuffers one last time (it normally would not do so since
       // Pa_GetStreamActive() would now return false
+
+      // The capture thread may be amid a pass it began before the stream
+      // stopped; let it finish, so that none begins after the last one
+      while( mCaptureThreadLoopActive )
+         wxMilliSleep( 1 );
+
       mAudioThreadShouldCallFillBuffersOnce = true;
+      WakeAudioThread();
 
       while( mAudioThreadShouldCallFillBuffersOnce )
       {
@@ -2338,7 +2607,8 @@ void AudioIO::StopStream()
       //
       if (mCaptureTracks.size() > 0)
       {
-         mCaptureBuffers.reset();
+         mCaptureBuffer.reset();
+         mCaptureScratch.reset();
          mResample.reset();
 
          //
@@ -2458,14 +2728,22 @@ void AudioIO::SetPaused(bool state)
    }
 
    mPaused = state;
+
+#if defined(EXPERIMENTAL_MIDI_OUT) && defined(USE_MIDI_THREAD)
+   // Silence or resume the notes promptly, not at the next event
+   mMidiThreadWaker.Wake();
+#endif
 }
 
 #ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
 void AudioIO::UpdateScrub
    (double endTimeOrSpeed, const ScrubbingOptions &options)
 {
-   if (mScrubState)
+   if (mScrubState) {
       mScrubState->Update(endTimeOrSpeed, options);
+      // Make the new position heard without waiting out the poll interval
+      mAudioThreadWaker.Wake();
+   }
 }
 
 void AudioIO::StopScrub()
@@ -2574,10 +2852,14 @@ finished:
 
 AudioThread::ExitCode AudioThread::Entry()
 {
+   RealtimeScheduling::ThreadPromoter promoter{
+      RealtimeScheduling::AudioThread, 0.010 };
    AudioIO *gAudioIO;
    while( !TestDestroy() &&
       nullptr != ( gAudioIO = AudioIO::Get() ) )
    {
+      promoter.Update( gAudioIO->mProAudioMode );
+
       using Clock = std::chrono::steady_clock;
       auto loopPassStart = Clock::now();
       const auto interval = ScrubPollInterval_ms;
@@ -2591,38 +2873,80 @@ AudioThread::ExitCode AudioThread::Entry()
       }
       else if( gAudioIO->mAudioThreadFillBuffersLoopRunning )
       {
-         gAudioIO->FillBuffers();
+         // The capture thread does the rest
+         gAudioIO->FillPlaybackBuffers();
       }
       gAudioIO->mAudioThreadFillBuffersLoopActive = false;
 
-      if ( gAudioIO->mPlaybackSchedule.Interactive() )
+      if ( gAudioIO->mScrubShortQueue )
+         // Woken by each new mouse position
+         gAudioIO->mAudioThreadWaker.Wait(
+            std::chrono::milliseconds( interval ) );
+      else if ( gAudioIO->mPlaybackSchedule.Interactive() )
          std::this_thread::sleep_until(
             loopPassStart + std::chrono::milliseconds( interval ) );
       else
-         Sleep(10);
+         // The callback wakes this thread when it has consumed or produced
+         // enough; the timeout only bounds the cost of a missed wakeup
+         gAudioIO->mAudioThreadWaker.Wait( std::chrono::milliseconds( 10 ) );
    }
 
    return 0;
 }
 
 
+CaptureThread::ExitCode CaptureThread::Entry()
+{
+   RealtimeScheduling::ThreadPromoter promoter{
+      RealtimeScheduling::CaptureThread, 0.010 };
+   AudioIO *gAudioIO;
+   while( !TestDestroy() &&
+      nullptr != ( gAudioIO = AudioIO::Get() ) )
+   {
+      promoter.Update( gAudioIO->mProAudioMode );
+
+      // Set LoopActive outside the tests to avoid race condition
+      gAudioIO->mCaptureThreadLoopActive = true;
+      if( gAudioIO->mAudioThreadFillBuffersLoopRunning )
+      {
+         gAudioIO->DrainRecordBuffers();
+      }
+      gAudioIO->mCaptureThreadLoopActive = false;
+
+      gAudioIO->mCaptureThreadWaker.Wait( std::chrono::milliseconds( 10 ) );
+   }
+
+   return 0;
+}
+
 #ifdef EXPERIMENTAL_MIDI_OUT
 MidiThread::ExitCode MidiThread::Entry()
 {
+   RealtimeScheduling::ThreadPromoter promoter{
+      RealtimeScheduling::MidiThread, MIDI_SLEEP / 1000.0 };
    AudioIO *gAudioIO;
    while( !TestDestroy() &&
       nullptr != ( gAudioIO = AudioIO::Get() ) )
    {
+      promoter.Update( gAudioIO->mProAudioMode );
+
+      // While idle, StartPortMidiStream wakes this thread sooner
+      std::chrono::microseconds wait{ MIDI_MAX_WAIT * 1000 };
+
       // Set LoopActive outside the tests to avoid race condition
       gAudioIO->mMidiThreadFillBuffersLoopActive = true;
-      if( gAudioIO->mMidiThreadFillBuffersLoopRunning &&
-          // mNumFrames signals at least one callback, needed for MidiTime()
-          gAudioIO->mNumFrames > 0)
+      if( gAudioIO->mMidiThreadFillBuffersLoopRunning )
       {
-         gAudioIO->FillMidiBuffers();
+         // mNumFrames signals at least one callback, needed for MidiTime()
+         double due = 0;
+         if( gAudioIO->mNumFrames > 0 )
+            due = gAudioIO->FillMidiBuffers();
+         // Sleep until the next event falls due, not a fixed interval
+         wait = std::chrono::microseconds( std::max<long long>( 1000,
+            std::min<long long>( MIDI_MAX_WAIT * 1000, due * 1e6 ) ) );
       }
       gAudioIO->mMidiThreadFillBuffersLoopActive = false;
-      Sleep(MIDI_SLEEP);
+      gAudioIO->mMidiThreadWaker.Wait( wait );
    }
    return 0;
 }
@@ -2653,11 +2977,8 @@ size_t AudioIoCallback::GetCommonlyReadyPlayback()
 
 size_t AudioIO::GetCommonlyAvailCapture()
 {
-   auto commonlyAvail = mCaptureBuffers[0]->AvailForGet();
-   for (unsigned i = 1; i < mCaptureTracks.size(); ++i)
-      commonlyAvail = std::min(commonlyAvail,
-         mCaptureBuffers[i]->AvailForGet());
-   return commonlyAvail;
+   // In frames; the channels are always all there together
+   return mCaptureBuffer->AvailForGet() / mNumCaptureChannels;
 }
 
 // This method is the data gateway between the audio thread (which
@@ -2665,26 +2986,23 @@ size_t AudioIO::GetCommonlyAvailCapture()
 // (which communicates with the audio device).
 void AudioIO::FillBuffers()
 {
-   unsigned int i;
+   PROFILE_SCOPE("AudioIO::FillBuffers");
+   FillPlaybackBuffers();
+   DrainRecordBuffers();
+}
 
-   auto delayedHandler = [this] ( AudacityException * pException ) {
-      // In the main thread, stop recording
-      // This is one place where the application handles disk
-      // exhaustion exceptions from wave track operations, without rolling
-      // back to the last pushed undo state.  Instead, partial recording
-      // results are pushed as a NEW undo state.  For this reason, as
-      // commented elsewhere, we want an exception safety guarantee for
-      // the output wave tracks, after the failed append operation, that
-      // the tracks remain as they were after the previous successful
-      // (block-level) appends.
+void AudioIO::FillPlaybackBuffers()
+{
+   unsigned int i;
 
-      // Note that the Flush in StopStream() may throw another exception,
-      // but StopStream() contains that exception, and the logic in
-      // AudacityException::DelayedHandlerAction prevents redundant message
-      // boxes.
-      StopStream();
-      DefaultDelayedHandlerAction{}( pException );
-   };
+   // Record how long this takes, and how full the buffers were when it
+   // began, which is when they are emptiest
+   const auto fillStart = AudioIOMetrics::Clock::now();
+   const long long playbackReady = mPlaybackTracks.size() > 0
+      ? (long long)GetCommonlyReadyPlayback() : -1;
+   auto recordMetrics = finally( [&] {
+      mMetrics.RecordFillBuffers( fillStart, playbackReady, -1 );
+   } );
 
    if (mPlaybackTracks.size() > 0)
    {
@@ -2708,19 +3026,45 @@ void AudioIO::FillBuffers()
       // perhaps again later in play to avoid underfilling the queue and falling
       // behind the real-time demand on the consumer side in the callback.
       auto nReady = GetCommonlyReadyPlayback();
-      auto nNeeded =
-         mPlaybackQueueMinimum - std::min(mPlaybackQueueMinimum, nReady);
+      auto queueMinimum = mPlaybackQueueMinimum;
+
+      // Mouse scrubbing, unless seeking, only tops up a short queue, and only
+      // with a new mouse position, so that a movement is heard after that
+      // queue, not after the long one that seeking stutters need
+      mScrubShortQueue = false;
+      bool newScrubPosition = false;
+#ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
+      if (mScrubState &&
+          mPlaybackSchedule.mPlayMode == PlaybackSchedule::PLAY_SCRUB &&
+          !mScrubState->IsSeeking()) {
+         mScrubShortQueue = true;
+         queueMinimum = mScrubQueueMinimum;
+      }
+#endif
+
+      auto nNeeded = queueMinimum - std::min(queueMinimum, nReady);
+
+#ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
+      // An old position would only make silence; but if the queue ran dry,
+      // the mouse is not being polled
+      if (mScrubShortQueue && nNeeded > 0)
+         newScrubPosition = mScrubState->TakeUpdate() || nReady == 0;
+#endif
 
       // wxASSERT( nNeeded <= nAvailable );
 
       auto realTimeRemaining = mPlaybackSchedule.RealTimeRemaining();
-      if (nAvailable >= mPlaybackSamplesToCopy ||
-          (mPlaybackSchedule.PlayingStraight() &&
-           nAvailable / mRate >= realTimeRemaining))
+      if (mScrubShortQueue
+          ? (newScrubPosition && nAvailable > 0)
+          : (nAvailable >= mPlaybackSamplesToCopy ||
+             (mPlaybackSchedule.PlayingStraight() &&
+              nAvailable / mRate >= realTimeRemaining)))
       {
          // Limit maximum buffer size (increases performance)
-         auto available = std::min( nAvailable,
-            std::max( nNeeded, mPlaybackSamplesToCopy ) );
+         auto available = mScrubShortQueue
+            ? std::min( nAvailable, nNeeded )
+            : std::min( nAvailable,
+               std::max( nNeeded, mPlaybackSamplesToCopy ) );
 
          // msmeyer: When playing a very short selection in looped
          // mode, the selection must be copied to the buffer multiple
@@ -2874,19 +3218,54 @@ void AudioIO::FillBuffers()
          } while (!done);
       }
    }  // end of playback buffering
+}
+
+void AudioIO::DrainRecordBuffers()
+{
+   unsigned int i;
+
+   std::lock_guard< std::mutex > lock{ mCaptureDrainMutex };
+
+   // Record how long this takes, and how full the buffers were when it
+   // began, which is when they are fullest
+   const auto fillStart = AudioIOMetrics::Clock::now();
+   const long long captureAvail = mCaptureTracks.size() > 0
+      ? (long long)GetCommonlyAvailCapture() : -1;
+   auto recordMetrics = finally( [&] {
+      mMetrics.RecordFillBuffers( fillStart, -1, captureAvail );
+   } );
+
+   auto delayedHandler = [this] ( AudacityException * pException ) {
+      // In the main thread, stop recording
+      // This is one place where the application handles disk
+      // exhaustion exceptions from wave track operations, without rolling
+      // back to the last pushed undo state.  Instead, partial recording
+      // results are pushed as a NEW undo state.  For this reason, as
+      // commented elsewhere, we want an exception safety guarantee for
+      // the output wave tracks, after the failed append operation, that
+      // the tracks remain as they were after the previous successful
+      // (block-level) appends.
+
+      // Note that the Flush in StopStream() may throw another exception,
+      // but StopStream() contains that exception, and the logic in
+      // AudacityException::DelayedHandlerAction prevents redundant message
+      // boxes.
+      StopStream();
+      DefaultDelayedHandlerAction{}( pException );
+   };
 
    if (!mRecordingException &&
        mCaptureTracks.size() > 0)
       GuardedCall( [&] {
          // start record buffering
-         const auto avail = GetCommonlyAvailCapture(); // samples
-         const auto remainingTime =
-            std::max(0.0, mRecordingSchedule.ToConsume());
-         // This may be a very big double number:
-         const auto remainingSamples = remainingTime * mRate;
+         const auto avail = GetCommonlyAvailCapture(); // frames
          bool latencyCorrected = true;
 
          double deltat = avail / mRate;
+         // With half the ring full, the disk is needed for the capture more
+         // than for blocks written behind
+         SimpleBlockFile::SetWriteThrottled(
+            deltat > mCaptureRingBufferSecs / 2 );
 
          if (mAudioThreadShouldCallFillBuffersOnce ||
              deltat >= mMinCaptureSecsToCopy)
@@ -2895,143 +3274,181 @@ void AudioIO::FillBuffers()
             // The WaveTracks have their own buffering for efficiency.
             AutoSaveFile blockFileLog;
             auto numChannels = mCaptureTracks.size();
+            auto &scratch = *mCaptureScratch;
 
-            for( i = 0; i < numChannels; i++ )
-            {
-               sampleFormat trackFormat = mCaptureTracks[i]->GetSampleFormat();
-
-               AutoSaveFile appendLog;
-               size_t discarded = 0;
-
-               if (!mRecordingSchedule.mLatencyCorrected) {
-                  const auto correction = mRecordingSchedule.TotalCorrection();
-                  if (correction >= 0) {
-                     // Rightward shift
-                     // Once only (per track per recording), insert some initial
-                     // silence.
-                     size_t size = floor( correction * mRate * mFactor);
+            auto logAppend = [&]( unsigned channel, AutoSaveFile &appendLog ){
+               if (!appendLog.IsEmpty())
+               {
+                  blockFileLog.StartTag(wxT("recordingrecovery"));
+                  blockFileLog.WriteAttr(wxT("id"),
+                     mCaptureTracks[channel]->GetAutoSaveIdent());
+                  blockFileLog.WriteAttr(wxT("channel"), (int)channel);
+                  blockFileLog.WriteAttr(wxT("numchannels"), numChannels);
+                  blockFileLog.WriteSubTree(appendLog);
+                  blockFileLog.EndTag(wxT("recordingrecovery"));
+               }
+            };
+
+            // The latency correction is the same for all channels
+            size_t discarded = 0;
+            if (!mRecordingSchedule.mLatencyCorrected) {
+               const auto correction = mRecordingSchedule.TotalCorrection();
+               if (correction >= 0) {
+                  // Rightward shift
+                  // Once only (per track per recording), insert some initial
+                  // silence.
+                  size_t size = floor( correction * mRate * mFactor);
+                  for( i = 0; i < numChannels; i++ )
+                  {
+                     sampleFormat trackFormat =
+                        mCaptureTracks[i]->GetSampleFormat();
+                     AutoSaveFile appendLog;
                      SampleBuffer temp(size, trackFormat);
                      ClearSamples(temp.ptr(), trackFormat, 0, size);
                      mCaptureTracks[i]->Append(temp.ptr(), trackFormat,
                                                size, 1, &appendLog);
+                     logAppend(i, appendLog);
                   }
-                  else {
-                     // Leftward shift
-                     // discard some samples from the ring buffers.
-                     size_t size = floor(
-                        mRecordingSchedule.ToDiscard() * mRate );
-
-                     // The ring buffer might have grown concurrently -- don't discard more
-                     // than the "avail" value noted above.
-                     discarded = mCaptureBuffers[i]->Discard(std::min(avail, size));
-
-                     if (discarded < size)
-                        // We need to visit this again to complete the
-                        // discarding.
-                        latencyCorrected = false;
-                  }
                }
+               else {
+                  // Leftward shift
+                  // discard some frames from the ring buffer.
+                  size_t size = floor(
+                     mRecordingSchedule.ToDiscard() * mRate );
+
+                  // The ring buffer might have grown concurrently -- don't discard more
+                  // than the "avail" value noted above.
+                  discarded = mCaptureBuffer->Discard(
+                     std::min(avail, size) * mNumCaptureChannels )
+                        / mNumCaptureChannels;
+
+                  if (discarded < size)
+                     // We need to visit this again to complete the
+                     // discarding.
+                     latencyCorrected = false;
+               }
+            }
+            wxASSERT(discarded <= avail);
+            mRecordingSchedule.mPosition += discarded / mRate;
+
+            // Take the rest in chunks of no more than the scratch holds
+            size_t toGetTotal = avail - discarded;
+            while (toGetTotal > 0) {
+               const auto chunk = std::min(toGetTotal, scratch.frames);
+               toGetTotal -= chunk;
+
+               // Separate all the channels at once, straight from the ring
+               // buffer's storage
+               const auto spans = mCaptureBuffer->GetReadableSpans(
+                  chunk * mNumCaptureChannels );
+               size_t done = 0;
+               for (const auto &span : { spans.first, spans.second }) {
+                  const auto frames = span.second / mNumCaptureChannels;
+                  for( i = 0; i < numChannels; i++ )
+                     scratch.channelPtrs[i] = (samplePtr)
+                        scratch.channels[i].get() +
+                           done * SAMPLE_SIZE(mCaptureFormat);
+                  DeinterleaveSamples(span.first, mCaptureFormat,
+                     mNumCaptureChannels, scratch.channelPtrs.get(),
+                     numChannels, frames);
+                  done += frames;
+               }
+               mCaptureBuffer->Consume(done * mNumCaptureChannels);
+               // wxASSERT(done == chunk);
+               // but we can't assert in this thread
+
+               const auto remainingTime =
+                  std::max(0.0, mRecordingSchedule.ToConsume());
+               // This may be a very big double number:
+               const auto remainingSamples = remainingTime * mRate;
 
-               const float *pCrossfadeSrc = nullptr;
-               size_t crossfadeStart = 0, totalCrossfadeLength = 0;
-               if (i < mRecordingSchedule.mCrossfadeData.size())
+               for( i = 0; i < numChannels; i++ )
                {
-                  // Do crossfading
-                  // The supplied crossfade samples are at the same rate as the track
-                  const auto &data = mRecordingSchedule.mCrossfadeData[i];
-                  totalCrossfadeLength = data.size();
-                  if (totalCrossfadeLength) {
-                     crossfadeStart =
-                        floor(mRecordingSchedule.Consumed() * mCaptureTracks[i]->GetRate());
-                     if (crossfadeStart < totalCrossfadeLength)
-                        pCrossfadeSrc = data.data() + crossfadeStart;
+                  AutoSaveFile appendLog;
+
+                  const float *pCrossfadeSrc = nullptr;
+                  size_t crossfadeStart = 0, totalCrossfadeLength = 0;
+                  if (i < mRecordingSchedule.mCrossfadeData.size())
+                  {
+                     // Do crossfading
+                     // The supplied crossfade samples are at the same rate as the track
+                     const auto &data = mRecordingSchedule.mCrossfadeData[i];
+                     totalCrossfadeLength = data.size();
+                     if (totalCrossfadeLength) {
+                        crossfadeStart =
+                           floor(mRecordingSchedule.Consumed() * mCaptureTracks[i]->GetRate());
+                        if (crossfadeStart < totalCrossfadeLength)
+                           pCrossfadeSrc = data.data() + crossfadeStart;
+                     }
                   }
-               }
 
-               wxASSERT(discarded <= avail);
-               size_t toGet = avail - discarded;
-               SampleBuffer temp;
-               size_t size;
-               sampleFormat format;
-               if( mFactor == 1.0 )
-               {
-                  // Take captured samples directly
-                  size = toGet;
-                  if (pCrossfadeSrc)
-                     // Change to float for crossfade calculation
+                  size_t toGet = chunk;
+                  samplePtr ptr = (samplePtr)scratch.channels[i].get();
+                  size_t size;
+                  sampleFormat format = mCaptureFormat;
+                  if (format != floatSample &&
+                      (pCrossfadeSrc || mFactor != 1.0)) {
+                     // Change to float for crossfade or resampling
+                     // calculation
+                     CopySamples(ptr, format,
+                        (samplePtr)scratch.floats.get(), floatSample, toGet);
+                     ptr = (samplePtr)scratch.floats.get();
                      format = floatSample;
+                  }
+                  if( mFactor == 1.0 )
+                  {
+                     // Take captured samples directly
+                     size = toGet;
+                     if (double(size) > remainingSamples)
+                        size = floor(remainingSamples);
+                  }
                   else
-                     format = trackFormat;
-                  temp.Allocate(size, format);
-                  const auto got =
-                     mCaptureBuffers[i]->Get(temp.ptr(), format, toGet);
-                  // wxASSERT(got == toGet);
-                  // but we can't assert in this thread
-                  wxUnusedVar(got);
-                  if (double(size) > remainingSamples)
-                     size = floor(remainingSamples);
-               }
-               else
-               {
-                  size = lrint(toGet * mFactor);
-                  format = floatSample;
-                  SampleBuffer temp1(toGet, floatSample);
-                  temp.Allocate(size, format);
-                  const auto got =
-                     mCaptureBuffers[i]->Get(temp1.ptr(), floatSample, toGet);
-                  // wxASSERT(got == toGet);
-                  // but we can't assert in this thread
-                  wxUnusedVar(got);
-                  /* we are re-sampling on the fly. The last resampling call
-                   * must flush any samples left in the rate conversion buffer
-                   * so that they get recorded
-                   */
-                  if (toGet > 0 ) {
+                  {
+                     size = lrint(toGet * mFactor);
+                     /* we are re-sampling on the fly. The last resampling call
+                      * must flush any samples left in the rate conversion buffer
+                      * so that they get recorded
+                      */
                      if (double(toGet) > remainingSamples)
                         toGet = floor(remainingSamples);
                      const auto results =
-                     mResample[i]->Process(mFactor, (float *)temp1.ptr(), toGet,
-                                           !IsStreamActive(), (float *)temp.ptr(), size);
+                     mResample[i]->Process(mFactor, (float *)ptr, toGet,
+                                           !IsStreamActive() && toGetTotal == 0,
+                                           scratch.resampled.get(), size);
                      size = results.second;
+                     ptr = (samplePtr)scratch.resampled.get();
                   }
-               }
 
-               if (pCrossfadeSrc) {
-                  wxASSERT(format == floatSample);
-                  size_t crossfadeLength = std::min(size, totalCrossfadeLength - crossfadeStart);
-                  if (crossfadeLength) {
-                     auto ratio = double(crossfadeStart) / totalCrossfadeLength;
-                     auto ratioStep = 1.0 / totalCrossfadeLength;
-                     auto pCrossfadeDst = (float*)temp.ptr();
-
-                     // Crossfade loop here
-                     for (size_t ii = 0; ii < crossfadeLength; ++ii) {
-                        *pCrossfadeDst = ratio * *pCrossfadeDst + (1.0 - ratio) * *pCrossfadeSrc;
-                        ++pCrossfadeSrc, ++pCrossfadeDst;
-                        ratio += ratioStep;
+                  if (pCrossfadeSrc) {
+                     wxASSERT(format == floatSample);
+                     size_t crossfadeLength = std::min(size, totalCrossfadeLength - crossfadeStart);
+                     if (crossfadeLength) {
+                        auto ratio = double(crossfadeStart) / totalCrossfadeLength;
+                        auto ratioStep = 1.0 / totalCrossfadeLength;
+                        auto pCrossfadeDst = (float*)ptr;
+
+                        // Crossfade loop here
+                        for (size_t ii = 0; ii < crossfadeLength; ++ii) {
+                           *pCrossfadeDst = ratio * *pCrossfadeDst + (1.0 - ratio) * *pCrossfadeSrc;
+                           ++pCrossfadeSrc, ++pCrossfadeDst;
+                           ratio += ratioStep;
+                        }
                      }
                   }
-               }
 
-               // Now append
-               // see comment in second handler about guarantee
-               mCaptureTracks[i]->Append(temp.ptr(), format,
-                  size, 1,
-                  &appendLog);
+                  // Now append
+                  // see comment in second handler about guarantee
+                  mCaptureTracks[i]->Append(ptr, format,
+                     size, 1,
+                     &appendLog);
 
-               if (!appendLog.IsEmpty())
-               {
-                  blockFileLog.StartTag(wxT("recordingrecovery"));
-                  blockFileLog.WriteAttr(wxT("id"), mCaptureTracks[i]->GetAutoSaveIdent());
-                  blockFileLog.WriteAttr(wxT("channel"), (int)i);
-                  blockFileLog.WriteAttr(wxT("numchannels"), numChannels);
-                  blockFileLog.WriteSubTree(appendLog);
-                  blockFileLog.EndTag(wxT("recordingrecovery"));
-               }
-            } // end loop over capture channels
+                  logAppend(i, appendLog);
+               } // end loop over capture channels
+
+               // Now update the recording shedule position
+               mRecordingSchedule.mPosition += chunk / mRate;
+            }
 
-            // Now update the recording shedule position
-            mRecordingSchedule.mPosition += avail / mRate;
             mRecordingSchedule.mLatencyCorrected = latencyCorrected;
 
             auto pListener = GetListener();
@@ -3267,15 +3684,16 @@ bool AudioIO::SetHasSolo(bool hasSolo)
 }
 
 
-void AudioIO::FillMidiBuffers()
+double AudioIO::FillMidiBuffers()
 {
    // Keep track of time paused. If not paused, fill buffers.
+   // SetPaused wakes the MIDI thread when pause ends
    if (IsPaused()) {
       if (!mMidiPaused) {
          mMidiPaused = true;
          AllNotesOff(); // to avoid hanging notes during pause
       }
-      return;
+      return MIDI_MAX_WAIT * 0.001;
    }
 
    if (mMidiPaused) {
@@ -3344,6 +3762,13 @@ void AudioIO::FillMidiBuffers()
       (mPlaybackSchedule.PlayingStraight() && // PRL:  what if scrubbing?
        timeAtSpeed >= mPlaybackSchedule.mT1 + loopDelay);
    // !mNextEvent);
+
+   // The next event is output when the compute-ahead time reaches it.
+   // With no more events, the caller should come back to test for the
+   // end, which the maximum wait does well enough
+   if (mNextEvent)
+      return UncorrectedMidiEventTime() - time;
+   return MIDI_MAX_WAIT * 0.001;
 }
 
 double AudioIO::PauseTime()
@@ -3736,22 +4161,57 @@ void AudioIoCallback::ComputeMidiTimings(
 //   to run in the main GUI thread after the next event loop iteration.
 //   That's important, because Pause() updates GUI, such as status bar,
 //   and that should NOT happen in this audio non-gui thread.
-void AudioIoCallback::CheckSoundActivatedRecordingLevel( const void *inputBuffer )
+//
+//   The level is measured on the input buffer itself, so that the decision
+//   is made in the callback that captures the sound, whatever the meter.
+void AudioIoCallback::CheckSoundActivatedRecordingLevel(
+   float *tempFloats,
+   const void *inputBuffer,
+   unsigned long framesPerBuffer
+   )
 {
    if( !inputBuffer)
       return;
    // Quick returns if next to nothing to do.
    if( !mPauseRec )
       return;
-   if( !mInputMeter )
-      return;
-   
-   bool bShouldBePaused = mInputMeter->GetMaxPeak() < mSilenceLevel;
-   if( bShouldBePaused != IsPaused())
+
+   const auto numSamples = framesPerBuffer * mNumCaptureChannels;
+   const float *inputFloats = (const float *)inputBuffer;
+   if (mCaptureFormat != floatSample) {
+      CopySamples((samplePtr)inputBuffer, mCaptureFormat,
+                  (samplePtr)tempFloats, floatSample, numSamples);
+      inputFloats = tempFloats;
+   }
+
+   if (PeakOfSamples(inputFloats, numSamples) >= mSilenceLevel) {
+      mFramesAboveSilence += framesPerBuffer;
+      mFramesBelowSilence = 0;
+   }
+   else {
+      mFramesBelowSilence += framesPerBuffer;
+      mFramesAboveSilence = 0;
+   }
+
+   const bool paused = IsPaused();
+   bool bShouldBePaused = paused;
+   if (paused)
+      bShouldBePaused = !(mFramesAboveSilence > 0 &&
+         mFramesAboveSilence >= mSoundActivationAttack * mRate);
+   else
+      bShouldBePaused = mFramesBelowSilence > mSoundActivationHold * mRate;
+
+   // Request each change once, not again at each callback until the main
+   // thread toggles the pause
+   if (bShouldBePaused == paused)
+      mSoundActivationPending = false;
+   else if (!mSoundActivationPending)
    {
       auto pListener = GetListener();
-      if ( pListener )
+      if ( pListener ) {
          pListener->OnSoundActivationThreshold();
+         mSoundActivationPending = true;
+      }
    }
 }
 
@@ -3765,7 +4225,8 @@ void AudioIoCallback::AddToOutputChannel( unsigned int chan,
    float * tempBuf,
    bool drop,
    unsigned long len,
-   WaveTrack *vt
+   WaveTrack *vt,
+   PlaybackLevels *levels
    )
 {
    const auto numPlaybackChannels = mNumPlaybackChannels;
@@ -3774,6 +4235,11 @@ void AudioIoCallback::AddToOutputChannel( unsigned int chan,
    if (drop || !mAudioThreadFillBuffersLoopRunning || mPaused)
       gain = 0.0;
 
+   // The levels for the mixer board, after gain and pan, but before the
+   // output volume
+   if (levels)
+      levels->Add( chan, tempBuf, len, gain );
+
    // Output volume emulation: possibly copy meter samples, then
    // apply volume, then copy to the output buffer
    if (outputMeterFloats != outputFloats)
@@ -3843,13 +4309,19 @@ bool AudioIoCallback::FillOutputBuffers(
    }
 
    // ------ MEMORY ALLOCATION ----------------------
-   // These are small structures.
-   WaveTrack **chans = (WaveTrack **) alloca(numPlaybackChannels * sizeof(WaveTrack *));
-   float **tempBufs = (float **) alloca(numPlaybackChannels * sizeof(float *));
-
-   // And these are larger structures....
-   for (unsigned int c = 0; c < numPlaybackChannels; c++)
-      tempBufs[c] = (float *) alloca(framesPerBuffer * sizeof(float));
+   // All was done in AllocateCallbackScratch, unless this buffer is larger
+   // than expected
+   auto &scratch = *mCallbackScratch;
+   WaveTrack **chans = scratch.chans.get();
+   size_t *chanTracks = scratch.chanTracks.get();
+   float **tempBufs = scratch.tempBufs.get();
+   float **scratchBufs = scratch.scratchPtrs.get();
+   RingBuffer **toConsume = scratch.toConsume.get();
+   if (framesPerBuffer > scratch.frames) {
+      scratchBufs = (float **) alloca(numPlaybackChannels * sizeof(float *));
+      for (unsigned int c = 0; c < numPlaybackChannels; c++)
+         scratchBufs[c] = (float *) alloca(framesPerBuffer * sizeof(float));
+   }
    // ------ End of MEMORY ALLOCATION ---------------
 
    auto & em = RealtimeEffectManager::Get();
@@ -3876,12 +4348,64 @@ bool AudioIoCallback::FillOutputBuffers(
    // I would expect us not to need the fast paths, since linearly interpolated gain
    // is very cheap to process.
 
+   // Release ring buffer space that was mixed in place
+   auto consumeInPlace = [&]{
+      for (int c = 0; c < chanCnt; c++)
+         if (toConsume[c])
+            toConsume[c]->Consume(framesPerBuffer), toConsume[c] = nullptr;
+   };
+
+   // Note that there are two kinds of channel count.
+   // c and nChans are counting channels in the Tracks.
+   // chan (and numPlayBackChannels) is counting output channels on the device.
+   // chan = 0 is left channel
+   // chan = 1 is right channel.
+   //
+   // Each channel in the tracks can output to more than one channel on the device.
+   // For example mono channels output to both left and right output channels.
+   auto mixGroup = [&]( WaveTrack *const *tracks, const size_t *indices,
+      float *const *bufs,
+      int nChans, bool groupDrop, decltype(framesPerBuffer) groupLen ){
+      if (groupLen > 0) for (int c = 0; c < nChans; c++)
+      {
+         const auto vt = tracks[c];
+         const auto levels =
+            mPlaybackLevels ? &mPlaybackLevels[indices[c]] : nullptr;
+
+         if (vt->GetChannelIgnoringPan() == Track::LeftChannel ||
+               vt->GetChannelIgnoringPan() == Track::MonoChannel )
+            AddToOutputChannel( 0, outputMeterFloats, outputFloats, tempFloats, bufs[c], groupDrop, groupLen, vt, levels);
+
+         if (vt->GetChannelIgnoringPan() == Track::RightChannel ||
+               vt->GetChannelIgnoringPan() == Track::MonoChannel  )
+            AddToOutputChannel( 1, outputMeterFloats, outputFloats, tempFloats, bufs[c], groupDrop, groupLen, vt, levels);
+
+         if (levels)
+            levels->AddFrames( groupLen );
+      }
+   };
+
+   // Groups mixed in place in the ring buffers may have their realtime
+   // effects applied all at once after the loop, sharing the work with the
+   // threads of the effect manager; these remember them until then
+   const bool deferEffects = em.RealtimeHasWorkers();
+   using Job = RealtimeEffectManager::Job;
+   Job *jobs = scratch.jobs.get();
+   bool *jobDrops = scratch.jobDrops.get();
+   WaveTrack **jobTracks = scratch.jobTracks.get();
+   size_t *jobTrackIndices = scratch.jobTrackIndices.get();
+   float **jobBufs = scratch.jobBufs.get();
+   RingBuffer **jobConsume = scratch.jobConsume.get();
+   size_t nJobs = 0;
+   unsigned nJobChans = 0;
+
    bool drop = false;        // Track should become silent.
    bool dropQuickly = false; // Track has already been faded to silence.
    for (unsigned t = 0; t < numPlaybackTracks; t++)
    {
       WaveTrack *vt = mPlaybackTracks[t].get();
       chans[chanCnt] = vt;
+      chanTracks[chanCnt] = t;
 
       // TODO: more-than-two-channels
       auto nextTrack =
@@ -3896,6 +4420,8 @@ bool AudioIoCallback::FillOutputBuffers(
 
       if ( firstChannel )
       {
+         for (unsigned int c = 0; c < numPlaybackChannels; c++)
+            tempBufs[c] = scratchBufs[c], toConsume[c] = nullptr;
          selected = vt->GetSelected();
          // IF mono THEN clear 'the other' channel.
          if ( lastChannel && (numPlaybackChannels>1)) {
@@ -3917,6 +4443,18 @@ bool AudioIoCallback::FillOutputBuffers(
          // keep going here.  
          // we may still need to issue a paComplete.
       }
+      else if ( toGet == framesPerBuffer &&
+         mPlaybackBuffers[t]->GetReadableSpans(toGet).second.second == 0 )
+      {
+         // The samples are contiguous in the ring buffer:  mix (and apply
+         // realtime effects) in place there, and consume them after.
+         // The writer will not touch that space until then.
+         const auto span = mPlaybackBuffers[t]->GetReadableSpans(toGet).first;
+         tempBufs[chanCnt] = (float *)span.first;
+         toConsume[chanCnt] = mPlaybackBuffers[t].get();
+         len = span.second;
+         chanCnt++;
+      }
       else
       {
          len = mPlaybackBuffers[t]->Get((samplePtr)tempBufs[chanCnt],
@@ -3950,40 +4488,58 @@ bool AudioIoCallback::FillOutputBuffers(
       // Last channel of a track seen now
       len = mMaxFramesOutput;
 
+      if ( deferEffects && !dropQuickly && selected &&
+         std::all_of( toConsume, toConsume + chanCnt,
+            [](RingBuffer *pBuffer){ return pBuffer != nullptr; } ) )
+      {
+         // The samples stay put in the ring buffers until consumed, so
+         // nothing else of this pass needs them
+         jobs[nJobs] = { group, unsigned(chanCnt), jobBufs + nJobChans, len };
+         jobDrops[nJobs] = drop;
+         for (int c = 0; c < chanCnt; c++, nJobChans++) {
+            jobTracks[nJobChans] = chans[c];
+            jobTrackIndices[nJobChans] = chanTracks[c];
+            jobBufs[nJobChans] = tempBufs[c];
+            jobConsume[nJobChans] = toConsume[c];
+            toConsume[c] = nullptr;
+         }
+         nJobs++;
+         group++;
+         CallbackCheckCompletion(mCallbackReturn, len);
+         chanCnt = 0;
+         continue;
+      }
+
       if( !dropQuickly && selected )
          len = em.RealtimeProcess(group, chanCnt, tempBufs, len);
       group++;
 
       CallbackCheckCompletion(mCallbackReturn, len);
-      if (dropQuickly) // no samples to process, they've been discarded
+      if (dropQuickly) { // no samples to process, they've been discarded
+         consumeInPlace();
          continue;
+      }
 
       // Our channels aren't silent.  We need to pass their data on.
-      //
-      // Note that there are two kinds of channel count.
-      // c and chanCnt are counting channels in the Tracks.
-      // chan (and numPlayBackChannels) is counting output channels on the device.
-      // chan = 0 is left channel
-      // chan = 1 is right channel.
-      //
-      // Each channel in the tracks can output to more than one channel on the device.
-      // For example mono channels output to both left and right output channels.
-      if (len > 0) for (int c = 0; c < chanCnt; c++)
-      {
-         vt = chans[c];
+      mixGroup( chans, chanTracks, tempBufs, chanCnt, drop, len );
 
-         if (vt->GetChannelIgnoringPan() == Track::LeftChannel ||
-               vt->GetChannelIgnoringPan() == Track::MonoChannel )
-            AddToOutputChannel( 0, outputMeterFloats, outputFloats, tempFloats, tempBufs[c], drop, len, vt);
-
-         if (vt->GetChannelIgnoringPan() == Track::RightChannel ||
-               vt->GetChannelIgnoringPan() == Track::MonoChannel  )
-            AddToOutputChannel( 1, outputMeterFloats, outputFloats, tempFloats, tempBufs[c], drop, len, vt);
-      }
+      consumeInPlace();
 
       chanCnt = 0;
    }
 
+   // Now the deferred groups, each effect taking one group at a time but
+   // different effects and groups going on at once, then mixed in the
+   // order of the tracks
+   em.RealtimeProcessJobs(jobs, nJobs);
+   for (size_t j = 0; j < nJobs; j++) {
+      const auto offset = jobs[j].buffers - jobBufs;
+      mixGroup( jobTracks + offset, jobTrackIndices + offset, jobBufs + offset,
+         jobs[j].chans, jobDrops[j], jobs[j].numSamples );
+      for (unsigned c = 0; c < jobs[j].chans; c++)
+         jobConsume[offset + c]->Consume(framesPerBuffer);
+   }
+
    // Poke: If there are no playback tracks, then the earlier check
    // about the time indicator being past the end won't happen;
    // do it here instead (but not if looping or scrubbing)
@@ -4023,8 +4579,7 @@ void AudioIoCallback::UpdateTimePosition(unsigned long framesPerBuffer)
 void AudioIoCallback::FillInputBuffers(
    const void *inputBuffer, 
    unsigned long framesPerBuffer,
-   const PaStreamCallbackFlags statusFlags,
-   float * tempFloats
+   const PaStreamCallbackFlags statusFlags
 )
 {
    const auto numPlaybackTracks = mPlaybackTracks.size();
@@ -4055,9 +4610,8 @@ void AudioIoCallback::FillInputBuffers(
    // So we have not decided to enable this extra detection yet in
    // production
 
-   size_t len = framesPerBuffer;
-   for(unsigned t = 0; t < numCaptureChannels; t++)
-      len = std::min( len, mCaptureBuffers[t]->AvailForPut() );
+   size_t len = std::min<size_t>( framesPerBuffer,
+      mCaptureBuffer->AvailForPut() / numCaptureChannels );
 
    if (mSimulateRecordingErrors && 100LL * rand() < RAND_MAX)
       // Make spurious errors for purposes of testing the error
@@ -4066,7 +4620,7 @@ void AudioIoCallback::FillInputBuffers(
 
    // A different symptom is that len < framesPerBuffer because
    // the other thread, executing FillBuffers, isn't consuming fast
-   // enough from mCaptureBuffers; maybe it's CPU-bound, or maybe the
+   // enough from mCaptureBuffer; maybe it's CPU-bound, or maybe the
    // storage device it writes is too slow
    if (mDetectDropouts &&
          ((mDetectUpstreamDropouts && inputError) ||
@@ -4089,52 +4643,13 @@ void AudioIoCallback::FillInputBuffers(
    if (len <= 0) 
       return;
 
-   // We have an ASSERT in the AudioIO constructor to alert us to 
-   // possible issues with the (short*) cast.  We'd have a problem if
-   // sizeof(short) > sizeof(float) since our buffers are sized for floats.
-   for(unsigned t = 0; t < numCaptureChannels; t++) {
-
-      // dmazzoni:
-      // Un-interleave.  Ugly special-case code required because the
-      // capture channels could be in three different sample formats;
-      // it'd be nice to be able to call CopySamples, but it can't
-      // handle multiplying by the gain and then clipping.  Bummer.
-
-      switch(mCaptureFormat) {
-         case floatSample: {
-            float *inputFloats = (float *)inputBuffer;
-            for(unsigned i = 0; i < len; i++)
-               tempFloats[i] =
-                  inputFloats[numCaptureChannels*i+t];
-         } break;
-         case int24Sample:
-            // We should never get here. Audacity's int24Sample format
-            // is different from PortAudio's sample format and so we
-            // make PortAudio return float samples when recording in
-            // 24-bit samples.
-            wxASSERT(false);
-            break;
-         case int16Sample: {
-            short *inputShorts = (short *)inputBuffer;
-            short *tempShorts = (short *)tempFloats;
-            for( unsigned i = 0; i < len; i++) {
-               float tmp = inputShorts[numCaptureChannels*i+t];
-               tmp = wxClip( -32768, tmp, 32767 );
-               tempShorts[i] = (short)(tmp);
-            }
-         } break;
-      } // switch
-
-      // JKC: mCaptureFormat must be for samples with sizeof(float) or
-      // fewer bytes (because tempFloats is sized for floats).  All 
-      // formats are 2 or 4 bytes, so we are OK.
-      const auto put =
-         mCaptureBuffers[t]->Put(
-            (samplePtr)tempFloats, mCaptureFormat, len);
-      // wxASSERT(put == len);
-      // but we can't assert in this thread
-      wxUnusedVar(put);
-   }
+   // Whole frames, interleaved as they came, in one copy; no gain or
+   // conversion applies, and DrainRecordBuffers separates the channels
+   const auto put = mCaptureBuffer->Put(
+      (samplePtr)inputBuffer, mCaptureFormat, len * numCaptureChannels);
+   // wxASSERT(put == len * numCaptureChannels);
+   // but we can't assert in this thread
+   wxUnusedVar(put);
 }
 
 
@@ -4369,6 +4884,15 @@ int AudioIoCallback::AudioCallback(const void *inputBuffer, void *outputBuffer,
                           const PaStreamCallbackTimeInfo *timeInfo,
                           const PaStreamCallbackFlags statusFlags, void * WXUNUSED(userData) )
 {
+   // Nothing in here may allocate or lock; debug builds can check
+   RealtimeSafety::Scope realtimeSafety;
+
+   // Time every pass, whichever way it returns
+   const auto callbackStart = AudioIOMetrics::Clock::now();
+   auto recordMetrics = finally( [&] {
+      mMetrics.RecordCallback( callbackStart, framesPerBuffer, statusFlags );
+   } );
+
    mbHasSoloTracks = CountSoloingTracks() > 0 ;
    mCallbackReturn = paContinue;
 
@@ -4391,9 +4915,15 @@ int AudioIoCallback::AudioCallback(const void *inputBuffer, void *outputBuffer,
    // ------ MEMORY ALLOCATIONS -----------------------------------------------
    // tempFloats will be a resusable scratch pad for (possibly format converted)
    // audio data.  One temporary use is for the InputMeter data.
+   // These were allocated when the stream opened, unless this buffer is
+   // larger than expected.
    const auto numPlaybackChannels = mNumPlaybackChannels;
    const auto numCaptureChannels = mNumCaptureChannels;
-   float *tempFloats = (float *)alloca(framesPerBuffer*sizeof(float)*
+   const auto &scratch = *mCallbackScratch;
+   const bool preallocated = framesPerBuffer <= scratch.frames;
+   float *tempFloats = preallocated
+      ? scratch.tempFloats.get()
+      : (float *)alloca(framesPerBuffer*sizeof(float)*
                              MAX(numCaptureChannels,numPlaybackChannels));
 
    bool bVolEmulationActive = 
@@ -4401,9 +4931,11 @@ int AudioIoCallback::AudioCallback(const void *inputBuffer, void *outputBuffer,
    // outputMeterFloats is the scratch pad for the output meter.  
    // we can often reuse the existing outputBuffer and save on allocating 
    // something new.
-   float *outputMeterFloats = bVolEmulationActive ?
-         (float *)alloca(framesPerBuffer*numPlaybackChannels * sizeof(float)) :
-         (float *)outputBuffer;
+   float *outputMeterFloats = !bVolEmulationActive
+      ? (float *)outputBuffer
+      : preallocated
+         ? scratch.outputMeterFloats.get()
+         : (float *)alloca(framesPerBuffer*numPlaybackChannels * sizeof(float));
    // ----- END of MEMORY ALLOCATIONS ------------------------------------------
 
 
@@ -4413,14 +4945,12 @@ int AudioIoCallback::AudioCallback(const void *inputBuffer, void *outputBuffer,
       framesPerBuffer); 
 
    // This function may queue up a pause or resume.
-   // TODO this is a bit dodgy as it toggles the Pause, and
-   // relies on an idle event to have handled that, so could 
-   // queue up multiple toggle requests and so do nothing.
-   // Eventually it will sort itself out by random luck, but
-   // the net effect is a delay in starting/stopping sound activated 
-   // recording.
+   // It toggles the Pause, relying on an idle event to handle that, but
+   // does not queue another toggle before the first is done.
    CheckSoundActivatedRecordingLevel(
-      inputBuffer);
+      tempFloats,
+      inputBuffer,
+      framesPerBuffer);
   
    // Even when paused, we do playthrough.
    // Initialise output buffer to zero or to playthrough data.
@@ -4445,22 +4975,139 @@ int AudioIoCallback::AudioCallback(const void *inputBuffer, void *outputBuffer,
       return mCallbackReturn;
 
    // To move the cursor onwards.  (uses mMaxFramesOutput)
+   const auto startTime = mPlaybackSchedule.GetTrackTime();
    UpdateTimePosition(framesPerBuffer);
+   if (outputBuffer && timeInfo && timeInfo->outputBufferDacTime > 0)
+      mPositionStamp.Write( startTime, mPlaybackSchedule.GetTrackTime(),
+         timeInfo->outputBufferDacTime, framesPerBuffer / mRate );
 
    // To capture input into track (sound from microphone)
    FillInputBuffers(
       inputBuffer, 
       framesPerBuffer,
-      statusFlags,
-      tempFloats);
+      statusFlags);
 
    SendVuOutputMeterData( outputMeterFloats, framesPerBuffer);
 
+   mAudioThreadWaker.CountFrames( framesPerBuffer );
+   mCaptureThreadWaker.CountFrames( framesPerBuffer );
+
    return mCallbackReturn;
 }
 
+void AudioIoCallback::WakeAudioThread()
+{
+   mAudioThreadWaker.Wake();
+}
+
+PlaybackLevels::PlaybackLevels()
+{
+   for (unsigned c = 0; c < 2; ++c) {
+      mPeak[c].store( 0 );
+      mSquares[c].store( 0 );
+      mClipped[c].store( 0 );
+      mTakenSquares[c] = 0;
+      mTakenClipped[c] = 0;
+   }
+   mFrames.store( 0 );
+   mTakenFrames = 0;
+}
+
+void PlaybackLevels::Add(
+   unsigned chan, const float *samples, size_t len, float gain )
+{
+   if (chan >= 2)
+      return;
+
+   float peak = 0;
+   double squares = 0;
+   size_t clipped = 0;
+   for (size_t i = 0; i < len; ++i) {
+      const float value = fabsf( gain * samples[i] );
+      peak = std::max( peak, value );
+      squares += value * value;
+      if (value >= MAX_AUDIO)
+         ++clipped;
+   }
+
+   // Only this thread changes the totals
+   mSquares[chan].store(
+      mSquares[chan].load( std::memory_order_relaxed ) + squares,
+      std::memory_order_relaxed );
+   mClipped[chan].store(
+      mClipped[chan].load( std::memory_order_relaxed ) + clipped,
+      std::memory_order_relaxed );
+   // But the reader resets the peak
+   auto old = mPeak[chan].load( std::memory_order_relaxed );
+   while ( peak > old &&
+      !mPeak[chan].compare_exchange_weak( old, peak,
+         std::memory_order_relaxed ) )
+      ;
+}
+
+void PlaybackLevels::AddFrames( size_t frames )
+{
+   // Publishes the totals added before
+   mFrames.store( mFrames.load( std::memory_order_relaxed ) + frames,
+      std::memory_order_release );
+}
+
+auto PlaybackLevels::Take() -> Levels
+{
+   Levels result;
+   const auto frames = mFrames.load( std::memory_order_acquire );
+   result.frames = frames - mTakenFrames;
+   mTakenFrames = frames;
+   for (unsigned c = 0; c < 2; ++c) {
+      result.peak[c] = mPeak[c].exchange( 0, std::memory_order_relaxed );
+
+      const auto squares = mSquares[c].load( std::memory_order_relaxed );
+      result.rms[c] = result.frames > 0
+         ? sqrt( std::max( 0.0, squares - mTakenSquares[c] ) / result.frames )
+         : 0;
+      mTakenSquares[c] = squares;
+
+      const auto clipped = mClipped[c].load( std::memory_order_relaxed );
+      result.clipped[c] = clipped - mTakenClipped[c];
+      mTakenClipped[c] = clipped;
+   }
+   return result;
+}
+
+void AudioThreadWaker::Reset( size_t threshold )
+{
+   mThreshold = threshold;
+   mFrames.store( 0 );
+}
+
+void AudioThreadWaker::CountFrames( size_t frames )
+{
+   if ( mFrames.fetch_add( frames ) + frames >= mThreshold ) {
+      mFrames.store( 0 );
+      Wake();
+   }
+}
+
+void AudioThreadWaker::Wake()
+{
+   // The callback must not take the mutex.  A wakeup lost between the
+   // waiter's test and its wait costs no more than the timeout.
+   mPending.store( true );
+   mCondition.notify_one();
+}
+
+void AudioThreadWaker::Wait( std::chrono::microseconds timeout )
+{
+   std::unique_lock< std::mutex > lock{ mMutex };
+   mCondition.wait_for( lock, timeout, [this]{
+      return mPending.exchange( false ); } );
+}
+
 PaStreamCallbackResult AudioIoCallback::CallbackDoSeek()
 {
+   // Seeking waits for the audio thread; the callback is late anyway
+   RealtimeSafety::Exemption exemption;
+
    const int token = mStreamToken;
    wxMutexLocker locker(mSuspendAudioThread);
    if (token != mStreamToken)
@@ -4500,6 +5147,7 @@ PaStreamCallbackResult AudioIoCallback::CallbackDoSeek()
 
    // Reload the ring buffers
    mAudioThreadShouldCallFillBuffersOnce = true;
+   WakeAudioThread();
    while( mAudioThreadShouldCallFillBuffersOnce )
    {
       wxMilliSleep( 50 );
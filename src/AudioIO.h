@@ -19,7 +19,12 @@
 
 #include "Experimental.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <wx/atomic.h> // member variable
 
@@ -52,6 +57,7 @@ class RingBuffer;
 class Mixer;
 class Resample;
 class AudioThread;
+class CaptureThread;
 class SelectedRegion;
 
 class AudacityProject;
@@ -228,6 +234,69 @@ void MessageBuffer<Data>::Write( Data &&data )
    mSlots[idx].mBusy.store( false, std::memory_order_release );
 }
 
+/// Lets the PortAudio callback wake a thread that waits for work, without
+/// taking a lock
+class AudioThreadWaker
+{
+public:
+   /// Frames through the callback that are worth waking for; call before
+   /// the stream starts
+   void Reset(size_t threshold);
+   /// Called by the callback
+   void CountFrames(size_t frames);
+   void Wake();
+   /// Sleep until woken, or at most for timeout, in case a wakeup came just
+   /// before the wait
+   void Wait(std::chrono::microseconds timeout);
+
+private:
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::atomic<bool> mPending{ false };
+   std::atomic<size_t> mFrames{ 0 };
+   size_t mThreshold{ std::numeric_limits<size_t>::max() };
+};
+
+/// Post-fader levels of one playback track at the two output channels,
+/// which the callback accumulates and the main thread takes, without a lock
+class PlaybackLevels
+{
+public:
+   /// What was played since the last Take()
+   struct Levels
+   {
+      size_t frames;
+      float peak[2];
+      float rms[2];
+      unsigned clipped[2];
+   };
+
+   PlaybackLevels();
+   PlaybackLevels( const PlaybackLevels& ) PROHIBITED;
+   PlaybackLevels &operator=( const PlaybackLevels& ) PROHIBITED;
+
+   /// Called by the callback, the only writer, for each output channel the
+   /// track feeds
+   void Add(unsigned chan, const float *samples, size_t len, float gain);
+   /// Called by the callback once for each buffer of the track
+   void AddFrames(size_t frames);
+
+   /// Called by one reader only
+   Levels Take();
+
+private:
+   // Totals since the stream started, except the peaks, which the reader
+   // resets; the reader remembers what it took from the totals
+   std::atomic<float> mPeak[2];
+   std::atomic<double> mSquares[2];
+   std::atomic<size_t> mClipped[2];
+   std::atomic<size_t> mFrames;
+
+   double mTakenSquares[2];
+   size_t mTakenClipped[2];
+   size_t mTakenFrames;
+};
+
 class AUDACITY_DLL_API AudioIoCallback /* not final */
    : public AudioIOBase
 {
@@ -266,7 +335,10 @@ public:
    void ComputeMidiTimings(
       const PaStreamCallbackTimeInfo *timeInfo,
       unsigned long framesPerBuffer);
-   void CheckSoundActivatedRecordingLevel(const void *inputBuffer);
+   void CheckSoundActivatedRecordingLevel(
+      float *tempFloats,
+      const void *inputBuffer,
+      unsigned long framesPerBuffer);
    void AddToOutputChannel( unsigned int chan,
       float * outputMeterFloats,
       float * outputFloats,
@@ -274,7 +346,8 @@ public:
       float * tempBuf,
       bool drop,
       unsigned long len,
-      WaveTrack *vt
+      WaveTrack *vt,
+      PlaybackLevels *levels
       );
    bool FillOutputBuffers(
       void *outputBuffer,
@@ -284,8 +357,7 @@ public:
    void FillInputBuffers(
       const void *inputBuffer, 
       unsigned long framesPerBuffer,
-      const PaStreamCallbackFlags statusFlags,
-      float * tempFloats
+      const PaStreamCallbackFlags statusFlags
    );
    void UpdateTimePosition(
       unsigned long framesPerBuffer
@@ -306,6 +378,9 @@ public:
       unsigned long framesPerBuffer
    );
 
+   // Make the audio thread call FillBuffers now, not at the end of its sleep
+   void WakeAudioThread();
+
 
 // Required by these functions...
 #ifdef EXPERIMENTAL_MIDI_OUT
@@ -413,13 +488,19 @@ public:
 #endif
 
    std::unique_ptr<AudioThread> mThread;
+   std::unique_ptr<AudioThread> mCaptureThread;
 #ifdef EXPERIMENTAL_MIDI_OUT
 #ifdef USE_MIDI_THREAD
    std::unique_ptr<AudioThread> mMidiThread;
 #endif
 #endif
    ArrayOf<std::unique_ptr<Resample>> mResample;
-   ArrayOf<std::unique_ptr<RingBuffer>> mCaptureBuffers;
+   /// All capture channels, interleaved as the device delivers them, so
+   /// that the callback makes one copy however many channels there are
+   std::unique_ptr<RingBuffer> mCaptureBuffer;
+   /// Where DrainRecordBuffers separates the channels; made with the stream
+   struct CaptureScratch;
+   std::unique_ptr<CaptureScratch> mCaptureScratch;
    WaveTrackArray      mCaptureTracks;
    ArrayOf<std::unique_ptr<RingBuffer>> mPlaybackBuffers;
    WaveTrackArray      mPlaybackTracks;
@@ -428,6 +509,13 @@ public:
    static int          mNextStreamToken;
    double              mFactor;
    unsigned long       mMaxFramesOutput; // The actual number of frames output.
+
+   /// Scratch space for the callback, so that it allocates nothing; made
+   /// when the stream opens, for the most frames per buffer expected
+   struct CallbackScratch;
+   std::unique_ptr<CallbackScratch> mCallbackScratch;
+   /// By playback track; allocated with the scratch, before the stream runs
+   ArrayOf<PlaybackLevels> mPlaybackLevels;
    bool                mbMicroFades; 
 
    double              mSeek;
@@ -438,12 +526,27 @@ public:
    size_t              mPlaybackSamplesToCopy;
    /// Occupancy of the queue we try to maintain, with bigger batches if needed
    size_t              mPlaybackQueueMinimum;
+   /// The same, for mouse scrubbing that is not seeking
+   size_t              mScrubQueueMinimum{ 0 };
+   /// Whether the last filling was for such scrubbing; used by the Audio
+   /// thread only
+   bool                mScrubShortQueue{ false };
 
    double              mMinCaptureSecsToCopy;
    bool                mSoftwarePlaythrough;
    /// True if Sound Activated Recording is enabled
    bool                mPauseRec;
+   /// Amplitude of the input below which sound activated recording pauses
    float               mSilenceLevel;
+   /// Seconds the input must stay above the level to resume recording, and
+   /// below it to pause
+   double              mSoundActivationAttack;
+   double              mSoundActivationHold;
+   /// Frames of input since it last went below, or above, the level
+   unsigned long       mFramesAboveSilence;
+   unsigned long       mFramesBelowSilence;
+   /// A pause or resume was requested of the main thread and is not yet done
+   bool                mSoundActivationPending;
    unsigned int        mNumCaptureChannels;
    unsigned int        mNumPlaybackChannels;
    sampleFormat        mCaptureFormat;
@@ -452,11 +555,28 @@ public:
    volatile bool       mAudioThreadFillBuffersLoopRunning;
    volatile bool       mAudioThreadFillBuffersLoopActive;
 
+   /// Woken by the callback when it has consumed a playback batch
+   AudioThreadWaker    mAudioThreadWaker;
+   /// Woken by the callback when it has produced a capture batch
+   AudioThreadWaker    mCaptureThreadWaker;
+   /// Set by the capture thread around each pass, as the audio thread sets
+   /// mAudioThreadFillBuffersLoopActive
+   volatile bool       mCaptureThreadLoopActive;
+   /// Held while draining the capture buffers, which the capture thread
+   /// does, and also the audio thread when asked to call FillBuffers once
+   std::mutex          mCaptureDrainMutex;
+   /// Whether the audio threads should run at real-time priority, and the
+   /// stream's buffers be locked in memory; see RealtimeScheduling
+   volatile bool       mProAudioMode;
+
    wxLongLong          mLastPlaybackTimeMillis;
 
 #ifdef EXPERIMENTAL_MIDI_OUT
    volatile bool       mMidiThreadFillBuffersLoopRunning;
    volatile bool       mMidiThreadFillBuffersLoopActive;
+   /// The MIDI thread sleeps until its next event falls due, unless woken
+   /// sooner because the stream starts or pauses
+   AudioThreadWaker    mMidiThreadWaker;
 #endif
 
    volatile double     mLastRecordingOffset;
@@ -470,6 +590,7 @@ protected:
    std::weak_ptr< AudioIOListener > mListener;
 
    friend class AudioThread;
+   friend class CaptureThread;
 #ifdef EXPERIMENTAL_MIDI_OUT
    friend class MidiThread;
 #endif
@@ -607,6 +728,14 @@ public:
    wxString LastPaErrorString();
 
    wxLongLong GetLastPlaybackTime() const { return mLastPlaybackTimeMillis; }
+
+   /** \brief Levels of a playing track group since the last call, after its
+    * gain and pan, for the meters of the mixer board
+    *
+    * Peaks and RMS are for the left and right output channels.  False if the
+    * group with this leader is not playing.  Call on the main thread only */
+   bool TakePlaybackLevels(
+      const WaveTrack &leader, PlaybackLevels::Levels &levels);
    AudacityProject *GetOwningProject() const { return mOwningProject; }
 
 #ifdef EXPERIMENTAL_MIDI_OUT
@@ -706,6 +835,7 @@ public:
    double GetBestRate(bool capturing, bool playing, double sampleRate);
 
    friend class AudioThread;
+   friend class CaptureThread;
 #ifdef EXPERIMENTAL_MIDI_OUT
    friend class MidiThread;
 #endif
@@ -736,7 +866,16 @@ private:
                              unsigned int numPlaybackChannels,
                              unsigned int numCaptureChannels,
                              sampleFormat captureFormat);
+   /// Both of the following; what the audio thread does when asked to
+   /// call FillBuffers once, at stream start and stop and after seeking
    void FillBuffers();
+   /// Mix, resample and apply realtime effects into the playback buffers;
+   /// done by the audio thread
+   void FillPlaybackBuffers();
+   /// Append the contents of the capture buffers to the recording tracks;
+   /// done by the capture thread, so that slow disk writes don't delay
+   /// playback, nor heavy mixing delay recording
+   void DrainRecordBuffers();
 
 #ifdef EXPERIMENTAL_MIDI_OUT
    void PrepareMidiIterator(bool send = true, double offset = 0);
@@ -747,7 +886,9 @@ private:
    double UncorrectedMidiEventTime();
 
    void OutputEvent();
-   void FillMidiBuffers();
+   /// Output the events that are due, and return the seconds until the
+   /// next one is, or until playback completes
+   double FillMidiBuffers();
    void GetNextEvent();
    double PauseTime();
    void AllNotesOff(bool looping = false);
@@ -778,6 +919,14 @@ private:
       const TransportTracks &tracks, double t0, double t1, double sampleRate,
       bool scrubbing );
 
+   /** \brief Allocate the scratch space of the callback, for the channels
+     * and playback tracks and the latency of the stream just opened. */
+   void AllocateCallbackScratch();
+
+   /** \brief Allocate the scratch space of DrainRecordBuffers, for the
+     * capture tracks and with mCaptureBuffer already made. */
+   void AllocateCaptureScratch();
+
    /** \brief Clean up after StartStream if it fails.
      *
      * If bOnlyBuffers is specified, it only cleans up the buffers. */
@@ -463,6 +463,12 @@ double AudioIOBase::PlaybackSchedule::ClampTrackTime( double trackTime ) const
 }
 
 double AudioIOBase::PlaybackSchedule::NormalizeTrackTime() const
+{
+   return NormalizeTrackTime( GetTrackTime() );
+}
+
+double AudioIOBase::PlaybackSchedule::NormalizeTrackTime(
+   double trackTime ) const
 {
    // Track time readout for the main thread
 
@@ -484,10 +490,10 @@ double AudioIOBase::PlaybackSchedule::NormalizeTrackTime() const
    // Limit the time between t0 and t1 if not scrubbing.
    // Should the limiting be necessary in any play mode if there are no bugs?
    if (Interactive())
-      absoluteTime = GetTrackTime();
+      absoluteTime = trackTime;
    else
 #endif
-      absoluteTime = LimitTrackTime();
+      absoluteTime = ClampTrackTime( trackTime );
 
    if (mCutPreviewGapLen > 0)
    {
@@ -510,6 +516,73 @@ double AudioIOBase::GetStreamTime()
    return mPlaybackSchedule.NormalizeTrackTime();
 }
 
+double AudioIOBase::GetAudibleStreamTime()
+{
+   // Track time readout for the main thread
+
+   if( !IsStreamActive() )
+      return BAD_STREAM_TIME;
+
+   double startTime, endTime, dacTime, duration;
+   if ( !mPortStreamV19 ||
+        !mPositionStamp.Read( startTime, endTime, dacTime, duration ) ||
+        duration <= 0 )
+      return GetStreamTime();
+
+   // The buffer wrapped around in looped play; it is brief
+   if ( mPlaybackSchedule.Looping() &&
+        ( endTime - startTime ) * ( mPlaybackSchedule.mT1 -
+           mPlaybackSchedule.mT0 ) < 0 )
+      return GetStreamTime();
+
+   // Hosts without a stream clock give zero.  The latest buffer is usually
+   // still ahead of the output, by the latency, so extrapolate back from it;
+   // but not forward past its end, as when paused or late
+   const auto now = Pa_GetStreamTime( mPortStreamV19 );
+   const auto elapsed = now - dacTime;
+   if ( now <= 0 || elapsed < -1.0 )
+      return GetStreamTime();
+   const auto fraction = std::min( 1.0, elapsed / duration );
+   return mPlaybackSchedule.NormalizeTrackTime(
+      startTime + fraction * ( endTime - startTime ) );
+}
+
+void AudioIOBase::PositionStamp::Write(double startTime, double endTime,
+   double dacTime, double duration)
+{
+   // A sequence lock:  readers retry if the count changed or is odd
+   const auto sequence = mSequence.load( std::memory_order_relaxed );
+   mSequence.store( sequence + 1, std::memory_order_relaxed );
+   std::atomic_thread_fence( std::memory_order_release );
+   mStartTime.store( startTime, std::memory_order_relaxed );
+   mEndTime.store( endTime, std::memory_order_relaxed );
+   mDacTime.store( dacTime, std::memory_order_relaxed );
+   mDuration.store( duration, std::memory_order_relaxed );
+   // Skip zero when wrapping around, so that it still means no stamp
+   mSequence.store( sequence + 2 ? sequence + 2 : 2,
+      std::memory_order_release );
+}
+
+bool AudioIOBase::PositionStamp::Read(double &startTime, double &endTime,
+   double &dacTime, double &duration) const
+{
+   for ( int attempt = 0; attempt < 4; ++attempt ) {
+      const auto before = mSequence.load( std::memory_order_acquire );
+      if ( before == 0 )
+         return false;
+      if ( before & 1 )
+         continue;
+      startTime = mStartTime.load( std::memory_order_relaxed );
+      endTime = mEndTime.load( std::memory_order_relaxed );
+      dacTime = mDacTime.load( std::memory_order_relaxed );
+      duration = mDuration.load( std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if ( mSequence.load( std::memory_order_relaxed ) == before )
+         return true;
+   }
+   return false;
+}
+
 std::vector<long> AudioIOBase::GetSupportedPlaybackRates(int devIndex, double rate)
 {
    if (devIndex == -1)
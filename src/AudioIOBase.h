@@ -22,6 +22,7 @@ Paul Licameli split from AudioIO.h
 #include <wx/string.h>
 #include <wx/weakref.h> // member variable
 #include "portaudio.h"
+#include "AudioIOMetrics.h" // member variable
 
 #if USE_PORTMIXER
 #include "../lib-src/portmixer/include/portmixer.h"
@@ -199,6 +200,16 @@ public:
     */
    double GetStreamTime();
 
+   /** \brief During playback, the track time now reaching the output
+    *
+    * Unlike GetStreamTime, which steps once per callback and leads what is
+    * heard by the output latency, this interpolates from when the latest
+    * buffer reaches the converter, by PortAudio's stream clock, and so moves
+    * smoothly.  Falls back to GetStreamTime when the host gives no timing.
+    * Cheap enough to call for every redraw.
+    */
+   double GetAudibleStreamTime();
+
    /** \brief Array of common audio sample rates
     *
     * These are the rates we will always support, regardless of hardware support
@@ -256,6 +267,9 @@ public:
     */
    void SetMixer(int inputSource);
 
+   /// Callback timing and xrun counts of the current or last stream
+   const AudioIOMetrics &GetMetrics() const { return mMetrics; }
+
 protected:
    static std::unique_ptr<AudioIOBase> ugAudioIO;
    static wxString DeviceName(const PaDeviceInfo* info);
@@ -279,6 +293,8 @@ protected:
 
    PaStream           *mPortStreamV19;
 
+   AudioIOMetrics      mMetrics;
+
    wxWeakRef<MeterPanelBase> mInputMeter{};
    wxWeakRef<MeterPanelBase> mOutputMeter{};
 
@@ -409,6 +425,8 @@ protected:
        * Returns a time in seconds.
        */
       double NormalizeTrackTime() const;
+      /** \brief The same, for a given track time */
+      double NormalizeTrackTime( double trackTime ) const;
 
       void ResetMode() { mPlayMode = PLAY_STRAIGHT; }
 
@@ -456,6 +474,32 @@ protected:
 
    } mPlaybackSchedule;
 
+   /// What the audio callback last played, published without locks for any
+   /// thread to read:  the track times at the start and end of the buffer,
+   /// when its first sample reaches the converter, and its real duration
+   class PositionStamp
+   {
+   public:
+      /// Call while no callback runs
+      void Reset() { mSequence.store( 0, std::memory_order_relaxed ); }
+
+      /// Called by the audio callback only
+      void Write(double startTime, double endTime,
+         double dacTime, double duration);
+
+      /// False if nothing was written, or if the writer kept interrupting
+      bool Read(double &startTime, double &endTime,
+         double &dacTime, double &duration) const;
+
+   private:
+      // Odd while a write is in progress; zero if there was none
+      std::atomic<unsigned> mSequence{ 0 };
+      std::atomic<double> mStartTime{ 0 };
+      std::atomic<double> mEndTime{ 0 };
+      std::atomic<double> mDacTime{ 0 };
+      std::atomic<double> mDuration{ 0 };
+   } mPositionStamp;
+
    /** \brief get the index of the supplied (named) recording device, or the
     * device selected in the preferences if none given.
     *
@@ -0,0 +1,171 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AudioIOMetrics.cpp
+
+*******************************************************************//**
+
+\class AudioIOMetrics
+\brief Lock free timing counters for the PortAudio callback and the audio
+thread, to help choose buffer sizes from measurements.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "AudioIOMetrics.h"
+
+#include <algorithm>
+#include <wx/sstream.h>
+#include <wx/txtstrm.h>
+
+#include "Internat.h"
+
+void AudioIOMetrics::Reset(double rate)
+{
+   const auto resetTiming = [](AtomicTiming &timing){
+      timing.count.store(0, std::memory_order_relaxed);
+      timing.totalMicroseconds.store(0, std::memory_order_relaxed);
+      timing.maxMicroseconds.store(0, std::memory_order_relaxed);
+      for (auto &bucket : timing.histogram)
+         bucket.store(0, std::memory_order_relaxed);
+   };
+
+   mStart = Clock::now();
+   mRate = rate;
+   resetTiming(mCallback);
+   mLateCallbacks.store(0, std::memory_order_relaxed);
+   resetTiming(mFillBuffers);
+   mMinPlaybackReady.store(~0ull, std::memory_order_relaxed);
+   mLastPlaybackReady.store(0, std::memory_order_relaxed);
+   mMaxCaptureAvail.store(0, std::memory_order_relaxed);
+   mLastCaptureAvail.store(0, std::memory_order_relaxed);
+   mInputUnderflows.store(0, std::memory_order_relaxed);
+   mInputOverflows.store(0, std::memory_order_relaxed);
+   mOutputUnderflows.store(0, std::memory_order_relaxed);
+   mOutputOverflows.store(0, std::memory_order_relaxed);
+   mXrunCount.store(0, std::memory_order_release);
+}
+
+auto AudioIOMetrics::Load(const AtomicTiming &timing) -> Timing
+{
+   Timing result;
+   result.count = timing.count.load(std::memory_order_relaxed);
+   result.totalMicroseconds =
+      timing.totalMicroseconds.load(std::memory_order_relaxed);
+   result.maxMicroseconds =
+      timing.maxMicroseconds.load(std::memory_order_relaxed);
+   for (size_t ii = 0; ii < NumBuckets; ++ii)
+      result.histogram[ii] =
+         timing.histogram[ii].load(std::memory_order_relaxed);
+   return result;
+}
+
+auto AudioIOMetrics::GetSnapshot() const -> Snapshot
+{
+   Snapshot result;
+   result.rate = mRate;
+   result.callback = Load(mCallback);
+   result.lateCallbacks = mLateCallbacks.load(std::memory_order_relaxed);
+   result.fillBuffers = Load(mFillBuffers);
+
+   const auto minReady = mMinPlaybackReady.load(std::memory_order_relaxed);
+   result.minPlaybackReady = (minReady == ~0ull) ? 0 : minReady;
+   result.lastPlaybackReady =
+      mLastPlaybackReady.load(std::memory_order_relaxed);
+   result.maxCaptureAvail = mMaxCaptureAvail.load(std::memory_order_relaxed);
+   result.lastCaptureAvail =
+      mLastCaptureAvail.load(std::memory_order_relaxed);
+
+   result.inputUnderflows = mInputUnderflows.load(std::memory_order_relaxed);
+   result.inputOverflows = mInputOverflows.load(std::memory_order_relaxed);
+   result.outputUnderflows =
+      mOutputUnderflows.load(std::memory_order_relaxed);
+   result.outputOverflows = mOutputOverflows.load(std::memory_order_relaxed);
+
+   const auto count = mXrunCount.load(std::memory_order_acquire);
+   result.xrunCount = count;
+   const auto kept = std::min<unsigned long long>(count, NumXrunsKept);
+   for (auto ii = count - kept; ii < count; ++ii) {
+      const auto &slot = mXruns[ii % NumXrunsKept];
+      result.recentXruns.push_back({
+         slot.microseconds.load(std::memory_order_relaxed) / 1e6,
+         slot.flags.load(std::memory_order_relaxed) });
+   }
+
+   return result;
+}
+
+wxString AudioIOMetrics::Report() const
+{
+   const auto snapshot = GetSnapshot();
+
+   wxStringOutputStream o;
+   wxTextOutputStream s(o, wxEOL_UNIX);
+
+   const auto reportTiming = [&](const Timing &timing){
+      if (timing.count == 0)
+         return;
+      s << XO("Count: %llu, mean: %.3f ms, longest: %.3f ms\n")
+         .Format( timing.count,
+            timing.totalMicroseconds / (1000.0 * timing.count),
+            timing.maxMicroseconds / 1000.0 );
+      unsigned long long lower = 0;
+      for (size_t ii = 0; ii < NumBuckets; ++ii) {
+         const auto upper = 1ull << (ii + FirstBucketLog2);
+         if (timing.histogram[ii] > 0) {
+            if (ii + 1 < NumBuckets)
+               s << XO("  %llu - %llu us: %llu\n")
+                  .Format( lower, upper, timing.histogram[ii] );
+            else
+               s << XO("  %llu us or more: %llu\n")
+                  .Format( lower, timing.histogram[ii] );
+         }
+         lower = upper;
+      }
+   };
+
+   const auto seconds = [&](unsigned long long samples){
+      return snapshot.rate > 0 ? samples / snapshot.rate : 0.0;
+   };
+
+   s << wxT("==============================\n");
+   s << XO("Audio I/O performance of the last stream:\n");
+   s << XO("Sample rate: %.0f\n").Format( snapshot.rate );
+
+   s << wxT("==============================\n");
+   s << XO("Callback durations:\n");
+   reportTiming(snapshot.callback);
+   s << XO("Callbacks longer than their buffers: %llu\n")
+      .Format( snapshot.lateCallbacks );
+
+   s << wxT("==============================\n");
+   s << XO("Audio thread buffer filling durations:\n");
+   reportTiming(snapshot.fillBuffers);
+   s << XO("Playback buffer fill, least: %llu samples (%.3f s), latest: %llu samples (%.3f s)\n")
+      .Format( snapshot.minPlaybackReady, seconds(snapshot.minPlaybackReady),
+         snapshot.lastPlaybackReady, seconds(snapshot.lastPlaybackReady) );
+   s << XO("Capture buffer fill, greatest: %llu samples (%.3f s), latest: %llu samples (%.3f s)\n")
+      .Format( snapshot.maxCaptureAvail, seconds(snapshot.maxCaptureAvail),
+         snapshot.lastCaptureAvail, seconds(snapshot.lastCaptureAvail) );
+
+   s << wxT("==============================\n");
+   s << XO("Input underflows: %llu, input overflows: %llu\n")
+      .Format( snapshot.inputUnderflows, snapshot.inputOverflows );
+   s << XO("Output underflows: %llu, output overflows: %llu\n")
+      .Format( snapshot.outputUnderflows, snapshot.outputOverflows );
+   for (const auto &xrun : snapshot.recentXruns) {
+      wxString kinds;
+      if (xrun.flags & paInputUnderflow)
+         kinds += wxT(" input-underflow");
+      if (xrun.flags & paInputOverflow)
+         kinds += wxT(" input-overflow");
+      if (xrun.flags & paOutputUnderflow)
+         kinds += wxT(" output-underflow");
+      if (xrun.flags & paOutputOverflow)
+         kinds += wxT(" output-overflow");
+      s << XO("  at %.3f s:%s\n").Format( xrun.time, kinds );
+   }
+
+   return o.GetString();
+}
@@ -0,0 +1,196 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AudioIOMetrics.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_AUDIO_IO_METRICS__
+#define __AUDACITY_AUDIO_IO_METRICS__
+
+#include "Audacity.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <wx/string.h>
+#include "portaudio.h"
+
+/// \brief Counters describing the timing of the PortAudio callback and of
+/// the audio thread, for the life of one stream.
+///
+/// Recording is lock free and allocates nothing, so it may be done from the
+/// callback.  Readers on other threads get values that are each consistent,
+/// though not necessarily all from the same instant.
+class AUDACITY_DLL_API AudioIOMetrics
+{
+public:
+   using Clock = std::chrono::steady_clock;
+
+   /// Histogram bucket ii counts durations under 2^(ii + FirstBucketLog2)
+   /// microseconds, not counted in an earlier bucket; the last is unbounded
+   enum : size_t { NumBuckets = 16, FirstBucketLog2 = 4 };
+   /// How many of the most recent xruns are remembered
+   enum : size_t { NumXrunsKept = 16 };
+
+   using Histogram = std::array<unsigned long long, NumBuckets>;
+
+   struct Timing {
+      unsigned long long count{ 0 };
+      unsigned long long totalMicroseconds{ 0 };
+      unsigned long long maxMicroseconds{ 0 };
+      Histogram histogram{};
+   };
+
+   struct Xrun {
+      double time; ///< seconds since the stream started
+      PaStreamCallbackFlags flags;
+   };
+
+   struct Snapshot {
+      double rate{ 0 };
+      Timing callback;
+      /// Callbacks that took longer than the audio they delivered
+      unsigned long long lateCallbacks{ 0 };
+      Timing fillBuffers;
+      /// Least and latest samples ready in the playback buffers, as seen
+      /// by the audio thread
+      unsigned long long minPlaybackReady{ 0 }, lastPlaybackReady{ 0 };
+      /// Greatest and latest samples waiting in the capture buffers
+      unsigned long long maxCaptureAvail{ 0 }, lastCaptureAvail{ 0 };
+      unsigned long long inputUnderflows{ 0 }, inputOverflows{ 0 },
+         outputUnderflows{ 0 }, outputOverflows{ 0 };
+      unsigned long long xrunCount{ 0 };
+      /// The most recent xruns, oldest first
+      std::vector<Xrun> recentXruns;
+   };
+
+   /// Call before the stream starts, not concurrently with recording
+   void Reset(double rate);
+
+   /// Called at the end of each PortAudio callback
+   void RecordCallback(Clock::time_point start,
+      unsigned long framesPerBuffer, PaStreamCallbackFlags statusFlags)
+   {
+      const auto now = Clock::now();
+      const auto duration = Microseconds(now - start);
+      RecordTiming(mCallback, duration);
+      if (mRate > 0 && duration > framesPerBuffer * 1e6 / mRate)
+         mLateCallbacks.fetch_add(1, std::memory_order_relaxed);
+
+      const auto xrunFlags = statusFlags &
+         (paInputUnderflow | paInputOverflow |
+          paOutputUnderflow | paOutputOverflow);
+      if (xrunFlags && !(statusFlags & paPrimingOutput)) {
+         if (xrunFlags & paInputUnderflow)
+            mInputUnderflows.fetch_add(1, std::memory_order_relaxed);
+         if (xrunFlags & paInputOverflow)
+            mInputOverflows.fetch_add(1, std::memory_order_relaxed);
+         if (xrunFlags & paOutputUnderflow)
+            mOutputUnderflows.fetch_add(1, std::memory_order_relaxed);
+         if (xrunFlags & paOutputOverflow)
+            mOutputOverflows.fetch_add(1, std::memory_order_relaxed);
+
+         // Only the callback writes xruns, so the slot is ours
+         const auto index = mXrunCount.load(std::memory_order_relaxed);
+         auto &slot = mXruns[index % NumXrunsKept];
+         slot.microseconds.store(
+            Microseconds(now - mStart), std::memory_order_relaxed);
+         slot.flags.store(xrunFlags, std::memory_order_relaxed);
+         mXrunCount.store(index + 1, std::memory_order_release);
+      }
+   }
+
+   /// Called after each pass of the audio thread; ready and avail are
+   /// sampled at the start of the pass, or are -1 when not applicable
+   void RecordFillBuffers(Clock::time_point start,
+      long long playbackReady, long long captureAvail)
+   {
+      RecordTiming(mFillBuffers, Microseconds(Clock::now() - start));
+      if (playbackReady >= 0) {
+         mLastPlaybackReady.store(playbackReady, std::memory_order_relaxed);
+         UpdateMin(mMinPlaybackReady, playbackReady);
+      }
+      if (captureAvail >= 0) {
+         mLastCaptureAvail.store(captureAvail, std::memory_order_relaxed);
+         UpdateMax(mMaxCaptureAvail, captureAvail);
+      }
+   }
+
+   Snapshot GetSnapshot() const;
+
+   /// A readable summary for diagnostics
+   wxString Report() const;
+
+private:
+   using Counter = std::atomic<unsigned long long>;
+
+   struct AtomicTiming {
+      Counter count{ 0 };
+      Counter totalMicroseconds{ 0 };
+      Counter maxMicroseconds{ 0 };
+      std::array<Counter, NumBuckets> histogram{};
+   };
+
+   struct AtomicXrun {
+      Counter microseconds{ 0 };
+      std::atomic<PaStreamCallbackFlags> flags{ 0 };
+   };
+
+   static unsigned long long Microseconds(Clock::duration duration)
+   {
+      const auto count =
+         std::chrono::duration_cast<std::chrono::microseconds>(duration)
+            .count();
+      return count > 0 ? count : 0;
+   }
+
+   static void UpdateMax(Counter &counter, unsigned long long value)
+   {
+      auto old = counter.load(std::memory_order_relaxed);
+      while (value > old &&
+         !counter.compare_exchange_weak(old, value, std::memory_order_relaxed))
+         ;
+   }
+
+   static void UpdateMin(Counter &counter, unsigned long long value)
+   {
+      auto old = counter.load(std::memory_order_relaxed);
+      while (value < old &&
+         !counter.compare_exchange_weak(old, value, std::memory_order_relaxed))
+         ;
+   }
+
+   static void RecordTiming(AtomicTiming &timing, unsigned long long us)
+   {
+      size_t bucket = 0;
+      while (bucket + 1 < NumBuckets &&
+             us >= (1ull << (bucket + FirstBucketLog2)))
+         ++bucket;
+      timing.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+      timing.count.fetch_add(1, std::memory_order_relaxed);
+      timing.totalMicroseconds.fetch_add(us, std::memory_order_relaxed);
+      UpdateMax(timing.maxMicroseconds, us);
+   }
+
+   static Timing Load(const AtomicTiming &timing);
+
+   Clock::time_point mStart{ Clock::now() };
+   double mRate{ 0 };
+
+   AtomicTiming mCallback;
+   Counter mLateCallbacks{ 0 };
+   AtomicTiming mFillBuffers;
+
+   Counter mMinPlaybackReady{ ~0ull }, mLastPlaybackReady{ 0 };
+   Counter mMaxCaptureAvail{ 0 }, mLastCaptureAvail{ 0 };
+
+   Counter mInputUnderflows{ 0 }, mInputOverflows{ 0 },
+      mOutputUnderflows{ 0 }, mOutputOverflows{ 0 };
+   Counter mXrunCount{ 0 };
+   std::array<AtomicXrun, NumXrunsKept> mXruns{};
+};
+
+#endif
@@ -21,6 +21,8 @@ text or binary format to a file.
 #include "Audacity.h"
 #include "AutoRecovery.h"
 #include "DirManager.h"
+#include "Internat.h"
+#include "Prefs.h"
 #include "blockfile/SimpleBlockFile.h"
 #include "Sequence.h"
 
@@ -381,6 +383,28 @@ void AutoSaveFile::WriteSubTree(const AutoSaveFile & value)
    mBuffer.PutC(FT_Pop);
 }
 
+std::string AutoSaveFile::EncodeSubTree() const
+{
+   std::string result;
+   result += static_cast<char>(FT_Push);
+
+   wxStreamBuffer *buf = mDict.GetOutputStreamBuffer();
+   result.append(
+      static_cast<const char*>(buf->GetBufferStart()), buf->GetIntPosition());
+
+   buf = mBuffer.GetOutputStreamBuffer();
+   result.append(
+      static_cast<const char*>(buf->GetBufferStart()), buf->GetIntPosition());
+
+   result += static_cast<char>(FT_Pop);
+   return result;
+}
+
+void AutoSaveFile::AppendEncoded(const std::string & bytes)
+{
+   mBuffer.Write(bytes.data(), bytes.size());
+}
+
 bool AutoSaveFile::Write(wxFFile & file) const
 {
    bool success = file.Write(AutoSaveIdent, strlen(AutoSaveIdent)) == strlen(AutoSaveIdent);
@@ -445,11 +469,228 @@ void AutoSaveFile::WriteName(const wxString & name)
    mBuffer.Write(&id, sizeof(id));
 }
 
+void AutoSaveFile::WriteProject(XMLFileWriter & file) const
+{
+   file.WriteBytes(BinaryProjectIdent, strlen(BinaryProjectIdent));
+   const unsigned char charSize = sizeof(wxChar);
+   file.WriteBytes(&charSize, sizeof(charSize));
+
+   wxStreamBuffer *buf = mDict.GetOutputStreamBuffer();
+   file.WriteBytes(buf->GetBufferStart(), buf->GetIntPosition());
+   buf = mBuffer.GetOutputStreamBuffer();
+   file.WriteBytes(buf->GetBufferStart(), buf->GetIntPosition());
+}
+
+bool AutoSaveFile::GetBinaryProjectFiles()
+{
+   bool binary;
+   gPrefs->Read(wxT("/FileFormats/BinaryProjectFiles"), &binary, false);
+   return binary;
+}
+
 bool AutoSaveFile::IsEmpty() const
 {
    return mBuffer.GetLength() == 0;
 }
 
+// Replay the fields to the writer, ending at the end of the stream; false if
+// a name is not in the dictionary
+static bool DecodeFields(wxMemoryInputStream &in, XMLWriter &out)
+{
+   using WxChars = ArrayOf < wxChar >;
+
+   IdMap mIds;
+   std::vector<IdMap> mIdStack;
+
+   mIds.clear();
+
+   struct Error{};
+   auto Lookup = [&mIds]( short id ) -> const wxString & {
+      auto iter = mIds.find( id );
+      if ( iter == mIds.end() )
+         throw Error{};
+      return iter->second;
+   };
+
+   try { while ( !in.Eof() ) {
+      short id;
+
+      switch (in.GetC())
+      {
+         case FT_Push:
+         {
+            mIdStack.push_back(mIds);
+            mIds.clear();
+         }
+         break;
+
+         case FT_Pop:
+         {
+            mIds = mIdStack.back();
+            mIdStack.pop_back();
+         }
+         break;
+
+         case FT_Name:
+         {
+            short len;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&len, sizeof(len));
+            WxChars name{ len / sizeof(wxChar) };
+            in.Read(name.get(), len);
+
+            mIds[id] = wxString(name.get(), len / sizeof(wxChar));
+         }
+         break;
+
+         case FT_StartTag:
+         {
+            in.Read(&id, sizeof(id));
+
+            out.StartTag(Lookup(id));
+         }
+         break;
+
+         case FT_EndTag:
+         {
+            in.Read(&id, sizeof(id));
+
+            out.EndTag(Lookup(id));
+         }
+         break;
+
+         case FT_String:
+         {
+            int len;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&len, sizeof(len));
+            WxChars val{ len / sizeof(wxChar) };
+            in.Read(val.get(), len);
+
+            out.WriteAttr(Lookup(id), wxString(val.get(), len / sizeof(wxChar)));
+         }
+         break;
+
+         case FT_Float:
+         {
+            float val;
+            int dig;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+            in.Read(&dig, sizeof(dig));
+
+            out.WriteAttr(Lookup(id), val, dig);
+         }
+         break;
+
+         case FT_Double:
+         {
+            double val;
+            int dig;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+            in.Read(&dig, sizeof(dig));
+
+            out.WriteAttr(Lookup(id), val, dig);
+         }
+         break;
+
+         case FT_Int:
+         {
+            int val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            out.WriteAttr(Lookup(id), val);
+         }
+         break;
+
+         case FT_Bool:
+         {
+            bool val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            out.WriteAttr(Lookup(id), val);
+         }
+         break;
+
+         case FT_Long:
+         {
+            long val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            out.WriteAttr(Lookup(id), val);
+         }
+         break;
+
+         case FT_LongLong:
+         {
+            long long val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            out.WriteAttr(Lookup(id), val);
+         }
+         break;
+
+         case FT_SizeT:
+         {
+            size_t val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            out.WriteAttr(Lookup(id), val);
+         }
+         break;
+
+         case FT_Data:
+         {
+            int len;
+
+            in.Read(&len, sizeof(len));
+            WxChars val{ len / sizeof(wxChar) };
+            in.Read(val.get(), len);
+
+            out.WriteData(wxString(val.get(), len / sizeof(wxChar)));
+         }
+         break;
+
+         case FT_Raw:
+         {
+            int len;
+
+            in.Read(&len, sizeof(len));
+            WxChars val{ len / sizeof(wxChar) };
+            in.Read(val.get(), len);
+
+            out.Write(wxString(val.get(), len / sizeof(wxChar)));
+         }
+         break;
+
+         default:
+            wxASSERT(true);
+         break;
+      }
+   } }
+   catch( const Error & )
+   {
+      return false;
+   }
+
+   return true;
+}
+
 bool AutoSaveFile::Decode(const FilePath & fileName)
 {
    char ident[sizeof(AutoSaveIdent)];
@@ -512,7 +753,6 @@ bool AutoSaveFile::Decode(const FilePath & fileName)
 
    len = file.Length() - len;
    using Chars = ArrayOf < char >;
-   using WxChars = ArrayOf < wxChar >;
    Chars buf{ len };
    if (file.Read(buf.get(), len) != len)
    {
@@ -531,198 +771,196 @@ bool AutoSaveFile::Decode(const FilePath & fileName)
    return GuardedCall< bool >( [&] {
       XMLFileWriter out{ fileName, XO("Error Decoding File") };
 
-      IdMap mIds;
-      std::vector<IdMap> mIdStack;
-
-      mIds.clear();
-   
-      struct Error{};
-      auto Lookup = [&mIds]( short id ) -> const wxString & {
-         auto iter = mIds.find( id );
-         if ( iter == mIds.end() )
-            throw Error{};
-         return iter->second;
-      };
-
-      try { while ( !in.Eof() ) {
-         short id;
-
-         switch (in.GetC())
-         {
-            case FT_Push:
-            {
-               mIdStack.push_back(mIds);
-               mIds.clear();
-            }
-            break;
-
-            case FT_Pop:
-            {
-               mIds = mIdStack.back();
-               mIdStack.pop_back();
-            }
-            break;
-
-            case FT_Name:
-            {
-               short len;
-
-               in.Read(&id, sizeof(id));
-               in.Read(&len, sizeof(len));
-               WxChars name{ len / sizeof(wxChar) };
-               in.Read(name.get(), len);
-
-               mIds[id] = wxString(name.get(), len / sizeof(wxChar));
-            }
-            break;
-
-            case FT_StartTag:
-            {
-               in.Read(&id, sizeof(id));
-
-               out.StartTag(Lookup(id));
-            }
-            break;
-
-            case FT_EndTag:
-            {
-               in.Read(&id, sizeof(id));
-
-               out.EndTag(Lookup(id));
-            }
-            break;
-
-            case FT_String:
-            {
-               int len;
-
-               in.Read(&id, sizeof(id));
-               in.Read(&len, sizeof(len));
-               WxChars val{ len / sizeof(wxChar) };
-               in.Read(val.get(), len);
-
-               out.WriteAttr(Lookup(id), wxString(val.get(), len / sizeof(wxChar)));
-            }
-            break;
+      // return before committing, so we do not overwrite the recovery file!
+      if (!DecodeFields(in, out))
+         return false;
 
-            case FT_Float:
-            {
-               float val;
-               int dig;
+      out.Commit();
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
-               in.Read(&dig, sizeof(dig));
+      return true;
+   } );
+}
 
-               out.WriteAttr(Lookup(id), val, dig);
-            }
-            break;
+///
+/// BinaryProjectReader class
+///
 
-            case FT_Double:
-            {
-               double val;
-               int dig;
+bool BinaryProjectReader::IsBinaryProject(const FilePath & fileName)
+{
+   char ident[sizeof(BinaryProjectIdent)];
+   const size_t len = strlen(BinaryProjectIdent);
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
-               in.Read(&dig, sizeof(dig));
+   wxFFile file;
+   return file.Open(fileName, wxT("rb")) &&
+      file.Read(&ident, len) == len &&
+      strncmp(ident, BinaryProjectIdent, len) == 0;
+}
 
-               out.WriteAttr(Lookup(id), val, dig);
-            }
-            break;
+bool BinaryProjectReader::Parse(
+   XMLTagHandler *baseHandler, const FilePath & fileName)
+{
+   wxFFile file;
+   if (!file.Open(fileName, wxT("rb"))) {
+      mErrorStr = XO("Could not open file: \"%s\"").Format( fileName );
+      return false;
+   }
 
-            case FT_Int:
-            {
-               int val;
+   const size_t identLen = strlen(BinaryProjectIdent);
+   char ident[sizeof(BinaryProjectIdent)];
+   unsigned char charSize = 0;
+   if (file.Read(&ident, identLen) != identLen ||
+       strncmp(ident, BinaryProjectIdent, identLen) != 0 ||
+       file.Read(&charSize, sizeof(charSize)) != sizeof(charSize)) {
+      mErrorStr = XO("Could not load file: \"%s\"").Format( fileName );
+      return false;
+   }
+   if (charSize != sizeof(wxChar)) {
+      // Strings are in the native wide characters of the saving platform
+      mErrorStr =
+         XO("The project \"%s\" was saved in a binary format for a different kind of computer.")
+            .Format( fileName );
+      return false;
+   }
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+   const size_t len = file.Length() - identLen - sizeof(charSize);
+   ArrayOf<char> buf{ len };
+   if (file.Read(buf.get(), len) != len) {
+      mErrorStr = XO("Could not load file: \"%s\"").Format( fileName );
+      return false;
+   }
+   file.Close();
 
-               out.WriteAttr(Lookup(id), val);
-            }
-            break;
+   wxMemoryInputStream in(buf.get(), len);
 
-            case FT_Bool:
-            {
-               bool val;
+   mBaseHandler = baseHandler;
+   mHandlers.clear();
+   mPendingTag = false;
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+   if (!DecodeFields(in, *this)) {
+      mErrorStr = XO("File may be invalid or corrupted: \n%s").Format( fileName );
+      return false;
+   }
+   FlushTag();
 
-               out.WriteAttr(Lookup(id), val);
-            }
-            break;
+   // As for XMLFileReader, succeed only if the first-level handler was called
+   // and did not return false
+   if (mBaseHandler && mHandlers.empty())
+      return true;
+   else {
+      mErrorStr = XO("Could not load file: \"%s\"").Format( fileName );
+      return false;
+   }
+}
 
-            case FT_Long:
-            {
-               long val;
+void BinaryProjectReader::FlushTag()
+{
+   if (!mPendingTag)
+      return;
+   mPendingTag = false;
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+   if (mHandlers.empty())
+      mHandlers.push_back(mBaseHandler);
+   else if (XMLTagHandler *const handler = mHandlers.back())
+      mHandlers.push_back(handler->HandleXMLChild(mTag.wx_str()));
+   else
+      mHandlers.push_back(nullptr);
+
+   if (XMLTagHandler *& handler = mHandlers.back()) {
+      std::vector<const wxChar*> attrs;
+      attrs.reserve(mAttrs.size() + 1);
+      for (const auto &attr : mAttrs)
+         attrs.push_back(attr.wx_str());
+      attrs.push_back(nullptr);
+
+      if (!handler->HandleXMLTag(mTag.wx_str(), attrs.data())) {
+         handler = nullptr;
+         if (mHandlers.size() == 1)
+            mBaseHandler = nullptr;
+      }
+   }
+   mAttrs.clear();
+}
 
-               out.WriteAttr(Lookup(id), val);
-            }
-            break;
+void BinaryProjectReader::StartTag(const wxString & name)
+{
+   FlushTag();
+   mTag = name;
+   mPendingTag = true;
+}
 
-            case FT_LongLong:
-            {
-               long long val;
+void BinaryProjectReader::EndTag(const wxString & name)
+{
+   FlushTag();
+   if (mHandlers.empty())
+      return;
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+   if (XMLTagHandler *const handler = mHandlers.back())
+      handler->HandleXMLEndTag(name.wx_str());
+   mHandlers.pop_back();
+}
 
-               out.WriteAttr(Lookup(id), val);
-            }
-            break;
+void BinaryProjectReader::WriteAttr(const wxString & name, const wxString & value)
+{
+   mAttrs.push_back(name);
+   mAttrs.push_back(value);
+}
 
-            case FT_SizeT:
-            {
-               size_t val;
+void BinaryProjectReader::WriteAttr(const wxString & name, const wxChar *value)
+{
+   WriteAttr(name, wxString(value));
+}
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+// Format numbers as XMLWriter does, so the handlers see the same strings
 
-               out.WriteAttr(Lookup(id), val);
-            }
-            break;
+void BinaryProjectReader::WriteAttr(const wxString & name, int value)
+{
+   WriteAttr(name, wxString::Format(wxT("%d"), value));
+}
 
-            case FT_Data:
-            {
-               int len;
+void BinaryProjectReader::WriteAttr(const wxString & name, bool value)
+{
+   WriteAttr(name, wxString::Format(wxT("%d"), (int) value));
+}
 
-               in.Read(&len, sizeof(len));
-               WxChars val{ len / sizeof(wxChar) };
-               in.Read(val.get(), len);
+void BinaryProjectReader::WriteAttr(const wxString & name, long value)
+{
+   WriteAttr(name, wxString::Format(wxT("%ld"), value));
+}
 
-               out.WriteData(wxString(val.get(), len / sizeof(wxChar)));
-            }
-            break;
+void BinaryProjectReader::WriteAttr(const wxString & name, long long value)
+{
+   WriteAttr(name, wxString::Format(wxT("%lld"), value));
+}
 
-            case FT_Raw:
-            {
-               int len;
+void BinaryProjectReader::WriteAttr(const wxString & name, size_t value)
+{
+   WriteAttr(name, wxString::Format(wxT("%lld"), (long long) value));
+}
 
-               in.Read(&len, sizeof(len));
-               WxChars val{ len / sizeof(wxChar) };
-               in.Read(val.get(), len);
+void BinaryProjectReader::WriteAttr(
+   const wxString & name, float value, int digits)
+{
+   WriteAttr(name, Internat::ToString(value, digits));
+}
 
-               out.Write(wxString(val.get(), len / sizeof(wxChar)));
-            }
-            break;
+void BinaryProjectReader::WriteAttr(
+   const wxString & name, double value, int digits)
+{
+   WriteAttr(name, Internat::ToString(value, digits));
+}
 
-            default:
-               wxASSERT(true);
-            break;
-         }
-      } }
-      catch( const Error & )
-      {
-         // return before committing, so we do not overwrite the recovery file!
-         return false;
-      }
+void BinaryProjectReader::WriteData(const wxString & value)
+{
+   FlushTag();
+   if (mHandlers.empty())
+      return;
 
-      out.Commit();
+   if (XMLTagHandler *const handler = mHandlers.back())
+      handler->HandleXMLContent(value);
+}
 
-      return true;
-   } );
+void BinaryProjectReader::Write(const wxString &)
+{
+   // Only the XML declaration and doctype are written raw; there is
+   // nothing in them for the handlers
 }
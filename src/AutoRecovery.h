@@ -15,11 +15,14 @@
 
 #include <wx/mstream.h> // member variables
 
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "audacity/Types.h"
 
 class wxFFile;
 class AudacityProject;
+class XMLFileWriter;
 
 //
 // XML Handler for a <recordingrecovery> tag
@@ -51,6 +54,10 @@ private:
 // Should be plain ASCII
 #define AutoSaveIdent "<?xml autosave>"
 
+// Begins like XML, so that opening recognizes a project file; followed by
+// one byte giving the size of wxChar, which the encoding depends on
+#define BinaryProjectIdent "<?xml binary>"
+
 using NameMap = std::unordered_map<wxString, short>;
 using IdMap = std::unordered_map<short, wxString>;
 
@@ -84,9 +91,20 @@ public:
    // Non-override functions
    void WriteSubTree(const AutoSaveFile & value);
 
+   /// The bytes that WriteSubTree would append for this
+   std::string EncodeSubTree() const;
+   /// Append bytes from EncodeSubTree, of this or another AutoSaveFile
+   void AppendEncoded(const std::string & bytes);
+
    bool Write(wxFFile & file) const;
    bool Append(wxFFile & file) const;
 
+   /// Write as a binary project file.  Might throw.
+   void WriteProject(XMLFileWriter & file) const;
+
+   /// Whether to save projects in this encoding rather than as XML
+   static bool GetBinaryProjectFiles();
+
    bool IsEmpty() const;
 
    bool Decode(const FilePath & fileName);
@@ -102,5 +120,46 @@ private:
    size_t mAllocSize;
 };
 
+/// Reads a project file written by AutoSaveFile::WriteProject.  The fields
+/// are passed straight to the tag handlers, with no XML text to parse.
+class AUDACITY_DLL_API BinaryProjectReader final : private XMLWriter
+{
+public:
+   static bool IsBinaryProject(const FilePath & fileName);
+
+   bool Parse(XMLTagHandler *baseHandler, const FilePath & fileName);
+
+   const TranslatableString &GetErrorStr() const { return mErrorStr; }
+
+private:
+   // The decoder writes to this, as to an XMLWriter
+   void StartTag(const wxString & name) override;
+   void EndTag(const wxString & name) override;
+
+   void WriteAttr(const wxString & name, const wxString &value) override;
+   void WriteAttr(const wxString & name, const wxChar *value) override;
+
+   void WriteAttr(const wxString & name, int value) override;
+   void WriteAttr(const wxString & name, bool value) override;
+   void WriteAttr(const wxString & name, long value) override;
+   void WriteAttr(const wxString & name, long long value) override;
+   void WriteAttr(const wxString & name, size_t value) override;
+   void WriteAttr(const wxString & name, float value, int digits = -1) override;
+   void WriteAttr(const wxString & name, double value, int digits = -1) override;
+
+   void WriteData(const wxString & value) override;
+   void Write(const wxString & data) override;
+
+   // Pass the pending start tag and its attributes to a handler
+   void FlushTag();
+
+   XMLTagHandler *mBaseHandler{};
+   std::vector<XMLTagHandler*> mHandlers;
+   wxString mTag;
+   wxArrayString mAttrs;
+   bool mPendingTag{ false };
+   TranslatableString mErrorStr;
+};
+
 
 #endif
@@ -26,7 +26,9 @@ processing.  See also MacrosWindow and ApplyMacroDialog.
 
 #include "Project.h"
 #include "ProjectAudioManager.h"
+#include "ProjectFileManager.h"
 #include "ProjectHistory.h"
+#include "ProjectManager.h"
 #include "ProjectSettings.h"
 #include "ProjectWindow.h"
 #include "commands/CommandManager.h"
@@ -1008,6 +1010,30 @@ bool MacroCommands::ApplyMacro(
    return true;
 }
 
+size_t MacroCommands::ApplyMacroToFiles( const MacroCommandsCatalog &catalog,
+   const wxArrayString & files, const FileProgress &progress )
+{
+   AudacityProject *project = &mProject;
+   size_t i = 0;
+   for (; i < files.size(); i++) {
+      if (progress && !progress(i))
+         break;
+
+      auto success = GuardedCall< bool >( [&] {
+         ProjectFileManager::Get( *project ).Import(files[i]);
+         ProjectWindow::Get( *project ).ZoomAfterImport(nullptr);
+         SelectUtilities::DoSelectAll(*project);
+         return ApplyMacro(catalog) && !mAbort;
+      } );
+
+      if (!success)
+         break;
+
+      ProjectManager::Get( *project ).ResetProjectToEmpty();
+   }
+   return i;
+}
+
 // AbortBatch() allows a premature terminatation of a batch.
 void MacroCommands::AbortBatch()
 {
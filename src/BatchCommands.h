@@ -12,6 +12,7 @@
 #ifndef __AUDACITY_BATCH_COMMANDS_DIALOG__
 #define __AUDACITY_BATCH_COMMANDS_DIALOG__
 
+#include <functional>
 #include <wx/defs.h>
 
 #include "export/Export.h"
@@ -63,6 +64,14 @@ class MacroCommands final {
  public:
    bool ApplyMacro( const MacroCommandsCatalog &catalog,
       const wxString & filename = {});
+   // Import each file into the (empty) project in turn, apply the macro
+   // already read by ReadMacro() to all of it, and reset the project.
+   // The optional callback is told the index of each file before it is
+   // processed, and may return false to stop.
+   // Returns the number of files successfully processed.
+   using FileProgress = std::function< bool( size_t ) >;
+   size_t ApplyMacroToFiles( const MacroCommandsCatalog &catalog,
+      const wxArrayString & files, const FileProgress &progress = {} );
    static bool HandleTextualCommand( CommandManager &commandManager,
       const CommandID & Str,
       const CommandContext & context, CommandFlag flags, bool alwaysEnabled);
@@ -425,33 +425,21 @@ void ApplyMacroDialog::OnApplyToFiles(wxCommandEvent & WXUNUSED(event))
    Hide();
 
    mMacroCommands.ReadMacro(name);
-   for (i = 0; i < (int)files.size(); i++) {
-      wxWindowDisabler wd(&activityWin);
-      if (i > 0) {
-         //Clear the arrow in previous item.
-         fileList->SetItemImage(i - 1, 0, 0);
-      }
-      fileList->SetItemImage(i, 1, 1);
-      fileList->EnsureVisible(i);
-
-      auto success = GuardedCall< bool >( [&] {
-         ProjectFileManager::Get( *project ).Import(files[i]);
-         ProjectWindow::Get( *project ).ZoomAfterImport(nullptr);
-         SelectUtilities::DoSelectAll(*project);
-         if (!mMacroCommands.ApplyMacro(mCatalog))
-            return false;
-
+   Optional<wxWindowDisabler> wd;
+   mMacroCommands.ApplyMacroToFiles( mCatalog, files, [&]( size_t ii ) {
+      wd.reset();
+      if (ii > 0) {
          if (!activityWin.IsShown() || mAbort)
             return false;
-
-         return true;
-      } );
-
-      if (!success)
-         break;
-      
-      ProjectManager::Get( *project ).ResetProjectToEmpty();
-   }
+         //Clear the arrow in previous item.
+         fileList->SetItemImage(ii - 1, 0, 0);
+      }
+      fileList->SetItemImage(ii, 1, 1);
+      fileList->EnsureVisible(ii);
+      wd.emplace(&activityWin);
+      return true;
+   } );
+   wd.reset();
 
    Show();
    Raise();
@@ -18,6 +18,12 @@ of the BlockFile system.
 #include "Audacity.h"
 #include "Benchmark.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <vector>
+
 #include <wx/app.h>
 #include <wx/log.h>
 #include <wx/textctrl.h>
@@ -25,7 +31,9 @@ of the BlockFile system.
 #include <wx/checkbox.h>
 #include <wx/choice.h>
 #include <wx/dialog.h>
+#include <wx/ffile.h>
 #include <wx/filedlg.h>
+#include <wx/textfile.h>
 #include <wx/sizer.h>
 #include <wx/stattext.h>
 #include <wx/timer.h>
@@ -34,7 +42,9 @@ of the BlockFile system.
 #include <wx/valtext.h>
 #include <wx/intl.h>
 
+#include "CacheBudget.h"
 #include "DirManager.h"
+#include "Mix.h"
 #include "ShuttleGui.h"
 #include "Project.h"
 #include "WaveClip.h"
@@ -42,6 +52,8 @@ of the BlockFile system.
 #include "Sequence.h"
 #include "Prefs.h"
 #include "ProjectSettings.h"
+#include "RingBuffer.h"
+#include "UndoManager.h"
 #include "ViewInfo.h"
 
 #include "FileNames.h"
@@ -576,3 +588,344 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    Printf( XO("Benchmark completed successfully.\n") );
    HoldPrint(false);
 }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Durations of the repetitions of one operation, in microseconds
+using Durations = std::vector<double>;
+
+template< typename Operation >
+void TimeOnce( Durations &durations, const Operation &operation )
+{
+   const auto start = Clock::now();
+   operation();
+   const auto stop = Clock::now();
+   durations.push_back(
+      std::chrono::duration<double, std::micro>( stop - start ).count() );
+}
+
+// Nearest-rank percentile of sorted durations
+double Percentile( const Durations &sorted, double percent )
+{
+   const auto rank = static_cast<size_t>(
+      std::ceil( percent / 100.0 * sorted.size() ) );
+   return sorted[ std::max<size_t>( rank, 1 ) - 1 ];
+}
+
+// One JSON object for a scenario; bytes is how much data all the
+// repetitions together processed, if throughput is meaningful
+wxString ScenarioJSON(
+   const wxString &name, Durations durations, double bytes = 0 )
+{
+   if (durations.empty())
+      return wxString::Format( wxT("{ \"name\": \"%s\", \"count\": 0 }"),
+         name );
+
+   std::sort( durations.begin(), durations.end() );
+   double total = 0;
+   for (auto duration : durations)
+      total += duration;
+
+   auto result = wxString::Format( wxT(
+      "{ \"name\": \"%s\", \"count\": %lu, \"total_us\": %.1f, "
+      "\"mean_us\": %.3f, \"min_us\": %.3f, \"p50_us\": %.3f, "
+      "\"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f"),
+      name, (unsigned long)durations.size(), total,
+      total / durations.size(), durations.front(),
+      Percentile( durations, 50 ), Percentile( durations, 90 ),
+      Percentile( durations, 99 ), durations.back() );
+   if (bytes > 0 && total > 0)
+      result += wxString::Format( wxT(", \"mb_per_s\": %.3f"),
+         bytes / 1048576.0 / ( total / 1e6 ) );
+   result += wxT(" }");
+   return result;
+}
+
+}
+
+bool RunHeadlessBenchmark( AudacityProject &project,
+   const wxString &outputPath, const wxString &limitsPath )
+{
+   // The defaults of the dialog, with the block size as set from the
+   // command line
+   const size_t dataSize = 32;
+   const int trials = 100;
+   const int undoTrials = 100;
+   const long randSeed = 234657;
+   const size_t mixBufferSize = 4096;
+   const size_t copyBufferSize = 65536;
+   const int copyTrials = 1000;
+   const double mixRate = 44100;
+
+   bool editClipCanMove = true;
+   gPrefs->Read(wxT("/GUI/EditClipCanMove"), &editClipCanMove);
+   gPrefs->Write(wxT("/GUI/EditClipCanMove"), false);
+   gPrefs->Flush();
+   const auto cleanup = finally( [&] {
+      gPrefs->Write(wxT("/GUI/EditClipCanMove"), editClipCanMove);
+      gPrefs->Flush();
+   } );
+
+   ZoomInfo zoomInfo(0.0, ZoomInfo::GetDefaultZoom());
+   auto dd = DirManager::Create();
+   TrackFactory factory{ ProjectSettings::Get( project ), dd, &zoomInfo };
+   const auto t = factory.NewWaveTrack(int16Sample);
+   t->SetRate(1);
+
+   srand(randSeed);
+
+   // Write the test data a disk block at a time, as the dialog lays it out
+   // in constant chunks
+   const size_t blockSamples = std::max<size_t>( 1,
+      Sequence::GetMaxDiskBlockSize() / sizeof(short) );
+   size_t chunkSize = 200 + (rand() % 100);
+   size_t nChunks = (dataSize * 1048576) / (chunkSize*sizeof(short));
+   while(nChunks < 20 || chunkSize > blockSamples / 2) {
+      chunkSize = std::max( size_t(1), (chunkSize / 2) + (rand() % 100) );
+      nChunks = (dataSize * 1048576) / (chunkSize*sizeof(short));
+   }
+   const size_t totalSamples = nChunks * chunkSize;
+
+   using Shorts = ArrayOf < short > ;
+   Shorts small1{ nChunks };
+   Shorts block{ blockSamples };
+   for (size_t i = 0; i < nChunks; i++)
+      small1[i] = short(rand());
+
+   std::vector<wxString> results;
+   std::map<wxString, double> medians;
+   const auto addResult = [&]( const wxString &name,
+      Durations durations, double bytes ){
+      results.push_back( ScenarioJSON( name, durations, bytes ) );
+      if (!durations.empty()) {
+         std::sort( durations.begin(), durations.end() );
+         medians[ name ] = Percentile( durations, 50 );
+      }
+   };
+   bool ok = true;
+   try {
+      Durations writes;
+      for (size_t pos = 0; pos < totalSamples; pos += blockSamples) {
+         const auto len = std::min( blockSamples, totalSamples - pos );
+         for (size_t b = 0; b < len; b++)
+            block[b] = small1[(pos + b) / chunkSize];
+         TimeOnce( writes, [&]{
+            t->Append((samplePtr)block.get(), int16Sample, len);
+            if (pos + len == totalSamples)
+               t->Flush();
+         } );
+      }
+      addResult( wxT("block-write"), writes,
+         totalSamples * sizeof(short) );
+
+      Durations reads;
+      for (size_t pos = 0; pos < totalSamples; pos += blockSamples) {
+         const auto len = std::min( blockSamples, totalSamples - pos );
+         TimeOnce( reads, [&]{
+            t->Get((samplePtr)block.get(), int16Sample, pos, len);
+         } );
+      }
+      addResult( wxT("block-read"), reads,
+         totalSamples * sizeof(short) );
+
+      // The random cut and paste of the dialog, checked afterward
+      Durations edits;
+      for (int z = 0; z < trials; z++) {
+         const size_t x0 = rand() % nChunks;
+         const size_t xlen = 1 + (rand() % (nChunks - x0));
+         const size_t y0 = rand() % (nChunks - xlen + 1);
+         TimeOnce( edits, [&]{
+            auto tmp = t->Cut(
+               double (x0 * chunkSize), double ((x0 + xlen) * chunkSize));
+            t->Paste((double)(y0 * chunkSize), tmp.get());
+         } );
+
+         auto first = &small1[0];
+         if (x0 + xlen < nChunks)
+            std::rotate( first + x0, first + x0 + xlen, first + nChunks );
+         std::rotate( first + y0, first + nChunks - xlen, first + nChunks );
+      }
+      addResult( wxT("edit"), edits, 0 );
+
+      size_t bad = 0;
+      for (size_t i = 0; i < nChunks; i++) {
+         t->Get((samplePtr)block.get(), int16Sample, i * chunkSize, chunkSize);
+         for (size_t b = 0; b < chunkSize; b++)
+            if (block[b] != small1[i]) {
+               bad++;
+               break;
+            }
+      }
+      if (bad) {
+         wxPrintf(wxT("Errors in %lu/%lu chunks\n"),
+            (unsigned long)bad, (unsigned long)nChunks);
+         ok = false;
+      }
+
+      // Delete single chunks from a copy, keeping the track for later
+      {
+         const auto copy = std::static_pointer_cast<WaveTrack>( t->Duplicate() );
+         Durations deletes;
+         const auto deleteTrials = std::min<size_t>( trials, nChunks / 2 );
+         for (size_t z = 0; z < deleteTrials; z++) {
+            const size_t x0 = rand() % (nChunks - z - 1);
+            TimeOnce( deletes, [&]{
+               copy->Clear(
+                  double (x0 * chunkSize), double ((x0 + 1) * chunkSize));
+            } );
+         }
+         addResult( wxT("delete"), deletes, 0 );
+      }
+
+      // Conversions between each pair of formats, with the dither chosen
+      // for export
+      {
+         static const sampleFormat formats[] =
+            { int16Sample, int24Sample, floatSample };
+         static const wxChar *const formatNames[] =
+            { wxT("int16"), wxT("int24"), wxT("float") };
+         Floats noise{ copyBufferSize };
+         for (size_t i = 0; i < copyBufferSize; i++)
+            noise[i] = rand() / (float)RAND_MAX - 0.5f;
+         for (size_t from = 0; from < 3; from++) {
+            SampleBuffer source( copyBufferSize, formats[from] );
+            CopySamples( (samplePtr)noise.get(), floatSample,
+               source.ptr(), formats[from], copyBufferSize );
+            for (size_t to = 0; to < 3; to++) {
+               if (from == to)
+                  continue;
+               SampleBuffer dest( copyBufferSize, formats[to] );
+               Durations copies;
+               for (int z = 0; z < copyTrials; z++)
+                  TimeOnce( copies, [&]{
+                     CopySamples( source.ptr(), formats[from],
+                        dest.ptr(), formats[to], copyBufferSize );
+                  } );
+               addResult( wxString::Format( wxT("copy-samples-%s-%s"),
+                     formatNames[from], formatNames[to] ),
+                  copies, (double)copyTrials * copyBufferSize *
+                     SAMPLE_SIZE( formats[from] ) );
+            }
+         }
+      }
+
+      // Put and get through a ring buffer on one thread
+      {
+         RingBuffer ringBuffer( floatSample, 4 * mixBufferSize );
+         Floats chunk{ mixBufferSize };
+         Durations transfers;
+         for (int z = 0; z < copyTrials; z++)
+            TimeOnce( transfers, [&]{
+               ringBuffer.Put( (samplePtr)chunk.get(), floatSample,
+                  mixBufferSize );
+               ringBuffer.Get( (samplePtr)chunk.get(), floatSample,
+                  mixBufferSize );
+            } );
+         addResult( wxT("ring-buffer"), transfers,
+            (double)copyTrials * mixBufferSize * sizeof(float) );
+      }
+
+      // Mix a stereo pair of copies of the edited track with it to float
+      t->SetRate(mixRate);
+      WaveTrackConstArray mixTracks{ t };
+      for (int i = 0; i < 3; i++)
+         mixTracks.push_back(
+            std::static_pointer_cast<const WaveTrack>( t->Duplicate() ) );
+      Durations mixes;
+      {
+         Mixer mixer( mixTracks, true, Mixer::WarpOptions{ nullptr },
+            0.0, t->GetEndTime(), 2, mixBufferSize, true, mixRate,
+            floatSample );
+         for (bool more = true; more;)
+            TimeOnce( mixes, [&]{ more = mixer.Process(mixBufferSize) > 0; } );
+      }
+      addResult( wxT("mixdown"), mixes,
+         mixTracks.size() * totalSamples * sizeof(float) );
+
+      // Push undo states of a list holding the track, changing a few
+      // samples between the pushes
+      auto undoTracks = TrackList::Create( nullptr );
+      undoTracks->Add( t );
+      auto &undoManager = UndoManager::Get( project );
+      Durations pushes;
+      for (int z = 0; z < undoTrials; z++) {
+         const auto pos = sampleCount( rand() % (totalSamples - chunkSize) );
+         t->Set((samplePtr)block.get(), int16Sample, pos, chunkSize);
+         TimeOnce( pushes, [&]{
+            undoManager.PushState( undoTracks.get(), SelectedRegion{}, {},
+               XO("Benchmark"), XO("Benchmark"), UndoPush::MINIMAL );
+         } );
+      }
+      addResult( wxT("undo-push"), pushes, 0 );
+   }
+   catch (const AudacityException&) {
+      ok = false;
+   }
+   dd.reset();
+
+   // Each line of the limits file is a scenario name and the most
+   // microseconds allowed for its median; a scenario over its limit fails
+   // the run
+   std::vector<wxString> failures;
+   if (!limitsPath.empty()) {
+      wxTextFile limits( limitsPath );
+      if (!limits.Open()) {
+         wxPrintf(_("Could not read benchmark limits from %s\n"), limitsPath);
+         ok = false;
+      }
+      else for (size_t i = 0; i < limits.GetLineCount(); ++i) {
+         auto line = limits[i];
+         line.Trim(true).Trim(false);
+         if (line.empty() || line.StartsWith(wxT("#")))
+            continue;
+         wxString limitString;
+         const auto name = line.BeforeFirst(wxT(' '), &limitString);
+         double limit;
+         if (!limitString.Trim(false).ToDouble(&limit))
+            continue;
+         const auto found = medians.find( name );
+         if (found != medians.end() && found->second > limit) {
+            wxPrintf(wxT("%s: median %.3f us exceeds the limit of %.3f us\n"),
+               name, found->second, limit);
+            failures.push_back( name );
+            ok = false;
+         }
+      }
+   }
+
+   wxString json = wxString::Format( wxT(
+      "{\n  \"block_size\": %lu,\n  \"data_mb\": %lu,\n  \"scenarios\": [\n"),
+      (unsigned long)Sequence::GetMaxDiskBlockSize(), (unsigned long)dataSize );
+   for (size_t i = 0; i < results.size(); i++)
+      json += wxT("    ") + results[i] +
+         (i + 1 < results.size() ? wxT(",\n") : wxT("\n"));
+   json += wxT("  ],\n  \"caches\": [\n");
+   for (unsigned kind = 0; kind < CacheBudget::NKinds; ++kind) {
+      const auto stats =
+         CacheBudget::Get().GetStatistics( CacheBudget::Kind( kind ) );
+      json += wxString::Format( wxT(
+         "    { \"name\": \"%s\", \"bytes\": %llu, \"peak_bytes\": %llu, "
+         "\"budget\": %llu, \"evictions\": %llu, \"refusals\": %llu }%s\n"),
+         CacheBudget::GetName( CacheBudget::Kind( kind ) ),
+         (unsigned long long)stats.bytes,
+         (unsigned long long)stats.peakBytes,
+         (unsigned long long)stats.budget,
+         stats.evictions, stats.refusals,
+         kind + 1 < CacheBudget::NKinds ? wxT(",") : wxT("") );
+   }
+   json += wxT("  ],\n  \"limit_failures\": [");
+   for (size_t i = 0; i < failures.size(); i++)
+      json += (i ? wxT(", \"") : wxT(" \"")) + failures[i] + wxT("\"");
+   json += wxString::Format( wxT(" ],\n  \"passed\": %s\n}\n"),
+      ok ? wxT("true") : wxT("false") );
+
+   wxFFile file( outputPath, wxT("wb") );
+   if (!file.IsOpened() || !file.Write( json, wxConvUTF8 )) {
+      wxPrintf(_("Could not write benchmark results to %s\n"), outputPath);
+      return false;
+   }
+
+   return ok;
+}
@@ -11,8 +11,16 @@
 #ifndef __AUDACITY_BENCHMARK__
 #define __AUDACITY_BENCHMARK__
 
+class AudacityProject;
 class ProjectSettings;
+class wxString;
 
 void RunBenchmark( wxWindow *parent, const ProjectSettings &settings );
 
+/// Run the benchmark scenarios without any window, writing the timings with
+/// their percentiles as JSON to the file; returns false if anything failed,
+/// including a median over its limit in the optional limits file
+bool RunHeadlessBenchmark( AudacityProject &project,
+   const wxString &outputPath, const wxString &limitsPath );
+
 #endif // define __AUDACITY_BENCHMARK__
@@ -44,6 +44,8 @@ out.
 
 #include <float.h>
 #include <cmath>
+#include <list>
+#include <mutex>
 
 #include <wx/utils.h>
 #include <wx/filefn.h>
@@ -51,6 +53,7 @@ out.
 #include <wx/log.h>
 
 #include "sndfile.h"
+#include "BlockSampleCache.h"
 #include "FileException.h"
 #include "FileFormats.h"
 
@@ -82,9 +85,10 @@ SummaryInfo::SummaryInfo(size_t samples)
    offset64K = headerTagLen;
    offset256 = offset64K + (frames64K * bytesPerFrame);
    totalSummaryBytes = offset256 + (frames256 * bytesPerFrame);
+
+   frames4K = frames256 / Ratio4K;
 }
 
-ArrayOf<char> BlockFile::fullSummary;
 
 /// Initializes the base BlockFile data.  The block is initially
 /// unlocked and its reference count is 1.
@@ -110,6 +114,8 @@ unsigned long BlockFile::gBlockFileDestructionCount { 0 };
 
 BlockFile::~BlockFile()
 {
+   BlockSampleCache::Get().Forget(this);
+
    if (!IsLocked() && mFileName.HasName())
       // PRL: what should be done if this fails?
       wxRemoveFile(mFileName.GetFullPath());
@@ -180,8 +186,8 @@ bool BlockFile::IsLocked()
 /// This method also has the side effect of setting the mMin, mMax,
 /// and mRMS members of this class.
 ///
-/// You must not DELETE the returned buffer; it is static to this
-/// method.
+/// The returned buffer is owned by cleanup, so that block files may be
+/// made on several threads at once.
 ///
 /// @param buffer A buffer containing the sample data to be analyzed
 /// @param len    The length of the sample data
@@ -189,15 +195,13 @@ bool BlockFile::IsLocked()
 void *BlockFile::CalcSummary(samplePtr buffer, size_t len,
                              sampleFormat format, ArrayOf<char> &cleanup)
 {
-   // Caller has nothing to deallocate
-   cleanup.reset();
-
-   fullSummary.reinit(mSummaryInfo.totalSummaryBytes);
+   cleanup.reinit(mSummaryInfo.totalSummaryBytes);
+   char *fullSummary = cleanup.get();
 
-   memcpy(fullSummary.get(), headerTag, headerTagLen);
+   memcpy(fullSummary, headerTag, headerTagLen);
 
-   float *summary64K = (float *)(fullSummary.get() + mSummaryInfo.offset64K);
-   float *summary256 = (float *)(fullSummary.get() + mSummaryInfo.offset256);
+   float *summary64K = (float *)(fullSummary + mSummaryInfo.offset64K);
+   float *summary256 = (float *)(fullSummary + mSummaryInfo.offset256);
 
    Floats fbuffer{ len };
    CopySamples(buffer, format,
@@ -205,7 +209,7 @@ void *BlockFile::CalcSummary(samplePtr buffer, size_t len,
 
    CalcSummaryFromBuffer(fbuffer.get(), len, summary256, summary64K);
 
-   return fullSummary.get();
+   return fullSummary;
 }
 
 void BlockFile::CalcSummaryFromBuffer(const float *fbuffer, size_t len,
@@ -452,7 +456,7 @@ bool BlockFile::Read256(float *buffer,
 /// Retrieves a portion of the 64K summary buffer from this BlockFile.  This
 /// data provides information about the minimum value, the maximum
 /// value, and the maximum RMS value for every group of 64K samples in the
-/// file.
+/// file.  The whole level is read once, then held in memory.
 /// Fill with zeroes and return false if data are unavailable for any reason.
 ///
 /// @param *buffer The area where the summary information will be
@@ -464,28 +468,128 @@ bool BlockFile::Read64K(float *buffer,
 {
    wxASSERT(start >= 0);
 
-   ArrayOf< char > summary;
-   // In case of failure, summary is filled with zeroes
-   auto result = this->ReadSummary(summary);
-
    start = std::min( start, mSummaryInfo.frames64K );
    len = std::min( len, mSummaryInfo.frames64K - start );
 
-   CopySamples(summary.get() + mSummaryInfo.offset64K +
-               (start * mSummaryInfo.bytesPerFrame),
-               mSummaryInfo.format,
-               (samplePtr)buffer, floatSample, len * mSummaryInfo.fields);
+   ODLocker locker{ &mSummary4KMutex };
+   if (!mSummary64K) {
+      ArrayOf< char > summary;
+      // In case of failure, summary is filled with zeroes
+      auto result = this->ReadSummary(summary);
+
+      // The level is small, so keep all of it, unless it may change yet
+      Floats summary64K{ 3 * mSummaryInfo.frames64K };
+      const auto all = mSummaryInfo.frames64K;
+      CopySamples(summary.get() + mSummaryInfo.offset64K,
+                  mSummaryInfo.format,
+                  (samplePtr)summary64K.get(), floatSample,
+                  all * mSummaryInfo.fields);
+
+      if (mSummaryInfo.fields == 2) {
+         // No RMS info; make guess
+         for(auto i = all; i--;) {
+            summary64K[3*i+2] =
+               (fabs(summary64K[2*i]) + fabs(summary64K[2*i+1]))/4.0;
+            summary64K[3*i+1] = summary64K[2*i+1];
+            summary64K[3*i] = summary64K[2*i];
+         }
+      }
 
-   if (mSummaryInfo.fields == 2) {
-      // No RMS info; make guess
-      for(auto i = len; i--;) {
-         buffer[3*i+2] = (fabs(buffer[2*i]) + fabs(buffer[2*i+1]))/4.0;
-         buffer[3*i+1] = buffer[2*i+1];
-         buffer[3*i] = buffer[2*i];
+      std::copy(summary64K.get() + 3 * start,
+         summary64K.get() + 3 * (start + len), buffer);
+      if (result && IsSummaryAvailable())
+         mSummary64K = std::shared_ptr<float>{
+            summary64K.release(), std::default_delete<float[]>{} };
+      return result;
+   }
+
+   std::copy(mSummary64K.get() + 3 * start,
+      mSummary64K.get() + 3 * (start + len), buffer);
+   return true;
+}
+
+void BlockFile::PrepareSummaries()
+{
+   // Reading nothing still fills what the reads keep in memory
+   float unused[3];
+   Read4K(unused, 0, 0);
+   Read64K(unused, 0, 0);
+}
+
+void BlockFile::ShareSummaries(BlockFile &copy)
+{
+   if (&copy == this ||
+       copy.mLen != mLen ||
+       copy.mSummaryInfo.frames4K != mSummaryInfo.frames4K ||
+       copy.mSummaryInfo.frames64K != mSummaryInfo.frames64K)
+      return;
+
+   std::shared_ptr<float> summary4K, summary64K;
+   {
+      ODLocker locker{ &mSummary4KMutex };
+      summary4K = mSummary4K;
+      summary64K = mSummary64K;
+   }
+
+   ODLocker locker{ &copy.mSummary4KMutex };
+   if (!copy.mSummary4K)
+      copy.mSummary4K = std::move(summary4K);
+   if (!copy.mSummary64K)
+      copy.mSummary64K = std::move(summary64K);
+}
+
+/// Retrieves a portion of the 4K summary, which is not stored in the file,
+/// but aggregated from the 256 summary the first time it is needed.  Later
+/// reads need no file access at all.
+/// Fill with zeroes and return false if data are unavailable for any reason.
+///
+/// @param *buffer The area where the summary information will be
+///                written.  It must be at least len*3 long.
+/// @param start   The offset in 4K-sample increments
+/// @param len     The number of 4K-sample summary frames to read
+bool BlockFile::Read4K(float *buffer,
+                       size_t start, size_t len)
+{
+   const auto frames4K = mSummaryInfo.frames4K;
+   start = std::min( start, frames4K );
+   len = std::min( len, frames4K - start );
+
+   ODLocker locker{ &mSummary4KMutex };
+   if (!mSummary4K) {
+      Floats summary256{ 3 * mSummaryInfo.frames256 };
+      if (!IsSummaryAvailable() ||
+          !this->Read256(summary256.get(), 0, mSummaryInfo.frames256)) {
+         // Don't remember a failure; the summary may become available later
+         std::fill(buffer, buffer + 3 * len, 0.0f);
+         return false;
+      }
+
+      // Aggregate only the 256 frames that cover samples
+      const auto used256 = (mLen + 255) / 256;
+      Floats summary4K{ 3 * frames4K };
+      for (size_t i = 0; i < frames4K; ++i) {
+         const auto first = i * SummaryInfo::Ratio4K;
+         const auto last = std::min( used256, first + SummaryInfo::Ratio4K );
+         float min = FLT_MAX, max = -FLT_MAX;
+         double sumsq = 0.0;
+         for (auto j = first; j < last; ++j) {
+            min = std::min( min, summary256[3 * j] );
+            max = std::max( max, summary256[3 * j + 1] );
+            const double rms = summary256[3 * j + 2];
+            sumsq += rms * rms;
+         }
+         summary4K[3 * i] = min;
+         summary4K[3 * i + 1] = max;
+         summary4K[3 * i + 2] =
+            last > first ? (float)sqrt(sumsq / (last - first)) : 0.0f;
       }
+      mSummary4K = std::shared_ptr<float>{
+         summary4K.release(), std::default_delete<float[]>{} };
    }
 
-   return result;
+   std::copy(mSummary4K.get() + 3 * start, mSummary4K.get() + 3 * (start + len),
+      buffer);
+   return true;
 }
 
 namespace {
@@ -505,6 +609,114 @@ auto BlockFile::SetMissingAliasFileFound( MissingAliasFileFoundHook hook )
    return result;
 }
 
+namespace {
+
+/// An aliased file opened for reading, shared by all alias block files
+/// that read it; the mutex serializes seeking and reading the handle
+struct AliasedFileHandle
+{
+   wxString path;
+   time_t modified{};
+   wxFile file;
+   SFFile sf;
+   SF_INFO info{};
+   std::mutex mutex;
+};
+
+/// A bounded, least-recently-used set of open aliased files, so that
+/// reading successive blocks of a long alias-imported file does not reopen
+/// it each time
+class AliasedFilePool
+{
+public:
+   static AliasedFilePool &Get()
+   {
+      static AliasedFilePool instance;
+      return instance;
+   }
+
+   // Returns null if the file does not exist or libsndfile can't open it
+   std::shared_ptr<AliasedFileHandle> Find( const wxString &path )
+   {
+      // The file may since have been replaced, or gone missing
+      const auto modified = wxFileModificationTime( path );
+      if (modified == (time_t)-1) {
+         Forget( path );
+         return {};
+      }
+
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         for (auto iter = mLRU.begin(); iter != mLRU.end(); ++iter) {
+            if ((*iter)->path == path) {
+               if ((*iter)->modified != modified) {
+                  // Readers in other threads may still hold the old one
+                  mLRU.erase( iter );
+                  break;
+               }
+               // Move to the front
+               mLRU.splice( mLRU.begin(), mLRU, iter );
+               return mLRU.front();
+            }
+         }
+      }
+
+      // Open without holding the pool's lock
+      auto pHandle = std::make_shared<AliasedFileHandle>();
+      pHandle->path = path;
+      pHandle->modified = modified;
+      if (!pHandle->file.Open( path ))
+         return {};
+      // Even though there is an sf_open() that takes a filename, use the one
+      // that takes a file descriptor since wxWidgets can open a file with a
+      // Unicode name and libsndfile can't (under Windows).
+      pHandle->sf.reset( SFCall<SNDFILE*>(
+         sf_open_fd, pHandle->file.fd(), SFM_READ, &pHandle->info, FALSE ) );
+      if (!pHandle->sf)
+         // Don't remember the failure
+         return {};
+
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mLRU.push_front( pHandle );
+      if (mLRU.size() > MaxOpen)
+         mLRU.pop_back();
+      return pHandle;
+   }
+
+   void Forget( const wxString &path )
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mLRU.remove_if(
+         [&]( const std::shared_ptr<AliasedFileHandle> &pHandle ){
+            return pHandle->path == path; } );
+   }
+
+private:
+   // Few enough that the linear search costs nothing next to a read, and
+   // well within the limits on open files
+   enum : size_t { MaxOpen = 16 };
+
+   std::mutex mMutex;
+   std::list< std::shared_ptr<AliasedFileHandle> > mLRU;
+};
+
+// A pooled handle is used only under its own mutex, so its reads need not
+// wait for the lock that serializes all other libsndfile calls
+template<typename R, typename F, typename... Args>
+inline R HandleCall(bool pooled, F fun, Args&&... args)
+{
+   if (pooled)
+      return fun(std::forward<Args>(args)...);
+   return SFCall<R>(fun, std::forward<Args>(args)...);
+}
+
+}
+
+void BlockFile::CloseAliasedFile(const wxString &fullPath)
+{
+   AliasedFilePool::Get().Forget( fullPath );
+}
+
 size_t BlockFile::CommonReadData(
    bool mayThrow,
    const wxFileName &fileName, bool &mSilentLog,
@@ -544,20 +756,35 @@ size_t BlockFile::CommonReadData(
    wxFile f;   // will be closed when it goes out of scope
    SFFile sf;
 
+   // Aliased files are read often, a block at a time, so they stay open in
+   // the pool; libsndfile may use separate handles on separate threads
+   std::shared_ptr<AliasedFileHandle> pHandle;
+   std::unique_lock<std::mutex> handleLock;
+   SNDFILE *pSF = nullptr;
+
    {
       Optional<wxLogNull> silence{};
       if (mSilentLog)
          silence.emplace();
 
       const auto fullPath = fileName.GetFullPath();
-      if (wxFile::Exists(fullPath) && f.Open(fullPath)) {
+      if (pAliasFile && !pLegacyFormat) {
+         pHandle = AliasedFilePool::Get().Find( fullPath );
+         if (pHandle) {
+            handleLock = std::unique_lock<std::mutex>{ pHandle->mutex };
+            info = pHandle->info;
+            pSF = pHandle->sf.get();
+         }
+      }
+      else if (wxFile::Exists(fullPath) && f.Open(fullPath)) {
          // Even though there is an sf_open() that takes a filename, use the one that
          // takes a file descriptor since wxWidgets can open a file with a Unicode name and
          // libsndfile can't (under Windows).
          sf.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &info, FALSE));
+         pSF = sf.get();
       }
 
-      if (!sf) {
+      if (!pSF) {
 
          memset(data, 0, SAMPLE_SIZE(format)*len);
 
@@ -569,12 +796,12 @@ size_t BlockFile::CommonReadData(
          }
       }
    }
-   mSilentLog = !sf;
+   mSilentLog = !pSF;
 
    size_t framesRead = 0;
-   if (sf) {
-      auto seek_result = SFCall<sf_count_t>(
-         sf_seek, sf.get(), ( origin + start ).as_long_long(), SEEK_SET);
+   if (pSF) {
+      auto seek_result = HandleCall<sf_count_t>( !!pHandle,
+         sf_seek, pSF, ( origin + start ).as_long_long(), SEEK_SET);
 
       if (seek_result < 0)
          // error
@@ -589,14 +816,14 @@ size_t BlockFile::CommonReadData(
              sf_subtype_is_integer(info.format)) {
             // If both the src and dest formats are integer formats,
             // read integers directly from the file, comversions not needed
-            framesRead = SFCall<sf_count_t>(
-               sf_readf_short, sf.get(), (short *)data, len);
+            framesRead = HandleCall<sf_count_t>( !!pHandle,
+               sf_readf_short, pSF, (short *)data, len);
          }
          else if (channels == 1 &&
                   format == int24Sample &&
                   sf_subtype_is_integer(info.format)) {
-            framesRead = SFCall<sf_count_t>(
-               sf_readf_int, sf.get(), (int *)data, len);
+            framesRead = HandleCall<sf_count_t>( !!pHandle,
+               sf_readf_int, pSF, (int *)data, len);
 
             // libsndfile gave us the 3 byte sample in the 3 most
             // significant bytes -- we want it in the 3 least
@@ -612,8 +839,8 @@ size_t BlockFile::CommonReadData(
             // read 16-bit data directly.  This is a pretty common
             // case, as most audio files are 16-bit.
             SampleBuffer buffer(len * channels, int16Sample);
-            framesRead = SFCall<sf_count_t>(
-               sf_readf_short, sf.get(), (short *)buffer.ptr(), len);
+            framesRead = HandleCall<sf_count_t>( !!pHandle,
+               sf_readf_short, pSF, (short *)buffer.ptr(), len);
             for (size_t i = 0; i < framesRead; i++)
                ((short *)data)[i] =
                ((short *)buffer.ptr())[(channels * i) + channel];
@@ -623,8 +850,8 @@ size_t BlockFile::CommonReadData(
             // scaling, and pass us normalized data as floats.  We can
             // then convert to whatever format we want.
             SampleBuffer buffer(len * channels, floatSample);
-            framesRead = SFCall<sf_count_t>(
-               sf_readf_float, sf.get(), (float *)buffer.ptr(), len);
+            framesRead = HandleCall<sf_count_t>( !!pHandle,
+               sf_readf_float, pSF, (float *)buffer.ptr(), len);
             auto bufferPtr = (samplePtr)((float *)buffer.ptr() + channel);
             CopySamples(bufferPtr, floatSample,
                         (samplePtr)data, format,
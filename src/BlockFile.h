@@ -34,6 +34,10 @@ class SummaryInfo {
    size_t         frames256;
    int            offset256;
    size_t         totalSummaryBytes;
+
+   // The in-memory level between 256 and 64K, not part of the file format
+   enum : size_t { Ratio4K = 16 };
+   size_t         frames4K;
 };
 
 
@@ -59,6 +63,10 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
    static MissingAliasFileFoundHook
       SetMissingAliasFileFound( MissingAliasFileFoundHook hook );
 
+   // Alias block files keep the audio files they read open, a few at a time;
+   // close any handle on this one, as before renaming it
+   static void CloseAliasedFile( const wxString &fullPath );
+
    // Constructor / Destructor
 
    /// Construct a BlockFile.
@@ -141,6 +149,21 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
    virtual bool Read256(float *buffer, size_t start, size_t len);
    /// Returns the 64K summary data block
    virtual bool Read64K(float *buffer, size_t start, size_t len);
+   /// Returns summary triples for every 4096 samples, derived from the 256
+   /// summary on first use and then held in memory (not written to disk)
+   bool Read4K(float *buffer, size_t start, size_t len);
+   /// Fill the summaries that Read4K and Read64K keep in memory, so that
+   /// drawing reads no file later.  May be called on a worker thread.
+   void PrepareSummaries();
+   /// Give a copy of this block, with the same samples, the summaries held
+   /// in memory, so that blocks copied between projects read them once
+   void ShareSummaries(BlockFile &copy);
+   /// Returns dB power spectra, windowSize / 2 bins each, for frames
+   /// [first, first + nFrames) of windowSize samples, from a spectral summary
+   /// stored with the block.  False if there is none for this window.
+   virtual bool ReadSpectralFrames(size_t windowSize, int windowType,
+      size_t first, size_t nFrames, float *buffer) const
+   { return false; }
 
    /// Returns TRUE if this block references another disk file
    virtual bool IsAlias() const { return false; }
@@ -148,6 +171,10 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
    /// Returns TRUE if this block's complete summary has been computed and is ready (for OD)
    virtual bool IsSummaryAvailable() const {return true;}
 
+   /// Returns TRUE if the summaries hold true RMS values; those of some
+   /// legacy files hold only min and max, and Read256 estimates the RMS
+   bool HasSummaryRMS() const { return mSummaryInfo.fields >= 3; }
+
    /// Returns TRUE if this block's complete data is ready to be accessed by Read()
    virtual bool IsDataAvailable() const {return true;}
 
@@ -161,6 +188,12 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
    using DiskByteCount = unsigned long long;
    virtual DiskByteCount GetSpaceUsage() const = 0;
 
+   /// Do ahead of time any disk access that queries of a block just loaded
+   /// from a project would need.  May be called on a worker thread while
+   /// the project is still being parsed, but never during other use.
+   /// A no-fail operation that does not throw
+   virtual void PrepareLoaded() const { /* nothing to read by default */ }
+
    /// if the on-disk state disappeared, either recover it (if it was
    //summary only), write out a placeholder of silence data (missing
    //.au) or mark the blockfile to deal some other way without spewing
@@ -238,14 +271,19 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
  private:
    int mLockCount;
 
-   static ArrayOf<char> fullSummary;
-
  protected:
    wxFileNameWrapper mFileName;
    size_t mLen;
    SummaryInfo mSummaryInfo;
    float mMin, mMax, mRMS;
    mutable bool mSilentLog;
+
+ private:
+   // Computed by Read4K, and read by Read64K, both guarded by the mutex;
+   // shared with copies, and never modified once made
+   std::shared_ptr<float> mSummary4K;
+   std::shared_ptr<float> mSummary64K;
+   ODLock mSummary4KMutex;
 };
 
 /// A BlockFile that refers to data in an existing file
@@ -0,0 +1,153 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockFileIOStats.cpp
+
+*******************************************************************//**
+
+\class BlockFileIOStats
+\brief Lock free counters of block file reads and writes, to find which
+workloads go to the disk and to size the caches from measurements.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "BlockFileIOStats.h"
+
+#include <wx/sstream.h>
+#include <wx/txtstrm.h>
+
+#include "Internat.h"
+
+BlockFileIOStats &BlockFileIOStats::Get()
+{
+   static BlockFileIOStats instance;
+   return instance;
+}
+
+wxString BlockFileIOStats::GetName(Kind kind)
+{
+   static const wxChar *const names[NKinds] = {
+      wxT("simple"),
+      wxT("compressed"),
+      wxT("packed"),
+      wxT("alias"),
+      wxT("legacy"),
+   };
+   return names[kind];
+}
+
+wxString BlockFileIOStats::GetName(Operation operation)
+{
+   static const wxChar *const names[NOperations] = {
+      wxT("fileread"),
+      wxT("memoryread"),
+      wxT("write"),
+   };
+   return names[operation];
+}
+
+void BlockFileIOStats::Record(Kind kind, Operation operation,
+   Clock::duration duration, size_t bytes)
+{
+   const auto count =
+      std::chrono::duration_cast<std::chrono::microseconds>(duration)
+         .count();
+   const unsigned long long us = count > 0 ? count : 0;
+
+   auto &counts = mCounts[kind][operation];
+   size_t bucket = 0;
+   while (bucket + 1 < NumBuckets &&
+          us >= (1ull << (bucket + FirstBucketLog2)))
+      ++bucket;
+   counts.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+   counts.count.fetch_add(1, std::memory_order_relaxed);
+   counts.bytes.fetch_add(bytes, std::memory_order_relaxed);
+   counts.totalMicroseconds.fetch_add(us, std::memory_order_relaxed);
+   auto old = counts.maxMicroseconds.load(std::memory_order_relaxed);
+   while (us > old &&
+      !counts.maxMicroseconds.compare_exchange_weak(
+         old, us, std::memory_order_relaxed))
+      ;
+}
+
+auto BlockFileIOStats::GetSnapshot() const -> Snapshot
+{
+   Snapshot result;
+   for (unsigned kind = 0; kind < NKinds; ++kind)
+      for (unsigned operation = 0; operation < NOperations; ++operation) {
+         const auto &counts = mCounts[kind][operation];
+         auto &out = result.counts[kind][operation];
+         out.count = counts.count.load(std::memory_order_relaxed);
+         out.bytes = counts.bytes.load(std::memory_order_relaxed);
+         out.totalMicroseconds =
+            counts.totalMicroseconds.load(std::memory_order_relaxed);
+         out.maxMicroseconds =
+            counts.maxMicroseconds.load(std::memory_order_relaxed);
+         for (size_t ii = 0; ii < NumBuckets; ++ii)
+            out.histogram[ii] =
+               counts.histogram[ii].load(std::memory_order_relaxed);
+      }
+   result.cacheHits = mCacheHits.load(std::memory_order_relaxed);
+   result.cacheMisses = mCacheMisses.load(std::memory_order_relaxed);
+   return result;
+}
+
+void BlockFileIOStats::Reset()
+{
+   for (auto &row : mCounts)
+      for (auto &counts : row) {
+         counts.count.store(0, std::memory_order_relaxed);
+         counts.bytes.store(0, std::memory_order_relaxed);
+         counts.totalMicroseconds.store(0, std::memory_order_relaxed);
+         counts.maxMicroseconds.store(0, std::memory_order_relaxed);
+         for (auto &bucket : counts.histogram)
+            bucket.store(0, std::memory_order_relaxed);
+      }
+   mCacheHits.store(0, std::memory_order_relaxed);
+   mCacheMisses.store(0, std::memory_order_relaxed);
+}
+
+wxString BlockFileIOStats::Report() const
+{
+   const auto snapshot = GetSnapshot();
+
+   wxStringOutputStream o;
+   wxTextOutputStream s(o, wxEOL_UNIX);
+
+   s << wxT("==============================\n");
+   s << XO("Block file input and output since startup:\n");
+   s << XO("Sample cache hits: %llu, misses: %llu\n")
+      .Format( snapshot.cacheHits, snapshot.cacheMisses );
+
+   for (unsigned kind = 0; kind < NKinds; ++kind)
+      for (unsigned operation = 0; operation < NOperations; ++operation) {
+         const auto &counts = snapshot.counts[kind][operation];
+         if (counts.count == 0)
+            continue;
+         s << wxT("==============================\n");
+         s << XO("%s block files, %s:\n")
+            .Format( GetName( Kind( kind ) ),
+               GetName( Operation( operation ) ) );
+         s << XO("Count: %llu, bytes: %llu, mean: %.3f ms, longest: %.3f ms\n")
+            .Format( counts.count, counts.bytes,
+               counts.totalMicroseconds / (1000.0 * counts.count),
+               counts.maxMicroseconds / 1000.0 );
+         unsigned long long lower = 0;
+         for (size_t ii = 0; ii < NumBuckets; ++ii) {
+            const auto upper = 1ull << (ii + FirstBucketLog2);
+            if (counts.histogram[ii] > 0) {
+               if (ii + 1 < NumBuckets)
+                  s << XO("  %llu - %llu us: %llu\n")
+                     .Format( lower, upper, counts.histogram[ii] );
+               else
+                  s << XO("  %llu us or more: %llu\n")
+                     .Format( lower, counts.histogram[ii] );
+            }
+            lower = upper;
+         }
+      }
+
+   return o.GetString();
+}
@@ -0,0 +1,126 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockFileIOStats.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_BLOCK_FILE_IO_STATS__
+#define __AUDACITY_BLOCK_FILE_IO_STATS__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <wx/string.h>
+
+#include "MemoryX.h"
+
+/// \brief Counters of the reads and writes of block files, by kind of block
+/// file, with latency histograms, for the life of the process.
+///
+/// Recording is lock free and allocates nothing, so block files record on
+/// whatever thread reads them.  Readers get values that are each
+/// consistent, though not necessarily all from the same instant.
+class PROFILE_DLL_API BlockFileIOStats final
+{
+public:
+   using Clock = std::chrono::steady_clock;
+
+   enum Kind : unsigned { Simple, Compressed, Packed, Alias, Legacy, NKinds };
+
+   enum Operation : unsigned {
+      /// Samples read from the disk, opening the file
+      FileRead,
+      /// Samples served from memory:  blocks not yet written, cached or
+      /// mapped
+      MemoryRead,
+      Write,
+      NOperations
+   };
+
+   /// Histogram bucket ii counts durations under 2^(ii + FirstBucketLog2)
+   /// microseconds, not counted in an earlier bucket; the last is unbounded
+   enum : size_t { NumBuckets = 16, FirstBucketLog2 = 2 };
+
+   using Histogram = std::array<unsigned long long, NumBuckets>;
+
+   struct Counts {
+      unsigned long long count{ 0 };
+      unsigned long long bytes{ 0 };
+      unsigned long long totalMicroseconds{ 0 };
+      unsigned long long maxMicroseconds{ 0 };
+      Histogram histogram{};
+   };
+
+   struct Snapshot {
+      Counts counts[NKinds][NOperations];
+      /// Float reads of whole blocks found, or not, in BlockSampleCache
+      unsigned long long cacheHits{ 0 }, cacheMisses{ 0 };
+   };
+
+   /// Times one operation, and records it when destroyed, even if by an
+   /// exception
+   class Scope final
+   {
+   public:
+      Scope(Kind kind, Operation operation)
+         : mKind{ kind }, mOperation{ operation }, mStart{ Clock::now() }
+      {}
+      Scope( const Scope& ) PROHIBITED;
+      Scope &operator=( const Scope& ) PROHIBITED;
+      ~Scope()
+      {
+         Get().Record(mKind, mOperation, Clock::now() - mStart, mBytes);
+      }
+
+      void SetOperation(Operation operation) { mOperation = operation; }
+      void SetBytes(size_t bytes) { mBytes = bytes; }
+
+   private:
+      const Kind mKind;
+      Operation mOperation;
+      const Clock::time_point mStart;
+      size_t mBytes{ 0 };
+   };
+
+   static BlockFileIOStats &Get();
+
+   static wxString GetName(Kind kind);
+   static wxString GetName(Operation operation);
+
+   void Record(Kind kind, Operation operation,
+      Clock::duration duration, size_t bytes);
+   void RecordCacheLookup(bool hit)
+   {
+      (hit ? mCacheHits : mCacheMisses)
+         .fetch_add(1, std::memory_order_relaxed);
+   }
+
+   Snapshot GetSnapshot() const;
+   /// Start counting again from zero
+   void Reset();
+
+   /// A readable summary for diagnostics
+   wxString Report() const;
+
+private:
+   BlockFileIOStats() = default;
+   BlockFileIOStats( const BlockFileIOStats& ) PROHIBITED;
+   BlockFileIOStats &operator=( const BlockFileIOStats& ) PROHIBITED;
+
+   using Counter = std::atomic<unsigned long long>;
+
+   struct AtomicCounts {
+      Counter count{ 0 };
+      Counter bytes{ 0 };
+      Counter totalMicroseconds{ 0 };
+      Counter maxMicroseconds{ 0 };
+      std::array<Counter, NumBuckets> histogram{};
+   };
+
+   AtomicCounts mCounts[NKinds][NOperations];
+   Counter mCacheHits{ 0 }, mCacheMisses{ 0 };
+};
+
+#endif
@@ -0,0 +1,140 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockSampleCache.cpp
+
+*******************************************************************//**
+
+\class BlockSampleCache
+\brief Keeps the decoded samples of recently read block files, so that
+playback, drawing, analysis and effects reading the same region do not each
+go to the disk again.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "BlockSampleCache.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "BlockFile.h"
+#include "BlockFileIOStats.h"
+#include "CacheBudget.h"
+
+BlockSampleCache &BlockSampleCache::Get()
+{
+   static BlockSampleCache instance;
+   return instance;
+}
+
+void BlockSampleCache::UpdatePrefs()
+{
+   const auto budget =
+      CacheBudget::Get().GetBudget( CacheBudget::DecodedSamples );
+   auto &cache = Get();
+   cache.mShardBudget.store( budget / NShards );
+   for (auto &shard : cache.mShards) {
+      std::lock_guard<std::mutex> lock{ shard.mutex };
+      cache.Trim( shard );
+   }
+}
+
+void BlockSampleCache::Trim(Shard &shard)
+{
+   const auto budget = mShardBudget.load();
+   while (shard.bytes > budget && !shard.lru.empty()) {
+      const auto &last = shard.lru.back();
+      shard.bytes -= last.len * sizeof(float);
+      CacheBudget::Get().Release(
+         CacheBudget::DecodedSamples, last.len * sizeof(float) );
+      CacheBudget::Get().NoteEviction( CacheBudget::DecodedSamples );
+      shard.index.erase( last.pBlock );
+      shard.lru.pop_back();
+   }
+}
+
+auto BlockSampleCache::GetShard(const BlockFile *pBlock) -> Shard &
+{
+   // Block files are allocated on at least 8 byte boundaries
+   const auto hash = reinterpret_cast<uintptr_t>( pBlock ) >> 3;
+   return mShards[ hash % NShards ];
+}
+
+size_t BlockSampleCache::Read(const BlockFile &block, samplePtr data,
+   sampleFormat format, size_t start, size_t len, bool mayThrow)
+{
+   const auto blockLen = block.GetLength();
+   // On-demand blocks not yet decoded read as silence for now
+   if (format != floatSample || mShardBudget.load() == 0 ||
+       !block.IsDataAvailable() ||
+       blockLen * sizeof(float) > mShardBudget.load())
+      return block.ReadData( data, format, start, len, mayThrow );
+
+   const auto pFloats = reinterpret_cast<float*>( data );
+   const bool hit = Find( &block, pFloats, start, len );
+   BlockFileIOStats::Get().RecordCacheLookup( hit );
+   if (hit)
+      return len;
+
+   // Read the whole block without holding any lock
+   Floats samples{ blockLen };
+   if (block.ReadData( samplePtr( samples.get() ), floatSample, 0, blockLen,
+         mayThrow ) != blockLen)
+      // Don't remember the failure; read just what was asked, which also
+      // fills the rest as ReadData does
+      return block.ReadData( data, format, start, len, mayThrow );
+
+   memcpy( pFloats, samples.get() + start, len * sizeof(float) );
+   Insert( &block, std::move( samples ), blockLen );
+   return len;
+}
+
+bool BlockSampleCache::Find(
+   const BlockFile *pBlock, float *data, size_t start, size_t len)
+{
+   auto &shard = GetShard( pBlock );
+   std::lock_guard<std::mutex> lock{ shard.mutex };
+   auto iter = shard.index.find( pBlock );
+   if (iter == shard.index.end())
+      return false;
+
+   // Move to the front
+   shard.lru.splice( shard.lru.begin(), shard.lru, iter->second );
+   const auto &entry = shard.lru.front();
+   if (start + len > entry.len)
+      return false;
+   memcpy( data, entry.samples.get() + start, len * sizeof(float) );
+   return true;
+}
+
+void BlockSampleCache::Insert(
+   const BlockFile *pBlock, Floats &&samples, size_t len)
+{
+   auto &shard = GetShard( pBlock );
+   std::lock_guard<std::mutex> lock{ shard.mutex };
+   if (shard.index.count( pBlock ))
+      // Another thread read it meanwhile
+      return;
+
+   shard.lru.push_front( Entry{ pBlock, std::move( samples ), len } );
+   shard.index[ pBlock ] = shard.lru.begin();
+   shard.bytes += len * sizeof(float);
+   CacheBudget::Get().Add( CacheBudget::DecodedSamples, len * sizeof(float) );
+   Trim( shard );
+}
+
+void BlockSampleCache::Forget(const BlockFile *pBlock)
+{
+   auto &shard = GetShard( pBlock );
+   std::lock_guard<std::mutex> lock{ shard.mutex };
+   auto iter = shard.index.find( pBlock );
+   if (iter != shard.index.end()) {
+      shard.bytes -= iter->second->len * sizeof(float);
+      CacheBudget::Get().Release(
+         CacheBudget::DecodedSamples, iter->second->len * sizeof(float) );
+      shard.lru.erase( iter->second );
+      shard.index.erase( iter );
+   }
+}
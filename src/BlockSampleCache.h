@@ -0,0 +1,78 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockSampleCache.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_BLOCK_SAMPLE_CACHE__
+#define __AUDACITY_BLOCK_SAMPLE_CACHE__
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "MemoryX.h"
+#include "SampleFormat.h"
+
+class BlockFile;
+
+/// A process-wide, size-bounded cache of the samples of whole block files,
+/// decoded to float, shared by all readers of them on any thread.
+///
+/// Block files are immutable, so an entry is good until its block file is
+/// destroyed, which forgets it.  Entries are spread over a few shards, each
+/// with its own lock and least-recently-used order, so that readers on
+/// different threads seldom wait for each other.
+class PROFILE_DLL_API BlockSampleCache final
+{
+public:
+   static BlockSampleCache &Get();
+
+   /// Like BlockFile::ReadData, but float samples are served from the cache,
+   /// reading the whole block into it on a miss
+   size_t Read(const BlockFile &block, samplePtr data, sampleFormat format,
+               size_t start, size_t len, bool mayThrow);
+
+   /// Called when the block file is destroyed
+   void Forget(const BlockFile *pBlock);
+
+   /// Take the memory budget from CacheBudget, after it reads preferences;
+   /// call on the main thread
+   static void UpdatePrefs();
+
+private:
+   BlockSampleCache() = default;
+   BlockSampleCache( const BlockSampleCache& ) PROHIBITED;
+   BlockSampleCache &operator=( const BlockSampleCache& ) PROHIBITED;
+
+   enum : size_t { NShards = 16 };
+
+   struct Entry {
+      const BlockFile *pBlock;
+      Floats samples;
+      size_t len;
+   };
+   using Entries = std::list< Entry >;
+
+   struct Shard {
+      std::mutex mutex;
+      Entries lru;
+      std::unordered_map< const BlockFile*, Entries::iterator > index;
+      size_t bytes{ 0 };
+   };
+
+   Shard &GetShard(const BlockFile *pBlock);
+   // Evict the least recently used entries past the budget; lock first
+   void Trim(Shard &shard);
+   bool Find(const BlockFile *pBlock, float *data, size_t start, size_t len);
+   void Insert(const BlockFile *pBlock, Floats &&samples, size_t len);
+
+   Shard mShards[NShards];
+   // Bytes of samples allowed in each shard; 0 disables the cache
+   std::atomic<size_t> mShardBudget{ 0 };
+};
+
+#endif
@@ -0,0 +1,167 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CacheBudget.cpp
+
+*******************************************************************//**
+
+\class CacheBudget
+\brief Keeps the in-memory caches of recorded blocks, decoded samples,
+wave and spectrum displays and track reads within budgets of their own.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "CacheBudget.h"
+
+#include "Prefs.h"
+
+namespace {
+struct KindInfo {
+   const wxChar *name;
+   const wxChar *key;
+   // Default memory budget, in megabytes
+   long defaultMB;
+};
+
+const KindInfo &GetInfo(CacheBudget::Kind kind)
+{
+   static const KindInfo info[CacheBudget::NKinds] = {
+      { wxT("recorded-blocks"), wxT("/Directories/RecordCacheMB"), 1024 },
+      { wxT("decoded-samples"), wxT("/Directories/SampleCacheMB"), 256 },
+      { wxT("waveforms"), wxT("/Directories/WaveformCacheMB"), 64 },
+      { wxT("spectrograms"), wxT("/Directories/SpectrogramCacheMB"), 512 },
+      { wxT("track-reads"), wxT("/Directories/TrackReadCacheMB"), 256 },
+   };
+   return info[kind];
+}
+}
+
+CacheBudget::Client::~Client()
+{
+}
+
+CacheBudget &CacheBudget::Get()
+{
+   static CacheBudget instance;
+   return instance;
+}
+
+void CacheBudget::UpdatePrefs()
+{
+   auto &budget = Get();
+   std::lock_guard<std::mutex> lock{ budget.mMutex };
+   for (unsigned kind = 0; kind < NKinds; ++kind) {
+      const auto &info = GetInfo( Kind( kind ) );
+      auto budgetMB = gPrefs->Read( info.key, info.defaultMB );
+      if (budgetMB < 0)
+         budgetMB = 0;
+      budget.mTallies[kind].budget.store( size_t(budgetMB) * 1024 * 1024 );
+      budget.Trim( Kind( kind ) );
+   }
+}
+
+wxString CacheBudget::GetName(Kind kind)
+{
+   return GetInfo( kind ).name;
+}
+
+bool CacheBudget::Reserve(Kind kind, size_t bytes)
+{
+   auto &tally = mTallies[kind];
+   const auto budget = tally.budget.load();
+   auto old = tally.bytes.load();
+   do {
+      if (budget > 0 && old + bytes > budget) {
+         ++tally.refusals;
+         return false;
+      }
+   } while (!tally.bytes.compare_exchange_weak( old, old + bytes ));
+
+   auto peak = tally.peakBytes.load();
+   while (old + bytes > peak &&
+          !tally.peakBytes.compare_exchange_weak( peak, old + bytes ))
+      ;
+   return true;
+}
+
+void CacheBudget::Add(Kind kind, size_t bytes)
+{
+   auto &tally = mTallies[kind];
+   const auto now = ( tally.bytes += bytes );
+   auto peak = tally.peakBytes.load();
+   while (now > peak && !tally.peakBytes.compare_exchange_weak( peak, now ))
+      ;
+}
+
+void CacheBudget::Release(Kind kind, size_t bytes)
+{
+   mTallies[kind].bytes -= bytes;
+}
+
+void CacheBudget::Touch(Kind kind, const Client &client, size_t bytes)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   auto &clients = mClients[kind];
+   auto &index = mIndex[kind];
+   auto iter = index.find( &client );
+   if (iter == index.end()) {
+      clients.emplace_front( &client, 0 );
+      index[ &client ] = clients.begin();
+   }
+   else
+      // Move to the front
+      clients.splice( clients.begin(), clients, iter->second );
+
+   auto &held = clients.front().second;
+   Release( kind, held );
+   held = bytes;
+   Add( kind, bytes );
+   Trim( kind );
+}
+
+void CacheBudget::Forget(const Client &client)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   for (unsigned kind = 0; kind < NKinds; ++kind) {
+      auto &index = mIndex[kind];
+      auto iter = index.find( &client );
+      if (iter != index.end()) {
+         Release( Kind( kind ), iter->second->second );
+         mClients[kind].erase( iter->second );
+         index.erase( iter );
+      }
+   }
+}
+
+void CacheBudget::Trim(Kind kind)
+{
+   auto &tally = mTallies[kind];
+   const auto budget = tally.budget.load();
+   if (budget == 0)
+      return;
+
+   // The most recently used client is being drawn, so it always stays
+   auto &clients = mClients[kind];
+   while (tally.bytes.load() > budget && clients.size() > 1) {
+      const auto &last = clients.back();
+      last.first->EvictCache( kind );
+      Release( kind, last.second );
+      NoteEviction( kind );
+      mIndex[kind].erase( last.first );
+      clients.pop_back();
+   }
+}
+
+auto CacheBudget::GetStatistics(Kind kind) const -> Statistics
+{
+   const auto &tally = mTallies[kind];
+   return {
+      tally.bytes.load(),
+      tally.peakBytes.load(),
+      tally.budget.load(),
+      tally.evictions.load(),
+      tally.refusals.load(),
+   };
+}
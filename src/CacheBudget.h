@@ -0,0 +1,113 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CacheBudget.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_CACHE_BUDGET__
+#define __AUDACITY_CACHE_BUDGET__
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <wx/string.h>
+
+#include "MemoryX.h"
+
+/// Accounts for the memory held by each class of in-memory cache against a
+/// budget from preferences, so that long sessions do not grow without bound.
+///
+/// Caches of recorded blocks and of track reads ask before they allocate,
+/// and spill to disk, or do without, when refused.  Display caches of clips
+/// are clients, kept in least-recently-used order, and the least recently
+/// drawn give up their memory when a kind goes over its budget.  The
+/// decoded sample cache keeps its own order, but takes its budget from here.
+class PROFILE_DLL_API CacheBudget final
+{
+public:
+   enum Kind : unsigned {
+      RecordedBlocks,
+      DecodedSamples,
+      Waveforms,
+      Spectrograms,
+      TrackReads,
+
+      NKinds
+   };
+
+   /// Something holding cached memory of one or more kinds, that it can give
+   /// up on request.  Clients are touched on the main thread; EvictCache is
+   /// called there too, with the budget locked, so it must not call back.
+   class Client
+   {
+   public:
+      virtual ~Client();
+      virtual void EvictCache(Kind kind) const = 0;
+   };
+
+   struct Statistics {
+      size_t bytes;
+      size_t peakBytes;
+      // 0 for no limit
+      size_t budget;
+      unsigned long long evictions;
+      unsigned long long refusals;
+   };
+
+   static CacheBudget &Get();
+
+   /// Read the budgets from preferences, and evict any excess; call on the
+   /// main thread
+   static void UpdatePrefs();
+
+   static wxString GetName(Kind kind);
+
+   /// In bytes; 0 for no limit, except that the decoded sample cache is
+   /// then disabled
+   size_t GetBudget(Kind kind) const { return mTallies[kind].budget.load(); }
+
+   /// Account for the bytes if they fit the budget; else count a refusal
+   /// and return false
+   bool Reserve(Kind kind, size_t bytes);
+   /// Account for the bytes regardless of the budget
+   void Add(Kind kind, size_t bytes);
+   void Release(Kind kind, size_t bytes);
+   void NoteEviction(Kind kind) { ++mTallies[kind].evictions; }
+
+   /// Make the client the most recently used of the kind, now holding the
+   /// given bytes, then evict the least recently used others past the budget
+   void Touch(Kind kind, const Client &client, size_t bytes);
+   /// Stop accounting for the client's memory of every kind; any thread
+   void Forget(const Client &client);
+
+   Statistics GetStatistics(Kind kind) const;
+
+private:
+   CacheBudget() = default;
+   CacheBudget( const CacheBudget& ) PROHIBITED;
+   CacheBudget &operator=( const CacheBudget& ) PROHIBITED;
+
+   // Evict least recently used clients but the first; lock first
+   void Trim(Kind kind);
+
+   struct Tally {
+      std::atomic<size_t> bytes{ 0 };
+      std::atomic<size_t> peakBytes{ 0 };
+      std::atomic<size_t> budget{ 0 };
+      std::atomic<unsigned long long> evictions{ 0 };
+      std::atomic<unsigned long long> refusals{ 0 };
+   };
+   Tally mTallies[NKinds];
+
+   using Entries = std::list< std::pair< const Client*, size_t > >;
+   std::mutex mMutex;
+   // Most recently touched first
+   Entries mClients[NKinds];
+   std::unordered_map< const Client*, Entries::iterator > mIndex[NKinds];
+};
+
+#endif
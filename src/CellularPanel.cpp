@@ -1121,6 +1121,12 @@ std::shared_ptr<TrackPanelCell> CellularPanel::LastCell() const
 }
 
 void CellularPanel::Draw( TrackPanelDrawingContext &context, unsigned nPasses )
+{
+   Draw( context, nPasses, GetClientRect() );
+}
+
+void CellularPanel::Draw( TrackPanelDrawingContext &context, unsigned nPasses,
+   const wxRect &area )
 {
    const auto panelRect = GetClientRect();
    auto lastCell = LastCell();
@@ -1131,7 +1137,7 @@ void CellularPanel::Draw( TrackPanelDrawingContext &context, unsigned nPasses )
          // Draw the node
          const auto newRect = node.DrawingArea(
             context, rect, panelRect, iPass );
-         if ( newRect.Intersects( panelRect ) )
+         if ( newRect.Intersects( panelRect ) && newRect.Intersects( area ) )
             node.Draw( context, newRect, iPass );
 
          // Draw the current handle if it is associated with the node
@@ -1140,7 +1146,8 @@ void CellularPanel::Draw( TrackPanelDrawingContext &context, unsigned nPasses )
             if ( target ) {
                const auto targetRect =
                   target->DrawingArea( context, rect, panelRect, iPass );
-               if ( targetRect.Intersects( panelRect ) )
+               if ( targetRect.Intersects( panelRect ) &&
+                    targetRect.Intersects( area ) )
                   target->Draw( context, targetRect, iPass );
             }
          }
@@ -145,10 +145,10 @@ const ReservedCommandFlag&
             - &Track::IsLeader;
          return !range.empty();
       },
-      { []( const TranslatableString& ) { return
+      CommandFlagOptions{ []( const TranslatableString& ) { return
          // This reason will not be shown, because the stereo-to-mono is greyed out if not allowed.
          XO("You must first select some stereo audio to perform this\naction. (You cannot use this with mono.)");
-      } ,"Audacity_Selection"}
+      } ,"Audacity_Selection"}.DependsOn( TrackListDependency )
    }; return flag; }  //lda
 const ReservedCommandFlag&
    NoiseReductionTimeSelectedFlag() { static ReservedCommandFlag flag{
@@ -165,9 +165,9 @@ const ReservedCommandFlag&
       [](const AudacityProject &project){
          return !TrackList::Get( project ).Selected<const WaveTrack>().empty();
       },
-      { []( const TranslatableString& ) { return
+      CommandFlagOptions{ []( const TranslatableString& ) { return
          XO("You must first select some audio to perform this action.\n(Selecting other kinds of track won't work.)");
-      } ,"Audacity_Selection"}
+      } ,"Audacity_Selection"}.DependsOn( TrackListDependency )
    }; return flag; }
 const ReservedCommandFlag&
    TracksExistFlag() { static ReservedCommandFlag flag{
@@ -175,22 +175,23 @@ const ReservedCommandFlag&
          return !TrackList::Get( project ).Any().empty();
       },
       CommandFlagOptions{}.DisableDefaultMessage()
+         .DependsOn( TrackListDependency )
    }; return flag; }
 const ReservedCommandFlag&
    TracksSelectedFlag() { static ReservedCommandFlag flag{
       TracksSelectedPred, // exclude TimeTracks
-      { []( const TranslatableString &Name ){ return
+      CommandFlagOptions{ []( const TranslatableString &Name ){ return
          // i18n-hint: %s will be replaced by the name of an action, such as "Remove Tracks".
          XO("\"%s\" requires one or more tracks to be selected.").Format( Name );
-      },"Audacity_Selection" }
+      },"Audacity_Selection" }.DependsOn( TrackListDependency )
    }; return flag; }
 const ReservedCommandFlag&
    AnyTracksSelectedFlag() { static ReservedCommandFlag flag{
       AnyTracksSelectedPred, // Allow TimeTracks
-      { []( const TranslatableString &Name ){ return
+      CommandFlagOptions{ []( const TranslatableString &Name ){ return
          // i18n-hint: %s will be replaced by the name of an action, such as "Remove Tracks".
          XO("\"%s\" requires one or more tracks to be selected.").Format( Name );
-      },"Audacity_Selection" }
+      },"Audacity_Selection" }.DependsOn( TrackListDependency )
    }; return flag; }
 const ReservedCommandFlag&
    TrackPanelHasFocus() { static ReservedCommandFlag flag{
@@ -224,7 +225,8 @@ const ReservedCommandFlag&
    LabelTracksExistFlag() { static ReservedCommandFlag flag{
       [](const AudacityProject &project){
          return !TrackList::Get( project ).Any<const LabelTrack>().empty();
-      }
+      },
+      CommandFlagOptions{}.DependsOn( TrackListDependency )
    }; return flag; }
 const ReservedCommandFlag&
    UnsavedChangesFlag() { static ReservedCommandFlag flag{
@@ -292,20 +294,23 @@ const ReservedCommandFlag&
    WaveTracksExistFlag() { static ReservedCommandFlag flag{
       [](const AudacityProject &project){
          return !TrackList::Get( project ).Any<const WaveTrack>().empty();
-      }
+      },
+      CommandFlagOptions{}.DependsOn( TrackListDependency )
    }; return flag; }
 #ifdef USE_MIDI
 const ReservedCommandFlag&
    NoteTracksExistFlag() { static ReservedCommandFlag flag{
       [](const AudacityProject &project){
          return !TrackList::Get( project ).Any<const NoteTrack>().empty();
-      }
+      },
+      CommandFlagOptions{}.DependsOn( TrackListDependency )
    }; return flag; }  //gsw
 const ReservedCommandFlag&
    NoteTracksSelectedFlag() { static ReservedCommandFlag flag{
       [](const AudacityProject &project){
          return !TrackList::Get( project ).Selected<const NoteTrack>().empty();
-      }
+      },
+      CommandFlagOptions{}.DependsOn( TrackListDependency )
    }; return flag; }  //gsw
 #endif
 const ReservedCommandFlag&
@@ -352,7 +357,8 @@ const ReservedCommandFlag&
 #endif
             !tracks.Any<const WaveTrack>().empty()
          ;
-      }
+      },
+      CommandFlagOptions{}.DependsOn( TrackListDependency )
    }; return flag; }
 const ReservedCommandFlag&
    AudioTracksSelectedFlag() { static ReservedCommandFlag flag{
@@ -366,7 +372,8 @@ const ReservedCommandFlag&
 #endif
             !tracks.Selected<const WaveTrack>().empty()
          ;
-      }
+      },
+      CommandFlagOptions{}.DependsOn( TrackListDependency )
    }; return flag; }
 const ReservedCommandFlag&
    NoAutoSelect() { static ReservedCommandFlag flag{
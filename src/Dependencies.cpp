@@ -50,6 +50,8 @@ AliasedFile s.
 #include <wx/frame.h>
 #include <wx/stattext.h>
 
+#include "blockfile/CompressedBlockFile.h"
+#include "blockfile/PackedBlockFile.h"
 #include "blockfile/SimpleBlockFile.h"
 #include "DirManager.h"
 #include "FileFormats.h"
@@ -210,11 +212,21 @@ static void RemoveDependencies(AudacityProject *project,
             // We tolerate exceptions from NewBlockFile
             // and so we can allow exceptions from ReadData too
             f->ReadData(buffer.ptr(), format, 0, len);
-            newBlockFile =
-               dirManager.NewBlockFile( [&]( wxFileNameWrapper filePath ) {
-                  return make_blockfile<SimpleBlockFile>(
-                     std::move(filePath), buffer.ptr(), len, format);
-               } );
+            if (PackedBlockFile::GetPackBlockFiles())
+               newBlockFile =
+                  dirManager.NewPackedBlockFile(buffer.ptr(), len, format);
+            else if (CompressedBlockFile::GetCompressBlockFiles())
+               newBlockFile =
+                  dirManager.NewBlockFile( [&]( wxFileNameWrapper filePath ) {
+                     return make_blockfile<CompressedBlockFile>(
+                        std::move(filePath), buffer.ptr(), len, format);
+                  } );
+            else
+               newBlockFile =
+                  dirManager.NewBlockFile( [&]( wxFileNameWrapper filePath ) {
+                     return make_blockfile<SimpleBlockFile>(
+                        std::move(filePath), buffer.ptr(), len, format);
+                  } );
          }
 
          // Update our hash so we know what block files we've done
@@ -51,12 +51,14 @@ DeviceManager* DeviceManager::Instance()
 
 const std::vector<DeviceSourceMap> &DeviceManager::GetInputDeviceMaps()
 {
+   WaitForInitialScan();
    if (!m_inited)
       Init();
    return mInputDeviceSourceMaps;
 }
 const std::vector<DeviceSourceMap> &DeviceManager::GetOutputDeviceMaps()
 {
+   WaitForInitialScan();
    if (!m_inited)
       Init();
    return mOutputDeviceSourceMaps;
@@ -191,11 +193,24 @@ static bool IsInputDeviceAMapperDevice(const PaDeviceInfo *info)
    return false;
 }
 
-static void AddSources(int deviceIndex, int rate, std::vector<DeviceSourceMap> *maps, int isInput)
+// Identifies a device across restarts of PortAudio, which may renumber it
+static wxString SourceCacheKey(const PaDeviceInfo *info)
+{
+   return wxString::Format(wxT("%s\n%s\n%d\n%g"),
+      wxSafeConvertMB2WX(Pa_GetHostApiInfo(info->hostApi)->name),
+      wxSafeConvertMB2WX(info->name),
+      info->maxInputChannels,
+      info->defaultSampleRate);
+}
+
+static void AddSources(int deviceIndex, int rate, std::vector<DeviceSourceMap> *maps, int isInput,
+   const std::map<wxString, std::vector<DeviceSourceMap>> &oldCache,
+   std::map<wxString, std::vector<DeviceSourceMap>> &newCache)
 {
    int error = 0;
    DeviceSourceMap map;
    const PaDeviceInfo *info = Pa_GetDeviceInfo(deviceIndex);
+   wxString key;
 
    // This tries to open the device with the samplerate worked out above, which
    // will be the highest available for play and record on the device, or
@@ -217,6 +232,22 @@ static void AddSources(int deviceIndex, int rate, std::vector<DeviceSourceMap> *
    // portaudio indecies)
    // Also, for mapper devices we don't want to keep any sources, so check for it here
    if (isInput && !IsInputDeviceAMapperDevice(info)) {
+      // Opening the stream is the slow part of a scan, with some drivers
+      // taking a second or more, so reuse what the last scan found
+      if (info) {
+         key = SourceCacheKey(info);
+         auto found = oldCache.find(key);
+         if (found != oldCache.end()) {
+            for (auto cached : found->second) {
+               cached.deviceIndex = deviceIndex;
+               cached.hostIndex = info->hostApi;
+               maps->push_back(cached);
+            }
+            newCache[key] = found->second;
+            return;
+         }
+      }
+
       if (info)
          parameters.suggestedLatency = info->defaultLowInputLatency;
       else
@@ -231,8 +262,12 @@ static void AddSources(int deviceIndex, int rate, std::vector<DeviceSourceMap> *
    }
 
    if (stream && !error) {
+      const auto first = maps->size();
       AddSourcesFromStream(deviceIndex, info, maps, stream);
       Pa_CloseStream(stream);
+      // Failures are not remembered, so that a busy device is tried again
+      if (!key.empty())
+         newCache[key].assign(maps->begin() + first, maps->end());
    } else {
       map.sourceIndex  = -1;
       map.totalSources = 0;
@@ -252,10 +287,6 @@ static void AddSources(int deviceIndex, int rate, std::vector<DeviceSourceMap> *
 /// Assumes that DeviceManager is only used on the main thread.
 void DeviceManager::Rescan()
 {
-   // get rid of the previous scan info
-   this->mInputDeviceSourceMaps.clear();
-   this->mOutputDeviceSourceMaps.clear();
-
    // if we are doing a second scan then restart portaudio to get NEW devices
    if (m_inited) {
       // check to see if there is a stream open - can happen if monitoring,
@@ -279,13 +310,19 @@ void DeviceManager::Rescan()
    // FIXME: TRAP_ERR PaErrorCode not handled in ReScan()
    int nDevices = Pa_GetDeviceCount();
 
+   // Entries for devices not seen in this scan are dropped
+   SourceCache oldCache;
+   oldCache.swap(mSourceCache);
+   std::vector<DeviceSourceMap> inputMaps, outputMaps;
+
    //The heirarchy for devices is Host/device/source.
    //Some newer systems aggregate this.
    //So we need to call port mixer for every device to get the sources
    for (int i = 0; i < nDevices; i++) {
       const PaDeviceInfo *info = Pa_GetDeviceInfo(i);
       if (info->maxOutputChannels > 0) {
-         AddSources(i, info->defaultSampleRate, &mOutputDeviceSourceMaps, 0);
+         AddSources(i, info->defaultSampleRate, &outputMaps, 0,
+                    oldCache, mSourceCache);
       }
 
       if (info->maxInputChannels > 0) {
@@ -295,12 +332,23 @@ void DeviceManager::Rescan()
              PaWasapi_IsLoopback(i) > 0)
 #endif
 #endif
-         AddSources(i, info->defaultSampleRate, &mInputDeviceSourceMaps, 1);
+         AddSources(i, info->defaultSampleRate, &inputMaps, 1,
+                    oldCache, mSourceCache);
       }
    }
 
+   // Leave the lists alone if nothing changed, so that the toolbars and
+   // any open preferences need not be rebuilt
+   const bool changed = !m_inited ||
+      inputMaps != mInputDeviceSourceMaps ||
+      outputMaps != mOutputDeviceSourceMaps;
+   if (changed) {
+      mInputDeviceSourceMaps.swap(inputMaps);
+      mOutputDeviceSourceMaps.swap(outputMaps);
+   }
+
    // If this was not an initial scan update each device toolbar.
-   if ( m_inited ) {
+   if ( m_inited && changed ) {
       wxCommandEvent e{ EVT_RESCANNED_DEVICES };
       wxTheApp->ProcessEvent( e );
    }
@@ -331,7 +379,49 @@ DeviceManager::DeviceManager()
 
 DeviceManager::~DeviceManager()
 {
+   WaitForInitialScan();
+}
+
+void DeviceManager::StartInitialScan()
+{
+#ifndef __WXMSW__
+   // Not on Windows, where PortAudio initializes COM for the host APIs on
+   // the calling thread
+   if (m_inited || mScanThread.joinable())
+      return;
+
+   mScanThread = std::thread{ [this]{
+      // An initial scan sends no events and uses nothing of the
+      // application but PortAudio, which is reference counted
+      mScanInitializedPortAudio = ( Pa_Initialize() == paNoError );
+      if (mScanInitializedPortAudio) {
+         try {
+            Rescan();
+         }
+         catch( ... ) {
+            // The scan is made again when the lists are first needed
+            m_inited = false;
+         }
+      }
+   } };
+#endif
+}
 
+void DeviceManager::WaitForInitialScan()
+{
+   if (mScanThread.joinable())
+      mScanThread.join();
+}
+
+void DeviceManager::ReleaseInitialScan()
+{
+   WaitForInitialScan();
+   if (mScanInitializedPortAudio) {
+      // Rescan() terminates and initializes again to find new devices, which
+      // works only if AudioIO holds the only other reference
+      mScanInitializedPortAudio = false;
+      Pa_Terminate();
+   }
 }
 
 void DeviceManager::Init()
@@ -21,6 +21,8 @@
 #include "Experimental.h"
 
 #include <chrono>
+#include <map>
+#include <thread>
 #include <vector>
 
 #include <wx/event.h> // to declare a custom event type
@@ -45,6 +47,23 @@ typedef struct DeviceSourceMap {
    wxString hostString;
 } DeviceSourceMap;
 
+inline bool operator==(const DeviceSourceMap &a, const DeviceSourceMap &b)
+{
+   return a.deviceIndex == b.deviceIndex &&
+      a.sourceIndex == b.sourceIndex &&
+      a.hostIndex == b.hostIndex &&
+      a.totalSources == b.totalSources &&
+      a.numChannels == b.numChannels &&
+      a.sourceString == b.sourceString &&
+      a.deviceString == b.deviceString &&
+      a.hostString == b.hostString;
+}
+
+inline bool operator!=(const DeviceSourceMap &a, const DeviceSourceMap &b)
+{
+   return !(a == b);
+}
+
 wxString MakeDeviceSourceString(const DeviceSourceMap *map);
 
 class DeviceManager final
@@ -60,11 +79,24 @@ class DeviceManager final
 
    /// Gets a NEW list of devices by terminating and restarting portaudio
    /// Assumes that DeviceManager is only used on the main thread.
+   /// Input devices seen by the previous scan are not opened again to
+   /// count their sources, and EVT_RESCANNED_DEVICES is sent only if the
+   /// lists changed; otherwise they, and pointers into them, stay valid.
    void Rescan();
 
    // Time since devices scanned in seconds.
    float GetTimeSinceRescan();
 
+   /// Begin the first scan on another thread, so that startup does other
+   /// work while devices are opened.  Nothing else may use PortAudio until
+   /// WaitForInitialScan() returns.  Call once, on the main thread.
+   void StartInitialScan();
+   /// Block until the scan begun by StartInitialScan() is done, if any
+   void WaitForInitialScan();
+   /// Let go of the scanning thread's initialization of PortAudio; call after
+   /// AudioIO has initialized it too
+   void ReleaseInitialScan();
+
    DeviceSourceMap* GetDefaultOutputDevice(int hostIndex);
    DeviceSourceMap* GetDefaultInputDevice(int hostIndex);
 
@@ -93,9 +125,18 @@ private:
 
    bool m_inited;
 
+   /// The sources of input devices, as found by opening a stream on each,
+   /// by host API, name and capabilities
+   using SourceCache = std::map<wxString, std::vector<DeviceSourceMap>>;
+   SourceCache mSourceCache;
+
    std::vector<DeviceSourceMap> mInputDeviceSourceMaps;
    std::vector<DeviceSourceMap> mOutputDeviceSourceMaps;
 
+   std::thread mScanThread;
+   // Whether the scanning thread holds PortAudio initialized
+   bool mScanInitializedPortAudio{ false };
+
    static DeviceManager dm;
 };
 
@@ -65,6 +65,11 @@
 #include "DirManager.h"
 
 #include <time.h> // to use time() for srand()
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
 
 #include <wx/wxcrtvararg.h>
 #include <wx/defs.h>
@@ -86,6 +91,7 @@
 #endif
 
 #include "BlockFile.h"
+#include "FileException.h"
 #include "FileNames.h"
 #include "InconsistencyException.h"
 #include "Prefs.h"
@@ -93,6 +99,8 @@
 #include "widgets/Warning.h"
 #include "widgets/AudacityMessageBox.h"
 #include "widgets/ProgressDialog.h"
+#include "blockfile/PackedBlockFile.h"
+#include "blockfile/RangeBlockFile.h"
 
 #if defined(__WXMAC__)
 #include <mach/mach.h>
@@ -196,6 +204,155 @@ int DirManager::RecursivelyEnumerate(const FilePath &dirPath,
    return count;
 }
 
+namespace {
+
+// FNV-1a, taking eight bytes at a time, with the high bits folded back in
+// after each step so that they reach the low ones
+unsigned long long HashSamples(
+   samplePtr sampleData, size_t sampleLen, sampleFormat format)
+{
+   const size_t bytes = sampleLen * SAMPLE_SIZE(format);
+   const unsigned long long prime = 1099511628211ULL;
+   unsigned long long hash = 14695981039346656037ULL ^ format;
+   size_t ii = 0;
+   for (; ii + sizeof(hash) <= bytes; ii += sizeof(hash)) {
+      unsigned long long word;
+      memcpy(&word, sampleData + ii, sizeof(word));
+      hash = (hash ^ word) * prime;
+      hash ^= hash >> 32;
+   }
+   for (; ii < bytes; ++ii)
+      hash = (hash ^ (unsigned char)sampleData[ii]) * prime;
+   return hash ^ bytes;
+}
+
+// The work of these threads is waiting on the disk, not computing, so a few
+// more threads than the cores are still worth it
+unsigned CountDiskThreads()
+{
+   return std::max(2u, std::min(8u, 2 * std::thread::hardware_concurrency()));
+}
+
+// Call fn(ii) for each ii in [0, n), spread over threads, the calling thread
+// among them.  fn must not throw.
+template< typename Function >
+void ForEachInParallel(size_t n, const Function &fn)
+{
+   const size_t nThreads = std::min<size_t>(n, CountDiskThreads());
+   std::atomic<size_t> next{ 0 };
+   const auto work = [&]{
+      for (size_t ii = 0; (ii = next++) < n;)
+         fn(ii);
+   };
+
+   std::vector<std::thread> threads;
+   for (size_t ii = 1; ii < nThreads; ++ii)
+      threads.emplace_back(work);
+   work();
+   for (auto &thread : threads)
+      thread.join();
+}
+
+// Call fn(ii) for each ii in [0, n) on worker threads, while the calling
+// thread updates the progress dialog, if any.  fn returns false, or the user
+// stops the progress, to skip what is not yet started.  Returns whether all
+// were done.
+template< typename Function >
+bool ForEachInParallel(
+   size_t n, const Function &fn, ProgressDialog *progress)
+{
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::atomic<bool> stopped{ false };
+
+   std::vector<std::thread> threads;
+   // Whatever happens, wait for the threads before the caller's data go away
+   auto cleanup = finally( [&] {
+      stopped.store(true);
+      for (auto &thread : threads)
+         thread.join();
+   } );
+   const size_t nThreads = std::min<size_t>(n, CountDiskThreads());
+   for (size_t iThread = 0; iThread < nThreads; ++iThread)
+      threads.emplace_back( [&]{
+         for (size_t ii = 0; !stopped.load() && (ii = next++) < n;) {
+            if (!fn(ii))
+               stopped.store(true);
+            ++nDone;
+         }
+      } );
+
+   while (nDone.load() < n && !stopped.load()) {
+      if (progress &&
+          progress->Update((int) nDone.load(), (int) n) !=
+             ProgressResult::Success)
+         stopped.store(true);
+      else
+         ::wxMilliSleep(10);
+   }
+   return !stopped.load();
+}
+
+// Hard-link if possible, else clone or copy; link becomes false when a link
+// fails, as when the paths are on different devices
+bool TransferFile(
+   const FilePath &oldPath, const FilePath &newPath, std::atomic<bool> &link)
+{
+   if (link.load() && FileNames::HardLinkFile( oldPath, newPath ))
+      return true;
+   link.store(false);
+   return FileNames::CloneFile( oldPath, newPath ) ||
+      FileNames::CopyFile( oldPath, newPath );
+}
+
+}
+
+bool DirManager::EnumerateFilesInParallel(const FilePath &dirPath,
+                                          FilePaths& filePathArray, // output: all files in dirPath tree
+                                          const TranslatableString &message)
+{
+   // The files at the top, and the subdirectories, are listed on this thread
+   FilePaths subdirPaths;
+   {
+      wxDir dir(dirPath);
+      if (!dir.IsOpened())
+         return true;
+
+      wxString name;
+      bool cont = dir.GetFirst(&name, wxEmptyString,
+         wxDIR_FILES | wxDIR_HIDDEN | wxDIR_NO_FOLLOW);
+      while ( cont ){
+         filePathArray.push_back(dirPath + wxFILE_SEP_PATH + name);
+         cont = dir.GetNext(&name);
+      }
+
+      cont = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS | wxDIR_NO_FOLLOW);
+      while ( cont ){
+         subdirPaths.push_back(dirPath + wxFILE_SEP_PATH + name);
+         cont = dir.GetNext(&name);
+      }
+   }
+
+   // Each subdirectory tree is enumerated whole by one of the workers, into
+   // an array of its own, so the result is in the same order as
+   // RecursivelyEnumerate gives
+   std::vector<FilePaths> found(subdirPaths.size());
+   Optional<ProgressDialog> progress{};
+   if (!message.empty())
+      progress.emplace( XO("Progress"), message );
+   if (!ForEachInParallel(subdirPaths.size(), [&](size_t ii){
+         RecursivelyEnumerate(
+            subdirPaths[ii], found[ii], wxEmptyString, wxEmptyString,
+            true, false);
+         return true;
+      }, progress ? &*progress : nullptr))
+      return false;
+
+   for (auto &paths : found)
+      filePathArray.insert(filePathArray.end(), paths.begin(), paths.end());
+   return true;
+}
+
 int DirManager::RecursivelyEnumerateWithProgress(const FilePath &dirPath,
                                              FilePaths& filePathArray, // output: all files in dirPath tree
                                              wxString dirspec,
@@ -439,6 +596,10 @@ DirManager::DirManager()
 
 DirManager::~DirManager()
 {
+   // Workers must not read the files while they are cleaned away
+   mLoadedBlocks.reset();
+   mAliasedFileSearch.reset();
+
    auto start = sDirManagers.begin(), finish = sDirManagers.end(),
       iter = std::remove_if( start, finish,
          [=]( const std::weak_ptr<DirManager> &ptr ){
@@ -446,6 +607,9 @@ DirManager::~DirManager()
          } );
    sDirManagers.erase( iter, finish );
 
+   // Remove a pack of unsaved blocks now, so that the directory may go too
+   mWritePack.reset();
+
    numDirManagers--;
    if (numDirManagers == 0) {
       CleanTempDir();
@@ -574,6 +738,8 @@ struct DirManager::ProjectSetter::Impl
    // Remember old path to be cleaned up in case of successful move
    FilePath oldFull{ dirManager.projFull };
    FilePaths newPaths;
+   // Pack files, with their paths in the NEW directory
+   std::vector< std::pair< std::shared_ptr<BlockPack>, FilePath > > newPacks;
    size_t trueTotal{ 0 };
    bool moving{ true };
 
@@ -680,6 +846,12 @@ DirManager::ProjectSetter::Impl::Impl(
          auto b = pair.second.lock();
          return b && b->IsLocked();
       }
+   ) && ! std::any_of(
+      dirManager.mBlockPacks.begin(), dirManager.mBlockPacks.end(),
+      []( const BlockPacks::value_type &pair ){
+         auto pPack = pair.second.lock();
+         return pPack && pPack->IsKept();
+      }
    );
 
    trueTotal = 0;
@@ -690,17 +862,22 @@ DirManager::ProjectSetter::Impl::Impl(
       ProgressDialog progress(XO("Progress"),
          XO("Saving project data files"));
 
-      int total = dirManager.mBlockFileHash.size();
+      int total =
+         dirManager.mBlockFileHash.size() + dirManager.mBlockPacks.size();
 
+      // New paths are chosen, and their directories made, on this thread.
+      // The files are linked, cloned or copied by workers afterward, except
+      // those of on-demand blocks still being computed.
       bool link = moving;
+      FileTransfers transfers;
       for (const auto &pair : dirManager.mBlockFileHash) {
          if( progress.Update((int) newPaths.size(), total) != ProgressResult::Success )
             return;
 
          FilePath newPath;
          if (auto b = pair.second.lock()) {
-            auto result =
-               dirManager.LinkOrCopyToNewProjectDirectory( &*b, link );
+            auto result = dirManager.LinkOrCopyToNewProjectDirectory(
+               &*b, link, &transfers );
             if (!result.first)
                return;
             newPath = result.second;
@@ -708,6 +885,37 @@ DirManager::ProjectSetter::Impl::Impl(
          }
          newPaths.push_back( newPath );
       }
+
+      for (const auto &pair : dirManager.mBlockPacks) {
+         if( progress.Update((int) (newPaths.size() + newPacks.size()), total)
+               != ProgressResult::Success )
+            return;
+
+         auto pPack = pair.second.lock();
+         if (!pPack)
+            continue;
+
+         const auto oldFileName = pPack->GetFileName();
+         wxFileNameWrapper newFileName;
+         if (!dirManager.AssignFile(
+               newFileName, oldFileName.GetFullName(), false))
+            return;
+
+         const auto oldPath = oldFileName.GetFullPath();
+         const auto newPath = newFileName.GetFullPath();
+         // A pack may have no file yet, if nothing was appended to it
+         if (newPath != oldPath && oldFileName.FileExists())
+            transfers.push_back( { oldPath, newPath } );
+         newPacks.emplace_back( pPack, newPath );
+         ++trueTotal;
+      }
+
+      std::atomic<bool> canLink{ link };
+      if (!ForEachInParallel( transfers.size(), [&](size_t ii){
+            const auto &transfer = transfers[ii];
+            return TransferFile( transfer.oldPath, transfer.newPath, canLink );
+         }, &progress ))
+         return;
    }
 
    ok = true;
@@ -764,6 +972,14 @@ void DirManager::ProjectSetter::Impl::Commit()
       ++ii;
    }
 
+   for (const auto &pair : newPacks) {
+      const auto &pPack = pair.first;
+      const auto oldPath = pPack->GetFileName().GetFullPath();
+      if ((moving || !pPack->IsKept()) && oldPath != pair.second)
+         wxRemoveFile( oldPath );
+      pPack->SetFileName( wxFileNameWrapper{ wxFileName{ pair.second } } );
+   }
+
    // Some subtlety; SetProject is used both to move a temp project
    // into a permanent home as well as just set up path variables when
    // loading a project; in this latter case, the movement code does
@@ -1185,7 +1401,8 @@ wxFileNameWrapper DirManager::MakeBlockFileName()
 
       baseFileName.Printf(wxT("e%02x%02x%03x"),topnum,midnum,filenum);
 
-      if (!ContainsBlockFile(baseFileName)) {
+      if (!ContainsBlockFile(baseFileName) &&
+          !mPendingBlockFileNames.count(baseFileName)) {
          // not in the hash, good.
          if (!this->AssignFile(ret, baseFileName, true))
          {
@@ -1209,9 +1426,28 @@ wxFileNameWrapper DirManager::MakeBlockFileName()
 
 BlockFilePtr DirManager::NewBlockFile( const BlockFileFactory &factory )
 {
-   wxFileNameWrapper filePath{ MakeBlockFileName() };
+   wxFileNameWrapper filePath;
+   {
+      // Reserve the name, but write the file without the lock, so that
+      // concurrent imports don't wait for each other's disk writes
+      std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+      filePath = MakeBlockFileName();
+      mPendingBlockFileNames.insert( filePath.GetName() );
+   }
    const wxString fileName{ filePath.GetName() };
-   auto newBlockFile = factory( std::move(filePath) );
+
+   BlockFilePtr newBlockFile;
+   try {
+      newBlockFile = factory( std::move(filePath) );
+   }
+   catch( ... ) {
+      std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+      mPendingBlockFileNames.erase( fileName );
+      throw;
+   }
+
+   std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+   mPendingBlockFileNames.erase( fileName );
    mBlockFileHash[fileName] = newBlockFile;
    auto &aliasName = newBlockFile->GetExternalFileName();
    if ( aliasName.IsOk() )
@@ -1221,6 +1457,141 @@ BlockFilePtr DirManager::NewBlockFile( const BlockFileFactory &factory )
    return newBlockFile;
 }
 
+BlockFilePtr DirManager::NewPackedBlockFile(
+   samplePtr sampleData, size_t sampleLen, sampleFormat format )
+{
+   std::shared_ptr<BlockPack> pPack;
+   {
+      std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+      pPack = GetWritePack();
+   }
+
+   // Like silent block files, packed ones have no file of their own, so
+   // they don't go into mBlockFileHash
+   return make_blockfile<PackedBlockFile>(
+      std::move(pPack), sampleData, sampleLen, format);
+}
+
+BlockFilePtr DirManager::NewSharedBlockFile(
+   samplePtr sampleData, size_t sampleLen, sampleFormat format,
+   const SharedBlockFileFactory &factory )
+{
+   const auto hash = HashSamples(sampleData, sampleLen, format);
+
+   std::vector<BlockFilePtr> candidates;
+   {
+      std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+      const auto range = mSharedBlocks.equal_range(hash);
+      for (auto iter = range.first; iter != range.second;) {
+         auto pBlock = iter->second.block.lock();
+         if (!pBlock) {
+            iter = mSharedBlocks.erase(iter);
+            continue;
+         }
+         if (iter->second.format == format && iter->second.length == sampleLen)
+            candidates.push_back(std::move(pBlock));
+         ++iter;
+      }
+   }
+
+   // Compare the samples, in case the hashes collided, without the lock
+   // while reading.  Locked blocks are not shared, as in CopyBlockFile.
+   if (!candidates.empty()) {
+      SampleBuffer buffer(sampleLen, format);
+      const auto bytes = sampleLen * SAMPLE_SIZE(format);
+      for (const auto &pBlock : candidates) {
+         if (pBlock->IsLocked())
+            continue;
+         if (pBlock->ReadData(buffer.ptr(), format, 0, sampleLen, false)
+                == sampleLen &&
+             memcmp(buffer.ptr(), sampleData, bytes) == 0)
+            return pBlock;
+      }
+   }
+
+   auto pBlock = factory();
+
+   std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+   if (mSharedBlocks.size() >= mSharedBlocksSweepSize) {
+      for (auto iter = mSharedBlocks.begin(); iter != mSharedBlocks.end();) {
+         if (iter->second.block.expired())
+            iter = mSharedBlocks.erase(iter);
+         else
+            ++iter;
+      }
+      mSharedBlocksSweepSize =
+         std::max<size_t>(1024, 2 * mSharedBlocks.size());
+   }
+   SharedBlock shared;
+   shared.block = pBlock;
+   shared.format = format;
+   shared.length = sampleLen;
+   mSharedBlocks.emplace(hash, shared);
+   return pBlock;
+}
+
+bool DirManager::GetShareIdenticalBlocks()
+{
+   bool shareIdenticalBlocks = false;
+   gPrefs->Read(wxT("/Directories/ShareIdenticalBlocks"), &shareIdenticalBlocks);
+   return shareIdenticalBlocks;
+}
+
+std::shared_ptr<BlockPack> DirManager::GetBlockPack( const wxString &name )
+{
+   std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+   auto &wPack = mBlockPacks[name];
+   auto pPack = wPack.lock();
+   if (!pPack) {
+      wxFileNameWrapper fileName;
+      AssignFile(fileName, name, false);
+      const auto size = fileName.FileExists()
+         ? fileName.GetSize() : wxULongLong{ 0 };
+      // A saved project may refer to it, so never remove it
+      pPack = std::make_shared<BlockPack>( std::move(fileName),
+         size == wxInvalidSize ? 0 : size.GetValue(), true );
+      wPack = pPack;
+   }
+   return pPack;
+}
+
+bool DirManager::OwnsBlockPack( const BlockPack &pack )
+{
+   std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+   auto iter = mBlockPacks.find( pack.GetFileName().GetFullName() );
+   return iter != mBlockPacks.end() && iter->second.lock().get() == &pack;
+}
+
+// Call with mBlockFileMutex locked
+std::shared_ptr<BlockPack> DirManager::GetWritePack()
+{
+   if (mWritePack && mWritePack->GetSize() < BlockPack::MaxBytes)
+      return mWritePack;
+
+   // Start a NEW pack, under a name that is neither on disk nor in use
+   const auto dir = GetDataFilesDir();
+   if (!wxDirExists(dir))
+      wxFileName::Mkdir(dir, 0777, wxPATH_MKDIR_FULL);
+
+   for (int ii = 0;; ++ii) {
+      const auto name = wxString::Format(wxT("p%05d.aupack"), ii);
+      auto iter = mBlockPacks.find( name );
+      if (iter != mBlockPacks.end() && !iter->second.expired())
+         continue;
+
+      wxFileNameWrapper fileName;
+      if (!AssignFile(fileName, name, false))
+         throw FileException{ FileException::Cause::Open, fileName };
+      if (fileName.FileExists())
+         continue;
+
+      mWritePack =
+         std::make_shared<BlockPack>( std::move(fileName), 0, false );
+      mBlockPacks[name] = mWritePack;
+      return mWritePack;
+   }
+}
+
 bool DirManager::ContainsBlockFile(const BlockFile *b) const
 {
    if (!b)
@@ -1250,6 +1621,29 @@ BlockFilePtr DirManager::CopyBlockFile(const BlockFilePtr &b)
    if (!b)
       THROW_INCONSISTENCY_EXCEPTION;
 
+   if (auto pRange = dynamic_cast<const RangeBlockFile*>(b.get())) {
+      // Share or copy the source, as for any other block, so that this
+      // DirManager knows of it
+      const auto &source = pRange->GetSource();
+      auto newSource = CopyBlockFile(source);
+      if (newSource == source && !b->IsLocked())
+         return b;
+      return make_blockfile<RangeBlockFile>(
+         std::move(newSource), pRange->GetStart(), b->GetLength());
+   }
+
+   if (auto pPacked = dynamic_cast<const PackedBlockFile*>(b.get())) {
+      // Blocks may share extents in this project's packs, but not in those
+      // of another project, which go away with it
+      if (!OwnsBlockPack(*pPacked->GetPack())) {
+         const auto len = b->GetLength();
+         const auto format = pPacked->GetFormat();
+         SampleBuffer buffer(len, format);
+         b->ReadData(buffer.ptr(), format, 0, len);
+         return NewPackedBlockFile(buffer.ptr(), len, format);
+      }
+   }
+
    auto result = b->GetFileName();
    const auto &fn = result.name;
 
@@ -1259,8 +1653,10 @@ BlockFilePtr DirManager::CopyBlockFile(const BlockFilePtr &b)
       //but it's something to watch out for.
       //
       // LLL: Except for silent block files which have uninitialized filename.
-      if (fn.IsOk())
+      if (fn.IsOk()) {
+         std::lock_guard<std::mutex> lock{ mBlockFileMutex };
          mBlockFileHash[fn.GetName()] = b;
+      }
       return b;
    }
 
@@ -1272,20 +1668,38 @@ BlockFilePtr DirManager::CopyBlockFile(const BlockFilePtr &b)
       b2 = b->Copy(wxFileNameWrapper{});
    else
    {
-      wxFileNameWrapper newFile{ MakeBlockFileName() };
+      wxFileNameWrapper newFile;
+      {
+         std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+         newFile = MakeBlockFileName();
+         mPendingBlockFileNames.insert( newFile.GetName() );
+      }
       const wxString newName{newFile.GetName()};
       const wxString newPath{ newFile.GetFullPath() };
+      auto unreserve = finally( [&]{
+         std::lock_guard<std::mutex> lock{ mBlockFileMutex };
+         mPendingBlockFileNames.erase( newName );
+      } );
 
       // We assume that the NEW file should have the same extension
       // as the existing file
       newFile.SetExt(fn.GetExt());
 
+      // The copy is made from the file, which a block made with
+      // write-behind may not have yet
+      if (b->GetNeedWriteCacheToDisk())
+         b->WriteCacheToDisk();
+
       //some block files such as ODPCMAliasBlockFIle don't always have
       //a summary file, so we should check before we copy.
       if(b->IsSummaryAvailable())
       {
-         if( !FileNames::CopyFile(fn.GetFullPath(),
-                  newFile.GetFullPath()) )
+         // Block files are never rewritten, so the copy may share the
+         // storage of the original, as when pasting from another project
+         // on the same volume
+         std::atomic<bool> canLink{ true };
+         if( !TransferFile(fn.GetFullPath(),
+                  newFile.GetFullPath(), canLink) )
             // Disk space exhaustion, maybe
             throw FileException{
                FileException::Cause::Write, newFile };
@@ -1296,6 +1710,7 @@ BlockFilePtr DirManager::CopyBlockFile(const BlockFilePtr &b)
 
       b2 = b->Copy(std::move(newFile));
 
+      std::lock_guard<std::mutex> lock{ mBlockFileMutex };
       mBlockFileHash[newName] = b2;
       aliasList.push_back(newPath);
    }
@@ -1303,6 +1718,9 @@ BlockFilePtr DirManager::CopyBlockFile(const BlockFilePtr &b)
    if (!b2)
       THROW_INCONSISTENCY_EXCEPTION;
 
+   // The samples are the same, so the summaries are too
+   b->ShareSummaries(*b2);
+
    return b2;
 }
 
@@ -1324,11 +1742,177 @@ DirManager::RegisteredBlockFileDeserializer::RegisteredBlockFileDeserializer(
    GetDeserializers()[tag] = function;
 }
 
+/// Block files just loaded from a project, whose disk access is done by a few
+/// worker threads while the parse continues.  The blocks are let go only on
+/// the main thread, after the workers finish, so none is destroyed on them.
+class DirManager::LoadedBlockQueue
+{
+public:
+   LoadedBlockQueue()
+   {
+      const unsigned nThreads = CountDiskThreads();
+      mThreads.reserve(nThreads);
+      for (unsigned ii = 0; ii < nThreads; ++ii)
+         mThreads.emplace_back( [this]{ Work(); } );
+   }
+
+   ~LoadedBlockQueue()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mFinished = true;
+      }
+      mCondition.notify_all();
+      for (auto &thread : mThreads)
+         thread.join();
+   }
+
+   void Add(const BlockFilePtr &pBlock)
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mBlocks.push_back(pBlock);
+      }
+      mCondition.notify_one();
+   }
+
+private:
+   void Work()
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      while (true) {
+         mCondition.wait( lock, [this]{
+            return mFinished || mNext < mBlocks.size(); } );
+         if (mNext == mBlocks.size())
+            // Finished, and nothing left
+            return;
+         const BlockFile *pBlock = mBlocks[mNext++].get();
+         lock.unlock();
+         pBlock->PrepareLoaded();
+         lock.lock();
+      }
+   }
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::vector<BlockFilePtr> mBlocks;
+   size_t mNext{ 0 };
+   bool mFinished{ false };
+   std::vector<std::thread> mThreads;
+};
+
+/// The files that the alias blocks of a project refer to, each looked for
+/// once, by a thread that starts when loading finishes.  Meanwhile the rest
+/// of the project opens and draws from the summaries, which need no aliased
+/// file.
+class DirManager::AliasedFileSearch
+{
+public:
+   explicit AliasedFileSearch(FilePaths paths)
+      : mPaths{ std::move(paths) }
+      , mMissing(mPaths.size())
+   {
+      mThread = std::thread( [this]{
+         ForEachInParallel(mPaths.size(), [this](size_t ii){
+            mMissing[ii] = !wxFileExists(mPaths[ii]);
+         });
+      } );
+   }
+
+   ~AliasedFileSearch()
+   {
+      if (mThread.joinable())
+         mThread.join();
+   }
+
+   // Wait for the thread, and give whether each path exists
+   std::unordered_map<FilePath, bool> Finish()
+   {
+      if (mThread.joinable())
+         mThread.join();
+      std::unordered_map<FilePath, bool> result;
+      for (size_t ii = 0; ii < mPaths.size(); ++ii)
+         result.emplace(mPaths[ii], !mMissing[ii]);
+      return result;
+   }
+
+private:
+   const FilePaths mPaths;
+   std::vector<char> mMissing;
+   std::thread mThread;
+};
+
+void DirManager::FinishLoading()
+{
+   mLoadedBlocks.reset();
+   mBareAliasedNames.clear();
+
+   FilePaths aliasedPaths;
+   std::unordered_set<FilePath> seen;
+   for (const auto &pair : mBlockFileHash) {
+      BlockFilePtr b = pair.second.lock();
+      if (b && b->IsAlias()) {
+         auto path = static_cast< AliasBlockFile* >( &*b )
+            ->GetAliasedFileName().GetFullPath();
+         if (!path.empty() && seen.insert(path).second)
+            aliasedPaths.push_back(std::move(path));
+      }
+   }
+
+   mAliasedFileSearch.reset();
+   if (!aliasedPaths.empty())
+      mAliasedFileSearch =
+         std::make_unique<AliasedFileSearch>(std::move(aliasedPaths));
+}
+
+void DirManager::AssignAliasedFile(wxFileNameWrapper &fileName,
+   const wxString &value, const FilePath &dirName)
+{
+   // A name with a path is used as it is, found or not
+   if (!XMLValueChecker::IsGoodFileString(value)) {
+      if (XMLValueChecker::IsGoodPathString(value))
+         fileName.Assign(value);
+      return;
+   }
+
+   // Many blocks alias each file, so look only once for each name
+   const auto key = dirName + wxFILE_SEP_PATH + value;
+   auto found = mBareAliasedNames.find(key);
+   if (found == mBareAliasedNames.end())
+      found = mBareAliasedNames.emplace(key,
+         !XMLValueChecker::IsGoodPathName(value) &&
+         XMLValueChecker::IsGoodFileName(value, dirName)).first;
+
+   if (found->second)
+      // Allow fallback of looking for the file name, located in the
+      // directory
+      fileName.Assign(dirName, value);
+   else
+      fileName.Assign(value);
+}
+
 bool DirManager::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
 {
    if( !mLoadingTarget )
       return false;
 
+   if (!wxStrcmp(tag, RangeBlockFile::GetXMLTag())) {
+      // Ranges never nest
+      if (mLoadingRangeTarget ||
+          !RangeBlockFile::ReadXMLAttributes(
+             attrs, mLoadingRangeStart, mLoadingRangeLen)) {
+         mLoadingTarget = nullptr;
+         return false;
+      }
+      // Load the child tag, the source of the range, aside; the range is
+      // made at the end tag
+      mLoadingRangeTarget = std::move(mLoadingTarget);
+      mLoadingRangeSource.reset();
+      mLoadingTarget =
+         [this] () -> BlockFilePtr& { return mLoadingRangeSource; };
+      return true;
+   }
+
    BlockFilePtr pBlockFile {};
 
    BlockFilePtr &target = mLoadingTarget();
@@ -1387,11 +1971,33 @@ bool DirManager::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
    // balancing information
    BalanceInfoAdd(name);
 
+   if (!mLoadedBlocks)
+      mLoadedBlocks = std::make_unique<LoadedBlockQueue>();
+   mLoadedBlocks->Add(target);
+
    return true;
 }
 
+void DirManager::HandleXMLEndTag(const wxChar *tag)
+{
+   if (!mLoadingRangeTarget || wxStrcmp(tag, RangeBlockFile::GetXMLTag()))
+      return;
+
+   // If the source is missing, or too short, the target stays empty, and
+   // the sequence fills the gap with silence
+   auto source = std::move(mLoadingRangeSource);
+   mLoadingRangeSource.reset();
+   if (source &&
+       mLoadingRangeStart + mLoadingRangeLen <= source->GetLength())
+      mLoadingRangeTarget() = RangeBlockFile::Make(
+         source, mLoadingRangeStart, mLoadingRangeLen);
+
+   mLoadingTarget = nullptr;
+   mLoadingRangeTarget = nullptr;
+}
+
 std::pair<bool, FilePath> DirManager::LinkOrCopyToNewProjectDirectory(
-   BlockFile *f, bool &link )
+   BlockFile *f, bool &link, FileTransfers *pDeferred )
 {
    FilePath newPath;
    auto result = f->GetFileName();
@@ -1419,14 +2025,15 @@ std::pair<bool, FilePath> DirManager::LinkOrCopyToNewProjectDirectory(
       bool summaryExisted = f->IsSummaryAvailable();
       auto oldPath = oldFileNameRef.GetFullPath();
       if (summaryExisted) {
-         bool success = false;
-         if (link)
-            success = FileNames::HardLinkFile( oldPath, newPath );
-         if (!success)
-             link = false,
-             success = FileNames::CopyFile( oldPath, newPath );
-         if (!success)
-            return { false, {} };
+         if (pDeferred)
+            pDeferred->push_back( { oldPath, newPath } );
+         else {
+            std::atomic<bool> canLink{ link };
+            const bool success = TransferFile( oldPath, newPath, canLink );
+            link = canLink.load();
+            if (!success)
+               return { false, {} };
+         }
       }
 
       if (!summaryExisted && (f->IsSummaryAvailable() || f->IsSummaryBeingComputed())) {
@@ -1539,6 +2146,9 @@ bool DirManager::EnsureSafeFilename(const wxFileName &fName)
    }
 
    if (needToRename) {
+      // Windows won't rename a file that is open
+      BlockFile::CloseAliasedFile(fullPath);
+
       if (!wxRenameFile(fullPath,
                         renamedFullPath))
       {
@@ -1590,34 +2200,60 @@ void DirManager::FindMissingAliasFiles(
       BlockHash& missingAliasFilesAUFHash,     // output: (.auf) AliasBlockFiles whose aliased files are missing
       BlockHash& missingAliasFilesPathHash)    // output: full paths of missing aliased files
 {
-   BlockHash::iterator iter = mBlockFileHash.begin();
-   while (iter != mBlockFileHash.end())
+   // Many blocks may alias one file, so look for each file only once
+   FilePaths aliasedPaths;
+   std::unordered_map<wxString, size_t> aliasedPathIndices;
+   std::vector< std::pair<BlockHash::const_iterator, size_t> > aliases;
+   for (auto iter = mBlockFileHash.cbegin(); iter != mBlockFileHash.cend(); ++iter)
    {
-      wxString key = iter->first;   // file name and extension
       BlockFilePtr b = iter->second.lock();
-      if (b) {
-         if (b->IsAlias())
+      if (b && b->IsAlias())
+      {
+         const wxFileName &aliasedFileName =
+         static_cast< AliasBlockFile* > ( &*b )->GetAliasedFileName();
+         wxString aliasedFileFullPath = aliasedFileName.GetFullPath();
+         // wxEmptyString can happen if user already chose to "replace... with silence".
+         if (!aliasedFileFullPath.empty())
          {
-            const wxFileName &aliasedFileName =
-            static_cast< AliasBlockFile* > ( &*b )->GetAliasedFileName();
-            wxString aliasedFileFullPath = aliasedFileName.GetFullPath();
-            // wxEmptyString can happen if user already chose to "replace... with silence".
-            if ((!aliasedFileFullPath.empty()) &&
-                !aliasedFileName.FileExists())
-            {
-               missingAliasFilesAUFHash[key] = b;
-               if (missingAliasFilesPathHash.find(aliasedFileFullPath) ==
-                   missingAliasFilesPathHash.end()) // Add it only once.
-                  // Not actually using the block here, just the path,
-                  // so set the block to NULL to create the entry.
-                  missingAliasFilesPathHash[aliasedFileFullPath] = {};
-            }
+            auto result = aliasedPathIndices.emplace(
+               aliasedFileFullPath, aliasedPaths.size() );
+            if (result.second)
+               aliasedPaths.push_back(aliasedFileFullPath);
+            aliases.emplace_back(iter, result.first->second);
          }
       }
-      ++iter;
    }
 
-   iter = missingAliasFilesPathHash.begin();
+   // Use what was found in the background since loading, and look now only
+   // for the files aliased since
+   std::unordered_map<FilePath, bool> found;
+   if (mAliasedFileSearch) {
+      found = mAliasedFileSearch->Finish();
+      mAliasedFileSearch.reset();
+   }
+   std::vector<char> missing(aliasedPaths.size());
+   ForEachInParallel(aliasedPaths.size(), [&](size_t ii){
+      auto iter = found.find(aliasedPaths[ii]);
+      missing[ii] = iter != found.end()
+         ? !iter->second
+         : !wxFileExists(aliasedPaths[ii]);
+   });
+
+   for (const auto &alias : aliases)
+   {
+      if (!missing[alias.second])
+         continue;
+      const wxString &key = alias.first->first;   // file name and extension
+      missingAliasFilesAUFHash[key] = alias.first->second;
+      const wxString &aliasedFileFullPath = aliasedPaths[alias.second];
+      if (missingAliasFilesPathHash.find(aliasedFileFullPath) ==
+          missingAliasFilesPathHash.end()) // Add it only once.
+         // Not actually using the block here, just the path,
+         // so set the block to NULL to create the entry.
+         missingAliasFilesPathHash[aliasedFileFullPath] = {};
+   }
+
+   auto iter = missingAliasFilesPathHash.begin();
    while (iter != missingAliasFilesPathHash.end())
    {
       wxLogWarning(_("Missing aliased audio file: '%s'"), iter->first);
@@ -1626,10 +2262,11 @@ void DirManager::FindMissingAliasFiles(
 }
 
 void DirManager::FindMissingAUFs(
-      BlockHash& missingAUFHash)                // output: missing (.auf) AliasBlockFiles
+      BlockHash& missingAUFHash,                // output: missing (.auf) AliasBlockFiles
+      const FilePathSet *pPresentFiles)         // input: files known to exist, or null
 {
-   BlockHash::iterator iter = mBlockFileHash.begin();
-   while (iter != mBlockFileHash.end())
+   std::vector< std::pair<BlockHash::const_iterator, FilePath> > candidates;
+   for (auto iter = mBlockFileHash.cbegin(); iter != mBlockFileHash.cend(); ++iter)
    {
       const wxString &key = iter->first;
       BlockFilePtr b = iter->second.lock();
@@ -1641,23 +2278,35 @@ void DirManager::FindMissingAUFs(
             wxFileNameWrapper fileName{ MakeBlockFilePath(key) };
             fileName.SetName(key);
             fileName.SetExt(wxT("auf"));
-            if (!fileName.FileExists())
-            {
-               missingAUFHash[key] = b;
-               wxLogWarning(_("Missing alias (.auf) block file: '%s'"),
-                            fileName.GetFullPath());
-            }
+            candidates.emplace_back(iter, fileName.GetFullPath());
          }
       }
-      ++iter;
+   }
+
+   // A path not in the set of present files might only be spelled otherwise,
+   // so it is looked for on disk before it is called missing
+   std::vector<char> missing(candidates.size());
+   ForEachInParallel(candidates.size(), [&](size_t ii){
+      const auto &path = candidates[ii].second;
+      missing[ii] = !(pPresentFiles && pPresentFiles->count(path)) &&
+         !wxFileExists(path);
+   });
+
+   for (size_t ii = 0; ii < candidates.size(); ++ii)
+   {
+      if (!missing[ii])
+         continue;
+      missingAUFHash[candidates[ii].first->first] = candidates[ii].first->second;
+      wxLogWarning(_("Missing alias (.auf) block file: '%s'"),
+                   candidates[ii].second);
    }
 }
 
 void DirManager::FindMissingAUs(
       BlockHash& missingAUHash)                 // missing data (.au) blockfiles
 {
-   BlockHash::iterator iter = mBlockFileHash.begin();
-   while (iter != mBlockFileHash.end())
+   std::vector< std::pair<BlockHash::const_iterator, FilePath> > candidates;
+   for (auto iter = mBlockFileHash.cbegin(); iter != mBlockFileHash.cend(); ++iter)
    {
       const wxString &key = iter->first;
       BlockFilePtr b = iter->second.lock();
@@ -1668,17 +2317,28 @@ void DirManager::FindMissingAUs(
          {
             wxFileNameWrapper fileName{ MakeBlockFilePath(key) };
             fileName.SetName(key);
-            fileName.SetExt(wxT("au"));
-            const auto path = fileName.GetFullPath();
-            if (!fileName.FileExists() ||
-                wxFile{ path }.Length() == 0)
-            {
-               missingAUHash[key] = b;
-               wxLogWarning(_("Missing data block file: '%s'"), path);
-            }
+            // Not every data block file is .au
+            const auto ext = b->GetFileName().name.GetExt();
+            fileName.SetExt(ext.empty() ? wxString{ wxT("au") } : ext);
+            candidates.emplace_back(iter, fileName.GetFullPath());
          }
       }
-      ++iter;
+   }
+
+   // Empty files are missing too, so each must be opened, not only found in
+   // the directory
+   std::vector<char> missing(candidates.size());
+   ForEachInParallel(candidates.size(), [&](size_t ii){
+      const auto &path = candidates[ii].second;
+      missing[ii] = !wxFileExists(path) || wxFile{ path }.Length() == 0;
+   });
+
+   for (size_t ii = 0; ii < candidates.size(); ++ii)
+   {
+      if (!missing[ii])
+         continue;
+      missingAUHash[candidates[ii].first->first] = candidates[ii].first->second;
+      wxLogWarning(_("Missing data block file: '%s'"), candidates[ii].second);
    }
 }
 
@@ -1703,6 +2363,7 @@ void DirManager::FindOrphanBlockFiles(
             // Consider only Audacity data files.
             // Specifically, ignore <branding> JPG and <import> OGG ("Save Compressed Copy").
             (ext.IsSameAs(wxT("au"), false) ||
+               ext.IsSameAs(wxT("auz"), false) ||
                ext.IsSameAs(wxT("auf"), false)))
       {
          // Ignore it if it exists in the clipboard (from a previously closed project)
@@ -1725,14 +2386,12 @@ void DirManager::RemoveOrphanBlockfiles()
 {
    FilePaths filePathArray; // *all* files in the project directory/subdirectories
    auto dirPath = (!projFull.empty() ? projFull : mytemp);
-   RecursivelyEnumerateWithProgress(
+   if (!EnumerateFilesInParallel(
       dirPath,
       filePathArray,          // output: all files in project directory tree
-      wxEmptyString,          // All dirs
-      wxEmptyString,          // All files
-      true, false,
-      mBlockFileHash.size(),  // rough guess of how many BlockFiles will be found/processed, for progress
-      XO("Inspecting project file data"));
+      XO("Inspecting project file data")))
+      // Cancelled; the orphans stay until next time
+      return;
 
    FilePaths orphanFilePathArray;
    this->FindOrphanBlockFiles(
@@ -16,7 +16,10 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "ClientData.h"
 
@@ -24,6 +27,7 @@ class wxFileNameWrapper;
 class AudacityProject;
 class BlockArray;
 class BlockFile;
+class BlockPack;
 class ProgressDialog;
 
 using DirHash = std::unordered_map<int, int>;
@@ -72,6 +76,13 @@ class PROFILE_DLL_API DirManager final
                                                 int progress_count,
                                                 const TranslatableString &message);
 
+   // Enumerate all files in the tree, like RecursivelyEnumerateWithProgress
+   // with no specs, but each subdirectory of dirPath on a worker thread.
+   // Returns false, leaving the array incomplete, if the user cancelled.
+   static bool EnumerateFilesInParallel(const FilePath &dirPath,
+                                        FilePaths& filePathArray, // output: all files in dirPath tree
+                                        const TranslatableString &message);
+
    static int RecursivelyCountSubdirs( const FilePath &dirPath );
 
    static int RecursivelyRemoveEmptyDirs(const FilePath &dirPath,
@@ -142,6 +153,27 @@ class PROFILE_DLL_API DirManager final
    using BlockFileFactory = std::function< BlockFilePtr( wxFileNameWrapper ) >;
    BlockFilePtr NewBlockFile( const BlockFileFactory &factory );
 
+   // Makes a PackedBlockFile, appending the samples to one of this
+   // project's pack files.  May throw.
+   BlockFilePtr NewPackedBlockFile(
+      samplePtr sampleData, size_t sampleLen, sampleFormat format );
+
+   using SharedBlockFileFactory = std::function< BlockFilePtr() >;
+   // Returns a block made before by this function with exactly the same
+   // samples, which may then be shared between sequences as copied blocks
+   // are; else makes one with the factory, and remembers it.  May throw.
+   BlockFilePtr NewSharedBlockFile(
+      samplePtr sampleData, size_t sampleLen, sampleFormat format,
+      const SharedBlockFileFactory &factory );
+
+   // Whether NEW blocks of recorded and imported audio should be shared
+   // where their samples are identical, by preference
+   static bool GetShareIdenticalBlocks();
+
+   // The pack file of the given name in the data directory, for loading
+   // blocks that refer to it
+   std::shared_ptr<BlockPack> GetBlockPack( const wxString &name );
+
    /// Returns true if the blockfile pointed to by b is contained by the DirManager
    bool ContainsBlockFile(const BlockFile *b) const;
    /// Check for existing using filename using complete filename
@@ -162,8 +194,15 @@ class PROFILE_DLL_API DirManager final
    void SaveBlockFile(BlockFile * f, wxTextFile * out);
 #endif
 
+   // A file to be linked or copied into a NEW project directory
+   struct FileTransfer { FilePath oldPath, newPath; };
+   using FileTransfers = std::vector<FileTransfer>;
+
+   // If pDeferred is not null, files that can be linked or copied at any
+   // time are appended to it instead, to be done later on other threads
    std::pair<bool, FilePath>
-      LinkOrCopyToNewProjectDirectory(BlockFile *f, bool &link);
+      LinkOrCopyToNewProjectDirectory(BlockFile *f, bool &link,
+         FileTransfers *pDeferred = nullptr);
 
    bool EnsureSafeFilename(const wxFileName &fName);
 
@@ -181,9 +220,22 @@ class PROFILE_DLL_API DirManager final
    void SetLoadingMaxSamples(size_t max) { mMaxSamples = max; }
 
    bool HandleXMLTag(const wxChar *tag, const wxChar **attrs) override;
+   void HandleXMLEndTag(const wxChar *tag) override;
+   // Only the tag of a range block file has a child, the block it refers to
    XMLTagHandler *HandleXMLChild(const wxChar * WXUNUSED(tag)) override
-      { return NULL; }
+      { return mLoadingRangeTarget ? this : NULL; }
+   // Wait for the disk access that HandleXMLTag started in the background
+   // for the block files it loaded.  Call after parsing a project, before
+   // using its blocks.  Then starts looking for the files that the alias
+   // blocks refer to, also in the background, for FindMissingAliasFiles.
+   void FinishLoading();
    bool AssignFile(wxFileNameWrapper &filename, const wxString &value, bool check);
+   // Assign the file that a loaded block aliases:  value, as a path; or a
+   // bare name in dirName, if not found as a path but found there.  Only
+   // bare names are looked for now, each once while loading; the others are
+   // left to FindMissingAliasFiles.
+   void AssignAliasedFile(wxFileNameWrapper &fileName,
+                          const wxString &value, const FilePath &dirName);
 
    // Clean the temp dir. Note that now where we have auto recovery the temp
    // dir is not cleaned at start up anymore. But it is cleaned when the
@@ -199,8 +251,10 @@ class PROFILE_DLL_API DirManager final
    void FindMissingAliasFiles(
          BlockHash& missingAliasFilesAUFHash,     // output: (.auf) AliasBlockFiles whose aliased files are missing
          BlockHash& missingAliasFilesPathHash);   // output: full paths of missing aliased files
+   using FilePathSet = std::unordered_set<FilePath>;
    void FindMissingAUFs(
-         BlockHash& missingAUFHash);               // output: missing (.auf) AliasBlockFiles
+         BlockHash& missingAUFHash,                // output: missing (.auf) AliasBlockFiles
+         const FilePathSet *pPresentFiles = nullptr); // input: files known to exist
    void FindMissingAUs(
          BlockHash& missingAUHash);                // missing data (.au) blockfiles
    // Find .au and .auf files that are not in the project.
@@ -241,6 +295,34 @@ class PROFILE_DLL_API DirManager final
 
    BlockHash mBlockFileHash; // repository for blockfiles
 
+   // Guards naming of NEW block files and their entry in mBlockFileHash, so
+   // that concurrent imports may make block files at once
+   std::mutex mBlockFileMutex;
+   // Names given out by NewBlockFile() whose files are still being written
+   std::unordered_set<wxString> mPendingBlockFileNames;
+
+   bool OwnsBlockPack( const BlockPack &pack );
+   std::shared_ptr<BlockPack> GetWritePack();
+
+   // Pack files of PackedBlockFiles, by name; also guarded by mBlockFileMutex
+   using BlockPacks =
+      std::unordered_map< wxString, std::weak_ptr<BlockPack> >;
+   BlockPacks mBlockPacks;
+   // The pack to which NEW blocks are appended
+   std::shared_ptr<BlockPack> mWritePack;
+
+   // Blocks made by NewSharedBlockFile, by a hash of their samples; also
+   // guarded by mBlockFileMutex.  Expired entries are swept out when the
+   // map reaches mSharedBlocksSweepSize.
+   struct SharedBlock
+   {
+      std::weak_ptr<BlockFile> block;
+      sampleFormat format;
+      size_t length;
+   };
+   std::unordered_multimap< unsigned long long, SharedBlock > mSharedBlocks;
+   size_t mSharedBlocksSweepSize{ 1024 };
+
    // Hashes for management of the sub-directory tree of _data
    struct BalanceInfo
    {
@@ -266,6 +348,16 @@ class PROFILE_DLL_API DirManager final
    FilePaths aliasList;
 
    LoadingTarget mLoadingTarget;
+   // A range block file being loaded, until the end of its tag
+   LoadingTarget mLoadingRangeTarget;
+   BlockFilePtr mLoadingRangeSource;
+   size_t mLoadingRangeStart{ 0 }, mLoadingRangeLen{ 0 };
+   class LoadedBlockQueue;
+   std::unique_ptr<LoadedBlockQueue> mLoadedBlocks;
+   // Whether each bare aliased name was found in the directory, while loading
+   std::unordered_map<FilePath, bool> mBareAliasedNames;
+   class AliasedFileSearch;
+   std::unique_ptr<AliasedFileSearch> mAliasedFileSearch;
    sampleFormat mLoadingFormat;
    size_t mLoadingBlockLen;
 
@@ -45,6 +45,7 @@ and get deterministic behaviour.
 // (Note: this file should be included first)
 #include "float_cast.h"
 
+#include <algorithm>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
@@ -54,6 +55,17 @@ and get deterministic behaviour.
 
 #include <wx/defs.h>
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_CONVERSIONS
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_CONVERSIONS
+#include <arm_neon.h>
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 
 // Constants for the noise shaping buffer
@@ -64,7 +76,7 @@ const int Dither::BUF_SIZE = 8;
 const float Dither::SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
 
 // This is supposed to produce white noise and no dc
-#define DITHER_NOISE (rand() / (float)RAND_MAX - 0.5f)
+#define DITHER_NOISE (Noise())
 
 // The following is a rather ugly, but fast implementation
 // of a dither loop. The macro "DITHER" is expanded to an implementation
@@ -207,8 +219,197 @@ const float Dither::SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
     } while (0)
 
 
+// Vectorized conversions for contiguous samples, where no dither noise is
+// added.  Results are identical to those of the scalar loops below:
+// floats are clipped to [-1, 1] before scaling, and rounding is to nearest
+// as with lrintf.  Returns how many leading samples were converted; the
+// caller does the remainder.
+static unsigned int ConvertVectorized(
+   const samplePtr source, sampleFormat sourceFormat,
+   samplePtr dest, sampleFormat destFormat,
+   unsigned int len)
+{
+   unsigned int i = 0;
+#if defined(USE_SSE2_CONVERSIONS)
+   if (sourceFormat == floatSample && destFormat == int16Sample) {
+      const float *s = (const float*)source;
+      short *d = (short*)dest;
+      const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f),
+         scale = _mm_set1_ps(CONVERT_DIV16);
+      for (; i + 8 <= len; i += 8) {
+         __m128 a = _mm_loadu_ps(s + i), b = _mm_loadu_ps(s + i + 4);
+         a = _mm_mul_ps(_mm_max_ps(_mm_min_ps(a, hi), lo), scale);
+         b = _mm_mul_ps(_mm_max_ps(_mm_min_ps(b, hi), lo), scale);
+         // Signed saturation does the clipping of 32768 to 32767
+         _mm_storeu_si128((__m128i*)(d + i),
+            _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+      }
+   }
+   else if (sourceFormat == floatSample && destFormat == int24Sample) {
+      const float *s = (const float*)source;
+      int *d = (int*)dest;
+      const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f),
+         scale = _mm_set1_ps(CONVERT_DIV24),
+         max24 = _mm_set1_ps(8388607.0f);
+      for (; i + 4 <= len; i += 4) {
+         __m128 a = _mm_loadu_ps(s + i);
+         a = _mm_mul_ps(_mm_max_ps(_mm_min_ps(a, hi), lo), scale);
+         _mm_storeu_si128((__m128i*)(d + i),
+            _mm_cvtps_epi32(_mm_min_ps(a, max24)));
+      }
+   }
+   else if (sourceFormat == int24Sample && destFormat == int16Sample) {
+      const int *s = (const int*)source;
+      short *d = (short*)dest;
+      const __m128 scale = _mm_set1_ps(CONVERT_DIV16 / CONVERT_DIV24);
+      for (; i + 8 <= len; i += 8) {
+         __m128 a = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(s + i)));
+         __m128 b =
+            _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(s + i + 4)));
+         _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi32(
+            _mm_cvtps_epi32(_mm_mul_ps(a, scale)),
+            _mm_cvtps_epi32(_mm_mul_ps(b, scale))));
+      }
+   }
+   else if (sourceFormat == int16Sample && destFormat == floatSample) {
+      const short *s = (const short*)source;
+      float *d = (float*)dest;
+      const __m128 scale = _mm_set1_ps(1.0f / CONVERT_DIV16);
+      for (; i + 8 <= len; i += 8) {
+         __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+         // Sign-extend by unpacking into the high halves, then shifting
+         __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+         __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+         _mm_storeu_ps(d + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+         _mm_storeu_ps(d + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+      }
+   }
+   else if (sourceFormat == int24Sample && destFormat == floatSample) {
+      const int *s = (const int*)source;
+      float *d = (float*)dest;
+      const __m128 scale = _mm_set1_ps(1.0f / CONVERT_DIV24);
+      for (; i + 4 <= len; i += 4)
+         _mm_storeu_ps(d + i, _mm_mul_ps(_mm_cvtepi32_ps(
+            _mm_loadu_si128((const __m128i*)(s + i))), scale));
+   }
+   else if (sourceFormat == int16Sample && destFormat == int24Sample) {
+      const short *s = (const short*)source;
+      int *d = (int*)dest;
+      const __m128i zero = _mm_setzero_si128();
+      for (; i + 8 <= len; i += 8) {
+         __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+         // Unpacking puts each sample in the high half over zeroes; shift
+         // it down to leave it scaled by 256
+         _mm_storeu_si128((__m128i*)(d + i),
+            _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 8));
+         _mm_storeu_si128((__m128i*)(d + i + 4),
+            _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 8));
+      }
+   }
+#elif defined(USE_NEON_CONVERSIONS)
+   if (sourceFormat == floatSample && destFormat == int16Sample) {
+      const float *s = (const float*)source;
+      short *d = (short*)dest;
+      const float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+      for (; i + 8 <= len; i += 8) {
+         float32x4_t a = vminq_f32(vmaxq_f32(vld1q_f32(s + i), lo), hi);
+         float32x4_t b = vminq_f32(vmaxq_f32(vld1q_f32(s + i + 4), lo), hi);
+         a = vmulq_n_f32(a, CONVERT_DIV16);
+         b = vmulq_n_f32(b, CONVERT_DIV16);
+         vst1q_s16(d + i, vcombine_s16(
+            vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+      }
+   }
+   else if (sourceFormat == floatSample && destFormat == int24Sample) {
+      const float *s = (const float*)source;
+      int *d = (int*)dest;
+      const float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f),
+         max24 = vdupq_n_f32(8388607.0f);
+      for (; i + 4 <= len; i += 4) {
+         float32x4_t a = vminq_f32(vmaxq_f32(vld1q_f32(s + i), lo), hi);
+         a = vminq_f32(vmulq_n_f32(a, CONVERT_DIV24), max24);
+         vst1q_s32(d + i, vcvtnq_s32_f32(a));
+      }
+   }
+   else if (sourceFormat == int16Sample && destFormat == floatSample) {
+      const short *s = (const short*)source;
+      float *d = (float*)dest;
+      for (; i + 8 <= len; i += 8) {
+         int16x8_t x = vld1q_s16(s + i);
+         vst1q_f32(d + i, vmulq_n_f32(
+            vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), 1.0f / CONVERT_DIV16));
+         vst1q_f32(d + i + 4, vmulq_n_f32(
+            vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), 1.0f / CONVERT_DIV16));
+      }
+   }
+   else if (sourceFormat == int24Sample && destFormat == floatSample) {
+      const int *s = (const int*)source;
+      float *d = (float*)dest;
+      for (; i + 4 <= len; i += 4)
+         vst1q_f32(d + i,
+            vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(s + i)), 1.0f / CONVERT_DIV24));
+   }
+#else
+   wxUnusedVar(source);
+   wxUnusedVar(sourceFormat);
+   wxUnusedVar(dest);
+   wxUnusedVar(destFormat);
+   wxUnusedVar(len);
+#endif
+   return i;
+}
+
+// Store floats already scaled to the range of the integer format, rounding
+// and clipping them as the STORE_... macros do
+static void StoreScaled(const float *scaled, samplePtr dest,
+                        sampleFormat destFormat, unsigned int len)
+{
+   unsigned int i = 0;
+   int x;
+   if (destFormat == int16Sample) {
+      short *d = (short*)dest;
+#if defined(USE_SSE2_CONVERSIONS)
+      for (; i + 8 <= len; i += 8)
+         // Signed saturation does the clipping
+         _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi32(
+            _mm_cvtps_epi32(_mm_loadu_ps(scaled + i)),
+            _mm_cvtps_epi32(_mm_loadu_ps(scaled + i + 4))));
+#elif defined(USE_NEON_CONVERSIONS)
+      for (; i + 8 <= len; i += 8)
+         vst1q_s16(d + i, vcombine_s16(
+            vqmovn_s32(vcvtnq_s32_f32(vld1q_f32(scaled + i))),
+            vqmovn_s32(vcvtnq_s32_f32(vld1q_f32(scaled + i + 4)))));
+#endif
+      for (; i < len; ++i)
+         STORE_INT16(d + i, scaled[i]);
+   }
+   else {
+      int *d = (int*)dest;
+#if defined(USE_SSE2_CONVERSIONS)
+      const __m128 lo = _mm_set1_ps(-8388608.0f), hi = _mm_set1_ps(8388607.0f);
+      for (; i + 4 <= len; i += 4)
+         _mm_storeu_si128((__m128i*)(d + i), _mm_cvtps_epi32(
+            _mm_max_ps(_mm_min_ps(_mm_loadu_ps(scaled + i), hi), lo)));
+#elif defined(USE_NEON_CONVERSIONS)
+      const float32x4_t lo = vdupq_n_f32(-8388608.0f),
+         hi = vdupq_n_f32(8388607.0f);
+      for (; i + 4 <= len; i += 4)
+         vst1q_s32(d + i, vcvtnq_s32_f32(
+            vmaxq_f32(vminq_f32(vld1q_f32(scaled + i), hi), lo)));
+#endif
+      for (; i < len; ++i)
+         STORE_INT24(d + i, scaled[i]);
+   }
+}
+
 Dither::Dither()
 {
+    // Seed the noise differently for each instance; zero is the one state
+    // that xorshift never leaves
+    mRandomState = (std::uint32_t(rand()) << 16) ^ std::uint32_t(rand());
+    if (mRandomState == 0)
+        mRandomState = 1;
+
     // On startup, initialize dither by resetting values
     Reset();
 }
@@ -259,6 +460,24 @@ void Dither::Apply(enum DitherType ditherType,
     if (len == 0)
         return; // nothing to do
 
+    // Conversions that add no noise can be vectorized when contiguous
+    if (sourceStride == 1 && destStride == 1 && destFormat != sourceFormat &&
+        (ditherType == DitherType::none ||
+         destFormat == floatSample ||
+         (destFormat == int24Sample && sourceFormat == int16Sample)))
+    {
+        const auto done =
+           ConvertVectorized(source, sourceFormat, dest, destFormat, len);
+        if (done > 0) {
+           if (done < len)
+              Apply(ditherType,
+                 source + done * SAMPLE_SIZE(sourceFormat), sourceFormat,
+                 dest + done * SAMPLE_SIZE(destFormat), destFormat,
+                 len - done);
+           return;
+        }
+    }
+
     if (destFormat == sourceFormat)
     {
         // No need to dither, because source and destination
@@ -324,6 +543,16 @@ void Dither::Apply(enum DitherType ditherType,
         for (i = 0; i < len; i++, d += destStride, s += sourceStride)
             *d = ((int)*s) << 8;
     } else
+    if (sourceFormat == floatSample && sourceStride == 1 && destStride == 1 &&
+        (ditherType == DitherType::rectangle ||
+         ditherType == DitherType::triangle))
+    {
+        // These have no feedback through the rounded result, so the noise
+        // and the conversion can be done for blocks of samples
+        if (ditherType == DitherType::triangle)
+            Reset(); // reset dither filter for this NEW conversion
+        DitherFloats(ditherType, (const float*)source, dest, destFormat, len);
+    } else
     {
         // We must do dithering
         switch (ditherType)
@@ -348,6 +577,72 @@ void Dither::Apply(enum DitherType ditherType,
     }
 }
 
+void Dither::DitherFloats(DitherType ditherType,
+                          const float *source, samplePtr dest,
+                          sampleFormat destFormat, unsigned int len)
+{
+    wxASSERT(destFormat == int16Sample || destFormat == int24Sample);
+    const float scale =
+        destFormat == int16Sample ? CONVERT_DIV16 : CONVERT_DIV24;
+
+    enum : unsigned int { blockSize = 256 };
+    // noise[0] holds the previous noise, for the triangle filter
+    float noise[blockSize + 1];
+    float scaled[blockSize];
+    while (len > 0)
+    {
+        const auto count = std::min<unsigned int>(len, blockSize);
+        FillNoise(noise + 1, count);
+        if (ditherType == DitherType::rectangle)
+        {
+            for (unsigned int i = 0; i < count; i++)
+            {
+                const float sample = source[i] > 1.0f ? 1.0f
+                    : source[i] < -1.0f ? -1.0f : source[i];
+                scaled[i] = sample * scale - noise[i + 1];
+            }
+        }
+        else
+        {
+            noise[0] = mTriangleState;
+            for (unsigned int i = 0; i < count; i++)
+            {
+                const float sample = source[i] > 1.0f ? 1.0f
+                    : source[i] < -1.0f ? -1.0f : source[i];
+                scaled[i] = sample * scale + noise[i + 1] - noise[i];
+            }
+            mTriangleState = noise[count];
+        }
+        StoreScaled(scaled, dest, destFormat, count);
+
+        source += count;
+        dest += count * SAMPLE_SIZE(destFormat);
+        len -= count;
+    }
+}
+
+inline float Dither::Noise()
+{
+    // xorshift32
+    auto state = mRandomState;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    mRandomState = state;
+
+    // Make a float in [1, 2) from the high bits, then shift it
+    const std::uint32_t bits = (state >> 9) | 0x3F800000u;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value - 1.5f;
+}
+
+void Dither::FillNoise(float *noise, unsigned int len)
+{
+    for (unsigned int i = 0; i < len; i++)
+        noise[i] = Noise();
+}
+
 // Dither implementations
 
 // No dither, just return sample
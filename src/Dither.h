@@ -12,6 +12,8 @@
 
 #include "audacity/Types.h" // for samplePtr
 
+#include <cstdint>
+
 template< typename Enum > class EnumSetting;
 
 
@@ -45,6 +47,14 @@ public:
                unsigned int destStride = 1);
 
 private:
+    // Rectangle or triangle dither of contiguous floats, a block at a time
+    void DitherFloats(DitherType ditherType,
+                      const float *source, samplePtr dest,
+                      sampleFormat destFormat, unsigned int len);
+    // Fill with white noise in [-0.5, 0.5)
+    void FillNoise(float *noise, unsigned int len);
+    float Noise();
+
     // Dither methods
     float NoDither(float sample);
     float RectangleDither(float sample);
@@ -60,6 +70,10 @@ private:
     int mPhase;
     float mTriangleState;
     float mBuffer[8 /* = BUF_SIZE */];
+
+    // State of the xorshift generator of the noise; rand() is slower, and
+    // serializes the threads that dither
+    std::uint32_t mRandomState;
 };
 
 #endif /* __AUDACITY_DITHER_H__ */
@@ -32,6 +32,8 @@ a draggable point type.
 #include "Experimental.h"
 
 #include <math.h>
+#include <cmath>
+#include <algorithm>
 
 #include <wx/wxcrtvararg.h>
 #include <wx/brush.h>
@@ -266,6 +268,22 @@ Envelope::Envelope(const Envelope &orig)
    CopyRange(orig, 0, orig.GetNumberOfPoints());
 }
 
+bool Envelope::IsIdenticalTo(const Envelope &other) const
+{
+   if (mDB != other.mDB ||
+       mMinValue != other.mMinValue ||
+       mMaxValue != other.mMaxValue ||
+       mDefaultValue != other.mDefaultValue ||
+       mOffset != other.mOffset ||
+       mTrackLen != other.mTrackLen ||
+       mEnv.size() != other.mEnv.size())
+      return false;
+
+   return std::equal( mEnv.begin(), mEnv.end(), other.mEnv.begin(),
+      [](const EnvPoint &a, const EnvPoint &b){
+         return a.GetT() == b.GetT() && a.GetVal() == b.GetVal(); } );
+}
+
 void Envelope::CopyRange(const Envelope &orig, size_t begin, size_t end)
 {
    size_t len = orig.mEnv.size();
@@ -931,6 +949,42 @@ void Envelope::GetValues( double *buffer, int bufferLen,
    GetValuesRelative( buffer, bufferLen, t0, tstep);
 }
 
+namespace {
+// Like the ramps that MultiplyValues applies, these compute each value from
+// the start of the run, not from the value before, so they vectorize
+
+void FillLinearRamp(double *buffer, int len, double start, double step)
+{
+   for (int ii = 0; ii < len; ++ii)
+      buffer[ii] = start + ii * step;
+}
+
+void FillExponentialRamp(double *buffer, int len, double start, double step)
+{
+   // Keep four values in flight, each advancing by step to the fourth
+   enum { Lanes = 4 };
+   double values[Lanes];
+   values[0] = start;
+   for (int ll = 1; ll < Lanes; ++ll)
+      values[ll] = values[ll - 1] * step;
+   const double stride = (step * step) * (step * step);
+
+   int ii = 0;
+   if (std::isfinite(stride)) {
+      for (; ii + Lanes <= len; ii += Lanes)
+         for (int ll = 0; ll < Lanes; ++ll) {
+            buffer[ii + ll] = values[ll];
+            values[ll] *= stride;
+         }
+   }
+   double value = (ii == 0) ? start : values[0];
+   for (; ii < len; ++ii) {
+      buffer[ii] = value;
+      value *= step;
+   }
+}
+}
+
 void Envelope::GetValuesRelative
    (double *buffer, int bufferLen, double t0, double tstep, bool leftLimit)
    const
@@ -938,112 +992,217 @@ void Envelope::GetValuesRelative
    // JC: If bufferLen ==0 we have probably just allocated a zero sized buffer.
    // wxASSERT( bufferLen > 0 );
 
-   const auto epsilon = tstep / 2;
-   int len = mEnv.size();
+   ValueRuns runs{ *this, bufferLen, t0, tstep, leftLimit };
+   ValueRun run;
+   while (runs.Next(run)) {
+      if (run.exponential)
+         FillExponentialRamp(buffer, run.count, run.start, run.step);
+      else if (run.step == 0.0)
+         std::fill(buffer, buffer + run.count, run.start);
+      else
+         FillLinearRamp(buffer, run.count, run.start, run.step);
+      buffer += run.count;
+   }
+}
 
-   double t = t0;
-   double increment = 0;
-   if ( len > 1 && t <= mEnv[0].GetT() && mEnv[0].GetT() == mEnv[1].GetT() )
-      increment = leftLimit ? -epsilon : epsilon;
+Envelope::ValueRuns::ValueRuns(const Envelope &envelope,
+   int len, double t0, double tstep, bool leftLimit)
+   : mEnvelope{ envelope }
+   , mLen{ len }
+   , mTstep{ tstep }
+   , mEpsilon{ tstep / 2 }
+   , mLeftLimit{ leftLimit }
+   , mT{ t0 }
+{
+   const auto &env = mEnvelope.mEnv;
+   if ( env.size() > 1 && mT <= env[0].GetT() && env[0].GetT() == env[1].GetT() )
+      mIncrement = mLeftLimit ? -mEpsilon : mEpsilon;
+}
 
-   double tprev, vprev, tnext = 0, vnext, vstep = 0;
+bool Envelope::ValueRuns::Next(ValueRun &run)
+{
+   if (mB >= mLen)
+      return false;
 
-   for (int b = 0; b < bufferLen; b++) {
+   const auto &env = mEnvelope.mEnv;
+   const int len = env.size();
+   const int begin = mB;
+
+   // Get easiest cases out the way first...
+   // IF empty envelope THEN default value
+   if (len <= 0) {
+      run = { mLen - mB, mEnvelope.mDefaultValue, 0.0, false };
+      mT += mTstep * (mLen - mB);
+      mB = mLen;
+      return true;
+   }
 
-      // Get easiest cases out the way first...
-      // IF empty envelope THEN default value
-      if (len <= 0) {
-         buffer[b] = mDefaultValue;
-         t += tstep;
-         continue;
-      }
+   const auto beforeFirst = [&]{
+      auto tplus = mT + mIncrement;
+      return mLeftLimit ? tplus <= env[0].GetT() : tplus < env[0].GetT();
+   };
+   const auto afterLast = [&]{
+      auto tplus = mT + mIncrement;
+      return mLeftLimit
+         ? tplus > env[len - 1].GetT() : tplus >= env[len - 1].GetT();
+   };
 
-      auto tplus = t + increment;
+   // IF before envelope THEN first value
+   if ( beforeFirst() ) {
+      do {
+         ++mB;
+         mT += mTstep;
+      } while (mB < mLen && beforeFirst());
+      run = { mB - begin, env[0].GetVal(), 0.0, false };
+      return true;
+   }
+   // IF after envelope THEN last value
+   if ( afterLast() ) {
+      do {
+         ++mB;
+         mT += mTstep;
+      } while (mB < mLen && afterLast());
+      run = { mB - begin, env[len - 1].GetVal(), 0.0, false };
+      return true;
+   }
 
-      // IF before envelope THEN first value
-      if ( leftLimit ? tplus <= mEnv[0].GetT() : tplus < mEnv[0].GetT() ) {
-         buffer[b] = mEnv[0].GetVal();
-         t += tstep;
-         continue;
-      }
-      // IF after envelope THEN last value
-      if ( leftLimit
-            ? tplus > mEnv[len - 1].GetT() : tplus >= mEnv[len - 1].GetT() ) {
-         buffer[b] = mEnv[len - 1].GetVal();
-         t += tstep;
-         continue;
-      }
+   auto tplus = mT + mIncrement;
 
-      // be careful to get the correct limit even in case epsilon == 0
-      if ( b == 0 ||
-           ( leftLimit ? tplus > tnext : tplus >= tnext ) ) {
+   // We're beyond our tnext, so find the next one.
+   // Don't just increment lo or hi because we might
+   // be zoomed far out and that could be a large number of
+   // points to move over.  That's why we binary search.
 
-         // We're beyond our tnext, so find the next one.
-         // Don't just increment lo or hi because we might
-         // be zoomed far out and that could be a large number of
-         // points to move over.  That's why we binary search.
+   int lo,hi;
+   if ( mLeftLimit )
+      mEnvelope.BinarySearchForTime_LeftLimit( lo, hi, tplus );
+   else
+      mEnvelope.BinarySearchForTime( lo, hi, tplus );
+
+   // mEnv[0] is before tplus because of eliminations above, therefore lo >= 0
+   // mEnv[len - 1] is after tplus, therefore hi <= len - 1
+   wxASSERT( lo >= 0 && hi <= len - 1 );
+
+   const double tprev = env[lo].GetT();
+   const double tnext = env[hi].GetT();
+
+   if ( hi + 1 < len && tnext == env[ hi + 1 ].GetT() )
+      // There is a discontinuity after this point-to-point interval.
+      // Usually will stop evaluating in this interval when time is slightly
+      // before tNext, then use the right limit.
+      // This is the right intent
+      // in case small roundoff errors cause a sample time to be a little
+      // before the envelope point time.
+      // Less commonly we want a left limit, so we continue evaluating in
+      // this interval until shortly after the discontinuity.
+      mIncrement = mLeftLimit ? -mEpsilon : mEpsilon;
+   else
+      mIncrement = 0;
 
-         int lo,hi;
-         if ( leftLimit )
-            BinarySearchForTime_LeftLimit( lo, hi, tplus );
-         else
-            BinarySearchForTime( lo, hi, tplus );
-
-         // mEnv[0] is before tplus because of eliminations above, therefore lo >= 0
-         // mEnv[len - 1] is after tplus, therefore hi <= len - 1
-         wxASSERT( lo >= 0 && hi <= len - 1 );
-
-         tprev = mEnv[lo].GetT();
-         tnext = mEnv[hi].GetT();
-
-         if ( hi + 1 < len && tnext == mEnv[ hi + 1 ].GetT() )
-            // There is a discontinuity after this point-to-point interval.
-            // Usually will stop evaluating in this interval when time is slightly
-            // before tNext, then use the right limit.
-            // This is the right intent
-            // in case small roundoff errors cause a sample time to be a little
-            // before the envelope point time.
-            // Less commonly we want a left limit, so we continue evaluating in
-            // this interval until shortly after the discontinuity.
-            increment = leftLimit ? -epsilon : epsilon;
-         else
-            increment = 0;
+   const double vprev = mEnvelope.GetInterpolationStartValueAtPoint( lo );
+   const double vnext = mEnvelope.GetInterpolationStartValueAtPoint( hi );
 
-         vprev = GetInterpolationStartValueAtPoint( lo );
-         vnext = GetInterpolationStartValueAtPoint( hi );
+   // Interpolate, either linear or log depending on mDB.
+   double dt = (tnext - tprev);
+   double to = mT - tprev;
+   double v, vstep;
+   if (dt > 0.0)
+   {
+      v = (vprev * (dt - to) + vnext * to) / dt;
+      vstep = (vnext - vprev) * mTstep / dt;
+   }
+   else
+   {
+      v = vnext;
+      vstep = 0.0;
+   }
 
-         // Interpolate, either linear or log depending on mDB.
-         double dt = (tnext - tprev);
-         double to = t - tprev;
-         double v;
-         if (dt > 0.0)
-         {
-            v = (vprev * (dt - to) + vnext * to) / dt;
-            vstep = (vnext - vprev) * tstep / dt;
-         }
-         else
-         {
-            v = vnext;
-            vstep = 0.0;
-         }
+   // An adjustment if logarithmic scale.
+   if( mEnvelope.mDB )
+   {
+      v = pow(10.0, v);
+      vstep = pow( 10.0, vstep );
+   }
 
-         // An adjustment if logarithmic scale.
-         if( mDB )
-         {
-            v = pow(10.0, v);
-            vstep = pow( 10.0, vstep );
-         }
+   // Continue in this interval until beyond tnext; tnext is not after the
+   // last point, so this also stops before the after-envelope case
+   const auto inInterval = [&]{
+      auto tplus = mT + mIncrement;
+      return mLeftLimit ? !(tplus > tnext) : !(tplus >= tnext);
+   };
+   do {
+      ++mB;
+      mT += mTstep;
+   } while (mB < mLen && inInterval());
+
+   run = { mB - begin, v, vstep, mEnvelope.mDB };
+   return true;
+}
 
-         buffer[b] = v;
-      } else {
-         if (mDB){
-            buffer[b] = buffer[b - 1] * vstep;
-         }else{
-            buffer[b] = buffer[b - 1] + vstep;
+auto Envelope::GetValueRuns(int len, double t0, double tstep) const
+   -> ValueRuns
+{
+   // Convert t0 from absolute to clip-relative time
+   return { *this, len, t0 - mOffset, tstep, false };
+}
+
+namespace {
+// These loops are simple enough for compilers to vectorize
+
+void ScaleSamples(float *buffer, int len, float gain)
+{
+   for (int ii = 0; ii < len; ++ii)
+      buffer[ii] *= gain;
+}
+
+void ApplyLinearRamp(float *buffer, int len, double start, double step)
+{
+   for (int ii = 0; ii < len; ++ii)
+      buffer[ii] *= float(start + ii * step);
+}
+
+void ApplyExponentialRamp(float *buffer, int len, double start, double step)
+{
+   // Keep four gains in flight, each advancing by step to the fourth
+   enum { Lanes = 4 };
+   double gains[Lanes];
+   gains[0] = start;
+   for (int ll = 1; ll < Lanes; ++ll)
+      gains[ll] = gains[ll - 1] * step;
+   const double stride = (step * step) * (step * step);
+
+   int ii = 0;
+   if (std::isfinite(stride)) {
+      for (; ii + Lanes <= len; ii += Lanes)
+         for (int ll = 0; ll < Lanes; ++ll) {
+            buffer[ii + ll] *= float(gains[ll]);
+            gains[ll] *= stride;
          }
-      }
+   }
+   double gain = (ii == 0) ? start : gains[0];
+   for (; ii < len; ++ii) {
+      buffer[ii] *= float(gain);
+      gain *= step;
+   }
+}
+}
 
-      t += tstep;
+void Envelope::MultiplyValues(
+   float *buffer, int len, double t0, double tstep) const
+{
+   auto runs = GetValueRuns(len, t0, tstep);
+   ValueRun run;
+   while (runs.Next(run)) {
+      if (run.exponential ? run.step == 1.0 : run.step == 0.0) {
+         // Nothing to do for unity
+         if (run.start != 1.0)
+            ScaleSamples(buffer, run.count, run.start);
+      }
+      else if (run.exponential)
+         ApplyExponentialRamp(buffer, run.count, run.start, run.step);
+      else
+         ApplyLinearRamp(buffer, run.count, run.start, run.step);
+      buffer += run.count;
    }
 }
 
@@ -1292,6 +1451,78 @@ double Envelope::IntegralOfInverse( double t0, double t1 ) const
    }
 }
 
+Envelope::InverseIntegrals::InverseIntegrals( const Envelope &envelope )
+   : mEnvelope{ envelope }
+{
+   const auto &env = envelope.mEnv;
+   const auto count = env.size();
+   mTimes.reserve( count );
+   mIntegrals.reserve( count );
+   double total = 0.0;
+   for ( size_t i = 0; i < count; ++i ) {
+      if ( i > 0 )
+         total += IntegrateInverseInterpolated(
+            env[i - 1].GetVal(), env[i].GetVal(),
+            env[i].GetT() - env[i - 1].GetT(), envelope.mDB );
+      mTimes.push_back( env[i].GetT() );
+      mIntegrals.push_back( total );
+   }
+}
+
+double Envelope::InverseIntegrals::Primitive( double t ) const
+{
+   const auto &env = mEnvelope.mEnv;
+   const auto count = mTimes.size();
+   if ( t < mTimes[0] )
+      return ( t - mTimes[0] ) / env[0].GetVal();
+   if ( t >= mTimes[count - 1] )
+      return mIntegrals[count - 1] +
+         ( t - mTimes[count - 1] ) / env[count - 1].GetVal();
+
+   // The last point not after t, and the first point after it
+   const auto hi =
+      std::upper_bound( mTimes.begin(), mTimes.end(), t ) - mTimes.begin();
+   const auto lo = hi - 1;
+   const double y1 = env[lo].GetVal();
+   const double y2 = InterpolatePoints( y1, env[hi].GetVal(),
+      ( t - mTimes[lo] ) / ( mTimes[hi] - mTimes[lo] ), mEnvelope.mDB );
+   return mIntegrals[lo] +
+      IntegrateInverseInterpolated( y1, y2, t - mTimes[lo], mEnvelope.mDB );
+}
+
+double Envelope::InverseIntegrals::IntegralOfInverse(
+   double t0, double t1 ) const
+{
+   if ( mTimes.empty() )
+      // 'empty' envelope
+      return ( t1 - t0 ) / mEnvelope.mDefaultValue;
+   const auto offset = mEnvelope.mOffset;
+   return Primitive( t1 - offset ) - Primitive( t0 - offset );
+}
+
+double Envelope::InverseIntegrals::AverageOfInverse(
+   double t0, double t1 ) const
+{
+   if ( t0 == t1 ) {
+      if ( mTimes.empty() )
+         return 1.0 / mEnvelope.mDefaultValue;
+      // Don't use GetValue, which changes the search guess
+      const auto &env = mEnvelope.mEnv;
+      const auto t = t0 - mEnvelope.mOffset;
+      if ( t < mTimes.front() )
+         return 1.0 / env.front().GetVal();
+      if ( t >= mTimes.back() )
+         return 1.0 / env.back().GetVal();
+      const auto hi =
+         std::upper_bound( mTimes.begin(), mTimes.end(), t ) - mTimes.begin();
+      const auto lo = hi - 1;
+      return 1.0 / InterpolatePoints( env[lo].GetVal(), env[hi].GetVal(),
+         ( t - mTimes[lo] ) / ( mTimes[hi] - mTimes[lo] ), mEnvelope.mDB );
+   }
+   else
+      return IntegralOfInverse( t0, t1 ) / ( t1 - t0 );
+}
+
 double Envelope::SolveIntegralOfInverse( double t0, double area ) const
 {
    if(area == 0.0)
@@ -96,6 +96,9 @@ public:
    // and repaired
    bool ConsistencyCheck();
 
+   // Whether other has the same points, range and extent, as a copy would
+   bool IsIdenticalTo(const Envelope &other) const;
+
    double GetOffset() const { return mOffset; }
    double GetTrackLen() const { return mTrackLen; }
 
@@ -151,6 +154,49 @@ public:
     * more than one value in a row. */
    void GetValues(double *buffer, int len, double t0, double tstep) const;
 
+   /** \brief A run of consecutive values, as GetValues() computes them,
+    * that follow one segment of the envelope.
+    *
+    * The first value is start; each next one is the previous times step if
+    * exponential, else the previous plus step.  Constant runs have step 0
+    * and are not exponential. */
+   struct ValueRun {
+      int count;
+      double start;
+      double step;
+      bool exponential;
+   };
+
+   /** \brief Visits the same values as GetValues(), a run at a time. */
+   class ValueRuns {
+   public:
+      /** \brief Get the next run; false when all values are visited */
+      bool Next(ValueRun &run);
+
+   private:
+      friend Envelope;
+      ValueRuns(const Envelope &envelope,
+         int len, double t0, double tstep, bool leftLimit);
+
+      const Envelope &mEnvelope;
+      const int mLen;
+      const double mTstep;
+      const double mEpsilon;
+      const bool mLeftLimit;
+      int mB{ 0 };
+      double mT;
+      double mIncrement{ 0 };
+   };
+
+   /** \brief Get runs of values for len samples, from absolute time t0 */
+   ValueRuns GetValueRuns(int len, double t0, double tstep) const;
+
+   /** \brief Multiply samples by the values GetValues() would give.
+    *
+    * No buffer of values is needed; runs of unity are skipped and other
+    * runs are applied as ramps. */
+   void MultiplyValues(float *buffer, int len, double t0, double tstep) const;
+
    // Guarantee an envelope point at the end of the domain.
    void Cap( double sampleDur );
 
@@ -177,6 +223,26 @@ public:
    double IntegralOfInverse( double t0, double t1 ) const;
    double SolveIntegralOfInverse( double t0, double area) const;
 
+   // The integral of the inverse up to each point, found once, so that
+   // IntegralOfInverse over any range is a difference of two lookups.  It
+   // neither searches the envelope nor changes its search guess, so threads
+   // may share it; it is invalid once the envelope changes.
+   class InverseIntegrals {
+   public:
+      explicit InverseIntegrals( const Envelope &envelope );
+
+      double IntegralOfInverse( double t0, double t1 ) const;
+      double AverageOfInverse( double t0, double t1 ) const;
+
+   private:
+      // Integral of the inverse from the first point to relative time t
+      double Primitive( double t ) const;
+
+      const Envelope &mEnvelope;
+      std::vector<double> mTimes;
+      std::vector<double> mIntegrals;
+   };
+
    void print() const;
    void testMe();
 
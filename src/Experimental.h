@@ -189,6 +189,10 @@
 // Define to enable the device change handler
 //#define EXPERIMENTAL_DEVICE_CHANGE_HANDLER
 
+// Define, for debug builds, to report heap allocations and mutex locks in the
+// audio callback, in Help > Diagnostics; see RealtimeSafety
+//#define EXPERIMENTAL_REALTIME_SAFETY_CHECKS
+
 // Define for NEW noise reduction effect from Paul Licameli.
 #define EXPERIMENTAL_NOISE_REDUCTION
 
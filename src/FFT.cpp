@@ -51,6 +51,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 
 #include "RealFFTf.h"
 
@@ -512,8 +517,8 @@ void NewWindowFunc(int whichFunction, size_t NumSamplesIn, bool extraSample, flo
    }
 }
 
-// See cautions in FFT.h !
-void WindowFunc(int whichFunction, size_t NumSamples, float *in)
+// Whether WindowFunc is NewWindowFunc with extraSample
+static bool LegacyExtraSample(int whichFunction)
 {
    bool extraSample = false;
    switch (whichFunction)
@@ -533,7 +538,14 @@ void WindowFunc(int whichFunction, size_t NumSamples, float *in)
       // but I think that never happened, so I am not bothering to preserve that
       break;
    }
-   NewWindowFunc(whichFunction, NumSamples, extraSample, in);
+   return extraSample;
+}
+
+// See cautions in FFT.h !
+void WindowFunc(int whichFunction, size_t NumSamples, float *in)
+{
+   NewWindowFunc(whichFunction, NumSamples,
+      LegacyExtraSample(whichFunction), in);
 }
 
 void DerivativeOfWindowFunc(int whichFunction, size_t NumSamples, bool extraSample, float *in)
@@ -699,3 +711,63 @@ void DerivativeOfWindowFunc(int whichFunction, size_t NumSamples, bool extraSamp
       wxFprintf(stderr, "FFT::DerivativeOfWindowFunc - Invalid window function: %d\n", whichFunction);
    }
 }
+
+namespace {
+
+struct WindowTable {
+   Floats storage;
+   const float *values;
+};
+
+// Keyed by function, size, extraSample and derivative
+using WindowTableKey = std::tuple<int, size_t, bool, bool>;
+
+std::mutex &WindowTablesMutex()
+{
+   static std::mutex mutex;
+   return mutex;
+}
+
+std::map<WindowTableKey, WindowTable> &WindowTables()
+{
+   static std::map<WindowTableKey, WindowTable> tables;
+   return tables;
+}
+
+}
+
+const float *GetWindowTable(int whichFunction, size_t NumSamples,
+                            bool extraSample, bool derivative)
+{
+   std::lock_guard<std::mutex> locker{ WindowTablesMutex() };
+
+   auto &tables = WindowTables();
+   const WindowTableKey key{ whichFunction, NumSamples, extraSample, derivative };
+   auto iter = tables.find(key);
+   if (iter != tables.end())
+      return iter->second.values;
+
+   // Align to a cache line, which suits any vector loads
+   enum : size_t { Alignment = 64 };
+   WindowTable table;
+   table.storage.reinit(NumSamples + Alignment / sizeof(float));
+   void *pointer = table.storage.get();
+   size_t space = (NumSamples + Alignment / sizeof(float)) * sizeof(float);
+   const auto values = static_cast<float*>(
+      std::align(Alignment, NumSamples * sizeof(float), pointer, space));
+   std::fill(values, values + NumSamples, 1.0f);
+   if (derivative)
+      DerivativeOfWindowFunc(whichFunction, NumSamples, extraSample, values);
+   else
+      NewWindowFunc(whichFunction, NumSamples, extraSample, values);
+   table.values = values;
+
+   // Map nodes do not move, so the pointer stays valid
+   return tables.emplace(key, std::move(table)).first->second.values;
+}
+
+const float *GetLegacyWindowTable(int whichFunction, size_t NumSamples)
+{
+   return GetWindowTable(whichFunction, NumSamples,
+      LegacyExtraSample(whichFunction));
+}
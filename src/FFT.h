@@ -136,6 +136,21 @@ void NewWindowFunc(int whichFunction, size_t NumSamples, bool extraSample, float
  */
 void DerivativeOfWindowFunc(int whichFunction, size_t NumSamples, bool extraSample, float *data);
 
+/*
+ * The values by which NewWindowFunc, or DerivativeOfWindowFunc if
+ * derivative is true, would multiply data, for the same arguments
+ * Each table is made once, and kept for the life of the program; tables
+ * are never changed, so that any thread may read them
+ * The pointer is aligned for vector loads
+ */
+const float *GetWindowTable(int whichFunction, size_t NumSamples,
+                            bool extraSample, bool derivative = false);
+
+/*
+ * The same, for WindowFunc
+ */
+const float *GetLegacyWindowTable(int whichFunction, size_t NumSamples);
+
 /*
  * Returns the name of the windowing function (for UI display)
  */
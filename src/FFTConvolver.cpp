@@ -0,0 +1,214 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FFTConvolver.cpp
+
+*******************************************************************//**
+
+\class FFTConvolver
+\brief Fast convolution of a channel with a long finite impulse response,
+for equalization and other filters given by their impulse responses.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "FFTConvolver.h"
+
+#include <algorithm>
+#include <string.h>
+
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_CONVOLUTION
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_CONVOLUTION
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// sum += x * h, complex, for len bins with real and imaginary parts apart
+void MultiplyAccumulate(const float *xReal, const float *xImag,
+   const float *hReal, const float *hImag,
+   float *sumReal, float *sumImag, size_t len)
+{
+   size_t ii = 0;
+#if defined(USE_SSE2_CONVOLUTION)
+   for (; ii + 4 <= len; ii += 4) {
+      const __m128 a = _mm_loadu_ps(xReal + ii);
+      const __m128 b = _mm_loadu_ps(xImag + ii);
+      const __m128 c = _mm_loadu_ps(hReal + ii);
+      const __m128 d = _mm_loadu_ps(hImag + ii);
+      _mm_storeu_ps(sumReal + ii, _mm_add_ps(_mm_loadu_ps(sumReal + ii),
+         _mm_sub_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d))));
+      _mm_storeu_ps(sumImag + ii, _mm_add_ps(_mm_loadu_ps(sumImag + ii),
+         _mm_add_ps(_mm_mul_ps(a, d), _mm_mul_ps(b, c))));
+   }
+#elif defined(USE_NEON_CONVOLUTION)
+   for (; ii + 4 <= len; ii += 4) {
+      const float32x4_t a = vld1q_f32(xReal + ii);
+      const float32x4_t b = vld1q_f32(xImag + ii);
+      const float32x4_t c = vld1q_f32(hReal + ii);
+      const float32x4_t d = vld1q_f32(hImag + ii);
+      vst1q_f32(sumReal + ii, vmlsq_f32(
+         vmlaq_f32(vld1q_f32(sumReal + ii), a, c), b, d));
+      vst1q_f32(sumImag + ii, vmlaq_f32(
+         vmlaq_f32(vld1q_f32(sumImag + ii), a, d), b, c));
+   }
+#endif
+   for (; ii < len; ++ii) {
+      const float a = xReal[ii], b = xImag[ii];
+      const float c = hReal[ii], d = hImag[ii];
+      sumReal[ii] += a * c - b * d;
+      sumImag[ii] += a * d + b * c;
+   }
+}
+
+// Transform 2 * blockSize samples in buffer, and store the spectrum in
+// natural order, the Fs/2 component as the imaginary part of the DC
+void Transform(const FFTParam *hFFT, float *buffer, size_t blockSize,
+   float *real, float *imag)
+{
+   RealFFTf(buffer, hFFT);
+   real[0] = buffer[0];
+   imag[0] = buffer[1];
+   const int *pBitReversed = &hFFT->BitReversed[1];
+   for (size_t ii = 1; ii < blockSize; ++ii) {
+      const int kk = *pBitReversed++;
+      real[ii] = buffer[kk];
+      imag[ii] = buffer[kk + 1];
+   }
+}
+
+size_t ChooseBlockSize(size_t length)
+{
+   size_t blockSize = 2;
+   while (blockSize < length && blockSize < FFTConvolutionKernel::MaxBlockSize)
+      blockSize *= 2;
+   return blockSize;
+}
+
+}
+
+FFTConvolutionKernel::FFTConvolutionKernel(
+   const float *impulse, size_t length, size_t blockSize)
+: mLength{ length }
+, mBlockSize{ blockSize ? blockSize : ChooseBlockSize(length) }
+, mPartitions{ std::max<size_t>(1, (length + mBlockSize - 1) / mBlockSize) }
+, mReal{ mPartitions * mBlockSize }
+, mImag{ mPartitions * mBlockSize }
+{
+   wxASSERT(mBlockSize >= 2 && (mBlockSize & (mBlockSize - 1)) == 0);
+
+   // Each partition is padded to twice the block size, so that the
+   // circular convolution of a transform of two blocks of input gives the
+   // linear convolution of the second
+   const auto fftSize = 2 * mBlockSize;
+   const auto hFFT = GetFFT(fftSize);
+   Floats buffer{ fftSize };
+   for (size_t pp = 0; pp < mPartitions; ++pp) {
+      const auto first = std::min(length, pp * mBlockSize);
+      const auto count = std::min(length - first, mBlockSize);
+      std::fill(buffer.get(), buffer.get() + fftSize, 0.0f);
+      std::copy(impulse + first, impulse + first + count, buffer.get());
+      Transform(hFFT.get(), buffer.get(), mBlockSize,
+         mReal.get() + pp * mBlockSize, mImag.get() + pp * mBlockSize);
+   }
+}
+
+FFTConvolver::FFTConvolver(
+   std::shared_ptr<const FFTConvolutionKernel> pKernel)
+: mpKernel{ std::move(pKernel) }
+, mBlockSize{ mpKernel->GetBlockSize() }
+, mPartitions{ mpKernel->GetPartitions() }
+, hFFT{ GetFFT(2 * mBlockSize) }
+, mInput{ 2 * mBlockSize, true }
+, mOutput{ mBlockSize, true }
+, mHistoryReal{ mPartitions * mBlockSize, true }
+, mHistoryImag{ mPartitions * mBlockSize, true }
+, mSumReal{ mBlockSize }
+, mSumImag{ mBlockSize }
+, mFFTBuffer{ 2 * mBlockSize }
+, mTimeBuffer{ 2 * mBlockSize }
+{
+}
+
+void FFTConvolver::Reset()
+{
+   std::fill(mInput.get(), mInput.get() + 2 * mBlockSize, 0.0f);
+   std::fill(mOutput.get(), mOutput.get() + mBlockSize, 0.0f);
+   std::fill(mHistoryReal.get(),
+      mHistoryReal.get() + mPartitions * mBlockSize, 0.0f);
+   std::fill(mHistoryImag.get(),
+      mHistoryImag.get() + mPartitions * mBlockSize, 0.0f);
+   mPosition = 0;
+   mNewest = 0;
+}
+
+void FFTConvolver::Process(const float *input, float *output, size_t len)
+{
+   while (len > 0) {
+      const auto count = std::min(len, mBlockSize - mPosition);
+      // Take the input first, in case output is the same buffer
+      memmove(&mInput[mBlockSize + mPosition], input, count * sizeof(float));
+      memmove(output, &mOutput[mPosition], count * sizeof(float));
+      input += count;
+      output += count;
+      len -= count;
+      mPosition += count;
+
+      if (mPosition == mBlockSize) {
+         ProcessBlock();
+         mPosition = 0;
+      }
+   }
+}
+
+void FFTConvolver::ProcessBlock()
+{
+   const auto &kernel = *mpKernel;
+
+   // Transform the previous and the current blocks of input
+   mNewest = (mNewest + 1) % mPartitions;
+   memmove(&mFFTBuffer[0], &mInput[0], 2 * mBlockSize * sizeof(float));
+   Transform(hFFT.get(), mFFTBuffer.get(), mBlockSize,
+      &mHistoryReal[mNewest * mBlockSize],
+      &mHistoryImag[mNewest * mBlockSize]);
+
+   // Multiply the spectrum of each block by that of the partition as many
+   // blocks later in the kernel, and sum
+   std::fill(mSumReal.get(), mSumReal.get() + mBlockSize, 0.0f);
+   std::fill(mSumImag.get(), mSumImag.get() + mBlockSize, 0.0f);
+   for (size_t pp = 0; pp < mPartitions; ++pp) {
+      const auto offset =
+         ((mNewest + mPartitions - pp) % mPartitions) * mBlockSize;
+      const float *xReal = &mHistoryReal[offset];
+      const float *xImag = &mHistoryImag[offset];
+      const float *hReal = &kernel.mReal[pp * mBlockSize];
+      const float *hImag = &kernel.mImag[pp * mBlockSize];
+      // DC and Fs/2 components are purely real
+      mSumReal[0] += xReal[0] * hReal[0];
+      mSumImag[0] += xImag[0] * hImag[0];
+      MultiplyAccumulate(xReal + 1, xImag + 1, hReal + 1, hImag + 1,
+         &mSumReal[1], &mSumImag[1], mBlockSize - 1);
+   }
+
+   // Inverse FFT; the second half is the output for the current block,
+   // the first half being wrapped around
+   mFFTBuffer[0] = mSumReal[0];
+   mFFTBuffer[1] = mSumImag[0];
+   for (size_t ii = 1; ii < mBlockSize; ++ii) {
+      mFFTBuffer[2 * ii] = mSumReal[ii];
+      mFFTBuffer[2 * ii + 1] = mSumImag[ii];
+   }
+   InverseRealFFTf(mFFTBuffer.get(), hFFT.get());
+   ReorderToTime(hFFT.get(), mFFTBuffer.get(), mTimeBuffer.get());
+   memmove(&mOutput[0], &mTimeBuffer[mBlockSize], mBlockSize * sizeof(float));
+
+   // The current block becomes the previous
+   memmove(&mInput[0], &mInput[mBlockSize], mBlockSize * sizeof(float));
+}
@@ -0,0 +1,95 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FFTConvolver.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_FFT_CONVOLVER__
+#define __AUDACITY_FFT_CONVOLVER__
+
+#include "MemoryX.h"
+#include "RealFFTf.h"
+
+/// The spectra of the partitions of a finite impulse response, all of one
+/// block size, for FFTConvolver.  Immutable, so that convolvers of several
+/// channels, on any threads, may share it.
+class FFTConvolutionKernel final
+{
+public:
+   /// Blocks larger than this make no more than one partition of any impulse
+   enum : size_t { MaxBlockSize = 8192 };
+
+   /// blockSize must be a power of two, at least 2; if 0, it is the least
+   /// power of two not less than the length, up to MaxBlockSize
+   FFTConvolutionKernel(
+      const float *impulse, size_t length, size_t blockSize = 0);
+   FFTConvolutionKernel( const FFTConvolutionKernel& ) PROHIBITED;
+   FFTConvolutionKernel &operator=( const FFTConvolutionKernel& ) PROHIBITED;
+
+   size_t GetLength() const { return mLength; }
+   size_t GetBlockSize() const { return mBlockSize; }
+   size_t GetPartitions() const { return mPartitions; }
+
+private:
+   friend class FFTConvolver;
+
+   const size_t mLength;
+   const size_t mBlockSize;
+   const size_t mPartitions;
+   // mPartitions spectra of mBlockSize bins each, with real and imaginary
+   // parts apart, and the Fs/2 component as the imaginary part of the DC
+   Floats mReal;
+   Floats mImag;
+};
+
+/// Convolves one channel with a kernel, by uniformly partitioned overlap-save:
+/// each block of input is transformed once, and the spectra of the latest
+/// blocks are multiplied by those of the partitions and summed.
+class FFTConvolver final
+{
+public:
+   explicit FFTConvolver(std::shared_ptr<const FFTConvolutionKernel> pKernel);
+   FFTConvolver( const FFTConvolver& ) PROHIBITED;
+   FFTConvolver &operator=( const FFTConvolver& ) PROHIBITED;
+
+   const FFTConvolutionKernel &GetKernel() const { return *mpKernel; }
+
+   /// Output is the convolution delayed by this many samples
+   size_t GetLatency() const { return mBlockSize; }
+
+   /// Take len more samples of input and give as many of output; output may
+   /// be the same buffer as input
+   void Process(const float *input, float *output, size_t len);
+
+   /// Forget all input, as if newly constructed
+   void Reset();
+
+private:
+   void ProcessBlock();
+
+   const std::shared_ptr<const FFTConvolutionKernel> mpKernel;
+   const size_t mBlockSize;
+   const size_t mPartitions;
+   HFFT hFFT;
+
+   // The previous and the current block of input
+   Floats mInput;
+   // Output for the previous block
+   Floats mOutput;
+   size_t mPosition{ 0 };
+
+   // Spectra of the latest mPartitions blocks of input, as in the kernel;
+   // a ring, in which mNewest is the index of the latest
+   Floats mHistoryReal;
+   Floats mHistoryImag;
+   size_t mNewest{ 0 };
+
+   Floats mSumReal;
+   Floats mSumImag;
+   Floats mFFTBuffer;
+   Floats mTimeBuffer;
+};
+
+#endif
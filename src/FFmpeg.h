@@ -146,6 +146,12 @@ extern "C" {
       #ifndef AV_CODEC_CAP_SMALL_LAST_FRAME
          #define AV_CODEC_CAP_SMALL_LAST_FRAME CODEC_CAP_SMALL_LAST_FRAME
       #endif
+      #ifndef AV_CODEC_CAP_FRAME_THREADS
+         #define AV_CODEC_CAP_FRAME_THREADS CODEC_CAP_FRAME_THREADS
+      #endif
+      #ifndef AV_CODEC_CAP_SLICE_THREADS
+         #define AV_CODEC_CAP_SLICE_THREADS CODEC_CAP_SLICE_THREADS
+      #endif
    #endif
 
 }
@@ -794,6 +800,12 @@ extern "C" {
       (AVPacket *pkt),
       (pkt)
    );
+   FFMPEG_FUNCTION_WITH_RETURN(
+      int,
+      av_dup_packet,
+      (AVPacket *pkt),
+      (pkt)
+   );
    FFMPEG_FUNCTION_WITH_RETURN(
       AVFifoBuffer*,
       av_fifo_alloc,
@@ -47,6 +47,20 @@ used throughout Audacity into this one place.
 #include <windows.h>
 #endif
 
+#if defined(__WXMAC__)
+#include <AvailabilityMacros.h>
+// clonefile() is only in macOS 10.12 and later
+#if MAC_OS_X_VERSION_MIN_REQUIRED >= 101200
+#define HAVE_CLONEFILE 1
+#include <sys/clonefile.h>
+#endif
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/fs.h> // for FICLONE
+#endif
+
 static wxString gDataDir;
 
 const FileNames::FileType
@@ -186,6 +200,39 @@ bool FileNames::HardLinkFile( const FilePath& file1, const FilePath& file2 )
 #endif
 }
 
+bool FileNames::CloneFile( const FilePath& file1, const FilePath& file2 )
+{
+#if defined(HAVE_CLONEFILE)
+
+   return 0 == ::clonefile( file1.c_str(), file2.c_str(), 0 );
+
+#elif defined(__linux__) && defined(FICLONE)
+
+   const int in = ::open( file1.c_str(), O_RDONLY );
+   if (in < 0)
+      return false;
+   const int out = ::open( file2.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666 );
+   if (out < 0) {
+      ::close( in );
+      return false;
+   }
+   const bool result = 0 == ::ioctl( out, FICLONE, in );
+   ::close( in );
+   ::close( out );
+   if (!result)
+      // Maybe another file system, or one that can't share extents
+      ::unlink( file2.c_str() );
+   return result;
+
+#else
+
+   // No cheap clones here, such as on Windows; callers copy instead
+   (void) file1, (void) file2;
+   return false;
+
+#endif
+}
+
 wxString FileNames::MkDir(const wxString &Str)
 {
    // Behaviour of wxFileName::DirExists() and wxFileName::MkDir() has
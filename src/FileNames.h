@@ -63,6 +63,11 @@ namespace FileNames
    // storage devices.
    bool HardLinkFile( const FilePath& file1, const FilePath& file2);
 
+   // Make file2 a copy-on-write clone of file1, sharing its storage, if the
+   // file system can (reflinks on Btrfs and XFS, clonefile on APFS).  file2
+   // must not exist yet.
+   bool CloneFile( const FilePath& file1, const FilePath& file2);
+
    wxString MkDir(const wxString &Str);
    wxString TempDir();
 
@@ -36,6 +36,9 @@ the mouse around.
 #include "FreqWindow.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 #include <wx/setup.h> // for wxUSE_* macros
 
@@ -59,6 +62,7 @@ the mouse around.
 
 #include <wx/textctrl.h>
 #include <wx/textfile.h>
+#include <wx/utils.h>
 
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
@@ -572,59 +576,33 @@ bool FrequencyPlotDialog::Show(bool show)
 
 void FrequencyPlotDialog::GetAudio()
 {
-   mData.reset();
+   // Nothing is read yet; Recalc streams the samples, so that there is no
+   // limit on the length of the selection
+   mTracks.clear();
    mDataLen = 0;
 
    int selcount = 0;
-   bool warning = false;
    for (auto track : TrackList::Get( *mProject ).Selected< const WaveTrack >()) {
       auto &selectedRegion = ViewInfo::Get( *mProject ).selectedRegion;
+      auto start = track->TimeToLongSamples(selectedRegion.t0());
       if (selcount==0) {
          mRate = track->GetRate();
-         auto start = track->TimeToLongSamples(selectedRegion.t0());
          auto end = track->TimeToLongSamples(selectedRegion.t1());
-         auto dataLen = end - start;
-         if (dataLen > 10485760) {
-            warning = true;
-            mDataLen = 10485760;
-         }
-         else
-            // dataLen is not more than 10 * 2 ^ 20
-            mDataLen = dataLen.as_size_t();
-         mData = Floats{ mDataLen };
-         // Don't allow throw for bad reads
-         track->Get((samplePtr)mData.get(), floatSample, start, mDataLen,
-                    fillZero, false);
+         mDataLen = std::max( sampleCount( 0 ), end - start );
       }
       else {
          if (track->GetRate() != mRate) {
             AudacityMessageBox(
                XO(
 "To plot the spectrum, all selected tracks must be the same sample rate.") );
-            mData.reset();
+            mTracks.clear();
             mDataLen = 0;
             return;
          }
-         auto start = track->TimeToLongSamples(selectedRegion.t0());
-         Floats buffer2{ mDataLen };
-         // Again, stop exceptions
-         track->Get((samplePtr)buffer2.get(), floatSample, start, mDataLen,
-                    fillZero, false);
-         for (size_t i = 0; i < mDataLen; i++)
-            mData[i] += buffer2[i];
       }
+      mTracks.push_back( { track->SharedPointer< const WaveTrack >(), start } );
       selcount++;
    }
-
-   if (selcount == 0)
-      return;
-
-   if (warning) {
-      auto msg = XO(
-"Too much audio was selected. Only the first %.1f seconds of audio will be analyzed.")
-         .Format(mDataLen / mRate);
-      AudacityMessageBox( msg );
-   }
 }
 
 void FrequencyPlotDialog::OnSize(wxSizeEvent & WXUNUSED(event))
@@ -660,7 +638,8 @@ void FrequencyPlotDialog::DrawBackground(wxMemoryDC & dc)
 
 void FrequencyPlotDialog::DrawPlot()
 {
-   if (!mData || mDataLen < mWindowSize || mAnalyst->GetProcessedSize() == 0) {
+   if (mTracks.empty() || mDataLen < mWindowSize ||
+       mAnalyst->GetProcessedSize() == 0) {
       wxMemoryDC memDC;
 
       vRuler->ruler.SetLog(false);
@@ -878,7 +857,7 @@ void FrequencyPlotDialog::PlotPaint(wxPaintEvent & event)
 
    dc.DrawBitmap( *mBitmap, 0, 0, true );
    // Fix for Bug 1226 "Plot Spectrum freezes... if insufficient samples selected"
-   if (!mData || mDataLen < mWindowSize)
+   if (mTracks.empty() || mDataLen < mWindowSize)
       return;
 
    dc.SetFont(mFreqFont);
@@ -999,7 +978,7 @@ void FrequencyPlotDialog::SendRecalcEvent()
 
 void FrequencyPlotDialog::Recalc()
 {
-   if (!mData || mDataLen < mWindowSize) {
+   if (mTracks.empty() || mDataLen < mWindowSize) {
       DrawPlot();
       return;
    }
@@ -1019,9 +998,55 @@ void FrequencyPlotDialog::Recalc()
          blocker.emplace(this);
       wxYieldIfNeeded();
 
-      mAnalyst->Calculate(alg, windowFunc, mWindowSize, mRate,
-         mData.get(), mDataLen,
-         &mYMin, &mYMax, mProgress);
+      // The sum of the selected tracks, read forward block by block
+      std::vector< std::unique_ptr<WaveTrackCache> > caches;
+      for (const auto &source : mTracks) {
+         caches.push_back( std::make_unique<WaveTrackCache>( source.track ) );
+         caches.back()->SetReadAhead( true );
+      }
+      auto read = [this, &caches]
+      ( sampleCount start, size_t len, float *buffer ){
+         std::fill( buffer, buffer + len, 0.0f );
+         for (size_t ii = 0; ii < caches.size(); ++ii) {
+            // Don't allow throw for bad reads
+            auto samples = reinterpret_cast<const float*>( caches[ii]->Get(
+               floatSample, mTracks[ii].start + start, len, false ) );
+            if (samples)
+               for (size_t jj = 0; jj < len; ++jj)
+                  buffer[jj] += samples[jj];
+         }
+      };
+
+      // Read and analyze on another thread, while this one redraws the
+      // progress gauge; the windows stay disabled, so the tracks can't
+      // change meanwhile
+      enum : int { ProgressRange = 10000 };
+      std::atomic<long long> done{ 0 };
+      std::atomic<bool> finished{ false };
+      std::exception_ptr exception;
+      mProgress->SetRange( ProgressRange );
+      std::thread worker{ [&]{
+         try {
+            mAnalyst->Calculate(alg, windowFunc, mWindowSize, mRate,
+               read, mDataLen, &mYMin, &mYMax,
+               [&]( sampleCount soFar ){
+                  done.store( soFar.as_long_long() );
+               } );
+         }
+         catch( ... ) {
+            exception = std::current_exception();
+         }
+         finished.store( true );
+      } };
+      const auto total = std::max<long long>( 1, mDataLen.as_long_long() );
+      while (!finished.load()) {
+         wxMilliSleep( 10 );
+         mProgress->SetValue( ProgressRange * done.load() / total );
+      }
+      worker.join();
+      mProgress->Reset();
+      if (exception)
+         std::rethrow_exception( exception );
    }
    if (hadFocus) {
       hadFocus->SetFocus();
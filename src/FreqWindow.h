@@ -30,6 +30,7 @@ class AudacityProject;
 class FrequencyPlotDialog;
 class FreqGauge;
 class RulerPanel;
+class WaveTrack;
 
 DECLARE_EXPORTED_EVENT_TYPE(AUDACITY_DLL_API, EVT_FREQWINDOW_RECALC, -1);
 
@@ -130,8 +131,14 @@ private:
 
 
    double mRate;
-   size_t mDataLen;
-   Floats mData;
+   /// The selected tracks, each with the sample where the selection begins
+   /// in it; they are read a block at a time when analyzed
+   struct TrackSource {
+      std::shared_ptr<const WaveTrack> track;
+      sampleCount start;
+   };
+   std::vector<TrackSource> mTracks;
+   sampleCount mDataLen;
    size_t mWindowSize;
 
    bool mLogAxis;
@@ -13,6 +13,8 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include <wx/defs.h>
 
 #include "Matrix.h"
@@ -77,6 +79,50 @@ static void LinearInterpolateAudio(float *buffer, int len,
    }
 }
 
+// Solve M x = b for x, where M is symmetric positive definite, and zero
+// beyond W places from the diagonal.  band holds the upper half of M,
+// with M[i][i+d] in band[i][d], and is overwritten with its Cholesky
+// factor U, so that M = U' U; x holds b on entry.  Returns false if M is
+// not positive definite.  The cost is O(n W^2).
+static bool SolveBanded(Matrix &band, size_t W, Vector &x)
+{
+   const size_t n = band.Rows();
+
+   for(size_t i=0; i<n; i++) {
+      for(size_t d=0; d<=W && i+d<n; d++) {
+         const auto j = i + d;
+         double sum = band[i][d];
+         for(size_t k = j > W ? j - W : 0; k < i; k++)
+            sum -= band[k][i-k] * band[k][j-k];
+         if (d == 0) {
+            if (!(sum > 0))
+               return false;
+            band[i][0] = sqrt(sum);
+         }
+         else
+            band[i][d] = sum / band[i][0];
+      }
+   }
+
+   // Forward substitution with U'
+   for(size_t i=0; i<n; i++) {
+      double sum = x[i];
+      for(size_t k = i > W ? i - W : 0; k < i; k++)
+         sum -= band[k][i-k] * x[k];
+      x[i] = sum / band[i][0];
+   }
+
+   // Back substitution with U
+   for(size_t i=n; i-- > 0;) {
+      double sum = x[i];
+      for(size_t d=1; d<=W && i+d<n; d++)
+         sum -= band[i][d] * x[i+d];
+      x[i] = sum / band[i][0];
+   }
+
+   return true;
+}
+
 // Here's the main interpolate function, using
 // Least Squares AutoRegression (LSAR):
 void InterpolateAudio(float *buffer, const size_t len,
@@ -92,6 +138,9 @@ void InterpolateAudio(float *buffer, const size_t len,
    if(numBad >= len)
       return;  //should never have been called!
 
+   if(numBad == 0)
+      return;
+
    if (firstBad == 0) {
       // The algorithm below has a weird asymmetry in that it
       // performs poorly when interpolating to the left.  If
@@ -130,20 +179,44 @@ void InterpolateAudio(float *buffer, const size_t len,
 
    // Solve for the best autoregression coefficients
    // using a least-squares fit to all of the non-bad
-   // data we have in the buffer
+   // data we have in the buffer.  The fit uses the windows
+   // s[i..i+P] for i in the known intervals below.
+   const size_t intervals[2][2] = {
+      { 0, firstBad > P ? firstBad - P : 0 },
+      { firstBad + numBad, std::max(firstBad + numBad, len - P) },
+   };
+
+   // XP[row][col] sums s[i+row] * s[i+col]; its first P columns are the
+   // normal equations and its last column is their right side.  Each
+   // entry is the one above and to the left, with the windows shifted
+   // by one sample, so only the ends of the intervals change it.
+   Matrix XP(P, P + 1);
+   for(const auto &interval : intervals)
+      for(size_t i = interval[0]; i < interval[1]; i++)
+         for(size_t col=0; col<=P; col++)
+            XP[0][col] += s[i] * s[i+col];
+   for(size_t row=1; row<P; row++)
+      for(size_t col=row; col<=P; col++) {
+         double sum = XP[row-1][col-1];
+         for(const auto &interval : intervals)
+            if (interval[0] < interval[1])
+               sum += s[interval[1]+row-1] * s[interval[1]+col-1]
+                    - s[interval[0]+row-1] * s[interval[0]+col-1];
+         XP[row][col] = sum;
+      }
+
+   // The normal equations are symmetric and positive definite, so
+   // Cholesky factorization solves them, in a third of the work of
+   // inverting them
    Matrix X(P, P);
-   Vector b(P);
-
-   for(size_t i = 0; i + P < len; i++)
-      if (i+P < firstBad || i >= (firstBad + numBad))
-         for(size_t row=0; row<P; row++) {
-            for(size_t col=0; col<P; col++)
-               X[row][col] += (s[i+row] * s[i+col]);
-            b[row] += s[i+P] * s[i+row];
-         }
+   Vector a(P);
+   for(size_t row=0; row<P; row++) {
+      for(size_t col=row; col<P; col++)
+         X[row][col-row] = XP[row][col];
+      a[row] = XP[row][P];
+   }
 
-   Matrix Xinv(P, P);
-   if (!InvertMatrix(X, Xinv)) {
+   if (!SolveBanded(X, P - 1, a)) {
       // The matrix is singular!  Fall back on linear...
       // In practice I have never seen this happen if
       // we add the tiny bit of random noise.
@@ -151,53 +224,69 @@ void InterpolateAudio(float *buffer, const size_t len,
       return;
    }
 
-   // This vector now contains the autoregression coefficients
-   const Vector &a = Xinv * b;
-
-   // Create a matrix (a "Toeplitz" matrix, as it turns out)
-   // which encodes the autoregressive relationship between
-   // elements of the sequence.
-   Matrix A(N-P, N);
-   for(size_t row=0; row<N-P; row++) {
-      for(size_t col=0; col<P; col++)
-         A[row][row+col] = -a[col];
-      A[row][row+P] = 1;
+   // a now contains the autoregression coefficients.  Each of the N-P
+   // rows of the "Toeplitz" matrix A that encodes the autoregressive
+   // relationship between elements of the sequence is
+   // -a[0] ... -a[P-1] 1, shifted right by the row number.
+   // A is never built; only the rows that meet the bad samples matter.
+   Vector c(P + 1);
+   for(size_t k=0; k<P; k++)
+      c[k] = -a[k];
+   c[P] = 1;
+
+   // Split both A and the signal into the unknown (bad) columns, Au, and
+   // the known (good) ones, Ak.  The best values su of the bad samples
+   // minimize |Au su + Ak sk|, so that (Au' Au) su = -Au' (Ak sk).
+   const size_t nRows = N - P;
+   const size_t firstRow = firstBad > P ? firstBad - P : 0;
+   const size_t endRow = std::min(nRows, firstBad + numBad);
+
+   // The residual of the known samples, Ak sk, in the rows that matter
+   Vector r(endRow - firstRow);
+   for(size_t row=firstRow; row<endRow; row++) {
+      double sum = 0;
+      for(size_t k=0; k<=P; k++) {
+         const auto col = row + k;
+         if (col < firstBad || col >= firstBad + numBad)
+            sum += c[k] * s[col];
+      }
+      r[row - firstRow] = sum;
+   }
+
+   // Au' Au is banded, each column of Au meeting only P others, so it is
+   // built and factored in O(numBad P^2), not O(numBad^2 N)
+   const size_t W = std::min(P, numBad - 1);
+   Matrix G(numBad, W + 1);
+   Vector su(numBad);
+   for(size_t i=0; i<numBad; i++) {
+      const auto coli = firstBad + i;
+      for(size_t d=0; d<=W && i+d<numBad; d++) {
+         const auto colj = coli + d;
+         // Rows meeting both columns
+         const size_t rowStart = colj > P ? colj - P : 0;
+         const size_t rowEnd = std::min(nRows, coli + 1);
+         double sum = 0;
+         for(size_t row=rowStart; row<rowEnd; row++)
+            sum += c[coli-row] * c[colj-row];
+         G[i][d] = sum;
+      }
+
+      const size_t rowStart = std::max(firstRow, coli > P ? coli - P : 0);
+      const size_t rowEnd = std::min(endRow, coli + 1);
+      double sum = 0;
+      for(size_t row=rowStart; row<rowEnd; row++)
+         sum += c[coli-row] * r[row-firstRow];
+      su[i] = -sum;
    }
 
-   // Split both the Toeplitz matrix and the signal into
-   // two pieces.  Note that this code could be made to
-   // work even in the case where the "bad" samples are
-   // not contiguous, but currently it assumes they are.
-   //   "u" is for unknown (bad)
-   //   "k" is for known (good)
-   Matrix Au = MatrixSubset(A, 0, N-P, firstBad, numBad);
-   Matrix A_left = MatrixSubset(A, 0, N-P, 0, firstBad);
-   Matrix A_right = MatrixSubset(A, 0, N-P,
-                                 firstBad+numBad, N-(firstBad+numBad));
-   Matrix Ak = MatrixConcatenateCols(A_left, A_right);
-
-   const Vector &s_left = VectorSubset(s, 0, firstBad);
-   const Vector &s_right = VectorSubset(s, firstBad+numBad,
-                                 N-(firstBad+numBad));
-   const Vector &sk = VectorConcatenate(s_left, s_right);
-
-   // Do some linear algebra to find the best possible
-   // values that fill in the "bad" area
-   Matrix AuT = TransposeMatrix(Au);
-   Matrix X1 = MatrixMultiply(AuT, Au);
-   Matrix X2(X1.Rows(), X1.Cols());
-   if (!InvertMatrix(X1, X2)) {
+   if (!SolveBanded(G, W, su)) {
       // The matrix is singular!  Fall back on linear...
       LinearInterpolateAudio(buffer, len, firstBad, numBad);
       return;
    }
-   Matrix X2b = X2 * -1.0;
-   Matrix X3 = MatrixMultiply(X2b, AuT);
-   Matrix X4 = MatrixMultiply(X3, Ak);
-   // This vector contains our best guess as to the
-   // unknown values
-   const Vector &su = X4 * sk;
 
+   // su now contains our best guess as to the
+   // unknown values.
    // Put the results into the return buffer
    for(size_t i=0; i<numBad; i++)
       buffer[firstBad+i] = (float)su[i];
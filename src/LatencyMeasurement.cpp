@@ -0,0 +1,263 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LatencyMeasurement.cpp
+
+*******************************************************************//**
+
+\class LatencyMeasurement
+\brief Finds by loopback how late recorded sound is relative to what was
+played with it, so that overdubs line up to the sample without guessing
+at the latency compensation.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "LatencyMeasurement.h"
+
+#include <algorithm>
+#include <cmath>
+#include <wx/utils.h>
+
+#include "portaudio.h"
+
+#include "FFTConvolver.h"
+#include "Internat.h"
+#include "MemoryX.h"
+#include "Prefs.h"
+#include "prefs/RecordingPrefs.h"
+
+namespace {
+
+// Silence before the burst lets the devices settle; the recording runs on
+// long enough after it to allow this much round trip
+constexpr double LeadIn = 0.3;
+constexpr double MaxRoundTrip = 1.0;
+constexpr size_t BurstLength = 4096;
+constexpr float BurstAmplitude = 0.5f;
+
+// How far the correlation peak must stand above its RMS to be believed
+constexpr double MinPeakToRMS = 8.0;
+
+struct Loopback {
+   Floats burst;
+   size_t burstStart{};
+   Floats recording;
+   size_t length{};
+   size_t position{};
+   int outChannels{};
+};
+
+int LoopbackCallback(const void *input, void *output,
+   unsigned long framesPerBuffer, const PaStreamCallbackTimeInfo *,
+   PaStreamCallbackFlags, void *userData)
+{
+   auto &loopback = *static_cast<Loopback*>(userData);
+   auto in = static_cast<const float*>(input);
+   auto out = static_cast<float*>(output);
+   for (unsigned long ii = 0; ii < framesPerBuffer; ++ii) {
+      const auto frame = loopback.position + ii;
+      float sample = 0;
+      if (frame >= loopback.burstStart &&
+          frame < loopback.burstStart + BurstLength)
+         sample = loopback.burst[frame - loopback.burstStart];
+      for (int cc = 0; cc < loopback.outChannels; ++cc)
+         *out++ = sample;
+      if (in && frame < loopback.length)
+         loopback.recording[frame] = in[ii];
+   }
+   loopback.position += framesPerBuffer;
+   return loopback.position >= loopback.length ? paComplete : paContinue;
+}
+
+// The same noise every time, with no dependency on the C library's rand
+void MakeBurst(float *burst, size_t length)
+{
+   unsigned long state = 12345;
+   for (size_t ii = 0; ii < length; ++ii) {
+      state = (state * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      burst[ii] = BurstAmplitude * (2.0f * state / 0x7fffffffUL - 1.0f);
+   }
+}
+
+// Index in the recording where the burst begins, or -1 if it is not
+// clearly there
+long FindBurst(const Loopback &loopback)
+{
+   // Convolution with the time reversed burst is correlation with it
+   Floats reversed{ BurstLength };
+   std::reverse_copy(loopback.burst.get(), loopback.burst.get() + BurstLength,
+      reversed.get());
+   FFTConvolver convolver{ std::make_shared<const FFTConvolutionKernel>(
+      reversed.get(), BurstLength) };
+   const auto delay = convolver.GetLatency() + BurstLength - 1;
+
+   const auto total = loopback.length + delay;
+   Floats correlation{ total, true };
+   std::copy(loopback.recording.get(),
+      loopback.recording.get() + loopback.length, correlation.get());
+   convolver.Process(correlation.get(), correlation.get(), total);
+
+   // Sound cannot come back before it was played
+   const size_t first = delay + loopback.burstStart;
+   if (total <= first)
+      return -1;
+   size_t peak = first;
+   double sumSquares = 0;
+   for (size_t ii = first; ii < total; ++ii) {
+      const double value = correlation[ii];
+      sumSquares += value * value;
+      if (std::fabs(value) > std::fabs(correlation[peak]))
+         peak = ii;
+   }
+   const double rms = std::sqrt(sumSquares / (total - first));
+   if (!(rms > 0) || std::fabs(correlation[peak]) < MinPeakToRMS * rms)
+      return -1;
+   return long(peak - delay);
+}
+
+// wxConfig paths may hold nothing but a safe subset of characters
+wxString KeyPart(const wxString &name)
+{
+   wxString result;
+   for (auto ch : name)
+      result += wxIsalnum(wxChar(ch)) ? wxChar(ch) : wxChar('_');
+   return result;
+}
+
+wxString Key(const wxString &host,
+   const wxString &playDevice, const wxString &recordDevice)
+{
+   return wxT("/AudioIO/RoundTripLatency/") + KeyPart(host) + wxT("/") +
+      KeyPart(playDevice) + wxT("/") + KeyPart(recordDevice);
+}
+
+}
+
+bool LatencyMeasurement::Measure(int playDevIndex, int recordDevIndex,
+   double rate, double bufferLength,
+   double &roundTrip, double &reported, TranslatableString &error)
+{
+   const auto playInfo = Pa_GetDeviceInfo(playDevIndex);
+   const auto recordInfo = Pa_GetDeviceInfo(recordDevIndex);
+   if (!playInfo || !recordInfo ||
+       playInfo->maxOutputChannels < 1 || recordInfo->maxInputChannels < 1) {
+      error = XO("The playback and recording devices are not available.");
+      return false;
+   }
+
+   Loopback loopback;
+   loopback.outChannels = std::min(2, playInfo->maxOutputChannels);
+   loopback.burst.reinit(BurstLength);
+   MakeBurst(loopback.burst.get(), BurstLength);
+   loopback.burstStart = LeadIn * rate;
+   loopback.length =
+      loopback.burstStart + BurstLength + size_t(MaxRoundTrip * rate);
+   loopback.recording.reinit(loopback.length, true);
+
+   PaStreamParameters playbackParameters{};
+   playbackParameters.device = playDevIndex;
+   playbackParameters.channelCount = loopback.outChannels;
+   playbackParameters.sampleFormat = paFloat32;
+   // As AudioIO does, see bug 1949
+   const auto hostInfo = Pa_GetHostApiInfo(playInfo->hostApi);
+   const bool isWASAPI = (hostInfo && hostInfo->type == paWASAPI);
+   playbackParameters.suggestedLatency =
+      isWASAPI ? 0.0 : bufferLength / 1000.0;
+
+   PaStreamParameters captureParameters{};
+   captureParameters.device = recordDevIndex;
+   captureParameters.channelCount = 1;
+   captureParameters.sampleFormat = paFloat32;
+   captureParameters.suggestedLatency = bufferLength / 1000.0;
+
+   PaStream *stream = nullptr;
+   auto result = Pa_OpenStream(&stream,
+      &captureParameters, &playbackParameters,
+      rate, paFramesPerBufferUnspecified, paNoFlag,
+      LoopbackCallback, &loopback);
+   if (result == paNoError)
+      result = Pa_StartStream(stream);
+   if (result != paNoError) {
+      if (stream)
+         Pa_CloseStream(stream);
+      error = XO("Could not open the devices together:\n%s")
+         .Format( wxSafeConvertMB2WX(Pa_GetErrorText(result)) );
+      return false;
+   }
+
+   if (const auto info = Pa_GetStreamInfo(stream))
+      reported = info->inputLatency + info->outputLatency;
+   else
+      reported = 0;
+
+   // The callback completes the stream; give up on a stalled device
+   const auto timeout =
+      wxGetLocalTimeMillis() + long(1000 * (loopback.length / rate + 2));
+   while (Pa_IsStreamActive(stream) == 1 && wxGetLocalTimeMillis() < timeout)
+      wxMilliSleep(20);
+   const bool completed = Pa_IsStreamActive(stream) == 0;
+   Pa_StopStream(stream);
+   Pa_CloseStream(stream);
+   if (!completed) {
+      error = XO("The devices stopped responding during the measurement.");
+      return false;
+   }
+
+   const auto start = FindBurst(loopback);
+   if (start < 0) {
+      error = XO(
+"The test signal was not heard.  Connect the playback output to the recording\n\
+input with a cable, or place a microphone near the speakers, and try again.");
+      return false;
+   }
+
+   roundTrip = (start - long(loopback.burstStart)) / rate;
+   return true;
+}
+
+void LatencyMeasurement::Store(const wxString &host,
+   const wxString &playDevice, const wxString &recordDevice,
+   double bufferLength, double correction)
+{
+   const auto key = Key(host, playDevice, recordDevice);
+   gPrefs->Write(key + wxT("/Correction"), correction);
+   gPrefs->Write(key + wxT("/BufferLength"), bufferLength);
+   gPrefs->Flush();
+}
+
+void LatencyMeasurement::Forget(const wxString &host,
+   const wxString &playDevice, const wxString &recordDevice)
+{
+   const auto key = Key(host, playDevice, recordDevice);
+   if (gPrefs->HasGroup(key)) {
+      gPrefs->DeleteGroup(key);
+      gPrefs->Flush();
+   }
+}
+
+bool LatencyMeasurement::Lookup(const wxString &host,
+   const wxString &playDevice, const wxString &recordDevice,
+   double bufferLength, double &correction)
+{
+   const auto key = Key(host, playDevice, recordDevice);
+   double measuredLength;
+   if (!gPrefs->Read(key + wxT("/Correction"), &correction) ||
+       !gPrefs->Read(key + wxT("/BufferLength"), &measuredLength))
+      return false;
+   // Round trip grows with the buffers, so another length needs measuring
+   // again
+   return std::fabs(measuredLength - bufferLength) < 0.5;
+}
+
+bool LatencyMeasurement::GetStored(double &correction)
+{
+   return Lookup(
+      gPrefs->Read(wxT("/AudioIO/Host"), wxT("")),
+      gPrefs->Read(wxT("/AudioIO/PlaybackDevice"), wxT("")),
+      gPrefs->Read(wxT("/AudioIO/RecordingDevice"), wxT("")),
+      gPrefs->ReadDouble(wxT("/AudioIO/LatencyDuration"),
+         DEFAULT_LATENCY_DURATION),
+      correction);
+}
@@ -0,0 +1,58 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LatencyMeasurement.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_LATENCY_MEASUREMENT__
+#define __AUDACITY_LATENCY_MEASUREMENT__
+
+#include "Audacity.h"
+
+#include <wx/string.h>
+
+class TranslatableString;
+
+/// \brief Measures the round trip from playback to recording through a
+/// loopback cable, and remembers it per pair of devices as the latency
+/// compensation for recording.
+///
+/// The measurement plays a short burst of noise and finds it in what is
+/// recorded by cross-correlation, so it includes everything between the
+/// audio callback and the converters:  PortAudio's buffering, the driver
+/// and any hardware.  It is valid for the buffer length it was made with.
+class AUDACITY_DLL_API LatencyMeasurement final
+{
+public:
+   /// Opens its own duplex stream on the PortAudio devices, which must not
+   /// be in use, and blocks for about two seconds.  Returns false with a
+   /// message if the stream failed or the burst was not clearly found.
+   /// roundTrip is in seconds; reported is what PortAudio estimated for the
+   /// same stream, for comparison.
+   static bool Measure(int playDevIndex, int recordDevIndex,
+      double rate, double bufferLength,
+      double &roundTrip, double &reported, TranslatableString &error);
+
+   /// Remember a compensation in milliseconds (negative, as the preference
+   /// is) for the devices, named as in preferences, and buffer length
+   static void Store(const wxString &host,
+      const wxString &playDevice, const wxString &recordDevice,
+      double bufferLength, double correction);
+
+   /// Forget any measurement for the devices
+   static void Forget(const wxString &host,
+      const wxString &playDevice, const wxString &recordDevice);
+
+   /// The stored compensation in milliseconds for the devices and buffer
+   /// length, if there is one
+   static bool Lookup(const wxString &host,
+      const wxString &playDevice, const wxString &recordDevice,
+      double bufferLength, double &correction);
+
+   /// Lookup for the devices and buffer length now in preferences
+   static bool GetStored(double &correction);
+};
+
+#endif
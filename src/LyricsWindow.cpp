@@ -156,7 +156,7 @@ void LyricsWindow::OnTimer(wxCommandEvent &event)
    if (ProjectAudioIO::Get( *mProject ).IsAudioActive())
    {
       auto gAudioIO = AudioIOBase::Get();
-      GetLyricsPanel()->Update(gAudioIO->GetStreamTime());
+      GetLyricsPanel()->Update(gAudioIO->GetAudibleStreamTime());
    }
    else
    {
@@ -13,6 +13,8 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include <algorithm>
+
 #include <wx/defs.h>
 
 Vector::Vector()
@@ -80,10 +82,9 @@ double Vector::Sum() const
 Matrix::Matrix(unsigned rows, unsigned cols, double **data)
    : mRows{ rows }
    , mCols{ cols }
-   , mRowVec{ mRows }
+   , mData{ rows * cols }
 {
    for(unsigned i = 0; i < mRows; i++) {
-      mRowVec[i].Reinit( mCols );
       for(unsigned j = 0; j < mCols; j++) {
          if (data)
             (*this)[i][j] = data[i][j];
@@ -106,13 +107,13 @@ Matrix::Matrix(const Matrix &other)
 
 void Matrix::CopyFrom(const Matrix &other)
 {
+   if (this == &other)
+      return;
    mRows = other.mRows;
    mCols = other.mCols;
-   mRowVec.reinit(mRows);
-   for (unsigned i = 0; i < mRows; i++) {
-      mRowVec[i].Reinit( mCols );
-      mRowVec[i] = other.mRowVec[i];
-   }
+   const auto size = mRows * mCols;
+   mData.reinit(size);
+   std::copy(other.mData.get(), other.mData.get() + size, mData.get());
 }
 
 Matrix::~Matrix()
@@ -121,7 +122,14 @@ Matrix::~Matrix()
 
 void Matrix::SwapRows(unsigned i, unsigned j)
 {
-   mRowVec[i].Swap(mRowVec[j]);
+   std::swap_ranges((*this)[i], (*this)[i] + mCols, (*this)[j]);
+}
+
+void Matrix::ScaleRow(unsigned i, double factor)
+{
+   auto row = (*this)[i];
+   for(unsigned j = 0; j < mCols; j++)
+      row[j] *= factor;
 }
 
 Matrix IdentityMatrix(unsigned N)
@@ -323,8 +331,8 @@ bool InvertMatrix(const Matrix& input, Matrix& Minv)
 
       // Divide this row by the value of M[i][i]
       double factor = 1.0 / M[i][i];
-      M[i] = M[i] * factor;
-      Minv[i] = Minv[i] * factor;
+      M.ScaleRow(i, factor);
+      Minv.ScaleRow(i, factor);
 
       // Eliminate the rest of the column
       for(unsigned j = 0; j < N; j++) {
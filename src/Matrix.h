@@ -15,7 +15,8 @@
 
 \class Matrix
 \brief Holds a matrix of doubles and supports arithmetic, subsetting,
-  and matrix inversion.  Used by InterpolateAudio.
+  and matrix inversion.  Used by InterpolateAudio.  The rows are stored
+  one after another in a single array.
 
 \class Vector
 \brief Holds a matrix of doubles and supports arithmetic operations,
@@ -63,19 +64,22 @@ class Matrix
 
    Matrix& operator=(const Matrix& other);
 
-   inline Vector& operator[](unsigned i) { return mRowVec[i]; }
-   inline Vector& operator[](unsigned i) const { return mRowVec[i]; }
+   inline double *operator[](unsigned i) { return mData.get() + i * mCols; }
+   inline const double *operator[](unsigned i) const
+      { return mData.get() + i * mCols; }
    inline unsigned Rows() const { return mRows; }
    inline unsigned Cols() const { return mCols; }
 
    void SwapRows(unsigned i, unsigned j);
+   // Multiply row i by factor
+   void ScaleRow(unsigned i, double factor);
 
  private:
    void CopyFrom(const Matrix& other);
 
    unsigned mRows;
    unsigned mCols;
-   ArrayOf<Vector> mRowVec;
+   Doubles mData;
 };
 
 bool InvertMatrix(const Matrix& input, Matrix& Minv);
@@ -35,6 +35,7 @@
 #include "Project.h"
 #include "ProjectHistory.h"
 #include "ProjectSettings.h"
+#include "Track.h"
 #include "UndoManager.h"
 #include "commands/CommandManager.h"
 #include "toolbars/ToolManager.h"
@@ -76,6 +77,16 @@ MenuManager::MenuManager( AudacityProject &project )
    mProject.Bind( EVT_UNDO_OR_REDO, &MenuManager::OnUndoRedo, this );
    mProject.Bind( EVT_UNDO_RESET, &MenuManager::OnUndoRedo, this );
    mProject.Bind( EVT_UNDO_PUSHED, &MenuManager::OnUndoRedo, this );
+
+   auto &tracks = TrackList::Get( mProject );
+   for ( auto type : {
+      EVT_TRACKLIST_SELECTION_CHANGE,
+      EVT_TRACKLIST_PERMUTED,
+      EVT_TRACKLIST_RESIZING,
+      EVT_TRACKLIST_ADDITION,
+      EVT_TRACKLIST_DELETION,
+   } )
+      tracks.Bind( type, &MenuManager::OnTrackListChanged, this );
 }
 
 MenuManager::~MenuManager()
@@ -1306,6 +1317,13 @@ void MenuManager::OnUndoRedo( wxCommandEvent &evt )
    UpdateMenus();
 }
 
+void MenuManager::OnTrackListChanged( TrackListEvent &evt )
+{
+   evt.Skip();
+   // Test again at the next update of the menus
+   mStaleDependencies |= TrackListDependency;
+}
+
 namespace{
    using Predicates = std::vector< ReservedCommandFlag::Predicate >;
    Predicates &RegisteredPredicates()
@@ -1338,9 +1356,9 @@ CommandFlag MenuManager::GetUpdateFlags( bool checkActive ) const
    // and returns them in a bitfield.  Note that if none of the flags
    // have changed, it's not necessary to even check for updates.
 
-   // static variable, used to remember flags for next time.
-   static CommandFlag lastFlags;
-
+   // The cached results of other tests are reused only by the frequent
+   // updates in idle time; any other caller, such as a command deciding
+   // whether it may run, tests everything
    CommandFlag flags, quickFlags;
 
    const auto &options = Options();
@@ -1356,17 +1374,25 @@ CommandFlag MenuManager::GetUpdateFlags( bool checkActive ) const
 
    if ( checkActive && !GetProjectFrame( mProject ).IsActive() )
       // quick 'short-circuit' return.
-      flags = (lastFlags & ~quickFlags) | flags;
+      flags = (mCachedFlags & ~quickFlags) | flags;
    else {
       ii = 0;
       for ( const auto &predicate : RegisteredPredicates() ) {
-         if ( !options[ii].quickTest && predicate( mProject ) )
+         const auto &option = options[ii];
+         if ( option.quickTest )
+            ;
+         else if ( checkActive && option.dependencies &&
+            !(option.dependencies & mStaleDependencies) )
+            // No event since the last test could have changed the answer
+            flags[ii] = mCachedFlags[ii];
+         else if ( predicate( mProject ) )
             flags[ii] = true;
          ++ii;
       }
+      mStaleDependencies = 0;
    }
 
-   lastFlags = flags;
+   mCachedFlags = flags;
    return flags;
 }
 
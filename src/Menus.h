@@ -12,6 +12,7 @@
 
 #include "audacity/Types.h"
 
+#include <wx/event.h> // to inherit
 #include <wx/string.h> // member variable
 #include "Prefs.h"
 #include "ClientData.h"
@@ -19,6 +20,7 @@
 
 class wxArrayString;
 class wxCommandEvent;
+class TrackListEvent;
 class AudacityProject;
 class CommandContext;
 class CommandManager;
@@ -59,6 +61,7 @@ struct ToolbarMenuVisitor;
 class MenuManager final
    : public MenuCreator
    , public ClientData::Base
+   , public wxEvtHandler
    , private PrefsListener
 {
 public:
@@ -100,9 +103,15 @@ private:
       CommandFlag flagsRequired);
 
    void OnUndoRedo( wxCommandEvent &evt );
+   void OnTrackListChanged( TrackListEvent &evt );
 
    AudacityProject &mProject;
 
+   // Results of the last tests of all flags, and bits of
+   // CommandFlagDependency for events received since those tests
+   mutable CommandFlag mCachedFlags;
+   mutable unsigned mStaleDependencies{ ~0u };
+
 public:
    // 0 is grey out, 1 is Autoselect, 2 is Give warnings.
    int  mWhatIfNoSelection;
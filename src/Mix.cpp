@@ -25,6 +25,9 @@
 #include "Mix.h"
 
 #include <math.h>
+#include <algorithm>
+#include <exception>
+#include <thread>
 
 #include <wx/textctrl.h>
 #include <wx/progdlg.h>
@@ -34,6 +37,8 @@
 #include "Envelope.h"
 #include "WaveTrack.h"
 #include "Prefs.h"
+#include "Profiler.h"
+#include "RealtimeScheduling.h"
 #include "Resample.h"
 #include "TimeTrack.h"
 #include "float_cast.h"
@@ -151,6 +156,7 @@ void MixAndRender(TrackList *tracks, TrackFactory *trackFactory,
       Mixer::WarpOptions(timeTrack ? timeTrack->GetEnvelope() : nullptr),
       startTime, endTime, mono ? 1 : 2, maxBlockLen, false,
       rate, format);
+   mixer.ProcessTracksInParallel();
 
    ::wxSafeYield();
 
@@ -241,7 +247,6 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
    , mSampleQueue{ mNumInputTracks, mQueueMaxLen }
 
    , mNumChannels{ numOutChannels }
-   , mGains{ mNumChannels }
 
    , mMayThrow{ mayThrow }
 {
@@ -253,9 +258,14 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
    mSamplePos.reinit(mNumInputTracks);
    for(size_t i=0; i<mNumInputTracks; i++) {
       mInputTrack[i].SetTrack(inputTracks[i]);
+      // Playback and export read forward
+      mInputTrack[i].SetReadAhead(true);
       mSamplePos[i] = inputTracks[i]->TimeToLongSamples(startTime);
    }
    mEnvelope = warpOptions.envelope;
+   if (mEnvelope)
+      mInverseIntegrals =
+         std::make_unique<Envelope::InverseIntegrals>(*mEnvelope);
    mT0 = startTime;
    mT1 = stopTime;
    mTime = startTime;
@@ -265,6 +275,7 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
    mSpeed = 1.0;
    mFormat = outFormat;
    mApplyTrackGains = true;
+   mParallel = false;
    if( mixerSpec && mixerSpec->GetNumChannels() == mNumChannels &&
          mixerSpec->GetNumTracks() == mNumInputTracks )
       mMixerSpec = mixerSpec;
@@ -281,12 +292,8 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
    }
 
    mBuffer.reinit(mNumBuffers);
-   mTemp.reinit(mNumBuffers);
-   for (unsigned int c = 0; c < mNumBuffers; c++) {
+   for (unsigned int c = 0; c < mNumBuffers; c++)
       mBuffer[c].Allocate(mInterleavedBufferSize, mFormat);
-      mTemp[c].Allocate(mInterleavedBufferSize, floatSample);
-   }
-   mFloatBuffer = Floats{ mInterleavedBufferSize };
 
    // But cut the queue into blocks of this finer size
    // for variable rate resampling.  Each block is resampled at some
@@ -327,18 +334,62 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
 
    MakeResamplers();
 
-   const auto envLen = std::max(mQueueMaxLen, mInterleavedBufferSize);
-   mEnvValues.reinit(envLen);
+   // Find the channels that only one track feeds, as when each track of a
+   // multichannel export has a channel of its own; those tracks are copied
+   // to their channels, which need no clearing
+   {
+      std::vector<int> sources(mNumChannels, -1);
+      ArrayOf<int> channelFlags{ mNumChannels };
+      for (size_t i = 0; i < mNumInputTracks; i++) {
+         GetChannelFlags(i, channelFlags.get());
+         for (size_t c = 0; c < mNumChannels; c++)
+            if (channelFlags[c])
+               // -2 for several sources
+               sources[c] = sources[c] == -1 ? int(i) : -2;
+      }
+      mSoleSource = std::move(sources);
+   }
+
+   mScratch.resize(1);
+   AllocateScratch(mScratch[0]);
 }
 
 Mixer::~Mixer()
 {
 }
 
+bool Mixer::LockMemory()
+{
+   mMemoryLocks.clear();
+   bool success = true;
+   const auto lock = [&]( const void *address, size_t bytes ){
+      mMemoryLocks.push_back( std::make_unique<MemoryLock>() );
+      if ( !mMemoryLocks.back()->Lock( address, bytes ) )
+         success = false;
+   };
+
+   for (unsigned int c = 0; c < mNumBuffers; c++)
+      lock( mBuffer[c].ptr(), mInterleavedBufferSize * SAMPLE_SIZE(mFormat) );
+   for (size_t i = 0; i < mNumInputTracks; i++)
+      lock( mSampleQueue[i].get(), mQueueMaxLen * sizeof(float) );
+   auto &scratch = mScratch[0];
+   lock( scratch.floatBuffer.get(), mInterleavedBufferSize * sizeof(float) );
+   for (unsigned int c = 0; c < mNumChannels; c++)
+      lock( scratch.temp[c].ptr(), mBufferSize * SAMPLE_SIZE(floatSample) );
+
+   return success;
+}
+
 void Mixer::MakeResamplers()
 {
    for (size_t i = 0; i < mNumInputTracks; i++)
-      mResample[i] = std::make_unique<Resample>(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+      mResample[i] = Resample::Acquire(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+}
+
+void Mixer::ResetResamplers()
+{
+   for (size_t i = 0; i < mNumInputTracks; i++)
+      mResample[i]->Reset();
 }
 
 void Mixer::ApplyTrackGains(bool apply)
@@ -346,10 +397,31 @@ void Mixer::ApplyTrackGains(bool apply)
    mApplyTrackGains = apply;
 }
 
-void Mixer::Clear()
+void Mixer::ProcessTracksInParallel(bool parallel)
+{
+   mParallel = parallel;
+}
+
+void Mixer::AllocateScratch(Scratch &scratch)
 {
-   for (unsigned int c = 0; c < mNumBuffers; c++) {
-      memset(mTemp[c].ptr(), 0, mInterleavedBufferSize * SAMPLE_SIZE(floatSample));
+   scratch.floatBuffer = Floats{ mInterleavedBufferSize };
+   scratch.gains.reinit(mNumChannels);
+   // The accumulators are not interleaved, even for interleaved output, so
+   // that each track is added with contiguous loops; Process interleaves
+   scratch.temp.reinit(mNumChannels);
+   for (unsigned int c = 0; c < mNumChannels; c++)
+      scratch.temp[c].Allocate(mBufferSize, floatSample);
+}
+
+void Mixer::Clear(Scratch &scratch, size_t begin, size_t end)
+{
+   for (unsigned int c = 0; c < mNumChannels; c++) {
+      // A channel fed only by one of the tracks [begin, end) is copied to,
+      // not added to
+      const auto source = mSoleSource[c];
+      if (source >= 0 && size_t(source) >= begin && size_t(source) < end)
+         continue;
+      memset(scratch.temp[c].ptr(), 0, mMaxOut * SAMPLE_SIZE(floatSample));
    }
 }
 
@@ -361,6 +433,19 @@ void MixBuffers(unsigned numChannels, int *channelFlags, float *gains,
       if (!channelFlags[c])
          continue;
 
+      if (channelFlags[c] == 2 && !interleaved) {
+         // The only source of this channel:  copy, with no need to clear first
+         float gain = gains[c];
+         float *dest = (float *)dests[c].ptr();
+         const float *temp = (const float *)src;
+         if (gain == 1.0f)
+            memcpy(dest, temp, len * sizeof(float));
+         else
+            for (int j = 0; j < len; j++)
+               dest[j] = temp[j] * gain;
+         continue;
+      }
+
       samplePtr destPtr;
       unsigned skip;
 
@@ -395,9 +480,10 @@ namespace {
     * @param t1 The ending time to calculate to
     * @return The relative length increase of the chosen segment from the original sound.
     */
-double ComputeWarpFactor(const Envelope &env, double t0, double t1)
+double ComputeWarpFactor(
+   const Envelope::InverseIntegrals &integrals, double t0, double t1)
 {
-   return env.AverageOfInverse(t0, t1);
+   return integrals.AverageOfInverse(t0, t1);
 }
 
 }
@@ -405,7 +491,7 @@ double ComputeWarpFactor(const Envelope &env, double t0, double t1)
 size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                                     sampleCount *pos, float *queue,
                                     int *queueStart, int *queueLen,
-                                    Resample * pResample)
+                                    Resample * pResample, Scratch &scratch)
 {
    const WaveTrack *const track = cache.GetTrack().get();
    const double trackRate = track->GetRate();
@@ -458,9 +544,9 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
-                                        getLen,
-                                        (*pos - (getLen- 1)).as_double() / trackRate);
+               track->ApplyEnvelope(&queue[*queueLen],
+                                    getLen,
+                                    (*pos - (getLen- 1)).as_double() / trackRate);
                *pos -= getLen;
             }
             else {
@@ -470,17 +556,13 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
-                                        getLen,
-                                        (*pos).as_double() / trackRate);
+               track->ApplyEnvelope(&queue[*queueLen],
+                                    getLen,
+                                    (*pos).as_double() / trackRate);
 
                *pos += getLen;
             }
 
-            for (decltype(getLen) i = 0; i < getLen; i++) {
-               queue[(*queueLen) + i] *= mEnvValues[i];
-            }
-
             if (backwards)
                ReverseSamples((samplePtr)&queue[0], floatSample,
                               *queueLen, getLen);
@@ -504,10 +586,10 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
          //         without changing the way the resampler works, because the number of input samples that will be used
          //         is unpredictable. Maybe it can be compensated later though.
          if (backwards)
-            factor *= ComputeWarpFactor( *mEnvelope,
+            factor *= ComputeWarpFactor( *mInverseIntegrals,
                t - (double)thisProcessLen / trackRate + tstep, t + tstep);
          else
-            factor *= ComputeWarpFactor( *mEnvelope,
+            factor *= ComputeWarpFactor( *mInverseIntegrals,
                t, t + (double)thisProcessLen / trackRate);
       }
 
@@ -515,7 +597,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                                       &queue[*queueStart],
                                       thisProcessLen,
                                       last,
-                                      &mFloatBuffer[out],
+                                      &scratch.floatBuffer[out],
                                       mMaxOut - out);
 
       const auto input_used = results.first;
@@ -531,26 +613,26 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
 
    for (size_t c = 0; c < mNumChannels; c++) {
       if (mApplyTrackGains) {
-         mGains[c] = track->GetChannelGain(c);
+         scratch.gains[c] = track->GetChannelGain(c);
       }
       else {
-         mGains[c] = 1.0;
+         scratch.gains[c] = 1.0;
       }
    }
 
    MixBuffers(mNumChannels,
               channelFlags,
-              mGains.get(),
-              (samplePtr)mFloatBuffer.get(),
-              mTemp.get(),
+              scratch.gains.get(),
+              (samplePtr)scratch.floatBuffer.get(),
+              scratch.temp.get(),
               out,
-              mInterleaved);
+              false);
 
    return out;
 }
 
 size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
-                               sampleCount *pos)
+                               sampleCount *pos, Scratch &scratch)
 {
    const WaveTrack *const track = cache.GetTrack().get();
    const double t = ( *pos ).as_double() / track->GetRate();
@@ -576,91 +658,183 @@ size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
    if (backwards) {
       auto results = cache.Get(floatSample, *pos - (slen - 1), slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(scratch.floatBuffer.get(), results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
-      track->GetEnvelopeValues(mEnvValues.get(), slen, t - (slen - 1) / mRate);
-      for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
-      ReverseSamples((samplePtr)mFloatBuffer.get(), floatSample, 0, slen);
+         memset(scratch.floatBuffer.get(), 0, sizeof(float) * slen);
+      track->ApplyEnvelope(scratch.floatBuffer.get(), slen, t - (slen - 1) / mRate);
+      ReverseSamples((samplePtr)scratch.floatBuffer.get(), floatSample, 0, slen);
 
       *pos -= slen;
    }
    else {
       auto results = cache.Get(floatSample, *pos, slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(scratch.floatBuffer.get(), results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
-      track->GetEnvelopeValues(mEnvValues.get(), slen, t);
-      for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+         memset(scratch.floatBuffer.get(), 0, sizeof(float) * slen);
+      track->ApplyEnvelope(scratch.floatBuffer.get(), slen, t);
 
       *pos += slen;
    }
 
    for(size_t c=0; c<mNumChannels; c++)
       if (mApplyTrackGains)
-         mGains[c] = track->GetChannelGain(c);
+         scratch.gains[c] = track->GetChannelGain(c);
       else
-         mGains[c] = 1.0;
+         scratch.gains[c] = 1.0;
 
-   MixBuffers(mNumChannels, channelFlags, mGains.get(),
-              (samplePtr)mFloatBuffer.get(), mTemp.get(), slen, mInterleaved);
+   MixBuffers(mNumChannels, channelFlags, scratch.gains.get(),
+              (samplePtr)scratch.floatBuffer.get(), scratch.temp.get(), slen, false);
 
    return slen;
 }
 
+void Mixer::GetChannelFlags(size_t iTrack, int *channelFlags) const
+{
+   const WaveTrack *const track = mInputTrack[iTrack].GetTrack().get();
+   for(size_t j=0; j<mNumChannels; j++)
+      channelFlags[j] = 0;
+
+   if( mMixerSpec ) {
+      //ignore left and right when downmixing is not required
+      for(size_t j = 0; j < mNumChannels; j++ )
+         channelFlags[ j ] = mMixerSpec->mMap[ iTrack ][ j ] ? 1 : 0;
+   }
+   else {
+      switch(track->GetChannel()) {
+      case Track::MonoChannel:
+      default:
+         for(size_t j=0; j<mNumChannels; j++)
+            channelFlags[j] = 1;
+         break;
+      case Track::LeftChannel:
+         channelFlags[0] = 1;
+         break;
+      case Track::RightChannel:
+         if (mNumChannels >= 2)
+            channelFlags[1] = 1;
+         else
+            channelFlags[0] = 1;
+         break;
+      }
+   }
+
+   for(size_t j = 0; j < mSoleSource.size(); j++)
+      if (mSoleSource[j] == int(iTrack))
+         channelFlags[j] = 2;
+}
+
+size_t Mixer::MixTracks(size_t begin, size_t end, Scratch &scratch)
+{
+   size_t maxOut = 0;
+   ArrayOf<int> channelFlags{ mNumChannels };
+
+   Clear(scratch, begin, end);
+   for(size_t i = begin; i < end; i++) {
+      const WaveTrack *const track = mInputTrack[i].GetTrack().get();
+      GetChannelFlags(i, channelFlags.get());
+      size_t out;
+      if (mbVariableRates || track->GetRate() != mRate)
+         out = MixVariableRates(channelFlags.get(), mInputTrack[i],
+               &mSamplePos[i], mSampleQueue[i].get(),
+               &mQueueStart[i], &mQueueLen[i], mResample[i].get(),
+               scratch);
+      else
+         out = MixSameRate(channelFlags.get(), mInputTrack[i], &mSamplePos[i],
+               scratch);
+
+      // What the track did not reach of the channels it alone feeds was not
+      // cleared
+      if (out < mMaxOut)
+         for(size_t c = 0; c < mNumChannels; c++)
+            if (channelFlags[c] == 2)
+               memset((float *)scratch.temp[c].ptr() + out, 0,
+                  (mMaxOut - out) * SAMPLE_SIZE(floatSample));
+
+      maxOut = std::max(maxOut, out);
+   }
+   return maxOut;
+}
+
+size_t Mixer::MixTracksInParallel(unsigned nThreads)
+{
+   // Each thread gets a fixed, contiguous range of tracks, and the
+   // accumulators are summed in order, so the result does not depend on
+   // scheduling
+   while (mScratch.size() < nThreads) {
+      mScratch.emplace_back();
+      AllocateScratch(mScratch.back());
+   }
+
+   const auto trackBegin = [&](unsigned ii){
+      return size_t( (unsigned long long)mNumInputTracks * ii / nThreads );
+   };
+
+   std::vector<size_t> maxOuts(nThreads, 0);
+   std::vector<std::exception_ptr> errors(nThreads);
+   std::vector<std::thread> threads;
+   threads.reserve(nThreads - 1);
+   for (unsigned ii = 1; ii < nThreads; ++ii)
+      threads.emplace_back([&, ii]{
+         try {
+            maxOuts[ii] =
+               MixTracks(trackBegin(ii), trackBegin(ii + 1), mScratch[ii]);
+         }
+         catch (...) { errors[ii] = std::current_exception(); }
+      });
+
+   try { maxOuts[0] = MixTracks(trackBegin(0), trackBegin(1), mScratch[0]); }
+   catch (...) { errors[0] = std::current_exception(); }
+
+   for (auto &thread : threads)
+      thread.join();
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+
+   const auto maxOut = *std::max_element(maxOuts.begin(), maxOuts.end());
+
+   // Samples past an accumulator's own maximum are still zero from Clear(),
+   // so summing the common length is exact
+   const size_t len = maxOut;
+   for (unsigned int c = 0; c < mNumChannels; c++) {
+      float *const dest = (float *)mScratch[0].temp[c].ptr();
+      for (unsigned ii = 1; ii < nThreads; ++ii) {
+         const float *const src = (const float *)mScratch[ii].temp[c].ptr();
+         // A simple loop, which compilers vectorize
+         for (size_t j = 0; j < len; j++)
+            dest[j] += src[j];
+      }
+   }
+
+   return maxOut;
+}
+
 size_t Mixer::Process(size_t maxToProcess)
 {
+   PROFILE_SCOPE("Mixer::Process");
+
    // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
    // it here. It's also unnecessary I think.
    //if (mT >= mT1)
    //   return 0;
 
    decltype(Process(0)) maxOut = 0;
-   ArrayOf<int> channelFlags{ mNumChannels };
 
    mMaxOut = maxToProcess;
 
-   Clear();
-   for(size_t i=0; i<mNumInputTracks; i++) {
-      const WaveTrack *const track = mInputTrack[i].GetTrack().get();
-      for(size_t j=0; j<mNumChannels; j++)
-         channelFlags[j] = 0;
+   unsigned nThreads = 1;
+   if (mParallel && mNumInputTracks > 1)
+      nThreads = unsigned( std::min<size_t>(mNumInputTracks,
+         std::max(1u, std::thread::hardware_concurrency())) );
 
-      if( mMixerSpec ) {
-         //ignore left and right when downmixing is not required
-         for(size_t j = 0; j < mNumChannels; j++ )
-            channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
-      }
-      else {
-         switch(track->GetChannel()) {
-         case Track::MonoChannel:
-         default:
-            for(size_t j=0; j<mNumChannels; j++)
-               channelFlags[j] = 1;
-            break;
-         case Track::LeftChannel:
-            channelFlags[0] = 1;
-            break;
-         case Track::RightChannel:
-            if (mNumChannels >= 2)
-               channelFlags[1] = 1;
-            else
-               channelFlags[0] = 1;
-            break;
-         }
-      }
-      if (mbVariableRates || track->GetRate() != mRate)
-         maxOut = std::max(maxOut,
-            MixVariableRates(channelFlags.get(), mInputTrack[i],
-               &mSamplePos[i], mSampleQueue[i].get(),
-               &mQueueStart[i], &mQueueLen[i], mResample[i].get()));
-      else
-         maxOut = std::max(maxOut,
-            MixSameRate(channelFlags.get(), mInputTrack[i], &mSamplePos[i]));
+   if (nThreads > 1)
+      maxOut = MixTracksInParallel(nThreads);
+   else
+      maxOut = MixTracks(0, mNumInputTracks, mScratch[0]);
 
+   for(size_t i=0; i<mNumInputTracks; i++) {
+      const WaveTrack *const track = mInputTrack[i].GetTrack().get();
       double t = mSamplePos[i].as_double() / (double)track->GetRate();
       if (mT0 > mT1)
          // backwards (as possibly in scrubbing)
@@ -669,21 +843,23 @@ size_t Mixer::Process(size_t maxToProcess)
          // forwards (the usual)
          mTime = std::min(std::max(t, mTime), mT1);
    }
+
+   const auto &temp = mScratch[0].temp;
    if(mInterleaved) {
       for(size_t c=0; c<mNumChannels; c++) {
-         CopySamples(mTemp[0].ptr() + (c * SAMPLE_SIZE(floatSample)),
+         CopySamples(temp[c].ptr(),
             floatSample,
             mBuffer[0].ptr() + (c * SAMPLE_SIZE(mFormat)),
             mFormat,
             maxOut,
             mHighQuality,
-            mNumChannels,
+            1,
             mNumChannels);
       }
    }
    else {
       for(size_t c=0; c<mNumBuffers; c++) {
-         CopySamples(mTemp[c].ptr(),
+         CopySamples(temp[c].ptr(),
             floatSample,
             mBuffer[c].ptr(),
             mFormat,
@@ -726,8 +902,9 @@ void Mixer::Restart()
 
    // Bug 1887:  libsoxr 0.1.3, first used in Audacity 2.3.0, crashes with
    // constant rate resampling if you try to reuse the resampler after it has
-   // flushed.  Should that be considered a bug in sox?  This works around it:
-   MakeResamplers();
+   // flushed.  Should that be considered a bug in sox?  This works around it,
+   // now by resetting rather than remaking them:
+   ResetResamplers();
 }
 
 void Mixer::Reposition(double t, bool bSkipping)
@@ -750,7 +927,7 @@ void Mixer::Reposition(double t, bool bSkipping)
    // flushed.  Should that be considered a bug in sox?  This works around it.
    // (See also bug 1887, and the same work around in Mixer::Restart().)
    if( bSkipping )
-      MakeResamplers();
+      ResetResamplers();
 }
 
 void Mixer::SetTimesAndSpeed(double t0, double t1, double speed)
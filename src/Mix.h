@@ -20,12 +20,14 @@
 #ifndef __AUDACITY_MIX__
 #define __AUDACITY_MIX__
 
+#include "Envelope.h" // member variable
+#include "Resample.h" // member variable
 #include "SampleFormat.h"
+#include <memory>
 #include <vector>
 
-class Resample;
 class DirManager;
-class BoundedEnvelope;
+class MemoryLock;
 class TrackFactory;
 class TrackList;
 class WaveTrack;
@@ -114,6 +116,17 @@ class AUDACITY_DLL_API Mixer {
 
    void ApplyTrackGains(bool apply = true); // True by default
 
+   /// Mix the input tracks on several threads at once, each into its own
+   /// accumulator, summed when all are done.  False by default.
+   /// Worthwhile for many tracks, especially with resampling; the result
+   /// may differ from serial mixing by rounding only.
+   void ProcessTracksInParallel(bool parallel = true);
+
+   /// Keep the output, queue and mixing buffers resident in RAM, for the
+   /// real-time threads of playback; returns whether all could be locked.
+   /// Buffers for extra threads of parallel mixing are not included.
+   bool LockMemory();
+
    //
    // Processing
    //
@@ -147,18 +160,43 @@ class AUDACITY_DLL_API Mixer {
    /// Retrieve one of the non-interleaved buffers
    samplePtr GetBuffer(int channel);
 
+   /// Layout of the buffers
+   unsigned GetNumChannels() const { return mNumChannels; }
+   bool IsInterleaved() const { return mInterleaved; }
+   sampleFormat GetFormat() const { return mFormat; }
+
  private:
 
-   void Clear();
+   // Buffers used while mixing tracks into an accumulator; there is one
+   // set for each thread that mixes
+   struct Scratch {
+      Floats           floatBuffer;
+      Floats           gains;
+      ArrayOf<SampleBuffer> temp;
+   };
+
+   void AllocateScratch(Scratch &scratch);
+   // Clear the accumulators, but not those that one of the tracks
+   // [begin, end) alone will fill
+   void Clear(Scratch &scratch, size_t begin, size_t end);
+   void GetChannelFlags(size_t iTrack, int *channelFlags) const;
+
+   // Mix tracks [begin, end) into scratch.temp, returning the most samples
+   // produced by any of them
+   size_t MixTracks(size_t begin, size_t end, Scratch &scratch);
+
    size_t MixSameRate(int *channelFlags, WaveTrackCache &cache,
-                           sampleCount *pos);
+                           sampleCount *pos, Scratch &scratch);
 
    size_t MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                                 sampleCount *pos, float *queue,
                                 int *queueStart, int *queueLen,
-                                Resample * pResample);
+                                Resample * pResample, Scratch &scratch);
+
+   size_t MixTracksInParallel(unsigned nThreads);
 
    void MakeResamplers();
+   void ResetResamplers();
 
  private:
 
@@ -167,37 +205,43 @@ class AUDACITY_DLL_API Mixer {
    ArrayOf<WaveTrackCache> mInputTrack;
    bool             mbVariableRates;
    const BoundedEnvelope *mEnvelope;
+   // Found once from mEnvelope, and shared by the threads mixing tracks
+   std::unique_ptr<Envelope::InverseIntegrals> mInverseIntegrals;
    ArrayOf<sampleCount> mSamplePos;
    bool             mApplyTrackGains;
-   Doubles          mEnvValues;
+   bool             mParallel;
    double           mT0; // Start time
    double           mT1; // Stop time (none if mT0==mT1)
    double           mTime;  // Current time (renamed from mT to mTime for consistency with AudioIO - mT represented warped time there)
-   ArrayOf<std::unique_ptr<Resample>> mResample;
+   ArrayOf<Resample::Pooled> mResample;
    size_t           mQueueMaxLen;
    FloatBuffers     mSampleQueue;
    ArrayOf<int>     mQueueStart;
    ArrayOf<int>     mQueueLen;
    size_t           mProcessLen;
    MixerSpec        *mMixerSpec;
+   // For each output channel, the only track that feeds it, or negative
+   std::vector<int> mSoleSource;
 
    // Output
    size_t              mMaxOut;
    unsigned         mNumChannels;
-   Floats           mGains;
    unsigned         mNumBuffers;
    size_t              mBufferSize;
    size_t              mInterleavedBufferSize;
    sampleFormat     mFormat;
    bool             mInterleaved;
-   ArrayOf<SampleBuffer> mBuffer, mTemp;
-   Floats           mFloatBuffer;
+   ArrayOf<SampleBuffer> mBuffer;
+   // mScratch[0] holds the mix; any others are for extra threads
+   std::vector<Scratch> mScratch;
    double           mRate;
    double           mSpeed;
    bool             mHighQuality;
    std::vector<double> mMinFactor, mMaxFactor;
 
    bool             mMayThrow;
+
+   std::vector< std::unique_ptr<MemoryLock> > mMemoryLocks;
 };
 
 #endif
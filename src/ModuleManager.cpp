@@ -590,6 +590,16 @@ PluginPaths ModuleManager::FindPluginsForProvider(const PluginID & providerID,
    return mDynModules[providerID]->FindPluginPaths(PluginManager::Get());
 }
 
+void ModuleManager::PrepareEffectPlugins(const PluginID & providerID, const PluginPaths & paths)
+{
+   if (mDynModules.find(providerID) == mDynModules.end())
+   {
+      return;
+   }
+
+   mDynModules[providerID]->PrepareDiscovery(paths);
+}
+
 bool ModuleManager::RegisterEffectPlugin(const PluginID & providerID, const PluginPath & path, TranslatableString &errMsg)
 {
    errMsg = {};
@@ -100,6 +100,7 @@ public:
    void FindAllPlugins(PluginIDs & providers, PluginPaths & paths);
 
    PluginPaths FindPluginsForProvider(const PluginID & provider, const PluginPath & path);
+   void PrepareEffectPlugins(const PluginID & provider, const PluginPaths & paths);
    bool RegisterEffectPlugin(const PluginID & provider, const PluginPath & path,
                        TranslatableString &errMsg);
 
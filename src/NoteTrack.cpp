@@ -26,6 +26,7 @@
 #include <wx/intl.h>
 
 #if defined(USE_MIDI)
+#include <algorithm>
 #include <sstream>
 
 #define ROUND(x) ((int) ((x) + 0.5))
@@ -106,6 +107,21 @@ SONFNS(AutoSave)
 
 
 
+// Notes of the sequence sorted by starting time, which is kept in seconds of
+// the sequence, grouped in fixed-size buckets that know the latest ending
+// time of their notes; so notes sounding in an interval are found by binary
+// search, skipping the buckets of earlier notes that have all ended
+struct NoteTrack::NoteIndex
+{
+   struct Entry {
+      double start, end;
+      Alg_note_ptr note;
+   };
+   std::vector< Entry > entries;
+   std::vector< double > bucketEnds;
+   static constexpr size_t BucketSize = 64;
+};
+
 static ProjectFileIORegistry::Entry registerFactory{
    wxT( "notetrack" ),
    []( AudacityProject &project ){
@@ -167,6 +183,70 @@ Alg_seq &NoteTrack::GetSeq() const
    return *mSeq;
 }
 
+void NoteTrack::FindNotes(
+   double t0, double t1, std::vector<Alg_note_ptr> &notes) const
+{
+   if (!mpNoteIndex) {
+      auto &seq = GetSeq();
+      seq.convert_to_seconds();
+
+      auto pIndex = std::make_unique<NoteIndex>();
+      auto &entries = pIndex->entries;
+      Alg_iterator iterator(&seq, false);
+      iterator.begin();
+      Alg_event_ptr evt;
+      while (0 != (evt = iterator.next())) {
+         if (evt->get_type() == 'n') {
+            const auto note = static_cast<Alg_note_ptr>(evt);
+            entries.push_back({ note->time, note->time + note->dur, note });
+         }
+      }
+      iterator.end();
+
+      // The iterator already visits events in time order
+      auto &bucketEnds = pIndex->bucketEnds;
+      for (size_t ii = 0; ii < entries.size(); ++ii) {
+         if (ii % NoteIndex::BucketSize == 0)
+            bucketEnds.push_back(entries[ii].end);
+         else
+            bucketEnds.back() = std::max(bucketEnds.back(), entries[ii].end);
+      }
+
+      mpNoteIndex = std::move(pIndex);
+   }
+
+   const auto &entries = mpNoteIndex->entries;
+   const auto &bucketEnds = mpNoteIndex->bucketEnds;
+   const auto offset = GetOffset();
+   t0 -= offset;
+   t1 -= offset;
+
+   // Notes starting at or after t1 are never visited
+   const size_t last = std::lower_bound(entries.begin(), entries.end(), t1,
+      [](const NoteIndex::Entry &entry, double t){ return entry.start < t; }
+   ) - entries.begin();
+
+   for (size_t bucket = 0, nBuckets = bucketEnds.size();
+        bucket < nBuckets; ++bucket) {
+      const auto begin = bucket * NoteIndex::BucketSize;
+      if (begin >= last)
+         break;
+      if (bucketEnds[bucket] <= t0)
+         continue;
+      const auto end = std::min(begin + NoteIndex::BucketSize, last);
+      for (auto ii = begin; ii < end; ++ii) {
+         const auto &entry = entries[ii];
+         if (entry.end > t0)
+            notes.push_back(entry.note);
+      }
+   }
+}
+
+void NoteTrack::InvalidateNoteIndex() const
+{
+   mpNoteIndex.reset();
+}
+
 Track::Holder NoteTrack::Clone() const
 {
    auto duplicate = std::make_shared<NoteTrack>(mDirManager);
@@ -257,6 +337,7 @@ void NoteTrack::WarpAndTransposeNotes(double t0, double t1,
    }
    // about to redisplay, so might as well convert back to time now
    seq.convert_to_seconds();
+   InvalidateNoteIndex();
 }
 
 // Draws the midi channel toggle buttons within the given rect.
@@ -389,6 +470,7 @@ bool NoteTrack::LabelClick(const wxRect &rect, int mx, int my, bool right)
 void NoteTrack::SetSequence(std::unique_ptr<Alg_seq> &&seq)
 {
    mSeq = std::move(seq);
+   InvalidateNoteIndex();
 }
 
 void NoteTrack::PrintSequence()
@@ -468,6 +550,7 @@ Track::Holder NoteTrack::Cut(double t0, double t1)
    seq.convert_to_seconds();
    newTrack->mSeq.reset(seq.cut(t0 - GetOffset(), len, false));
    newTrack->SetOffset(0);
+   InvalidateNoteIndex();
 
    // Not needed
    // Alg_seq::cut seems to handle this
@@ -517,6 +600,7 @@ bool NoteTrack::Trim(double t0, double t1)
    seq.clear(t1 - GetOffset(), seq.get_dur() + 10000.0, false);
    // Now that stuff beyond selection is cleared, clear before selection:
    seq.clear(0.0, t0 - GetOffset(), false);
+   InvalidateNoteIndex();
    // want starting time to be t0
    SetOffset(t0);
 
@@ -535,6 +619,7 @@ void NoteTrack::Clear(double t0, double t1)
    double len = t1-t0;
 
    auto &seq = GetSeq();
+   InvalidateNoteIndex();
 
    auto offset = GetOffset();
    auto start = t0 - offset;
@@ -599,6 +684,7 @@ void NoteTrack::Paste(double t, const Track *src)
       //delta += other->GetSeq().get_real_dur();
 
       seq.paste(t - GetOffset(), &other->GetSeq());
+      InvalidateNoteIndex();
 
       AddToDuration( delta );
 
@@ -623,6 +709,7 @@ void NoteTrack::Silence(double t0, double t1)
    // If it's set, then it seems like notes are silenced if they start or end in the range,
    // otherwise only if they start in the range. --Poke
    seq.silence(t0 - GetOffset(), len, false);
+   InvalidateNoteIndex();
 }
 
 void NoteTrack::InsertSilence(double t, double len)
@@ -633,6 +720,7 @@ void NoteTrack::InsertSilence(double t, double len)
    auto &seq = GetSeq();
    seq.convert_to_seconds();
    seq.insert_silence(t - GetOffset(), len);
+   InvalidateNoteIndex();
 
    // is this needed?
    // AddToDuration( len );
@@ -672,6 +760,7 @@ bool NoteTrack::Shift(double t) // t is always seconds
    } else { // offset is zero, no modifications
       return false;
    }
+   InvalidateNoteIndex();
    return true;
 }
 
@@ -704,6 +793,7 @@ bool NoteTrack::StretchRegion
    auto &seq = GetSeq();
    bool result = seq.stretch_region( t0.second, t1.second, newDur );
    if (result) {
+      InvalidateNoteIndex();
       const auto oldDur = t1.first - t0.first;
       AddToDuration( newDur - oldDur );
    }
@@ -907,6 +997,7 @@ bool NoteTrack::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
              std::string s(strValue.mb_str(wxConvUTF8));
              std::istringstream data(s);
              mSeq = std::make_unique<Alg_seq>(data, false);
+             InvalidateNoteIndex();
          }
       } // while
       return true;
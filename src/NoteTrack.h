@@ -83,6 +83,13 @@ public:
 
    Alg_seq &GetSeq() const;
 
+   /// Append the notes that sound at some time in [t0, t1), in order of
+   /// starting time; t0 and t1 include the track offset
+   void FindNotes(double t0, double t1, std::vector<Alg_note_ptr> &notes) const;
+   /// Must be called after changing the times of events of the sequence
+   /// returned by GetSeq(), other than by member functions of NoteTrack
+   void InvalidateNoteIndex() const;
+
    void WarpAndTransposeNotes(double t0, double t1,
                               const TimeWarper &warper, double semitones);
 
@@ -202,6 +209,10 @@ public:
    mutable std::unique_ptr<char[]> mSerializationBuffer;
    mutable long mSerializationLength;
 
+   // Made on demand by FindNotes and discarded after edits
+   struct NoteIndex;
+   mutable std::unique_ptr<NoteIndex> mpNoteIndex;
+
 #ifdef EXPERIMENTAL_MIDI_OUT
    float mVelocity; // velocity offset
 #endif
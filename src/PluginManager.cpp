@@ -50,6 +50,7 @@ for shared and private configs - which need to move out.
 #include "widgets/AudacityMessageBox.h"
 #include "widgets/ProgressDialog.h"
 
+#include <map>
 #include <unordered_map>
 
 // ============================================================================
@@ -995,6 +996,26 @@ void PluginRegistrationDialog::OnOK(wxCommandEvent & WXUNUSED(evt))
          Verbatim( GetTitle() ), msg, pdlgHideStopButton };
       progress.CenterOnParent();
 
+      // Let each provider look at all of the paths it may be asked to
+      // register before the one at a time registration below, so that it
+      // can examine them in parallel
+      std::map<PluginID, PluginPaths> pathsByProvider;
+      for (ItemDataMap::iterator iter = mItems.begin(); iter != mItems.end(); ++iter)
+      {
+         ItemData & item = iter->second;
+         if (item.state == STATE_Enabled && item.plugs[0]->GetPluginType() == PluginTypeStub)
+         {
+            for (size_t j = 0, cntj = item.plugs.size(); j < cntj; j++)
+            {
+               pathsByProvider[item.plugs[j]->GetProviderID()].push_back(item.path);
+            }
+         }
+      }
+      for (auto &pair : pathsByProvider)
+      {
+         mm.PrepareEffectPlugins(pair.first, pair.second);
+      }
+
       int i = 0;
       for (ItemDataMap::iterator iter = mItems.begin(); iter != mItems.end(); ++iter)
       {
@@ -1232,6 +1253,16 @@ void PluginDescriptor::SetValid(bool valid)
    mValid = valid;
 }
 
+const wxString & PluginDescriptor::GetFileStamp() const
+{
+   return mFileStamp;
+}
+
+void PluginDescriptor::SetFileStamp(const wxString & stamp)
+{
+   mFileStamp = stamp;
+}
+
 // Effects
 
 wxString PluginDescriptor::GetEffectFamily() const
@@ -1353,6 +1384,7 @@ void PluginDescriptor::SetImporterExtensions( FileExtensions extensions )
 #define KEY_LASTUPDATED                wxT("LastUpdated")
 #define KEY_ENABLED                    wxT("Enabled")
 #define KEY_VALID                      wxT("Valid")
+#define KEY_FILESTAMP                  wxT("FileStamp")
 #define KEY_PROVIDERID                 wxT("ProviderID")
 #define KEY_EFFECTTYPE                 wxT("EffectType")
 #define KEY_EFFECTFAMILY               wxT("EffectFamily")
@@ -1481,6 +1513,7 @@ const PluginID & PluginManager::RegisterPlugin(ModuleInterface *provider, Effect
 
    plug.SetEnabled(true);
    plug.SetValid(true);
+   plug.SetFileStamp(GetFileStamp(plug.GetPath()));
 
    return plug.GetID();
 }
@@ -2140,6 +2173,10 @@ void PluginManager::LoadGroup(wxFileConfig *pRegistry, PluginType type)
       pRegistry->Read(KEY_VALID, &boolVal, false);
       plug.SetValid(boolVal);
 
+      // When was it found valid (optional)
+      pRegistry->Read(KEY_FILESTAMP, &strVal, wxEmptyString);
+      plug.SetFileStamp(strVal);
+
       switch (type)
       {
          case PluginTypeModule:
@@ -2313,6 +2350,8 @@ void PluginManager::SaveGroup(wxFileConfig *pRegistry, PluginType type)
       pRegistry->Write(KEY_PROVIDERID, plug.GetProviderID());
       pRegistry->Write(KEY_ENABLED, plug.IsEnabled());
       pRegistry->Write(KEY_VALID, plug.IsValid());
+      if (!plug.GetFileStamp().empty())
+         pRegistry->Write(KEY_FILESTAMP, plug.GetFileStamp());
 
       switch (type)
       {
@@ -2367,6 +2406,26 @@ void PluginManager::SaveGroup(wxFileConfig *pRegistry, PluginType type)
    return;
 }
 
+wxString PluginManager::GetFileStamp(const PluginPath & path)
+{
+   // Paths of some providers append more to the file path, or are no file
+   // paths at all
+   wxFileName fn{ path.BeforeFirst(wxT(';')) };
+   if (!fn.IsAbsolute() || !fn.FileExists())
+   {
+      return {};
+   }
+
+   wxDateTime modified;
+   if (!fn.GetTimes(nullptr, &modified, nullptr))
+   {
+      return {};
+   }
+
+   return wxString::Format(wxT("%s:%s"),
+      modified.GetValue().ToString(), fn.GetSize().ToString());
+}
+
 // If bFast is true, do not do a full check.  Just check the ones
 // that are quick to check.  Currently (Feb 2017) just Nyquist
 // and built-ins.
@@ -2447,11 +2506,23 @@ void PluginManager::CheckForUpdates(bool bFast)
       }
       else if (plugType != PluginTypeNone && plugType != PluginTypeStub)
       {
+         // A plugin found valid before, whose file is unchanged since, is
+         // still valid without asking the provider, which may load it
+         const auto stamp = bFast ? wxString{} : GetFileStamp(plugPath);
+         if (plug.IsValid() && !stamp.empty() && stamp == plug.GetFileStamp())
+         {
+            continue;
+         }
+
          plug.SetValid(mm.IsPluginValid(plug.GetProviderID(), plugPath, bFast));
          if (!plug.IsValid())
          {
             plug.SetEnabled(false);
          }
+         else if (!bFast)
+         {
+            plug.SetFileStamp(stamp);
+         }
       }
    }
 
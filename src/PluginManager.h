@@ -70,6 +70,10 @@ public:
    bool IsEnabled() const;
    bool IsValid() const;
 
+   // Modification time and size of the plugin's file when it was last
+   // found valid; empty if its path is no file
+   const wxString & GetFileStamp() const;
+
    // These should be passed an untranslated value
    void SetID(const PluginID & ID);
    void SetProviderID(const PluginID & providerID);
@@ -83,6 +87,7 @@ public:
 
    void SetEnabled(bool enable);
    void SetValid(bool valid);
+   void SetFileStamp(const wxString & stamp);
 
    // Effect plugins only
 
@@ -139,6 +144,7 @@ private:
    wxString mProviderID;
    bool mEnabled;
    bool mValid;
+   wxString mFileStamp;
 
    // Effects
 
@@ -277,6 +283,10 @@ private:
 
    PluginDescriptor & CreatePlugin(const PluginID & id, ComponentInterface *ident, PluginType type);
 
+   // Modification time and size of the file named by the path, which change
+   // when the plugin is replaced; empty if the path is no file
+   static wxString GetFileStamp(const PluginPath & path);
+
    wxFileConfig *GetSettings();
 
    bool HasGroup(const RegistryPath & group);
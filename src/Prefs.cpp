@@ -185,6 +185,54 @@ AudacityPrefs::AudacityPrefs(const wxString& appName,
                style,
                conv)
 {
+   // Values cached from any earlier object are not valid
+   ++sGeneration;
+}
+
+std::atomic<unsigned long> AudacityPrefs::sGeneration{ 1 };
+
+bool AudacityPrefs::RenameEntry(
+   const wxString& oldName, const wxString& newName)
+{
+   ++sGeneration;
+   return wxFileConfig::RenameEntry( oldName, newName );
+}
+
+bool AudacityPrefs::RenameGroup(
+   const wxString& oldName, const wxString& newName)
+{
+   ++sGeneration;
+   return wxFileConfig::RenameGroup( oldName, newName );
+}
+
+bool AudacityPrefs::DeleteEntry(const wxString& key, bool bDeleteGroupIfEmpty)
+{
+   ++sGeneration;
+   return wxFileConfig::DeleteEntry( key, bDeleteGroupIfEmpty );
+}
+
+bool AudacityPrefs::DeleteGroup(const wxString& key)
+{
+   ++sGeneration;
+   return wxFileConfig::DeleteGroup( key );
+}
+
+bool AudacityPrefs::DeleteAll()
+{
+   ++sGeneration;
+   return wxFileConfig::DeleteAll();
+}
+
+bool AudacityPrefs::DoWriteString(const wxString& key, const wxString& szValue)
+{
+   ++sGeneration;
+   return wxFileConfig::DoWriteString( key, szValue );
+}
+
+bool AudacityPrefs::DoWriteLong(const wxString& key, long lValue)
+{
+   ++sGeneration;
+   return wxFileConfig::DoWriteLong( key, lValue );
 }
 
 
@@ -270,8 +318,13 @@ const EnumValueSymbol &ChoiceSetting::Default() const
 
 wxString ChoiceSetting::Read() const
 {
-   const auto &defaultValue = Default().Internal();
-   return ReadWithDefault( defaultValue );
+   if ( mGeneration != AudacityPrefs::GetGeneration() ) {
+      const auto &defaultValue = Default().Internal();
+      mCachedValue = ReadWithDefault( defaultValue );
+      // Migration may have written
+      mGeneration = AudacityPrefs::GetGeneration();
+   }
+   return mCachedValue;
 }
 
 wxString ChoiceSetting::ReadWithDefault( const wxString &defaultValue ) const
@@ -336,8 +389,11 @@ EnumSettingBase::EnumSettingBase(
 
 void ChoiceSetting::SetDefault( long value )
 {
-   if ( value < (long)mSymbols.size() )
+   if ( value < (long)mSymbols.size() ) {
       mDefaultSymbol = value;
+      // Read again
+      mGeneration = 0;
+   }
    else
       wxASSERT( false );
 }
@@ -34,6 +34,7 @@
 #include "../include/audacity/ComponentInterface.h"
 #include "MemoryX.h" // for wxArrayStringEx
 
+#include <atomic>
 #include <memory>
 #include <wx/fileconf.h>  // to inherit wxFileConfig
 #include <wx/event.h> // to declare custom event types
@@ -84,6 +85,25 @@ public:
    int mVersionMajorKeyInit{};
    int mVersionMinorKeyInit{};
    int mVersionMicroKeyInit{};
+
+   // Changes with every write, rename or deletion of entries in any
+   // AudacityPrefs object, so that cached values know when to read again
+   static unsigned long GetGeneration() { return sGeneration.load(); }
+
+   bool RenameEntry(const wxString& oldName, const wxString& newName) override;
+   bool RenameGroup(const wxString& oldName, const wxString& newName) override;
+   bool DeleteEntry(const wxString& key, bool bDeleteGroupIfEmpty = true)
+      override;
+   bool DeleteGroup(const wxString& key) override;
+   bool DeleteAll() override;
+
+protected:
+   // wxConfigBase writes all other types through these
+   bool DoWriteString(const wxString& key, const wxString& szValue) override;
+   bool DoWriteLong(const wxString& key, long lValue) override;
+
+private:
+   static std::atomic<unsigned long> sGeneration;
 };
 
 struct ByColumns_t{};
@@ -163,6 +183,10 @@ protected:
    // stores an internal value
    mutable bool mMigrated { false };
 
+   // The result of Read() when gPrefs was at the given generation
+   mutable wxString mCachedValue;
+   mutable unsigned long mGeneration { 0 };
+
    long mDefaultSymbol;
 };
 
@@ -241,6 +265,49 @@ public:
 
 };
 
+/// A typed preference with a key path and a default, for values read often,
+/// as when starting a stream or creating a track.  The value is cached, and
+/// gPrefs is read again only after some preference has changed.  Use it on
+/// the main thread.
+template< typename T >
+class Setting
+{
+public:
+   Setting( const wxString &key, const T &defaultValue )
+      : mKey{ key }
+      , mDefaultValue{ defaultValue }
+   {
+      wxASSERT( key.StartsWith( wxT("/") ) );
+   }
+
+   const wxString &Key() const { return mKey; }
+   const T &GetDefault() const { return mDefaultValue; }
+
+   T Read() const
+   {
+      if ( mGeneration != AudacityPrefs::GetGeneration() ) {
+         mValue = gPrefs
+            ? gPrefs->ReadObject( mKey, mDefaultValue )
+            : mDefaultValue;
+         mGeneration = AudacityPrefs::GetGeneration();
+      }
+      return mValue;
+   }
+
+   bool Write( const T &value ) // you flush gPrefs afterward
+   {
+      return gPrefs && gPrefs->Write( mKey, value );
+   }
+
+private:
+   const wxString mKey;
+   const T mDefaultValue;
+
+   mutable T mValue{};
+   // Generations start at 1, so the first read always reads gPrefs
+   mutable unsigned long mGeneration{ 0 };
+};
+
 // An event emitted by the application when the Preference dialog commits
 // changes
 wxDECLARE_EVENT(EVT_PREFS_UPDATE, wxCommandEvent);
@@ -24,12 +24,33 @@ but it will probably work fine if you use it on a high level.
 #include "Profiler.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wx/crt.h>
 
+namespace {
+// Events each thread can record; later ones are dropped and counted
+const size_t TraceBufferEvents = 1 << 18;
+
+const char *TraceFileName()
+{
+   return getenv("AUDACITY_TRACE_FILE");
+}
+}
+
+bool Profiler::sTracing = TraceFileName() != nullptr;
+
+Profiler::Profiler()
+   : mStartTime{ std::chrono::steady_clock::now() }
+{
+}
+
 ///write to a profile at the end of the test.
 Profiler::~Profiler()
 {
+   if (sTracing)
+      WriteTrace();
+
    if(mTasks.size())
    {
       //print everything out.  append to a log.
@@ -88,6 +109,72 @@ Profiler* Profiler::Instance()
    return &pro;
 }
 
+void Profiler::Record(const char* name, char phase)
+{
+   static thread_local TraceBuffer* tBuffer = nullptr;
+   auto pProfiler = Instance();
+   if (!tBuffer)
+      tBuffer = pProfiler->AddTraceBuffer();
+
+   // Only this thread appends, so there is no need for a lock; the release
+   // makes the event visible to the writer at exit
+   auto &buffer = *tBuffer;
+   const auto count = buffer.count.load(std::memory_order_relaxed);
+   if (count == buffer.events.size()) {
+      ++pProfiler->mDroppedEvents;
+      return;
+   }
+   buffer.events[count] = { name,
+      std::chrono::steady_clock::now() - pProfiler->mStartTime, phase };
+   buffer.count.store(count + 1, std::memory_order_release);
+}
+
+Profiler::TraceBuffer::TraceBuffer(unsigned long id)
+   : events( TraceBufferEvents )
+   , threadId{ id }
+{
+}
+
+Profiler::TraceBuffer* Profiler::AddTraceBuffer()
+{
+   ODLocker locker(&mTraceBuffersMutex);
+   mTraceBuffers.push_back(
+      std::make_unique<TraceBuffer>( mTraceBuffers.size() + 1 ) );
+   return mTraceBuffers.back().get();
+}
+
+///write all trace events in the Chrome trace event format
+void Profiler::WriteTrace()
+{
+   FILE* trace = fopen(TraceFileName(), "w");
+   if (!trace)
+      return;
+
+   ODLocker locker(&mTraceBuffersMutex);
+   wxFprintf(trace, "{\"traceEvents\":[\n");
+   bool first = true;
+   for (const auto &pBuffer : mTraceBuffers)
+   {
+      const auto count = pBuffer->count.load(std::memory_order_acquire);
+      for (size_t i = 0; i < count; i++)
+      {
+         const auto &event = pBuffer->events[i];
+         const double microseconds = std::chrono::duration<double, std::micro>(
+            event.time ).count();
+         // Names are string literals in the code, without quotes to escape
+         wxFprintf(trace,
+            "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu}",
+            first ? "" : ",\n", event.name, event.phase, microseconds,
+            pBuffer->threadId);
+         first = false;
+      }
+   }
+   wxFprintf(trace,
+      "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%lu}}\n",
+      (unsigned long)mDroppedEvents.load());
+   fclose(trace);
+}
+
 ///find a taskProfile for the given task, otherwise create
 TaskProfile* Profiler::GetOrCreateTaskProfile(const char* fileName, int lineNum)
 {
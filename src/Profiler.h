@@ -18,6 +18,12 @@ but it will probably work fine if you use it on a high level.
 \class TaskProfile
 \brief a simple class to keep track of one task that may be called multiple times.
 
+\class ProfileScope
+\brief Records the beginning and end of a scope as trace events, when the
+environment variable AUDACITY_TRACE_FILE names a file.  Each thread appends
+to its own buffer without locking; at exit, all are written to that file as
+Chrome trace (Perfetto) JSON.  Scopes may nest.
+
 *//*******************************************************************/
 
 
@@ -26,6 +32,8 @@ but it will probably work fine if you use it on a high level.
 
 #ifndef __AUDACITY_PROFILER__
 #define __AUDACITY_PROFILER__
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <time.h>
 #include "ondemand/ODTaskThread.h"
@@ -34,6 +42,11 @@ but it will probably work fine if you use it on a high level.
 #define BEGIN_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->Begin(__FILE__,__LINE__,TASK_DESCRIPTION)
 #define END_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->End(__FILE__,__LINE__,TASK_DESCRIPTION)
 
+#define PROFILE_SCOPE_CAT(a, b) a ## b
+#define PROFILE_SCOPE_NAME(line) PROFILE_SCOPE_CAT(profileScope, line)
+/// Trace the rest of the enclosing scope; NAME must be a string literal
+#define PROFILE_SCOPE(NAME) ProfileScope PROFILE_SCOPE_NAME(__LINE__){ NAME }
+
 class TaskProfile;
 class Profiler
 {
@@ -50,9 +63,32 @@ class Profiler
    ///Gets the singleton instance
    static Profiler* Instance();
 
+   ///whether ProfileScope records trace events; fixed at startup
+   static bool Tracing() { return sTracing; }
+
+   ///append a trace event for the calling thread; phase is 'B' or 'E'
+   static void Record(const char* name, char phase);
+
   protected:
    ///private constructor - Singleton.
-   Profiler(){};
+   Profiler();
+
+   struct TraceEvent {
+      const char* name;
+      std::chrono::steady_clock::duration time;
+      char phase;
+   };
+   ///events of one thread, appended only by it
+   struct TraceBuffer {
+      explicit TraceBuffer(unsigned long threadId);
+      std::vector<TraceEvent> events;
+      std::atomic<size_t> count{ 0 };
+      unsigned long threadId;
+   };
+   TraceBuffer* AddTraceBuffer();
+   void WriteTrace();
+
+   static bool sTracing;
 
    ///find a taskProfile for the given task, otherwise create
    TaskProfile* GetOrCreateTaskProfile(const char* fileName, int lineNum);
@@ -63,6 +99,34 @@ class Profiler
    //mutex for above variable
    ODLock mTasksMutex;
 
+   //Buffers of all threads that recorded trace events, kept until exit
+   std::vector<std::unique_ptr<TraceBuffer>> mTraceBuffers;
+   //mutex for above variable, locked once by each thread that traces
+   ODLock mTraceBuffersMutex;
+   std::chrono::steady_clock::time_point mStartTime;
+   std::atomic<size_t> mDroppedEvents{ 0 };
+};
+
+class ProfileScope
+{
+public:
+   explicit ProfileScope(const char* name)
+      : mName{ Profiler::Tracing() ? name : nullptr }
+   {
+      if (mName)
+         Profiler::Record(mName, 'B');
+   }
+   ~ProfileScope()
+   {
+      if (mName)
+         Profiler::Record(mName, 'E');
+   }
+
+   ProfileScope(const ProfileScope&) = delete;
+   ProfileScope& operator= (const ProfileScope&) = delete;
+
+private:
+   const char* mName;
 };
 
  class TaskProfile
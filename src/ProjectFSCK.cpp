@@ -72,14 +72,14 @@ int ProjectFSCK(
 
    FilePaths filePathArray; // *all* files in the project directory/subdirectories
    auto dirPath = ( dm.GetDataFilesDir() );
-   DirManager::RecursivelyEnumerateWithProgress(
+   // If the user cancels the enumeration, the files found so far still save
+   // looking for them one by one, but orphans are not sought
+   const bool bEnumerated = DirManager::EnumerateFilesInParallel(
       dirPath,
       filePathArray,          // output: all files in project directory tree
-      wxEmptyString,          // All dirs
-      wxEmptyString,          // All files
-      true, false,
-      dm.NumBlockFiles(),  // rough guess of how many BlockFiles will be found/processed, for progress
       XO("Inspecting project file data"));
+   const DirManager::FilePathSet presentFiles(
+      filePathArray.begin(), filePathArray.end() );
 
    //
    // MISSING ALIASED AUDIO FILES
@@ -178,7 +178,7 @@ XO("Project check of \"%s\" folder \
    // Alias summary regeneration must happen after checking missing aliased files.
    //
    BlockHash missingAUFHash;              // missing (.auf) AliasBlockFiles
-   dm.FindMissingAUFs(missingAUFHash);
+   dm.FindMissingAUFs(missingAUFHash, &presentFiles);
    if ((nResult != FSCKstatus_CLOSE_REQ) && !missingAUFHash.empty())
    {
       // In auto-recover mode, we just recreate the alias files, and do not ask user.
@@ -324,7 +324,8 @@ XO("Project check of \"%s\" folder \
    // ORPHAN BLOCKFILES (.au and .auf files that are not in the project.)
    //
    FilePaths orphanFilePathArray;     // orphan .au and .auf files
-   dm.FindOrphanBlockFiles(filePathArray, orphanFilePathArray);
+   if (bEnumerated)
+      dm.FindOrphanBlockFiles(filePathArray, orphanFilePathArray);
 
    if ((nResult != FSCKstatus_CLOSE_REQ) && !orphanFilePathArray.empty())
    {
@@ -19,6 +19,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "ProjectFileIORegistry.h"
 #include "ProjectSettings.h"
 #include "Tags.h"
+#include "UndoManager.h"
 #include "ViewInfo.h"
 #include "WaveTrack.h"
 #include "widgets/AudacityMessageBox.h"
@@ -425,7 +426,8 @@ void ProjectFileIO::WriteXMLHeader(XMLWriter &xmlFile) const
 }
 
 void ProjectFileIO::WriteXML(
-   XMLWriter &xmlFile, FilePaths *strOtherNamesArray)
+   XMLWriter &xmlFile, FilePaths *strOtherNamesArray,
+   ClipXMLCache *pClipCache)
 // may throw
 {
    auto &proj = mProject;
@@ -516,7 +518,7 @@ void ProjectFileIO::WriteXML(
          }
          else {
             pWaveTrack->SetAutoSaveIdent(mAutoSaving ? ++ndx : 0);
-            pWaveTrack->WriteXML(xmlFile);
+            pWaveTrack->WriteXML(xmlFile, pClipCache);
          }
       },
       [&](Track *t) {
@@ -592,17 +594,31 @@ void ProjectFileIO::AutoSave()
    {
       VarSetter<bool> setter(&mAutoSaving, true, false);
 
+      if (!mAutoSaveClipCache)
+         mAutoSaveClipCache = std::make_unique<ClipXMLCache>();
+      mAutoSaveClipCache->Abandon();
+
       AutoSaveFile buffer;
       WriteXMLHeader( buffer );
-      WriteXML( buffer, nullptr );
+      WriteXML( buffer, nullptr, mAutoSaveClipCache.get() );
 
       wxFFile saveFile;
       saveFile.Open(fn + wxT(".tmp"), wxT("wb"));
       return buffer.Write(saveFile);
    } );
 
-   if (!success)
+   if (!success) {
+      if (mAutoSaveClipCache)
+         mAutoSaveClipCache->Abandon();
       return;
+   }
+
+   // The copies in the current undo state do not change, and usually are
+   // shared with the next state for clips that an edit leaves alone
+   if (auto pStateTracks = UndoManager::Get( project ).GetCurrentTracks())
+      mAutoSaveClipCache->Commit( TrackList::Get( project ), *pStateTracks );
+   else
+      mAutoSaveClipCache->Abandon();
 
    // Now that we have a NEW auto-save file, DELETE the old one
    DeleteCurrentAutoSaveFile();
@@ -11,11 +11,13 @@ Paul Licameli split from AudacityProject.h
 #ifndef __AUDACITY_PROJECT_FILE_IO__
 #define __AUDACITY_PROJECT_FILE_IO__
 
+#include <memory>
 #include "ClientData.h" // to inherit
 #include "Prefs.h" // to inherit
 #include "xml/XMLTagHandler.h" // to inherit
 
 class AudacityProject;
+class ClipXMLCache;
 
 ///\brief Object associated with a project that manages reading and writing
 /// of Audacity project file formats, and autosave
@@ -59,9 +61,10 @@ public:
 
    // If the second argument is not null, that means we are saving a
    // compressed project, and the wave tracks have been exported into the
-   // named files
+   // named files.  If the third is not null, wave clips are written through it.
    void WriteXML(
-      XMLWriter &xmlFile, FilePaths *strOtherNamesArray) /* not override */;
+      XMLWriter &xmlFile, FilePaths *strOtherNamesArray,
+      ClipXMLCache *pClipCache = nullptr) /* not override */;
 
 private:
    // XMLTagHandler callback methods
@@ -74,6 +77,8 @@ private:
 
    // Last auto-save file name and path (empty if none)
    FilePath mAutoSaveFileName;
+   // Encodings of clips at the last autosave, to append again while unchanged
+   std::unique_ptr<ClipXMLCache> mAutoSaveClipCache;
 
    // Are we currently auto-saving or not?
    bool mAutoSaving{ false };
@@ -12,7 +12,14 @@ Paul Licameli split from AudacityProject.cpp
 
 #include "Experimental.h"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <wx/app.h>
 #include <wx/crt.h> // for wxPrintf
+#include <wx/log.h>
+#include <wx/utils.h>
 
 #if defined(__WXGTK__)
 #include <wx/evtloop.h>
@@ -38,6 +45,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "SelectUtilities.h"
 #include "SelectionState.h"
 #include "Sequence.h"
+#include "SummaryPrefetcher.h"
 #include "Tags.h"
 #include "TrackPanelAx.h"
 #include "TrackPanel.h"
@@ -49,6 +57,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "export/Export.h"
 #include "import/Import.h"
 #include "import/ImportMIDI.h"
+#include "import/ImportPlugin.h"
 #include "commands/CommandContext.h"
 #include "ondemand/ODComputeSummaryTask.h"
 #include "ondemand/ODDecodeFlacTask.h"
@@ -58,6 +67,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "widgets/AudacityMessageBox.h"
 #include "widgets/ErrorDialog.h"
 #include "widgets/FileHistory.h"
+#include "widgets/ProgressDialog.h"
 #include "widgets/Warning.h"
 #include "xml/XMLFileReader.h"
 
@@ -169,6 +179,8 @@ auto ProjectFileManager::ReadProjectFile( const FilePath &fileName )
    ///
 
    XMLFileReader xmlFile;
+   BinaryProjectReader binaryFile;
+   const bool binary = BinaryProjectReader::IsBinaryProject( fileName );
 
 #ifdef EXPERIMENTAL_OD_DATA
    // 'Lossless copy' projects have dependencies. We need to always copy-in
@@ -193,7 +205,13 @@ auto ProjectFileManager::ReadProjectFile( const FilePath &fileName )
    } );
 #endif
 
-   bool bParseSuccess = xmlFile.Parse(&projectFileIO, fileName);
+   bool bParseSuccess = binary
+      ? binaryFile.Parse(&projectFileIO, fileName)
+      : xmlFile.Parse(&projectFileIO, fileName);
+
+   // Whether or not the parse succeeded, the blocks it made are done with
+   // their background reads before anything else looks at them
+   DirManager::Get( project ).FinishLoading();
    
    bool err = false;
 
@@ -223,7 +241,8 @@ auto ProjectFileManager::ReadProjectFile( const FilePath &fileName )
    }
 
    return {
-      false, bParseSuccess, err, xmlFile.GetErrorStr(),
+      false, bParseSuccess, err,
+      binary ? binaryFile.GetErrorStr() : xmlFile.GetErrorStr(),
       FindHelpUrl( xmlFile.GetLibraryErrorStr() )
    };
 }
@@ -497,8 +516,27 @@ bool ProjectFileManager::DoSave (const bool fromSaveAs,
    // (SetProject, when it fails, cleans itself up.)
    XMLFileWriter saveFile{ fileName, XO("Error Saving Project") };
    success = GuardedCall< bool >( [&] {
-         projectFileIO.WriteXMLHeader(saveFile);
-         projectFileIO.WriteXML(saveFile, bWantSaveCopy ? &strOtherNamesArray : nullptr);
+         // Write again the text of clips unchanged since the last save
+         ClipXMLCache *pClipCache = nullptr;
+         if (!bWantSaveCopy) {
+            if (!mClipXMLCache)
+               mClipXMLCache = std::make_unique<ClipXMLCache>();
+            mClipXMLCache->Abandon();
+            pClipCache = mClipXMLCache.get();
+         }
+         auto pOtherNames = bWantSaveCopy ? &strOtherNamesArray : nullptr;
+
+         if (AutoSaveFile::GetBinaryProjectFiles()) {
+            // Encode in memory, then write the result in one piece
+            AutoSaveFile buffer;
+            projectFileIO.WriteXMLHeader(buffer);
+            projectFileIO.WriteXML(buffer, pOtherNames, pClipCache);
+            buffer.WriteProject(saveFile);
+         }
+         else {
+            projectFileIO.WriteXMLHeader(saveFile);
+            projectFileIO.WriteXML(saveFile, pOtherNames, pClipCache);
+         }
          // Flushes files, forcing space exhaustion errors before trying
          // SetProject():
          saveFile.PreCommit();
@@ -601,6 +639,9 @@ bool ProjectFileManager::DoSave (const bool fromSaveAs,
          //            wt->MarkSaved();
       }
 
+      if (mClipXMLCache)
+         mClipXMLCache->Commit( tracks, *mLastSavedTracks );
+
       UndoManager::Get( proj ).StateSaved();
    }
 
@@ -1041,6 +1082,7 @@ void ProjectFileManager::CloseLock()
       mLastSavedTracks->Clear();
       mLastSavedTracks.reset();
    }
+   mClipXMLCache.reset();
 }
 
 // static method, can be called outside of a project
@@ -1400,6 +1442,7 @@ void ProjectFileManager::OpenFile(const FilePath &fileNameArg, bool addtohistory
             // This is a no-fail:
             dirManager.FillBlockfilesCache();
             EnqueueODTasks();
+            SummaryPrefetcher::Get( project ).Start();
          }
 
          // For an unknown reason, OSX requires that the project window be
@@ -1684,3 +1727,205 @@ bool ProjectFileManager::Import(
    dirManager.FillBlockfilesCache();
    return true;
 }
+
+void ProjectFileManager::ImportFiles(const wxArrayString &fileNames)
+{
+   auto &project = mProject;
+   auto &dirManager = DirManager::Get( project );
+   auto &trackFactory = TrackFactory::Get( project );
+
+   bool inParallel = false;
+   gPrefs->Read(wxT("/AudioFiles/ImportInParallel"), &inParallel, false);
+   if (!inParallel || fileNames.size() < 2) {
+      for (const auto &fileName : fileNames)
+         Import(fileName);
+      return;
+   }
+
+   // One of these for each file being imported
+   struct Job {
+      Job( std::mutex &setupMutex, const FilePath &name )
+         : concurrentImport{ setupMutex }
+         , fileName{ name }
+      {}
+
+      ConcurrentImport concurrentImport;
+      const FilePath fileName;
+      // Null if the file was imported while it was opened
+      std::unique_ptr<ImportFileHandle> handle;
+      // Only the tags found in the file
+      std::shared_ptr<Tags> tags;
+      TrackHolders tracks;
+      std::thread thread;
+      std::atomic<bool> done{ false };
+      ProgressResult result{ ProgressResult::Success };
+      std::exception_ptr exception;
+   };
+
+   enum : size_t { MaxOpenImports = 32 };
+   std::mutex setupMutex;
+   std::vector<std::unique_ptr<Job>> jobs;
+   std::exception_ptr exception;
+
+   // Whatever happens, wait for the threads before the jobs are destroyed
+   auto cleanup = finally( [&] {
+      for (auto &pJob : jobs)
+         pJob->concurrentImport.Request(ProgressResult::Cancelled);
+      for (auto &pJob : jobs)
+         if (pJob->thread.joinable())
+            pJob->thread.join();
+   } );
+
+   // Decode the opened files, then add their tracks in order
+   auto finishJobs = [&] {
+      if (jobs.empty())
+         return;
+
+      std::vector<Job*> todo;
+      for (auto &pJob : jobs)
+         if (pJob->handle)
+            todo.push_back( pJob.get() );
+
+      if (!todo.empty()) {
+         auto busy = valueRestorer( project.mbBusyImporting, true );
+         const size_t nThreads =
+            std::max(1u, std::thread::hardware_concurrency());
+         ProgressDialog progress{ XO("Import"),
+            XO("Importing %lld files").Format( (long long) todo.size() ) };
+
+         auto next = todo.begin();
+         std::vector<Job*> running;
+         size_t nDone = 0;
+         auto request = ProgressResult::Success;
+         while (next != todo.end() || !running.empty()) {
+            // Keep the processors busy, until stopped or cancelled
+            while (request == ProgressResult::Success &&
+                   next != todo.end() && running.size() < nThreads) {
+               auto &job = **next++;
+               job.thread = std::thread( [&job, &trackFactory] {
+                  try {
+                     ConcurrentImport::Scope scope{ job.concurrentImport };
+                     job.result = job.handle->Import(
+                        &trackFactory, job.tracks, job.tags.get() );
+                  }
+                  catch( ... ) {
+                     job.result = ProgressResult::Failed;
+                     job.exception = std::current_exception();
+                  }
+                  job.done.store( true );
+               } );
+               running.push_back( &job );
+            }
+            if (request != ProgressResult::Success) {
+               // Files not yet started are skipped
+               for (; next != todo.end(); ++next)
+                  (*next)->result = ProgressResult::Cancelled;
+            }
+
+            double fraction = nDone;
+            for (auto iter = running.begin(); iter != running.end();) {
+               auto &job = **iter;
+               if (!job.done.load()) {
+                  fraction += job.concurrentImport.GetFraction();
+                  ++iter;
+                  continue;
+               }
+               job.thread.join();
+               // Close the file on this thread
+               job.handle.reset();
+               ++nDone;
+               fraction += 1;
+               iter = running.erase(iter);
+            }
+
+            if (request == ProgressResult::Success) {
+               request = progress.Update( fraction, (double) todo.size() );
+               if (request != ProgressResult::Success)
+                  // Stop keeps what the files in progress have so far
+                  for (auto pJob : running)
+                     pJob->concurrentImport.Request( request );
+            }
+            wxTheApp->ProcessPendingEvents();
+            wxMilliSleep(10);
+         }
+      }
+
+      for (auto &pJob : jobs) {
+         auto &job = *pJob;
+         if (job.exception) {
+            if (!exception)
+               exception = job.exception;
+            continue;
+         }
+         if (job.result != ProgressResult::Success &&
+             job.result != ProgressResult::Stopped)
+            continue;
+
+         auto end = job.tracks.end();
+         auto iter = std::remove_if( job.tracks.begin(), end,
+            std::mem_fn( &NewChannelGroup::empty ) );
+         if ( iter != end ) {
+            // importer shouldn't give us empty groups of channels!
+            wxASSERT(false);
+            // But correct that and proceed anyway
+            job.tracks.erase( iter, end );
+         }
+         if (job.tracks.empty()) {
+            wxLogError(wxT("ProjectFileManager::ImportFiles: %s gave no tracks"),
+               job.fileName);
+            continue;
+         }
+
+         // Merge the tags, as successive imports into the same Tags would
+         auto newTags = Tags::Get( project ).Duplicate();
+         for (const auto &pair : job.tags->GetRange())
+            newTags->SetTag( pair.first, pair.second );
+         Tags::Set( project, newTags );
+
+         FileHistory::Global().AddFileToHistory(job.fileName);
+
+         // PRL: Undo history is incremented inside this:
+         AddImportedTracks(job.fileName, std::move(job.tracks));
+         dirManager.FillBlockfilesCache();
+      }
+      jobs.clear();
+   };
+
+   for (const auto &fileName : fileNames) {
+      if (fileName.AfterLast('.').IsSameAs(wxT("lof"), false)) {
+         // A list of files imports others at once; keep the order
+         finishJobs();
+         Import(fileName);
+         continue;
+      }
+
+      // Open the file and choose streams on this thread; files that can't
+      // be imported concurrently are imported now
+      auto pJob = std::make_unique<Job>( setupMutex, fileName );
+      pJob->tags = std::make_shared<Tags>();
+      pJob->tags->Clear();
+      TranslatableString errorMessage;
+      bool success = Importer::Get().Import(project, fileName,
+                                            &trackFactory,
+                                            pJob->tracks,
+                                            pJob->tags.get(),
+                                            errorMessage,
+                                            &pJob->handle);
+      if (!errorMessage.empty()) {
+         // Error message derived from Importer::Import
+         // Additional help via a Help button links to the manual.
+         ShowErrorDialog(&GetProjectFrame( project ), XO("Error Importing"),
+                         errorMessage, wxT("Importing_Audio"));
+      }
+      if (success)
+         jobs.push_back( std::move( pJob ) );
+
+      // Don't hold too many files open at once
+      if (jobs.size() >= MaxOpenImports)
+         finishJobs();
+   }
+   finishJobs();
+
+   if (exception)
+      std::rethrow_exception( exception );
+}
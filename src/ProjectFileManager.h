@@ -21,6 +21,7 @@ Paul Licameli split from AudacityProject.h
 class wxString;
 class wxFileName;
 class AudacityProject;
+class ClipXMLCache;
 class ImportXMLTagHandler;
 class RecordingRecoveryHandler;
 class Track;
@@ -99,6 +100,12 @@ public:
    // If pNewTrackList is passed in non-NULL, it gets filled with the pointers to NEW tracks.
    bool Import(const FilePath &fileName, WaveTrackArray *pTrackArray = NULL);
 
+   // Import each of the files as Import() would, in the given order.  If
+   // /AudioFiles/ImportInParallel is set, the files whose importers allow it
+   // are decoded on several threads at once, but their tracks are still
+   // added in order.
+   void ImportFiles(const wxArrayString &fileNames);
+
    // Takes array of unique pointers; returns array of shared
    std::vector< std::shared_ptr<Track> >
    AddImportedTracks(const FilePath &fileName,
@@ -124,6 +131,9 @@ private:
    AudacityProject &mProject;
 
    std::shared_ptr<TrackList> mLastSavedTracks;
+
+   // Text of the clips of mLastSavedTracks, for writing unchanged clips again
+   std::unique_ptr<ClipXMLCache> mClipXMLCache;
    
    // The handler that handles recovery of <recordingrecovery> tags
    std::unique_ptr<RecordingRecoveryHandler> mRecordingRecoveryHandler;
@@ -33,6 +33,8 @@ Paul Licameli split from AudacityProject.cpp
 #include "ProjectStatus.h"
 #include "ProjectWindow.h"
 #include "SelectUtilities.h"
+#include "SequenceCompactor.h"
+#include "SummaryPrefetcher.h"
 #include "TrackPanel.h"
 #include "TrackUtilities.h"
 #include "UndoManager.h"
@@ -334,14 +336,22 @@ public:
             ProjectWindow::Get( *mProject ).HandleResize(); // Adjust scrollers for NEW track sizes.
          } );
 
+         // Import runs of audio files together, so that they may be decoded
+         // at once
+         auto &projectFileManager = ProjectFileManager::Get( *mProject );
+         FilePaths audioNames;
          for (const auto &name : sortednames) {
 #ifdef USE_MIDI
-            if (FileNames::IsMidi(name))
+            if (FileNames::IsMidi(name)) {
+               projectFileManager.ImportFiles(audioNames);
+               audioNames.clear();
                DoImportMIDI( *mProject, name );
+            }
             else
 #endif
-               ProjectFileManager::Get( *mProject ).Import(name);
+               audioNames.push_back(name);
          }
+         projectFileManager.ImportFiles(audioNames);
 
          auto &window = ProjectWindow::Get( *mProject );
          window.ZoomAfterImport(nullptr);
@@ -698,6 +708,10 @@ void ProjectManager::OnCloseWindow(wxCloseEvent & event)
    // Stop the timer since there's no need to update anything anymore
    mTimer.reset();
 
+   // The compactor's worker thread holds blocks and the DirManager
+   SequenceCompactor::Get( project ).Stop();
+   SummaryPrefetcher::Get( project ).Stop();
+
    // The project is now either saved or the user doesn't want to save it,
    // so there's no need to keep auto save info around anymore
    projectFileIO.DeleteCurrentAutoSaveFile();
@@ -996,6 +1010,9 @@ void ProjectManager::OnTimer(wxTimerEvent& WXUNUSED(event))
       }
    }
 
+   SequenceCompactor::Get( project ).Process();
+   SummaryPrefetcher::Get( project ).Process();
+
    // As also with the TrackPanel timer:  wxTimer may be unreliable without
    // some restarts
    RestartTimer();
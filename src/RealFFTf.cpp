@@ -41,17 +41,27 @@
 
 #include "Experimental.h"
 
+#include <atomic>
 #include <vector>
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
 
-#include <wx/thread.h>
-
 #ifdef EXPERIMENTAL_EQ_SSE_THREADED
 #include "RealFFTf48x.h"
 #endif
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_FFT
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_FFT
+#include <arm_neon.h>
+#endif
+
 #ifndef M_PI
 #define	M_PI		3.14159265358979323846  /* pi */
 #endif
@@ -101,82 +111,72 @@ HFFT InitializeFFT(size_t fftlen)
    return h;
 }
 
-enum : size_t { MAX_HFFT = 10 };
+namespace {
 
-// Maintain a pool:
-static std::vector< std::unique_ptr<FFTParam> > hFFTArray(MAX_HFFT);
-wxCriticalSection getFFTMutex;
+// The tables of each power of two length, made on first demand and then
+// never changed, so that lookups need no lock.  They are kept for the life
+// of the program, so that handles in static objects stay valid at exit.
+enum : size_t { MAX_HFFT = 32 };
+std::atomic<FFTParam*> hFFTArray[MAX_HFFT];
+
+// The index for the tables of fftlen in hFFTArray, or MAX_HFFT if they are
+// not kept there
+size_t TableIndex(size_t fftlen)
+{
+   if (fftlen < 2 || (fftlen & (fftlen - 1)) != 0)
+      return MAX_HFFT;
+   size_t index = 0;
+   while ((size_t(1) << index) < fftlen)
+      ++index;
+   return index;
+}
+
+}
 
 /* Get a handle to the FFT tables of the desired length */
 /* This version keeps common tables rather than allocating a NEW table every time */
 HFFT GetFFT(size_t fftlen)
 {
-   // To do:  smarter policy about when to retain in the pool and when to
-   // allocate a unique instance.
-
-   wxCriticalSectionLocker locker{ getFFTMutex };
-   
-   size_t h = 0;
-   auto n = fftlen/2;
-   auto size = hFFTArray.size();
-   for(;
-       (h < size) && hFFTArray[h] && (n != hFFTArray[h]->Points);
-       h++)
-      ;
-   if(h < size) {
-      if(hFFTArray[h] == NULL) {
-         hFFTArray[h].reset( InitializeFFT(fftlen).release() );
-      }
-      return HFFT{ hFFTArray[h].get() };
-   } else {
-      // All buffers used, so fall back to allocating a NEW set of tables
+   const auto index = TableIndex(fftlen);
+   if (index >= MAX_HFFT)
       return InitializeFFT(fftlen);
-   }
+
+   auto &entry = hFFTArray[index];
+   if (auto p = entry.load(std::memory_order_acquire))
+      return HFFT{ p };
+
+   // Threads racing to make the same tables agree on the first to finish
+   auto made = InitializeFFT(fftlen);
+   FFTParam *expected = nullptr;
+   if (entry.compare_exchange_strong(expected, made.get(),
+          std::memory_order_acq_rel, std::memory_order_acquire))
+      return HFFT{ made.release() };
+   return HFFT{ expected };
 }
 
 /* Release a previously requested handle to the FFT tables */
 void FFTDeleter::operator() (FFTParam *hFFT) const
 {
-   wxCriticalSectionLocker locker{ getFFTMutex };
-
-   auto it = hFFTArray.begin(), end = hFFTArray.end();
-   while (it != end && it->get() != hFFT)
-      ++it;
-   if ( it != end )
+   const auto index = TableIndex(2 * hFFT->Points);
+   if (index < MAX_HFFT &&
+       hFFTArray[index].load(std::memory_order_acquire) == hFFT)
       ;
    else
       delete hFFT;
 }
 
-/*
-*  Forward FFT routine.  Must call GetFFT(fftlen) first!
-*
-*  Note: Output is BIT-REVERSED! so you must use the BitReversed to
-*        get legible output, (i.e. Real_i = buffer[ h->BitReversed[i] ]
-*                                  Imag_i = buffer[ h->BitReversed[i]+1 ] )
-*        Input is in normal order.
-*
-* Output buffer[0] is the DC bin, and output buffer[1] is the Fs/2 bin
-* - this can be done because both values will always be real only
-* - this allows us to not have to allocate an extra complex value for the Fs/2 bin
-*
-*  Note: The scaling on this is done according to the standard FFT definition,
-*        so a unit amplitude DC signal will output an amplitude of (N)
-*        (Older revisions would progressively scale the input, so the output
-*        values would be similar in amplitude to the input values, which is
-*        good when using fixed point arithmetic)
-*/
-void RealFFTf(fft_type *buffer, const FFTParam *h)
+namespace {
+
+// The passes of butterflies of RealFFTf, beginning with groups of
+// ButterfliesPerGroup
+void ForwardButterflies(
+   fft_type *buffer, const FFTParam *h, size_t ButterfliesPerGroup)
 {
    fft_type *A,*B;
    const fft_type *sptr;
    const fft_type *endptr1,*endptr2;
-   const int *br1,*br2;
-   fft_type HRplus,HRminus,HIplus,HIminus;
    fft_type v1,v2,sin,cos;
 
-   auto ButterfliesPerGroup = h->Points/2;
-
    /*
    *  Butterfly:
    *     Ain-----Aout
@@ -198,6 +198,42 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
          sin = *sptr;
          cos = *(sptr+1);
          endptr2 = B;
+         // Two butterflies at a time, with the same operations in the same
+         // order as below, so that results are identical.  Lanes hold
+         // (v1, -v2) of each, from B and B with real and imaginary swapped.
+#if defined(USE_SSE2_FFT)
+         if (ButterfliesPerGroup >= 2) {
+            const __m128 vcos = _mm_set1_ps(cos);
+            const __m128 vsin = _mm_set_ps(-sin, sin, -sin, sin);
+            const __m128 two = _mm_set1_ps(2);
+            for (; A < endptr2; A += 4, B += 4) {
+               const __m128 b = _mm_loadu_ps(B);
+               const __m128 swapped = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+               const __m128 w =
+                  _mm_add_ps(_mm_mul_ps(b, vcos), _mm_mul_ps(swapped, vsin));
+               const __m128 sum = _mm_add_ps(_mm_loadu_ps(A), w);
+               _mm_storeu_ps(B, sum);
+               _mm_storeu_ps(A, _mm_sub_ps(sum, _mm_mul_ps(two, w)));
+            }
+         }
+#elif defined(USE_NEON_FFT)
+         if (ButterfliesPerGroup >= 2) {
+            const float sins[4] = { sin, -sin, sin, -sin };
+            const float32x4_t vcos = vdupq_n_f32(cos);
+            const float32x4_t vsin = vld1q_f32(sins);
+            const float32x4_t two = vdupq_n_f32(2);
+            for (; A < endptr2; A += 4, B += 4) {
+               const float32x4_t b = vld1q_f32(B);
+               const float32x4_t swapped = vrev64q_f32(b);
+               // Not vmlaq, which may fuse and round differently
+               const float32x4_t w =
+                  vaddq_f32(vmulq_f32(b, vcos), vmulq_f32(swapped, vsin));
+               const float32x4_t sum = vaddq_f32(vld1q_f32(A), w);
+               vst1q_f32(B, sum);
+               vst1q_f32(A, vsubq_f32(sum, vmulq_f32(two, w)));
+            }
+         }
+#endif
          while(A < endptr2)
          {
             v1 = *B * cos + *(B + 1) * sin;
@@ -213,7 +249,16 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
       }
       ButterfliesPerGroup >>= 1;
    }
-   /* Massage output to get the output for a real input sequence. */
+}
+
+/* Massage output to get the output for a real input sequence. */
+void ForwardRealMassage(fft_type *buffer, const FFTParam *h)
+{
+   fft_type *A,*B;
+   const int *br1,*br2;
+   fft_type HRplus,HRminus,HIplus,HIminus;
+   fft_type v1,v2,sin,cos;
+
    br1 = h->BitReversed.get() + 1;
    br2 = h->BitReversed.get() + h->Points - 1;
 
@@ -248,6 +293,66 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
    buffer[1]=v1;
 }
 
+}
+
+/*
+*  Forward FFT routine.  Must call GetFFT(fftlen) first!
+*
+*  Note: Output is BIT-REVERSED! so you must use the BitReversed to
+*        get legible output, (i.e. Real_i = buffer[ h->BitReversed[i] ]
+*                                  Imag_i = buffer[ h->BitReversed[i]+1 ] )
+*        Input is in normal order.
+*
+* Output buffer[0] is the DC bin, and output buffer[1] is the Fs/2 bin
+* - this can be done because both values will always be real only
+* - this allows us to not have to allocate an extra complex value for the Fs/2 bin
+*
+*  Note: The scaling on this is done according to the standard FFT definition,
+*        so a unit amplitude DC signal will output an amplitude of (N)
+*        (Older revisions would progressively scale the input, so the output
+*        values would be similar in amplitude to the input values, which is
+*        good when using fixed point arithmetic)
+*/
+void RealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   ForwardButterflies(buffer, h, h->Points/2);
+   ForwardRealMassage(buffer, h);
+}
+
+// RealFFTf of window times input, into buffer, with the multiplication done
+// in the first pass of butterflies, which also does the copying
+static void WindowedRealFFTf(const fft_type *input, const fft_type *window,
+   fft_type *buffer, const FFTParam *h)
+{
+   const auto ButterfliesPerGroup = h->Points/2;
+   if (ButterfliesPerGroup == 0) {
+      for (size_t ii = 0; ii < 2 * h->Points; ++ii)
+         buffer[ii] = input[ii] * window[ii];
+   }
+   else {
+      // The first pass is a single group, as in ForwardButterflies
+      const fft_type sin = h->SinTable[0];
+      const fft_type cos = h->SinTable[1];
+      const auto half = h->Points;
+      fft_type *A = buffer, *B = buffer + half;
+      const fft_type *inA = input, *inB = input + half;
+      const fft_type *winA = window, *winB = window + half;
+      for (size_t ii = 0; ii < half; ii += 2) {
+         const fft_type a0 = inA[ii] * winA[ii];
+         const fft_type a1 = inA[ii + 1] * winA[ii + 1];
+         const fft_type b0 = inB[ii] * winB[ii];
+         const fft_type b1 = inB[ii + 1] * winB[ii + 1];
+         const fft_type v1 = b0 * cos + b1 * sin;
+         const fft_type v2 = b0 * sin - b1 * cos;
+         B[ii] = a0 + v1;
+         A[ii] = B[ii] - 2 * v1;
+         B[ii + 1] = a1 - v2;
+         A[ii + 1] = B[ii + 1] + 2 * v2;
+      }
+      ForwardButterflies(buffer, h, ButterfliesPerGroup >> 1);
+   }
+   ForwardRealMassage(buffer, h);
+}
 
 /* Description: This routine performs an inverse FFT to real data.
 *              This code is for floating point data.
@@ -335,6 +440,41 @@ void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
          sin = *(sptr++);
          cos = *(sptr++);
          endptr2 = B;
+         // As in RealFFTf; here lanes hold (v1, v2)
+#if defined(USE_SSE2_FFT)
+         if (ButterfliesPerGroup >= 2) {
+            const __m128 vcos = _mm_set1_ps(cos);
+            const __m128 vsin = _mm_set_ps(sin, -sin, sin, -sin);
+            const __m128 half = _mm_set1_ps(0.5f);
+            for (; A < endptr2; A += 4, B += 4) {
+               const __m128 b = _mm_loadu_ps(B);
+               const __m128 swapped = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+               const __m128 v =
+                  _mm_add_ps(_mm_mul_ps(b, vcos), _mm_mul_ps(swapped, vsin));
+               const __m128 sum =
+                  _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(A), v), half);
+               _mm_storeu_ps(B, sum);
+               _mm_storeu_ps(A, _mm_sub_ps(sum, v));
+            }
+         }
+#elif defined(USE_NEON_FFT)
+         if (ButterfliesPerGroup >= 2) {
+            const float sins[4] = { -sin, sin, -sin, sin };
+            const float32x4_t vcos = vdupq_n_f32(cos);
+            const float32x4_t vsin = vld1q_f32(sins);
+            const float32x4_t half = vdupq_n_f32(0.5f);
+            for (; A < endptr2; A += 4, B += 4) {
+               const float32x4_t b = vld1q_f32(B);
+               const float32x4_t swapped = vrev64q_f32(b);
+               const float32x4_t v =
+                  vaddq_f32(vmulq_f32(b, vcos), vmulq_f32(swapped, vsin));
+               const float32x4_t sum =
+                  vmulq_f32(vaddq_f32(vld1q_f32(A), v), half);
+               vst1q_f32(B, sum);
+               vst1q_f32(A, vsubq_f32(sum, v));
+            }
+         }
+#endif
          while(A < endptr2)
          {
             v1 = *B * cos - *(B + 1) * sin;
@@ -373,3 +513,35 @@ void ReorderToTime(const FFTParam *hFFT, const fft_type *buffer, fft_type *TimeO
       TimeOut[i*2+1]=buffer[hFFT->BitReversed[i]+1];
    }
 }
+
+void PowerSpectraf(const FFTParam *hFFT, const fft_type *input, size_t hop,
+   const fft_type *window, size_t frameCount, fft_type *buffer,
+   fft_type *powers)
+{
+   const auto points = hFFT->Points;
+   for (size_t frame = 0; frame < frameCount;
+        ++frame, input += hop, powers += points + 1) {
+      WindowedRealFFTf(input, window, buffer, hFFT);
+      // Reorder and square in one pass
+      for (size_t i = 1; i < points; i++) {
+         const auto re = buffer[hFFT->BitReversed[i]  ];
+         const auto im = buffer[hFFT->BitReversed[i]+1];
+         powers[i] = re * re + im * im;
+      }
+      // Handle the (real-only) DC and Fs/2 bins
+      powers[0] = buffer[0] * buffer[0];
+      powers[points] = buffer[1] * buffer[1];
+   }
+}
+
+void Spectraf(const FFTParam *hFFT, const fft_type *input, size_t hop,
+   const fft_type *window, size_t frameCount, fft_type *buffer,
+   fft_type *RealOut, fft_type *ImagOut)
+{
+   const auto points = hFFT->Points;
+   for (size_t frame = 0; frame < frameCount; ++frame, input += hop,
+        RealOut += points + 1, ImagOut += points + 1) {
+      WindowedRealFFTf(input, window, buffer, hFFT);
+      ReorderToFreq(hFFT, buffer, RealOut, ImagOut);
+   }
+}
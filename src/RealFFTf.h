@@ -32,5 +32,19 @@ void ReorderToTime(const FFTParam *hFFT, const fft_type *buffer, fft_type *TimeO
 void ReorderToFreq(const FFTParam *hFFT, const fft_type *buffer,
 		   fft_type *RealOut, fft_type *ImagOut);
 
+// Short-time transforms of frameCount frames of input, each starting hop
+// samples after the one before, and each multiplied by window first.
+// Frames, window and buffer, which is scratch, all hold 2 * hFFT->Points
+// samples.  The windowing and copying are done in the first pass of
+// butterflies, and the reordering with the squaring of power spectra.
+// Output has hFFT->Points + 1 bins per frame, DC through Fs/2, frame after
+// frame.
+void PowerSpectraf(const FFTParam *hFFT, const fft_type *input, size_t hop,
+   const fft_type *window, size_t frameCount, fft_type *buffer,
+   fft_type *powers);
+void Spectraf(const FFTParam *hFFT, const fft_type *input, size_t hop,
+   const fft_type *window, size_t frameCount, fft_type *buffer,
+   fft_type *RealOut, fft_type *ImagOut);
+
 #endif
 
@@ -0,0 +1,181 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeSafety.cpp
+
+*******************************************************************//**
+
+\class RealtimeSafety
+\brief Catches the audio callback allocating or locking, which can make
+it miss its deadline, so that such regressions show in debug builds.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "RealtimeSafety.h"
+
+#ifdef EXPERIMENTAL_REALTIME_SAFETY_CHECKS
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <wx/sstream.h>
+#include <wx/txtstrm.h>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+#include "Internat.h"
+
+namespace {
+
+enum Kind : unsigned { Allocation, Deallocation, Lock, NKinds };
+
+// Depth of Scopes and Exemptions held by this thread; plain ints, because
+// these are consulted by operator new itself
+thread_local int tScopes = 0;
+thread_local int tExemptions = 0;
+
+std::atomic<unsigned long long> sViolations[NKinds];
+
+const char *const sDescriptions[NKinds] = {
+   "heap allocation",
+   "heap deallocation",
+   "mutex lock",
+};
+
+inline void Check(Kind kind)
+{
+   if (tScopes == 0 || tExemptions > 0)
+      return;
+
+   // Report the first of each kind at once, where a debugger can catch it;
+   // exempt the reporting itself
+   if (sViolations[kind]++ == 0) {
+      ++tExemptions;
+      fprintf(stderr, "Real-time safety: %s in the audio callback\n",
+         sDescriptions[kind]);
+      --tExemptions;
+   }
+}
+
+}
+
+RealtimeSafety::Scope::Scope()
+{
+   ++tScopes;
+}
+
+RealtimeSafety::Scope::~Scope()
+{
+   --tScopes;
+}
+
+RealtimeSafety::Exemption::Exemption()
+{
+   ++tExemptions;
+}
+
+RealtimeSafety::Exemption::~Exemption()
+{
+   --tExemptions;
+}
+
+wxString RealtimeSafety::Report()
+{
+   wxStringOutputStream o;
+   wxTextOutputStream s(o, wxEOL_UNIX);
+
+   s << wxT("==============================\n");
+   s << XO("Real-time safety violations in the audio callback:\n");
+   s << XO("Heap allocations: %llu\n").Format( sViolations[Allocation].load() );
+   s << XO("Heap deallocations: %llu\n")
+      .Format( sViolations[Deallocation].load() );
+#if defined(__linux__)
+   s << XO("Mutex locks: %llu\n").Format( sViolations[Lock].load() );
+#endif
+
+   return o.GetString();
+}
+
+// Replacements of the global allocation functions, for the whole program
+
+void *operator new(std::size_t size)
+{
+   Check(Allocation);
+   if (auto p = std::malloc(size ? size : 1))
+      return p;
+   throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size)
+{
+   return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+   Check(Allocation);
+   return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+   return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept
+{
+   if (p)
+      Check(Deallocation);
+   std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+   ::operator delete(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+   ::operator delete(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+   ::operator delete(p);
+}
+
+#if defined(__linux__)
+
+// Interpose the locking of any mutex, std::mutex and wxMutex included, and
+// forward to the C library
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+   using Function = int (*)(pthread_mutex_t *);
+   // Not a function-local static, whose guard might itself lock
+   static std::atomic<Function> sReal{ nullptr };
+   auto real = sReal.load(std::memory_order_acquire);
+   if (!real) {
+      real = reinterpret_cast<Function>(
+         dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+      sReal.store(real, std::memory_order_release);
+   }
+   Check(Lock);
+   return real(mutex);
+}
+
+#endif
+
+#else
+
+wxString RealtimeSafety::Report()
+{
+   return {};
+}
+
+#endif
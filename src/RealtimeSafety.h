@@ -0,0 +1,63 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeSafety.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_REALTIME_SAFETY__
+#define __AUDACITY_REALTIME_SAFETY__
+
+#include "Audacity.h"
+#include "Experimental.h"
+
+#include <wx/string.h>
+
+#include "MemoryX.h"
+
+/// \brief A debugging aid, like the sanitizers for real-time code:  counts
+/// and reports heap allocations, and waits for mutexes, on a thread that
+/// has declared that it must do neither, as the audio callback does.
+///
+/// Does nothing unless EXPERIMENTAL_REALTIME_SAFETY_CHECKS is defined.
+/// Then the global operator new and delete are replaced, and on Linux,
+/// pthread_mutex_lock is interposed.  Allocation directly with malloc, as
+/// by C libraries, is not seen.
+class AUDACITY_DLL_API RealtimeSafety final
+{
+public:
+   /// Hold one for the duration of the real-time work of the thread
+   class Scope final
+   {
+   public:
+#ifdef EXPERIMENTAL_REALTIME_SAFETY_CHECKS
+      Scope();
+      ~Scope();
+#else
+      Scope() {}
+#endif
+      Scope( const Scope& ) PROHIBITED;
+      Scope &operator=( const Scope& ) PROHIBITED;
+   };
+
+   /// Hold one where a Scope is held, around a known and accepted
+   /// violation, so that it does not hide new ones
+   class Exemption final
+   {
+   public:
+#ifdef EXPERIMENTAL_REALTIME_SAFETY_CHECKS
+      Exemption();
+      ~Exemption();
+#else
+      Exemption() {}
+#endif
+      Exemption( const Exemption& ) PROHIBITED;
+      Exemption &operator=( const Exemption& ) PROHIBITED;
+   };
+
+   /// A readable summary for diagnostics; empty unless checks are compiled
+   static wxString Report();
+};
+
+#endif
@@ -0,0 +1,269 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeScheduling.cpp
+
+*******************************************************************//**
+
+\class RealtimeScheduling
+\brief Raises the threads that feed the audio callback to real-time
+priority, and reports whether the system allowed it, so that dropouts on
+loaded machines can be told apart from slow disks and effects.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "RealtimeScheduling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <wx/sstream.h>
+#include <wx/txtstrm.h>
+
+#if defined(__WXMSW__)
+#include <windows.h>
+#elif defined(__WXMAC__)
+#include <pthread.h>
+#include <sys/mman.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include "Internat.h"
+#include "Prefs.h"
+
+namespace {
+
+enum Status : int { NotRequested, Promoted, Refused };
+
+// Written by each thread for itself, read for the report
+std::atomic<int> sStatus[RealtimeScheduling::NThreads];
+std::atomic<long> sError[RealtimeScheduling::NThreads];
+std::atomic<size_t> sLockedBuffers{ 0 }, sTotalBuffers{ 0 };
+
+TranslatableString ThreadName(unsigned thread)
+{
+   switch (thread) {
+      case RealtimeScheduling::AudioThread:
+         return XO("Playback thread");
+      case RealtimeScheduling::CaptureThread:
+         return XO("Recording thread");
+      case RealtimeScheduling::MidiThread:
+      default:
+         return XO("MIDI thread");
+   }
+}
+
+#if defined(__WXMSW__)
+
+// Avrt.dll is loaded at run time, so that there is nothing more to link
+using AvSetMmThreadCharacteristicsProc = HANDLE (WINAPI *)(LPCWSTR, LPDWORD);
+using AvRevertMmThreadCharacteristicsProc = BOOL (WINAPI *)(HANDLE);
+
+struct Avrt {
+   Avrt()
+   {
+      const auto module = ::LoadLibraryW(L"avrt.dll");
+      if (module) {
+         set = reinterpret_cast<AvSetMmThreadCharacteristicsProc>(
+            ::GetProcAddress(module, "AvSetMmThreadCharacteristicsW"));
+         revert = reinterpret_cast<AvRevertMmThreadCharacteristicsProc>(
+            ::GetProcAddress(module, "AvRevertMmThreadCharacteristics"));
+      }
+   }
+   AvSetMmThreadCharacteristicsProc set{ nullptr };
+   AvRevertMmThreadCharacteristicsProc revert{ nullptr };
+};
+
+const Avrt &GetAvrt()
+{
+   static Avrt avrt;
+   return avrt;
+}
+
+#endif
+
+}
+
+bool RealtimeScheduling::IsEnabled()
+{
+   return gPrefs->ReadBool(wxT("/AudioIO/ProAudioMode"), false);
+}
+
+void RealtimeScheduling::RecordMemoryLocks(size_t locked, size_t total)
+{
+   sLockedBuffers.store( locked );
+   sTotalBuffers.store( total );
+}
+
+wxString RealtimeScheduling::Report()
+{
+   wxStringOutputStream o;
+   wxTextOutputStream s(o, wxEOL_UNIX);
+
+   s << wxT("==============================\n");
+   s << XO("Real-time scheduling:\n");
+   if (!IsEnabled())
+      s << XO("Not enabled\n");
+   for (unsigned thread = 0; thread < NThreads; ++thread) {
+      switch (sStatus[thread].load()) {
+         case Promoted:
+            s << XO("%s: real-time\n").Format( ThreadName(thread) );
+            break;
+         case Refused:
+            s << XO("%s: refused by the system (error %ld)\n")
+               .Format( ThreadName(thread), sError[thread].load() );
+            break;
+         case NotRequested:
+         default:
+            s << XO("%s: normal\n").Format( ThreadName(thread) );
+            break;
+      }
+   }
+   if (const auto total = sTotalBuffers.load())
+      s << XO("Buffers locked in memory: %lu of %lu\n")
+         .Format( (unsigned long)sLockedBuffers.load(),
+            (unsigned long)total );
+
+   return o.GetString();
+}
+
+RealtimeScheduling::ThreadPromoter::ThreadPromoter(
+   Thread thread, double period)
+: mThread{ thread }
+, mPeriod{ period }
+{
+}
+
+RealtimeScheduling::ThreadPromoter::~ThreadPromoter()
+{
+   if (mPromoted)
+      Demote();
+}
+
+void RealtimeScheduling::ThreadPromoter::Change(bool wanted)
+{
+   mWanted = wanted;
+   if (wanted) {
+      mPromoted = Promote();
+      sStatus[mThread].store( mPromoted ? Promoted : Refused );
+   }
+   else {
+      if (mPromoted)
+         Demote();
+      mPromoted = false;
+      sStatus[mThread].store( NotRequested );
+   }
+}
+
+bool RealtimeScheduling::ThreadPromoter::Promote()
+{
+#if defined(__WXMSW__)
+   const auto &avrt = GetAvrt();
+   if (!avrt.set) {
+      sError[mThread].store( (long)ERROR_PROC_NOT_FOUND );
+      return false;
+   }
+   DWORD taskIndex = 0;
+   mHandle = avrt.set(L"Pro Audio", &taskIndex);
+   if (!mHandle) {
+      sError[mThread].store( (long)::GetLastError() );
+      return false;
+   }
+   return true;
+#elif defined(__WXMAC__)
+   mach_timebase_info_data_t timebase;
+   mach_timebase_info(&timebase);
+   const double ticksPerSecond = 1e9 * timebase.denom / timebase.numer;
+
+   // A pass needs much less than its period; the scheduler demotes threads
+   // that often overrun what they asked for
+   thread_time_constraint_policy_data_t policy;
+   policy.period = mPeriod * ticksPerSecond;
+   policy.computation = std::min(mPeriod / 4, 0.05) * ticksPerSecond;
+   policy.constraint = mPeriod * ticksPerSecond;
+   policy.preemptible = true;
+   const auto result = thread_policy_set(
+      pthread_mach_thread_np(pthread_self()), THREAD_TIME_CONSTRAINT_POLICY,
+      reinterpret_cast<thread_policy_t>(&policy),
+      THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+   if (result != KERN_SUCCESS) {
+      sError[mThread].store( (long)result );
+      return false;
+   }
+   return true;
+#else
+   // Stay well below the priorities that audio servers and PortAudio's own
+   // callback threads take, so that what feeds the callback never
+   // preempts it
+   const auto minimum = sched_get_priority_min(SCHED_FIFO);
+   const auto maximum = sched_get_priority_max(SCHED_FIFO);
+   sched_param param{};
+   param.sched_priority = std::min(minimum + 10, maximum);
+   const auto result =
+      pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+   if (result != 0) {
+      sError[mThread].store( (long)result );
+      return false;
+   }
+   return true;
+#endif
+}
+
+void RealtimeScheduling::ThreadPromoter::Demote()
+{
+#if defined(__WXMSW__)
+   const auto &avrt = GetAvrt();
+   if (mHandle && avrt.revert)
+      avrt.revert(mHandle);
+   mHandle = nullptr;
+#elif defined(__WXMAC__)
+   thread_standard_policy_data_t policy{};
+   thread_policy_set(
+      pthread_mach_thread_np(pthread_self()), THREAD_STANDARD_POLICY,
+      reinterpret_cast<thread_policy_t>(&policy),
+      THREAD_STANDARD_POLICY_COUNT);
+#else
+   sched_param param{};
+   param.sched_priority = 0;
+   pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#endif
+}
+
+bool MemoryLock::Lock(const void *address, size_t bytes)
+{
+   Unlock();
+   if (!address || bytes == 0)
+      return false;
+#if defined(__WXMSW__)
+   // Windows limits locked pages to the working set minimum; this may fail
+   // for large buffers unless that was raised
+   const bool success = ::VirtualLock(const_cast<void*>(address), bytes) != 0;
+#else
+   const bool success = mlock(address, bytes) == 0;
+#endif
+   if (success) {
+      mAddress = address;
+      mBytes = bytes;
+   }
+   return success;
+}
+
+void MemoryLock::Unlock()
+{
+   if (!mAddress)
+      return;
+#if defined(__WXMSW__)
+   ::VirtualUnlock(const_cast<void*>(mAddress), mBytes);
+#else
+   munlock(mAddress, mBytes);
+#endif
+   mAddress = nullptr;
+   mBytes = 0;
+}
@@ -0,0 +1,95 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeScheduling.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_REALTIME_SCHEDULING__
+#define __AUDACITY_REALTIME_SCHEDULING__
+
+#include "Audacity.h"
+
+#include <cstddef>
+#include <wx/string.h>
+
+#include "MemoryX.h"
+
+/// \brief The opt-in "pro audio" mode:  real-time scheduling of the threads
+/// that feed the audio callback, and memory they use locked in RAM, where
+/// the operating system permits.
+///
+/// Uses SCHED_FIFO on Linux and other POSIX systems, the MMCSS "Pro Audio"
+/// task on Windows, and the time constraint policy on macOS.  Any of these
+/// may be refused, as for want of privileges or memory lock limits; what
+/// happened is remembered for Help > Diagnostics.
+class AUDACITY_DLL_API RealtimeScheduling final
+{
+public:
+   /// Threads whose scheduling is reported
+   enum Thread : unsigned { AudioThread, CaptureThread, MidiThread, NThreads };
+
+   /// Whether the preference is on; read it on the main thread
+   static bool IsEnabled();
+
+   /// Remember how many of the stream's buffers were locked
+   static void RecordMemoryLocks(size_t locked, size_t total);
+
+   /// A readable summary for diagnostics
+   static wxString Report();
+
+   /// Owned by one thread, which calls Update at the top of each pass, to
+   /// raise or restore its own priority
+   class ThreadPromoter final
+   {
+   public:
+      /// period is about how often the thread wakes, in seconds
+      ThreadPromoter(Thread thread, double period);
+      ThreadPromoter( const ThreadPromoter& ) PROHIBITED;
+      ThreadPromoter &operator=( const ThreadPromoter& ) PROHIBITED;
+      ~ThreadPromoter();
+
+      /// Cheap when wanted has not changed since the last call
+      void Update(bool wanted)
+      {
+         if (wanted != mWanted)
+            Change(wanted);
+      }
+
+   private:
+      void Change(bool wanted);
+      bool Promote();
+      void Demote();
+
+      const Thread mThread;
+      const double mPeriod;
+      bool mWanted{ false };
+      bool mPromoted{ false };
+      // The MMCSS task handle, on Windows
+      void *mHandle{ nullptr };
+   };
+};
+
+/// Keeps a region of memory resident, so that touching it never faults to
+/// disk; forgets the lock on destruction, which must precede freeing
+class AUDACITY_DLL_API MemoryLock final
+{
+public:
+   MemoryLock() = default;
+   MemoryLock( const MemoryLock& ) PROHIBITED;
+   MemoryLock &operator=( const MemoryLock& ) PROHIBITED;
+   ~MemoryLock() { Unlock(); }
+
+   /// Unlocks any previous region first; returns whether it succeeded
+   bool Lock(const void *address, size_t bytes);
+   void Unlock();
+
+   bool IsLocked() const { return mAddress != nullptr; }
+
+private:
+   const void *mAddress{ nullptr };
+   size_t mBytes{ 0 };
+};
+
+#endif
@@ -27,9 +27,14 @@
 #include "Internat.h"
 #include "../include/audacity/ComponentInterface.h"
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
 #include <soxr.h>
 
 Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+   : mMinFactor{ dMinFactor }
+   , mMaxFactor{ dMaxFactor }
 {
    this->SetMethod(useBestMethod);
    soxr_quality_spec_t q_spec;
@@ -50,6 +55,78 @@ Resample::~Resample()
 {
 }
 
+namespace {
+// Idle resamplers, kept for reuse by Resample::Acquire, because Mixers are
+// made for every play, scrub and export of a region.  Limited in number,
+// because each holds its filter state.
+struct ResamplePool
+{
+   static ResamplePool &Get()
+   {
+      static ResamplePool pool;
+      return pool;
+   }
+
+   enum : size_t { MaxIdle = 32 };
+
+   std::mutex mutex;
+   std::vector< std::unique_ptr<Resample> > idle;
+};
+}
+
+void ResamplePoolReturner::operator () (Resample *p) const
+{
+   std::unique_ptr<Resample> resample{ p };
+   if (!resample)
+      return;
+   auto &pool = ResamplePool::Get();
+   std::lock_guard<std::mutex> locker{ pool.mutex };
+   if (pool.idle.size() < ResamplePool::MaxIdle)
+      pool.idle.push_back(std::move(resample));
+}
+
+auto Resample::Acquire(
+   const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+   -> Pooled
+{
+   const auto method = useBestMethod
+      ? BestMethodSetting.ReadEnum()
+      : FastMethodSetting.ReadEnum();
+
+   std::unique_ptr<Resample> resample;
+   {
+      auto &pool = ResamplePool::Get();
+      std::lock_guard<std::mutex> locker{ pool.mutex };
+      auto &idle = pool.idle;
+      // Search from the most recently returned
+      auto iter = std::find_if(idle.rbegin(), idle.rend(),
+         [&](const std::unique_ptr<Resample> &p){
+            return p->mMethod == method &&
+               p->mMinFactor == dMinFactor && p->mMaxFactor == dMaxFactor;
+         });
+      if (iter != idle.rend()) {
+         resample = std::move(*iter);
+         idle.erase(std::next(iter).base());
+      }
+   }
+
+   if (resample)
+      resample->Reset();
+   else
+      resample =
+         std::make_unique<Resample>(useBestMethod, dMinFactor, dMaxFactor);
+   return Pooled{ resample.release() };
+}
+
+void Resample::Reset()
+{
+   // soxr_clear rebuilds the internal state from the saved configuration,
+   // so this is also safe after flushing (see bug 1887)
+   if (mUsed && mHandle)
+      soxr_clear(mHandle.get());
+   mUsed = false;
+}
+
 //////////
 static const std::initializer_list<EnumValueSymbol> methodNames{
    { wxT("LowQuality"), XO("Low Quality (Fastest)") },
@@ -93,6 +170,7 @@ std::pair<size_t, size_t>
                         size_t  outBufferLen)
 {
    size_t idone, odone;
+   mUsed = true;
    if (mbWantConstRateResampling)
    {
       soxr_process(mHandle.get(),
@@ -25,6 +25,14 @@ struct soxr_deleter {
 };
 using soxrHandle = std::unique_ptr<soxr, soxr_deleter>;
 
+class Resample;
+
+/// Deleter that gives a Resample back to the pool, for reuse by
+/// Resample::Acquire
+struct ResamplePoolReturner {
+   void operator () (Resample *p) const;
+};
+
 class Resample final
 {
  public:
@@ -41,6 +49,17 @@ class Resample final
    Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
    ~Resample();
 
+   using Pooled = std::unique_ptr<Resample, ResamplePoolReturner>;
+
+   /// Like the constructor, but may reuse an idle resampler with the same
+   /// method and factors, which is reset instead of recreated
+   static Pooled Acquire(
+      const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
+
+   /// Ready the resampler for a fresh signal, with the same method and
+   /// factors.  Cheap if nothing was processed since the last reset.
+   void Reset();
+
    static EnumSetting< int > FastMethodSetting;
    static EnumSetting< int > BestMethodSetting;
 
@@ -81,6 +100,8 @@ class Resample final
    int   mMethod; // resampler-specific enum for resampling method
    soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
    bool mbWantConstRateResampling;
+   double mMinFactor, mMaxFactor;
+   bool mUsed{ false }; // whether Process was called since creation or reset
 };
 
 #endif // __AUDACITY_RESAMPLE_H__
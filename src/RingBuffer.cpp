@@ -38,6 +38,11 @@ RingBuffer::~RingBuffer()
 {
 }
 
+bool RingBuffer::LockMemory()
+{
+   return mMemoryLock.Lock( mBuffer.ptr(), mBufferSize * SAMPLE_SIZE(mFormat) );
+}
+
 // Calculations of free and filled space, given snapshots taken of the start
 // and end values
 
@@ -51,6 +56,16 @@ size_t RingBuffer::Free( size_t start, size_t end )
    return std::max<size_t>(mBufferSize - Filled( start, end ), 4) - 4;
 }
 
+auto RingBuffer::MakeSpans( size_t pos, size_t samples ) -> Spans
+{
+   const auto size = SAMPLE_SIZE(mFormat);
+   const auto block = std::min( samples, mBufferSize - pos );
+   return {
+      { mBuffer.ptr() + pos * size, block },
+      { mBuffer.ptr(), samples - block }
+   };
+}
+
 //
 // For the writer only:
 // Only writer writes the end, so it can read it again relaxed
@@ -133,6 +148,25 @@ size_t RingBuffer::Clear(sampleFormat format, size_t samplesToClear)
    return cleared;
 }
 
+auto RingBuffer::GetWritableSpans(size_t samples) -> Spans
+{
+   // Acquire, as in Put(), so that the reader is done with this space
+   auto start = mStart.load( std::memory_order_acquire );
+   auto end = mEnd.load( std::memory_order_relaxed );
+   return MakeSpans( end, std::min( samples, Free( start, end ) ) );
+}
+
+void RingBuffer::Produce(size_t samples)
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   auto end = mEnd.load( std::memory_order_relaxed );
+   samples = std::min( samples, Free( start, end ) );
+
+   // Release, as in Put(), so the writes into the spans are visible to
+   // the reader before the new end is
+   mEnd.store( (end + samples) % mBufferSize, std::memory_order_release );
+}
+
 //
 // For the reader only:
 // Only reader writes the start, so it can read it again relaxed
@@ -194,3 +228,22 @@ size_t RingBuffer::Discard(size_t samplesToDiscard)
 
    return samplesToDiscard;
 }
+
+auto RingBuffer::GetReadableSpans(size_t samples) -> Spans
+{
+   // Must match the writer's release with acquire, as in Get()
+   auto end = mEnd.load( std::memory_order_acquire );
+   auto start = mStart.load( std::memory_order_relaxed );
+   return MakeSpans( start, std::min( samples, Filled( start, end ) ) );
+}
+
+void RingBuffer::Consume(size_t samples)
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   samples = std::min( samples, Filled( start, end ) );
+
+   // Communicate to writer that we are done reading the spans, with
+   // nonrelaxed ordering
+   mStart.store( (start + samples) % mBufferSize, std::memory_order_release );
+}
@@ -11,14 +11,27 @@
 #ifndef __AUDACITY_RING_BUFFER__
 #define __AUDACITY_RING_BUFFER__
 
+#include "RealtimeScheduling.h"
 #include "SampleFormat.h"
 #include <atomic>
+#include <utility>
 
 class RingBuffer {
  public:
    RingBuffer(sampleFormat format, size_t size);
    ~RingBuffer();
 
+   sampleFormat GetFormat() const { return mFormat; }
+
+   //! Keep the samples resident in RAM, for real-time threads; returns
+   //! whether it succeeded
+   bool LockMemory();
+
+   //! A contiguous region of the buffer, and its length in samples
+   using Span = std::pair< samplePtr, size_t >;
+   //! At most two regions; the second is nonempty only when the first wraps
+   using Spans = std::pair< Span, Span >;
+
    //
    // For the writer only:
    //
@@ -29,6 +42,11 @@ class RingBuffer {
               size_t padding = 0);
    size_t Clear(sampleFormat format, size_t samples);
 
+   // Zero-copy alternative to Put:  write directly into the returned
+   // regions, then Produce() no more than their total length
+   Spans GetWritableSpans(size_t samples);
+   void Produce(size_t samples);
+
    //
    // For the reader only:
    //
@@ -37,9 +55,15 @@ class RingBuffer {
    size_t Get(samplePtr buffer, sampleFormat format, size_t samples);
    size_t Discard(size_t samples);
 
+   // Zero-copy alternative to Get:  read directly from the returned
+   // regions, then Consume() no more than their total length
+   Spans GetReadableSpans(size_t samples);
+   void Consume(size_t samples);
+
  private:
    size_t Filled( size_t start, size_t end );
    size_t Free( size_t start, size_t end );
+   Spans MakeSpans( size_t pos, size_t samples );
 
    enum : size_t { CacheLine = 64 };
    /*
@@ -56,6 +80,7 @@ class RingBuffer {
 
    sampleFormat  mFormat;
    SampleBuffer  mBuffer;
+   MemoryLock    mMemoryLock;
 };
 
 #endif /*  __AUDACITY_RING_BUFFER__ */
@@ -37,6 +37,7 @@
 #include "SampleFormat.h"
 
 #include <wx/intl.h>
+#include <algorithm>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,9 +47,21 @@
 #include "Dither.h"
 #include "Internat.h"
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_SAMPLE_FUNCS
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_SAMPLE_FUNCS
+#include <arm_neon.h>
+#endif
+
 static DitherType gLowQualityDither = DitherType::none;
 static DitherType gHighQualityDither = DitherType::none;
-static Dither gDitherAlgorithm;
+// Each thread that copies samples has its own dither state
+static thread_local Dither gDitherAlgorithm;
 
 void InitDitherers()
 {
@@ -99,6 +112,136 @@ void ReverseSamples(samplePtr dst, sampleFormat format,
    }
 }
 
+void ScaleSamples(float *buffer, size_t len, double factor)
+{
+   size_t ii = 0;
+#if defined(USE_SSE2_SAMPLE_FUNCS)
+   const __m128d f = _mm_set1_pd(factor);
+   for (; ii + 4 <= len; ii += 4) {
+      const __m128 x = _mm_loadu_ps(buffer + ii);
+      const __m128 lo = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(x), f));
+      const __m128 hi =
+         _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), f));
+      _mm_storeu_ps(buffer + ii, _mm_movelh_ps(lo, hi));
+   }
+#elif defined(USE_NEON_SAMPLE_FUNCS)
+   const float64x2_t f = vdupq_n_f64(factor);
+   for (; ii + 4 <= len; ii += 4) {
+      const float32x4_t x = vld1q_f32(buffer + ii);
+      const float32x2_t lo =
+         vcvt_f32_f64(vmulq_f64(vcvt_f64_f32(vget_low_f32(x)), f));
+      vst1q_f32(buffer + ii, vcvt_high_f32_f64(lo,
+         vmulq_f64(vcvt_high_f64_f32(x), f)));
+   }
+#endif
+   for (; ii < len; ++ii)
+      buffer[ii] = buffer[ii] * factor;
+}
+
+void NegateSamples(float *buffer, size_t len)
+{
+   size_t ii = 0;
+#if defined(USE_SSE2_SAMPLE_FUNCS)
+   // Flip the sign bits, as scalar negation does
+   const __m128 sign = _mm_set1_ps(-0.0f);
+   for (; ii + 4 <= len; ii += 4)
+      _mm_storeu_ps(buffer + ii, _mm_xor_ps(_mm_loadu_ps(buffer + ii), sign));
+#elif defined(USE_NEON_SAMPLE_FUNCS)
+   for (; ii + 4 <= len; ii += 4)
+      vst1q_f32(buffer + ii, vnegq_f32(vld1q_f32(buffer + ii)));
+#endif
+   for (; ii < len; ++ii)
+      buffer[ii] = -buffer[ii];
+}
+
+void RampSamples(float *buffer, size_t len,
+                 sampleCount first, int step, sampleCount denominator)
+{
+   wxASSERT(step == 1 || step == -1);
+   const float den = denominator.as_float();
+   size_t ii = 0;
+#if defined(USE_SSE2_SAMPLE_FUNCS) || defined(USE_NEON_SAMPLE_FUNCS)
+   // Count the numerators in 32 bit integers, which convert to float as
+   // the wider counts do, if all of them fit
+   const auto last = first + sampleCount(step) * len;
+   const long long limit = 0x7fffffff;
+   if (std::min(first, last) >= -limit && std::max(first, last) <= limit) {
+      const auto n0 = static_cast<int>(first.as_long_long());
+#if defined(USE_SSE2_SAMPLE_FUNCS)
+      const __m128 d = _mm_set1_ps(den);
+      __m128i n = _mm_setr_epi32(n0, n0 + step, n0 + 2 * step, n0 + 3 * step);
+      const __m128i dn = _mm_set1_epi32(4 * step);
+      for (; ii + 4 <= len; ii += 4) {
+         const __m128 x = _mm_loadu_ps(buffer + ii);
+         _mm_storeu_ps(buffer + ii,
+            _mm_div_ps(_mm_mul_ps(x, _mm_cvtepi32_ps(n)), d));
+         n = _mm_add_epi32(n, dn);
+      }
+#else
+      const float32x4_t d = vdupq_n_f32(den);
+      const int lanes[4] = { n0, n0 + step, n0 + 2 * step, n0 + 3 * step };
+      int32x4_t n = vld1q_s32(lanes);
+      const int32x4_t dn = vdupq_n_s32(4 * step);
+      for (; ii + 4 <= len; ii += 4) {
+         const float32x4_t x = vld1q_f32(buffer + ii);
+         vst1q_f32(buffer + ii,
+            vdivq_f32(vmulq_f32(x, vcvtq_f32_s32(n)), d));
+         n = vaddq_s32(n, dn);
+      }
+#endif
+   }
+#endif
+   for (; ii < len; ++ii)
+      buffer[ii] =
+         (buffer[ii] * (first + sampleCount(step) * ii).as_float()) / den;
+}
+
+void AverageSamples(const float *left, const float *right, float *dst,
+                    size_t len)
+{
+   size_t ii = 0;
+   // Halving is exact, so multiplying the float sum by one half rounds as
+   // dividing it by 2.0 in double precision does
+#if defined(USE_SSE2_SAMPLE_FUNCS)
+   const __m128 half = _mm_set1_ps(0.5f);
+   for (; ii + 4 <= len; ii += 4)
+      _mm_storeu_ps(dst + ii, _mm_mul_ps(
+         _mm_add_ps(_mm_loadu_ps(left + ii), _mm_loadu_ps(right + ii)), half));
+#elif defined(USE_NEON_SAMPLE_FUNCS)
+   const float32x4_t half = vdupq_n_f32(0.5f);
+   for (; ii + 4 <= len; ii += 4)
+      vst1q_f32(dst + ii, vmulq_f32(
+         vaddq_f32(vld1q_f32(left + ii), vld1q_f32(right + ii)), half));
+#endif
+   for (; ii < len; ++ii)
+      dst[ii] = (left[ii] + right[ii]) / 2.0;
+}
+
+float PeakOfSamples(const float *buffer, size_t len)
+{
+   size_t ii = 0;
+   float peak = 0.0f;
+#if defined(USE_SSE2_SAMPLE_FUNCS)
+   // Clear the sign bits for the absolute values
+   const __m128 sign = _mm_set1_ps(-0.0f);
+   __m128 peaks = _mm_setzero_ps();
+   for (; ii + 4 <= len; ii += 4)
+      peaks = _mm_max_ps(peaks,
+         _mm_andnot_ps(sign, _mm_loadu_ps(buffer + ii)));
+   float lanes[4];
+   _mm_storeu_ps(lanes, peaks);
+   peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(USE_NEON_SAMPLE_FUNCS)
+   float32x4_t peaks = vdupq_n_f32(0.0f);
+   for (; ii + 4 <= len; ii += 4)
+      peaks = vmaxq_f32(peaks, vabsq_f32(vld1q_f32(buffer + ii)));
+   peak = vmaxvq_f32(peaks);
+#endif
+   for (; ii < len; ++ii)
+      peak = std::max(peak, fabsf(buffer[ii]));
+   return peak;
+}
+
 void CopySamples(samplePtr src, sampleFormat srcFormat,
                  samplePtr dst, sampleFormat dstFormat,
                  unsigned int len,
@@ -121,3 +264,106 @@ void CopySamplesNoDither(samplePtr src, sampleFormat srcFormat,
       DitherType::none,
       src, srcFormat, dst, dstFormat, len, srcStride, dstStride);
 }
+
+void DeinterleaveSamples(samplePtr src, sampleFormat format,
+                         unsigned int srcChannels,
+                         const samplePtr *dst, unsigned int dstChannels,
+                         size_t len)
+{
+   unsigned int channel = 0;
+#if defined(USE_SSE2_SAMPLE_FUNCS) || defined(USE_NEON_SAMPLE_FUNCS)
+   if (format == floatSample) {
+      // Transpose blocks of four frames by four channels
+      const auto floats = reinterpret_cast<const float*>(src);
+      for (; channel + 4 <= dstChannels; channel += 4) {
+         const auto d0 = reinterpret_cast<float*>(dst[channel]);
+         const auto d1 = reinterpret_cast<float*>(dst[channel + 1]);
+         const auto d2 = reinterpret_cast<float*>(dst[channel + 2]);
+         const auto d3 = reinterpret_cast<float*>(dst[channel + 3]);
+         const float *in = floats + channel;
+         size_t ii = 0;
+         for (; ii + 4 <= len; ii += 4, in += 4 * srcChannels) {
+#if defined(USE_SSE2_SAMPLE_FUNCS)
+            __m128 r0 = _mm_loadu_ps(in);
+            __m128 r1 = _mm_loadu_ps(in + srcChannels);
+            __m128 r2 = _mm_loadu_ps(in + 2 * srcChannels);
+            __m128 r3 = _mm_loadu_ps(in + 3 * srcChannels);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(d0 + ii, r0);
+            _mm_storeu_ps(d1 + ii, r1);
+            _mm_storeu_ps(d2 + ii, r2);
+            _mm_storeu_ps(d3 + ii, r3);
+#else
+            const float32x4x2_t t01 =
+               vtrnq_f32(vld1q_f32(in), vld1q_f32(in + srcChannels));
+            const float32x4x2_t t23 = vtrnq_f32(
+               vld1q_f32(in + 2 * srcChannels), vld1q_f32(in + 3 * srcChannels));
+            vst1q_f32(d0 + ii, vcombine_f32(
+               vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+            vst1q_f32(d1 + ii, vcombine_f32(
+               vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+            vst1q_f32(d2 + ii, vcombine_f32(
+               vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+            vst1q_f32(d3 + ii, vcombine_f32(
+               vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+#endif
+         }
+         for (; ii < len; ++ii, in += srcChannels) {
+            d0[ii] = in[0];
+            d1[ii] = in[1];
+            d2[ii] = in[2];
+            d3[ii] = in[3];
+         }
+      }
+   }
+   else if (format == int16Sample && srcChannels == 2 && dstChannels == 2) {
+      // Most imported files are 16 bit stereo; split eight frames at a time
+      const auto in = reinterpret_cast<const short*>(src);
+      const auto left = reinterpret_cast<short*>(dst[0]);
+      const auto right = reinterpret_cast<short*>(dst[1]);
+      size_t ii = 0;
+      for (; ii + 8 <= len; ii += 8) {
+#if defined(USE_SSE2_SAMPLE_FUNCS)
+         // Each 32 bit lane holds one frame, left in the low half; shifting
+         // sign-extends either half, so that packing does not saturate
+         const __m128i f0 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * ii));
+         const __m128i f1 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * ii + 8));
+         const __m128i l = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_slli_epi32(f0, 16), 16),
+            _mm_srai_epi32(_mm_slli_epi32(f1, 16), 16));
+         const __m128i r = _mm_packs_epi32(
+            _mm_srai_epi32(f0, 16), _mm_srai_epi32(f1, 16));
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(left + ii), l);
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(right + ii), r);
+#else
+         const int16x8x2_t frames = vld2q_s16(in + 2 * ii);
+         vst1q_s16(left + ii, frames.val[0]);
+         vst1q_s16(right + ii, frames.val[1]);
+#endif
+      }
+      for (; ii < len; ++ii) {
+         left[ii] = in[2 * ii];
+         right[ii] = in[2 * ii + 1];
+      }
+      channel = dstChannels;
+   }
+#endif
+
+   // The rest one sample at a time; the formats differ only in size
+   for (; channel < dstChannels; ++channel) {
+      if (format == int16Sample) {
+         const short *in = reinterpret_cast<const short*>(src) + channel;
+         const auto out = reinterpret_cast<short*>(dst[channel]);
+         for (size_t ii = 0; ii < len; ++ii, in += srcChannels)
+            out[ii] = *in;
+      }
+      else {
+         const int *in = reinterpret_cast<const int*>(src) + channel;
+         const auto out = reinterpret_cast<int*>(dst[channel]);
+         for (size_t ii = 0; ii < len; ++ii, in += srcChannels)
+            out[ii] = *in;
+      }
+   }
+}
@@ -14,6 +14,7 @@
 #include "Audacity.h"
 
 #include "MemoryX.h"
+#include <functional>
 #include <wx/defs.h>
 
 #include "audacity/Types.h"
@@ -139,9 +140,44 @@ void      CopySamplesNoDither(samplePtr src, sampleFormat srcFormat,
 void      ClearSamples(samplePtr buffer, sampleFormat format,
                        size_t start, size_t len);
 
+// Separate the first dstChannels of the srcChannels interleaved in src,
+// each into its own buffer, all in the same format
+void      DeinterleaveSamples(samplePtr src, sampleFormat format,
+                              unsigned int srcChannels,
+                              const samplePtr *dst, unsigned int dstChannels,
+                              size_t len);
+
 void      ReverseSamples(samplePtr buffer, sampleFormat format,
                          int start, int len);
 
+//
+// Pointwise operations on float samples, in place
+//
+
+// Changes count float samples in place; pos is the position of the first,
+// relative to the start of the range being transformed.  Returns false to
+// stop.
+using SampleTransform =
+   std::function< bool( float *buffer, size_t count, sampleCount pos ) >;
+
+// Multiplies in double precision, then rounds to float
+void      ScaleSamples(float *buffer, size_t len, double factor);
+
+void      NegateSamples(float *buffer, size_t len);
+
+// Multiply sample i by (first + i * step) / denominator, computing in float
+// as buffer[i] * numerator / denominator; step is 1 or -1
+void      RampSamples(float *buffer, size_t len,
+                      sampleCount first, int step, sampleCount denominator);
+
+// dst[i] = (left[i] + right[i]) / 2, as for a mono downmix; dst may be the
+// same as left or right
+void      AverageSamples(const float *left, const float *right, float *dst,
+                         size_t len);
+
+// The greatest absolute value of the samples, or 0 if there are none
+float     PeakOfSamples(const float *buffer, size_t len);
+
 //
 // This must be called on startup and everytime NEW ditherers
 // are set in preferences.
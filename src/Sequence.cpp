@@ -32,6 +32,8 @@
 #include "Sequence.h"
 
 #include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <float.h>
 #include <math.h>
 
@@ -40,8 +42,12 @@
 #include <wx/ffile.h>
 #include <wx/log.h>
 
+#include "BlockSampleCache.h"
 #include "DirManager.h"
 
+#include "blockfile/CompressedBlockFile.h"
+#include "blockfile/PackedBlockFile.h"
+#include "blockfile/RangeBlockFile.h"
 #include "blockfile/SilentBlockFile.h"
 #include "blockfile/SimpleBlockFile.h"
 
@@ -49,8 +55,33 @@
 
 #include "widgets/AudacityMessageBox.h"
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_WAVE_DISPLAY
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_WAVE_DISPLAY
+#include <arm_neon.h>
+#endif
+
 size_t Sequence::sMaxDiskBlockSize = 1048576;
 
+namespace {
+   std::atomic<unsigned long long> sLengthGeneration{ 0 };
+
+   void NoteLengthChange()
+   {
+      sLengthGeneration.fetch_add(1, std::memory_order_relaxed);
+   }
+}
+
+unsigned long long Sequence::GetLengthGeneration()
+{
+   return sLengthGeneration.load(std::memory_order_relaxed);
+}
+
 // Sequence methods
 Sequence::Sequence(const std::shared_ptr<DirManager> &projDirManager, sampleFormat format)
    : mDirManager(projDirManager)
@@ -70,6 +101,7 @@ Sequence::Sequence(const Sequence &orig, const std::shared_ptr<DirManager> &proj
    , mMaxSamples(orig.mMaxSamples)
 {
    Paste(0, &orig);
+   mEditCount = orig.mEditCount;
 }
 
 Sequence::~Sequence()
@@ -86,6 +118,163 @@ size_t Sequence::GetIdealBlockSize() const
    return mMaxSamples;
 }
 
+namespace {
+   // Bounds of the disk block sizes that adaptive sizing chooses
+   const size_t MinAdaptiveDiskBlockSize = 64 * 1024;
+   const size_t MaxAdaptiveDiskBlockSize = 16 * 1024 * 1024;
+   // Played sequences get blocks this many times the default size, and
+   // densely edited ones, this many times smaller
+   const size_t AdaptiveRatio = 4;
+   // Never edited sequences are played or kept if at least this many
+   // blocks of the default size long
+   const size_t MinPlaybackBlocks = 64;
+   // Consolidate when at least this many blocks, and a quarter of all, are
+   // short
+   const size_t MinShortBlocks = 16;
+
+   // These are the same calculations as in the constructor
+   size_t MinSamplesFor(size_t maxDiskBlockSize, sampleFormat format)
+   {
+      return maxDiskBlockSize / SAMPLE_SIZE(format) / 2;
+   }
+}
+
+size_t Sequence::GetAdaptiveDiskBlockSize() const
+{
+   const auto current = mMaxSamples * SAMPLE_SIZE(mSampleFormat);
+   // Alias blocks cannot be split or merged without copying the audio they
+   // refer to
+   if (std::any_of( mBlock.begin(), mBlock.end(),
+         []( const SeqBlock &block ){ return block.f->IsAlias(); } ))
+      return current;
+
+   const auto base = sMaxDiskBlockSize;
+   const auto baseSamples = 2 * MinSamplesFor(base, mSampleFormat);
+   const auto idealBlocks =
+      mNumSamples.as_long_long() / std::max<size_t>(1, baseSamples);
+
+   if (mEditCount == 0) {
+      if (idealBlocks >= (long long) MinPlaybackBlocks)
+         return std::max(base,
+            std::min(base * AdaptiveRatio, MaxAdaptiveDiskBlockSize));
+   }
+   else if ((long long) mEditCount >= idealBlocks)
+      // An edit or more for each block
+      return std::min(base,
+         std::max(base / AdaptiveRatio, MinAdaptiveDiskBlockSize));
+
+   return base;
+}
+
+bool Sequence::NeedsReblock() const
+{
+   if (mBlock.empty())
+      return false;
+
+   if (GetAdaptiveDiskBlockSize() != mMaxSamples * SAMPLE_SIZE(mSampleFormat))
+      return true;
+
+   const size_t nShort = std::count_if( mBlock.begin(), mBlock.end(),
+      [this]( const SeqBlock &block ){
+         return !block.f->IsAlias() && block.f->GetLength() < mMinSamples; } );
+   return nShort >= MinShortBlocks && 4 * nShort >= mBlock.size();
+}
+
+void Sequence::Reblock(size_t maxDiskBlockSize)
+// STRONG-GUARANTEE
+{
+   auto consolidated =
+      Consolidate(*mDirManager, mSampleFormat, mBlock, maxDiskBlockSize);
+   CommitConsolidated(mBlock, std::move(consolidated), maxDiskBlockSize);
+}
+
+BlockArray Sequence::Consolidate(DirManager &dirManager, sampleFormat format,
+   const BlockArray &blocks, size_t maxDiskBlockSize)
+{
+   const auto minSamples = MinSamplesFor(maxDiskBlockSize, format);
+   const auto maxSamples = 2 * minSamples;
+
+   size_t maxLen = 0;
+   for (const auto &block : blocks)
+      maxLen = std::max(maxLen, block.f->GetLength());
+
+   BlockArray result;
+   result.reserve(blocks.size());
+
+   // A run of samples gathered from blocks of bad length, and from those
+   // after them, until long enough for blocks of good length
+   SampleBuffer buffer;
+   size_t filled = 0;
+   sampleCount runStart = 0;
+   const auto flush = [&]{
+      Blockify(dirManager, maxSamples, format,
+               result, runStart, buffer.ptr(), filled);
+      filled = 0;
+   };
+
+   for (const auto &block : blocks) {
+      const auto len = block.f->GetLength();
+      if (block.f->IsAlias() ||
+          (filled == 0 && len >= minSamples && len <= maxSamples)) {
+         if (filled > 0)
+            flush();
+         result.push_back(block);
+         continue;
+      }
+
+      if (!buffer.ptr())
+         // filled is less than minSamples before each block is added
+         buffer.Allocate(minSamples + maxLen, format);
+      if (filled == 0)
+         runStart = block.start;
+      Read(buffer.ptr() + filled * SAMPLE_SIZE(format), format,
+           block, 0, len, true);
+      filled += len;
+      if (filled >= minSamples)
+         flush();
+   }
+   if (filled > 0)
+      flush();
+
+   return result;
+}
+
+bool Sequence::HasBlocks(const BlockArray &blocks) const
+{
+   return blocks.size() == mBlock.size() &&
+      std::equal( blocks.begin(), blocks.end(), mBlock.begin(),
+         []( const SeqBlock &a, const SeqBlock &b ){
+            return a.f == b.f && a.start == b.start; } );
+}
+
+bool Sequence::CommitConsolidated(const BlockArray &original,
+   BlockArray &&consolidated, size_t maxDiskBlockSize)
+// STRONG-GUARANTEE
+{
+   if (!HasBlocks(original))
+      // Edited meanwhile
+      return false;
+
+   DeleteUpdateMutexLocker locker(*this);
+
+   const auto oldMinSamples = mMinSamples, oldMaxSamples = mMaxSamples;
+   mMinSamples = MinSamplesFor(maxDiskBlockSize, mSampleFormat);
+   mMaxSamples = mMinSamples * 2;
+
+   bool bSuccess = false;
+   auto cleanup = finally( [&] {
+      if (!bSuccess) {
+         mMaxSamples = oldMaxSamples;
+         mMinSamples = oldMinSamples;
+      }
+   } );
+
+   CommitChangesIfConsistent
+      (consolidated, mNumSamples, wxT("Sequence::CommitConsolidated()"));
+   bSuccess = true;
+   return true;
+}
+
 bool Sequence::Lock()
 {
    for (unsigned int i = 0; i < mBlock.size(); i++)
@@ -110,6 +299,19 @@ bool Sequence::Unlock()
    return true;
 }
 
+bool Sequence::HasSameBlocks(const Sequence &other) const
+{
+   if (mDirManager != other.mDirManager ||
+       mSampleFormat != other.mSampleFormat ||
+       mNumSamples != other.mNumSamples ||
+       mBlock.size() != other.mBlock.size())
+      return false;
+
+   return std::equal( mBlock.begin(), mBlock.end(), other.mBlock.begin(),
+      [](const SeqBlock &a, const SeqBlock &b){
+         return a.f == b.f && a.start == b.start; } );
+}
+
 sampleFormat Sequence::GetSampleFormat() const
 {
    return mSampleFormat;
@@ -234,6 +436,81 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format)
    return true;
 }
 
+namespace {
+
+// Min and max of samples [start, start + len) of one block file.  The 256
+// sample summary frames lying wholly within the range answer for their
+// samples, so that only the samples at the ends of the range are read.
+std::pair<float, float> BlockMinMax(
+   BlockFile &file, size_t start, size_t len, bool mayThrow)
+{
+   const size_t first = (start + 255) / 256;
+   const size_t last = (start + len) / 256;
+   Floats summary;
+   if (last > first && file.IsSummaryAvailable())
+      summary.reinit( 3 * (last - first) );
+   if (!summary || !file.Read256(summary.get(), first, last - first)) {
+      auto results = file.GetMinMaxRMS(start, len, mayThrow);
+      return { results.min, results.max };
+   }
+
+   float min = FLT_MAX;
+   float max = -FLT_MAX;
+   for (size_t i = 0; i < last - first; ++i) {
+      min = std::min( min, summary[3 * i] );
+      max = std::max( max, summary[3 * i + 1] );
+   }
+
+   // Samples before the first whole frame and after the last
+   const auto merge = [&]( size_t s0, size_t l0 ) {
+      if (l0 == 0)
+         return;
+      auto results = file.GetMinMaxRMS(s0, l0, mayThrow);
+      min = std::min( min, results.min );
+      max = std::max( max, results.max );
+   };
+   merge( start, first * 256 - start );
+   merge( last * 256, start + len - last * 256 );
+
+   return { min, max };
+}
+
+// Sum of squares of samples [start, start + len) of one block file, found
+// as BlockMinMax finds the extremes
+double BlockSumSquares(
+   BlockFile &file, size_t start, size_t len, bool mayThrow)
+{
+   const size_t first = (start + 255) / 256;
+   const size_t last = (start + len) / 256;
+   Floats summary;
+   if (last > first && file.IsSummaryAvailable() && file.HasSummaryRMS())
+      summary.reinit( 3 * (last - first) );
+   if (!summary || !file.Read256(summary.get(), first, last - first)) {
+      const double rms = file.GetMinMaxRMS(start, len, mayThrow).RMS;
+      return rms * rms * len;
+   }
+
+   double sumsq = 0.0;
+   for (size_t i = 0; i < last - first; ++i) {
+      const double rms = summary[3 * i + 2];
+      sumsq += rms * rms * 256;
+   }
+
+   // Samples before the first whole frame and after the last
+   const auto merge = [&]( size_t s0, size_t l0 ) {
+      if (l0 == 0)
+         return;
+      const double rms = file.GetMinMaxRMS(s0, l0, mayThrow).RMS;
+      sumsq += rms * rms * l0;
+   };
+   merge( start, first * 256 - start );
+   merge( last * 256, start + len - last * 256 );
+
+   return sumsq;
+}
+
+}
+
 std::pair<float, float> Sequence::GetMinMax(
    sampleCount start, sampleCount len, bool mayThrow) const
 {
@@ -285,11 +562,11 @@ std::pair<float, float> Sequence::GetMinMax(
          wxASSERT(maxl0 <= mMaxSamples); // Vaughan, 2011-10-19
          const auto l0 = limitSampleBufferSize ( maxl0, len );
 
-         results = theFile->GetMinMaxRMS(s0, l0, mayThrow);
-         if (results.min < min)
-            min = results.min;
-         if (results.max > max)
-            max = results.max;
+         const auto partial = BlockMinMax(*theFile, s0, l0, mayThrow);
+         if (partial.first < min)
+            min = partial.first;
+         if (partial.second > max)
+            max = partial.second;
       }
    }
 
@@ -305,11 +582,11 @@ std::pair<float, float> Sequence::GetMinMax(
          const auto l0 = ( start + len - theBlock.start ).as_size_t();
          wxASSERT(l0 <= mMaxSamples); // Vaughan, 2011-10-19
 
-         results = theFile->GetMinMaxRMS(0, l0, mayThrow);
-         if (results.min < min)
-            min = results.min;
-         if (results.max > max)
-            max = results.max;
+         const auto partial = BlockMinMax(*theFile, 0, l0, mayThrow);
+         if (partial.first < min)
+            min = partial.first;
+         if (partial.second > max)
+            max = partial.second;
       }
    }
 
@@ -357,9 +634,7 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
       wxASSERT(maxl0 <= mMaxSamples); // Vaughan, 2011-10-19
       const auto l0 = limitSampleBufferSize( maxl0, len );
 
-      auto results = theFile->GetMinMaxRMS(s0, l0, mayThrow);
-      const auto partialRMS = results.RMS;
-      sumsq += partialRMS * partialRMS * l0;
+      sumsq += BlockSumSquares(*theFile, s0, l0, mayThrow);
       length += l0;
    }
 
@@ -371,9 +646,7 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
       const auto l0 = ( start + len - theBlock.start ).as_size_t();
       wxASSERT(l0 <= mMaxSamples); // PRL: I think Vaughan missed this
 
-      auto results = theFile->GetMinMaxRMS(0, l0, mayThrow);
-      const auto partialRMS = results.RMS;
-      sumsq += partialRMS * partialRMS * l0;
+      sumsq += BlockSumSquares(*theFile, 0, l0, mayThrow);
       length += l0;
    }
 
@@ -383,6 +656,21 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
    return sqrt(sumsq / length.as_double() );
 }
 
+namespace {
+   // Refer to samples [start, start + len) of the block without reading
+   // them, or return null if they should be copied instead
+   BlockFilePtr NewRangeBlockFile( const BlockFilePtr &f,
+                                   size_t start, size_t len,
+                                   size_t minSamples )
+   {
+      if (len < minSamples || !RangeBlockFile::GetRangeBlockFiles())
+         return {};
+      if (start == 0 && len == f->GetLength())
+         return f;
+      return RangeBlockFile::Make( f, start, len );
+   }
+}
+
 std::unique_ptr<Sequence> Sequence::Copy(sampleCount s0, sampleCount s1) const
 {
    auto dest = std::make_unique<Sequence>(mDirManager, mSampleFormat);
@@ -416,10 +704,18 @@ std::unique_ptr<Sequence> Sequence::Copy(sampleCount s0, sampleCount s1) const
       blocklen =
          ( std::min(s1, block0.start + file->GetLength()) - s0 ).as_size_t();
       wxASSERT(file->IsAlias() || (blocklen <= (int)mMaxSamples)); // Vaughan, 2012-02-29
-      ensureSampleBufferSize(buffer, mSampleFormat, bufferSize, blocklen);
-      Get(b0, buffer.ptr(), mSampleFormat, s0, blocklen, true);
+      if (auto range = NewRangeBlockFile( file,
+            ( s0 - block0.start ).as_size_t(), blocklen, mMinSamples )) {
+         // The copy shares this DirManager, which knows the source already
+         dest->mBlock.push_back(SeqBlock(range, dest->mNumSamples));
+         dest->mNumSamples += blocklen;
+      }
+      else {
+         ensureSampleBufferSize(buffer, mSampleFormat, bufferSize, blocklen);
+         Get(b0, buffer.ptr(), mSampleFormat, s0, blocklen, true);
 
-      dest->Append(buffer.ptr(), mSampleFormat, blocklen);
+         dest->Append(buffer.ptr(), mSampleFormat, blocklen);
+      }
    }
    else
       --b0;
@@ -437,9 +733,16 @@ std::unique_ptr<Sequence> Sequence::Copy(sampleCount s0, sampleCount s1) const
       blocklen = (s1 - block.start).as_size_t();
       wxASSERT(file->IsAlias() || (blocklen <= (int)mMaxSamples)); // Vaughan, 2012-02-29
       if (blocklen < (int)file->GetLength()) {
-         ensureSampleBufferSize(buffer, mSampleFormat, bufferSize, blocklen);
-         Get(b1, buffer.ptr(), mSampleFormat, block.start, blocklen, true);
-         dest->Append(buffer.ptr(), mSampleFormat, blocklen);
+         if (auto range =
+               NewRangeBlockFile( file, 0, blocklen, mMinSamples )) {
+            dest->mBlock.push_back(SeqBlock(range, dest->mNumSamples));
+            dest->mNumSamples += blocklen;
+         }
+         else {
+            ensureSampleBufferSize(buffer, mSampleFormat, bufferSize, blocklen);
+            Get(b1, buffer.ptr(), mSampleFormat, block.start, blocklen, true);
+            dest->Append(buffer.ptr(), mSampleFormat, blocklen);
+         }
       }
       else
          // Special case, copy exactly
@@ -463,10 +766,22 @@ namespace {
                                     sampleFormat format,
                                     bool allowDeferredWrite = false)
    {
-      return dm.NewBlockFile( [&]( wxFileNameWrapper filePath ) {
-         return make_blockfile<SimpleBlockFile>(
-            std::move(filePath), sampleData, sampleLen, format, allowDeferredWrite);
-      } );
+      auto factory = [&]() -> BlockFilePtr {
+         if (PackedBlockFile::GetPackBlockFiles())
+            return dm.NewPackedBlockFile( sampleData, sampleLen, format );
+         if (CompressedBlockFile::GetCompressBlockFiles())
+            return dm.NewBlockFile( [&]( wxFileNameWrapper filePath ) {
+               return make_blockfile<CompressedBlockFile>(
+                  std::move(filePath), sampleData, sampleLen, format);
+            } );
+         return dm.NewBlockFile( [&]( wxFileNameWrapper filePath ) {
+            return make_blockfile<SimpleBlockFile>(
+               std::move(filePath), sampleData, sampleLen, format, allowDeferredWrite);
+         } );
+      };
+      if (DirManager::GetShareIdenticalBlocks())
+         return dm.NewSharedBlockFile( sampleData, sampleLen, format, factory );
+      return factory();
    }
 }
 
@@ -511,6 +826,8 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    if (addedLen == 0 || srcNumBlocks == 0)
       return;
 
+   ++mEditCount;
+
    const size_t numBlocks = mBlock.size();
 
    if (numBlocks == 0 ||
@@ -519,8 +836,10 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
       // onto the end because the current last block is longer than the
       // minimum size
 
-      // Build and swap a copy so there is a strong exception safety guarantee
-      BlockArray newBlock{ mBlock };
+      // Build the added blocks aside, so there is a strong exception safety
+      // guarantee without a copy of the whole array
+      BlockArray newBlock;
+      newBlock.reserve(srcNumBlocks);
       sampleCount samples = mNumSamples;
       for (unsigned int i = 0; i < srcNumBlocks; i++)
          // AppendBlock may throw for limited disk space, if pasting from
@@ -528,8 +847,8 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
          AppendBlock(*mDirManager, newBlock, samples, srcBlock[i]);
          // Increase ref count or duplicate file
 
-      CommitChangesIfConsistent
-         (newBlock, samples, wxT("Paste branch one"));
+      AppendBlocksIfConsistent
+         (newBlock, false, samples, wxT("Paste branch one"));
       return;
    }
 
@@ -538,6 +857,35 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    SeqBlock *const pBlock = &mBlock[b];
    const auto length = pBlock->f->GetLength();
    const auto largerBlockLen = addedLen + length;
+
+   {
+      // Keep the samples of the block on either side of the insertion as
+      // ranges of it, if neither side is too short, and share the pasted
+      // blocks, so that no samples are copied
+      const SeqBlock &block = *pBlock;
+      // s lies within block:
+      const auto splitPoint = ( s - block.start ).as_size_t();
+      const auto preFile =
+         NewRangeBlockFile( block.f, 0, splitPoint, mMinSamples );
+      const auto postFile = NewRangeBlockFile( block.f,
+         splitPoint, length - splitPoint, mMinSamples );
+      if ((splitPoint == 0 || preFile) &&
+          (splitPoint == length || postFile)) {
+         BlockArray newBlock;
+         newBlock.reserve(srcNumBlocks + 2);
+         if (preFile)
+            newBlock.push_back(SeqBlock(preFile, block.start));
+         sampleCount samples = s;
+         for (unsigned int i = 0; i < srcNumBlocks; i++)
+            AppendBlock(*mDirManager, newBlock, samples, srcBlock[i]);
+         if (postFile)
+            newBlock.push_back(SeqBlock(postFile, samples));
+
+         SpliceIfConsistent
+            (b, b + 1, newBlock, mNumSamples + addedLen, wxT("Paste ranges"));
+         return;
+      }
+   }
    // PRL: when insertion point is the first sample of a block,
    // and the following test fails, perhaps we could test
    // whether coalescence with the previous block is possible.
@@ -575,10 +923,12 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
          mBlock[i].start += addedLen;
 
       mNumSamples += addedLen;
+      NoteLengthChange();
 
       // This consistency check won't throw, it asserts.
       // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Paste branch two"), false);
+      ConsistencyCheck(mBlock, mMaxSamples, b, b + 1, mNumSamples,
+         wxT("Paste branch two"), false);
       return;
    }
 
@@ -586,9 +936,9 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    // it's simplest to just lump all the data together
    // into one big block along with the split block,
    // then resplit it all
+   // Only the blocks replacing the split block are built here
    BlockArray newBlock;
-   newBlock.reserve(numBlocks + srcNumBlocks + 2);
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b);
+   newBlock.reserve(srcNumBlocks + 2);
 
    SeqBlock &splitBlock = mBlock[b];
    auto splitLen = splitBlock.f->GetLength();
@@ -658,13 +1008,222 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
                newBlock, s + lastStart, sampleBuffer.ptr(), rightLen);
    }
 
-   // Copy remaining blocks to NEW block array and
-   // swap the NEW block array in for the old
-   for (i = b + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(addedLen));
+   // Splice the NEW blocks in for the split block, moving later blocks
+   SpliceIfConsistent
+      (b, b + 1, newBlock, mNumSamples + addedLen, wxT("Paste branch three"));
+}
+
+void Sequence::Repeat(size_t count)
+// STRONG-GUARANTEE
+{
+   if (count == 0 || mBlock.empty())
+      return;
 
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples + addedLen, wxT("Paste branch three"));
+   if (Overflows(mNumSamples.as_double() * (count + 1)))
+   {
+      wxLogError(
+         wxT("Sequence::Repeat: mNumSamples %s * %s would overflow."),
+         Internat::ToString(mNumSamples.as_double(), 0),
+         Internat::ToString((double)(count + 1), 0));
+      THROW_INCONSISTENCY_EXCEPTION;
+   }
+
+   if (mBlock.back().f->GetLength() >= mMinSamples) {
+      // Every seam falls between blocks of adequate size, so only references
+      // to the existing block files need be appended
+      const auto numBlocks = mBlock.size();
+      BlockArray newBlock;
+      newBlock.reserve(numBlocks * count);
+      sampleCount samples = mNumSamples;
+      for (size_t ii = 0; ii < count; ++ii)
+         for (size_t b = 0; b < numBlocks; ++b)
+            AppendBlock(*mDirManager, newBlock, samples, mBlock[b]);
+
+      AppendBlocksIfConsistent
+         (newBlock, false, samples, wxT("Repeat"));
+      return;
+   }
+
+   // The short last block must be merged at each seam; Paste does that,
+   // still sharing the blocks away from the seams.  Work on a copy for the
+   // strong guarantee.
+   auto src = Copy(0, mNumSamples);
+   auto result = Copy(0, mNumSamples);
+   for (size_t ii = 0; ii < count; ++ii)
+      result->Paste(result->mNumSamples, src.get());
+
+   // use NOFAIL-GUARANTEE
+   mBlock.swap(result->mBlock);
+   mNumSamples = result->mNumSamples;
+   NoteLengthChange();
+}
+
+namespace {
+   void ReverseSamples(samplePtr buffer, sampleFormat format, size_t len)
+   {
+      if (format == int16Sample)
+         std::reverse((short*)buffer, (short*)buffer + len);
+      else
+         // int24Sample is stored in four bytes, like floatSample
+         std::reverse((int*)buffer, (int*)buffer + len);
+   }
+}
+
+void Sequence::Reverse(sampleCount start, sampleCount len)
+// STRONG-GUARANTEE
+{
+   if (len <= 0)
+      return;
+
+   if (start < 0 || start + len > mNumSamples)
+      THROW_INCONSISTENCY_EXCEPTION;
+
+   ++mEditCount;
+
+   const unsigned b0 = FindBlock(start);
+   const unsigned b1 = FindBlock(start + len - 1) + 1;
+   const auto sampleSize = SAMPLE_SIZE(mSampleFormat);
+
+   // Build the blocks replacing [b0, b1) aside, accumulating samples until
+   // they fill a block
+   BlockArray newBlock;
+   sampleCount pos = mBlock[b0].start;
+   SampleBuffer pending(mMaxSamples, mSampleFormat);
+   size_t filled = 0;
+   const auto flush = [&] {
+      if (filled > 0) {
+         newBlock.push_back(SeqBlock(
+            NewSimpleBlockFile(
+               *mDirManager, pending.ptr(), filled, mSampleFormat),
+            pos));
+         pos += filled;
+         filled = 0;
+      }
+   };
+
+   SampleBuffer buffer(mMaxSamples, mSampleFormat);
+   const auto add = [&](const SeqBlock &block, size_t from, size_t count,
+                        bool reversed) {
+      Read(buffer.ptr(), mSampleFormat, block, from, count, true);
+      if (reversed)
+         ReverseSamples(buffer.ptr(), mSampleFormat, count);
+      for (size_t done = 0; done < count;) {
+         const auto n = std::min(count - done, mMaxSamples - filled);
+         memcpy(pending.ptr() + filled * sampleSize,
+                buffer.ptr() + done * sampleSize, n * sampleSize);
+         filled += n, done += n;
+         if (filled == mMaxSamples)
+            flush();
+      }
+   };
+
+   // The part of the first block before the range
+   const auto leftLen = (start - mBlock[b0].start).as_size_t();
+   if (leftLen > 0)
+      add(mBlock[b0], 0, leftLen, false);
+
+   // The range, from its last block to its first
+   const auto end = start + len;
+   for (auto b = b1; b-- > b0;) {
+      const SeqBlock &block = mBlock[b];
+      const auto &f = block.f;
+      const auto blockLen = f->GetLength();
+      const auto from = (std::max(start, block.start) - block.start)
+         .as_size_t();
+      const auto to = (std::min(end, block.start + blockLen) - block.start)
+         .as_size_t();
+      if (from == 0 && to == blockLen && f->IsSummaryAvailable()) {
+         const auto results = f->GetMinMaxRMS();
+         if (results.min == results.max) {
+            flush();
+            AppendBlock(*mDirManager, newBlock, pos, block);
+            continue;
+         }
+      }
+      add(block, from, to - from, true);
+   }
+
+   // The part of the last block after the range
+   const SeqBlock &last = mBlock[b1 - 1];
+   const auto rightStart = (end - last.start).as_size_t();
+   const auto rightLen = last.f->GetLength() - rightStart;
+   if (rightLen > 0)
+      add(last, rightStart, rightLen, false);
+
+   flush();
+
+   SpliceIfConsistent(b0, b1, newBlock, mNumSamples, wxT("Reverse"));
+}
+
+bool Sequence::TransformSamples(sampleCount start, sampleCount len,
+                                const SampleTransform &transform)
+// STRONG-GUARANTEE
+{
+   if (len <= 0)
+      return true;
+
+   if (start < 0 || start + len > mNumSamples)
+      THROW_INCONSISTENCY_EXCEPTION;
+
+   const unsigned b0 = FindBlock(start);
+   const unsigned b1 = FindBlock(start + len - 1) + 1;
+   const auto end = start + len;
+   const bool isFloat = (mSampleFormat == floatSample);
+
+   size_t bufferSize = mMaxSamples;
+   SampleBuffer buffer(bufferSize, mSampleFormat);
+   Floats floats;
+   if (!isFloat)
+      floats.reinit(bufferSize);
+
+   BlockArray newBlock;
+   for (auto b = b0; b < b1; ++b) {
+      const SeqBlock &block = mBlock[b];
+      const auto blockLen = block.f->GetLength();
+      const auto from = (std::max(start, block.start) - block.start)
+         .as_size_t();
+      const auto to = (std::min(end, block.start + blockLen) - block.start)
+         .as_size_t();
+      const auto count = to - from;
+
+      if (blockLen > bufferSize) {
+         // tolerate an inconsistently long block, as SetSamples does
+         bufferSize = blockLen;
+         buffer.Allocate(bufferSize, mSampleFormat);
+         if (!isFloat)
+            floats.reinit(bufferSize);
+      }
+
+      // Only the transformed samples are converted, so that the rest of
+      // the block keeps its exact values
+      float *data;
+      if (isFloat) {
+         Read(buffer.ptr(), mSampleFormat, block, 0, blockLen, true);
+         data = reinterpret_cast<float*>(buffer.ptr()) + from;
+      }
+      else {
+         if (count < blockLen)
+            Read(buffer.ptr(), mSampleFormat, block, 0, blockLen, true);
+         data = floats.get();
+         Read((samplePtr)data, floatSample, block, from, count, true);
+      }
+
+      if (!transform(data, count, block.start + from - start))
+         return false;
+
+      if (!isFloat)
+         CopySamples((samplePtr)data, floatSample,
+            buffer.ptr() + from * SAMPLE_SIZE(mSampleFormat), mSampleFormat,
+            count);
+
+      newBlock.push_back(SeqBlock(
+         NewSimpleBlockFile(*mDirManager, buffer.ptr(), blockLen, mSampleFormat),
+         block.start));
+   }
+
+   ++mEditCount;
+   SpliceIfConsistent(b0, b1, newBlock, mNumSamples, wxT("TransformSamples"));
+   return true;
 }
 
 void Sequence::SetSilence(sampleCount s0, sampleCount len)
@@ -737,6 +1296,7 @@ void Sequence::AppendBlock
 
    mBlock.push_back(newBlock);
    mNumSamples += newBlock.f->GetLength();
+   NoteLengthChange();
 
    // Don't do a consistency check here because this
    // function gets called in an inner loop.
@@ -748,6 +1308,11 @@ sampleCount Sequence::GetBlockStart(sampleCount position) const
    return mBlock[b].start;
 }
 
+const SeqBlock &Sequence::GetBlockAt(sampleCount position) const
+{
+   return mBlock[FindBlock(position)];
+}
+
 size_t Sequence::GetBestBlockSize(sampleCount start) const
 {
    // This method returns a nice number of samples you should try to grab in
@@ -869,6 +1434,8 @@ bool Sequence::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
 
             // nValue is now safe for size_t
             mMaxSamples = nValue;
+            // Sequences may have block sizes of their own
+            mMinSamples = mMaxSamples / 2;
 
             // PRL:  Is the following really okay?  DirManager might be shared across projects!
             // PRL:  Yes, because it only affects DirManager's behavior in opening the project.
@@ -894,6 +1461,16 @@ bool Sequence::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
                return false;
             }
             mNumSamples = nValue;
+            NoteLengthChange();
+         }
+         else if (!wxStrcmp(attr, wxT("edits")))
+         {
+            if (!XMLValueChecker::IsGoodInt64(strValue) || !strValue.ToLongLong(&nValue) || (nValue < 0))
+            {
+               mErrorOpening = true;
+               return false;
+            }
+            mEditCount = nValue;
          }
       } // while
 
@@ -978,6 +1555,7 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
          Internat::ToString(mNumSamples.as_double(), 0),
          Internat::ToString(numSamples.as_double(), 0));
       mNumSamples = numSamples;
+      NoteLengthChange();
       mErrorOpening = true;
    }
 }
@@ -1003,6 +1581,9 @@ void Sequence::WriteXML(XMLWriter &xmlFile) const
    xmlFile.WriteAttr(wxT("maxsamples"), mMaxSamples);
    xmlFile.WriteAttr(wxT("sampleformat"), (size_t)mSampleFormat);
    xmlFile.WriteAttr(wxT("numsamples"), mNumSamples.as_long_long() );
+   // For adaptive block sizing; older versions ignore it
+   if (mEditCount > 0)
+      xmlFile.WriteAttr(wxT("edits"), mEditCount);
 
    for (b = 0; b < mBlock.size(); b++) {
       const SeqBlock &bb = mBlock[b];
@@ -1099,7 +1680,8 @@ bool Sequence::Read(samplePtr buffer, sampleFormat format,
    wxASSERT(blockRelativeStart + len <= f->GetLength());
 
    // Either throws, or of !mayThrow, tells how many were really read
-   auto result = f->ReadData(buffer, format, blockRelativeStart, len, mayThrow);
+   auto result = BlockSampleCache::Get().Read(
+      *f, buffer, format, blockRelativeStart, len, mayThrow);
 
    if (result != len)
    {
@@ -1161,6 +1743,8 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
    if (start < 0 || start + len > mNumSamples)
       THROW_INCONSISTENCY_EXCEPTION;
 
+   ++mEditCount;
+
    size_t tempSize = mMaxSamples;
    // to do:  allocate this only on demand
    SampleBuffer scratch(tempSize, mSampleFormat);
@@ -1171,8 +1755,9 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
    }
 
    int b = FindBlock(start);
+   const int b0 = b;
+   // Only the blocks that change are built here
    BlockArray newBlock;
-   std::copy( mBlock.begin(), mBlock.begin() + b, std::back_inserter(newBlock) );
 
    while (len > 0
       // Redundant termination condition,
@@ -1255,50 +1840,128 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
       b++;
    }
 
-   std::copy( mBlock.begin() + b, mBlock.end(), std::back_inserter(newBlock) );
-
-   CommitChangesIfConsistent( newBlock, mNumSamples, wxT("SetSamples") );
+   SpliceIfConsistent( b0, b, newBlock, mNumSamples, wxT("SetSamples") );
 }
 
 namespace {
 
+#if defined(USE_SSE2_WAVE_DISPLAY)
+using Vec = __m128;
+inline Vec Load(const float *p) { return _mm_loadu_ps(p); }
+inline Vec Splat(float x) { return _mm_set1_ps(x); }
+inline Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+inline Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+inline Vec MulAdd(Vec acc, Vec a) { return _mm_add_ps(acc, _mm_mul_ps(a, a)); }
+inline void Store(float *p, Vec a) { _mm_storeu_ps(p, a); }
+#elif defined(USE_NEON_WAVE_DISPLAY)
+using Vec = float32x4_t;
+inline Vec Load(const float *p) { return vld1q_f32(p); }
+inline Vec Splat(float x) { return vdupq_n_f32(x); }
+inline Vec Min(Vec a, Vec b) { return vminq_f32(a, b); }
+inline Vec Max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+inline Vec MulAdd(Vec acc, Vec a) { return vmlaq_f32(acc, a, a); }
+inline void Store(float *p, Vec a) { vst1q_f32(p, a); }
+#endif
+
 struct MinMaxSumsq
 {
    MinMaxSumsq(const float *pv, int count, int divisor)
    {
       min = FLT_MAX, max = -FLT_MAX, sumsq = 0.0f;
-      while (count--) {
-         float v;
-         switch (divisor) {
-         default:
-         case 1:
-            // array holds samples
-            v = *pv++;
-            if (v < min)
-               min = v;
-            if (v > max)
-               max = v;
-            sumsq += v * v;
-            break;
-         case 256:
-         case 65536:
-            // array holds triples of min, max, and rms values
-            v = *pv++;
-            if (v < min)
-               min = v;
-            v = *pv++;
-            if (v > max)
-               max = v;
-            v = *pv++;
-            sumsq += v * v;
-            break;
-         }
+      if (count <= 0)
+         return;
+      switch (divisor) {
+      default:
+      case 1:
+         // array holds samples
+         Samples(pv, count);
+         break;
+      case 256:
+      case 4096:
+      case 65536:
+         // array holds triples of min, max, and rms values
+         Triples(pv, count);
+         break;
       }
    }
 
    float min;
    float max;
    float sumsq;
+
+private:
+   void Samples(const float *pv, size_t count)
+   {
+#if defined(USE_SSE2_WAVE_DISPLAY) || defined(USE_NEON_WAVE_DISPLAY)
+      // Four samples at a time, reducing the lanes at the end
+      if (count >= 4) {
+         Vec vMin = Splat(FLT_MAX), vMax = Splat(-FLT_MAX), vSumsq = Splat(0);
+         for (; count >= 4; count -= 4, pv += 4) {
+            const Vec v = Load(pv);
+            vMin = Min(v, vMin);
+            vMax = Max(v, vMax);
+            vSumsq = MulAdd(vSumsq, v);
+         }
+         float lanes[3][4];
+         Store(lanes[0], vMin), Store(lanes[1], vMax), Store(lanes[2], vSumsq);
+         for (int lane = 0; lane < 4; ++lane) {
+            min = std::min(min, lanes[0][lane]);
+            max = std::max(max, lanes[1][lane]);
+            sumsq += lanes[2][lane];
+         }
+      }
+#endif
+      for (; count--; ++pv) {
+         const float v = *pv;
+         min = std::min(min, v);
+         max = std::max(max, v);
+         sumsq += v * v;
+      }
+   }
+
+   void Triples(const float *pv, size_t count)
+   {
+#if defined(USE_SSE2_WAVE_DISPLAY) || defined(USE_NEON_WAVE_DISPLAY)
+      // Four triples are three vectors; accumulate min, max and squares in
+      // every lane, then take from each lane only the one that applies to
+      // the member of the triple it held
+      if (count >= 4) {
+         Vec vMin[3], vMax[3], vSumsq[3];
+         for (int ii = 0; ii < 3; ++ii)
+            vMin[ii] = Splat(FLT_MAX), vMax[ii] = Splat(-FLT_MAX),
+            vSumsq[ii] = Splat(0);
+         for (; count >= 4; count -= 4, pv += 12) {
+            for (int ii = 0; ii < 3; ++ii) {
+               const Vec v = Load(pv + 4 * ii);
+               vMin[ii] = Min(v, vMin[ii]);
+               vMax[ii] = Max(v, vMax[ii]);
+               vSumsq[ii] = MulAdd(vSumsq[ii], v);
+            }
+         }
+         for (int ii = 0; ii < 3; ++ii) {
+            float lanes[3][4];
+            Store(lanes[0], vMin[ii]);
+            Store(lanes[1], vMax[ii]);
+            Store(lanes[2], vSumsq[ii]);
+            for (int lane = 0; lane < 4; ++lane) {
+               switch ((4 * ii + lane) % 3) {
+               case 0:
+                  min = std::min(min, lanes[0][lane]); break;
+               case 1:
+                  max = std::max(max, lanes[1][lane]); break;
+               default:
+                  sumsq += lanes[2][lane]; break;
+               }
+            }
+         }
+      }
+#endif
+      for (; count--; pv += 3) {
+         min = std::min(min, pv[0]);
+         max = std::max(max, pv[1]);
+         sumsq += pv[2] * pv[2];
+      }
+   }
 };
 
 }
@@ -1377,6 +2040,7 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
          (whereNext - whereNow).as_double() / (nextPixel - pixel);
       const int divisor =
            (samplesPerPixel >= 65536) ? 65536
+         : (samplesPerPixel >= 4096) ? 4096
          : (samplesPerPixel >= 256) ? 256
          : 1;
 
@@ -1423,6 +2087,17 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
             //otherwise, mark the display as not yet computed
             blockStatus = -1 - b;
          break;
+      case 4096:
+         // Read triples
+         //check to see if summary data has been computed
+         if (seqBlock.f->IsSummaryAvailable())
+            // Ignore the return value.
+            // This function fills with zeroes if read fails
+            seqBlock.f->Read4K(temp.get(), startPosition, num);
+         else
+            //otherwise, mark the display as not yet computed
+            blockStatus = -1 - b;
+         break;
       case 65536:
          // Read triples
          //check to see if summary data has been computed
@@ -1544,7 +2219,9 @@ void Sequence::Append(samplePtr buffer, sampleFormat format,
    SeqBlock *pLastBlock;
    decltype(pLastBlock->f->GetLength()) length;
    size_t bufferSize = mMaxSamples;
-   SampleBuffer buffer2(bufferSize, mSampleFormat);
+   // Allocated only when needed:  recording appends small buffers often,
+   // mostly in the sequence format and to a full last block
+   SampleBuffer buffer2;
    bool replaceLast = false;
    if (numBlocks > 0 &&
        (length =
@@ -1553,6 +2230,7 @@ void Sequence::Append(samplePtr buffer, sampleFormat format,
       const SeqBlock &lastBlock = *pLastBlock;
       const auto addLen = std::min(mMaxSamples - length, len);
 
+      buffer2.Allocate(bufferSize, mSampleFormat);
       Read(buffer2.ptr(), mSampleFormat, lastBlock, 0, length, true);
 
       CopySamples(buffer,
@@ -1573,8 +2251,7 @@ void Sequence::Append(samplePtr buffer, sampleFormat format,
 
       if (blockFileLog)
          // shouldn't throw, because XMLWriter is not XMLFileWriter
-         static_cast< SimpleBlockFile * >( &*newLastBlock.f )
-            ->SaveXML( *blockFileLog );
+         newLastBlock.f->SaveXML( *blockFileLog );
 
       newBlock.push_back( newLastBlock );
 
@@ -1594,6 +2271,8 @@ void Sequence::Append(samplePtr buffer, sampleFormat format,
             buffer, addedLen, mSampleFormat, blockFileLog != NULL);
       }
       else {
+         if (!buffer2.ptr())
+            buffer2.Allocate(bufferSize, mSampleFormat);
          CopySamples(buffer, format, buffer2.ptr(), mSampleFormat, addedLen);
          pFile = NewSimpleBlockFile( *mDirManager,
             buffer2.ptr(), addedLen, mSampleFormat, blockFileLog != NULL);
@@ -1601,7 +2280,7 @@ void Sequence::Append(samplePtr buffer, sampleFormat format,
 
       if (blockFileLog)
          // shouldn't throw, because XMLWriter is not XMLFileWriter
-         static_cast< SimpleBlockFile * >( &*pFile )->SaveXML( *blockFileLog );
+         pFile->SaveXML( *blockFileLog );
 
       newBlock.push_back(SeqBlock(pFile, newNumSamples));
 
@@ -1653,6 +2332,8 @@ void Sequence::Delete(sampleCount start, sampleCount len)
    if (len < 0 || start < 0 || start + len > mNumSamples)
       THROW_INCONSISTENCY_EXCEPTION;
 
+   ++mEditCount;
+
    //TODO: add a ref-deref mechanism to SeqBlock/BlockArray so we don't have to make this a critical section.
    //On-demand threads iterate over the mBlocks and the GUI thread deletes them, so for now put a mutex here over
    //both functions,
@@ -1689,6 +2370,22 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       // because start + len - 1 is also in the block...
       auto newLen = ( length - limitSampleBufferSize( length, len ) );
 
+      // Keep the samples on either side of the deletion as ranges of the
+      // block, if neither side is too short, rather than copy them
+      const auto preFile = NewRangeBlockFile( b.f, 0, pos, mMinSamples );
+      const auto postFile = NewRangeBlockFile( b.f,
+         length - (newLen - pos), newLen - pos, mMinSamples );
+      if ((pos == 0 || preFile) && (pos == newLen || postFile)) {
+         BlockArray newBlock;
+         if (preFile)
+            newBlock.push_back(SeqBlock(preFile, b.start));
+         if (postFile)
+            newBlock.push_back(SeqBlock(postFile, start));
+         SpliceIfConsistent
+            (b0, b0 + 1, newBlock, mNumSamples - len, wxT("Delete ranges"));
+         return;
+      }
+
       scratch.Allocate(scratchSize, mSampleFormat);
       ensureSampleBufferSize(scratch, mSampleFormat, scratchSize, newLen);
 
@@ -1713,21 +2410,19 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          mBlock[j].start -= len;
 
       mNumSamples -= len;
+      NoteLengthChange();
 
       // This consistency check won't throw, it asserts.
       // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Delete - branch one"), false);
+      ConsistencyCheck(mBlock, mMaxSamples, b0, b0 + 1, mNumSamples,
+         wxT("Delete - branch one"), false);
       return;
    }
 
-   // Create a NEW array of blocks
+   // Create a NEW array of the blocks replacing those from first through b1
    BlockArray newBlock;
-   newBlock.reserve(numBlocks - (b1 - b0) + 2);
-
-   // Copy the blocks before the deletion point over to
-   // the NEW array
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b0);
-   unsigned int i;
+   newBlock.reserve(4);
+   auto first = b0;
 
    // First grab the samples in block b0 before the deletion point
    // into preBuffer.  If this is enough samples for its own block,
@@ -1739,12 +2434,16 @@ void Sequence::Delete(sampleCount start, sampleCount len)
    auto preBufferLen = ( start - preBlock.start ).as_size_t();
    if (preBufferLen) {
       if (preBufferLen >= mMinSamples || b0 == 0) {
-         if (!scratch.ptr())
-            scratch.Allocate(scratchSize, mSampleFormat);
-         ensureSampleBufferSize(scratch, mSampleFormat, scratchSize, preBufferLen);
-         Read(scratch.ptr(), mSampleFormat, preBlock, 0, preBufferLen, true);
          auto pFile =
-            NewSimpleBlockFile( *mDirManager, scratch.ptr(), preBufferLen, mSampleFormat );
+            NewRangeBlockFile( preBlock.f, 0, preBufferLen, mMinSamples );
+         if (!pFile) {
+            if (!scratch.ptr())
+               scratch.Allocate(scratchSize, mSampleFormat);
+            ensureSampleBufferSize(scratch, mSampleFormat, scratchSize, preBufferLen);
+            Read(scratch.ptr(), mSampleFormat, preBlock, 0, preBufferLen, true);
+            pFile =
+               NewSimpleBlockFile( *mDirManager, scratch.ptr(), preBufferLen, mSampleFormat );
+         }
 
          newBlock.push_back(SeqBlock(pFile, preBlock.start));
       } else {
@@ -1761,7 +2460,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          Read(scratch.ptr() + prepreLen*sampleSize, mSampleFormat,
               preBlock, 0, preBufferLen, true);
 
-         newBlock.pop_back();
+         first = b0 - 1;
          Blockify(*mDirManager, mMaxSamples, mSampleFormat,
                   newBlock, prepreBlock.start, scratch.ptr(), sum);
       }
@@ -1783,14 +2482,18 @@ void Sequence::Delete(sampleCount start, sampleCount len)
    ).as_size_t();
    if (postBufferLen) {
       if (postBufferLen >= mMinSamples || b1 == numBlocks - 1) {
-         if (!scratch.ptr())
-            // Last use of scratch, can ask for smaller
-            scratch.Allocate(postBufferLen, mSampleFormat);
          // start + len - 1 lies within postBlock
          auto pos = (start + len - postBlock.start).as_size_t();
-         Read(scratch.ptr(), mSampleFormat, postBlock, pos, postBufferLen, true);
          auto file =
-            NewSimpleBlockFile( *mDirManager, scratch.ptr(), postBufferLen, mSampleFormat );
+            NewRangeBlockFile( postBlock.f, pos, postBufferLen, mMinSamples );
+         if (!file) {
+            if (!scratch.ptr())
+               // Last use of scratch, can ask for smaller
+               scratch.Allocate(postBufferLen, mSampleFormat);
+            Read(scratch.ptr(), mSampleFormat, postBlock, pos, postBufferLen, true);
+            file =
+               NewSimpleBlockFile( *mDirManager, scratch.ptr(), postBufferLen, mSampleFormat );
+         }
 
          newBlock.push_back(SeqBlock(file, start));
       } else {
@@ -1817,12 +2520,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       // right on the end of a block.
    }
 
-   // Copy the remaining blocks over from the old array
-   for (i = b1 + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(-len));
-
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples - len, wxT("Delete - branch two"));
+   // Splice the NEW blocks in, moving the remaining blocks back
+   SpliceIfConsistent
+      (first, b1 + 1, newBlock, mNumSamples - len, wxT("Delete - branch two"));
 }
 
 void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
@@ -1832,6 +2532,15 @@ void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
 
 void Sequence::ConsistencyCheck
    (const BlockArray &mBlock, size_t maxSamples, size_t from,
+    sampleCount mNumSamples, const wxChar *whereStr,
+    bool mayThrow)
+{
+   ConsistencyCheck(mBlock, maxSamples, from, mBlock.size(), mNumSamples,
+      whereStr, mayThrow);
+}
+
+void Sequence::ConsistencyCheck
+   (const BlockArray &mBlock, size_t maxSamples, size_t from, size_t to,
     sampleCount mNumSamples, const wxChar *whereStr,
     bool WXUNUSED(mayThrow))
 {
@@ -1841,13 +2550,21 @@ void Sequence::ConsistencyCheck
    InconsistencyException ex;
 
    unsigned int numBlocks = mBlock.size();
+   to = std::min<size_t>(to, numBlocks);
 
    unsigned int i;
    sampleCount pos = from < numBlocks ? mBlock[from].start : mNumSamples;
    if ( from == 0 && pos != 0 )
       ex = CONSTRUCT_INCONSISTENCY_EXCEPTION, bError = true;
+   else if ( from > 0 && from <= numBlocks ) {
+      // The blocks must follow the one before them without a gap
+      const SeqBlock &prevBlock = mBlock[from - 1];
+      if ( !prevBlock.f ||
+           pos != prevBlock.start + prevBlock.f->GetLength() )
+         ex = CONSTRUCT_INCONSISTENCY_EXCEPTION, bError = true;
+   }
 
-   for (i = from; !bError && i < numBlocks; i++) {
+   for (i = from; !bError && i < to; i++) {
       const SeqBlock &seqBlock = mBlock[i];
       if (pos != seqBlock.start)
          ex = CONSTRUCT_INCONSISTENCY_EXCEPTION, bError = true;
@@ -1861,7 +2578,7 @@ void Sequence::ConsistencyCheck
       else
          ex = CONSTRUCT_INCONSISTENCY_EXCEPTION, bError = true;
    }
-   if ( !bError && pos != mNumSamples )
+   if ( !bError && pos != (to < numBlocks ? mBlock[to].start : mNumSamples) )
       ex = CONSTRUCT_INCONSISTENCY_EXCEPTION, bError = true;
 
    if ( bError )
@@ -1892,6 +2609,7 @@ void Sequence::CommitChangesIfConsistent
 
    mBlock.swap(newBlock);
    mNumSamples = numSamples;
+   NoteLengthChange();
 }
 
 void Sequence::AppendBlocksIfConsistent
@@ -1934,6 +2652,62 @@ void Sequence::AppendBlocksIfConsistent
    // use NOFAIL-GUARANTEE
 
    mNumSamples = numSamples;
+   NoteLengthChange();
+   consistent = true;
+}
+
+void Sequence::SpliceIfConsistent
+   (size_t b0, size_t b1, BlockArray &replacement,
+    sampleCount numSamples, const wxChar *whereStr)
+{
+   const auto oldSize = mBlock.size();
+   if (b0 > b1 || b1 > oldSize)
+      THROW_INCONSISTENCY_EXCEPTION;
+
+   const auto count = replacement.size();
+   const sampleCount delta = numSamples - mNumSamples;
+
+   // Allocate first, so that the rest, which only moves blocks, can't throw
+   BlockArray removed;
+   removed.reserve( b1 - b0 );
+   mBlock.reserve( std::max( oldSize, oldSize - (b1 - b0) + count ) );
+
+   // use NOFAIL-GUARANTEE
+   const auto shift = [&]( sampleCount amount ) {
+      for (auto ii = b0 + count, nn = mBlock.size(); ii < nn; ++ii)
+         mBlock[ii].start += amount;
+   };
+   std::move( mBlock.begin() + b0, mBlock.begin() + b1,
+              std::back_inserter( removed ) );
+   mBlock.erase( mBlock.begin() + b0, mBlock.begin() + b1 );
+   mBlock.insert( mBlock.begin() + b0,
+                  std::make_move_iterator( replacement.begin() ),
+                  std::make_move_iterator( replacement.end() ) );
+   shift( delta );
+
+   bool consistent = false;
+   auto cleanup = finally( [&] {
+      if ( !consistent ) {
+         shift( -delta );
+         std::move( mBlock.begin() + b0, mBlock.begin() + b0 + count,
+                    replacement.begin() );
+         mBlock.erase( mBlock.begin() + b0, mBlock.begin() + b0 + count );
+         mBlock.insert( mBlock.begin() + b0,
+                        std::make_move_iterator( removed.begin() ),
+                        std::make_move_iterator( removed.end() ) );
+      }
+   } );
+
+   // Check only the blocks that were spliced in; those after them moved
+   // together, so stay consistent with each other
+   ConsistencyCheck( mBlock, mMaxSamples, b0, b0 + count, numSamples,
+                     whereStr ); // may throw
+
+   // now commit
+   // use NOFAIL-GUARANTEE
+
+   mNumSamples = numSamples;
+   NoteLengthChange();
    consistent = true;
 }
 
@@ -1996,6 +2770,7 @@ void Sequence::AppendBlockFile( const BlockFileFactory &factory, size_t len )
    );
    mBlock.push_back(newBlock);
    mNumSamples += len;
+   NoteLengthChange();
 }
 
 void Sequence::AppendBlockFile(const BlockFilePtr &blockFile)
@@ -2004,6 +2779,7 @@ void Sequence::AppendBlockFile(const BlockFilePtr &blockFile)
 
    mBlock.push_back(SeqBlock(blockFile, mNumSamples));
    mNumSamples += blockFile->GetLength();
+   NoteLengthChange();
 
    // PRL:  I hoisted the intended consistency check out of the inner loop
    // See RecordingRecoveryHandler::HandleXMLEndTag
@@ -82,6 +82,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    sampleCount GetNumSamples() const { return mNumSamples; }
 
+   // Changes whenever the length of any sequence changes, so that indices of
+   // clips by sample position know when to rebuild
+   static unsigned long long GetLengthGeneration();
+
    bool Get(samplePtr buffer, sampleFormat format,
             sampleCount start, size_t len, bool mayThrow) const;
 
@@ -103,6 +107,19 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    // Return non-null, or else throw!
    std::unique_ptr<Sequence> Copy(sampleCount s0, sampleCount s1) const;
    void Paste(sampleCount s0, const Sequence *src);
+   // Append count more copies of all the samples, sharing the block files
+   // where the block sizes allow, with one consistency check
+   void Repeat(size_t count);
+   // Reverse the order of the samples in [start, start + len), in the stored
+   // format, rewriting only the blocks that overlap the range; blocks of
+   // constant value are their own reversal and are shared
+   void Reverse(sampleCount start, sampleCount len);
+
+   // Transform the samples in [start, start + len), reading and rewriting
+   // each block that overlaps the range once.  Returns false, changing
+   // nothing, if the transform stopped.
+   bool TransformSamples(sampleCount start, sampleCount len,
+                         const SampleTransform &transform);
 
    size_t GetIdealAppendLen() const;
    void Append(samplePtr buffer, sampleFormat format, size_t len,
@@ -175,12 +192,53 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    // This returns a possibly large or negative value
    sampleCount GetBlockStart(sampleCount position) const;
+   // The block holding the sample at position, which must be in range
+   const SeqBlock &GetBlockAt(sampleCount position) const;
 
    // These return a nonnegative number of samples meant to size a memory buffer
    size_t GetBestBlockSize(sampleCount start) const;
    size_t GetMaxBlockSize() const;
    size_t GetIdealBlockSize() const;
 
+   //
+   // Adaptive block sizing
+   //
+
+   // Count of the edits that rearranged samples, for the life of the
+   // sequence and those it was copied from
+   size_t GetEditCount() const { return mEditCount; }
+
+   // The disk block size, in bytes, that suits how the sequence is used:
+   // larger than the default for long sequences never edited, which are
+   // only played or kept, and smaller for densely edited ones.  The size
+   // stays the same where alias blocks fix it.
+   size_t GetAdaptiveDiskBlockSize() const;
+
+   // Whether consolidating would merge many short blocks, or change the
+   // block size to the adaptive one
+   bool NeedsReblock() const;
+
+   // Rewrite the blocks for the given disk block size, merging short ones
+   // and splitting long ones, and sharing those of good length
+   void Reblock(size_t maxDiskBlockSize);
+
+   // The blocks of Reblock, made aside.  Uses only its arguments, and
+   // reads and writes block files, so it may run on another thread with a
+   // copy of the block array of a sequence.  Alias blocks are always kept.
+   // May throw.
+   static BlockArray Consolidate(DirManager &dirManager, sampleFormat format,
+      const BlockArray &blocks, size_t maxDiskBlockSize);
+
+   // Whether the sequence has the very same block files at the same starts
+   // as blocks
+   bool HasBlocks(const BlockArray &blocks) const;
+
+   // Replace the blocks with those consolidated from original, and adopt
+   // the block size, if the sequence has the very same blocks as original
+   // still; return whether it did
+   bool CommitConsolidated(const BlockArray &original,
+      BlockArray &&consolidated, size_t maxDiskBlockSize);
+
    //
    // This should only be used if you really, really know what
    // you're doing!
@@ -189,6 +247,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    BlockArray &GetBlockArray() { return mBlock; }
    const BlockArray &GetBlockArray() const { return mBlock; }
 
+   /// Whether other has the same format and the very same block files at the
+   /// same starts, in the same project
+   bool HasSameBlocks(const Sequence &other) const;
+
    ///
    void LockDeleteUpdateMutex(){mDeleteUpdateMutex.Lock();}
    void UnlockDeleteUpdateMutex(){mDeleteUpdateMutex.Unlock();}
@@ -231,6 +293,8 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    size_t   mMinSamples; // min samples per block
    size_t   mMaxSamples; // max samples per block
 
+   size_t   mEditCount{ 0 };
+
    bool          mErrorOpening{ false };
 
    ///To block the Delete() method against the ODCalcSummaryTask::Update() method
@@ -252,7 +316,7 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    // Accumulate NEW block files onto the end of a block array.
    // Does not change this sequence.  The intent is to use
-   // CommitChangesIfConsistent later.
+   // CommitChangesIfConsistent or SpliceIfConsistent later.
    static void Blockify
       (DirManager &dirManager, size_t maxSamples, sampleFormat format,
        BlockArray &list, sampleCount start, samplePtr buffer, size_t len);
@@ -281,7 +345,14 @@ private:
        sampleCount numSamples, const wxChar *whereStr,
        bool mayThrow = true);
 
-   // The next two are used in methods that give a strong guarantee.
+   // Check only blocks [from, to), which must follow the block before them
+   // and end where block to starts, or at numSamples if to is the end
+   static void ConsistencyCheck
+      (const BlockArray &block, size_t maxSamples, size_t from, size_t to,
+       sampleCount numSamples, const wxChar *whereStr,
+       bool mayThrow = true);
+
+   // The next three are used in methods that give a strong guarantee.
    // They either throw because final consistency check fails, or swap the
    // changed contents into place.
 
@@ -292,6 +363,14 @@ private:
       (BlockArray &additionalBlocks, bool replaceLast,
        sampleCount numSamples, const wxChar *whereStr);
 
+   // Replace blocks [b0, b1) with the replacement blocks, in place, moving
+   // the later blocks by the change of length.  Neither copies nor checks
+   // the unchanged blocks, so the cost of an edit does not grow with the
+   // length of the whole sequence.
+   void SpliceIfConsistent
+      (size_t b0, size_t b1, BlockArray &replacement,
+       sampleCount numSamples, const wxChar *whereStr);
+
 };
 
 #endif // __AUDACITY_SEQUENCE__
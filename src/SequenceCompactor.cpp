@@ -0,0 +1,215 @@
+/**********************************************************************
+
+Audacity: A Digital Audio Editor
+
+SequenceCompactor.cpp
+
+*******************************************************************//**
+
+\class SequenceCompactor
+\brief Merges the short blocks of sequences in the background
+
+If the preference "/Directories/CompactSequences" is set, the project timer
+looks for a sequence of a project track that Sequence::NeedsReblock, and
+consolidates a copy of its block array on a worker thread.  On the main
+thread again, the NEW blocks replace the old in every clip that still has
+them, in the project and in the undo history, so that old blocks are freed.
+
+The saved state is left alone:  its blocks must stay as the project file
+names them.  Blocks that are locked, or still being computed, are left
+alone too.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "SequenceCompactor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#include "AudioIO.h"
+#include "BlockFile.h"
+#include "DirManager.h"
+#include "Prefs.h"
+#include "Project.h"
+#include "ProjectAudioIO.h"
+#include "ProjectFileIO.h"
+#include "ProjectWindow.h"
+#include "Sequence.h"
+#include "UndoManager.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+
+struct SequenceCompactor::Job {
+   std::shared_ptr< DirManager > dirManager;
+   sampleFormat format;
+   BlockArray original;
+   size_t maxDiskBlockSize;
+
+   // Written by the worker thread before it sets done
+   BlockArray consolidated;
+   std::exception_ptr exception;
+   std::atomic< bool > done{ false };
+};
+
+static AudacityProject::AttachedObjects::RegisteredFactory
+sSequenceCompactorKey {
+   []( AudacityProject &project ) {
+      return std::make_shared< SequenceCompactor >( project );
+   }
+};
+
+SequenceCompactor &SequenceCompactor::Get( AudacityProject &project )
+{
+   return project.AttachedObjects::Get< SequenceCompactor >(
+      sSequenceCompactorKey );
+}
+
+const SequenceCompactor &SequenceCompactor::Get(
+   const AudacityProject &project )
+{
+   return Get( const_cast< AudacityProject & >( project ) );
+}
+
+SequenceCompactor::SequenceCompactor( AudacityProject &project )
+   : mProject{ project }
+{
+}
+
+SequenceCompactor::~SequenceCompactor()
+{
+   Stop();
+}
+
+bool SequenceCompactor::GetCompactSequences()
+{
+   bool compactSequences = false;
+   gPrefs->Read(wxT("/Directories/CompactSequences"), &compactSequences);
+   return compactSequences;
+}
+
+void SequenceCompactor::Process()
+{
+   if (mJob) {
+      // A finished pass waits for the project to be idle again
+      if (!mJob->done.load( std::memory_order_acquire ) || !IsIdle())
+         return;
+      mThread.join();
+      auto cleanup = finally( [this]{ mJob.reset(); } );
+      if (!mJob->exception)
+         Commit();
+      return;
+   }
+
+   if (!GetCompactSequences() || !IsIdle())
+      return;
+
+   if (auto pSequence = FindCandidate())
+      Start( *pSequence );
+}
+
+void SequenceCompactor::Stop()
+{
+   if (mThread.joinable())
+      mThread.join();
+   mJob.reset();
+}
+
+bool SequenceCompactor::IsIdle() const
+{
+   auto &project = mProject;
+   if (ProjectAudioIO::Get( project ).IsAudioActive() ||
+       AudioIO::Get()->IsBusy())
+      return false;
+
+   // Modal dialogs and progress dialogs disable the window, while commands
+   // may be in the middle of changing the tracks
+   auto &window = ProjectWindow::Get( project );
+   if (!window.IsEnabled() || window.IsBeingDeleted() || wxIsBusy())
+      return false;
+
+   return !TrackList::Get( project ).HasPendingTracks();
+}
+
+Sequence *SequenceCompactor::FindCandidate()
+{
+   decltype(mTried) tried;
+   Sequence *result = nullptr;
+
+   for (auto wt : TrackList::Get( mProject ).Any< WaveTrack >()) {
+      // Only the clips directly in the tracks; UndoManager::ReplaceBlocks
+      // does not look into cut lines
+      for (const auto &pClip : wt->GetClips()) {
+         const auto pSequence = pClip->GetSequence();
+         const auto editCount = pSequence->GetEditCount();
+         auto found = mTried.find( pSequence );
+         if (found != mTried.end() && found->second == editCount) {
+            tried.insert( *found );
+            continue;
+         }
+         if (result)
+            continue;
+
+         const auto &blocks = pSequence->GetBlockArray();
+         if (std::any_of( blocks.begin(), blocks.end(),
+            []( const SeqBlock &block ){
+               return block.f->IsLocked() ||
+                  !block.f->IsDataAvailable() ||
+                  !block.f->IsSummaryAvailable(); } ))
+            continue;
+
+         if (pSequence->NeedsReblock()) {
+            result = pSequence;
+            tried[ pSequence ] = editCount;
+         }
+      }
+   }
+
+   // Forget the sequences that are gone
+   mTried.swap( tried );
+   return result;
+}
+
+void SequenceCompactor::Start( Sequence &sequence )
+{
+   auto pJob = std::make_unique< Job >();
+   pJob->dirManager = DirManager::Get( mProject ).shared_from_this();
+   pJob->format = sequence.GetSampleFormat();
+   pJob->original = sequence.GetBlockArray();
+   pJob->maxDiskBlockSize = sequence.GetAdaptiveDiskBlockSize();
+
+   auto &job = *pJob;
+   mThread = std::thread( [&job]{
+      try {
+         job.consolidated = Sequence::Consolidate( *job.dirManager,
+            job.format, job.original, job.maxDiskBlockSize );
+      }
+      catch ( ... ) {
+         // Leave the sequence as it was
+         job.exception = std::current_exception();
+      }
+      job.done.store( true, std::memory_order_release );
+   } );
+   mJob = std::move( pJob );
+}
+
+void SequenceCompactor::Commit()
+{
+   auto &job = *mJob;
+   if (!UndoManager::Get( mProject ).ReplaceBlocks(
+      job.original, job.consolidated, job.maxDiskBlockSize ))
+      return;
+
+   bool replaced = false;
+   for (auto wt : TrackList::Get( mProject ).Any< WaveTrack >())
+      for (const auto &pClip : wt->GetClips())
+         replaced = pClip->GetSequence()->CommitConsolidated( job.original,
+            BlockArray{ job.consolidated }, job.maxDiskBlockSize )
+         || replaced;
+
+   // So that recovery after a crash finds the NEW blocks, not the old ones
+   // that may now be deleted
+   if (replaced)
+      ProjectFileIO::Get( mProject ).AutoSave();
+}
@@ -0,0 +1,67 @@
+/**********************************************************************
+
+Audacity: A Digital Audio Editor
+
+SequenceCompactor.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SEQUENCE_COMPACTOR__
+#define __AUDACITY_SEQUENCE_COMPACTOR__
+
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include "ClientData.h" // to inherit
+
+class AudacityProject;
+class Sequence;
+
+///\brief Object associated with a project that reblocks its fragmented
+/// sequences while the project is idle
+///
+/// Edits leave many short blocks, each read and drawn apart.  When nothing
+/// else happens, the compactor consolidates one sequence at a time on a
+/// worker thread, then gives the result to the project tracks and to every
+/// undo state that has the same blocks.
+class SequenceCompactor final
+   : public ClientData::Base
+{
+public:
+   static SequenceCompactor &Get( AudacityProject &project );
+   static const SequenceCompactor &Get( const AudacityProject &project );
+
+   explicit SequenceCompactor( AudacityProject &project );
+   SequenceCompactor( const SequenceCompactor & ) PROHIBITED;
+   SequenceCompactor &operator=( const SequenceCompactor & ) PROHIBITED;
+   ~SequenceCompactor() override;
+
+   /// Called periodically on the main thread:  commits a finished pass, or
+   /// starts one if the project is idle
+   void Process();
+
+   /// Wait for the worker thread and discard its results
+   void Stop();
+
+   /// Whether the preference to compact sequences is set
+   static bool GetCompactSequences();
+
+private:
+   bool IsIdle() const;
+   Sequence *FindCandidate();
+   void Start( Sequence &sequence );
+   void Commit();
+
+   struct Job;
+
+   AudacityProject &mProject;
+   std::unique_ptr< Job > mJob;
+   std::thread mThread;
+
+   // Sequences already tried, with their edit counts then, so that they are
+   // not tried again before they change
+   std::unordered_map< const Sequence*, size_t > mTried;
+};
+
+#endif
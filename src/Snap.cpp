@@ -13,6 +13,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <unordered_map>
 
 #include "Project.h"
 #include "ProjectSettings.h"
@@ -71,6 +72,93 @@ SnapManager::~SnapManager()
 {
 }
 
+namespace {
+
+// A snap candidate before filtering by the time converter; remembers the clip
+// so that clips excluded from one drag can be skipped
+struct CandidatePoint {
+   double t;
+   const Track *track;
+   const WaveClip *clip;
+
+   bool operator == (const CandidatePoint &other) const
+   {
+      return t == other.t && track == other.track && clip == other.clip;
+   }
+};
+
+using CandidatePoints = std::vector< CandidatePoint >;
+
+// Snap candidates of all tracks of a project, kept between drags, so that
+// starting a drag needs only to check that each track still has the same
+// clip and label boundaries, instead of converting and sorting all of them
+// again
+struct SnapPointCache final : ClientData::Base
+{
+   struct Entry {
+      // Unfiltered, in the order of the track's clips or labels
+      CandidatePoints raw;
+      // Sorted, filtered by the settings below
+      CandidatePoints filtered;
+      bool snapToTime{ false };
+      double rate{ 0.0 };
+      NumericFormatSymbol format;
+      bool visited{ false };
+   };
+   std::unordered_map< const Track*, Entry > mEntries;
+
+   // All entries' filtered points merged in time order
+   CandidatePoints mSorted;
+   bool mSortedValid{ false };
+};
+
+const AudacityProject::AttachedObjects::RegisteredFactory sSnapPointCacheKey{
+   []( AudacityProject & ){ return std::make_unique< SnapPointCache >(); }
+};
+
+void CollectCandidates(const Track *pTrack, CandidatePoints &points)
+{
+   points.clear();
+   pTrack->TypeSwitch(
+      [&](const LabelTrack *labelTrack) {
+         for (int i = 0, cnt = labelTrack->GetNumLabels(); i < cnt; ++i)
+         {
+            const LabelStruct *label = labelTrack->GetLabel(i);
+            const double t0 = label->getT0();
+            const double t1 = label->getT1();
+            points.push_back({ t0, labelTrack, nullptr });
+            if (t1 != t0)
+            {
+               points.push_back({ t1, labelTrack, nullptr });
+            }
+         }
+      },
+      [&](const WaveTrack *waveTrack) {
+         for (const auto &clip: waveTrack->GetClips())
+         {
+            points.push_back(
+               { clip->GetStartTime(), waveTrack, clip.get() });
+            points.push_back(
+               { clip->GetEndTime(), waveTrack, clip.get() });
+         }
+      }
+#ifdef USE_MIDI
+      ,
+      [&](const NoteTrack *track) {
+         points.push_back({ track->GetStartTime(), track, nullptr });
+         points.push_back({ track->GetEndTime(), track, nullptr });
+      }
+#endif
+   );
+}
+
+inline bool operator < (const CandidatePoint &p1, const CandidatePoint &p2)
+{
+   return p1.t < p2.t;
+}
+
+}
+
 void SnapManager::Reinit()
 {
    const auto &settings = ProjectSettings::Get( *mProject );
@@ -102,78 +190,107 @@ void SnapManager::Reinit()
       mConverter.SetFormatName(mFormat);
    }
 
-   // Add a SnapPoint at t=0
-   mSnapPoints.push_back(SnapPoint{});
-
-   auto trackRange =
-      mTracks->Any()
-         - [&](const Track *pTrack){
-            return mTrackExclusions &&
-               make_iterator_range( *mTrackExclusions ).contains( pTrack );
-         };
-   trackRange.Visit(
-      [&](const LabelTrack *labelTrack) {
-         for (int i = 0, cnt = labelTrack->GetNumLabels(); i < cnt; ++i)
-         {
-            const LabelStruct *label = labelTrack->GetLabel(i);
-            const double t0 = label->getT0();
-            const double t1 = label->getT1();
-            CondListAdd(t0, labelTrack);
-            if (t1 != t0)
-            {
-               CondListAdd(t1, labelTrack);
-            }
-         }
-      },
-      [&](const WaveTrack *waveTrack) {
-         for (const auto &clip: waveTrack->GetClips())
-         {
-            if (mClipExclusions)
-            {
-               bool skip = false;
-               for (size_t j = 0, cnt = mClipExclusions->size(); j < cnt; ++j)
-               {
-                  if ((*mClipExclusions)[j].track == waveTrack &&
-                      (*mClipExclusions)[j].clip == clip.get())
-                  {
-                     skip = true;
-                     break;
-                  }
-               }
-
-               if (skip)
-                  continue;
-            }
+   // The project's own tracks share the project's cache; any other list is
+   // examined from scratch
+   auto &project = const_cast< AudacityProject & >( *mProject );
+   SnapPointCache localCache;
+   auto &cache = ( mTracks == &TrackList::Get( project ) )
+      ? project.AttachedObjects::Get< SnapPointCache >( sSnapPointCacheKey )
+      : localCache;
+
+   for (auto &pair : cache.mEntries)
+      pair.second.visited = false;
+
+   // Bring the entries up to date with the tracks.  Edits of clips and labels
+   // do not notify the TrackList, so compare the boundaries instead; that is
+   // cheap compared with filtering and sorting.
+   CandidatePoints scratch;
+   for (const auto pTrack : mTracks->Any())
+   {
+      CollectCandidates(pTrack, scratch);
+
+      auto &entry = cache.mEntries[ pTrack ];
+      entry.visited = true;
+      const bool sameFilter = entry.snapToTime == mSnapToTime &&
+         (!mSnapToTime || (entry.rate == mRate && entry.format == mFormat));
+      if (sameFilter && entry.raw == scratch)
+         continue;
+
+      entry.raw.swap(scratch);
+      entry.snapToTime = mSnapToTime;
+      entry.rate = mRate;
+      entry.format = mFormat;
+      entry.filtered.clear();
+      for (const auto &point : entry.raw)
+         if (CondListAdd(point.t))
+            entry.filtered.push_back(point);
+      std::sort(entry.filtered.begin(), entry.filtered.end());
+      cache.mSortedValid = false;
+   }
 
-            CondListAdd(clip->GetStartTime(), waveTrack);
-            CondListAdd(clip->GetEndTime(), waveTrack);
-         }
+   // Forget tracks that went away
+   for (auto iter = cache.mEntries.begin(); iter != cache.mEntries.end();)
+   {
+      if (iter->second.visited)
+         ++iter;
+      else {
+         iter = cache.mEntries.erase(iter);
+         cache.mSortedValid = false;
       }
-#ifdef USE_MIDI
-      ,
-      [&](const NoteTrack *track) {
-         CondListAdd(track->GetStartTime(), track);
-         CondListAdd(track->GetEndTime(), track);
+   }
+
+   if (!cache.mSortedValid)
+   {
+      auto &sorted = cache.mSorted;
+      sorted.clear();
+      for (const auto &pair : cache.mEntries)
+      {
+         const auto &filtered = pair.second.filtered;
+         const auto size = sorted.size();
+         sorted.insert(sorted.end(), filtered.begin(), filtered.end());
+         std::inplace_merge(
+            sorted.begin(), sorted.begin() + size, sorted.end());
       }
-#endif
-   );
+      cache.mSortedValid = true;
+   }
+
+   // Copy the sorted candidates, leaving out the excluded tracks and clips
+   const auto excluded = [&](const CandidatePoint &point) -> bool {
+      if (mTrackExclusions &&
+          make_iterator_range( *mTrackExclusions ).contains( point.track ))
+         return true;
+      if (mClipExclusions && point.clip)
+      {
+         for (const auto &exclusion : *mClipExclusions)
+         {
+            if (exclusion.track == point.track &&
+                exclusion.clip == point.clip)
+               return true;
+         }
+      }
+      return false;
+   };
+   for (const auto &point : cache.mSorted)
+   {
+      if (!excluded(point))
+         mSnapPoints.push_back(SnapPoint{ point.t, point.track });
+   }
 
-   // Sort all by time
-   std::sort(mSnapPoints.begin(), mSnapPoints.end());
+   // Add a SnapPoint at t=0
+   mSnapPoints.insert(
+      std::upper_bound(mSnapPoints.begin(), mSnapPoints.end(), SnapPoint{}),
+      SnapPoint{});
 }
 
-// Adds to mSnapPoints, filtering by TimeConverter
-void SnapManager::CondListAdd(double t, const Track *track)
+// Whether a point belongs in mSnapPoints, filtering by TimeConverter
+bool SnapManager::CondListAdd(double t)
 {
    if (mSnapToTime)
    {
       mConverter.SetValue(t);
    }
 
-   if (!mSnapToTime || mConverter.GetValue() == t)
-   {
-      mSnapPoints.push_back(SnapPoint{ t, track });
-   }
+   return !mSnapToTime || mConverter.GetValue() == t;
 }
 
 // Return the time of the SnapPoint at a given index
@@ -189,30 +306,16 @@ wxInt64 SnapManager::PixelDiff(double t, size_t index)
                    mZoomInfo->TimeToPosition(Get(index), 0));
 }
 
-// Find the index where this SnapPoint should go in
-// sorted order, between i0 (inclusive) and i1 (exclusive).
-size_t SnapManager::Find(double t, size_t i0, size_t i1)
-{
-   if (i1 <= i0 + 1)
-   {
-      return i0;
-   }
-
-   size_t half = (i0 + i1) / 2;
-
-   if (t < Get(half))
-   {
-      return Find(t, i0, half);
-   }
-
-   return Find(t, half, i1);
-}
-
 // Find the SnapPoint nearest to time t
 size_t SnapManager::Find(double t)
 {
    size_t cnt = mSnapPoints.size();
-   size_t index = Find(t, 0, cnt);
+
+   // Find the last point not after t, or else the first point
+   auto found = std::upper_bound(mSnapPoints.begin(), mSnapPoints.end(),
+      SnapPoint{ t });
+   size_t index = found == mSnapPoints.begin()
+      ? 0 : (found - mSnapPoints.begin()) - 1;
 
    // At this point, either index is the closest, or the next one
    // to the right is.  Keep moving to the right until we get a
@@ -15,10 +15,83 @@
 
 #include "Spectrum.h"
 
+#include <algorithm>
 #include <math.h>
 
+#include "RealFFTf.h"
 #include "SampleFormat.h"
 
+// Frames transformed together when there is no autocorrelation
+enum : size_t { SpectrumBatch = 16 };
+
+namespace {
+
+// Add the autocorrelation of the cube root compressed power spectrum of one
+// frame to the first half of sums.  buffer holds hFFT->Points * 2 floats and
+// powers one more than half as many
+void AccumulateAutocorrelation(const FFTParam *hFFT, const float *window,
+   const float *data, float *buffer, float *powers, float *sums)
+{
+   const size_t half = hFFT->Points;
+   const size_t windowSize = 2 * half;
+   PowerSpectraf(hFFT, data, 0, window, 1, buffer, powers);
+
+   // Tolonen and Karjalainen recommend taking the cube root
+   // of the power, instead of the square root.
+   // The power spectrum of real data is symmetric, so take the root of the
+   // unique half and mirror it
+   for (size_t i = 0; i <= half; i++)
+      powers[i] = powf(powers[i], 1.0f / 3.0f);
+   buffer[0] = powers[0];
+   for (size_t i = 1; i <= half; i++)
+      buffer[i] = buffer[windowSize - i] = powers[i];
+
+   // Take FFT, and the real part of the result
+   RealFFTf(buffer, hFFT);
+   sums[0] += buffer[0];
+   for (size_t i = 1; i < half; i++)
+      sums[i] += buffer[hFFT->BitReversed[i]];
+}
+
+// Peak prune, reverse and scale the sums into output, which may be sums;
+// temp holds half of windowSize floats
+void FinishAutocorrelation(size_t windowSize,
+   float *sums, float *temp, float *output)
+{
+   const auto half = windowSize / 2;
+
+   // Peak Pruning as described by Tolonen and Karjalainen, 2000
+   /*
+    Combine most of the calculations in a single for loop.
+    It should be safe, as indexes refer only to current and previous elements,
+    that have already been clipped, etc...
+   */
+   for (size_t i = 0; i < half; i++) {
+     // Clip at zero, copy to temp array
+     if (sums[i] < 0.0)
+         sums[i] = float(0.0);
+     temp[i] = sums[i];
+     // Subtract a time-doubled signal (linearly interp.) from the original
+     // (clipped) signal
+     if ((i % 2) == 0)
+        sums[i] -= temp[i / 2];
+     else
+        sums[i] -= ((temp[i / 2] + temp[i / 2 + 1]) / 2);
+
+     // Clip at zero again
+     if (sums[i] < 0.0)
+         sums[i] = float(0.0);
+   }
+
+   // Reverse and scale
+   for (size_t i = 0; i < half; i++)
+      temp[i] = sums[i] / (windowSize / 4);
+   for (size_t i = 0; i < half; i++)
+      output[half - 1 - i] = temp[i];
+}
+
+}
+
 bool ComputeSpectrum(const float * data, size_t width,
                      size_t windowSize,
                      double WXUNUSED(rate), float *output,
@@ -37,75 +110,40 @@ bool ComputeSpectrum(const float * data, size_t width,
    auto half = windowSize / 2;
 
    Floats in{ windowSize };
-   Floats out{ windowSize };
-   Floats out2{ windowSize };
+
+   const auto window = GetLegacyWindowTable(windowFunc, windowSize);
+   auto hFFT = GetFFT(windowSize);
 
    size_t start = 0;
    unsigned windows = 0;
-   while (start + windowSize <= width) {
-      for (size_t i = 0; i < windowSize; i++)
-         in[i] = data[start + i];
-
-      WindowFunc(windowFunc, windowSize, in.get());
-
-      if (autocorrelation) {
-         // Take FFT
-         RealFFT(windowSize, in.get(), out.get(), out2.get());
-         // Compute power
-         for (size_t i = 0; i < windowSize; i++)
-            in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
-
-         // Tolonen and Karjalainen recommend taking the cube root
-         // of the power, instead of the square root
-
-         for (size_t i = 0; i < windowSize; i++)
-            in[i] = powf(in[i], 1.0f / 3.0f);
-
-         // Take FFT
-         RealFFT(windowSize, in.get(), out.get(), out2.get());
-      }
-      else
-         PowerSpectrum(windowSize, in.get(), out.get());
-
-      // Take real part of result
-      for (size_t i = 0; i < half; i++)
-        processed[i] += out[i];
-
-      start += half;
-      windows++;
-   }
-
    if (autocorrelation) {
-
-      // Peak Pruning as described by Tolonen and Karjalainen, 2000
-      /*
-       Combine most of the calculations in a single for loop.
-       It should be safe, as indexes refer only to current and previous elements,
-       that have already been clipped, etc...
-      */
-      for (size_t i = 0; i < half; i++) {
-        // Clip at zero, copy to temp array
-        if (processed[i] < 0.0)
-            processed[i] = float(0.0);
-        out[i] = processed[i];
-        // Subtract a time-doubled signal (linearly interp.) from the original
-        // (clipped) signal
-        if ((i % 2) == 0)
-           processed[i] -= out[i / 2];
-        else
-           processed[i] -= ((out[i / 2] + out[i / 2 + 1]) / 2);
-
-        // Clip at zero again
-        if (processed[i] < 0.0)
-            processed[i] = float(0.0);
+      Floats powers{ half + 1 };
+      while (start + windowSize <= width) {
+         AccumulateAutocorrelation(hFFT.get(), window, data + start,
+            in.get(), powers.get(), processed.get());
+         start += half;
+         windows++;
       }
 
-      // Reverse and scale
-      for (size_t i = 0; i < half; i++)
-         in[i] = processed[i] / (windowSize / 4);
-      for (size_t i = 0; i < half; i++)
-         processed[half - 1 - i] = in[i];
+      FinishAutocorrelation(windowSize, processed.get(), in.get(),
+         processed.get());
    } else {
+      // Power spectra of several frames at once
+      Floats powers{ SpectrumBatch * (half + 1) };
+      while (start + windowSize <= width) {
+         const auto frames = std::min<size_t>(SpectrumBatch,
+            (width - windowSize - start) / half + 1);
+         PowerSpectraf(hFFT.get(), data + start, half, window,
+            frames, in.get(), powers.get());
+         for (size_t frame = 0; frame < frames; frame++) {
+            const auto power = powers.get() + frame * (half + 1);
+            for (size_t i = 0; i < half; i++)
+               processed[i] += power[i];
+         }
+         start += frames * half;
+         windows += frames;
+      }
+
       // Convert to decibels
       // But do it safely; -Inf is nobody's friend
       for (size_t i = 0; i < half; i++){
@@ -123,3 +161,19 @@ bool ComputeSpectrum(const float * data, size_t width,
    return true;
 }
 
+void ComputeEnhancedAutocorrelation(const float *data, size_t windowSize,
+   float *output, float *scratch, int windowFunc)
+{
+   const auto half = windowSize / 2;
+   const auto buffer = scratch;
+   const auto powers = buffer + windowSize;
+   const auto sums = powers + half + 1;
+   std::fill(sums, sums + half, 0.0f);
+
+   // The tables are cached, so this does not allocate after the first time
+   auto hFFT = GetFFT(windowSize);
+   AccumulateAutocorrelation(hFFT.get(),
+      GetLegacyWindowTable(windowFunc, windowSize), data,
+      buffer, powers, sums);
+   FinishAutocorrelation(windowSize, sums, buffer, output);
+}
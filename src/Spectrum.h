@@ -25,4 +25,13 @@ bool ComputeSpectrum(const float * data, size_t width, size_t windowSize,
                      double rate, float *out, bool autocorrelation,
                      int windowFunc = eWinFuncHanning);
 
+/*
+  The enhanced autocorrelation of one frame, as ComputeSpectrum computes it
+  when width equals windowSize, but without allocating, for callers that
+  compute many; scratch holds 3 * windowSize floats and must not overlap
+  data, which it does not change
+*/
+void ComputeEnhancedAutocorrelation(const float *data, size_t windowSize,
+   float *output, float *scratch, int windowFunc = eWinFuncHanning);
+
 #endif
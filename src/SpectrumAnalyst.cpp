@@ -27,9 +27,14 @@ and in the spectrogram spectral selection.
 #include "SpectrumAnalyst.h"
 #include "FFT.h"
 
+#include <algorithm>
+#include "RealFFTf.h"
 #include "SampleFormat.h"
 #include <wx/dcclient.h>
 
+// Samples read from the source at a time
+enum : size_t { BlockSize = 262144 };
+
 FreqGauge::FreqGauge(wxWindow * parent, wxWindowID winid)
 :  wxStatusBar(parent, winid, wxST_SIZEGRIP)
 {
@@ -95,6 +100,37 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
                                 const float *data, size_t dataLen,
                                 float *pYMin, float *pYMax,
                                 FreqGauge *progress)
+{
+   if (progress) {
+      progress->SetRange(dataLen);
+   }
+
+   const auto result = Calculate(alg, windowFunc, windowSize, rate,
+      [data]( sampleCount start, size_t len, float *buffer ){
+         std::copy( data + start.as_size_t(),
+            data + start.as_size_t() + len, buffer );
+      },
+      sampleCount( dataLen ), pYMin, pYMax,
+      [progress]( sampleCount done ){
+         if (progress) {
+            progress->SetValue( done.as_size_t() );
+         }
+      });
+
+   if (progress) {
+      // Reset for next time
+      progress->Reset();
+   }
+
+   return result;
+}
+
+bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
+                                size_t windowSize, double rate,
+                                const SampleSource &source,
+                                sampleCount dataLen,
+                                float *pYMin, float *pYMax,
+                                const ProgressReport &progress)
 {
    // Wipe old data
    mProcessed.resize(0);
@@ -111,7 +147,7 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       return false;
    }
 
-   if (dataLen < windowSize) {
+   if (dataLen < sampleCount( windowSize )) {
       return false;
    }
 
@@ -126,15 +162,12 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
    Floats in{ mWindowSize };
    Floats out{ mWindowSize };
    Floats out2{ mWindowSize };
-   Floats win{ mWindowSize };
+   const auto win = GetLegacyWindowTable(windowFunc, mWindowSize);
 
    for (size_t i = 0; i < mWindowSize; i++) {
       mProcessed[i] = 0.0f;
-      win[i] = 1.0f;
    }
 
-   WindowFunc(windowFunc, mWindowSize, win.get());
-
    // Scale window such that an amplitude of 1.0 in the time domain
    // shows an amplitude of 0dB in the frequency domain
    double wss = 0;
@@ -145,97 +178,121 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
    else
       wss = 1.0;
 
-   if (progress) {
-      progress->SetRange(dataLen);
-   }
-
-   size_t start = 0;
-   int windows = 0;
-   while (start + mWindowSize <= dataLen) {
-      for (size_t i = 0; i < mWindowSize; i++)
-         in[i] = win[i] * data[start + i];
+   // Frames begin every half window.  Read a block of whole frames at a
+   // time; the next block begins with the first frame that did not fit, so
+   // the overlap is read again, and memory does not grow with dataLen.
+   const size_t blockFrames = std::max<size_t>( 1, BlockSize / half );
+   const size_t blockSize = (blockFrames - 1) * half + mWindowSize;
+   Floats block{ blockSize };
 
-      switch (alg) {
-         case Spectrum:
-            PowerSpectrum(mWindowSize, in.get(), out.get());
+   // For the Spectrum algorithm, power spectra of several frames at once
+   enum : size_t { Batch = 16 };
+   auto hFFT = GetFFT(mWindowSize);
+   Floats powers{ Batch * (half + 1) };
 
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Autocorrelation:
-         case CubeRootAutocorrelation:
-         case EnhancedAutocorrelation:
-
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-            // Compute power
+   sampleCount blockStart = 0;
+   int windows = 0;
+   while (blockStart + mWindowSize <= dataLen) {
+      const auto blockLen =
+         limitSampleBufferSize( blockSize, dataLen - blockStart );
+      source( blockStart, blockLen, block.get() );
+      const auto frames = (blockLen - mWindowSize) / half + 1;
+      const float *data = block.get();
+
+      size_t start = 0;
+      if (alg == Spectrum) {
+         for (size_t done = 0; done < frames;) {
+            const auto batch = std::min<size_t>(Batch, frames - done);
+            PowerSpectraf(hFFT.get(), data + start, half, win,
+               batch, in.get(), powers.get());
+            for (size_t frame = 0; frame < batch; frame++) {
+               const auto power = powers.get() + frame * (half + 1);
+               for (size_t i = 0; i < half; i++)
+                  mProcessed[i] += power[i];
+            }
+            start += batch * half;
+            done += batch;
+         }
+         windows += frames;
+      }
+      else {
+         for (size_t frame = 0; frame < frames; frame++) {
             for (size_t i = 0; i < mWindowSize; i++)
-               in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+               in[i] = win[i] * data[start + i];
+
+            switch (alg) {
+               case Autocorrelation:
+               case CubeRootAutocorrelation:
+               case EnhancedAutocorrelation:
+
+                  // Take FFT
+                  RealFFT(mWindowSize, in.get(), out.get(), out2.get());
+                  // Compute power
+                  for (size_t i = 0; i < mWindowSize; i++)
+                     in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+
+                  if (alg == Autocorrelation) {
+                     for (size_t i = 0; i < mWindowSize; i++)
+                        in[i] = sqrt(in[i]);
+                  }
+                  if (alg == CubeRootAutocorrelation ||
+                      alg == EnhancedAutocorrelation) {
+                     // Tolonen and Karjalainen recommend taking the cube root
+                     // of the power, instead of the square root
+
+                     for (size_t i = 0; i < mWindowSize; i++)
+                        in[i] = pow(in[i], 1.0f / 3.0f);
+                  }
+                  // Take FFT
+                  RealFFT(mWindowSize, in.get(), out.get(), out2.get());
+
+                  // Take real part of result
+                  for (size_t i = 0; i < half; i++)
+                     mProcessed[i] += out[i];
+                  break;
 
-            if (alg == Autocorrelation) {
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = sqrt(in[i]);
-            }
-            if (alg == CubeRootAutocorrelation ||
-                alg == EnhancedAutocorrelation) {
-               // Tolonen and Karjalainen recommend taking the cube root
-               // of the power, instead of the square root
+               case Cepstrum:
+                  RealFFT(mWindowSize, in.get(), out.get(), out2.get());
+
+                  // Compute log power
+                  // Set a sane lower limit assuming maximum time amplitude of 1.0
+                  {
+                     float power;
+                     float minpower = 1e-20*mWindowSize*mWindowSize;
+                     for (size_t i = 0; i < mWindowSize; i++)
+                     {
+                        power = (out[i] * out[i]) + (out2[i] * out2[i]);
+                        if(power < minpower)
+                           in[i] = log(minpower);
+                        else
+                           in[i] = log(power);
+                     }
+                     // Take IFFT
+                     InverseRealFFT(mWindowSize, in.get(), NULL, out.get());
+
+                     // Take real part of result
+                     for (size_t i = 0; i < half; i++)
+                        mProcessed[i] += out[i];
+                  }
 
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = pow(in[i], 1.0f / 3.0f);
-            }
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Take real part of result
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Cepstrum:
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Compute log power
-            // Set a sane lower limit assuming maximum time amplitude of 1.0
-            {
-               float power;
-               float minpower = 1e-20*mWindowSize*mWindowSize;
-               for (size_t i = 0; i < mWindowSize; i++)
-               {
-                  power = (out[i] * out[i]) + (out2[i] * out2[i]);
-                  if(power < minpower)
-                     in[i] = log(minpower);
-                  else
-                     in[i] = log(power);
-               }
-               // Take IFFT
-               InverseRealFFT(mWindowSize, in.get(), NULL, out.get());
-
-               // Take real part of result
-               for (size_t i = 0; i < half; i++)
-                  mProcessed[i] += out[i];
-            }
+                  break;
+
+               default:
+                  wxASSERT(false);
+                  break;
+            }                         //switch
 
-            break;
+            start += half;
+            windows++;
+         }
+      }
 
-         default:
-            wxASSERT(false);
-            break;
-      }                         //switch
+      blockStart += frames * half;
 
       // Update the progress bar
       if (progress) {
-         progress->SetValue(start);
+         progress(blockStart);
       }
-
-      start += half;
-      windows++;
-   }
-
-   if (progress) {
-      // Reset for next time
-      progress->Reset();
    }
 
    float mYMin = 1000000, mYMax = -1000000;
@@ -12,8 +12,10 @@
 #ifndef __AUDACITY_SPECTRUM_ANALYST__
 #define __AUDACITY_SPECTRUM_ANALYST__
 
+#include <functional>
 #include <vector>
 #include <wx/statusbr.h>
+#include "audacity/Types.h"
 
 class FreqGauge;
 
@@ -42,6 +44,21 @@ public:
       float *pYMin = NULL, float *pYMax = NULL, // outputs
       FreqGauge *progress = NULL);
 
+   /// Writes len samples of the data, beginning at start, to buffer
+   using SampleSource =
+      std::function< void( sampleCount start, size_t len, float *buffer ) >;
+   /// Told how many samples have been analyzed so far
+   using ProgressReport = std::function< void( sampleCount done ) >;
+
+   // The same, taking the data from source a block at a time, so that
+   // memory does not grow with dataLen.  Calls back on the same thread.
+   bool Calculate(Algorithm alg,
+      int windowFunc, // see FFT.h for values
+      size_t windowSize, double rate,
+      const SampleSource &source, sampleCount dataLen,
+      float *pYMin = NULL, float *pYMax = NULL, // outputs
+      const ProgressReport &progress = {});
+
    const float *GetProcessed() const;
    int GetProcessedSize() const;
 
@@ -0,0 +1,67 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  StartupTimer.cpp
+
+*******************************************************************//**
+
+\class StartupTimer
+\brief Remembers how long each phase of startup took, so that slow
+registration of plug-ins and modules can be seen and measured.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "StartupTimer.h"
+
+#include <chrono>
+#include <vector>
+#include <wx/sstream.h>
+#include <wx/txtstrm.h>
+
+#include "Internat.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Phase {
+   TranslatableString name;
+   Clock::duration duration;
+};
+
+// Initialized with the other statics, before main
+const Clock::time_point sStart = Clock::now();
+Clock::time_point sLast = sStart;
+std::vector<Phase> sPhases;
+
+double Milliseconds(Clock::duration duration)
+{
+   return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}
+
+void StartupTimer::Mark(const TranslatableString &phase)
+{
+   const auto now = Clock::now();
+   sPhases.push_back({ phase, now - sLast });
+   sLast = now;
+}
+
+wxString StartupTimer::Report()
+{
+   wxStringOutputStream o;
+   wxTextOutputStream s(o, wxEOL_UNIX);
+
+   s << wxT("==============================\n");
+   s << XO("Startup times:\n");
+   for (const auto &phase : sPhases)
+      s << XO("%s: %.1f ms\n")
+         .Format( phase.name, Milliseconds(phase.duration) );
+   s << wxT("==============================\n");
+   s << XO("Total: %.1f ms\n").Format( Milliseconds(sLast - sStart) );
+
+   return o.GetString();
+}
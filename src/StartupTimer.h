@@ -0,0 +1,33 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  StartupTimer.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_STARTUP_TIMER__
+#define __AUDACITY_STARTUP_TIMER__
+
+#include "Audacity.h"
+
+#include <wx/string.h>
+
+class TranslatableString;
+
+/// \brief Durations of the phases of startup, for Help > Diagnostics.
+///
+/// Timing begins with static initialization of the program.  Marks are made
+/// on the main thread only.
+class AUDACITY_DLL_API StartupTimer final
+{
+public:
+   /// Record the time since the previous mark (or since timing began) as
+   /// spent in the phase just ended
+   static void Mark(const TranslatableString &phase);
+
+   /// A readable summary for diagnostics
+   static wxString Report();
+};
+
+#endif
@@ -0,0 +1,151 @@
+/**********************************************************************
+
+Audacity: A Digital Audio Editor
+
+SummaryPrefetcher.cpp
+
+*******************************************************************//**
+
+\class SummaryPrefetcher
+\brief Reads the summaries of the blocks of a project in the background
+
+If the preference "/Directories/PrefetchSummaries" is set, opening a project
+starts a few worker threads, which call BlockFile::PrepareSummaries for
+each block of each wave track, those of the tracks on screen first.  Later
+draws of those blocks at the coarser zoom levels then read no files.
+
+The threads hold the blocks until they finish, and the project timer lets
+go of them on the main thread, so that no block is destroyed on a worker.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "SummaryPrefetcher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <unordered_set>
+
+#include "BlockFile.h"
+#include "Prefs.h"
+#include "Project.h"
+#include "Sequence.h"
+#include "TrackPanel.h"
+#include "ViewInfo.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+#include "tracks/ui/TrackView.h"
+
+struct SummaryPrefetcher::Job {
+   std::vector< BlockFilePtr > blocks;
+   std::atomic< size_t > next{ 0 };
+   std::atomic< size_t > nRunning{ 0 };
+   std::atomic< bool > stopped{ false };
+};
+
+static AudacityProject::AttachedObjects::RegisteredFactory
+sSummaryPrefetcherKey {
+   []( AudacityProject &project ) {
+      return std::make_shared< SummaryPrefetcher >( project );
+   }
+};
+
+SummaryPrefetcher &SummaryPrefetcher::Get( AudacityProject &project )
+{
+   return project.AttachedObjects::Get< SummaryPrefetcher >(
+      sSummaryPrefetcherKey );
+}
+
+const SummaryPrefetcher &SummaryPrefetcher::Get(
+   const AudacityProject &project )
+{
+   return Get( const_cast< AudacityProject & >( project ) );
+}
+
+SummaryPrefetcher::SummaryPrefetcher( AudacityProject &project )
+   : mProject{ project }
+{
+}
+
+SummaryPrefetcher::~SummaryPrefetcher()
+{
+   Stop();
+}
+
+bool SummaryPrefetcher::GetPrefetchSummaries()
+{
+   bool prefetchSummaries = false;
+   gPrefs->Read(wxT("/Directories/PrefetchSummaries"), &prefetchSummaries);
+   return prefetchSummaries;
+}
+
+void SummaryPrefetcher::Start()
+{
+   Stop();
+   if (!GetPrefetchSummaries())
+      return;
+
+   // The tracks on screen go first
+   const auto &viewInfo = ViewInfo::Get( mProject );
+   const auto top = viewInfo.vpos;
+   const auto bottom =
+      top + TrackPanel::Get( mProject ).GetSize().GetHeight();
+   std::vector< const WaveTrack* > tracks;
+   auto range = TrackList::Get( mProject ).Any< const WaveTrack >();
+   std::copy( range.begin(), range.end(), std::back_inserter( tracks ) );
+   std::stable_partition( tracks.begin(), tracks.end(),
+      [&]( const WaveTrack *wt ){
+         const auto &view = TrackView::Get( *wt );
+         const auto y = view.GetY();
+         return y < bottom && y + view.GetHeight() > top;
+      } );
+
+   auto pJob = std::make_unique< Job >();
+   // Blocks may be shared among the clips
+   std::unordered_set< const BlockFile* > seen;
+   for (auto wt : tracks)
+      for (const auto &pClip : wt->GetClips())
+         for (const auto &block : pClip->GetSequence()->GetBlockArray()) {
+            const auto &f = block.f;
+            // Summaries still to be computed are left to their tasks
+            if (f->IsSummaryAvailable() && !f->IsSummaryBeingComputed() &&
+                seen.insert( f.get() ).second)
+               pJob->blocks.push_back( f );
+         }
+   if (pJob->blocks.empty())
+      return;
+
+   // The work is waiting on the disk, so a few threads are enough
+   auto &job = *pJob;
+   const auto nThreads = std::min< size_t >( job.blocks.size(),
+      std::max( 2u, std::min( 4u, std::thread::hardware_concurrency() ) ) );
+   job.nRunning = nThreads;
+   for (size_t ii = 0; ii < nThreads; ++ii)
+      mThreads.emplace_back( [&job]{
+         for (size_t jj = 0;
+              !job.stopped.load() && (jj = job.next++) < job.blocks.size();)
+            // A failure keeps nothing, and drawing will try again
+            try { job.blocks[jj]->PrepareSummaries(); }
+            catch ( ... ) {}
+         --job.nRunning;
+      } );
+   mJob = std::move( pJob );
+}
+
+void SummaryPrefetcher::Process()
+{
+   if (mJob && mJob->nRunning.load() == 0)
+      Stop();
+}
+
+void SummaryPrefetcher::Stop()
+{
+   if (mJob)
+      mJob->stopped.store( true );
+   for (auto &thread : mThreads)
+      thread.join();
+   mThreads.clear();
+   // Now let go of the blocks, on the main thread
+   mJob.reset();
+}
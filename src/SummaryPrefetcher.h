@@ -0,0 +1,61 @@
+/**********************************************************************
+
+Audacity: A Digital Audio Editor
+
+SummaryPrefetcher.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SUMMARY_PREFETCHER__
+#define __AUDACITY_SUMMARY_PREFETCHER__
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ClientData.h" // to inherit
+
+class AudacityProject;
+
+///\brief Object associated with a project that reads the summaries of its
+/// blocks in the background after it opens
+///
+/// The first draw of a newly opened project reads the summaries of the
+/// blocks one at a time.  The prefetcher reads them on worker threads, those
+/// of the tracks on screen first, into what BlockFile::Read4K and
+/// BlockFile::Read64K keep in memory.
+class SummaryPrefetcher final
+   : public ClientData::Base
+{
+public:
+   static SummaryPrefetcher &Get( AudacityProject &project );
+   static const SummaryPrefetcher &Get( const AudacityProject &project );
+
+   explicit SummaryPrefetcher( AudacityProject &project );
+   SummaryPrefetcher( const SummaryPrefetcher & ) PROHIBITED;
+   SummaryPrefetcher &operator=( const SummaryPrefetcher & ) PROHIBITED;
+   ~SummaryPrefetcher() override;
+
+   /// Called when the project opens:  starts reading, if the preference is
+   /// set
+   void Start();
+
+   /// Called periodically on the main thread:  lets go of the blocks of a
+   /// finished pass
+   void Process();
+
+   /// Stop the worker threads and let go of the blocks
+   void Stop();
+
+   /// Whether the preference to prefetch summaries is set
+   static bool GetPrefetchSummaries();
+
+private:
+   struct Job;
+
+   AudacityProject &mProject;
+   std::unique_ptr< Job > mJob;
+   std::vector< std::thread > mThreads;
+};
+
+#endif
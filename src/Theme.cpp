@@ -449,20 +449,9 @@ void ThemeBase::RegisterImage( int &iIndex, const wxImage &Image, const wxString
 {
    wxASSERT( iIndex == -1 ); // Don't initialise same bitmap twice!
    mImages.push_back( Image );
-
-#ifdef __APPLE__
-   // On Mac, bitmaps with alpha don't work.
-   // So we convert to a mask and use that.
-   // It isn't quite as good, as alpha gives smoother edges.
-   //[Does not affect the large control buttons, as for those we do
-   // the blending ourselves anyway.]
-   wxImage TempImage( Image );
-   TempImage.ConvertAlphaToMask();
-   mBitmaps.push_back( wxBitmap( TempImage ) );
-#else
-   mBitmaps.push_back( wxBitmap( Image ) );
-#endif
-
+   // The bitmap is made on first use; most images are replaced from the image
+   // cache before that
+   mBitmaps.push_back( wxBitmap{} );
    mBitmapNames.push_back( Name );
    mBitmapFlags.push_back( mFlow.mFlags );
    mFlow.mFlags &= ~resFlagSkip;
@@ -1019,7 +1008,8 @@ bool ThemeBase::ReadImageCache( teThemeType type, bool bOkIfNotFound)
          wxRect R = mFlow.RectInner();
          //wxLogDebug( "[%i, %i, %i, %i, \"%s\"], ", R.x, R.y, R.width, R.height, mBitmapNames[i].c_str() );
          Image = GetSubImageWithAlpha( ImageCache, mFlow.RectInner() );
-         mBitmaps[i] = wxBitmap(Image);
+         // Make the bitmap on first use
+         mBitmaps[i] = wxBitmap{};
       }
    }
    if( !ImageCache.HasAlpha() )
@@ -1218,7 +1208,30 @@ wxBitmap & ThemeBase::Bitmap( int iIndex )
 {
    wxASSERT( iIndex >= 0 );
    EnsureInitialised();
-   return mBitmaps[iIndex];
+   auto &bitmap = mBitmaps[iIndex];
+   if( !bitmap.IsOk() )
+      bitmap = MakeBitmap( iIndex );
+   return bitmap;
+}
+
+wxBitmap ThemeBase::MakeBitmap( int iIndex ) const
+{
+   const auto &Image = mImages[iIndex];
+#ifdef __APPLE__
+   // Images not found in the image cache keep the bitmaps they were
+   // registered with
+   if( mBitmapFlags[iIndex] & resFlagInternal ) {
+      // On Mac, bitmaps with alpha don't work.
+      // So we convert to a mask and use that.
+      // It isn't quite as good, as alpha gives smoother edges.
+      //[Does not affect the large control buttons, as for those we do
+      // the blending ourselves anyway.]
+      wxImage TempImage( Image );
+      TempImage.ConvertAlphaToMask();
+      return wxBitmap( TempImage );
+   }
+#endif
+   return wxBitmap( Image );
 }
 
 wxImage  & ThemeBase::Image( int iIndex )
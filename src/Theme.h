@@ -144,8 +144,12 @@ public:
    wxImage MakeImageWithAlpha( wxBitmap & Bmp );
 
 protected:
+   // Convert the image of the given index for drawing
+   wxBitmap MakeBitmap( int iIndex ) const;
+
    // wxImage, wxBitmap copy cheaply using reference counting
    std::vector<wxImage> mImages;
+   // Not Ok until first requested
    std::vector<wxBitmap> mBitmaps;
    wxArrayString mBitmapNames;
    std::vector<int> mBitmapFlags;
@@ -125,6 +125,21 @@ Track::Holder Track::Duplicate() const
    return result;
 }
 
+Track::Holder Track::DuplicateSharing(const Track &previous) const
+{
+   auto result = CloneSharing( previous );
+
+   if (mpView)
+      mpView->CopyTo( *result );
+
+   return result;
+}
+
+Track::Holder Track::CloneSharing(const Track &) const
+{
+   return Clone();
+}
+
 Track::~Track()
 {
 }
@@ -673,13 +688,26 @@ void TrackList::Permute(const std::vector<TrackNodePointer> &permutation)
 
 Track *TrackList::FindById( TrackId id )
 {
-   // Linear search.  Tracks in a project are usually very few.
    // Search only the non-pending tracks.
-   auto it = std::find_if( ListOfTracks::begin(), ListOfTracks::end(),
-      [=](const ListOfTracks::value_type &ptr){ return ptr->GetId() == id; } );
-   if (it == ListOfTracks::end())
-      return {};
-   return it->get();
+   auto found = mIdIndex.find( id );
+   if (found != mIdIndex.end()) {
+      auto pTrack = found->second.lock();
+      if (pTrack && pTrack->GetId() == id &&
+          pTrack->mNode.second == this && pTrack->GetOwner().get() == this)
+         return pTrack.get();
+   }
+
+   // Missed, or stale:  search linearly, indexing every track on the way,
+   // so that menus and the mixer board, which look up many ids in turn,
+   // search once for all of them
+   mIdIndex.clear();
+   Track *result = nullptr;
+   for (const auto &ptr : static_cast< ListOfTracks& >( *this )) {
+      mIdIndex[ ptr->GetId() ] = ptr;
+      if (ptr->GetId() == id)
+         result = ptr.get();
+   }
+   return result;
 }
 
 Track *TrackList::DoAddToHead(const std::shared_ptr<Track> &t)
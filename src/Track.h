@@ -18,6 +18,7 @@
 #include <vector>
 #include <list>
 #include <functional>
+#include <unordered_map>
 #include <wx/longlong.h>
 
 #include "ClientData.h"
@@ -173,6 +174,12 @@ public:
    bool operator <  (const TrackId &other) const
    { return mValue <  other.mValue; }
 
+   // For keying a std::unordered_map on TrackId
+   struct Hash {
+      size_t operator () (const TrackId &id) const
+      { return std::hash<long>{}( id.mValue ); }
+   };
+
 private:
    long mValue;
 };
@@ -324,6 +331,9 @@ private:
    using Holder = std::shared_ptr<Track>;
    // public nonvirtual duplication function that invokes Clone():
    virtual Holder Duplicate() const;
+   // Like Duplicate(), but the copy may share contents that are unchanged
+   // from previous, an earlier duplicate that will never be modified
+   Holder DuplicateSharing(const Track &previous) const;
 
    // Called when this track is merged to stereo with another, and should
    // take on some paramaters of its partner.
@@ -391,6 +401,8 @@ private:
    // Subclass responsibility implements only a part of Duplicate(), copying
    // the track data proper (not associated data such as for groups and views):
    virtual Holder Clone() const = 0;
+   // Part of DuplicateSharing(); by default, shares nothing and invokes Clone()
+   virtual Holder CloneSharing(const Track &previous) const;
 
    virtual TrackKind GetKind() const { return TrackKind::None; }
 
@@ -1345,6 +1357,7 @@ public:
    /// For use in sorting:  assume each iterator points into this list, no duplications
    void Permute(const std::vector<TrackNodePointer> &permutation);
 
+   /// Tracks found are remembered, so that later lookups need not search
    Track *FindById( TrackId id );
 
    /// Add a Track, giving it a fresh id
@@ -1572,6 +1585,11 @@ private:
    ListOfTracks mPendingUpdates;
    // This is in correspondence with mPendingUpdates
    std::vector< Updater > mUpdaters;
+
+   // Index for FindById, rebuilt whenever a lookup misses.  Entries are
+   // checked on use, because tracks may since have left the list.
+   std::unordered_map< TrackId, std::weak_ptr< Track >, TrackId::Hash >
+      mIdIndex;
 };
 
 class AUDACITY_DLL_API TrackFactory final
@@ -71,6 +71,7 @@ is time to refresh some aspect of the screen.
 #include "float_cast.h"
 
 #include "Prefs.h"
+#include "Profiler.h"
 #include "RefreshCode.h"
 #include "TrackArtist.h"
 #include "TrackPanelAx.h"
@@ -88,6 +89,10 @@ is time to refresh some aspect of the screen.
 #include "../images/Cursors.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <unordered_map>
 
 #include <wx/dc.h>
 #include <wx/dcclient.h>
@@ -470,10 +475,84 @@ void TrackPanel::OnTimer(wxTimerEvent& )
          }
       }
    }
+   UpdateODDemands();
+
    if(mTimeCount > 1000)
       mTimeCount = 0;
 }
 
+namespace {
+   // How far on either side of the play head to decode first
+   const double PlayHeadDemandSeconds = 10.0;
+}
+
+void TrackPanel::UpdateODDemands()
+{
+   if (!ODManager::IsInstanceCreated())
+      return;
+
+   UpdateODViewDemands();
+   UpdateODPlayHeadDemands();
+}
+
+void TrackPanel::UpdateODPlayHeadDemands()
+{
+   auto gAudioIO = AudioIO::Get();
+   double t0 = 0, t1 = 0;
+   if (IsAudioActive()) {
+      // Each new demand makes the tasks reorder their blocks, so demand a
+      // NEW region only when the play head has gone halfway to an end
+      const auto time = gAudioIO->GetStreamTime();
+      const auto center = (mODPlayHeadDemand0 + mODPlayHeadDemand1) / 2;
+      if (mODPlayHeadDemand0 < mODPlayHeadDemand1 &&
+          fabs(time - center) < PlayHeadDemandSeconds / 2)
+         return;
+      t0 = std::max(0.0, time - PlayHeadDemandSeconds);
+      t1 = time + PlayHeadDemandSeconds;
+   }
+   else if (!(mODPlayHeadDemand0 < mODPlayHeadDemand1))
+      // Nothing to withdraw
+      return;
+
+   mODPlayHeadDemand0 = t0, mODPlayHeadDemand1 = t1;
+   for (auto wt : GetTracks()->Any< WaveTrack >())
+      ODManager::Instance()->DemandTrackRange(
+         wt, ODTask::eDemandPlayHead, t0, t1);
+}
+
+void TrackPanel::UpdateODViewDemands()
+{
+   // What is on screen, after scrolling or zooming.  Tracks scrolled out of
+   // sight demand nothing, so that their tasks wait for those of visible
+   // tracks.
+   const auto h0 = mViewInfo->h;
+   const auto h1 = mViewInfo->GetScreenEndTime();
+   const auto top = mViewInfo->vpos;
+   const auto bottom = top + GetSize().GetHeight();
+   std::vector< const WaveTrack* > visibleTracks;
+   for (auto wt : GetTracks()->Any< const WaveTrack >()) {
+      const auto &view = TrackView::Get( *wt );
+      const auto y = view.GetY();
+      if (y < bottom && y + view.GetHeight() > top)
+         visibleTracks.push_back(wt);
+   }
+
+   // Demanding takes locks that a task may hold while it reorders, so do it
+   // when the view changes, and now and then for tasks added since
+   if (h0 == mODViewDemand0 && h1 == mODViewDemand1 &&
+       visibleTracks == mODViewTracks && (mTimeCount % 10) != 0)
+      return;
+   mODViewDemand0 = h0, mODViewDemand1 = h1;
+   mODViewTracks.swap(visibleTracks);
+
+   for (auto wt : GetTracks()->Any< WaveTrack >()) {
+      const bool visible = std::find(mODViewTracks.begin(),
+         mODViewTracks.end(), wt) != mODViewTracks.end();
+      ODManager::Instance()->DemandTrackRange(
+         wt, ODTask::eDemandView, visible ? h0 : 0, visible ? h1 : 0);
+   }
+}
+
 ///Handles the redrawing necessary for tasks as they partially update in the
 ///background, or finish.
 void TrackPanel::OnODTask(wxCommandEvent & WXUNUSED(event))
@@ -505,6 +584,7 @@ void TrackPanel::OnUndoReset( wxCommandEvent &event )
 ///  completing a repaint operation.
 void TrackPanel::OnPaint(wxPaintEvent & /* event */)
 {
+   PROFILE_SCOPE("TrackPanel::OnPaint");
    mLastDrawnSelectedRegion = mViewInfo->selectedRegion;
 
 #if DEBUG_DRAW_TIMING
@@ -523,15 +603,27 @@ void TrackPanel::OnPaint(wxPaintEvent & /* event */)
       {
          // Reset (should a mutex be used???)
          mRefreshBacking = false;
+         mBackingDamage = {};
 
          // Redraw the backing bitmap
-         DrawTracks(&GetBackingDCForRepaint());
+         DrawTracks(&GetBackingDCForRepaint(), GetClientRect());
 
          // Copy it to the display
          DisplayBitmap(dc);
       }
       else
       {
+         // Redraw in the backing bitmap only the tracks that changed
+         // (See TrackPanel::RefreshTrack())
+         if (!mBackingDamage.IsEmpty()) {
+            const auto damage = mBackingDamage;
+            mBackingDamage = {};
+            auto &backingDC = GetBackingDCForRepaint();
+            backingDC.SetClippingRegion(damage);
+            DrawTracks(&backingDC, damage);
+            backingDC.DestroyClippingRegion();
+         }
+
          // Copy full, possibly clipped, damage rectangle
          RepairBitmap(dc, box.x, box.y, box.width, box.height);
       }
@@ -806,7 +898,13 @@ void TrackPanel::RefreshTrack(Track *trk, bool refreshbacking)
 
    if( refreshbacking )
    {
-      mRefreshBacking = true;
+      // Not all of the backing bitmap, as Refresh() would have it, but only
+      // the part for this track
+      rect.Intersect( GetClientRect() );
+      if ( mBackingDamage.IsEmpty() )
+         mBackingDamage = rect;
+      else if ( !rect.IsEmpty() )
+         mBackingDamage.Union( rect );
    }
 
    Refresh( false, &rect );
@@ -847,11 +945,63 @@ void TrackPanel::OnAudioIO(wxCommandEvent & evt)
 
 #include "TrackPanelDrawingContext.h"
 
+namespace {
+
+// Let the views of tracks on screen compute what they will draw, before any
+// drawing, those of different tracks on several threads.  The views of one
+// track share its caches, so they are prepared in turn.
+void PrepareTrackViews( CellularPanel &panel,
+   TrackPanelDrawingContext &context, const wxRect &area )
+{
+   const auto panelRect = panel.GetClientRect();
+   std::vector< std::vector< std::pair< TrackView*, wxRect > > > groups;
+   std::unordered_map< const Track*, size_t > groupIndices;
+   panel.VisitCells( [&]( const wxRect &rect, TrackPanelCell &cell ) {
+      const auto pView = dynamic_cast< TrackView* >( &cell );
+      if ( !pView ||
+           !rect.Intersects( panelRect ) || !rect.Intersects( area ) )
+         return;
+      const auto pTrack = pView->FindTrack();
+      if ( !pTrack )
+         return;
+      const auto result =
+         groupIndices.emplace( pTrack.get(), groups.size() );
+      if ( result.second )
+         groups.emplace_back();
+      groups[ result.first->second ].emplace_back( pView, rect );
+   } );
+
+   std::atomic< size_t > next{ 0 };
+   const auto work = [&]{
+      for ( size_t ii = 0; ( ii = next++ ) < groups.size(); ) {
+         for ( const auto &pair : groups[ ii ] ) {
+            // Draw does it again if this fails, and reports the error
+            try { pair.first->PrepareDraw( context, pair.second ); }
+            catch ( ... ) {}
+         }
+      }
+   };
+
+   const size_t nThreads = std::min< size_t >(
+      groups.size(), std::thread::hardware_concurrency() );
+   std::vector< std::thread > threads;
+   for ( size_t ii = 1; ii < nThreads; ++ii )
+      threads.emplace_back( work );
+   work();
+   for ( auto &thread : threads )
+      thread.join();
+}
+
+}
+
 /// Draw the actual track areas.  We only draw the borders
 /// and the little buttons and menues and whatnot here, the
 /// actual contents of each track are drawn by the TrackArtist.
-void TrackPanel::DrawTracks(wxDC * dc)
+void TrackPanel::DrawTracks(wxDC * dc, const wxRect &area)
 {
+   PROFILE_SCOPE("TrackPanel::DrawTracks");
+   ++mDrawCount;
+
    wxRegion region = GetUpdateRegion();
 
    const wxRect clip = GetRect();
@@ -886,7 +1036,11 @@ void TrackPanel::DrawTracks(wxDC * dc)
    mTrackArtist->drawSliders = sliderFlag;
    mTrackArtist->hasSolo = hasSolo;
 
-   this->CellularPanel::Draw( context, TrackArtist::NPasses );
+   // Compute waveform and spectrogram columns in parallel; only the drawing
+   // on the device context is left to this thread
+   PrepareTrackViews( *this, context, area );
+
+   this->CellularPanel::Draw( context, TrackArtist::NPasses, area );
 }
 
 void TrackPanel::SetBackgroundCell
@@ -102,6 +102,10 @@ class AUDACITY_DLL_API TrackPanel final
    void OnIdle(wxIdleEvent & event);
    void OnTimer(wxTimerEvent& event);
    void OnODTask(wxCommandEvent &event);
+   // Tell on-demand tasks which parts of the tracks to finish first
+   void UpdateODDemands();
+   void UpdateODViewDemands();
+   void UpdateODPlayHeadDemands();
    void OnProjectSettingsChange(wxCommandEvent &event);
    void OnTrackFocusChange( wxCommandEvent &event );
 
@@ -162,8 +166,13 @@ public:
    TrackPanelListener * GetListener(){ return mListener;}
    AdornedRulerPanel * GetRuler(){ return mRuler;}
 
+   // Counts drawings of cells into the backing bitmap, so that overlays can
+   // tell when the cells may have moved
+   unsigned GetDrawCount() const { return mDrawCount; }
+
 protected:
-   void DrawTracks(wxDC * dc);
+   // Draw only what intersects area, to which dc is clipped
+   void DrawTracks(wxDC * dc, const wxRect &area);
 
 public:
    // Set the object that performs catch-all event handling when the pointer
@@ -202,6 +211,9 @@ protected:
    int mTimeCount;
 
    bool mRefreshBacking;
+   // Where the backing bitmap must be redrawn, when not all of it
+   wxRect mBackingDamage;
+   unsigned mDrawCount{ 0 };
 
 #ifdef EXPERIMENTAL_SPECTRAL_EDITING
 
@@ -211,6 +223,12 @@ protected:
 
    bool mRedrawAfterStop;
 
+   // The regions last demanded of on-demand tasks, around the play head
+   // and on screen, and the tracks on screen
+   double mODPlayHeadDemand0{ 0 }, mODPlayHeadDemand1{ 0 };
+   double mODViewDemand0{ 0 }, mODViewDemand1{ 0 };
+   std::vector< const WaveTrack* > mODViewTracks;
+
 protected:
 
    SelectedRegion mLastDrawnSelectedRegion {};
@@ -35,8 +35,11 @@ UndoManager
 #include "NoteTrack.h"  // for Sonify* function declarations
 #include "Diags.h"
 #include "Tags.h"
+#include "blockfile/RangeBlockFile.h"
 
 
+#include <algorithm>
+#include <map>
 #include <unordered_set>
 
 wxDEFINE_EVENT(EVT_UNDO_PUSHED, wxCommandEvent);
@@ -63,6 +66,11 @@ struct UndoStackElem {
    UndoState state;
    TranslatableString description;
    TranslatableString shortDescription;
+
+   // For the space accounting of UndoManager
+   unsigned long long serial{};
+   unsigned long long usage{};
+   std::vector<ConstBlockFilePtr> blocks;
 };
 
 static const AudacityProject::AttachedObjects::RegisteredFactory key{
@@ -95,7 +103,7 @@ UndoManager::~UndoManager()
 
 namespace {
    SpaceArray::value_type
-   CalculateUsage(const TrackList &tracks, Set *seen)
+   CalculateUsage(const TrackList &tracks)
    {
       SpaceArray::value_type result = 0;
 
@@ -109,34 +117,73 @@ namespace {
             auto blocks = clip->GetSequenceBlockArray();
             for (const auto &block : *blocks)
             {
-               const auto &file = block.f;
-
-               // Accumulate space used by the file if the file was not
-               // yet seen
-               if ( !seen || (seen->count( &*file ) == 0 ) )
-               {
-                  unsigned long long usage{ file->GetSpaceUsage() };
-                  result += usage;
-               }
-
-               // Add file to current set
-               if (seen)
-                  seen->insert( &*file );
+               unsigned long long usage{ block.f->GetSpaceUsage() };
+               // A range takes the space of the block it refers to
+               if (auto pRange =
+                   dynamic_cast<const RangeBlockFile*>(&*block.f))
+                  usage = pRange->GetSource()->GetSpaceUsage();
+               result += usage;
             }
          }
       }
 
       return result;
    }
+
+   // The distinct block files used by the wave tracks
+   std::vector<ConstBlockFilePtr> CollectBlocks(const TrackList &tracks)
+   {
+      std::vector<ConstBlockFilePtr> result;
+      Set seen;
+      for (auto wt : tracks.Any< const WaveTrack >())
+      {
+         for(const auto &clip : wt->GetAllClips())
+         {
+            for (const auto &block : *clip->GetSequenceBlockArray())
+            {
+               if (seen.insert( &*block.f ).second)
+                  result.push_back( &*block.f );
+               // Ranges take no space, but keep their sources
+               if (auto pRange =
+                   dynamic_cast<const RangeBlockFile*>(&*block.f)) {
+                  const BlockFile *pSource = &*pRange->GetSource();
+                  if (seen.insert( pSource ).second)
+                     result.push_back( pSource );
+               }
+            }
+         }
+      }
+      return result;
+   }
+
+   std::shared_ptr<TrackList>
+   DuplicateTracks(const TrackList &tracks, const TrackList *pPrevious)
+   {
+      // Tracks of undo states are never modified, so the copies for a NEW
+      // state may share whatever is unchanged from those of the previous one.
+      // Ids differ between the lists, so pair the tracks by position.
+      std::vector<const Track*> previous;
+      if (pPrevious)
+         for (auto t : *pPrevious)
+            previous.push_back(t);
+
+      auto tracksCopy = TrackList::Create( nullptr );
+      size_t ii = 0;
+      for (auto t : tracks) {
+         if ( t->GetId() == TrackId{} )
+            // Don't copy a pending added track
+            continue;
+         if (ii < previous.size())
+            tracksCopy->Add(t->DuplicateSharing(*previous[ii++]));
+         else
+            tracksCopy->Add(t->Duplicate());
+      }
+      return tracksCopy;
+   }
 }
 
 void UndoManager::CalculateSpaceUsage()
 {
-   space.clear();
-   space.resize(stack.size(), 0);
-
-   Set seen;
-
    // After copies and pastes, a block file may be used in more than
    // one place in one undo history state, and it may be used in more than
    // one undo history state.  It might even be used in two states, but not
@@ -151,19 +198,136 @@ void UndoManager::CalculateSpaceUsage()
    // DELETE all states containing the block file.  So the block file's
    // contribution to space usage should be counted only in that latest state.
 
-   for (size_t nn = stack.size(); nn--;)
-   {
-      // Scan all tracks at current level
-      auto &tracks = *stack[nn]->state.tracks;
-      space[nn] = CalculateUsage(tracks, &seen);
+   // AddUsage and RemoveUsage keep those sums as states come and go.  Only
+   // blocks that used no space when first seen need another look.
+   for (auto iter = mEmptyBlocks.begin(); iter != mEmptyBlocks.end();) {
+      auto &record = mBlockUsage[ *iter ];
+      record.usage = (*iter)->GetSpaceUsage();
+      if (record.usage) {
+         FindState( record.states.back() ).usage += record.usage;
+         iter = mEmptyBlocks.erase( iter );
+      }
+      else
+         ++iter;
    }
 
-   mClipboardSpaceUsage = CalculateUsage(
-      Clipboard::Get().GetTracks(), nullptr);
+   space.clear();
+   for (const auto &elem : stack)
+      space.push_back( elem->usage );
+
+   mClipboardSpaceUsage = CalculateUsage( Clipboard::Get().GetTracks() );
 
    //TIMER_STOP( space_calc );
 }
 
+void UndoManager::AddUsage(UndoStackElem &elem)
+{
+   elem.blocks = CollectBlocks( *elem.state.tracks );
+   for (auto pBlock : elem.blocks) {
+      auto &record = mBlockUsage[ pBlock ];
+      auto &states = record.states;
+      if (states.empty()) {
+         record.usage = pBlock->GetSpaceUsage();
+         if (!record.usage)
+            mEmptyBlocks.insert( pBlock );
+      }
+
+      auto iter = std::upper_bound( states.begin(), states.end(), elem.serial );
+      if (iter == states.end()) {
+         // Now the latest state containing the block
+         if (!states.empty())
+            FindState( states.back() ).usage -= record.usage;
+         elem.usage += record.usage;
+      }
+      states.insert( iter, elem.serial );
+   }
+}
+
+void UndoManager::RemoveUsage(UndoStackElem &elem)
+{
+   for (auto pBlock : elem.blocks) {
+      auto found = mBlockUsage.find( pBlock );
+      if (found == mBlockUsage.end())
+         continue;
+      auto &record = found->second;
+      auto &states = record.states;
+
+      auto iter = std::lower_bound( states.begin(), states.end(), elem.serial );
+      if (iter == states.end() || *iter != elem.serial)
+         continue;
+      const bool latest = (iter + 1 == states.end());
+      states.erase( iter );
+
+      if (latest) {
+         // Credit the block to the next latest state, if any
+         elem.usage -= record.usage;
+         if (!states.empty())
+            FindState( states.back() ).usage += record.usage;
+      }
+      if (states.empty()) {
+         mEmptyBlocks.erase( pBlock );
+         mBlockUsage.erase( found );
+      }
+   }
+   elem.blocks.clear();
+}
+
+UndoStackElem &UndoManager::FindState(unsigned long long serial)
+{
+   // Serial numbers increase up the stack
+   auto iter = std::lower_bound( stack.begin(), stack.end(), serial,
+      [](const std::unique_ptr<UndoStackElem> &pElem, unsigned long long value)
+         { return pElem->serial < value; } );
+   wxASSERT( iter != stack.end() && (*iter)->serial == serial );
+   return **iter;
+}
+
+bool UndoManager::ReplaceBlocks(const BlockArray &original,
+   const BlockArray &consolidated, size_t maxDiskBlockSize)
+{
+   if (saved >= 0 && saved < (int)stack.size()) {
+      const auto savedSerial = stack[saved]->serial;
+      for (const auto &block : original) {
+         auto found = mBlockUsage.find( &*block.f );
+         if (found != mBlockUsage.end()) {
+            const auto &states = found->second.states;
+            if (std::binary_search( states.begin(), states.end(), savedSerial ))
+               return false;
+         }
+      }
+   }
+
+   // States may share clips, so make one replacement for each old clip.  The
+   // map keeps the old clips too, so that no address is reused meanwhile.
+   std::map< WaveClipHolder, WaveClipHolder > replacements;
+   for (const auto &pElem : stack) {
+      bool changed = false;
+      for (auto wt : pElem->state.tracks->Any< WaveTrack >()) {
+         for (auto &pClip : wt->GetClips()) {
+            auto found = replacements.find( pClip );
+            if (found == replacements.end()) {
+               if (!pClip->GetSequence()->HasBlocks( original ))
+                  continue;
+               auto pNewClip = std::make_shared< WaveClip >(
+                  *pClip, wt->GetDirManager(), true );
+               if (!pNewClip->GetSequence()->CommitConsolidated(
+                  original, BlockArray{ consolidated }, maxDiskBlockSize ))
+                  continue;
+               found = replacements.emplace( pClip, pNewClip ).first;
+            }
+            pClip = found->second;
+            changed = true;
+         }
+      }
+      if (changed) {
+         RemoveUsage( *pElem );
+         AddUsage( *pElem );
+      }
+   }
+
+   return true;
+}
+
 wxLongLong_t UndoManager::GetLongDescription(
    unsigned int n, TranslatableString *desc, wxString *size)
 {
@@ -200,6 +364,7 @@ void UndoManager::SetLongDescription(
 
 void UndoManager::RemoveStateAt(int n)
 {
+   RemoveUsage(*stack[n]);
    stack.erase(stack.begin() + n);
 }
 
@@ -231,6 +396,13 @@ unsigned int UndoManager::GetCurrentState()
    return current + 1;  // the array is 0 based, the abstraction is 1 based
 }
 
+const TrackList *UndoManager::GetCurrentTracks() const
+{
+   if (current < 0 || current >= (int)stack.size())
+      return nullptr;
+   return stack[current]->state.tracks.get();
+}
+
 bool UndoManager::UndoAvailable()
 {
    return (current > 0);
@@ -250,20 +422,14 @@ void UndoManager::ModifyState(const TrackList * l,
    }
 
    SonifyBeginModifyState();
-   // Delete current -- not necessary, but let's reclaim space early
-   stack[current]->state.tracks.reset();
-
-   // Duplicate
-   auto tracksCopy = TrackList::Create( nullptr );
-   for (auto t : *l) {
-      if ( t->GetId() == TrackId{} )
-         // Don't copy a pending added track
-         continue;
-      tracksCopy->Add(t->Duplicate());
-   }
+
+   // Duplicate, sharing what is unchanged from the state being replaced
+   auto tracksCopy = DuplicateTracks( *l, stack[current]->state.tracks.get() );
 
    // Replace
+   RemoveUsage(*stack[current]);
    stack[current]->state.tracks = std::move(tracksCopy);
+   AddUsage(*stack[current]);
    stack[current]->state.tags = tags;
 
    stack[current]->state.selectedRegion = selectedRegion;
@@ -294,13 +460,8 @@ void UndoManager::PushState(const TrackList * l,
       return;
    }
 
-   auto tracksCopy = TrackList::Create( nullptr );
-   for (auto t : *l) {
-      if ( t->GetId() == TrackId{} )
-         // Don't copy a pending added track
-         continue;
-      tracksCopy->Add(t->Duplicate());
-   }
+   auto tracksCopy = DuplicateTracks( *l,
+      current >= 0 ? stack[current]->state.tracks.get() : nullptr );
 
    mayConsolidate = true;
 
@@ -316,6 +477,8 @@ void UndoManager::PushState(const TrackList * l,
          (std::move(tracksCopy),
             longDescription, shortDescription, selectedRegion, tags)
    );
+   stack.back()->serial = mNextSerial++;
+   AddUsage(*stack.back());
 
    current++;
 
@@ -49,6 +49,8 @@
 #ifndef __AUDACITY_UNDOMANAGER__
 #define __AUDACITY_UNDOMANAGER__
 
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <wx/event.h> // to declare custom event types
 #include "ondemand/ODTaskThread.h"
@@ -73,6 +75,8 @@ wxDECLARE_EXPORTED_EVENT(AUDACITY_DLL_API, EVT_UNDO_OR_REDO, wxCommandEvent);
 wxDECLARE_EXPORTED_EVENT(AUDACITY_DLL_API, EVT_UNDO_RESET, wxCommandEvent);
 
 class AudacityProject;
+class BlockArray;
+class BlockFile;
 class Tags;
 class Track;
 class TrackList;
@@ -135,9 +139,18 @@ class AUDACITY_DLL_API UndoManager final
    void RemoveStateAt(int n);   // removes the n'th state (1 is oldest)
    unsigned int GetNumStates();
    unsigned int GetCurrentState();
+   // The tracks of the current state, which are never modified; null if none
+   const TrackList *GetCurrentTracks() const;
 
    void StopConsolidating() { mayConsolidate = false; }
 
+   // Give every state the blocks consolidated from original, where a clip
+   // has the very same blocks.  The states get NEW clips, since their
+   // tracks are not modified.  Declines, returning false, if the saved
+   // state has any of the blocks, because that would only add space.
+   bool ReplaceBlocks(const BlockArray &original,
+      const BlockArray &consolidated, size_t maxDiskBlockSize);
+
    void GetShortDescription(unsigned int n, TranslatableString *desc);
    // Return value must first be calculated by CalculateSpaceUsage():
    wxLongLong_t GetLongDescription(
@@ -189,6 +202,23 @@ class AUDACITY_DLL_API UndoManager final
    bool mODChanges;
    mutable ODLock mODChangesMutex;//mODChanges is accessed from many threads.
 
+   // Space usage is kept up to date as states come and go, so that
+   // CalculateSpaceUsage need not visit every block of every state.  Each
+   // block file is counted only in the latest state that contains it.
+   void AddUsage(UndoStackElem &elem);
+   void RemoveUsage(UndoStackElem &elem);
+   UndoStackElem &FindState(unsigned long long serial);
+
+   struct BlockUsage {
+      unsigned long long usage{};
+      // Serial numbers of the states containing the block, ascending
+      std::vector<unsigned long long> states;
+   };
+   std::unordered_map<const BlockFile*, BlockUsage> mBlockUsage;
+   // Blocks that used no space when first seen, such as on-demand blocks
+   // whose summaries were not yet computed; CalculateSpaceUsage rechecks them
+   std::unordered_set<const BlockFile*> mEmptyBlocks;
+   unsigned long long mNextSerial{ 0 };
 };
 
 #endif
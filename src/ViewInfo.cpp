@@ -251,7 +251,7 @@ bool ViewInfo::ReadXMLAttribute(const wxChar *attr, const wxChar *value)
 void ViewInfo::OnTimer(wxCommandEvent &event)
 {
    auto gAudioIO = AudioIOBase::Get();
-   mRecentStreamTime = gAudioIO->GetStreamTime();
+   mRecentStreamTime = gAudioIO->GetAudibleStreamTime();
    event.Skip();
    // Propagate the message to other listeners bound to this
    this->ProcessEvent( event );
@@ -662,17 +662,19 @@ bool VoiceKey::AboveThreshold(
    const WaveTrack & t, sampleCount start, sampleCount len)
 {
 
-   double erg=0;
-   double  sc=0;
-   double  dc=0;   //These store three statistics: energy, signchanges, and directionchanges
    int tests =0;   //Keeps track of how many statistics surpass the threshold.
    int testThreshold=0;  //Keeps track of the threshold.
 
-   //Calculate the test statistics
+   //Calculate the test statistics, all in one pass over the samples:
+   //energy, signchanges, and directionchanges
+   const auto statistics = TestStatistics(t, start, len);
+   const double erg = statistics.energy;
+   const double sc = statistics.signChanges;
+   const double dc = statistics.directionChanges;
+
    if(mUseEnergy)
       {
          testThreshold++;
-         erg = TestEnergy(t, start,len);
          tests +=(int)(erg > mThresholdEnergy);
 #if 0
          std::cout << "Energy: " << erg << " " <<mThresholdEnergy << std::endl;
@@ -682,7 +684,6 @@ bool VoiceKey::AboveThreshold(
    if(mUseSignChangesLow)
       {
          testThreshold++;
-         sc  = TestSignChanges(t,start,len);
          tests += (int)(sc < mThresholdSignChangesLower);
 #if 0
          std::cout << "SignChanges: " << sc << " " <<mThresholdSignChangesLower<< " < " << mThresholdSignChangesUpper << std::endl;
@@ -692,7 +693,6 @@ bool VoiceKey::AboveThreshold(
    if(mUseSignChangesHigh)
       {
          testThreshold++;
-         sc  = TestSignChanges(t,start,len);
          tests += (int)(sc > mThresholdSignChangesUpper);
 #if 0
          std::cout << "SignChanges: " << sc << " " <<mThresholdSignChangesLower<< " < " << mThresholdSignChangesUpper << std::endl;
@@ -704,7 +704,6 @@ bool VoiceKey::AboveThreshold(
    if(mUseDirectionChangesLow)
       {
          testThreshold++;
-         dc  = TestDirectionChanges(t,start,len);
          tests += (int)(dc < mThresholdDirectionChangesLower);
 #if 0
          std::cout << "DirectionChanges: " << dc << " " <<mThresholdDirectionChangesLower<< " < " << mThresholdDirectionChangesUpper << std::endl;
@@ -713,7 +712,6 @@ bool VoiceKey::AboveThreshold(
    if(mUseDirectionChangesHigh)
       {
          testThreshold++;
-         dc  = TestDirectionChanges(t,start,len);
          tests += (int)(dc > mThresholdDirectionChangesUpper);
 #if 0
          std::cout << "DirectionChanges: " << dc << " " <<mThresholdDirectionChangesLower<< " < " << mThresholdDirectionChangesUpper << std::endl;
@@ -796,16 +794,18 @@ void VoiceKey::CalibrateNoise(const WaveTrack & t, sampleCount start, sampleCoun
          samples++;          //Increment the number of samples we have
          const auto blocksize = limitSampleBufferSize( WindowSizeInt, samplesleft);
 
-         erg = TestEnergy(t, i, blocksize);
+         const auto statistics = TestStatistics(t, i, blocksize);
+
+         erg = statistics.energy;
          sumerg +=(double)erg;
          sumerg2 += pow((double)erg,2);
 
-         sc = TestSignChanges(t,i, blocksize);
+         sc = statistics.signChanges;
          sumsc += (double)sc;
          sumsc2 += pow((double)sc,2);
 
 
-         dc = TestDirectionChanges(t,i,blocksize);
+         dc = statistics.directionChanges;
          sumdc += (double)dc;
          sumdc2 += pow((double)dc,2);
       }
@@ -854,6 +854,61 @@ void VoiceKey::SetKeyType(bool erg, bool scLow , bool scHigh,
 }
 
 
+//This might continue over a number of blocks.
+auto VoiceKey::TestStatistics(
+   const WaveTrack & t, sampleCount start, sampleCount len) -> Statistics
+{
+   //The same sums and counts as TestEnergy, TestSignChanges and
+   //TestDirectionChanges make, from one read of each block
+   double sum = 1;
+   unsigned long signchanges = 1;
+   unsigned long directionchanges = 1;
+   int currentsign = 0;
+   float lastval = float(0);
+   int lastdirection = 1;
+
+   auto s = start;
+   auto originalLen = len;
+   const auto blockSize = limitSampleBufferSize(
+      t.GetMaxBlockSize(), len);
+   Floats buffer{ blockSize };
+
+   while(len > 0) {
+      auto block = limitSampleBufferSize ( t.GetBestBlockSize(s), len );
+
+      t.Get((samplePtr)buffer.get(), floatSample, s, block);
+
+      if (len == originalLen) {
+         //The first time through, set stuff up special.
+         currentsign = sgn(buffer[0]);
+         lastval = buffer[0];
+      }
+
+      for(decltype(block) i = 0; i < block; i++) {
+         const float value = buffer[i];
+         sum += value * value;
+         if (sgn(value) != currentsign) {
+            currentsign = sgn(value);
+            signchanges++;
+         }
+         if (sgn(value - lastval) != lastdirection) {
+            directionchanges++;
+            lastdirection = sgn(value - lastval);
+         }
+         lastval = value;
+      }
+      len -= block;
+      s += block;
+   }
+
+   const auto length = originalLen.as_double();
+   return {
+      sum / length,
+      (double)signchanges / length,
+      (double)directionchanges / length
+   };
+}
+
 //This might continue over a number of blocks.
 double VoiceKey::TestEnergy (
    const WaveTrack & t, sampleCount start, sampleCount len)
@@ -79,6 +79,16 @@ class VoiceKey {
    double mSilentWindowSize;           //Time in milliseconds of below-threshold windows required for silence
    double mSignalWindowSize;           //Time in milliseconds of above-threshold windows required for speech
 
+   // All three test statistics of a region, as the functions below
+   // find them one at a time, but reading the samples only once
+   struct Statistics {
+      double energy;
+      double signChanges;
+      double directionChanges;
+   };
+   Statistics TestStatistics(
+      const WaveTrack & t, sampleCount start, sampleCount len);
+
    double TestEnergy (const WaveTrack & t, sampleCount start,sampleCount len);
    double TestSignChanges (
       const WaveTrack & t, sampleCount start, sampleCount len);
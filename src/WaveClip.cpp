@@ -23,8 +23,14 @@
 
 #include "Experimental.h"
 
+#include <float.h>
 #include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <functional>
+#include <limits>
+#include <thread>
 #include <vector>
 #include <wx/log.h>
 
@@ -41,10 +47,6 @@
 #include "prefs/SpectrogramSettings.h"
 #include "widgets/ProgressDialog.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 class WaveCache {
 public:
    WaveCache()
@@ -95,6 +97,11 @@ public:
    std::vector<float> rms;
    std::vector<int> bl;
    int         numODPixels;
+   // Unrounded sample position from which where[] was computed
+   double      origin{ 0.0 };
+   // Columns that reach past this sample were computed before samples were
+   // appended there, and must be computed again
+   sampleCount validEnd{ std::numeric_limits<sampleCount::type>::max() };
 
    class InvalidRegion
    {
@@ -293,9 +300,25 @@ static void ComputeSpectrumUsingRealFFTf
    }
 }
 
+namespace {
+   std::atomic<unsigned long long> sPositionGeneration{ 0 };
+
+   void NotePositionChange()
+   {
+      sPositionGeneration.fetch_add(1, std::memory_order_relaxed);
+   }
+}
+
+unsigned long long WaveClip::GetPositionGeneration()
+{
+   return sPositionGeneration.load(std::memory_order_relaxed) +
+      Sequence::GetLengthGeneration();
+}
+
 WaveClip::WaveClip(const std::shared_ptr<DirManager> &projDirManager,
                    sampleFormat format, int rate, int colourIndex)
 {
+   NotePositionChange();
    mRate = rate;
    mColourIndex = colourIndex;
    mSequence = std::make_unique<Sequence>(projDirManager, format);
@@ -315,6 +338,7 @@ WaveClip::WaveClip(const WaveClip& orig,
    // current project's DirManager, because we might be copying
    // from one project to another
 
+   NotePositionChange();
    mOffset = orig.mOffset;
    mRate = orig.mRate;
    mColourIndex = orig.mColourIndex;
@@ -341,6 +365,7 @@ WaveClip::WaveClip(const WaveClip& orig,
 {
    // Copy only a range of the other WaveClip
 
+   NotePositionChange();
    mOffset = orig.mOffset;
    mRate = orig.mRate;
    mColourIndex = orig.mColourIndex;
@@ -383,6 +408,9 @@ WaveClip::WaveClip(const WaveClip& orig,
 
 WaveClip::~WaveClip()
 {
+   // So that no index mistakes a NEW clip at the same address for this one
+   NotePositionChange();
+   CacheBudget::Get().Forget(*this);
 }
 
 void WaveClip::SetOffset(double offset)
@@ -390,6 +418,7 @@ void WaveClip::SetOffset(double offset)
 {
     mOffset = offset;
     mEnvelope->SetOffset(mOffset);
+    NotePositionChange();
 }
 
 bool WaveClip::GetSamples(samplePtr buffer, sampleFormat format,
@@ -407,6 +436,71 @@ void WaveClip::SetSamples(samplePtr buffer, sampleFormat format,
 
    // use NOFAIL-GUARANTEE
    MarkChanged();
+
+   // Patch the copy for display, if it was valid and if the sequence
+   // stores the NEW samples without loss, so that the copy still agrees
+   ODLocker locker(&mDisplaySamplesMutex);
+   if (mDisplaySamplesDirty == mDirty - 1 &&
+       format <= mSequence->GetSampleFormat()) {
+      const auto cacheEnd = mDisplaySamplesStart + mDisplaySamples.size();
+      const auto from = std::max(start, mDisplaySamplesStart);
+      const auto to = std::min(start + len, cacheEnd);
+      if (from < to)
+         CopySamples(
+            buffer + (from - start).as_size_t() * SAMPLE_SIZE(format), format,
+            (samplePtr)&mDisplaySamples[
+               (from - mDisplaySamplesStart).as_size_t() ], floatSample,
+            (to - from).as_size_t());
+      mDisplaySamplesDirty = mDirty;
+   }
+}
+
+void WaveClip::ReverseSamples(sampleCount start, sampleCount len)
+// STRONG-GUARANTEE
+{
+   // use STRONG-GUARANTEE
+   mSequence->Reverse(start, len);
+
+   // use NOFAIL-GUARANTEE
+   MarkChanged();
+}
+
+bool WaveClip::TransformSamples(sampleCount start, sampleCount len,
+                                const SampleTransform &transform)
+// STRONG-GUARANTEE
+{
+   // use STRONG-GUARANTEE
+   if (!mSequence->TransformSamples(start, len, transform))
+      return false;
+
+   // use NOFAIL-GUARANTEE
+   MarkChanged();
+   return true;
+}
+
+bool WaveClip::GetDisplaySamples(
+   float *buffer, sampleCount start, size_t len) const
+{
+   ODLocker locker(&mDisplaySamplesMutex);
+   if (mDisplaySamplesDirty != mDirty ||
+       start < mDisplaySamplesStart ||
+       start + len > mDisplaySamplesStart + mDisplaySamples.size()) {
+      std::vector<float> samples(len);
+      // Suppress exceptions in this drawing operation
+      if (!GetSamples((samplePtr)samples.data(), floatSample, start, len,
+                      false)) {
+         // Don't remember a failed read
+         std::copy(samples.begin(), samples.end(), buffer);
+         return false;
+      }
+      mDisplaySamples.swap(samples);
+      mDisplaySamplesStart = start;
+      mDisplaySamplesDirty = mDirty;
+   }
+   const auto offset = (start - mDisplaySamplesStart).as_size_t();
+   std::copy(mDisplaySamples.begin() + offset,
+      mDisplaySamples.begin() + offset + len, buffer);
+   return true;
 }
 
 BlockArray* WaveClip::GetSequenceBlockArray()
@@ -491,6 +585,42 @@ void WaveClip::ClearWaveCache()
    mWaveCache = std::make_unique<WaveCache>();
 }
 
+void WaveClip::EvictCache(CacheBudget::Kind kind) const
+{
+   // Not drawn lately; it is all recomputed if it is drawn again
+   if (kind == CacheBudget::Waveforms) {
+      ODLocker locker(&mWaveCacheMutex);
+      mWaveCache = std::make_unique<WaveCache>();
+   }
+   else if (kind == CacheBudget::Spectrograms) {
+      mSpecCache = std::make_unique<SpecCache>();
+      mSpecPxCache = std::make_unique<SpecPxCache>(1);
+   }
+}
+
+void WaveClip::TouchWaveCache() const
+{
+   size_t bytes = 0;
+   {
+      ODLocker locker(&mWaveCacheMutex);
+      if (mWaveCache)
+         bytes = mWaveCache->where.capacity() * sizeof(sampleCount) +
+            mWaveCache->len * (3 * sizeof(float) + sizeof(int));
+   }
+   CacheBudget::Get().Touch(CacheBudget::Waveforms, *this, bytes);
+}
+
+void WaveClip::TouchSpecCache() const
+{
+   size_t bytes = 0;
+   if (mSpecCache)
+      bytes += mSpecCache->freq.capacity() * sizeof(float) +
+         mSpecCache->where.capacity() * sizeof(sampleCount);
+   if (mSpecPxCache)
+      bytes += mSpecPxCache->len * sizeof(float);
+   CacheBudget::Get().Touch(CacheBudget::Spectrograms, *this, bytes);
+}
+
 ///Adds an invalid region to the wavecache so it redraws that portion only.
 void WaveClip::AddInvalidRegion(sampleCount startSample, sampleCount endSample)
 {
@@ -556,6 +686,32 @@ fillWhere(std::vector<sampleCount> &where, size_t len, double bias, double corre
       where[x] = sampleCount( floor(w0 + double(x) * samplesPerPixel) );
 }
 
+// Combine columns [a, b) of a cache into one column, exactly for min and max,
+// and for rms by weighting the squares with the numbers of samples.
+// Fails if any of the columns is not yet computed.
+bool mergeColumns(const WaveCache &cache, size_t a, size_t b,
+                  float &min, float &max, float &rms, int &bl)
+{
+   float theMin = FLT_MAX, theMax = -FLT_MAX;
+   double sumsq = 0.0, count = 0.0;
+   for (auto j = a; j < b; ++j) {
+      if (cache.bl[j] < 0)
+         return false;
+      theMin = std::min(theMin, cache.min[j]);
+      theMax = std::max(theMax, cache.max[j]);
+      const double n = (cache.where[j + 1] - cache.where[j]).as_double();
+      sumsq += double(cache.rms[j]) * cache.rms[j] * n;
+      count += n;
+   }
+   if (count <= 0)
+      return false;
+   min = theMin;
+   max = theMax;
+   rms = sqrt(sumsq / count);
+   bl = cache.bl[a];
+   return true;
+}
+
 }
 
 //
@@ -567,11 +723,15 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
                                double pixelsPerSecond, bool &isLoadingOD) const
 {
    const bool allocated = (display.where != 0);
+   // Once the cache is up to date, whichever way this returns
+   auto touch = finally( [&]{ if (!allocated) TouchWaveCache(); } );
 
    const size_t numPixels = (int)display.width;
 
    size_t p0 = 0;         // least column requiring computation
    size_t p1 = numPixels; // greatest column requiring computation, plus one
+   // Ranges of columns requiring computation, if not just [p0, p1)
+   std::vector< std::pair< size_t, size_t > > runs;
 
    float *min;
    float *max;
@@ -608,7 +768,8 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
 
       if (match &&
          mWaveCache->start == t0 &&
-         mWaveCache->len >= numPixels) {
+         mWaveCache->len >= numPixels &&
+         mWaveCache->where[numPixels] <= mWaveCache->validEnd) {
          mWaveCache->LoadInvalidRegions(mSequence.get(), true);
          mWaveCache->ClearInvalidRegions();
 
@@ -622,6 +783,18 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
          return true;
       }
 
+      // When zooming out, columns of the NEW cache that begin and end at
+      // column boundaries of the old one can be merged from old columns
+      const bool zoomingOut =
+         mWaveCache &&
+         !ppsMatch &&
+         mWaveCache->len > 0 &&
+         mWaveCache->dirty == mDirty &&
+         mWaveCache->where[mWaveCache->len] <= mWaveCache->validEnd &&
+         mWaveCache->rate == mRate &&
+         mRate / mWaveCache->pps >= 1.0 &&
+         samplesPerPixel > mRate / mWaveCache->pps;
+
       std::unique_ptr<WaveCache> oldCache(std::move(mWaveCache));
 
       int oldX0 = 0;
@@ -635,11 +808,27 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
          // possibly out of bounds.
          // For what range of pixels can data be copied?
          copyBegin = std::min<size_t>(numPixels, std::max(0, -oldX0));
+         // Not past the columns still good after appending
+         size_t oldValid = oldCache->len;
+         while (oldValid > 0 &&
+                oldCache->where[oldValid] > oldCache->validEnd)
+            --oldValid;
          copyEnd = std::min<size_t>(numPixels, std::max(0,
-            (int)oldCache->len - oldX0
+            (int)oldValid - oldX0
          ));
+         copyEnd = std::max(copyEnd, copyBegin);
       }
-      if (!(copyEnd > copyBegin))
+      else if (zoomingOut) {
+         // Shift the NEW columns by less than one old column so that their
+         // boundaries fall on old boundaries, as far as possible
+         const double oldSamplesPerPixel = mRate / oldCache->pps;
+         const double guessOrigin = 0.5 + t0 * mRate;
+         const double shift = floor(0.5 +
+            (guessOrigin - oldCache->origin) / oldSamplesPerPixel);
+         correction =
+            oldCache->origin + shift * oldSamplesPerPixel - guessOrigin;
+      }
+      if (!(copyEnd > copyBegin) && !zoomingOut)
          oldCache.reset(0);
 
       mWaveCache = std::make_unique<WaveCache>(numPixels, pixelsPerSecond, mRate, t0, mDirty);
@@ -651,10 +840,17 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
 
       fillWhere(*pWhere, numPixels, 0.0, correction,
          t0, mRate, samplesPerPixel);
+      mWaveCache->origin = 0.5 + correction + t0 * mRate;
 
       // The range of pixels we must fetch from the Sequence:
       p0 = (copyBegin > 0) ? 0 : copyEnd;
       p1 = (copyEnd >= numPixels) ? copyBegin : numPixels;
+      if (copyBegin > 0 && copyEnd > copyBegin && copyEnd < numPixels) {
+         // Scrolled, and the old cache was also appended to:  compute the
+         // columns on both sides of those copied
+         runs.emplace_back(0, copyBegin);
+         runs.emplace_back(copyEnd, numPixels);
+      }
 
       // Optimization: if the old cache is good and overlaps
       // with the current one, re-use as much of the cache as
@@ -677,94 +873,129 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
          memcpy(&rms[copyBegin], &oldCache->rms[srcIdx], sizeFloats);
          memcpy(&bl[copyBegin], &oldCache->bl[srcIdx], length * sizeof(int));
       }
+
+      if (oldCache && zoomingOut) {
+         const auto &where = *pWhere;
+         const auto oldBegin = oldCache->where.begin();
+         const auto oldEnd = oldBegin + oldCache->len + 1;
+         auto pa = oldBegin;
+         size_t runStart = 0;
+         bool inRun = false;
+         for (size_t x = 0; x < numPixels; ++x) {
+            bool merged = false;
+            pa = std::lower_bound(pa, oldEnd, where[x]);
+            if (pa != oldEnd && *pa == where[x]) {
+               const auto pb = std::lower_bound(pa, oldEnd, where[x + 1]);
+               if (pb != oldEnd && *pb == where[x + 1] && pb > pa)
+                  merged = mergeColumns(*oldCache,
+                     pa - oldBegin, pb - oldBegin,
+                     min[x], max[x], rms[x], bl[x]);
+            }
+            if (!merged && !inRun)
+               runStart = x, inRun = true;
+            else if (merged && inRun) {
+               runs.emplace_back(runStart, x);
+               inRun = false;
+            }
+         }
+         if (inRun)
+            runs.emplace_back(runStart, numPixels);
+         p0 = p1 = 0;
+      }
    }
 
-   if (p1 > p0) {
-      // Cache was not used or did not satisfy the whole request
-      std::vector<sampleCount> &where = *pWhere;
+   if (runs.empty())
+      runs.emplace_back(p0, p1);
 
-      /* handle values in the append buffer */
+   for (const auto &run : runs) {
+      p0 = run.first, p1 = run.second;
+      if (p1 > p0) {
+         // Cache was not used or did not satisfy the whole request
+         std::vector<sampleCount> &where = *pWhere;
 
-      auto numSamples = mSequence->GetNumSamples();
-      auto a = p0;
+         /* handle values in the append buffer */
 
-      // Not all of the required columns might be in the sequence.
-      // Some might be in the append buffer.
-      for (; a < p1; ++a) {
-         if (where[a + 1] > numSamples)
-            break;
-      }
+         auto numSamples = mSequence->GetNumSamples();
+         auto a = p0;
 
-      // Handle the columns that land in the append buffer.
-      //compute the values that are outside the overlap from scratch.
-      if (a < p1) {
-         sampleFormat seqFormat = mSequence->GetSampleFormat();
-         bool didUpdate = false;
-         for(auto i = a; i < p1; i++) {
-            auto left = std::max(sampleCount{ 0 },
-                                 where[i] - numSamples);
-            auto right = std::min(sampleCount{ mAppendBufferLen },
-                                  where[i + 1] - numSamples);
-
-            //wxCriticalSectionLocker locker(mAppendCriticalSection);
-
-            if (right > left) {
-               Floats b;
-               float *pb{};
-               // left is nonnegative and at most mAppendBufferLen:
-               auto sLeft = left.as_size_t();
-               // The difference is at most mAppendBufferLen:
-               size_t len = ( right - left ).as_size_t();
-
-               if (seqFormat == floatSample)
-                  pb = &((float *)mAppendBuffer.ptr())[sLeft];
-               else {
-                  b.reinit(len);
-                  pb = b.get();
-                  CopySamples(mAppendBuffer.ptr() + sLeft * SAMPLE_SIZE(seqFormat),
-                              seqFormat,
-                              (samplePtr)pb, floatSample, len);
-               }
+         // Not all of the required columns might be in the sequence.
+         // Some might be in the append buffer.
+         for (; a < p1; ++a) {
+            if (where[a + 1] > numSamples)
+               break;
+         }
 
-               float theMax, theMin, sumsq;
-               {
-                  const float val = pb[0];
-                  theMax = theMin = val;
-                  sumsq = val * val;
-               }
-               for(decltype(len) j = 1; j < len; j++) {
-                  const float val = pb[j];
-                  theMax = std::max(theMax, val);
-                  theMin = std::min(theMin, val);
-                  sumsq += val * val;
+         // Handle the columns that land in the append buffer.
+         //compute the values that are outside the overlap from scratch.
+         if (a < p1) {
+            sampleFormat seqFormat = mSequence->GetSampleFormat();
+            bool didUpdate = false;
+            for(auto i = a; i < p1; i++) {
+               auto left = std::max(sampleCount{ 0 },
+                                    where[i] - numSamples);
+               auto right = std::min(sampleCount{ mAppendBufferLen },
+                                     where[i + 1] - numSamples);
+
+               //wxCriticalSectionLocker locker(mAppendCriticalSection);
+
+               if (right > left) {
+                  Floats b;
+                  float *pb{};
+                  // left is nonnegative and at most mAppendBufferLen:
+                  auto sLeft = left.as_size_t();
+                  // The difference is at most mAppendBufferLen:
+                  size_t len = ( right - left ).as_size_t();
+
+                  if (seqFormat == floatSample)
+                     pb = &((float *)mAppendBuffer.ptr())[sLeft];
+                  else {
+                     b.reinit(len);
+                     pb = b.get();
+                     CopySamples(mAppendBuffer.ptr() + sLeft * SAMPLE_SIZE(seqFormat),
+                                 seqFormat,
+                                 (samplePtr)pb, floatSample, len);
+                  }
+
+                  float theMax, theMin, sumsq;
+                  {
+                     const float val = pb[0];
+                     theMax = theMin = val;
+                     sumsq = val * val;
+                  }
+                  for(decltype(len) j = 1; j < len; j++) {
+                     const float val = pb[j];
+                     theMax = std::max(theMax, val);
+                     theMin = std::min(theMin, val);
+                     sumsq += val * val;
+                  }
+
+                  min[i] = theMin;
+                  max[i] = theMax;
+                  rms[i] = (float)sqrt(sumsq / len);
+                  bl[i] = 1; //for now just fake it.
+
+                  didUpdate=true;
                }
-
-               min[i] = theMin;
-               max[i] = theMax;
-               rms[i] = (float)sqrt(sumsq / len);
-               bl[i] = 1; //for now just fake it.
-
-               didUpdate=true;
             }
-         }
 
-         // Shrink the right end of the range to fetch from Sequence
-         if(didUpdate)
-            p1 = a;
-      }
+            // Shrink the right end of the range to fetch from Sequence
+            if(didUpdate)
+               p1 = a;
+         }
 
-      // Done with append buffer, now fetch the rest of the cache miss
-      // from the sequence
-      if (p1 > p0) {
-         if (!mSequence->GetWaveDisplay(&min[p0],
-                                        &max[p0],
-                                        &rms[p0],
-                                        &bl[p0],
-                                        p1-p0,
-                                        &where[p0]))
-         {
-            isLoadingOD=false;
-            return false;
+         // Done with append buffer, now fetch the rest of the cache miss
+         // from the sequence
+         if (p1 > p0) {
+            if (!mSequence->GetWaveDisplay(&min[p0],
+                                           &max[p0],
+                                           &rms[p0],
+                                           &bl[p0],
+                                           p1-p0,
+                                           &where[p0]))
+            {
+               isLoadingOD=false;
+               return false;
+            }
          }
       }
    }
@@ -811,6 +1042,126 @@ void ComputeSpectrogramGainFactors
    }
 }
 
+
+// Fill those columns of [lower, upper) that can be taken from the spectral
+// summaries of the blocks of the sequence, and mark them in stored
+void ReadStoredSpectra(
+   const Sequence &sequence, const SpectrogramSettings &settings,
+   const std::vector<sampleCount> &where, sampleCount numSamples,
+   int lower, int upper, const std::vector<float> &gainFactors,
+   float *freq, std::vector<char> &stored)
+{
+   const auto windowSize = settings.WindowSize();
+   const auto nBins = settings.NBins();
+   const auto &blocks = sequence.GetBlockArray();
+   std::vector<float> frames;
+
+   for (int xx = lower; xx < upper;) {
+      if (where[xx] < 0 || where[xx] >= numSamples) {
+         ++xx;
+         continue;
+      }
+
+      // Columns in the same block are read together
+      const auto &block = blocks[sequence.FindBlock(where[xx])];
+      const auto blockEnd = block.start + block.f->GetLength();
+      int last = xx + 1;
+      while (last < upper && where[last] < blockEnd)
+         ++last;
+
+      const auto frameOf = [&](int column){
+         return (where[column] - block.start).as_size_t() / windowSize;
+      };
+      const auto first = frameOf(xx);
+      const auto nFrames = frameOf(last - 1) + 1 - first;
+
+      // Read the run of frames at once, unless columns are so sparse
+      // that most of it would be skipped
+      const bool together = nFrames <= 2 * size_t(last - xx);
+      frames.resize(nBins * (together ? nFrames : 1));
+      if (together && !block.f->ReadSpectralFrames(
+            windowSize, settings.windowType, first, nFrames, &frames[0])) {
+         xx = last;
+         continue;
+      }
+
+      for (; xx < last; ++xx) {
+         const float *results = &frames[0];
+         if (together)
+            results += nBins * (frameOf(xx) - first);
+         else if (!block.f->ReadSpectralFrames(
+               windowSize, settings.windowType, frameOf(xx), 1, &frames[0])) {
+            xx = last;
+            break;
+         }
+
+         float *const out = freq + nBins * xx;
+         std::copy(results, results + nBins, out);
+         if (!gainFactors.empty()) {
+            // Apply a frequency-dependant gain factor
+            for (size_t ii = 0; ii < nBins; ++ii)
+               out[ii] += gainFactors[ii];
+         }
+         stored[xx] = 1;
+      }
+   }
+}
+
+// Whether Populate takes the columns that it can from spectral summaries
+bool MayReadStoredSpectra(const SpectrogramSettings &settings,
+   double rate, double pixelsPerSecond)
+{
+   return settings.algorithm == SpectrogramSettings::algSTFT &&
+      settings.ZeroPaddingFactor() == 1 &&
+      rate / pixelsPerSecond >= settings.WindowSize();
+}
+
+// Fewer columns than this are not worth starting a thread for
+enum : int { MinColumnsPerThread = 32 };
+
+unsigned CountSpectrumThreads(int nColumns)
+{
+   const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+   const unsigned useful =
+      std::max(1, nColumns / MinColumnsPerThread);
+   return std::min(cores, useful);
+}
+
+// Call fn(begin, end, iThread) for contiguous chunks of [lower, upper),
+// chunk 0 on the calling thread and the rest on their own threads.
+// Exceptions escaping fn are rethrown after all chunks finish.
+template< typename Function >
+void ForEachColumnChunk(
+   int lower, int upper, unsigned nThreads, const Function &fn)
+{
+   const int nColumns = upper - lower;
+   if (nColumns <= 0)
+      return;
+   nThreads = std::max(1u, std::min(nThreads, unsigned(nColumns)));
+
+   const auto chunkBegin = [&](unsigned ii){
+      return lower + int((long long)nColumns * ii / nThreads);
+   };
+
+   std::vector<std::thread> threads;
+   std::vector<std::exception_ptr> errors(nThreads);
+   threads.reserve(nThreads - 1);
+   for (unsigned ii = 1; ii < nThreads; ++ii)
+      threads.emplace_back([&, ii]{
+         try { fn(chunkBegin(ii), chunkBegin(ii + 1), ii); }
+         catch (...) { errors[ii] = std::current_exception(); }
+      });
+
+   try { fn(chunkBegin(0), chunkBegin(1), 0u); }
+   catch (...) { errors[0] = std::current_exception(); }
+
+   for (auto &thread : threads)
+      thread.join();
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+}
+
 }
 
 bool SpecCache::Matches
@@ -826,6 +1177,13 @@ bool SpecCache::Matches
 
    return
       ppsMatch &&
+      MatchesExceptZoom(dirty_, settings);
+}
+
+bool SpecCache::MatchesExceptZoom
+   (int dirty_, const SpectrogramSettings &settings) const
+{
+   return
       dirty == dirty_ &&
       windowType == settings.windowType &&
       windowSize == settings.WindowSize() &&
@@ -937,10 +1295,10 @@ bool SpecCache::CalculateOneSpectrum
          // not reassignment, xx is surely within bounds.
          wxASSERT(xx >= 0);
          float *const results = &out[nBins * xx];
-         // This function does not mutate useBuffer
-         ComputeSpectrum(useBuffer, windowSizeSetting, windowSizeSetting,
-            rate, results,
-            autocorrelation, settings.windowType);
+         // This function does not mutate useBuffer, and has the scratch
+         // after the frame to itself
+         ComputeEnhancedAutocorrelation(useBuffer, windowSizeSetting,
+            results, scratch + fftLen, settings.windowType);
       }
       else if (reassignment) {
          static const double epsilon = 1e-16;
@@ -1023,12 +1381,6 @@ bool SpecCache::CalculateOneSpectrum
 
                   // This is non-negative, because bin and correctedX are
                   auto ind = (int)nBins * correctedX + bin;
-#ifdef _OPENMP
-                  // This assignment can race if index reaches into another thread's bins.
-                  // The probability of a race very low, so this carries little overhead,
-                  // about 5% slower vs allowing it to race.
-                  #pragma omp atomic update
-#endif
                   out[ind] += power;
                }
             }
@@ -1084,8 +1436,9 @@ void SpecCache::Grow(size_t len_, const SpectrogramSettings& settings,
 void SpecCache::Populate
    (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
     int copyBegin, int copyEnd, size_t numPixels,
-    sampleCount numSamples,
-    double offset, double rate, double pixelsPerSecond)
+    const Sequence &sequence, sampleCount numSamples,
+    double offset, double rate, double pixelsPerSecond,
+    const std::vector<char> *pFilled)
 {
    const int &frequencyGainSetting = settings.frequencyGain;
    const size_t windowSizeSetting = settings.WindowSize();
@@ -1105,56 +1458,98 @@ void SpecCache::Populate
    const auto nBins = settings.NBins();
 
    const size_t bufferSize = fftLen;
-   const size_t scratchSize = reassignment ? 3 * bufferSize : bufferSize;
+   const size_t scratchSize = reassignment ? 3 * bufferSize
+      : autocorrelation ? bufferSize + 3 * windowSizeSetting
+      : bufferSize;
    std::vector<float> scratch(scratchSize);
 
    std::vector<float> gainFactors;
    if (!autocorrelation)
       ComputeSpectrogramGainFactors(fftLen, rate, frequencyGainSetting, gainFactors);
 
+   // When zoomed out so far that the windows of columns do not overlap,
+   // plain spectrograms may take columns from spectral summaries stored
+   // with the blocks.  Columns the caller filled are skipped as these are.
+   std::vector<char> stored;
+   if (pFilled)
+      stored = *pFilled;
+   if (MayReadStoredSpectra(settings, rate, pixelsPerSecond)) {
+      stored.resize(numPixels);
+      ReadStoredSpectra(sequence, settings, where, numSamples,
+         0, copyBegin, gainFactors, &freq[0], stored);
+      ReadStoredSpectra(sequence, settings, where, numSamples,
+         copyEnd, numPixels, gainFactors, &freq[0], stored);
+   }
+   const auto isStored = [&](int xx){
+      return !stored.empty() && stored[xx];
+   };
+
    // Loop over the ranges before and after the copied portion and compute anew.
    // One of the ranges may be empty.
    for (int jj = 0; jj < 2; ++jj) {
       const int lowerBoundX = jj == 0 ? 0 : copyEnd;
       const int upperBoundX = jj == 0 ? copyBegin : numPixels;
+      if (upperBoundX <= lowerBoundX)
+         continue;
 
-#ifdef _OPENMP
-      // Storage for mutable per-thread data.
-      // private clause ensures one copy per thread
-      struct ThreadLocalStorage {
-         ThreadLocalStorage()  { }
-         ~ThreadLocalStorage() { }
-
-         void init(WaveTrackCache &waveTrackCache, size_t scratchSize) {
-            if (!cache) {
-               cache = std::make_unique<WaveTrackCache>(waveTrackCache.GetTrack());
-               scratch.resize(scratchSize);
-            }
-         }
-         std::unique_ptr<WaveTrackCache> cache;
-         std::vector<float> scratch;
-      } tls;
-
-      #pragma omp parallel for private(tls)
-#endif
-      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
-      {
-#ifdef _OPENMP
-         tls.init(waveTrackCache, scratchSize);
-         WaveTrackCache& cache = *tls.cache;
-         float* buffer = &tls.scratch[0];
-#else
-         WaveTrackCache& cache = waveTrackCache;
-         float* buffer = &scratch[0];
-#endif
+      // Compute the first column here, which also makes sure the shared
+      // FFT tables are initialized before other threads use them
+      if (!isStored(lowerBoundX))
          CalculateOneSpectrum(
-            settings, cache, xx, numSamples,
+            settings, waveTrackCache, lowerBoundX, numSamples,
             offset, rate, pixelsPerSecond,
             lowerBoundX, upperBoundX,
-            gainFactors, buffer, &freq[0]);
+            gainFactors, &scratch[0], &freq[0]);
+
+      // Columns are independent, so the rest are split into contiguous
+      // chunks computed on several threads, each with its own sample
+      // cache and FFT scratch.  Time reassignment may add power into any
+      // column of the range, so each extra thread then accumulates into
+      // its own array, summed afterwards.
+      auto nThreads = CountSpectrumThreads(upperBoundX - lowerBoundX - 1);
+      const size_t outSize = nBins * (size_t)upperBoundX;
+      if (reassignment) {
+         // Bound the extra memory to about 64 MB
+         const size_t maxExtra = (64 << 20) / sizeof(float) / outSize;
+         nThreads = unsigned(std::min<size_t>(nThreads, 1 + maxExtra));
       }
+      std::vector< std::vector<float> > extraOut(
+         reassignment ? nThreads - 1 : 0);
+
+      ForEachColumnChunk(lowerBoundX + 1, upperBoundX, nThreads,
+         [&](int begin, int end, unsigned iThread)
+      {
+         Optional<WaveTrackCache> ownCache;
+         std::vector<float> ownScratch;
+         WaveTrackCache *pCache = &waveTrackCache;
+         float *buffer = &scratch[0];
+         float *out = &freq[0];
+         if (iThread > 0) {
+            pCache = &ownCache.emplace(waveTrackCache.GetTrack());
+            ownScratch.resize(scratchSize);
+            buffer = &ownScratch[0];
+            if (reassignment) {
+               auto &accum = extraOut[iThread - 1];
+               accum.resize(outSize);
+               out = &accum[0];
+            }
+         }
+
+         for (auto xx = begin; xx < end; ++xx)
+            if (!isStored(xx))
+               CalculateOneSpectrum(
+                  settings, *pCache, xx, numSamples,
+                  offset, rate, pixelsPerSecond,
+                  lowerBoundX, upperBoundX,
+                  gainFactors, buffer, out);
+      });
 
       if (reassignment) {
+         for (const auto &accum : extraOut) {
+            for (size_t ii = nBins * lowerBoundX; ii < outSize; ++ii)
+               freq[ii] += accum[ii];
+         }
+
          // Need to look beyond the edges of the range to accumulate more
          // time reassignments.
          // I'm not sure what's a good stopping criterion?
@@ -1188,24 +1583,26 @@ void SpecCache::Populate
 
          // Now Convert to dB terms.  Do this only after accumulating
          // power values, which may cross columns with the time correction.
-#ifdef _OPENMP
-         #pragma omp parallel for
-#endif
-         for (xx = lowerBoundX; xx < upperBoundX; ++xx) {
-            float *const results = &freq[nBins * xx];
-            for (size_t ii = 0; ii < nBins; ++ii) {
-               float &power = results[ii];
-               if (power <= 0)
-                  power = -160.0;
-               else
-                  power = 10.0*log10f(power);
-            }
-            if (!gainFactors.empty()) {
-               // Apply a frequency-dependant gain factor
-               for (size_t ii = 0; ii < nBins; ++ii)
-                  results[ii] += gainFactors[ii];
+         ForEachColumnChunk(lowerBoundX, upperBoundX,
+            CountSpectrumThreads(upperBoundX - lowerBoundX),
+            [&](int begin, int end, unsigned)
+         {
+            for (auto xx = begin; xx < end; ++xx) {
+               float *const results = &freq[nBins * xx];
+               for (size_t ii = 0; ii < nBins; ++ii) {
+                  float &power = results[ii];
+                  if (power <= 0)
+                     power = -160.0;
+                  else
+                     power = 10.0*log10f(power);
+               }
+               if (!gainFactors.empty()) {
+                  // Apply a frequency-dependant gain factor
+                  for (size_t ii = 0; ii < nBins; ++ii)
+                     results[ii] += gainFactors[ii];
+               }
             }
-         }
+         });
       }
    }
 }
@@ -1216,6 +1613,8 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
                               size_t numPixels,
                               double t0, double pixelsPerSecond) const
 {
+   // Once the cache is up to date, whichever way this returns
+   auto touch = finally( [this]{ TouchSpecCache(); } );
    const WaveTrack *const track = waveTrackCache.GetTrack().get();
    const SpectrogramSettings &settings = track->GetSpectrogramSettings();
 
@@ -1239,6 +1638,59 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
    if (settings.algorithm == SpectrogramSettings::algReassignment)
       match = false;
 
+   const double tstep = 1.0 / pixelsPerSecond;
+   const double samplesPerPixel = mRate * tstep;
+
+   // After a zoom, the columns of the old cache that are within half a
+   // pixel of where new ones are can stand for them, so that only the
+   // columns between them are computed.  Not if any came from, or would
+   // come from, spectral summaries, which are coarser.
+   if (!match && mSpecCache &&
+       mSpecCache->len > 0 &&
+       settings.algorithm != SpectrogramSettings::algReassignment &&
+       mSpecCache->MatchesExceptZoom(mDirty, settings) &&
+       !MayReadStoredSpectra(settings, mRate, mSpecCache->pps) &&
+       !MayReadStoredSpectra(settings, mRate, pixelsPerSecond)) {
+      auto oldCache = std::move(mSpecCache);
+      mSpecCache = std::make_unique<SpecCache>();
+      mSpecCache->Grow(numPixels, settings, pixelsPerSecond, t0);
+      fillWhere(mSpecCache->where, numPixels, 0.5, 0.0,
+         t0, mRate, samplesPerPixel);
+
+      const auto nBins = settings.NBins();
+      const double tolerance =
+         0.5 * std::min(samplesPerPixel, mRate / oldCache->pps);
+      const auto oldBegin = oldCache->where.begin();
+      const auto oldEnd = oldBegin + oldCache->len;
+      std::vector<char> filled(numPixels);
+      for (size_t xx = 0; xx < numPixels; ++xx) {
+         const auto position = mSpecCache->where[xx];
+         // The nearest old column
+         auto iter = std::lower_bound(oldBegin, oldEnd, position);
+         if (iter == oldEnd ||
+             (iter != oldBegin &&
+              (position - *(iter - 1)) < (*iter - position)))
+            --iter;
+         const auto distance = (*iter - position).as_double();
+         if (fabs(distance) <= tolerance) {
+            const auto src = &oldCache->freq[nBins * (iter - oldBegin)];
+            std::copy(src, src + nBins, &mSpecCache->freq[nBins * xx]);
+            filled[xx] = 1;
+         }
+      }
+
+      mSpecCache->Populate
+         (settings, waveTrackCache, 0, 0, numPixels,
+          *mSequence, mSequence->GetNumSamples(),
+          mOffset, mRate, pixelsPerSecond, &filled);
+
+      mSpecCache->dirty = mDirty;
+      spectrogram = &mSpecCache->freq[0];
+      where = &mSpecCache->where[0];
+
+      return true;
+   }
+
    // Free the cache when it won't cause a major stutter.
    // If the window size changed, we know there is nothing to be copied
    // If we zoomed out, or resized, we can give up memory. But not too much -
@@ -1251,9 +1703,6 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
       mSpecCache = std::make_unique<SpecCache>();
    }
 
-   const double tstep = 1.0 / pixelsPerSecond;
-   const double samplesPerPixel = mRate * tstep;
-
    int oldX0 = 0;
    double correction = 0.0;
 
@@ -1311,7 +1760,7 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
 
    mSpecCache->Populate
       (settings, waveTrackCache, copyBegin, copyEnd, numPixels,
-       mSequence->GetNumSamples(),
+       *mSequence, mSequence->GetNumSamples(),
        mOffset, mRate, pixelsPerSecond);
 
    mSpecCache->dirty = mDirty;
@@ -1422,10 +1871,11 @@ void WaveClip::Append(samplePtr buffer, sampleFormat format,
    if (!mAppendBuffer.ptr())
       mAppendBuffer.Allocate(maxBlockSize, seqFormat);
 
+   const auto oldLen = mSequence->GetNumSamples() + mAppendBufferLen;
    auto cleanup = finally( [&] {
       // use NOFAIL-GUARANTEE
       UpdateEnvelopeTrackLen();
-      MarkChanged();
+      MarkAppended(oldLen);
    } );
 
    for(;;) {
@@ -1446,6 +1896,21 @@ void WaveClip::Append(samplePtr buffer, sampleFormat format,
       if (len == 0)
          break;
 
+      if (mAppendBufferLen == 0 && stride == 1 && len >= blockSize) {
+         // Nothing is staged, and the input fills whole blocks:  give them
+         // to the sequence directly, without copying into the append buffer
+         // use STRONG-GUARANTEE
+         const auto bulkLen = blockSize +
+            (len - blockSize) / maxBlockSize * maxBlockSize;
+         mSequence->Append(buffer, format, bulkLen, blockFileLog);
+
+         // use NOFAIL-GUARANTEE for rest of this "if"
+         buffer += bulkLen * SAMPLE_SIZE(format);
+         len -= bulkLen;
+         blockSize = mSequence->GetIdealAppendLen();
+         continue;
+      }
+
       // use NOFAIL-GUARANTEE for rest of this "for"
       wxASSERT(mAppendBufferLen <= maxBlockSize);
       auto toCopy = std::min(len, maxBlockSize - mAppendBufferLen);
@@ -1474,6 +1939,19 @@ void WaveClip::AppendBlockFile( const BlockFileFactory &factory, size_t len)
    MarkChanged();
 }
 
+void WaveClip::MarkAppended(sampleCount oldLen)
+{
+   // The samples before oldLen are unchanged, so the columns of the wave
+   // cache before them stay good, and recording redraws only the rest
+   ODLocker locker(&mWaveCacheMutex);
+   const bool keep = mWaveCache && mWaveCache->dirty == mDirty;
+   MarkChanged();
+   if (keep) {
+      mWaveCache->dirty = mDirty;
+      mWaveCache->validEnd = std::min(mWaveCache->validEnd, oldLen);
+   }
+}
+
 void WaveClip::Flush()
 // NOFAIL-GUARANTEE that the clip will be in a flushed state.
 // PARTIAL-GUARANTEE in case of exceptions:
@@ -1491,9 +1969,12 @@ void WaveClip::Flush()
          // data but don't leave the track in an un-flushed state.
 
          // Use NOFAIL-GUARANTEE of these steps.
+         // Flushing moves the samples of the append buffer into the
+         // sequence and changes none, unless it fails and drops them
+         const auto oldLen = mSequence->GetNumSamples();
          mAppendBufferLen = 0;
          UpdateEnvelopeTrackLen();
-         MarkChanged();
+         MarkAppended(oldLen);
       } );
 
       mSequence->Append(mAppendBuffer.ptr(), mSequence->GetSampleFormat(),
@@ -1636,6 +2117,41 @@ void WaveClip::Paste(double t0, const WaveClip* other)
       mCutLines.push_back(std::move(holder));
 }
 
+void WaveClip::Repeat(size_t count)
+// STRONG-GUARANTEE
+{
+   if (count == 0)
+      return;
+
+   const double len = mSequence->GetNumSamples().as_double();
+
+   // Copy what is repeated before changing anything
+   Envelope pattern{ *mEnvelope };
+   pattern.SetOffset(0);
+   WaveClipHolders newCutlines;
+   for (size_t ii = 1; ii <= count; ++ii)
+      for (const auto &cutline: mCutLines)
+      {
+         newCutlines.push_back(
+            std::make_unique<WaveClip>
+               ( *cutline, mSequence->GetDirManager(), true));
+         newCutlines.back()->Offset(ii * len / mRate);
+      }
+
+   // Assume STRONG-GUARANTEE from Sequence::Repeat
+   mSequence->Repeat(count);
+
+   // Assume NOFAIL-GUARANTEE in the remaining
+   MarkChanged();
+   auto sampleTime = 1.0 / GetRate();
+   for (size_t ii = 1; ii <= count; ++ii)
+      mEnvelope->PasteEnvelope
+         (ii * len / mRate + mOffset, &pattern, sampleTime);
+
+   for (auto &holder : newCutlines)
+      mCutLines.push_back(std::move(holder));
+}
+
 void WaveClip::InsertSilence( double t, double len, double *pEnvelopeValue )
 // STRONG-GUARANTEE
 {
@@ -1869,6 +2385,23 @@ void WaveClip::OffsetCutLines(double t0, double len)
    }
 }
 
+bool WaveClip::IsIdenticalTo(const WaveClip &other) const
+{
+   if (mOffset != other.mOffset ||
+       mRate != other.mRate ||
+       mColourIndex != other.mColourIndex ||
+       mIsPlaceholder != other.mIsPlaceholder ||
+       mCutLines.size() != other.mCutLines.size() ||
+       !mSequence->HasSameBlocks( *other.mSequence ) ||
+       !mEnvelope->IsIdenticalTo( *other.mEnvelope ))
+      return false;
+
+   return std::equal( mCutLines.begin(), mCutLines.end(),
+      other.mCutLines.begin(),
+      [](const WaveClipHolder &a, const WaveClipHolder &b){
+         return a->IsIdenticalTo( *b ); } );
+}
+
 void WaveClip::Lock()
 {
    GetSequence()->Lock();
@@ -1893,6 +2426,7 @@ void WaveClip::Unlock()
 void WaveClip::SetRate(int rate)
 {
    mRate = rate;
+   NotePositionChange();
    auto newLength = mSequence->GetNumSamples().as_double() / mRate;
    mEnvelope->RescaleTimes( newLength );
    MarkChanged();
@@ -1910,6 +2444,24 @@ void WaveClip::Resample(int rate, ProgressDialog *progress)
    double factor = (double)rate / (double)mRate;
    ::Resample resample(true, factor, factor); // constant rate resampling
 
+   auto numSamples = mSequence->GetNumSamples();
+   auto newSequence = ResampleSequence(rate, resample,
+      [&](sampleCount pos) {
+         return !progress ||
+            progress->Update(
+               pos.as_long_long(),
+               numSamples.as_long_long()
+            ) == ProgressResult::Success;
+      });
+
+   CommitResample(rate, std::move(newSequence));
+}
+
+std::unique_ptr<Sequence> WaveClip::ResampleSequence(int rate,
+   ::Resample &resample, const std::function<bool(sampleCount)> &report) const
+{
+   double factor = (double)rate / (double)mRate;
+
    const size_t bufsize = 65536;
    Floats inBuffer{ bufsize };
    Floats outBuffer{ bufsize };
@@ -1953,34 +2505,31 @@ void WaveClip::Resample(int rate, ProgressDialog *progress)
       newSequence->Append((samplePtr)outBuffer.get(), floatSample,
                           outGenerated);
 
-      if (progress)
-      {
-         auto updateResult = progress->Update(
-            pos.as_long_long(),
-            numSamples.as_long_long()
-         );
-         error = (updateResult != ProgressResult::Success);
-         if (error)
-            throw UserException{};
-      }
+      if (report && !report(pos))
+         throw UserException{};
    }
 
    if (error)
       throw SimpleMessageBoxException{
          XO("Resampling failed.")
       };
-   else
-   {
-      // Use NOFAIL-GUARANTEE in these steps
 
-      // Invalidate wave display cache
-      mWaveCache = std::make_unique<WaveCache>();
-      // Invalidate the spectrum display cache
-      mSpecCache = std::make_unique<SpecCache>();
+   return newSequence;
+}
 
-      mSequence = std::move(newSequence);
-      mRate = rate;
-   }
+void WaveClip::CommitResample(
+   int rate, std::unique_ptr<Sequence> &&sequence)
+// NOFAIL-GUARANTEE
+{
+   // Invalidate wave display cache
+   mWaveCache = std::make_unique<WaveCache>();
+   // Invalidate the spectrum display cache
+   mSpecCache = std::make_unique<SpecCache>();
+
+   mSequence = std::move(sequence);
+   mRate = rate;
+   NotePositionChange();
+   MarkChanged();
 }
 
 // Used by commands which interact with clips using the keyboard.
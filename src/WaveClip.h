@@ -14,6 +14,7 @@
 
 #include "Audacity.h"
 
+#include "CacheBudget.h"
 #include "SampleFormat.h"
 #include "ondemand/ODTaskThread.h"
 #include "xml/XMLTagHandler.h"
@@ -22,6 +23,7 @@
 
 #include <wx/longlong.h>
 
+#include <functional>
 #include <vector>
 
 class BlockArray;
@@ -30,6 +32,7 @@ using BlockFilePtr = std::shared_ptr<BlockFile>;
 class DirManager;
 class Envelope;
 class ProgressDialog;
+class Resample;
 class Sequence;
 class SpectrogramSettings;
 class WaveCache;
@@ -57,6 +60,11 @@ public:
    bool Matches(int dirty_, double pixelsPerSecond,
       const SpectrogramSettings &settings, double rate) const;
 
+   // Whether the columns are computed as they would be now, though maybe
+   // at another zoom
+   bool MatchesExceptZoom(int dirty_,
+      const SpectrogramSettings &settings) const;
+
    // Calculate one column of the spectrum
    bool CalculateOneSpectrum
       (const SpectrogramSettings &settings,
@@ -72,12 +80,14 @@ public:
    void Grow(size_t len_, const SpectrogramSettings& settings,
                double pixelsPerSecond, double start_);
 
-   // Calculate the dirty columns at the begin and end of the cache
+   // Calculate the dirty columns at the begin and end of the cache,
+   // except those that are marked in pFilled
    void Populate
       (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
        int copyBegin, int copyEnd, size_t numPixels,
-       sampleCount numSamples,
-       double offset, double rate, double pixelsPerSecond);
+       const Sequence &sequence, sampleCount numSamples,
+       double offset, double rate, double pixelsPerSecond,
+       const std::vector<char> *pFilled = nullptr);
 
    size_t       len { 0 }; // counts pixels, not samples
    int          algorithm;
@@ -171,6 +181,7 @@ public:
 };
 
 class AUDACITY_DLL_API WaveClip final : public XMLTagHandler
+   , private CacheBudget::Client
 {
 private:
    // It is an error to copy a WaveClip without specifying the DirManager.
@@ -213,6 +224,15 @@ public:
    // the length of the clip
    void Resample(int rate, ProgressDialog *progress = NULL);
 
+   /// The first part of Resample, making the NEW sequence without changing
+   /// the clip, so it may run on a worker thread.  The resampler must be
+   /// made for the rates.  report is given the count of samples consumed;
+   /// if it returns false, throws UserException.
+   std::unique_ptr<Sequence> ResampleSequence(int rate, ::Resample &resample,
+      const std::function<bool(sampleCount)> &report) const;
+   /// The last part of Resample, given the result of ResampleSequence
+   void CommitResample(int rate, std::unique_ptr<Sequence> &&sequence);
+
    void SetColourIndex( int index ){ mColourIndex = index;};
    int GetColourIndex( ) const { return mColourIndex;};
    void SetOffset(double offset);
@@ -225,6 +245,10 @@ public:
    sampleCount GetEndSample() const;
    sampleCount GetNumSamples() const;
 
+   // Changes whenever any clip is made or destroyed, or changes its position,
+   // rate or length
+   static unsigned long long GetPositionGeneration();
+
    // One and only one of the following is true for a given t (unless the clip
    // has zero length -- then BeforeClip() and AfterClip() can both be true).
    // Within() is true if the time is substantially within the clip
@@ -237,6 +261,17 @@ public:
                    sampleCount start, size_t len, bool mayThrow = true) const;
    void SetSamples(samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
+   /// Like GetSamples into floats without throwing, but keeps a copy of the
+   /// range last fetched, so that redrawing individual samples need not
+   /// read the blocks again.  SetSamples updates the copy.
+   bool GetDisplaySamples(float *buffer, sampleCount start, size_t len) const;
+   /// Reverse the samples in [start, start + len), clip-relative, without
+   /// converting them to another format
+   void ReverseSamples(sampleCount start, sampleCount len);
+   /// Transform the samples in [start, start + len), clip-relative, block
+   /// by block; false, changing nothing, if the transform stopped
+   bool TransformSamples(sampleCount start, sampleCount len,
+                         const SampleTransform &transform);
 
    Envelope* GetEnvelope() { return mEnvelope.get(); }
    const Envelope* GetEnvelope() const { return mEnvelope.get(); }
@@ -300,6 +335,10 @@ public:
    /// Paste data from other clip, resampling it if not equal rate
    void Paste(double t0, const WaveClip* other);
 
+   /// Append count more copies of the whole clip, as so many Pastes at the
+   /// end would, but sharing the block files with one edit of the sequence
+   void Repeat(size_t count);
+
    /** Insert silence - note that this is an efficient operation for large
     * amounts of silence */
    void InsertSilence( double t, double len, double *pEnvelopeValue = nullptr );
@@ -359,9 +398,25 @@ public:
    bool GetIsPlaceholder() const { return mIsPlaceholder; }
    void SetIsPlaceholder(bool val) { mIsPlaceholder = val; }
 
+   /// Whether other would be an exact copy of this, sharing the same blocks,
+   /// so that it may stand in for one
+   bool IsIdenticalTo(const WaveClip &other) const;
+
    // used by commands which interact with clips using the keyboard
    bool SharesBoundaryWithNextClip(const WaveClip* next) const;
 
+private:
+   // CacheBudget::Client implementation
+   void EvictCache(CacheBudget::Kind kind) const override;
+
+   // Tell the budget what the display caches hold now
+   void TouchWaveCache() const;
+   void TouchSpecCache() const;
+
+   // MarkChanged, after samples were appended at oldLen and later, so that
+   // the wave cache keeps the columns before them
+   void MarkAppended(sampleCount oldLen); // NOFAIL-GUARANTEE
+
 public:
    // Cache of values to colour pixels of Spectrogram - used by TrackArtist
    mutable std::unique_ptr<SpecPxCache> mSpecPxCache;
@@ -380,6 +435,11 @@ protected:
    mutable std::unique_ptr<WaveCache> mWaveCache;
    mutable ODLock       mWaveCacheMutex {};
    mutable std::unique_ptr<SpecCache> mSpecCache;
+   // Copy made by GetDisplaySamples, valid while its dirty count is mDirty
+   mutable std::vector<float> mDisplaySamples;
+   mutable sampleCount  mDisplaySamplesStart { 0 };
+   mutable int          mDisplaySamplesDirty { -1 };
+   mutable ODLock       mDisplaySamplesMutex {};
    SampleBuffer  mAppendBuffer {};
    size_t        mAppendBufferLen { 0 };
 
@@ -36,14 +36,26 @@ Track classes.
 #include <wx/defs.h>
 #include <wx/intl.h>
 #include <wx/debug.h>
+#include <wx/utils.h>
 
 #include <float.h>
 #include <math.h>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include "float_cast.h"
 
+#include "AutoRecovery.h"
+#include "BlockFile.h"
+#include "BlockSampleCache.h"
+#include "CacheBudget.h"
 #include "Envelope.h"
+#include "Resample.h"
 #include "Sequence.h"
 #include "Spectrum.h"
 
@@ -61,6 +73,8 @@ Track classes.
 #include "prefs/WaveformSettings.h"
 
 #include "InconsistencyException.h"
+#include "UserException.h"
+#include "widgets/ProgressDialog.h"
 
 #include "tracks/ui/TrackView.h"
 #include "tracks/ui/TrackControls.h"
@@ -116,7 +130,12 @@ WaveTrack::WaveTrack(const std::shared_ptr<DirManager> &projDirManager, sampleFo
    mAutoSaveIdent = 0;
 }
 
-WaveTrack::WaveTrack(const WaveTrack &orig):
+WaveTrack::WaveTrack(const WaveTrack &orig)
+   : WaveTrack{ orig, nullptr }
+{
+}
+
+WaveTrack::WaveTrack(const WaveTrack &orig, const WaveTrack *pPrevious):
    PlayableTrack(orig)
    , mpSpectrumSettings(orig.mpSpectrumSettings
       ? std::make_unique<SpectrogramSettings>(*orig.mpSpectrumSettings)
@@ -134,9 +153,30 @@ WaveTrack::WaveTrack(const WaveTrack &orig):
 
    Init(orig);
 
-   for (const auto &clip : orig.mClips)
-      mClips.push_back
-         ( std::make_unique<WaveClip>( *clip, mDirManager, true ) );
+   for (size_t ii = 0, nClips = orig.mClips.size(); ii < nClips; ++ii) {
+      const auto &clip = orig.mClips[ii];
+      WaveClipHolder shared;
+      if (pPrevious && pPrevious->mDirManager == mDirManager) {
+         // Clips usually keep their places, so look there first
+         const auto &previousClips = pPrevious->mClips;
+         if (ii < previousClips.size() &&
+             clip->IsIdenticalTo( *previousClips[ii] ))
+            shared = previousClips[ii];
+         else {
+            auto iter = std::find_if(
+               previousClips.begin(), previousClips.end(),
+               [&](const WaveClipHolder &pClip){
+                  return clip->IsIdenticalTo( *pClip ); } );
+            if (iter != previousClips.end())
+               shared = *iter;
+         }
+      }
+      if (shared)
+         mClips.push_back( shared );
+      else
+         mClips.push_back
+            ( std::make_unique<WaveClip>( *clip, mDirManager, true ) );
+   }
 }
 
 // Copy the track metadata but not the contents.
@@ -326,6 +366,13 @@ Track::Holder WaveTrack::Clone() const
    return std::make_shared<WaveTrack>( *this );
 }
 
+Track::Holder WaveTrack::CloneSharing(const Track &previous) const
+{
+   // The previous copy is never modified again, so its clips may be shared
+   auto pPrevious = dynamic_cast<const WaveTrack*>(&previous);
+   return std::shared_ptr<WaveTrack>{ safenew WaveTrack( *this, pPrevious ) };
+}
+
 double WaveTrack::GetRate() const
 {
    return mRate;
@@ -1091,9 +1138,7 @@ void WaveTrack::SyncLockAdjust(double oldT1, double newT1)
       if (IsEmpty(oldT1, oldT1))
       {
          // Check if clips can move
-         bool clipsCanMove = true;
-         gPrefs->Read(wxT("/GUI/EditClipCanMove"), &clipsCanMove);
-         if (clipsCanMove) {
+         if (EditClipsCanMove.Read()) {
             auto tmp = Cut (oldT1, GetEndTime() + 1.0/GetRate());
 
             Paste(newT1, tmp.get());
@@ -1671,6 +1716,12 @@ XMLTagHandler *WaveTrack::HandleXMLChild(const wxChar *tag)
 
 void WaveTrack::WriteXML(XMLWriter &xmlFile) const
 // may throw
+{
+   WriteXML(xmlFile, nullptr);
+}
+
+void WaveTrack::WriteXML(XMLWriter &xmlFile, ClipXMLCache *pCache) const
+// may throw
 {
    xmlFile.StartTag(wxT("wavetrack"));
    if (mAutoSaveIdent)
@@ -1688,7 +1739,10 @@ void WaveTrack::WriteXML(XMLWriter &xmlFile) const
 
    for (const auto &clip : mClips)
    {
-      clip->WriteXML(xmlFile);
+      if (pCache)
+         pCache->WriteClip(xmlFile, *clip);
+      else
+         clip->WriteXML(xmlFile);
    }
 
    xmlFile.EndTag(wxT("wavetrack"));
@@ -1822,6 +1876,40 @@ std::pair<float, float> WaveTrack::GetMinMax(
    return results;
 }
 
+std::pair<float, float> WaveTrack::GetSampleMinMax(
+   sampleCount start, sampleCount len, bool mayThrow) const
+{
+   std::pair<float, float> results {
+      // we need these at extremes to make sure we find true min and max
+      FLT_MAX, -FLT_MAX
+   };
+   bool clipFound = false;
+
+   for (const auto &clip: GetClipsInRange(start, len))
+   {
+      auto clipStart = clip->GetStartSample();
+      auto s0 = std::max( start, clipStart );
+      auto s1 = std::min( start + len, clip->GetEndSample() );
+      if (s1 > s0)
+      {
+         clipFound = true;
+         auto clipResults =
+            clip->GetSequence()->GetMinMax(s0 - clipStart, s1 - s0, mayThrow);
+         if (clipResults.first < results.first)
+            results.first = clipResults.first;
+         if (clipResults.second > results.second)
+            results.second = clipResults.second;
+      }
+   }
+
+   if(!clipFound)
+   {
+      results = { 0.f, 0.f }; // sensible defaults if no clips found
+   }
+
+   return results;
+}
+
 float WaveTrack::GetRMS(double t0, double t1, bool mayThrow) const
 {
    if (t0 > t1) {
@@ -1856,82 +1944,184 @@ float WaveTrack::GetRMS(double t0, double t1, bool mayThrow) const
    return length > 0 ? sqrt(sumsq / length.as_double()) : 0.0;
 }
 
+void WaveTrack::UpdateClipIndex() const
+{
+   // Read the generation first, so that changes made meanwhile by another
+   // thread cause another rebuild
+   const auto generation = WaveClip::GetPositionGeneration();
+   if (generation == mClipIndexGeneration &&
+       mIndexedClips.size() == mClips.size() &&
+       std::equal(mClips.begin(), mClips.end(), mIndexedClips.begin(),
+          [](const WaveClipHolder &pClip, const WaveClip *pIndexed){
+             return pClip.get() == pIndexed; }))
+      return;
+
+   mIndexedClips.clear();
+   mClipIndex.clear();
+   mIndexedClips.reserve(mClips.size());
+   mClipIndex.reserve(mClips.size());
+   for (size_t ii = 0; ii < mClips.size(); ++ii) {
+      const auto pClip = mClips[ii].get();
+      mIndexedClips.push_back(pClip);
+      mClipIndex.push_back( { pClip->GetStartSample(), pClip->GetEndSample(),
+         0, ii, pClip } );
+   }
+
+   std::stable_sort(mClipIndex.begin(), mClipIndex.end(),
+      [](const ClipIndexEntry &a, const ClipIndexEntry &b){
+         return a.start < b.start; });
+
+   sampleCount maxEnd = 0;
+   for (auto &entry : mClipIndex) {
+      if (&entry == &mClipIndex.front() || entry.end > maxEnd)
+         maxEnd = entry.end;
+      entry.maxEnd = maxEnd;
+   }
+
+   mClipIndexGeneration = generation;
+}
+
+auto WaveTrack::FindClips(sampleCount start, sampleCount end) const
+   -> ClipIndexEntries
+{
+   ClipIndexEntries result;
+   if (end <= start)
+      return result;
+
+   std::lock_guard<std::mutex> lock{ mClipIndexMutex };
+   UpdateClipIndex();
+
+   // Entries before last start before end; walk back from it only while
+   // some earlier clip may still reach past start
+   auto last = std::lower_bound(mClipIndex.begin(), mClipIndex.end(), end,
+      [](const ClipIndexEntry &entry, sampleCount value){
+         return entry.start < value; });
+   for (auto iter = last; iter != mClipIndex.begin();) {
+      --iter;
+      if (iter->maxEnd <= start)
+         break;
+      if (iter->end > start)
+         result.push_back(*iter);
+   }
+   std::reverse(result.begin(), result.end());
+
+   return result;
+}
+
+WaveClipPointers WaveTrack::GetClipsInRange(sampleCount start, sampleCount len)
+{
+   WaveClipPointers result;
+   for (const auto &entry : FindClips(start, start + len))
+      result.push_back(entry.clip);
+   return result;
+}
+
+WaveClipConstPointers WaveTrack::GetClipsInRange(
+   sampleCount start, sampleCount len) const
+{
+   WaveClipConstPointers result;
+   for (const auto &entry : FindClips(start, start + len))
+      result.push_back(entry.clip);
+   return result;
+}
+
+namespace {
+   // Where the clip overlaps buffer samples [start, start + len):  the
+   // offset into the buffer, the offset into the clip, and the length
+   struct ClipOverlap {
+      size_t bufferOffset;
+      sampleCount clipOffset;
+      size_t len;
+   };
+
+   ClipOverlap FindOverlap( const WaveClip &clip,
+      sampleCount start, size_t len )
+   {
+      auto clipStart = clip.GetStartSample();
+
+      // Clip sample region and Get/Put sample region overlap
+      auto samplesToCopy =
+         std::min( start+len - clipStart, clip.GetNumSamples() );
+      auto startDelta = clipStart - start;
+      decltype(startDelta) inclipDelta = 0;
+      if (startDelta < 0)
+      {
+         inclipDelta = -startDelta; // make positive value
+         samplesToCopy -= inclipDelta;
+         // samplesToCopy is now either len or
+         //    (clipEnd - clipStart) - (start - clipStart)
+         //    == clipEnd - start > 0
+         // samplesToCopy is not more than len
+         //
+         startDelta = 0;
+         // startDelta is zero
+      }
+      else {
+         // startDelta is nonnegative and less than than len
+         // samplesToCopy is positive and not more than len
+      }
+
+      return { startDelta.as_size_t(), inclipDelta,
+         samplesToCopy.as_size_t() };
+   }
+
+}
+
 bool WaveTrack::Get(samplePtr buffer, sampleFormat format,
                     sampleCount start, size_t len, fillFormat fill,
                     bool mayThrow, sampleCount * pNumWithinClips) const
 {
-   // Simple optimization: When this buffer is completely contained within one clip,
-   // don't clear anything (because we won't have to). Otherwise, just clear
-   // everything to be on the safe side.
-   bool doClear = true;
    bool result = true;
    sampleCount samplesCopied = 0;
-   for (const auto &clip: mClips)
-   {
-      if (start >= clip->GetStartSample() && start+len <= clip->GetEndSample())
-      {
-         doClear = false;
-         break;
-      }
-   }
-   if (doClear)
-   {
-      // Usually we fill in empty space with zero
+
+   // Gather all the clips in the range in one search of the index
+   auto clips = FindClips(start, start + len);
+
+   // Fill only the gaps between the clips.  Usually we fill in empty space
+   // with zero, but we don't have to.
+   const auto fillGap = [&](sampleCount from, sampleCount to){
+      const auto offset = (from - start).as_size_t();
+      const auto count = (to - from).as_size_t();
       if( fill == fillZero )
-         ClearSamples(buffer, format, 0, len);
-      // but we don't have to.
+         ClearSamples(buffer, format, offset, count);
       else if( fill==fillTwo )
       {
          wxASSERT( format==floatSample );
-         float * pBuffer = (float*)buffer;
-         for(size_t i=0;i<len;i++)
+         float * pBuffer = (float*)buffer + offset;
+         for(size_t i=0;i<count;i++)
             pBuffer[i]=2.0f;
       }
       else
       {
          wxFAIL_MSG(wxT("Invalid fill format"));
       }
-   }
-
-   // Iterate the clips.  They are not necessarily sorted by time.
-   for (const auto &clip: mClips)
+   };
+   sampleCount filled = start;
+   for (const auto &entry : clips) {
+      if (entry.start > filled)
+         fillGap(filled, entry.start);
+      filled = std::max(filled, entry.end);
+   }
+   if (filled < start + len)
+      fillGap(filled, start + len);
+
+   // Where clips overlap, the later in mClips wins, as when all the clips
+   // were read in that order
+   std::sort(clips.begin(), clips.end(),
+      [](const ClipIndexEntry &a, const ClipIndexEntry &b){
+         return a.order < b.order; });
+   for (const auto &entry : clips)
    {
-      auto clipStart = clip->GetStartSample();
-      auto clipEnd = clip->GetEndSample();
-
-      if (clipEnd > start && clipStart < start+len)
-      {
-         // Clip sample region and Get/Put sample region overlap
-         auto samplesToCopy =
-            std::min( start+len - clipStart, clip->GetNumSamples() );
-         auto startDelta = clipStart - start;
-         decltype(startDelta) inclipDelta = 0;
-         if (startDelta < 0)
-         {
-            inclipDelta = -startDelta; // make positive value
-            samplesToCopy -= inclipDelta;
-            // samplesToCopy is now either len or
-            //    (clipEnd - clipStart) - (start - clipStart)
-            //    == clipEnd - start > 0
-            // samplesToCopy is not more than len
-            //
-            startDelta = 0;
-            // startDelta is zero
-         }
-         else {
-            // startDelta is nonnegative and less than than len
-            // samplesToCopy is positive and not more than len
-         }
-
-         if (!clip->GetSamples(
-               (samplePtr)(((char*)buffer) +
-                           startDelta.as_size_t() *
-                           SAMPLE_SIZE(format)),
-               format, inclipDelta, samplesToCopy.as_size_t(), mayThrow ))
-            result = false;
-         else
-            samplesCopied += samplesToCopy;
-      }
+      const auto &clip = entry.clip;
+      const auto overlap = FindOverlap(*clip, start, len);
+      if (!clip->GetSamples(
+            (samplePtr)(((char*)buffer) +
+                        overlap.bufferOffset *
+                        SAMPLE_SIZE(format)),
+            format, overlap.clipOffset, overlap.len, mayThrow ))
+         result = false;
+      else
+         samplesCopied += overlap.len;
    }
    if( pNumWithinClips )
       *pNumWithinClips = samplesCopied;
@@ -1942,74 +2132,60 @@ void WaveTrack::Set(samplePtr buffer, sampleFormat format,
                     sampleCount start, size_t len)
 // WEAK-GUARANTEE
 {
-   for (const auto &clip: mClips)
+   for (const auto &entry : FindClips(start, start + len))
    {
-      auto clipStart = clip->GetStartSample();
-      auto clipEnd = clip->GetEndSample();
-
-      if (clipEnd > start && clipStart < start+len)
-      {
-         // Clip sample region and Get/Put sample region overlap
-         auto samplesToCopy =
-            std::min( start+len - clipStart, clip->GetNumSamples() );
-         auto startDelta = clipStart - start;
-         decltype(startDelta) inclipDelta = 0;
-         if (startDelta < 0)
-         {
-            inclipDelta = -startDelta; // make positive value
-            samplesToCopy -= inclipDelta;
-            // samplesToCopy is now either len or
-            //    (clipEnd - clipStart) - (start - clipStart)
-            //    == clipEnd - start > 0
-            // samplesToCopy is not more than len
-            //
-            startDelta = 0;
-            // startDelta is zero
-         }
-         else {
-            // startDelta is nonnegative and less than than len
-            // samplesToCopy is positive and not more than len
-         }
-
-         clip->SetSamples(
-               (samplePtr)(((char*)buffer) +
-                           startDelta.as_size_t() *
-                           SAMPLE_SIZE(format)),
-                          format, inclipDelta, samplesToCopy.as_size_t() );
-         clip->MarkChanged();
-      }
+      const auto &clip = entry.clip;
+      const auto overlap = FindOverlap(*clip, start, len);
+      clip->SetSamples(
+            (samplePtr)(((char*)buffer) +
+                        overlap.bufferOffset *
+                        SAMPLE_SIZE(format)),
+                       format, overlap.clipOffset, overlap.len );
+      clip->MarkChanged();
    }
 }
 
-void WaveTrack::GetEnvelopeValues(double *buffer, size_t bufferLen,
-                                  double t0) const
+bool WaveTrack::TransformSamples(sampleCount start, sampleCount len,
+                                 const SampleTransform &transform)
+// WEAK-GUARANTEE
 {
-   // The output buffer corresponds to an unbroken span of time which the callers expect
-   // to be fully valid.  As clips are processed below, the output buffer is updated with
-   // envelope values from any portion of a clip, start, end, middle, or none at all.
-   // Since this does not guarantee that the entire buffer is filled with values we need
-   // to initialize the entire buffer to a default value.
-   //
-   // This does mean that, in the cases where a usable clip is located, the buffer value will
-   // be set twice.  Unfortunately, there is no easy way around this since the clips are not
-   // stored in increasing time order.  If they were, we could just track the time as the
-   // buffer is filled.
-   for (decltype(bufferLen) i = 0; i < bufferLen; i++)
+   const auto end = start + len;
+   for (const auto &entry : FindClips(start, end))
    {
-      buffer[i] = 1.0;
+      const auto &clip = entry.clip;
+      const auto clipStart = clip->GetStartSample();
+      const auto from = std::max(start, clipStart);
+      const auto to = std::min(end, clipStart + clip->GetNumSamples());
+      if (from >= to)
+         continue;
+      const auto offset = from - start;
+      if (!clip->TransformSamples(from - clipStart, to - from,
+         [&](float *buffer, size_t count, sampleCount pos) {
+            return transform(buffer, count, pos + offset);
+         }))
+         return false;
    }
+   return true;
+}
 
+namespace {
+// Call fn(offset, len, t0, envelope) for each span of a buffer of bufferLen
+// samples from time t0 that lies within a clip, with that clip's envelope
+template< typename Function >
+void ForEachClipEnvelopeSpan(const WaveClipHolders &clips, double rate,
+   size_t bufferLen, double t0, const Function &fn)
+{
    double startTime = t0;
-   auto tstep = 1.0 / mRate;
+   auto tstep = 1.0 / rate;
    double endTime = t0 + tstep * bufferLen;
-   for (const auto &clip: mClips)
+   for (const auto &clip: clips)
    {
       // IF clip intersects startTime..endTime THEN...
       auto dClipStartTime = clip->GetStartTime();
       auto dClipEndTime = clip->GetEndTime();
       if ((dClipStartTime < endTime) && (dClipEndTime > startTime))
       {
-         auto rbuf = buffer;
+         size_t roffset = 0;
          auto rlen = bufferLen;
          auto rt0 = t0;
 
@@ -2017,9 +2193,9 @@ void WaveTrack::GetEnvelopeValues(double *buffer, size_t bufferLen,
          {
             // This is not more than the number of samples in
             // (endTime - startTime) which is bufferLen:
-            auto nDiff = (sampleCount)floor((dClipStartTime - rt0) * mRate + 0.5);
+            auto nDiff = (sampleCount)floor((dClipStartTime - rt0) * rate + 0.5);
             auto snDiff = nDiff.as_size_t();
-            rbuf += snDiff;
+            roffset += snDiff;
             wxASSERT(snDiff <= rlen);
             rlen -= snDiff;
             rt0 = dClipStartTime;
@@ -2042,10 +2218,48 @@ void WaveTrack::GetEnvelopeValues(double *buffer, size_t bufferLen,
          }
          // Samples are obtained for the purpose of rendering a wave track,
          // so quantize time
-         clip->GetEnvelope()->GetValues(rbuf, rlen, rt0, tstep);
+         fn(roffset, rlen, rt0, *clip->GetEnvelope());
       }
    }
 }
+}
+
+void WaveTrack::GetEnvelopeValues(double *buffer, size_t bufferLen,
+                                  double t0) const
+{
+   // The output buffer corresponds to an unbroken span of time which the callers expect
+   // to be fully valid.  As clips are processed below, the output buffer is updated with
+   // envelope values from any portion of a clip, start, end, middle, or none at all.
+   // Since this does not guarantee that the entire buffer is filled with values we need
+   // to initialize the entire buffer to a default value.
+   //
+   // This does mean that, in the cases where a usable clip is located, the buffer value will
+   // be set twice.  Unfortunately, there is no easy way around this since the clips are not
+   // stored in increasing time order.  If they were, we could just track the time as the
+   // buffer is filled.
+   for (decltype(bufferLen) i = 0; i < bufferLen; i++)
+   {
+      buffer[i] = 1.0;
+   }
+
+   const auto tstep = 1.0 / mRate;
+   ForEachClipEnvelopeSpan(mClips, mRate, bufferLen, t0,
+      [&](size_t offset, size_t len, double rt0, const Envelope &envelope){
+         envelope.GetValues(buffer + offset, len, rt0, tstep);
+      });
+}
+
+void WaveTrack::ApplyEnvelope(float *buffer, size_t bufferLen,
+                              double t0) const
+{
+   // Samples outside of all clips are left as they are, as if multiplied by
+   // the 1.0 that GetEnvelopeValues() gives them
+   const auto tstep = 1.0 / mRate;
+   ForEachClipEnvelopeSpan(mClips, mRate, bufferLen, t0,
+      [&](size_t offset, size_t len, double rt0, const Envelope &envelope){
+         envelope.MultiplyValues(buffer + offset, len, rt0, tstep);
+      });
+}
 
 WaveClip* WaveTrack::GetClipAtX(int xcoord)
 {
@@ -2062,16 +2276,12 @@ WaveClip* WaveTrack::GetClipAtX(int xcoord)
 
 WaveClip* WaveTrack::GetClipAtSample(sampleCount sample)
 {
-   for (const auto &clip: mClips)
-   {
-      auto start = clip->GetStartSample();
-      auto len   = clip->GetNumSamples();
-
-      if (sample >= start && sample < start + len)
-         return clip.get();
-   }
-
-   return NULL;
+   // The first in mClips, if clips overlap
+   const auto clips = FindClips(sample, sample + 1);
+   auto found = std::min_element(clips.begin(), clips.end(),
+      [](const ClipIndexEntry &a, const ClipIndexEntry &b){
+         return a.order < b.order; });
+   return found != clips.end() ? found->clip : NULL;
 }
 
 // When the time is both the end of a clip and the start of the next clip, the
@@ -2439,13 +2649,98 @@ void WaveTrack::MergeClips(int clipidx1, int clipidx2)
 }
 
 void WaveTrack::Resample(int rate, ProgressDialog *progress)
-// WEAK-GUARANTEE
-// Partial completion may leave clips at differing sample rates!
+// STRONG-GUARANTEE
 {
-   for (const auto &clip : mClips)
-      clip->Resample(rate, progress);
+   Resample({ this }, rate, progress);
+}
+
+void WaveTrack::Resample(const std::vector<WaveTrack*> &tracks,
+   int rate, ProgressDialog *progress)
+// STRONG-GUARANTEE
+{
+   // Each clip resamples independently into a NEW sequence
+   struct Job {
+      WaveClip *clip;
+      std::unique_ptr<::Resample> resample;
+      std::unique_ptr<Sequence> result;
+   };
+   std::vector<Job> jobs;
+   long long total = 0;
+   for (auto pTrack : tracks)
+      for (const auto &clip : pTrack->mClips) {
+         if (clip->GetRate() == rate)
+            continue;
+         const double factor = (double)rate / clip->GetRate();
+         // Make the resamplers here, because they read preferences
+         jobs.push_back({ clip.get(),
+            std::make_unique<::Resample>(true, factor, factor), nullptr });
+         total += clip->GetNumSamples().as_long_long();
+      }
 
-   mRate = rate;
+   const auto nJobs = jobs.size();
+   std::vector< std::atomic<long long> > done(nJobs);
+   std::atomic<bool> stopped{ false };
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   const auto nThreads = std::min<size_t>(
+      nJobs, std::max(1u, std::thread::hardware_concurrency()));
+   std::vector<std::exception_ptr> errors(nThreads);
+   {
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the clips go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for (auto &thread : threads)
+            thread.join();
+      } );
+      for (size_t ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back( [&, ii]{
+            try {
+               for (size_t jj = 0;
+                    !stopped.load() && (jj = next++) < nJobs;) {
+                  auto &job = jobs[jj];
+                  job.result = job.clip->ResampleSequence(
+                     rate, *job.resample, [&](sampleCount pos) {
+                        done[jj].store(pos.as_long_long());
+                        return !stopped.load();
+                     });
+                  ++nDone;
+               }
+            }
+            catch (const UserException &) {
+               // Stopped by another thread, or by the user
+               stopped.store(true);
+            }
+            catch (...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      while (nDone.load() < nJobs && !stopped.load()) {
+         long long sum = 0;
+         for (const auto &count : done)
+            sum += count.load();
+         if (progress &&
+             progress->Update(sum, total) != ProgressResult::Success) {
+            stopped.store(true);
+            break;
+         }
+         ::wxMilliSleep(10);
+      }
+   }
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+   if (nDone.load() < nJobs)
+      // Cancelled
+      throw UserException{};
+
+   // Use NOFAIL-GUARANTEE in these steps
+   for (auto &job : jobs)
+      job.clip->CommitResample(rate, std::move(job.result));
+   for (auto pTrack : tracks)
+      pTrack->mRate = rate;
 }
 
 namespace {
@@ -2496,8 +2791,248 @@ void WaveTrack::SetAutoSaveIdent(int ident)
    mAutoSaveIdent = ident;
 }
 
+namespace {
+
+// How many blocks past the buffers a WaveTrackCache reads ahead
+enum : size_t { ReadAheadBlocks = 4 };
+
+// The block of the track holding sample s, and its start in the track, or
+// null between clips
+const SeqBlock *FindTrackBlock(
+   const WaveTrack &track, sampleCount s, sampleCount &blockStart)
+{
+   for (const auto &clip : track.GetClips())
+   {
+      const auto startSample =
+         (sampleCount)floor(0.5 + clip->GetStartTime() * track.GetRate());
+      const auto endSample = startSample + clip->GetNumSamples();
+      if (s >= startSample && s < endSample) {
+         const auto &block = clip->GetSequence()->GetBlockAt(s - startSample);
+         blockStart = startSample + block.start;
+         return &block;
+      }
+   }
+   return nullptr;
+}
+
+}
+
+struct WaveTrackCache::ReadAheadSlot
+{
+   std::mutex mutex;
+   std::condition_variable condition;
+
+   // Not changed while pending
+   BlockFilePtr block;
+   sampleCount start;
+   size_t len;
+   Floats data;
+
+   enum State { Pending, Done, Failed } state{ Pending };
+};
+
+namespace {
+
+/// One thread for all WaveTrackCaches, reading blocks into their read-ahead
+/// slots in the order requested
+class BlockReadAheadQueue
+{
+public:
+   using Slot = WaveTrackCache::ReadAheadSlot;
+
+   static BlockReadAheadQueue &Get()
+   {
+      static BlockReadAheadQueue instance;
+      return instance;
+   }
+
+   void Push( const std::shared_ptr<Slot> &pSlot )
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mQueue.push_back( pSlot );
+      }
+      mCondition.notify_one();
+   }
+
+private:
+   BlockReadAheadQueue()
+      : mThread{ [this]{ Run(); } }
+   {}
+
+   ~BlockReadAheadQueue()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mStopping = true;
+      }
+      mCondition.notify_all();
+      mThread.join();
+   }
+
+   void Run()
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      while (true) {
+         mCondition.wait( lock, [this]{
+            return mStopping || !mQueue.empty(); } );
+         if (mStopping)
+            return;
+
+         // Slots whose caches let go of them are skipped
+         auto pSlot = mQueue.front().lock();
+         mQueue.pop_front();
+         if (!pSlot)
+            continue;
+         lock.unlock();
+
+         auto state = Slot::Failed;
+         try {
+            if (BlockSampleCache::Get().Read( *pSlot->block,
+                  samplePtr(pSlot->data.get()), floatSample, 0, pSlot->len,
+                  false ) == pSlot->len)
+               state = Slot::Done;
+         }
+         catch( ... ) {}
+         {
+            std::lock_guard<std::mutex> slotLock{ pSlot->mutex };
+            pSlot->state = state;
+         }
+         pSlot->condition.notify_all();
+
+         lock.lock();
+      }
+   }
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque< std::weak_ptr<Slot> > mQueue;
+   bool mStopping{ false };
+   std::thread mThread;
+};
+
+}
+
 WaveTrackCache::~WaveTrackCache()
 {
+   ReleaseReadAheadData();
+}
+
+void WaveTrackCache::SetReadAhead(bool readAhead)
+{
+   mReadAhead = readAhead;
+   if (!readAhead)
+      ClearReadAhead();
+}
+
+bool WaveTrackCache::Fill(
+   Buffer &buffer, sampleCount start, size_t len, bool mayThrow)
+{
+   if (mReadAhead) {
+      const bool sequential = (start == mLastFillEnd);
+      if (!sequential)
+         ClearReadAhead();
+      mLastFillEnd = start + len;
+      if (!sequential)
+         mReadAheadEnd = mLastFillEnd;
+      const bool taken = TakeReadAhead(buffer, start, len);
+      if (sequential)
+         ScheduleReadAhead();
+      if (taken)
+         return true;
+   }
+
+   return mPTrack->Get(
+      samplePtr(buffer.data.get()), floatSample, start, len,
+      fillZero, mayThrow);
+}
+
+bool WaveTrackCache::TakeReadAhead(
+   Buffer &buffer, sampleCount start, size_t len)
+{
+   auto end = mReadAheadSlots.end();
+   auto iter = std::find_if( mReadAheadSlots.begin(), end,
+      [&]( const std::shared_ptr<ReadAheadSlot> &pSlot ){
+         return pSlot->start == start && pSlot->len == len; } );
+   if (iter == end)
+      return false;
+
+   // The track might have been edited since the block was read
+   sampleCount blockStart;
+   const auto pBlock = FindTrackBlock( *mPTrack, start, blockStart );
+   auto &slot = **iter;
+   if (!pBlock || pBlock->f != slot.block || blockStart != start)
+      return false;
+
+   std::unique_lock<std::mutex> lock{ slot.mutex };
+   slot.condition.wait( lock, [&]{
+      return slot.state != ReadAheadSlot::Pending; } );
+   if (slot.state != ReadAheadSlot::Done)
+      // Read again on this thread, with this caller's choice of throwing
+      return false;
+   memcpy( buffer.data.get(), slot.data.get(), len * sizeof(float) );
+   return true;
+}
+
+void WaveTrackCache::ScheduleReadAhead()
+{
+   // Recycle the slots behind the last fill
+   auto end = mReadAheadSlots.end();
+   auto newEnd = std::remove_if( mReadAheadSlots.begin(), end,
+      [&]( std::shared_ptr<ReadAheadSlot> &pSlot ){
+         if (pSlot->start >= mLastFillEnd)
+            return false;
+         std::lock_guard<std::mutex> lock{ pSlot->mutex };
+         if (pSlot->state != ReadAheadSlot::Pending)
+            mSpareReadAheadData.push_back( std::move( pSlot->data ) );
+         return true;
+      } );
+   mReadAheadSlots.erase( newEnd, end );
+
+   mReadAheadEnd = std::max( mReadAheadEnd, mLastFillEnd );
+   while (mReadAheadSlots.size() < ReadAheadBlocks) {
+      sampleCount blockStart;
+      const auto pBlock = FindTrackBlock( *mPTrack, mReadAheadEnd, blockStart );
+      // Stop at the end of the clip
+      if (!pBlock || blockStart != mReadAheadEnd)
+         break;
+      const auto len = pBlock->f->GetLength();
+      if (len > mBufferSize)
+         break;
+
+      auto pSlot = std::make_shared<ReadAheadSlot>();
+      pSlot->block = pBlock->f;
+      pSlot->start = blockStart;
+      pSlot->len = len;
+      if (!mSpareReadAheadData.empty()) {
+         pSlot->data = std::move( mSpareReadAheadData.back() );
+         mSpareReadAheadData.pop_back();
+      }
+      else if (CacheBudget::Get().Reserve(
+            CacheBudget::TrackReads, mBufferSize * sizeof(float) )) {
+         pSlot->data = Floats{ mBufferSize };
+         mReadAheadBytes += mBufferSize * sizeof(float);
+      }
+      else
+         // Read no further ahead than the budget allows
+         break;
+      mReadAheadSlots.push_back( pSlot );
+      BlockReadAheadQueue::Get().Push( pSlot );
+      mReadAheadEnd = blockStart + len;
+   }
+}
+
+void WaveTrackCache::ClearReadAhead()
+{
+   // Slots still pending are dropped with their buffers; the reading thread
+   // owns them until it is done
+   for (auto &pSlot : mReadAheadSlots) {
+      std::lock_guard<std::mutex> lock{ pSlot->mutex };
+      if (pSlot->state != ReadAheadSlot::Pending)
+         mSpareReadAheadData.push_back( std::move( pSlot->data ) );
+   }
+   mReadAheadSlots.clear();
+   mLastFillEnd = -1;
 }
 
 void WaveTrackCache::SetTrack(const std::shared_ptr<const WaveTrack> &pTrack)
@@ -2516,9 +3051,20 @@ void WaveTrackCache::SetTrack(const std::shared_ptr<const WaveTrack> &pTrack)
          Free();
       mPTrack = pTrack;
       mNValidBuffers = 0;
+      ClearReadAhead();
+      // Buffers of another size are no use
+      ReleaseReadAheadData();
    }
 }
 
+void WaveTrackCache::ReleaseReadAheadData()
+{
+   // Pending slots already cleared away give their buffers back soon after
+   mSpareReadAheadData.clear();
+   CacheBudget::Get().Release( CacheBudget::TrackReads, mReadAheadBytes );
+   mReadAheadBytes = 0;
+}
+
 constSamplePtr WaveTrackCache::Get(sampleFormat format,
    sampleCount start, size_t len, bool mayThrow)
 {
@@ -2570,9 +3116,7 @@ constSamplePtr WaveTrackCache::Get(sampleFormat format,
          if (start0 >= 0) {
             const auto len0 = mPTrack->GetBestBlockSize(start0);
             wxASSERT(len0 <= mBufferSize);
-            if (!mPTrack->Get(
-                  samplePtr(mBuffers[0].data.get()), floatSample, start0, len0,
-                  fillZero, mayThrow))
+            if (!Fill(mBuffers[0], start0, len0, mayThrow))
                return 0;
             mBuffers[0].start = start0;
             mBuffers[0].len = len0;
@@ -2598,7 +3142,7 @@ constSamplePtr WaveTrackCache::Get(sampleFormat format,
             if (start1 == end0) {
                const auto len1 = mPTrack->GetBestBlockSize(start1);
                wxASSERT(len1 <= mBufferSize);
-               if (!mPTrack->Get(samplePtr(mBuffers[1].data.get()), floatSample, start1, len1, fillZero, mayThrow))
+               if (!Fill(mBuffers[1], start1, len1, mayThrow))
                   return 0;
                mBuffers[1].start = start1;
                mBuffers[1].len = len1;
@@ -2694,6 +3238,8 @@ void WaveTrackCache::Free()
    mBuffers[1].Free();
    mOverlapBuffer.Free();
    mNValidBuffers = 0;
+   ClearReadAhead();
+   ReleaseReadAheadData();
 }
 
 auto WaveTrack::AllClipsIterator::operator ++ () -> AllClipsIterator &
@@ -2721,3 +3267,100 @@ void WaveTrack::AllClipsIterator::push( WaveClipHolders &clips )
       pClips = &(*first)->GetCutLines();
    }
 }
+
+namespace {
+   // Whether the text of the clip depends only on what IsIdenticalTo compares.
+   // On-demand blocks change when loading completes, and alias blocks may be
+   // pointed at renamed files.
+   bool IsCacheable(const WaveClip &clip)
+   {
+      for (const auto &block : *clip.GetSequenceBlockArray()) {
+         const auto &file = block.f;
+         if (file->IsAlias() ||
+             !file->IsDataAvailable() || !file->IsSummaryAvailable())
+            return false;
+      }
+      for (const auto &cutLine : clip.GetCutLines())
+         if (!IsCacheable(*cutLine))
+            return false;
+      return true;
+   }
+}
+
+void ClipXMLCache::WriteClip(XMLWriter &xmlFile, const WaveClip &clip)
+// may throw
+{
+   // Only text files and binary encodings can take the saved bytes
+   const auto pText = dynamic_cast<XMLFileWriter*>(&xmlFile);
+   const auto pBinary = dynamic_cast<AutoSaveFile*>(&xmlFile);
+   if (!pText && !pBinary) {
+      clip.WriteXML(xmlFile);
+      return;
+   }
+   const bool binary = (pBinary != nullptr);
+
+   const auto write = [&](const Content &content){
+      if (binary)
+         pBinary->AppendEncoded(content.bytes);
+      else
+         pText->WriteSubTreeUTF8(content.bytes);
+   };
+
+   auto found = mEntries.find(&clip);
+   if (found != mEntries.end()) {
+      auto entry = std::move(found->second);
+      mEntries.erase(found);
+      if (entry.content.binary == binary &&
+          clip.IsIdenticalTo(*entry.saved)) {
+         write(entry.content);
+         mWritten[&clip] = std::move(entry.content);
+         return;
+      }
+   }
+
+   if (!IsCacheable(clip)) {
+      clip.WriteXML(xmlFile);
+      return;
+   }
+
+   Content content{ {}, binary };
+   if (binary) {
+      AutoSaveFile subTree{ 64 * 1024 };
+      clip.WriteXML(subTree);
+      content.bytes = subTree.EncodeSubTree();
+   }
+   else {
+      XMLStringWriter writer;
+      writer.SetDepth(xmlFile.GetDepth());
+      clip.WriteXML(writer);
+      const auto utf8 = writer.utf8_str();
+      content.bytes.assign(utf8.data(), utf8.length());
+   }
+   write(content);
+   mWritten[&clip] = std::move(content);
+}
+
+void ClipXMLCache::Commit(const TrackList &tracks, const TrackList &savedTracks)
+{
+   decltype(mEntries) entries;
+
+   // The saved tracks are duplicates, with clips in the same order
+   auto saved = savedTracks.Any< const WaveTrack >();
+   auto iter = saved.begin(), end = saved.end();
+   for (auto wt : tracks.Any< const WaveTrack >()) {
+      if (iter == end)
+         break;
+      const auto &clips = wt->GetClips();
+      const auto &savedClips = (*iter++)->GetClips();
+      const auto nClips = std::min(clips.size(), savedClips.size());
+      for (size_t ii = 0; ii < nClips; ++ii) {
+         auto found = mWritten.find(clips[ii].get());
+         if (found != mWritten.end())
+            entries[clips[ii].get()] =
+               Entry{ savedClips[ii], std::move(found->second) };
+      }
+   }
+
+   mEntries.swap(entries);
+   mWritten.clear();
+}
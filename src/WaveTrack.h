@@ -13,6 +13,9 @@
 
 #include "Track.h"
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <wx/longlong.h>
 
@@ -26,6 +29,7 @@ class TimeWarper;
 
 class Sequence;
 class WaveClip;
+class ClipXMLCache;
 
 // Array of pointers that assume ownership
 using WaveClipHolder = std::shared_ptr< WaveClip >;
@@ -77,9 +81,14 @@ public:
    void Reinit(const WaveTrack &orig);
 
 private:
+   // Copy, but share with pPrevious, if not null, each clip it has that is
+   // identical to one of orig's
+   WaveTrack(const WaveTrack &orig, const WaveTrack *pPrevious);
+
    void Init(const WaveTrack &orig);
 
    Track::Holder Clone() const override;
+   Track::Holder CloneSharing(const Track &previous) const override;
 
    friend class TrackFactory;
 
@@ -248,15 +257,38 @@ private:
       sampleCount * pNumWithinClips = nullptr) const;
    void Set(samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
+   /// Transform the samples of the clips in [start, start + len), block by
+   /// block, as floats; positions passed to the transform count from
+   /// start.  False if the transform stopped, maybe after changing some
+   /// clips.
+   bool TransformSamples(sampleCount start, sampleCount len,
+                         const SampleTransform &transform);
+
+   /// The clips that have samples in [start, start + len), sorted by start.
+   /// Found by binary search in an index of the clips, which is rebuilt only
+   /// after clips are added, removed, moved or resized; so tracks of
+   /// thousands of short clips read as fast as tracks of a few.
+   WaveClipPointers GetClipsInRange(sampleCount start, sampleCount len);
+   WaveClipConstPointers GetClipsInRange(
+      sampleCount start, sampleCount len) const;
 
    // Fetch envelope values corresponding to uniformly separated sample times
    // starting at the given time.
    void GetEnvelopeValues(double *buffer, size_t bufferLen,
                          double t0) const;
 
+   // Multiply samples by the envelope values GetEnvelopeValues() would
+   // give, without making a buffer of them
+   void ApplyEnvelope(float *buffer, size_t bufferLen, double t0) const;
+
    // May assume precondition: t0 <= t1
    std::pair<float, float> GetMinMax(
       double t0, double t1, bool mayThrow = true) const;
+   // Like GetMinMax, but of the samples in [start, start + len); space
+   // between clips does not count.  Answered from the block summaries
+   // wherever they cover the range, so much faster than reading samples.
+   std::pair<float, float> GetSampleMinMax(
+      sampleCount start, sampleCount len, bool mayThrow = true) const;
    // May assume precondition: t0 <= t1
    float GetRMS(double t0, double t1, bool mayThrow = true) const;
 
@@ -294,6 +326,8 @@ private:
    void HandleXMLEndTag(const wxChar *tag) override;
    XMLTagHandler *HandleXMLChild(const wxChar *tag) override;
    void WriteXML(XMLWriter &xmlFile) const override;
+   /// Write the clips through the cache, if it is not null
+   void WriteXML(XMLWriter &xmlFile, ClipXMLCache *pCache) const;
 
    // Returns true if an error occurred while reading from XML
    bool GetErrorOpening() override;
@@ -521,6 +555,10 @@ private:
 
    // Resample track (i.e. all clips in the track)
    void Resample(int rate, ProgressDialog *progress = NULL);
+   // Resample all clips of the tracks, such as the channels of a group,
+   // on worker threads, changing the tracks only if all succeed
+   static void Resample(const std::vector<WaveTrack*> &tracks,
+      int rate, ProgressDialog *progress = NULL);
 
    //
    // AutoSave related
@@ -593,6 +631,30 @@ private:
 
    std::unique_ptr<SpectrogramSettings> mpSpectrumSettings;
    std::unique_ptr<WaveformSettings> mpWaveformSettings;
+
+   struct ClipIndexEntry {
+      sampleCount start, end;
+      // The greatest end of this and all earlier entries
+      sampleCount maxEnd;
+      // Position of the clip in mClips
+      size_t order;
+      WaveClip *clip;
+   };
+   using ClipIndexEntries = std::vector<ClipIndexEntry>;
+
+   // The entries for clips with samples in [start, end), sorted by start
+   ClipIndexEntries FindClips(sampleCount start, sampleCount end) const;
+   // Rebuild the index if the clips changed; call with the mutex locked
+   void UpdateClipIndex() const;
+
+   // Get and Set may be called from the audio thread too
+   mutable std::mutex mClipIndexMutex;
+   // Validity of the index:  the generation of WaveClip positions, and the
+   // clips, in the order of mClips, when it was built
+   mutable unsigned long long mClipIndexGeneration{ 0 };
+   mutable std::vector<const WaveClip*> mIndexedClips;
+   // Sorted by start
+   mutable ClipIndexEntries mClipIndex;
 };
 
 // This is meant to be a short-lived object, during whose lifetime,
@@ -620,6 +682,14 @@ public:
    const std::shared_ptr<const WaveTrack>& GetTrack() const { return mPTrack; }
    void SetTrack(const std::shared_ptr<const WaveTrack> &pTrack);
 
+   // For consumers that mostly read forward, such as playback and export:
+   // once reads are seen to be sequential, the next few blocks are read on a
+   // background thread before they are asked for
+   void SetReadAhead(bool readAhead);
+
+   // Defined in WaveTrack.cpp, and shared with its reading thread
+   struct ReadAheadSlot;
+
    // Uses fillZero always
    // Returns null on failure
    // Returned pointer may be invalidated if Get is called again
@@ -630,6 +700,15 @@ public:
 private:
    void Free();
 
+   struct Buffer;
+   bool Fill(Buffer &buffer, sampleCount start, size_t len, bool mayThrow);
+   bool TakeReadAhead(Buffer &buffer, sampleCount start, size_t len);
+   void ScheduleReadAhead();
+   void ClearReadAhead();
+   // Free the spare buffers, and give back to CacheBudget all that were
+   // allocated; clear the slots first
+   void ReleaseReadAheadData();
+
    struct Buffer {
       Floats data;
       sampleCount start;
@@ -652,6 +731,48 @@ private:
    Buffer mBuffers[2];
    GrowableSampleBuffer mOverlapBuffer;
    int mNValidBuffers;
+
+   // Blocks being read, or already read, ahead of the buffers
+   std::vector< std::shared_ptr<ReadAheadSlot> > mReadAheadSlots;
+   // Buffers of slots no longer needed, for reuse
+   std::vector< Floats > mSpareReadAheadData;
+   // Accounted to CacheBudget, for all read-ahead buffers allocated
+   size_t mReadAheadBytes{ 0 };
+   bool mReadAhead{ false };
+   // End of the last fill of a buffer, and of the last block read ahead
+   sampleCount mLastFillEnd{ -1 };
+   sampleCount mReadAheadEnd{ 0 };
+};
+
+/// Remembers the XML of clips as last saved, so that the next save may write
+/// it again for each clip unchanged since, rather than format it again.
+/// Works with XMLFileWriter, keeping UTF-8 text, and with AutoSaveFile,
+/// keeping encoded subtrees.
+class AUDACITY_DLL_API ClipXMLCache final
+{
+public:
+   /// Write the clip, reusing its text or else remembering it
+   void WriteClip(XMLWriter &xmlFile, const WaveClip &clip);
+
+   /// After a successful save, pair the clips written with copies of them
+   /// that will not change, such as those of the saved or current undo state;
+   /// savedTracks duplicates tracks
+   void Commit(const TrackList &tracks, const TrackList &savedTracks);
+   /// Forget what a failed save wrote
+   void Abandon() { mWritten.clear(); }
+
+private:
+   struct Content {
+      std::string bytes; // UTF-8 text, or else encoded by AutoSaveFile
+      bool binary;
+   };
+   struct Entry {
+      // Copy of the clip made at the save, compared to the clip at the next
+      std::shared_ptr<const WaveClip> saved;
+      Content content;
+   };
+   std::unordered_map<const WaveClip*, Entry> mEntries;
+   std::unordered_map<const WaveClip*, Content> mWritten;
 };
 
 #endif // __AUDACITY_WAVETRACK__
@@ -0,0 +1,744 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CompressedBlockFile.cpp
+
+*******************************************************************//**
+
+\class CompressedBlockFile
+\brief A BlockFile whose samples are losslessly compressed
+
+If the preference "/Directories/CompressBlockFiles" is set, NEW blocks are
+written one .auz file each into the e00/d00 tree, in place of .au files.
+Each file is a short header, then the summary, as a SimpleBlockFile has it,
+then the samples, coded in the manner of FLAC and Shorten:  frames of
+4096 samples, each with the fixed polynomial predictor of order 0 to 3
+that leaves the smallest residuals, and those Rice coded.
+
+The coding works on integers.  16 and 24 bit samples are their own values.
+Floating point samples that are all exactly 16 or 24 bit values, as those
+of most imported and recorded audio are, become those values; other floats
+are mapped, in order, to the integers of their bit patterns, which still
+predict well where the exponent changes slowly.  So every block gives back
+exactly the samples that were written, with at most a few bytes per frame
+more than storing them raw.
+
+The header and summary are in native byte order, as for PackedBlockFile.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "CompressedBlockFile.h"
+
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
+
+#include "../BlockFileIOStats.h"
+#include "../DirManager.h"
+#include "../FileException.h"
+#include "../Internat.h"
+#include "../Prefs.h"
+#include "../xml/XMLWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+   struct CompressedBlockHeader {
+      char tag[4];
+      wxUint32 format;
+      wxUint32 samples;
+      wxUint32 summaryBytes;
+      wxUint32 dataBytes;
+      wxUint32 domain;
+   };
+
+   const char CompressedBlockTag[4] = { 'A', 'U', 'C', 'Z' };
+
+   // How the samples were made integers for coding
+   enum Domain : wxUint32 {
+      IntegerSamples,
+      // Floats that are exact multiples of 2^-15 or 2^-23
+      ScaledFloats15,
+      ScaledFloats23,
+      // Floats by their bit patterns
+      FloatBits,
+   };
+
+   constexpr size_t FrameLength = 4096;
+   constexpr unsigned MaxOrder = 3;
+   // Quotients this large are escaped, and the value written in full
+   constexpr unsigned EscapeQuotient = 32;
+   // Bits of frame headers
+   constexpr unsigned VerbatimHeaderBits = 1 + 7;
+   constexpr unsigned RiceHeaderBits = 1 + 2 + 6 + 7;
+
+   using Residual = unsigned long long;
+
+   inline Residual ZigZag(long long value)
+   {
+      return value < 0
+         ? ~(static_cast<Residual>(value) << 1)
+         : static_cast<Residual>(value) << 1;
+   }
+
+   inline long long UnZigZag(Residual residual)
+   {
+      return static_cast<long long>(
+         (residual >> 1) ^ (Residual{} - (residual & 1)));
+   }
+
+   // Prediction from history[1], history[2], history[3], the samples
+   // before; unsigned, so that a corrupt file can't overflow
+   inline Residual Predict(unsigned order, const Residual *history)
+   {
+      switch (order) {
+      default:
+      case 0:
+         return 0;
+      case 1:
+         return history[1];
+      case 2:
+         return 2 * history[1] - history[2];
+      case 3:
+         return 3 * history[1] - 3 * history[2] + history[3];
+      }
+   }
+
+   inline unsigned BitWidth(Residual value)
+   {
+      unsigned width = 0;
+      while (value) {
+         ++width;
+         value >>= 1;
+      }
+      return width;
+   }
+
+   class BitWriter {
+   public:
+      void Put(Residual value, unsigned bits)
+      {
+         while (bits > 32) {
+            bits -= 32;
+            Put32((value >> bits) & 0xffffffffULL, 32);
+         }
+         if (bits > 0)
+            Put32(value & ((1ULL << bits) - 1), bits);
+      }
+
+      void PutOnes(unsigned count)
+      {
+         while (count > 0) {
+            const auto bits = std::min(count, 32u);
+            Put32(0xffffffffULL >> (32 - bits), bits);
+            count -= bits;
+         }
+      }
+
+      std::vector<unsigned char> Finish()
+      {
+         if (mBits > 0)
+            Put32(0, 8 - mBits);
+         return std::move(mBytes);
+      }
+
+   private:
+      void Put32(Residual value, unsigned bits)
+      {
+         mAccumulator = (mAccumulator << bits) | value;
+         mBits += bits;
+         while (mBits >= 8) {
+            mBits -= 8;
+            mBytes.push_back(
+               static_cast<unsigned char>(mAccumulator >> mBits));
+         }
+      }
+
+      std::vector<unsigned char> mBytes;
+      Residual mAccumulator{ 0 };
+      unsigned mBits{ 0 };
+   };
+
+   class BitReader {
+   public:
+      BitReader(const unsigned char *data, size_t bytes)
+         : mData{ data }, mEnd{ data + bytes }, mAvailable{ 8 * bytes }
+      {}
+
+      Residual Get(unsigned bits)
+      {
+         Residual result = 0;
+         while (bits > 32) {
+            bits -= 32;
+            result |= Get32(32) << bits;
+         }
+         if (bits > 0)
+            result |= Get32(bits);
+         return result;
+      }
+
+      // Count of ones before a zero, or EscapeQuotient
+      unsigned GetQuotient()
+      {
+         unsigned quotient = 0;
+         while (quotient < EscapeQuotient && Get32(1))
+            ++quotient;
+         return quotient;
+      }
+
+      // False if more was read than there is
+      bool IsGood() const { return mConsumed <= mAvailable; }
+
+   private:
+      Residual Get32(unsigned bits)
+      {
+         while (mBits < bits) {
+            // Zeroes past the end, which IsGood() reports
+            mAccumulator = (mAccumulator << 8) | (mData < mEnd ? *mData++ : 0);
+            mBits += 8;
+         }
+         mBits -= bits;
+         mConsumed += bits;
+         return (mAccumulator >> mBits) & (0xffffffffULL >> (32 - bits));
+      }
+
+      const unsigned char *mData;
+      const unsigned char *const mEnd;
+      const size_t mAvailable;
+      size_t mConsumed{ 0 };
+      Residual mAccumulator{ 0 };
+      unsigned mBits{ 0 };
+   };
+
+   // Exact size of the frame's residuals Rice coded with parameter k
+   unsigned long long RiceBits(
+      const Residual *residuals, size_t count, unsigned k, unsigned width)
+   {
+      unsigned long long bits = 0;
+      for (size_t ii = 0; ii < count; ++ii) {
+         const auto quotient = residuals[ii] >> k;
+         bits += quotient < EscapeQuotient
+            ? quotient + 1 + k
+            : EscapeQuotient + width;
+      }
+      return bits;
+   }
+
+   // Each frame is a flag for verbatim samples, the predictor order, the
+   // Rice parameter unless verbatim, and the width of escaped values
+   std::vector<unsigned char> Encode(const long long *values, size_t count)
+   {
+      BitWriter writer;
+      Residual history[MaxOrder + 1]{};
+      std::vector<Residual> residuals[MaxOrder + 1];
+      for (auto &frame : residuals)
+         frame.resize(FrameLength);
+
+      for (size_t frameStart = 0; frameStart < count;
+           frameStart += FrameLength) {
+         const auto frameLength = std::min(FrameLength, count - frameStart);
+
+         Residual frameHistory[MaxOrder + 1];
+         std::copy(history, history + MaxOrder + 1, frameHistory);
+         unsigned long long sums[MaxOrder + 1]{};
+         for (size_t ii = 0; ii < frameLength; ++ii) {
+            frameHistory[0] = static_cast<Residual>(values[frameStart + ii]);
+            for (unsigned order = 0; order <= MaxOrder; ++order) {
+               const auto residual = static_cast<long long>(
+                  frameHistory[0] - Predict(order, frameHistory));
+               residuals[order][ii] = ZigZag(residual);
+               sums[order] += residuals[order][ii] >> 1;
+            }
+            std::copy_backward(frameHistory, frameHistory + MaxOrder,
+               frameHistory + MaxOrder + 1);
+         }
+         std::copy(frameHistory, frameHistory + MaxOrder + 1, history);
+
+         const unsigned order =
+            std::min_element(sums, sums + MaxOrder + 1) - sums;
+         const auto &chosen = residuals[order];
+         const auto width = BitWidth(*std::max_element(
+            chosen.begin(), chosen.begin() + frameLength));
+
+         // The best parameter is near the log of the mean
+         const unsigned estimate =
+            BitWidth(2 * sums[order] / frameLength + 1) - 1;
+         unsigned k = 0;
+         auto bits = RiceBits(chosen.data(), frameLength, 0, width);
+         for (unsigned candidate = std::max(estimate, 1u) - 1;
+              candidate <= std::min(estimate + 1, 63u); ++candidate) {
+            const auto candidateBits =
+               RiceBits(chosen.data(), frameLength, candidate, width);
+            if (candidateBits < bits)
+               k = candidate, bits = candidateBits;
+         }
+
+         const auto &plain = residuals[0];
+         const auto plainWidth = BitWidth(*std::max_element(
+            plain.begin(), plain.begin() + frameLength));
+         if (VerbatimHeaderBits + plainWidth * frameLength <=
+             RiceHeaderBits + bits) {
+            writer.Put(1, 1);
+            writer.Put(plainWidth, 7);
+            for (size_t ii = 0; ii < frameLength; ++ii)
+               writer.Put(plain[ii], plainWidth);
+            continue;
+         }
+
+         writer.Put(0, 1);
+         writer.Put(order, 2);
+         writer.Put(k, 6);
+         writer.Put(width, 7);
+         for (size_t ii = 0; ii < frameLength; ++ii) {
+            const auto residual = chosen[ii];
+            const auto quotient = residual >> k;
+            if (quotient < EscapeQuotient) {
+               writer.PutOnes(quotient);
+               writer.Put(0, 1);
+               writer.Put(residual, k);
+            }
+            else {
+               writer.PutOnes(EscapeQuotient);
+               writer.Put(residual, width);
+            }
+         }
+      }
+
+      return writer.Finish();
+   }
+
+   // Decode whole frames until at least needed of the count values are
+   // known
+   bool Decode(const unsigned char *data, size_t bytes,
+      long long *values, size_t count, size_t needed)
+   {
+      BitReader reader{ data, bytes };
+      Residual history[MaxOrder + 1]{};
+      for (size_t frameStart = 0; frameStart < needed;
+           frameStart += FrameLength) {
+         const auto frameLength = std::min(FrameLength, count - frameStart);
+         const auto verbatim = reader.Get(1);
+         const unsigned order = verbatim ? 0 : reader.Get(2);
+         const unsigned k = verbatim ? 0 : reader.Get(6);
+         const unsigned width = std::min<unsigned>(reader.Get(7), 64);
+         if (!reader.IsGood())
+            return false;
+
+         for (size_t ii = 0; ii < frameLength; ++ii) {
+            Residual residual;
+            if (verbatim)
+               residual = reader.Get(width);
+            else {
+               const auto quotient = reader.GetQuotient();
+               residual = quotient < EscapeQuotient
+                  ? (static_cast<Residual>(quotient) << k) | reader.Get(k)
+                  : reader.Get(width);
+            }
+            history[0] = Predict(order, history) +
+               static_cast<Residual>(UnZigZag(residual));
+            values[frameStart + ii] = static_cast<long long>(history[0]);
+            std::copy_backward(history, history + MaxOrder,
+               history + MaxOrder + 1);
+         }
+      }
+      return reader.IsGood();
+   }
+
+   // Order preserving, and its own inverse
+   inline wxInt32 MapFloatBits(wxInt32 bits)
+   {
+      return bits < 0 ? bits ^ 0x7fffffff : bits;
+   }
+
+   Domain ChooseDomain(samplePtr sampleData, size_t len, sampleFormat format)
+   {
+      if (format != floatSample)
+         return IntegerSamples;
+
+      const auto samples = reinterpret_cast<const float*>(sampleData);
+      const auto exact = [&](int shift) -> bool {
+         const float scale = 1 << shift;
+         for (size_t ii = 0; ii < len; ++ii) {
+            const float scaled = samples[ii] * scale;
+            if (!(std::abs(scaled) < 2147483648.0f))
+               return false;
+            // Compare bits, so that -0.0 and NaN are not taken
+            const float back = static_cast<wxInt32>(scaled) / scale;
+            if (memcmp(&back, &samples[ii], sizeof(float)) != 0)
+               return false;
+         }
+         return true;
+      };
+      if (exact(15))
+         return ScaledFloats15;
+      if (exact(23))
+         return ScaledFloats23;
+      return FloatBits;
+   }
+
+   void ToIntegers(samplePtr sampleData, size_t len, sampleFormat format,
+      Domain domain, long long *values)
+   {
+      if (format == int16Sample) {
+         const auto samples = reinterpret_cast<const short*>(sampleData);
+         std::copy(samples, samples + len, values);
+         return;
+      }
+      if (format == int24Sample) {
+         const auto samples = reinterpret_cast<const int*>(sampleData);
+         std::copy(samples, samples + len, values);
+         return;
+      }
+
+      const auto samples = reinterpret_cast<const float*>(sampleData);
+      const float scale = domain == ScaledFloats15 ? 1 << 15 : 1 << 23;
+      for (size_t ii = 0; ii < len; ++ii) {
+         if (domain == FloatBits) {
+            wxInt32 bits;
+            memcpy(&bits, &samples[ii], sizeof(bits));
+            values[ii] = MapFloatBits(bits);
+         }
+         else
+            values[ii] = static_cast<wxInt32>(samples[ii] * scale);
+      }
+   }
+
+   void FromIntegers(const long long *values, size_t len, sampleFormat format,
+      Domain domain, samplePtr sampleData)
+   {
+      if (format == int16Sample) {
+         const auto samples = reinterpret_cast<short*>(sampleData);
+         for (size_t ii = 0; ii < len; ++ii)
+            samples[ii] = static_cast<short>(values[ii]);
+         return;
+      }
+      if (format == int24Sample) {
+         const auto samples = reinterpret_cast<int*>(sampleData);
+         for (size_t ii = 0; ii < len; ++ii)
+            samples[ii] = static_cast<int>(values[ii]);
+         return;
+      }
+
+      const auto samples = reinterpret_cast<float*>(sampleData);
+      const float scale = domain == ScaledFloats15 ? 1 << 15 : 1 << 23;
+      for (size_t ii = 0; ii < len; ++ii) {
+         if (domain == FloatBits) {
+            const auto bits = MapFloatBits(static_cast<wxInt32>(values[ii]));
+            memcpy(&samples[ii], &bits, sizeof(bits));
+         }
+         else
+            samples[ii] = static_cast<wxInt32>(values[ii]) / scale;
+      }
+   }
+}
+
+/// Create a disk file and write compressed data to it
+///
+/// @param baseFileName The filename to use, but without an extension.
+///                     This constructor will add the appropriate
+///                     extension (.auz in this case).
+/// @param sampleData   The sample data to be written to this block.
+/// @param sampleLen    The number of samples to be written to this block.
+/// @param format       The format of the given samples.
+CompressedBlockFile::CompressedBlockFile(wxFileNameWrapper &&baseFileName,
+                                         samplePtr sampleData, size_t sampleLen,
+                                         sampleFormat format)
+   : BlockFile{
+      (baseFileName.SetExt(wxT("auz")), std::move(baseFileName)),
+      sampleLen
+   }
+   , mFormat{ format }
+{
+   ArrayOf<char> cleanup;
+   void *summaryData = BlockFile::CalcSummary(sampleData, sampleLen,
+                                             format, cleanup);
+   WriteCompressedBlockFile(sampleData, format, summaryData);
+}
+
+/// Construct a CompressedBlockFile memory structure that will point to an
+/// existing block file.  This file must exist and be a valid block file.
+///
+/// @param existingFile The disk file this CompressedBlockFile should use.
+CompressedBlockFile::CompressedBlockFile(wxFileNameWrapper &&existingFile,
+                                         size_t len, sampleFormat format,
+                                         float min, float max, float rms)
+   : BlockFile{ std::move(existingFile), len }
+   , mFormat{ format }
+{
+   mMin = min;
+   mMax = max;
+   mRMS = rms;
+}
+
+CompressedBlockFile::~CompressedBlockFile()
+{
+}
+
+void CompressedBlockFile::WriteCompressedBlockFile(
+   samplePtr sampleData, sampleFormat format, const void *summaryData)
+{
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Compressed, BlockFileIOStats::Write };
+   stats.SetBytes(mLen * SAMPLE_SIZE(format));
+
+   const auto domain = ChooseDomain(sampleData, mLen, format);
+   std::vector<long long> values(mLen);
+   ToIntegers(sampleData, mLen, format, domain, values.data());
+   const auto coded = Encode(values.data(), mLen);
+
+   CompressedBlockHeader header;
+   memcpy(header.tag, CompressedBlockTag, sizeof(header.tag));
+   header.format = format;
+   header.samples = mLen;
+   header.summaryBytes = mSummaryInfo.totalSummaryBytes;
+   header.dataBytes = coded.size();
+   header.domain = domain;
+
+   wxFFile file(mFileName.GetFullPath(), wxT("wb"));
+   if (!file.IsOpened() ||
+       file.Write(&header, sizeof(header)) != sizeof(header) ||
+       file.Write(summaryData, mSummaryInfo.totalSummaryBytes) !=
+          mSummaryInfo.totalSummaryBytes ||
+       (!coded.empty() &&
+        file.Write(coded.data(), coded.size()) != coded.size()) ||
+       !file.Close())
+      throw FileException{ FileException::Cause::Write, mFileName };
+
+   mFormat = format;
+   mFileBytes =
+      sizeof(header) + mSummaryInfo.totalSummaryBytes + coded.size();
+}
+
+/// Read the summary section of the disk file.
+///
+/// @param *data The buffer to write the data to.  It must be at least
+/// mSummaryinfo.totalSummaryBytes long.
+bool CompressedBlockFile::ReadSummary(ArrayOf<char> &data)
+{
+   data.reinit( mSummaryInfo.totalSummaryBytes );
+
+   wxFFile file;
+   CompressedBlockHeader header;
+   bool success;
+   {
+      wxLogNull silence;
+      success = file.Open(mFileName.GetFullPath(), wxT("rb"));
+   }
+   success = success &&
+      file.Read(&header, sizeof(header)) == sizeof(header) &&
+      memcmp(header.tag, CompressedBlockTag, sizeof(header.tag)) == 0 &&
+      header.samples == mLen &&
+      header.summaryBytes == mSummaryInfo.totalSummaryBytes &&
+      file.Read(data.get(), mSummaryInfo.totalSummaryBytes) ==
+         mSummaryInfo.totalSummaryBytes;
+   if (!success) {
+      if (!mSilentLog)
+         wxLogWarning(wxT("CompressedBlockFile: missing summary in %s"),
+            mFileName.GetFullPath());
+      mSilentLog = TRUE;
+      memset(data.get(), 0, mSummaryInfo.totalSummaryBytes);
+      return false;
+   }
+   mSilentLog = FALSE;
+
+   return true;
+}
+
+bool CompressedBlockFile::ReadSamples(samplePtr buffer, size_t count) const
+{
+   wxFFile file;
+   {
+      wxLogNull silence;
+      if (!file.Open(mFileName.GetFullPath(), wxT("rb")))
+         return false;
+   }
+
+   CompressedBlockHeader header;
+   if (file.Read(&header, sizeof(header)) != sizeof(header) ||
+       memcmp(header.tag, CompressedBlockTag, sizeof(header.tag)) != 0 ||
+       header.format != static_cast<wxUint32>(mFormat) ||
+       header.samples != mLen ||
+       header.domain > FloatBits ||
+       static_cast<wxFileOffset>(header.dataBytes) > file.Length() ||
+       (header.domain != IntegerSamples && mFormat != floatSample) ||
+       !file.Seek(sizeof(header) + header.summaryBytes))
+      return false;
+
+   ArrayOf<unsigned char> coded{ header.dataBytes };
+   if (file.Read(coded.get(), header.dataBytes) != header.dataBytes)
+      return false;
+
+   std::vector<long long> values(mLen);
+   if (!Decode(coded.get(), header.dataBytes, values.data(), mLen, count))
+      return false;
+   FromIntegers(values.data(), count, mFormat,
+      static_cast<Domain>(header.domain), buffer);
+   return true;
+}
+
+/// Read the data portion of the block file, decoding it from the start of
+/// the block.  Convert it to the given format if it is not already.
+///
+/// @param data   The buffer where the data will be stored
+/// @param format The format the data will be stored in
+/// @param start  The offset in this block file
+/// @param len    The number of samples to read
+size_t CompressedBlockFile::ReadData(samplePtr data, sampleFormat format,
+                        size_t start, size_t len, bool mayThrow) const
+{
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Compressed, BlockFileIOStats::FileRead };
+   stats.SetBytes(len * SAMPLE_SIZE(format));
+
+   auto framesRead = std::min(len, std::max(start, mLen) - start);
+   if (framesRead > 0) {
+      SampleBuffer buffer(start + framesRead, mFormat);
+      if (ReadSamples(buffer.ptr(), start + framesRead))
+         CopySamples(buffer.ptr() + start * SAMPLE_SIZE(mFormat), mFormat,
+            data, format, framesRead);
+      else
+         framesRead = 0;
+   }
+
+   if ( framesRead < len ) {
+      if (mayThrow)
+         throw FileException{ FileException::Cause::Read, mFileName };
+      ClearSamples(data, format, framesRead, len - framesRead);
+   }
+
+   return framesRead;
+}
+
+void CompressedBlockFile::SaveXML(XMLWriter &xmlFile)
+// may throw
+{
+   xmlFile.StartTag(wxT("compressedblockfile"));
+
+   xmlFile.WriteAttr(wxT("filename"), mFileName.GetFullName());
+   xmlFile.WriteAttr(wxT("len"), mLen);
+   xmlFile.WriteAttr(wxT("format"), static_cast<int>(mFormat));
+   xmlFile.WriteAttr(wxT("min"), mMin);
+   xmlFile.WriteAttr(wxT("max"), mMax);
+   xmlFile.WriteAttr(wxT("rms"), mRMS);
+
+   xmlFile.EndTag(wxT("compressedblockfile"));
+}
+
+// BuildFromXML methods should always return a BlockFile, not NULL,
+// even if the result is flawed (e.g., refers to nonexistent file),
+// as testing will be done in ProjectFSCK().
+/// static
+BlockFilePtr CompressedBlockFile::BuildFromXML(
+   DirManager &dm, const wxChar **attrs)
+{
+   wxFileNameWrapper fileName;
+   sampleFormat format = floatSample;
+   float min = 0.0f, max = 0.0f, rms = 0.0f;
+   size_t len = 0;
+   double dblValue;
+   long nValue;
+
+   while(*attrs)
+   {
+      const wxChar *attr =  *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (!wxStricmp(attr, wxT("filename")) &&
+            // Can't use XMLValueChecker::IsGoodFileName here, but do part of its test.
+            XMLValueChecker::IsGoodFileString(strValue) &&
+            (strValue.length() + 1 + dm.GetProjectDataDir().length() <= PLATFORM_MAX_PATH))
+      {
+         if (!dm.AssignFile(fileName, strValue, false))
+            // Make sure fileName is back to uninitialized state so we can detect problem later.
+            fileName.Clear();
+      }
+      else if (!wxStrcmp(attr, wxT("len")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               nValue > 0)
+         len = nValue;
+      else if (!wxStrcmp(attr, wxT("format")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               XMLValueChecker::IsValidSampleFormat(nValue))
+         format = static_cast<sampleFormat>(nValue);
+      else if (XMLValueChecker::IsGoodString(strValue) && Internat::CompatibleToDouble(strValue, &dblValue))
+      {  // double parameters
+         if (!wxStricmp(attr, wxT("min")))
+            min = dblValue;
+         else if (!wxStricmp(attr, wxT("max")))
+            max = dblValue;
+         else if (!wxStricmp(attr, wxT("rms")) && (dblValue >= 0.0))
+            rms = dblValue;
+      }
+   }
+
+   return make_blockfile<CompressedBlockFile>
+      (std::move(fileName), len, format, min, max, rms);
+}
+
+/// Create a copy of this BlockFile, but using a different disk file.
+///
+/// @param newFileName The name of the NEW file to use.
+BlockFilePtr CompressedBlockFile::Copy(wxFileNameWrapper &&newFileName)
+{
+   return make_blockfile<CompressedBlockFile>
+      (std::move(newFileName), mLen, mFormat, mMin, mMax, mRMS);
+}
+
+auto CompressedBlockFile::GetSpaceUsage() const -> DiskByteCount
+{
+   if (mFileBytes == 0) {
+      wxFFile file;
+      {
+         wxLogNull silence;
+         if (!file.Open(mFileName.GetFullPath(), wxT("rb")))
+            return 0;
+      }
+      const auto length = file.Length();
+      if (length > 0)
+         mFileBytes = length;
+   }
+   return mFileBytes;
+}
+
+void CompressedBlockFile::PrepareLoaded() const
+{
+   // A missing file is reported later by ProjectFSCK, not here
+   GetSpaceUsage();
+}
+
+void CompressedBlockFile::Recover()
+{
+   ArrayOf<char> summaryData{ mSummaryInfo.totalSummaryBytes, true };
+   SampleBuffer sampleData(mLen, mFormat);
+   ClearSamples(sampleData.ptr(), mFormat, 0, mLen);
+   try {
+      WriteCompressedBlockFile(sampleData.ptr(), mFormat, summaryData.get());
+   }
+   catch ( const FileException & ) {
+      // Can't do anything else.
+      return;
+   }
+   mSilentLog = FALSE;
+}
+
+bool CompressedBlockFile::GetCompressBlockFiles()
+{
+   bool compressBlockFiles = false;
+   gPrefs->Read(wxT("/Directories/CompressBlockFiles"), &compressBlockFiles);
+   return compressBlockFiles;
+}
+
+static DirManager::RegisteredBlockFileDeserializer sRegistration {
+   "compressedblockfile",
+   []( DirManager &dm, const wxChar **attrs ){
+      return CompressedBlockFile::BuildFromXML( dm, attrs );
+   }
+};
@@ -0,0 +1,69 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CompressedBlockFile.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_COMPRESSED_BLOCKFILE__
+#define __AUDACITY_COMPRESSED_BLOCKFILE__
+
+#include "../BlockFile.h"
+
+class DirManager;
+
+/// A BlockFile whose samples are stored losslessly compressed, in a file
+/// of its own like a SimpleBlockFile
+class PROFILE_DLL_API CompressedBlockFile final : public BlockFile {
+ public:
+
+   // Constructor / Destructor
+
+   /// Create a disk file and write compressed summary and sample data to it
+   CompressedBlockFile(wxFileNameWrapper &&baseFileName,
+                       samplePtr sampleData, size_t sampleLen,
+                       sampleFormat format);
+   /// Create the memory structure to refer to the given block file
+   CompressedBlockFile(wxFileNameWrapper &&existingFile, size_t len,
+                       sampleFormat format,
+                       float min, float max, float rms);
+
+   virtual ~CompressedBlockFile();
+
+   // Reading
+
+   /// Read the summary section of the disk file
+   bool ReadSummary(ArrayOf<char> &data) override;
+   /// Decode the data section of the disk file
+   size_t ReadData(samplePtr data, sampleFormat format,
+                        size_t start, size_t len, bool mayThrow) const override;
+
+   /// Create a NEW block file identical to this one
+   BlockFilePtr Copy(wxFileNameWrapper &&newFileName) override;
+   /// Write an XML representation of this file
+   void SaveXML(XMLWriter &xmlFile) override;
+   DiskByteCount GetSpaceUsage() const override;
+   void PrepareLoaded() const override;
+   /// Rewrite the file as one of silence
+   void Recover() override;
+
+   static BlockFilePtr BuildFromXML(DirManager &dm, const wxChar **attrs);
+
+   /// Whether NEW blocks should be compressed, rather than simple block files
+   static bool GetCompressBlockFiles();
+
+   sampleFormat GetFormat() const { return mFormat; }
+
+ private:
+   void WriteCompressedBlockFile(samplePtr sampleData, sampleFormat format,
+                                 const void *summaryData);
+   /// Decode the first count samples, in mFormat
+   bool ReadSamples(samplePtr buffer, size_t count) const;
+
+   sampleFormat mFormat;
+   // Size of the file, found when first needed for a loaded block
+   mutable DiskByteCount mFileBytes{ 0 };
+};
+
+#endif
@@ -30,6 +30,7 @@
 #include <wx/utils.h>
 #include <wx/log.h>
 
+#include "../BlockFileIOStats.h"
 #include "../FileFormats.h"
 #include "../xml/XMLTagHandler.h"
 
@@ -195,6 +196,9 @@ bool LegacyBlockFile::ReadSummary(ArrayOf<char> &data)
 size_t LegacyBlockFile::ReadData(samplePtr data, sampleFormat format,
                               size_t start, size_t len, bool mayThrow) const
 {
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Legacy, BlockFileIOStats::FileRead };
+   stats.SetBytes(len * SAMPLE_SIZE(format));
    sf_count_t origin = (mSummaryInfo.totalSummaryBytes / SAMPLE_SIZE(mFormat));
    return CommonReadData( mayThrow,
       mFileName, mSilentLog, nullptr, origin, 0, data, format, start, len,
@@ -269,16 +269,8 @@ BlockFilePtr ODDecodeBlockFile::BuildFromXML(DirManager &dm, const wxChar **attr
       }
       else if( !wxStricmp(attr, wxT("audiofile")) )
       {
-         if (XMLValueChecker::IsGoodPathName(strValue))
-            audioFileName.Assign(strValue);
-         else if (XMLValueChecker::IsGoodFileName(strValue, dm.GetProjectDataDir()))
-            // Allow fallback of looking for the file name, located in the data directory.
-            audioFileName.Assign(dm.GetProjectDataDir(), strValue);
-         else if (XMLValueChecker::IsGoodPathString(strValue))
-            // If the file is missing, we failed XMLValueChecker::IsGoodPathName()
-            // and XMLValueChecker::IsGoodFileName, because both do existence tests,
-            // but we want to keep the reference to the file because it's a good path string.
-            audioFileName.Assign(strValue);
+         // A missing file is found when decoding
+         dm.AssignAliasedFile(audioFileName, strValue, dm.GetProjectDataDir());
       }
       else if ( !wxStricmp(attr, wxT("aliasstart")) )
       {
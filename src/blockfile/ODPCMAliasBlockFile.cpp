@@ -28,6 +28,7 @@ The summary is eventually computed and written to a file in a background thread.
 #include <wx/thread.h>
 #include <sndfile.h>
 
+#include "../BlockFileIOStats.h"
 #include "../DirManager.h"
 #include "../FileFormats.h"
 
@@ -298,16 +299,8 @@ BlockFilePtr ODPCMAliasBlockFile::BuildFromXML(DirManager &dm, const wxChar **at
       }
       else if( !wxStricmp(attr, wxT("aliasfile")) )
       {
-         if (XMLValueChecker::IsGoodPathName(strValue))
-            aliasFileName.Assign(strValue);
-         else if (XMLValueChecker::IsGoodFileName(strValue, dm.GetProjectDataDir()))
-            // Allow fallback of looking for the file name, located in the data directory.
-            aliasFileName.Assign(dm.GetProjectDataDir(), strValue);
-         else if (XMLValueChecker::IsGoodPathString(strValue))
-            // If the aliased file is missing, we failed XMLValueChecker::IsGoodPathName()
-            // and XMLValueChecker::IsGoodFileName, because both do existence tests,
-            // but we want to keep the reference to the missing file because it's a good path string.
-            aliasFileName.Assign(strValue);
+         // The file is looked for later, by ProjectFSCK
+         dm.AssignAliasedFile(aliasFileName, strValue, dm.GetProjectDataDir());
       }
       else if ( !wxStricmp(attr, wxT("aliasstart")) )
       {
@@ -501,6 +494,9 @@ size_t ODPCMAliasBlockFile::ReadData(samplePtr data, sampleFormat format,
       return len;
    }
 
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Alias, BlockFileIOStats::FileRead };
+   stats.SetBytes(len * SAMPLE_SIZE(format));
    return CommonReadData( mayThrow,
       mAliasedFileName, mSilentAliasLog, this, mAliasStart, mAliasChannel,
       data, format, start, len);
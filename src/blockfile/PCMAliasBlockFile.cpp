@@ -18,6 +18,7 @@
 
 #include <sndfile.h>
 
+#include "../BlockFileIOStats.h"
 #include "../FileFormats.h"
 
 #include "../DirManager.h"
@@ -76,6 +77,9 @@ size_t PCMAliasBlockFile::ReadData(samplePtr data, sampleFormat format,
       return len;
    }
 
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Alias, BlockFileIOStats::FileRead };
+   stats.SetBytes(len * SAMPLE_SIZE(format));
    return CommonReadData( mayThrow,
       mAliasedFileName, mSilentAliasLog, this, mAliasStart, mAliasChannel,
       data, format, start, len);
@@ -144,16 +148,8 @@ BlockFilePtr PCMAliasBlockFile::BuildFromXML(DirManager &dm, const wxChar **attr
       }
       else if (!wxStricmp(attr, wxT("aliasfile")))
       {
-         if (XMLValueChecker::IsGoodPathName(strValue))
-            aliasFileName.Assign(strValue);
-         else if (XMLValueChecker::IsGoodFileName(strValue, dm.GetProjectDataDir()))
-            // Allow fallback of looking for the file name, located in the data directory.
-            aliasFileName.Assign(dm.GetProjectDataDir(), strValue);
-         else if (XMLValueChecker::IsGoodPathString(strValue))
-            // If the aliased file is missing, we failed XMLValueChecker::IsGoodPathName()
-            // and XMLValueChecker::IsGoodFileName, because both do existence tests,
-            // but we want to keep the reference to the missing file because it's a good path string.
-            aliasFileName.Assign(strValue);
+         // The file is looked for later, by ProjectFSCK
+         dm.AssignAliasedFile(aliasFileName, strValue, dm.GetProjectDataDir());
       }
       else if ( !wxStricmp(attr, wxT("aliasstart")) )
       {
@@ -0,0 +1,397 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockFile.cpp
+
+*******************************************************************//**
+
+\file PackedBlockFile.cpp
+\brief Implements PackedBlockFile and BlockPack.
+
+*//****************************************************************//**
+
+\class PackedBlockFile
+\brief A BlockFile stored as an extent of a large pack file
+
+If the preference "/Directories/PackBlockFiles" is set, NEW blocks are
+appended to a few large pack files in the project data directory, instead
+of being written one .au file each into the e00/d00 tree.  That saves the
+open, backup, copy and check of a long project from hundreds of thousands
+of filesystem metadata operations.
+
+Each extent is a short header, then the summary, then the samples in the
+block's own sample format and native byte order.  The index of the extents
+is the project file itself:  each packedblockfile tag names its pack and
+offset.
+
+Extents are never rewritten or reused, so copies of a block share them, and
+a saved project stays valid while the pack grows.  Space held by discarded
+blocks is not reclaimed; a pack file is removed only if no block in it ever
+belonged to a saved project.
+
+*//****************************************************************//**
+
+\class BlockPack
+\brief An append-only file of PackedBlockFile extents
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "PackedBlockFile.h"
+
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
+
+#include "../BlockFileIOStats.h"
+#include "../DirManager.h"
+#include "../FileException.h"
+#include "../Internat.h"
+#include "../Prefs.h"
+#include "../xml/XMLWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+   // Precedes the summary and samples of each extent, so that a pack can be
+   // checked without the project file
+   struct PackedBlockHeader {
+      char tag[4];
+      wxUint32 format;
+      wxUint32 samples;
+      wxUint32 summaryBytes;
+   };
+
+   const char PackedBlockTag[4] = { 'A', 'U', 'P', 'B' };
+}
+
+BlockPack::BlockPack(
+   wxFileNameWrapper &&fileName, wxFileOffset size, bool kept)
+   : mFileName{ std::move(fileName) }
+   , mSize{ size }
+   , mKept{ kept }
+{
+}
+
+BlockPack::~BlockPack()
+{
+   if (!IsKept() && mFileName.HasName())
+      wxRemoveFile(mFileName.GetFullPath());
+}
+
+wxFileNameWrapper BlockPack::GetFileName() const
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   return mFileName;
+}
+
+void BlockPack::SetFileName(wxFileNameWrapper &&fileName)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   mFileName = std::move(fileName);
+}
+
+wxFileOffset BlockPack::GetSize() const
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   return mSize;
+}
+
+wxFileOffset BlockPack::Append(
+   const void *const *pieces, const size_t *sizes, size_t nPieces)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+
+   // Not opened for appending, so that the next extent goes after the last
+   // good one, even when an earlier write failed part way
+   const auto path = mFileName.GetFullPath();
+   wxFFile file;
+   if (!file.Open(path, wxFileExists(path) ? wxT("r+b") : wxT("w+b")) ||
+       !file.Seek(mSize))
+      throw FileException{ FileException::Cause::Open, mFileName };
+
+   wxFileOffset total = 0;
+   for (size_t ii = 0; ii < nPieces; ++ii) {
+      if (sizes[ii] > 0 &&
+          file.Write(pieces[ii], sizes[ii]) != sizes[ii])
+         throw FileException{ FileException::Cause::Write, mFileName };
+      total += sizes[ii];
+   }
+   if (!file.Close())
+      throw FileException{ FileException::Cause::Write, mFileName };
+
+   const auto offset = mSize;
+   mSize += total;
+   return offset;
+}
+
+bool BlockPack::Read(wxFileOffset offset, void *buffer, size_t bytes) const
+{
+   // Extents don't change once written, so only the name needs the lock
+   const auto path = GetFileName().GetFullPath();
+
+   wxFFile file;
+   {
+      wxLogNull silence;
+      if (path.empty() || !file.Open(path, wxT("rb")))
+         return false;
+   }
+   return file.Seek(offset) && file.Read(buffer, bytes) == bytes;
+}
+
+/// @param pack         The pack to which the block is appended.
+/// @param sampleData   The sample data to be written to this block.
+/// @param sampleLen    The number of samples to be written to this block.
+/// @param format       The format of the given samples.
+PackedBlockFile::PackedBlockFile(std::shared_ptr<BlockPack> pack,
+                                 samplePtr sampleData, size_t sampleLen,
+                                 sampleFormat format)
+   : BlockFile{ wxFileNameWrapper{}, sampleLen }
+   , mPack{ std::move(pack) }
+   , mFormat{ format }
+{
+   ArrayOf<char> cleanup;
+   void *summaryData = BlockFile::CalcSummary(sampleData, sampleLen,
+                                             format, cleanup);
+   AppendExtent(sampleData, format, summaryData);
+}
+
+PackedBlockFile::PackedBlockFile(std::shared_ptr<BlockPack> pack,
+                                 wxFileOffset offset, size_t len,
+                                 sampleFormat format,
+                                 float min, float max, float rms)
+   : BlockFile{ wxFileNameWrapper{}, len }
+   , mPack{ std::move(pack) }
+   , mOffset{ offset }
+   , mFormat{ format }
+{
+   mMin = min;
+   mMax = max;
+   mRMS = rms;
+}
+
+PackedBlockFile::~PackedBlockFile()
+{
+}
+
+void PackedBlockFile::AppendExtent(
+   samplePtr sampleData, sampleFormat format, const void *summaryData)
+{
+   PackedBlockHeader header;
+   memcpy(header.tag, PackedBlockTag, sizeof(header.tag));
+   header.format = format;
+   header.samples = mLen;
+   header.summaryBytes = mSummaryInfo.totalSummaryBytes;
+
+   const void *const pieces[] = { &header, summaryData, sampleData };
+   const size_t sizes[] = {
+      sizeof(header),
+      mSummaryInfo.totalSummaryBytes,
+      mLen * SAMPLE_SIZE(format)
+   };
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Packed, BlockFileIOStats::Write };
+   stats.SetBytes(sizes[2]);
+   mOffset = mPack->Append(pieces, sizes, 3);
+   mFormat = format;
+}
+
+wxFileOffset PackedBlockFile::SamplesOffset() const
+{
+   return mOffset + sizeof(PackedBlockHeader) + mSummaryInfo.totalSummaryBytes;
+}
+
+/// Read the summary section of the extent.
+///
+/// @param *data The buffer to write the data to.  It must be at least
+/// mSummaryinfo.totalSummaryBytes long.
+bool PackedBlockFile::ReadSummary(ArrayOf<char> &data)
+{
+   data.reinit( mSummaryInfo.totalSummaryBytes );
+
+   PackedBlockHeader header;
+   if (!mPack->Read(mOffset, &header, sizeof(header)) ||
+       memcmp(header.tag, PackedBlockTag, sizeof(header.tag)) != 0 ||
+       header.samples != mLen ||
+       header.summaryBytes != mSummaryInfo.totalSummaryBytes ||
+       !mPack->Read(mOffset + sizeof(header), data.get(),
+          mSummaryInfo.totalSummaryBytes)) {
+      if (!mSilentLog)
+         wxLogWarning(wxT("PackedBlockFile: missing summary at %lld in %s"),
+            (long long) mOffset, mPack->GetFileName().GetFullPath());
+      mSilentLog = TRUE;
+      memset(data.get(), 0, mSummaryInfo.totalSummaryBytes);
+      return false;
+   }
+   mSilentLog = FALSE;
+
+   return true;
+}
+
+/// Read the data portion of the extent.  Convert it to the given format if
+/// it is not already.
+///
+/// @param data   The buffer where the data will be stored
+/// @param format The format the data will be stored in
+/// @param start  The offset in this block file
+/// @param len    The number of samples to read
+size_t PackedBlockFile::ReadData(samplePtr data, sampleFormat format,
+                        size_t start, size_t len, bool mayThrow) const
+{
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Packed, BlockFileIOStats::FileRead };
+   stats.SetBytes(len * SAMPLE_SIZE(format));
+
+   auto framesRead = std::min(len, std::max(start, mLen) - start);
+   if (framesRead > 0) {
+      const auto offset = SamplesOffset() + start * SAMPLE_SIZE(mFormat);
+      const auto bytes = framesRead * SAMPLE_SIZE(mFormat);
+      bool success;
+      if (format == mFormat)
+         success = mPack->Read(offset, data, bytes);
+      else {
+         SampleBuffer buffer(framesRead, mFormat);
+         success = mPack->Read(offset, buffer.ptr(), bytes);
+         if (success)
+            CopySamples(buffer.ptr(), mFormat, data, format, framesRead);
+      }
+      if (!success)
+         framesRead = 0;
+   }
+
+   if ( framesRead < len ) {
+      if (mayThrow)
+         throw FileException{
+            FileException::Cause::Read, mPack->GetFileName() };
+      ClearSamples(data, format, framesRead, len - framesRead);
+   }
+
+   return framesRead;
+}
+
+void PackedBlockFile::SaveXML(XMLWriter &xmlFile)
+// may throw
+{
+   xmlFile.StartTag(wxT("packedblockfile"));
+
+   xmlFile.WriteAttr(wxT("pack"), mPack->GetFileName().GetFullName());
+   xmlFile.WriteAttr(wxT("offset"), static_cast<long long>(mOffset));
+   xmlFile.WriteAttr(wxT("len"), mLen);
+   xmlFile.WriteAttr(wxT("format"), static_cast<int>(mFormat));
+   xmlFile.WriteAttr(wxT("min"), mMin);
+   xmlFile.WriteAttr(wxT("max"), mMax);
+   xmlFile.WriteAttr(wxT("rms"), mRMS);
+
+   xmlFile.EndTag(wxT("packedblockfile"));
+}
+
+// BuildFromXML methods should always return a BlockFile, not NULL,
+// even if the result is flawed (e.g., refers to nonexistent file),
+// as testing will be done in ProjectFSCK().
+/// static
+BlockFilePtr PackedBlockFile::BuildFromXML(DirManager &dm, const wxChar **attrs)
+{
+   std::shared_ptr<BlockPack> pack;
+   wxFileOffset offset = 0;
+   sampleFormat format = floatSample;
+   float min = 0.0f, max = 0.0f, rms = 0.0f;
+   size_t len = 0;
+   double dblValue;
+   long nValue;
+   long long llValue;
+
+   while(*attrs)
+   {
+      const wxChar *attr =  *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (!wxStricmp(attr, wxT("pack")) &&
+            XMLValueChecker::IsGoodFileString(strValue) &&
+            // Packs are at the top of the data directory; see
+            // DirManager::MakeBlockFilePath
+            strValue.StartsWith(wxT("p")) &&
+            (strValue.length() + 1 + dm.GetProjectDataDir().length() <= PLATFORM_MAX_PATH))
+         pack = dm.GetBlockPack(strValue);
+      else if (!wxStrcmp(attr, wxT("offset")) &&
+               XMLValueChecker::IsGoodInt64(strValue) &&
+               strValue.ToLongLong(&llValue) && llValue >= 0)
+         offset = llValue;
+      else if (!wxStrcmp(attr, wxT("len")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               nValue > 0)
+         len = nValue;
+      else if (!wxStrcmp(attr, wxT("format")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               XMLValueChecker::IsValidSampleFormat(nValue))
+         format = static_cast<sampleFormat>(nValue);
+      else if (XMLValueChecker::IsGoodString(strValue) && Internat::CompatibleToDouble(strValue, &dblValue))
+      {  // double parameters
+         if (!wxStricmp(attr, wxT("min")))
+            min = dblValue;
+         else if (!wxStricmp(attr, wxT("max")))
+            max = dblValue;
+         else if (!wxStricmp(attr, wxT("rms")) && (dblValue >= 0.0))
+            rms = dblValue;
+      }
+   }
+
+   if (!pack)
+      // No file, so reads fail, and give silence or exceptions
+      pack = std::make_shared<BlockPack>(wxFileNameWrapper{}, 0, true);
+
+   return make_blockfile<PackedBlockFile>
+      (std::move(pack), offset, len, format, min, max, rms);
+}
+
+BlockFilePtr PackedBlockFile::Copy(wxFileNameWrapper &&)
+{
+   return make_blockfile<PackedBlockFile>
+      (mPack, mOffset, mLen, mFormat, mMin, mMax, mRMS);
+}
+
+auto PackedBlockFile::GetSpaceUsage() const -> DiskByteCount
+{
+   return sizeof(PackedBlockHeader) +
+      mSummaryInfo.totalSummaryBytes +
+      mLen * SAMPLE_SIZE(mFormat);
+}
+
+void PackedBlockFile::Recover()
+{
+   PackedBlockHeader header;
+   if (mPack->Read(mOffset, &header, sizeof(header)) &&
+       memcmp(header.tag, PackedBlockTag, sizeof(header.tag)) == 0)
+      return;
+
+   // The old extent can't be rewritten, so refer to a NEW one of silence
+   ArrayOf<char> summaryData{ mSummaryInfo.totalSummaryBytes, true };
+   SampleBuffer sampleData(mLen, mFormat);
+   ClearSamples(sampleData.ptr(), mFormat, 0, mLen);
+   AppendExtent(sampleData.ptr(), mFormat, summaryData.get());
+   mSilentLog = FALSE;
+}
+
+void PackedBlockFile::Lock()
+{
+   BlockFile::Lock();
+   mPack->Keep();
+}
+
+bool PackedBlockFile::GetPackBlockFiles()
+{
+   bool packBlockFiles = false;
+   gPrefs->Read(wxT("/Directories/PackBlockFiles"), &packBlockFiles);
+   return packBlockFiles;
+}
+
+static DirManager::RegisteredBlockFileDeserializer sRegistration {
+   "packedblockfile",
+   []( DirManager &dm, const wxChar **attrs ){
+      return PackedBlockFile::BuildFromXML( dm, attrs );
+   }
+};
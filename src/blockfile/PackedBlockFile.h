@@ -0,0 +1,116 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockFile.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_PACKED_BLOCKFILE__
+#define __AUDACITY_PACKED_BLOCKFILE__
+
+#include "../BlockFile.h"
+
+#include <atomic>
+#include <mutex>
+#include <wx/filefn.h> // for wxFileOffset
+
+class DirManager;
+
+/// An append-only file in the project data directory holding the contents
+/// of many PackedBlockFiles, one extent each.  Extents are never rewritten,
+/// so blocks may share them freely.
+class PROFILE_DLL_API BlockPack final
+{
+public:
+   /// Start a new pack file no longer than this, at the next append
+   enum : wxFileOffset { MaxBytes = 1 << 30 };
+
+   /// size is the length of the existing file, or 0 for a NEW one.  kept
+   /// is true for packs that a saved project may refer to.
+   BlockPack(wxFileNameWrapper &&fileName, wxFileOffset size, bool kept);
+   BlockPack( const BlockPack& ) PROHIBITED;
+   BlockPack &operator=( const BlockPack& ) PROHIBITED;
+
+   /// Removes the file, if no block in it was ever locked
+   ~BlockPack();
+
+   wxFileNameWrapper GetFileName() const;
+   void SetFileName(wxFileNameWrapper &&fileName);
+   wxFileOffset GetSize() const;
+
+   /// Write the pieces one after another at the end of the file, returning
+   /// the offset of the first.  Throws FileException on failure, leaving
+   /// the pack as it was.
+   wxFileOffset Append(
+      const void *const *pieces, const size_t *sizes, size_t nPieces);
+   /// Read bytes at offset; false if the file or the range is missing
+   bool Read(wxFileOffset offset, void *buffer, size_t bytes) const;
+
+   /// Blocks in this pack belong to a saved project, so keep the file
+   void Keep() { mKept.store(true, std::memory_order_relaxed); }
+   bool IsKept() const { return mKept.load(std::memory_order_relaxed); }
+
+private:
+   mutable std::mutex mMutex;
+   wxFileNameWrapper mFileName;
+   wxFileOffset mSize;
+   std::atomic<bool> mKept;
+};
+
+/// A BlockFile whose summary and samples are an extent of a BlockPack,
+/// rather than a file of its own
+class PROFILE_DLL_API PackedBlockFile final : public BlockFile {
+ public:
+
+   // Constructor / Destructor
+
+   /// Append summary and sample data to the pack
+   PackedBlockFile(std::shared_ptr<BlockPack> pack,
+                   samplePtr sampleData, size_t sampleLen,
+                   sampleFormat format);
+   /// Create the memory structure to refer to an existing extent
+   PackedBlockFile(std::shared_ptr<BlockPack> pack, wxFileOffset offset,
+                   size_t len, sampleFormat format,
+                   float min, float max, float rms);
+
+   virtual ~PackedBlockFile();
+
+   // Reading
+
+   /// Read the summary section of the extent
+   bool ReadSummary(ArrayOf<char> &data) override;
+   /// Read the data section of the extent
+   size_t ReadData(samplePtr data, sampleFormat format,
+                        size_t start, size_t len, bool mayThrow) const override;
+
+   /// Create a NEW block file sharing this one's extent; the name is unused
+   BlockFilePtr Copy(wxFileNameWrapper &&newFileName) override;
+   /// Write an XML representation of this file
+   void SaveXML(XMLWriter &xmlFile) override;
+   DiskByteCount GetSpaceUsage() const override;
+   /// Append silence in place of a missing extent
+   void Recover() override;
+
+   /// Locking also keeps the pack file
+   void Lock() override;
+
+   static BlockFilePtr BuildFromXML(DirManager &dm, const wxChar **attrs);
+
+   /// Whether NEW blocks should be packed, rather than simple block files
+   static bool GetPackBlockFiles();
+
+   const std::shared_ptr<BlockPack> &GetPack() const { return mPack; }
+   sampleFormat GetFormat() const { return mFormat; }
+
+ private:
+   void AppendExtent(samplePtr sampleData, sampleFormat format,
+                     const void *summaryData);
+   wxFileOffset SamplesOffset() const;
+
+   std::shared_ptr<BlockPack> mPack;
+   wxFileOffset mOffset{ 0 };
+   sampleFormat mFormat;
+};
+
+#endif
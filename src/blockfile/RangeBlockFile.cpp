@@ -0,0 +1,222 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RangeBlockFile.cpp
+
+*******************************************************************//**
+
+\class RangeBlockFile
+\brief A BlockFile referring to a range of the samples of another
+
+If the preference "/Directories/RangeBlockFiles" is set, an edit whose
+boundary falls inside a block keeps the surviving samples as ranges of the
+old block, instead of reading them and writing NEW block files.  Block
+files are never rewritten, so the old one serves as well as a copy.
+
+A range has no file of its own.  Its source stays in the DirManager, and
+is moved, copied and checked with the project like any other block.  The
+project file nests the tag of the source inside the rangeblockfile tag.
+
+A range holds on to all of its source, so the samples outside the range
+still take disk space until they are copied out of it.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "RangeBlockFile.h"
+
+#include "../Prefs.h"
+#include "../xml/XMLTagHandler.h"
+#include "../xml/XMLWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+RangeBlockFile::RangeBlockFile(BlockFilePtr source, size_t start, size_t len)
+: BlockFile{ wxFileNameWrapper{}, len }
+, mSource{ std::move(source) }
+, mStart{ start }
+{
+   wxASSERT( !dynamic_cast<const RangeBlockFile*>(mSource.get()) );
+   wxASSERT( start + len <= mSource->GetLength() );
+}
+
+RangeBlockFile::~RangeBlockFile()
+{
+}
+
+BlockFilePtr RangeBlockFile::Make(
+   const BlockFilePtr &block, size_t start, size_t len)
+{
+   if (!block || len == 0 || start + len > block->GetLength())
+      return {};
+
+   if (auto pRange = dynamic_cast<const RangeBlockFile*>(block.get())) {
+      if (start == 0 && len == block->GetLength())
+         return block;
+      // Refer to the source directly, so ranges never nest
+      return make_blockfile<RangeBlockFile>(
+         pRange->mSource, pRange->mStart + start, len);
+   }
+
+   // Alias and on-demand blocks are found by their types, to track their
+   // dependencies and compute them, so they are not hidden in ranges
+   if (block->IsAlias() ||
+       !block->IsSummaryAvailable() || !block->IsDataAvailable())
+      return {};
+
+   return make_blockfile<RangeBlockFile>(block, start, len);
+}
+
+size_t RangeBlockFile::ReadData(samplePtr data, sampleFormat format,
+   size_t start, size_t len, bool mayThrow) const
+{
+   // Read no samples of the source outside the range
+   const auto available = start < mLen ? std::min(len, mLen - start) : 0;
+   size_t result = 0;
+   if (available > 0)
+      result = mSource->ReadData(
+         data, format, mStart + start, available, mayThrow);
+   if (result < len)
+      ClearSamples(data, format, result, len - result);
+   return result;
+}
+
+auto RangeBlockFile::GetMinMaxRMS(bool mayThrow) const -> MinMaxRMS
+{
+   std::lock_guard<std::mutex> lock{ mSummaryMutex };
+   if (!mHaveMinMaxRMS) {
+      mMinMaxRMS = BlockFile::GetMinMaxRMS(0, mLen, mayThrow);
+      mHaveMinMaxRMS = true;
+   }
+   return mMinMaxRMS;
+}
+
+bool RangeBlockFile::ReadSummary(ArrayOf<char> &data)
+{
+   std::lock_guard<std::mutex> lock{ mSummaryMutex };
+   data.reinit( mSummaryInfo.totalSummaryBytes );
+
+   if (!mSummary) {
+      SampleBuffer samples(mLen, floatSample);
+      if (mSource->ReadData(samples.ptr(), floatSample, mStart, mLen, false)
+             < mLen) {
+         memset(data.get(), 0, mSummaryInfo.totalSummaryBytes);
+         return false;
+      }
+
+      // CalcSummary also sets mMin, mMax and mRMS
+      ArrayOf<char> summary;
+      CalcSummary(samples.ptr(), mLen, floatSample, summary);
+      mSummary = std::move(summary);
+      mMinMaxRMS = { mMin, mMax, mRMS };
+      mHaveMinMaxRMS = true;
+   }
+
+   memcpy(data.get(), mSummary.get(), mSummaryInfo.totalSummaryBytes);
+   return true;
+}
+
+bool RangeBlockFile::GetNeedWriteCacheToDisk()
+{
+   return mSource->GetNeedWriteCacheToDisk();
+}
+
+void RangeBlockFile::WriteCacheToDisk()
+{
+   mSource->WriteCacheToDisk();
+}
+
+void RangeBlockFile::Lock()
+{
+   BlockFile::Lock();
+   mSource->Lock();
+}
+
+void RangeBlockFile::Unlock()
+{
+   BlockFile::Unlock();
+   mSource->Unlock();
+}
+
+bool RangeBlockFile::IsSummaryAvailable() const
+{
+   return mSource->IsSummaryAvailable();
+}
+
+bool RangeBlockFile::IsDataAvailable() const
+{
+   return mSource->IsDataAvailable();
+}
+
+BlockFilePtr RangeBlockFile::Copy(wxFileNameWrapper &&)
+{
+   return make_blockfile<RangeBlockFile>(mSource, mStart, mLen);
+}
+
+void RangeBlockFile::SaveXML(XMLWriter &xmlFile)
+// may throw
+{
+   xmlFile.StartTag(GetXMLTag());
+
+   xmlFile.WriteAttr(wxT("start"), mStart);
+   xmlFile.WriteAttr(wxT("len"), mLen);
+
+   mSource->SaveXML(xmlFile);
+
+   xmlFile.EndTag(GetXMLTag());
+}
+
+auto RangeBlockFile::GetSpaceUsage() const -> DiskByteCount
+{
+   return 0;
+}
+
+void RangeBlockFile::Recover()
+{
+   mSource->Recover();
+}
+
+const wxChar *RangeBlockFile::GetXMLTag()
+{
+   return wxT("rangeblockfile");
+}
+
+/// static
+bool RangeBlockFile::ReadXMLAttributes(
+   const wxChar **attrs, size_t &start, size_t &len)
+{
+   bool haveStart = false;
+   long long nValue;
+
+   start = len = 0;
+   while(*attrs)
+   {
+      const wxChar *attr =  *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (!XMLValueChecker::IsGoodInt64(strValue) ||
+          !strValue.ToLongLong(&nValue) || nValue < 0)
+         return false;
+
+      if (!wxStrcmp(attr, wxT("start"))) {
+         start = nValue;
+         haveStart = true;
+      }
+      else if (!wxStrcmp(attr, wxT("len")))
+         len = nValue;
+   }
+
+   return haveStart && len > 0;
+}
+
+bool RangeBlockFile::GetRangeBlockFiles()
+{
+   bool rangeBlockFiles = false;
+   gPrefs->Read(wxT("/Directories/RangeBlockFiles"), &rangeBlockFiles);
+   return rangeBlockFiles;
+}
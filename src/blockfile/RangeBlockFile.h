@@ -0,0 +1,88 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RangeBlockFile.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_RANGE_BLOCKFILE__
+#define __AUDACITY_RANGE_BLOCKFILE__
+
+#include "../BlockFile.h"
+
+#include <mutex>
+
+/// A BlockFile of a range of the samples of another, which it shares
+/// instead of copying.  Its summaries are computed from those samples when
+/// first wanted, and held only in memory.
+class PROFILE_DLL_API RangeBlockFile final : public BlockFile {
+ public:
+
+   // Constructor / Destructor
+
+   /// source must not itself be a RangeBlockFile, and the range must lie
+   /// within it
+   RangeBlockFile(BlockFilePtr source, size_t start, size_t len);
+
+   virtual ~RangeBlockFile();
+
+   /// A block of samples [start, start + len) of the given block, which
+   /// may be a range itself; or null, if the samples should be copied
+   /// instead, because the block is an alias or not yet complete
+   static BlockFilePtr Make(
+      const BlockFilePtr &block, size_t start, size_t len);
+
+   // Reading
+
+   /// Read the samples of the range from the source
+   size_t ReadData(samplePtr data, sampleFormat format,
+                        size_t start, size_t len, bool mayThrow) const override;
+   MinMaxRMS GetMinMaxRMS(bool mayThrow) const override;
+
+   bool GetNeedWriteCacheToDisk() override;
+   void WriteCacheToDisk() override;
+
+   /// Locking also locks the source
+   void Lock() override;
+   void Unlock() override;
+
+   bool IsSummaryAvailable() const override;
+   bool IsDataAvailable() const override;
+
+   /// Create a NEW block file sharing the same source; the name is unused
+   BlockFilePtr Copy(wxFileNameWrapper &&newFileName) override;
+   /// Write an XML representation of this file, enclosing that of the source
+   void SaveXML(XMLWriter &xmlFile) override;
+   /// The space is that of the source, counted with it
+   DiskByteCount GetSpaceUsage() const override;
+   void Recover() override;
+
+   /// The tag that SaveXML writes; its child is the source
+   static const wxChar *GetXMLTag();
+   /// Read the range from the attributes of the tag; false if bad
+   static bool ReadXMLAttributes(
+      const wxChar **attrs, size_t &start, size_t &len);
+
+   /// Whether edits should refer to ranges of blocks, rather than copy
+   /// their samples into NEW block files
+   static bool GetRangeBlockFiles();
+
+   const BlockFilePtr &GetSource() const { return mSource; }
+   size_t GetStart() const { return mStart; }
+
+ protected:
+   /// Compute the summary of the range on first use
+   bool ReadSummary(ArrayOf<char> &data) override;
+
+ private:
+   const BlockFilePtr mSource;
+   const size_t mStart;
+
+   mutable std::mutex mSummaryMutex;
+   ArrayOf<char> mSummary;
+   mutable bool mHaveMinMaxRMS{ false };
+   mutable MinMaxRMS mMinMaxRMS{ 0, 0, 0 };
+};
+
+#endif
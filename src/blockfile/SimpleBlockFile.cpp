@@ -48,6 +48,12 @@ default is to disable caching.
   manual auto recovery, because the files are never written physically to
   disk).
 
+* Write-behind: If the preference "/Directories/WriteBehind" is set and the
+  parameter allowDeferredWrite is enabled, NEW block files are held in memory
+  only until a writer thread has written them to disk, in the order they were
+  made.  The recording thread then never waits for the creation of files.
+  WriteCacheToDisk() writes at once any that are still waiting.
+
 *//****************************************************************//**
 
 \class auHeader
@@ -66,13 +72,39 @@ to get its definition, rather than rolling our own.
 #include <wx/utils.h>
 #include <wx/log.h>
 
+#include "../BlockFileIOStats.h"
+#include "../CacheBudget.h"
 #include "../DirManager.h"
+#include "../FFT.h"
 #include "../Prefs.h"
+#include "../RealFFTf.h"
 
 #include "../FileFormats.h"
 
 #include "sndfile.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __UNIX__
+// Unix lets files be renamed and unlinked while mapped, as DirManager may do,
+// so reading through mappings is safe there; not so on Windows
+#define USE_MAPPED_BLOCK_READS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 static wxUint32 SwapUintEndianess(wxUint32 in)
 {
@@ -86,6 +118,330 @@ static wxUint32 SwapUintEndianess(wxUint32 in)
   return out;
 }
 
+namespace {
+
+// The optional spectral summary section follows the waveform summary, and
+// the data offset of the au header skips it, so other readers ignore it.
+// It holds, for each window size, the dB power spectrum of each successive
+// run of that many samples (the last zero padded), in hundredths of a dB,
+// in native byte order.
+struct SpectralSummaryHeader
+{
+   char tag[4];             // "SPEC"
+   wxUint32 windowType;
+   wxUint32 nWindowSizes;   // followed by that many wxUint32 sizes
+};
+
+// Spectrograms made with other windows are computed from the samples
+const int SpectralSummaryWindowType = eWinFuncHanning;
+const wxUint32 SpectralSummaryWindowSizes[] = { 2048, 8192 };
+
+size_t SpectralFrameCount(size_t windowSize, size_t samples)
+{
+   return (samples + windowSize - 1) / windowSize;
+}
+
+size_t SpectralSummaryBytes(size_t samples)
+{
+   size_t result = sizeof(SpectralSummaryHeader) +
+      sizeof(SpectralSummaryWindowSizes);
+   for (auto windowSize : SpectralSummaryWindowSizes)
+      result += SpectralFrameCount(windowSize, samples) *
+         (windowSize / 2) * sizeof(wxInt16);
+   return result;
+}
+
+ArrayOf<char> CalcSpectralSummary(
+   samplePtr sampleData, size_t sampleLen, sampleFormat format)
+{
+   const auto nBytes = SpectralSummaryBytes(sampleLen);
+   ArrayOf<char> result{ nBytes };
+
+   SpectralSummaryHeader header;
+   memcpy(header.tag, "SPEC", 4);
+   header.windowType = SpectralSummaryWindowType;
+   header.nWindowSizes = WXSIZEOF(SpectralSummaryWindowSizes);
+   auto pOut = result.get();
+   memcpy(pOut, &header, sizeof(header));
+   pOut += sizeof(header);
+   memcpy(pOut, SpectralSummaryWindowSizes, sizeof(SpectralSummaryWindowSizes));
+   pOut += sizeof(SpectralSummaryWindowSizes);
+
+   Floats samples{ sampleLen };
+   CopySamples(sampleData, format, (samplePtr)samples.get(), floatSample,
+      sampleLen);
+
+   for (auto windowSize : SpectralSummaryWindowSizes) {
+      // The same window, scaled to give 0 dB for a 0 dB sine tone, as
+      // SpectrogramSettings makes without zero padding
+      Floats window{ windowSize };
+      const auto table =
+         GetWindowTable(SpectralSummaryWindowType, windowSize, false);
+      std::copy(table, table + windowSize, window.get());
+      double scale = 0.0;
+      for (size_t ii = 0; ii < windowSize; ++ii)
+         scale += window[ii];
+      if (scale > 0)
+         scale = 2.0 / scale;
+      for (size_t ii = 0; ii < windowSize; ++ii)
+         window[ii] *= scale;
+
+      const auto hFFT = GetFFT(windowSize);
+      Floats buffer{ windowSize };
+      const auto nFrames = SpectralFrameCount(windowSize, sampleLen);
+      for (size_t frame = 0; frame < nFrames; ++frame) {
+         const auto start = frame * windowSize;
+         const auto len = std::min<size_t>(windowSize, sampleLen - start);
+         for (size_t ii = 0; ii < len; ++ii)
+            buffer[ii] = samples[start + ii] * window[ii];
+         std::fill(buffer.get() + len, buffer.get() + windowSize, 0.0f);
+         RealFFTf(buffer.get(), hFFT.get());
+
+         // Offsets in the section are all even, so this is aligned
+         const auto bins = reinterpret_cast<wxInt16*>(pOut);
+         const auto store = [](float power){
+            const float dB = power <= 0 ? -160.0f : 10.0f * log10f(power);
+            return (wxInt16)lrintf(
+               std::max(-32768.0f, std::min(32767.0f, dB * 100.0f)));
+         };
+         // Handle the (real-only) DC
+         bins[0] = store(buffer[0] * buffer[0]);
+         for (size_t ii = 1; ii < hFFT->Points; ++ii) {
+            const int index = hFFT->BitReversed[ii];
+            const float re = buffer[index], im = buffer[index + 1];
+            bins[ii] = store(re * re + im * im);
+         }
+         pOut += (windowSize / 2) * sizeof(wxInt16);
+      }
+   }
+
+   wxASSERT(pOut == result.get() + nBytes);
+   return result;
+}
+
+}
+
+#ifdef USE_MAPPED_BLOCK_READS
+namespace {
+
+/// Read-only mapping of a whole .au block file, with its parsed header
+struct MappedBlock
+{
+   MappedBlock() = default;
+   MappedBlock( const MappedBlock& ) = delete;
+   MappedBlock &operator=( const MappedBlock& ) = delete;
+   ~MappedBlock()
+   {
+      if (addr)
+         munmap( addr, size );
+   }
+
+   // Returns false if the file could not be opened; otherwise true, even
+   // if the contents are not in a format that can be read directly, in
+   // which case format is left zero
+   bool Map( const wxString &path )
+   {
+      int fd = open( path.fn_str(), O_RDONLY );
+      if (fd < 0)
+         return false;
+      struct stat st;
+      if (fstat( fd, &st ) == 0 && st.st_size >= (off_t)sizeof(auHeader)) {
+         auto p = mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+         if (p != MAP_FAILED)
+            addr = p, size = st.st_size;
+      }
+      close( fd );
+      if (!addr)
+         return true;
+
+      // Only native-endian mono 16 bit or float data can be used without
+      // help from libsndfile; packed 24 bit data cannot
+      auHeader header;
+      memcpy( &header, addr, sizeof(header) );
+      if (header.magic != 0x2e736e64 || header.channels != 1 ||
+          header.dataOffset > size)
+         return true;
+      switch (header.encoding) {
+         case AU_SAMPLE_FORMAT_16:
+            format = int16Sample; break;
+         case AU_SAMPLE_FORMAT_FLOAT:
+            format = floatSample; break;
+         default:
+            return true;
+      }
+      data = (const char*)addr + header.dataOffset;
+      samples = (size - header.dataOffset) / SAMPLE_SIZE(format);
+      return true;
+   }
+
+   void *addr{};
+   size_t size{};
+   sampleFormat format{};
+   const char *data{};
+   size_t samples{};
+};
+
+/// A bounded, least-recently-used set of block file mappings, shared
+/// by all threads that read SimpleBlockFiles
+class MappedBlockCache
+{
+public:
+   static MappedBlockCache &Get()
+   {
+      static MappedBlockCache instance;
+      return instance;
+   }
+
+   // Returns null if the file can't be mapped and read directly
+   std::shared_ptr<const MappedBlock> Find(
+      const SimpleBlockFile *key, const wxString &path )
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      auto iter = mIndex.find( key );
+      if (iter != mIndex.end()) {
+         // Move to the front
+         mLRU.splice( mLRU.begin(), mLRU, iter->second );
+         return Usable( mLRU.front().second );
+      }
+
+      auto pBlock = std::make_shared<MappedBlock>();
+      if (!pBlock->Map( path ))
+         // Maybe written later; don't remember the failure
+         return {};
+
+      mLRU.emplace_front( key, pBlock );
+      mIndex[ key ] = mLRU.begin();
+      if (mLRU.size() > MaxMapped) {
+         mIndex.erase( mLRU.back().first );
+         // Readers in other threads may still hold the mapping
+         mLRU.pop_back();
+      }
+      return Usable( pBlock );
+   }
+
+   void Forget( const SimpleBlockFile *key )
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      auto iter = mIndex.find( key );
+      if (iter != mIndex.end()) {
+         mLRU.erase( iter->second );
+         mIndex.erase( iter );
+      }
+   }
+
+private:
+   static std::shared_ptr<const MappedBlock> Usable(
+      const std::shared_ptr<MappedBlock> &pBlock )
+   {
+      if (pBlock->data)
+         return pBlock;
+      return {};
+   }
+
+   enum : size_t { MaxMapped = 256 };
+
+   using Entry = std::pair< const SimpleBlockFile*, std::shared_ptr<MappedBlock> >;
+   std::mutex mMutex;
+   std::list< Entry > mLRU;
+   std::unordered_map< const SimpleBlockFile*, std::list< Entry >::iterator >
+      mIndex;
+};
+
+}
+#endif
+
+namespace {
+// Set while recording falls behind; see SimpleBlockFile::SetWriteThrottled
+std::atomic<bool> sThrottled{ false };
+}
+
+void SimpleBlockFile::SetWriteThrottled(bool throttled)
+{
+   sThrottled.store(throttled);
+}
+
+/// A thread that writes the files of SimpleBlockFiles made with
+/// write-behind, in the order they were queued
+class BlockWriteQueue
+{
+public:
+   static BlockWriteQueue &Get()
+   {
+      static BlockWriteQueue instance;
+      return instance;
+   }
+
+   void Push( SimpleBlockFile *pFile )
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mQueue.push_back( pFile );
+      }
+      mCondition.notify_one();
+   }
+
+   // Afterwards the writer thread neither has nor will touch the block
+   void Remove( SimpleBlockFile *pFile )
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      auto end = mQueue.end();
+      auto iter = std::find( mQueue.begin(), end, pFile );
+      if (iter != end)
+         mQueue.erase( iter );
+      mCondition.wait( lock, [&]{ return mWriting != pFile; } );
+   }
+
+private:
+   BlockWriteQueue()
+      : mThread{ [this]{ Run(); } }
+   {}
+
+   ~BlockWriteQueue()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mStopping = true;
+      }
+      mCondition.notify_all();
+      mThread.join();
+   }
+
+   void Run()
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      while (true) {
+         mCondition.wait( lock, [this]{
+            return mStopping || !mQueue.empty(); } );
+         if (mStopping)
+            return;
+
+         if (sThrottled.load()) {
+            // Leave the disk to the capture until its ring drains
+            mCondition.wait_for( lock, std::chrono::milliseconds( 20 ) );
+            continue;
+         }
+
+         mWriting = mQueue.front();
+         mQueue.pop_front();
+         lock.unlock();
+         // A failure leaves the block pending, for WriteCacheToDisk() to
+         // retry and report
+         try { mWriting->WritePending(); }
+         catch( ... ) {}
+         lock.lock();
+         mWriting = nullptr;
+         mCondition.notify_all();
+      }
+   }
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque< SimpleBlockFile* > mQueue;
+   SimpleBlockFile *mWriting{ nullptr };
+   bool mStopping{ false };
+   std::thread mThread;
+};
+
 /// Constructs a SimpleBlockFile based on sample data and writes
 /// it to disk.
 ///
@@ -110,9 +466,35 @@ SimpleBlockFile::SimpleBlockFile(wxFileNameWrapper &&baseFileName,
 
    mCache.active = false;
 
-   bool useCache = GetCache() && (!bypassCache);
-
-   if (!(allowDeferredWrite && useCache) && !bypassCache)
+   // Past the memory budget, samples spill to the disk at once
+   const auto sampleDataSize = sampleLen * SAMPLE_SIZE(format);
+   const bool cacheWanted = GetCache() && (!bypassCache);
+   // Recorded blocks that the cache would keep until recording stops are
+   // instead written behind, as the capture allows, so that stopping does
+   // not wait for them all and memory is given back as they are written
+   bool writeBehind = allowDeferredWrite && !bypassCache &&
+      (cacheWanted || GetWriteBehind()) &&
+      CacheBudget::Get().Reserve(CacheBudget::RecordedBlocks, sampleDataSize);
+   bool useCache = cacheWanted && !writeBehind &&
+      CacheBudget::Get().Reserve(CacheBudget::RecordedBlocks, sampleDataSize);
+
+   if (writeBehind) {
+      auto pPending = std::make_shared<PendingWrite>();
+      pPending->format = format;
+      pPending->sampleData.reinit(sampleDataSize);
+      memcpy(pPending->sampleData.get(), sampleData, sampleDataSize);
+      // Find mMin, mMax and mRMS now; the spectral summary, if any, is left
+      // to the writer thread
+      ArrayOf<char> cleanup;
+      void* summaryData = BlockFile::CalcSummary(sampleData, sampleLen,
+                                                format, cleanup);
+      pPending->summaryData.reinit(mSummaryInfo.totalSummaryBytes);
+      memcpy(pPending->summaryData.get(), summaryData,
+             mSummaryInfo.totalSummaryBytes);
+      mPending = std::move( pPending );
+      BlockWriteQueue::Get().Push( this );
+   }
+   else if (!(allowDeferredWrite && useCache) && !bypassCache)
    {
       bool bSuccess = WriteSimpleBlockFile(sampleData, sampleLen, format, NULL);
       if (!bSuccess)
@@ -125,7 +507,6 @@ SimpleBlockFile::SimpleBlockFile(wxFileNameWrapper &&baseFileName,
       mCache.active = true;
       mCache.needWrite = true;
       mCache.format = format;
-      const auto sampleDataSize = sampleLen * SAMPLE_SIZE(format);
       mCache.sampleData.reinit(sampleDataSize);
       memcpy(mCache.sampleData.get(), sampleData, sampleDataSize);
       ArrayOf<char> cleanup;
@@ -157,6 +538,20 @@ SimpleBlockFile::SimpleBlockFile(wxFileNameWrapper &&existingFile, size_t len,
 
 SimpleBlockFile::~SimpleBlockFile()
 {
+   if (std::atomic_load( &mPending )) {
+      BlockWriteQueue::Get().Remove( this );
+      // Never written
+      if (auto pPending = std::atomic_load( &mPending ))
+         CacheBudget::Get().Release(CacheBudget::RecordedBlocks,
+            mLen * SAMPLE_SIZE(pPending->format));
+   }
+   if (mCache.active && mCache.sampleData)
+      CacheBudget::Get().Release(CacheBudget::RecordedBlocks,
+         mLen * SAMPLE_SIZE(mCache.format));
+
+#ifdef USE_MAPPED_BLOCK_READS
+   MappedBlockCache::Get().Forget( this );
+#endif
 }
 
 bool SimpleBlockFile::WriteSimpleBlockFile(
@@ -165,6 +560,15 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
     sampleFormat format,
     void* summaryData)
 {
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Simple, BlockFileIOStats::Write };
+   stats.SetBytes(sampleLen * SAMPLE_SIZE(format));
+
+#ifdef USE_MAPPED_BLOCK_READS
+   // Any old mapping must not outlive the contents it was made for
+   MappedBlockCache::Get().Forget( this );
+#endif
+
    wxFFile file(mFileName.GetFullPath(), wxT("wb"));
    if( !file.IsOpened() ){
       // Can't do anything else.
@@ -180,9 +584,19 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
    // endianness
    header.magic = 0x2e736e64;
 
+   // The optional spectral summary goes between the waveform summary
+   // and the samples
+   ArrayOf<char> spectralSummary;
+   mSpectralSummaryBytes = 0;
+   if (GetStoreSpectralSummaries() && sampleLen > 0) {
+      spectralSummary = CalcSpectralSummary(sampleData, sampleLen, format);
+      mSpectralSummaryBytes = SpectralSummaryBytes(sampleLen);
+   }
+
    // We store the summary data at the end of the header, so the data
    // offset is the length of the summary data plus the length of the header
-   header.dataOffset = sizeof(auHeader) + mSummaryInfo.totalSummaryBytes;
+   header.dataOffset = sizeof(auHeader) + mSummaryInfo.totalSummaryBytes +
+      mSpectralSummaryBytes;
 
    // dataSize is optional, and we opt out
    header.dataSize = 0xffffffff;
@@ -230,6 +644,17 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
       return false;
    }
 
+   if (mSpectralSummaryBytes > 0)
+   {
+      nBytesToWrite = mSpectralSummaryBytes;
+      nBytesWritten = file.Write(spectralSummary.get(), nBytesToWrite);
+      if (nBytesWritten != nBytesToWrite)
+      {
+         wxLogDebug(wxT("Wrote %lld bytes, expected %lld."), (long long) nBytesWritten, (long long) nBytesToWrite);
+         return false;
+      }
+   }
+
    if( format == int24Sample )
    {
       // we can't write the buffer directly to disk, because 24-bit samples
@@ -315,14 +740,18 @@ void SimpleBlockFile::FillCache()
 
    file.Close();
 
-   // Read samples into cache
-   mCache.sampleData.reinit(mLen * SAMPLE_SIZE(mCache.format));
+   // Read samples into cache, if the memory budget allows
+   const auto sampleDataSize = mLen * SAMPLE_SIZE(mCache.format);
+   if (!CacheBudget::Get().Reserve(CacheBudget::RecordedBlocks, sampleDataSize))
+      return;
+   mCache.sampleData.reinit(sampleDataSize);
    if (ReadData(mCache.sampleData.get(), mCache.format, 0, mLen,
                 // no exceptions!
                 false) != mLen)
    {
       // Could not read all samples
       mCache.sampleData.reset();
+      CacheBudget::Get().Release(CacheBudget::RecordedBlocks, sampleDataSize);
       return;
    }
 
@@ -344,7 +773,11 @@ void SimpleBlockFile::FillCache()
 bool SimpleBlockFile::ReadSummary(ArrayOf<char> &data)
 {
    data.reinit( mSummaryInfo.totalSummaryBytes );
-   if (mCache.active) {
+   if (auto pPending = std::atomic_load( &mPending )) {
+      memcpy(data.get(), pPending->summaryData.get(), mSummaryInfo.totalSummaryBytes);
+      return true;
+   }
+   else if (mCache.active) {
       //wxLogDebug("SimpleBlockFile::ReadSummary(): Summary is already in cache.");
       memcpy(data.get(), mCache.summaryData.get(), mSummaryInfo.totalSummaryBytes);
       return true;
@@ -393,15 +826,24 @@ bool SimpleBlockFile::ReadSummary(ArrayOf<char> &data)
 size_t SimpleBlockFile::ReadData(samplePtr data, sampleFormat format,
                         size_t start, size_t len, bool mayThrow) const
 {
-   if (mCache.active)
+   BlockFileIOStats::Scope stats{
+      BlockFileIOStats::Simple, BlockFileIOStats::MemoryRead };
+   stats.SetBytes(len * SAMPLE_SIZE(format));
+
+   // Held so that the writer thread can't free the samples while we copy
+   const auto pPending = std::atomic_load( &mPending );
+   if (pPending || mCache.active)
    {
       //wxLogDebug("SimpleBlockFile::ReadData(): Data are already in cache.");
+      const auto &sampleData =
+         pPending ? pPending->sampleData : mCache.sampleData;
+      const auto cacheFormat = pPending ? pPending->format : mCache.format;
 
       auto framesRead = std::min(len, std::max(start, mLen) - start);
       CopySamples(
-         (samplePtr)(mCache.sampleData.get() +
-            start * SAMPLE_SIZE(mCache.format)),
-         mCache.format, data, format, framesRead);
+         (samplePtr)(sampleData.get() +
+            start * SAMPLE_SIZE(cacheFormat)),
+         cacheFormat, data, format, framesRead);
 
       if ( framesRead < len ) {
          if (mayThrow)
@@ -412,9 +854,93 @@ size_t SimpleBlockFile::ReadData(samplePtr data, sampleFormat format,
 
       return framesRead;
    }
-   else
-      return CommonReadData( mayThrow,
-         mFileName, mSilentLog, nullptr, 0, 0, data, format, start, len);
+
+#ifdef USE_MAPPED_BLOCK_READS
+   // Read through a memory mapping when the file format allows, avoiding
+   // the open, seek and read system calls on every request
+   if (auto pBlock = MappedBlockCache::Get().Find( this, mFileName.GetFullPath() ))
+   {
+      auto framesRead =
+         std::min(len, std::max(start, pBlock->samples) - start);
+      CopySamples(
+         (samplePtr)(pBlock->data + start * SAMPLE_SIZE(pBlock->format)),
+         pBlock->format, data, format, framesRead);
+      mSilentLog = FALSE;
+
+      if ( framesRead < len ) {
+         if (mayThrow)
+            throw FileException{ FileException::Cause::Read, mFileName };
+         ClearSamples(data, format, framesRead, len - framesRead);
+      }
+
+      return framesRead;
+   }
+#endif
+
+   stats.SetOperation(BlockFileIOStats::FileRead);
+   return CommonReadData( mayThrow,
+      mFileName, mSilentLog, nullptr, 0, 0, data, format, start, len);
+}
+
+bool SimpleBlockFile::ReadSpectralFrames(size_t windowSize, int windowType,
+   size_t first, size_t nFrames, float *buffer) const
+{
+   if (windowType != SpectralSummaryWindowType || nFrames == 0 ||
+       std::atomic_load( &mPending ))
+      return false;
+
+   wxFFile file;
+   {
+      // Absence of the file, or of the section, just means the caller
+      // computes spectra from the samples
+      wxLogNull silence;
+      if (!file.Open(GetFileName().name.GetFullPath(), wxT("rb")))
+         return false;
+   }
+
+   auHeader header;
+   if (file.Read(&header, sizeof(header)) != sizeof(header) ||
+       header.magic != 0x2e736e64)
+      return false;
+
+   const size_t sectionStart = sizeof(auHeader) + mSummaryInfo.totalSummaryBytes;
+   SpectralSummaryHeader specHeader;
+   if (header.dataOffset < sectionStart + sizeof(specHeader) ||
+       !file.Seek(sectionStart) ||
+       file.Read(&specHeader, sizeof(specHeader)) != sizeof(specHeader) ||
+       memcmp(specHeader.tag, "SPEC", 4) != 0 ||
+       (int)specHeader.windowType != windowType ||
+       specHeader.nWindowSizes > 16)
+      return false;
+
+   std::vector<wxUint32> windowSizes(specHeader.nWindowSizes);
+   const auto sizesBytes = windowSizes.size() * sizeof(wxUint32);
+   if (file.Read(windowSizes.data(), sizesBytes) != sizesBytes)
+      return false;
+
+   // Find the frames for this window size, after those for earlier sizes
+   size_t offset = sectionStart + sizeof(specHeader) + sizesBytes;
+   auto iter = windowSizes.begin(), end = windowSizes.end();
+   for (; iter != end && *iter != windowSize; ++iter)
+      offset += SpectralFrameCount(*iter, mLen) * (*iter / 2) * sizeof(wxInt16);
+   if (iter == end || first + nFrames > SpectralFrameCount(windowSize, mLen))
+      return false;
+
+   const auto nBins = windowSize / 2;
+   offset += first * nBins * sizeof(wxInt16);
+   const auto nValues = nFrames * nBins;
+   if (offset + nValues * sizeof(wxInt16) > header.dataOffset)
+      return false;
+
+   std::vector<wxInt16> values(nValues);
+   if (!file.Seek(offset) ||
+       file.Read(values.data(), nValues * sizeof(wxInt16)) !=
+          nValues * sizeof(wxInt16))
+      return false;
+
+   for (size_t ii = 0; ii < nValues; ++ii)
+      buffer[ii] = values[ii] / 100.0f;
+   return true;
 }
 
 void SimpleBlockFile::SaveXML(XMLWriter &xmlFile)
@@ -492,7 +1018,7 @@ BlockFilePtr SimpleBlockFile::Copy(wxFileNameWrapper &&newFileName)
 
 auto SimpleBlockFile::GetSpaceUsage() const -> DiskByteCount
 {
-   if (mCache.active && mCache.needWrite)
+   if ((mCache.active && mCache.needWrite) || std::atomic_load( &mPending ))
    {
       // We don't know space usage yet
       return 0;
@@ -524,6 +1050,11 @@ auto SimpleBlockFile::GetSpaceUsage() const -> DiskByteCount
       else
          encoding = SwapUintEndianess(header.encoding);
    
+      // Anything between the summary and the samples is spectral summary
+      const size_t summaryEnd = sizeof(auHeader) + mSummaryInfo.totalSummaryBytes;
+      if (header.magic == 0x2e736e64 && header.dataOffset > summaryEnd)
+         mSpectralSummaryBytes = header.dataOffset - summaryEnd;
+
       switch (encoding)
       {
       case AU_SAMPLE_FORMAT_16:
@@ -544,10 +1075,18 @@ auto SimpleBlockFile::GetSpaceUsage() const -> DiskByteCount
    return (
           sizeof(auHeader) +
           mSummaryInfo.totalSummaryBytes +
+          mSpectralSummaryBytes +
           (GetLength() * SAMPLE_SIZE_DISK(mFormat))
    );
 }
 
+void SimpleBlockFile::PrepareLoaded() const
+{
+   // A missing file is reported later by ProjectFSCK, not here
+   wxLogNull logNo;
+   GetSpaceUsage();
+}
+
 void SimpleBlockFile::Recover(){
    wxFFile file(mFileName.GetFullPath(), wxT("wb"));
 
@@ -581,6 +1120,15 @@ void SimpleBlockFile::WriteCacheToDisk()
    if (!GetNeedWriteCacheToDisk())
       return;
 
+   if (std::atomic_load( &mPending )) {
+      // Don't wait for the writer thread
+      BlockWriteQueue::Get().Remove( this );
+      if (std::atomic_load( &mPending ) && !WritePending())
+         throw FileException{
+            FileException::Cause::Write, GetFileName().name };
+      return;
+   }
+
    if (WriteSimpleBlockFile(mCache.sampleData.get(), mLen, mCache.format,
                             mCache.summaryData.get()))
       mCache.needWrite = false;
@@ -588,7 +1136,31 @@ void SimpleBlockFile::WriteCacheToDisk()
 
 bool SimpleBlockFile::GetNeedWriteCacheToDisk()
 {
-   return mCache.active && mCache.needWrite;
+   return (mCache.active && mCache.needWrite) ||
+      std::atomic_load( &mPending );
+}
+
+bool SimpleBlockFile::WritePending()
+{
+   const auto pPending = std::atomic_load( &mPending );
+   if (!pPending)
+      return true;
+   if (!WriteSimpleBlockFile(pPending->sampleData.get(), mLen,
+         pPending->format, pPending->summaryData.get()))
+      return false;
+   // Readers now go to the file
+   std::atomic_store( &mPending, std::shared_ptr<const PendingWrite>{} );
+   CacheBudget::Get().Release(CacheBudget::RecordedBlocks,
+      mLen * SAMPLE_SIZE(pPending->format));
+   return true;
+}
+
+bool SimpleBlockFile::GetStoreSpectralSummaries()
+{
+   bool storeSpectralSummaries = false;
+   gPrefs->Read(wxT("/Spectrum/StoreSpectralSummaries"),
+      &storeSpectralSummaries);
+   return storeSpectralSummaries;
 }
 
 bool SimpleBlockFile::GetCache()
@@ -611,6 +1183,13 @@ bool SimpleBlockFile::GetCache()
 #endif
 }
 
+bool SimpleBlockFile::GetWriteBehind()
+{
+   bool writeBehind = false;
+   gPrefs->Read(wxT("/Directories/WriteBehind"), &writeBehind);
+   return writeBehind;
+}
+
 static DirManager::RegisteredBlockFileDeserializer sRegistration {
    "simpleblockfile",
    []( DirManager &dm, const wxChar **attrs ){
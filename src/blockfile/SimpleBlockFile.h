@@ -64,6 +64,9 @@ class PROFILE_DLL_API SimpleBlockFile /* not final */ : public BlockFile {
    /// Read the data section of the disk file
    size_t ReadData(samplePtr data, sampleFormat format,
                         size_t start, size_t len, bool mayThrow) const override;
+   /// Read frames of the spectral summary section, if the file has one
+   bool ReadSpectralFrames(size_t windowSize, int windowType,
+      size_t first, size_t nFrames, float *buffer) const override;
 
    /// Create a NEW block file identical to this one
    BlockFilePtr Copy(wxFileNameWrapper &&newFileName) override;
@@ -71,6 +74,8 @@ class PROFILE_DLL_API SimpleBlockFile /* not final */ : public BlockFile {
    void SaveXML(XMLWriter &xmlFile) override;
 
    DiskByteCount GetSpaceUsage() const override;
+   /// Read the format from the file header, as GetSpaceUsage() would
+   void PrepareLoaded() const override;
    void Recover() override;
 
    static BlockFilePtr BuildFromXML(DirManager &dm, const wxChar **attrs);
@@ -82,17 +87,43 @@ class PROFILE_DLL_API SimpleBlockFile /* not final */ : public BlockFile {
 
    void FillCache() /* noexcept */ override;
 
+   /// While throttled, blocks written behind wait in memory, leaving the
+   /// disk to a recording whose capture buffers are filling; any thread
+   static void SetWriteThrottled(bool throttled);
+
  protected:
 
    bool WriteSimpleBlockFile(samplePtr sampleData, size_t sampleLen,
                              sampleFormat format, void* summaryData);
    static bool GetCache();
+   static bool GetStoreSpectralSummaries();
+   static bool GetWriteBehind();
    void ReadIntoCache();
 
    SimpleBlockFileCache mCache;
 
  private:
+   friend class BlockWriteQueue;
+
+   // Samples and summary of a block whose file is not written yet
+   struct PendingWrite {
+      ArrayOf<char> sampleData, summaryData;
+      sampleFormat format;
+   };
+
+   /// Write the pending contents; called by the writer thread, or by
+   /// WriteCacheToDisk() after taking the block from it
+   bool WritePending();
+
+   // Non-null until the writer thread has written the file.  Access only
+   // with std::atomic_load and std::atomic_store, as other threads read
+   // the block meanwhile.
+   std::shared_ptr<const PendingWrite> mPending;
+
    mutable sampleFormat mFormat; // may be found lazily
+   // Size of the optional spectral summary section between the summary
+   // and the samples
+   mutable size_t mSpectralSummaryBytes{ 0 }; // may be found lazily
 };
 
 #endif
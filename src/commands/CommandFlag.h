@@ -35,6 +35,13 @@ constexpr CommandFlag
    AlwaysEnabledFlag{},      // all zeroes
    NoFlagsSpecified{ ~0ULL }; // all ones
 
+// Kinds of events, after which tests of some command flags may answer
+// differently
+enum CommandFlagDependency : unsigned {
+   // Tracks added, removed, reordered, selected or deselected
+   TrackListDependency = 1u << 0,
+};
+
 struct CommandFlagOptions{
    // Supplied the translated name of the command, returns a translated
    // error message
@@ -55,6 +62,8 @@ struct CommandFlagOptions{
    { enableDefaultMessage = false; return std::move( *this ); }
    CommandFlagOptions && Priority( unsigned priority_ ) &&
    { priority = priority_; return std::move( *this ); }
+   CommandFlagOptions && DependsOn( unsigned dependencies_ ) &&
+   { dependencies = dependencies_; return std::move( *this ); }
 
    // null, or else computes non-default message for the dialog box when the
    // condition is not satisfied for the selected command
@@ -80,6 +89,11 @@ struct CommandFlagOptions{
    // test may be skipped and the condition assumed to be unchanged since the
    // last more comprehensive testing
    bool quickTest = false;
+
+   // Bits of CommandFlagDependency.  If nonzero, and not a quick test, then
+   // updates of the menus in idle time reuse the last result of the test
+   // until an event of one of these kinds is received
+   unsigned dependencies = 0;
 };
 
 // Construct one statically to register (and reserve) a bit position in the set
@@ -295,9 +295,12 @@ void CommandManager::PurgeData()
    mCommandNameHash.clear();
    mCommandKeyHash.clear();
    mCommandNumericIDHash.clear();
+   mCommandKeyCodeHash.clear();
 
    mCurrentMenuName = COMMAND;
    mCurrentID = 17000;
+
+   mFlagsValid = false;
 }
 
 
@@ -458,6 +461,33 @@ wxMenu * CommandManager::CurrentSubMenu() const
    return mSubMenuList.back()->menu.get();
 }
 
+CommandListEntry *CommandManager::FindEntry(const CommandID &name) const
+{
+   auto iter = mCommandNameHash.find(name);
+   return iter == mCommandNameHash.end() ? nullptr : iter->second;
+}
+
+CommandListEntry *CommandManager::FindEntry(int id) const
+{
+   auto iter = mCommandNumericIDHash.find(id);
+   return iter == mCommandNumericIDHash.end() ? nullptr : iter->second;
+}
+
+CommandListEntry *CommandManager::FindEntry(const wxKeyEvent &evt) const
+{
+   // Format the key string only the first time each keystroke is seen
+   const auto code = KeyEventToKeyCode(evt);
+   auto iter = mCommandKeyCodeHash.find(code);
+   if (iter != mCommandKeyCodeHash.end())
+      return iter->second;
+
+   auto keyIter = mCommandKeyHash.find(KeyEventToKeyString(evt));
+   const auto entry =
+      keyIter == mCommandKeyHash.end() ? nullptr : keyIter->second;
+   mCommandKeyCodeHash[code] = entry;
+   return entry;
+}
+
 ///
 /// This returns the current menu that we're appending to - note that
 /// it could be a submenu if BeginSubMenu was called and we haven't
@@ -631,7 +661,7 @@ CommandListEntry *CommandManager::NewIdentifier(const CommandID & nameIn,
    auto name = nameIn;
 
    // If we have the identifier already, reuse it.
-   CommandListEntry *prev = mCommandNameHash[name];
+   CommandListEntry *prev = FindEntry(name);
    if (!prev);
    else if( prev->label != label );
    else if( multi );
@@ -720,6 +750,7 @@ CommandListEntry *CommandManager::NewIdentifier(const CommandID & nameIn,
 
       mCommandList.push_back(std::move(entry));
       // Don't use the variable entry eny more!
+      mFlagsValid = false;
    }
 
    // New variable
@@ -727,7 +758,7 @@ CommandListEntry *CommandManager::NewIdentifier(const CommandID & nameIn,
    mCommandNumericIDHash[entry->id] = entry;
 
 #if defined(__WXDEBUG__)
-   prev = mCommandNameHash[entry->name];
+   prev = FindEntry(entry->name);
    if (prev) {
       // Under Linux it looks as if we may ask for a newID for the same command
       // more than once.  So it's only an error if two different commands
@@ -752,6 +783,7 @@ CommandListEntry *CommandManager::NewIdentifier(const CommandID & nameIn,
 
    if (!entry->key.empty()) {
       mCommandKeyHash[entry->key] = entry;
+      mCommandKeyCodeHash.clear();
    }
 
    return entry;
@@ -855,7 +887,7 @@ void CommandManager::Enable(CommandListEntry *entry, bool enabled)
 
          // This menu item is not necessarily in the same menu, because
          // multi-items can be spread across multiple sub menus
-         CommandListEntry *multiEntry = mCommandNumericIDHash[ID];
+         CommandListEntry *multiEntry = FindEntry(ID);
          if (multiEntry) {
             wxMenuItem *item = multiEntry->menu->FindItem(ID);
 
@@ -875,7 +907,7 @@ void CommandManager::Enable(CommandListEntry *entry, bool enabled)
 
 void CommandManager::Enable(const wxString &name, bool enabled)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry || !entry->menu) {
       wxLogDebug(wxT("Warning: Unknown command enabled: '%s'"),
                  (const wxChar*)name);
@@ -894,6 +926,16 @@ void CommandManager::EnableUsingFlags(
    // conditions
    wxASSERT( (strictFlags & ~flags).none() );
 
+   // Visit only the commands that require some flag that changed since the
+   // last call; after any change of the commands, visit all again
+   const auto changed =
+      mFlagsValid ? (flags ^ mLastFlags) : NoFlagsSpecified;
+   const auto strictChanged =
+      mFlagsValid ? (strictFlags ^ mLastStrictFlags) : NoFlagsSpecified;
+   mLastFlags = flags;
+   mLastStrictFlags = strictFlags;
+   mFlagsValid = true;
+
    for(const auto &entry : mCommandList) {
       if (entry->multi && entry->index != 0)
          continue;
@@ -901,6 +943,10 @@ void CommandManager::EnableUsingFlags(
          continue;
 
       auto useFlags = entry->useStrictFlags ? strictFlags : flags;
+      const auto &useChanged =
+         entry->useStrictFlags ? strictChanged : changed;
+      if ((entry->flags & useChanged).none())
+         continue;
 
       if (entry->flags.any()) {
          bool enable = ((useFlags & entry->flags) == entry->flags);
@@ -911,7 +957,7 @@ void CommandManager::EnableUsingFlags(
 
 bool CommandManager::GetEnabled(const CommandID &name)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry || !entry->menu) {
       // using GET in a log message for devs' eyes only
       wxLogDebug(wxT("Warning: command doesn't exist: '%s'"),
@@ -928,7 +974,7 @@ int CommandManager::GetNumberOfKeysRead() const
 
 void CommandManager::Check(const CommandID &name, bool checked)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry || !entry->menu || entry->isOccult) {
       return;
    }
@@ -938,7 +984,7 @@ void CommandManager::Check(const CommandID &name, bool checked)
 ///Changes the label text of a menu item
 void CommandManager::Modify(const wxString &name, const TranslatableString &newLabel)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (entry && entry->menu) {
       entry->label = newLabel;
       entry->menu->SetLabel(entry->id, FormatLabelForMenu(entry));
@@ -948,7 +994,7 @@ void CommandManager::Modify(const wxString &name, const TranslatableString &newL
 void CommandManager::SetKeyFromName(const CommandID &name,
                                     const NormalizedKeyString &key)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (entry) {
       entry->key = key;
    }
@@ -1022,7 +1068,7 @@ bool CommandManager::FilterKeyEvent(AudacityProject *project, const wxKeyEvent &
       return false;
    
    auto pWindow = FindProjectFrame( project );
-   CommandListEntry *entry = mCommandKeyHash[KeyEventToKeyString(evt)];
+   CommandListEntry *entry = FindEntry(evt);
    if (entry == NULL)
    {
       return false;
@@ -1168,7 +1214,7 @@ bool CommandManager::HandleCommandEntry(AudacityProject &project,
 bool CommandManager::HandleMenuID(
    AudacityProject &project, int id, CommandFlag flags, bool alwaysEnabled)
 {
-   CommandListEntry *entry = mCommandNumericIDHash[id];
+   CommandListEntry *entry = FindEntry(id);
 
    auto hook = sMenuHook();
    if (hook && hook(entry->name))
@@ -1323,7 +1369,7 @@ void CommandManager::GetAllCommandData(
 
 CommandID CommandManager::GetNameFromNumericID(int id)
 {
-   CommandListEntry *entry = mCommandNumericIDHash[id];
+   CommandListEntry *entry = FindEntry(id);
    if (!entry)
       return {};
    return entry->name;
@@ -1331,7 +1377,7 @@ CommandID CommandManager::GetNameFromNumericID(int id)
 
 TranslatableString CommandManager::GetLabelFromName(const CommandID &name)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry)
       return {};
 
@@ -1340,7 +1386,7 @@ TranslatableString CommandManager::GetLabelFromName(const CommandID &name)
 
 TranslatableString CommandManager::GetPrefixedLabelFromName(const CommandID &name)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry)
       return {};
 
@@ -1353,7 +1399,7 @@ TranslatableString CommandManager::GetPrefixedLabelFromName(const CommandID &nam
 
 wxString CommandManager::GetCategoryFromName(const CommandID &name)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry)
       return wxT("");
 
@@ -1362,9 +1408,7 @@ wxString CommandManager::GetCategoryFromName(const CommandID &name)
 
 NormalizedKeyString CommandManager::GetKeyFromName(const CommandID &name) const
 {
-   CommandListEntry *entry =
-      // May create a NULL entry
-      const_cast<CommandManager*>(this)->mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry)
       return {};
 
@@ -1373,7 +1417,7 @@ NormalizedKeyString CommandManager::GetKeyFromName(const CommandID &name) const
 
 NormalizedKeyString CommandManager::GetDefaultKeyFromName(const CommandID &name)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
+   CommandListEntry *entry = FindEntry(name);
    if (!entry)
       return {};
 
@@ -1403,8 +1447,8 @@ bool CommandManager::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
             key = NormalizedKeyString{ value };
       }
 
-      if (mCommandNameHash[name]) {
-         mCommandNameHash[name]->key = key;
+      if (auto entry = FindEntry(CommandID{ name })) {
+         entry->key = key;
          mXMLKeysRead++;
       }
    }
@@ -1471,9 +1515,11 @@ void CommandManager::EndOccultCommands()
 void CommandManager::SetCommandFlags(const CommandID &name,
                                      CommandFlag flags)
 {
-   CommandListEntry *entry = mCommandNameHash[name];
-   if (entry)
+   CommandListEntry *entry = FindEntry(name);
+   if (entry) {
       entry->flags = flags;
+      mFlagsValid = false;
+   }
 }
 
 #if defined(__WXDEBUG__)
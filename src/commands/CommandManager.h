@@ -100,6 +100,9 @@ using CommandList = std::vector<std::unique_ptr<CommandListEntry>>;
 using CommandKeyHash = std::unordered_map<NormalizedKeyString, CommandListEntry*>;
 using CommandNameHash = std::unordered_map<CommandID, CommandListEntry*>;
 using CommandNumericIDHash = std::unordered_map<int, CommandListEntry*>;
+// Keyed by KeyEventToKeyCode()
+using CommandKeyCodeHash =
+   std::unordered_map<unsigned long long, CommandListEntry*>;
 
 class AudacityProject;
 class CommandContext;
@@ -357,6 +360,11 @@ private:
    wxMenuBar * CurrentMenuBar() const;
    wxMenuBar * GetMenuBar(const wxString & sMenu) const;
    wxMenu * CurrentSubMenu() const;
+
+   // These return null if not found, and do not insert into the hashes
+   CommandListEntry *FindEntry(const CommandID &name) const;
+   CommandListEntry *FindEntry(int id) const;
+   CommandListEntry *FindEntry(const wxKeyEvent &evt) const;
 public:
    wxMenu * CurrentMenu() const;
 
@@ -384,11 +392,18 @@ private:
    CommandNameHash  mCommandNameHash;
    CommandKeyHash mCommandKeyHash;
    CommandNumericIDHash  mCommandNumericIDHash;
+   // Results of lookups of keystrokes in mCommandKeyHash, including misses,
+   // so that repeated keystrokes need not format key strings
+   mutable CommandKeyCodeHash mCommandKeyCodeHash;
    int mCurrentID;
    int mXMLKeysRead;
 
    bool mbSeparatorAllowed; // false at the start of a menu and immediately after a separator.
 
+   // Arguments of the last EnableUsingFlags, valid until commands change
+   CommandFlag mLastFlags, mLastStrictFlags;
+   bool mFlagsValid{ false };
+
    TranslatableString mCurrentMenuName;
    std::unique_ptr<wxMenu> uCurrentMenu;
    wxMenu *mCurrentMenu {};
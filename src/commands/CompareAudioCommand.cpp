@@ -22,11 +22,16 @@ threshold of difference in two selected tracks
 #include "CompareAudioCommand.h"
 
 #include "LoadCommands.h"
+#include "../BlockFile.h"
+#include "../Sequence.h"
 #include "../ViewInfo.h"
+#include "../WaveClip.h"
 #include "../WaveTrack.h"
 
 
+#include <algorithm>
 #include <float.h>
+#include <string.h>
 #include <wx/intl.h>
 
 #include "../Shuttle.h"
@@ -49,6 +54,7 @@ extern void RegisterCompareAudio( Registrar & R){
 
 bool CompareAudioCommand::DefineParams( ShuttleParams & S ){
    S.Define( errorThreshold,  wxT("Threshold"),   0.0f,  0.0f,    0.01f,    1.0f );
+   S.Define( mReportRMS,      wxT("RMS"),         false );
    return true;
 }
 
@@ -59,6 +65,7 @@ void CompareAudioCommand::PopulateOrExchange(ShuttleGui & S)
    S.StartMultiColumn(2, wxALIGN_CENTER);
    {
       S.TieTextBox(XO("Threshold:"),errorThreshold);
+      S.TieCheckBox(XO("Report RMS difference"),mReportRMS);
    }
    S.EndMultiColumn();
 }
@@ -108,6 +115,43 @@ inline int min(int a, int b)
    return (a < b) ? a : b;
 }
 
+namespace {
+
+// The block file holding the sample of the track at the position, and the
+// range of track samples it covers
+struct BlockSpan {
+   const BlockFile *file = nullptr;
+   sampleCount start = 0, end = 0;
+};
+
+BlockSpan FindBlockSpan(const WaveTrack &track, sampleCount position)
+{
+   BlockSpan result;
+   for (const auto &clip : track.GetClips())
+   {
+      const auto clipStart = clip->GetStartSample();
+      const auto clipEnd = clipStart + clip->GetNumSamples();
+      if (position < clipStart || position >= clipEnd)
+         continue;
+
+      const auto &blocks = clip->GetSequence()->GetBlockArray();
+      const auto offset = position - clipStart;
+      auto iter = std::upper_bound(blocks.begin(), blocks.end(), offset,
+         [](sampleCount value, const SeqBlock &block)
+            { return value < block.start; });
+      if (iter == blocks.begin())
+         break;
+      const auto &block = *--iter;
+      result.file = block.f.get();
+      result.start = clipStart + block.start;
+      result.end = std::min(clipEnd, result.start + block.f->GetLength());
+      break;
+   }
+   return result;
+}
+
+}
+
 bool CompareAudioCommand::Apply(const CommandContext & context)
 {
    if (!GetSelection(context, context.project))
@@ -132,8 +176,26 @@ bool CompareAudioCommand::Apply(const CommandContext & context)
    auto s1 = mTrack0->TimeToLongSamples(mT1);
    auto position = s0;
    auto length = s1 - s0;
+   double sumOfSquares = 0;
    while (position < s1)
    {
+      // Where both tracks have the same block file at the same place, as
+      // after a copy, the samples are the same without reading them
+      const auto span0 = FindBlockSpan(*mTrack0, position);
+      if (span0.file)
+      {
+         const auto span1 = FindBlockSpan(*mTrack1, position);
+         if (span1.file == span0.file && span1.start == span0.start)
+         {
+            position = std::min(span0.end, s1);
+            context.Progress(
+               (position - s0).as_double() /
+               length.as_double()
+            );
+            continue;
+         }
+      }
+
       // Get a block of data into the buffers
       auto block = limitSampleBufferSize(
          mTrack0->GetBestBlockSize(position), s1 - position
@@ -141,12 +203,21 @@ bool CompareAudioCommand::Apply(const CommandContext & context)
       mTrack0->Get((samplePtr)buff0.get(), floatSample, position, block);
       mTrack1->Get((samplePtr)buff1.get(), floatSample, position, block);
 
-      for (decltype(block) buffPos = 0; buffPos < block; ++buffPos)
+      // Identical blocks need no arithmetic
+      if (memcmp(buff0.get(), buff1.get(), block * sizeof(float)) != 0)
       {
-         if (CompareSample(buff0[buffPos], buff1[buffPos]) > errorThreshold)
+         // Branch-free, so that the compiler can vectorize it
+         long blockErrors = 0;
+         double blockSquares = 0;
+         for (decltype(block) buffPos = 0; buffPos < block; ++buffPos)
          {
-            ++errorCount;
+            const double difference =
+               (double)buff0[buffPos] - (double)buff1[buffPos];
+            blockErrors += fabs(difference) > errorThreshold;
+            blockSquares += difference * difference;
          }
+         errorCount += blockErrors;
+         sumOfSquares += blockSquares;
       }
 
       position += block;
@@ -161,6 +232,9 @@ bool CompareAudioCommand::Apply(const CommandContext & context)
    context.Status(wxString::Format(wxT("%li"), errorCount));
    context.Status(wxString::Format(wxT("%.4f"), errorSeconds));
    context.Status(wxString::Format(wxT("Finished comparison: %li samples (%.3f seconds) exceeded the error threshold of %f."), errorCount, errorSeconds, errorThreshold));
+   if (mReportRMS)
+      context.Status(wxString::Format(wxT("RMS difference: %g"),
+         sqrt(sumOfSquares / length.as_double())));
    return true;
 }
 
@@ -41,6 +41,7 @@ public:
 
 private:
    double errorThreshold;
+   bool mReportRMS;
    double mT0, mT1;
    const WaveTrack *mTrack0;
    const WaveTrack *mTrack1;
@@ -0,0 +1,216 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   License: wxwidgets
+
+******************************************************************//**
+
+\file GetAudioStatsCommand.cpp
+\brief Contains definitions for GetAudioStatsCommand class
+
+\class GetAudioStatsCommand
+\brief Streams the selected part of each selected wave track once, and
+returns its peak, RMS, DC offset, EBU R128 loudness and true peak.
+
+Unlike the Normalize and Loudness effects, this copies no tracks, makes
+no undo state and redraws nothing, so it reads as fast as the disk does.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "GetAudioStatsCommand.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "LoadCommands.h"
+#include "../ViewInfo.h"
+#include "../WaveTrack.h"
+#include "../effects/EBUR128.h"
+
+#include "../Shuttle.h"
+#include "../ShuttleGui.h"
+#include "CommandContext.h"
+#include "CommandTargets.h"
+
+const ComponentInterfaceSymbol GetAudioStatsCommand::Symbol
+{ XO("Get Audio Stats") };
+
+namespace{ BuiltinCommandsModule::Registration< GetAudioStatsCommand > reg; }
+
+enum {
+   kJson,
+   kLisp,
+   kBrief,
+   nFormats
+};
+
+static const EnumValueSymbol kFormats[nFormats] =
+{
+   // These are acceptable dual purpose internal/visible names
+
+   /* i18n-hint JavaScript Object Notation */
+   { XO("JSON") },
+   /* i18n-hint name of a computer programming language */
+   { XO("LISP") },
+   { XO("Brief") }
+};
+
+namespace {
+
+// Levels in dB are reported no lower than this, rather than as -infinity,
+// which JSON can't represent
+const double MinDB = -145.0;
+
+double ToDB(double value, double scale)
+{
+   if (value <= 0)
+      return MinDB;
+   return std::max(MinDB, scale * log10(value));
+}
+
+}
+
+bool GetAudioStatsCommand::DefineParams( ShuttleParams & S ){
+   S.DefineEnum( mFormat, wxT("Format"), 0, kFormats, nFormats );
+   return true;
+}
+
+void GetAudioStatsCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieChoice( XO("Format:"),
+         mFormat, Msgids( kFormats, nFormats ));
+   }
+   S.EndMultiColumn();
+}
+
+bool GetAudioStatsCommand::Apply(const CommandContext &context)
+{
+   if( mFormat == kJson )
+      return ApplyInner( context );
+
+   if( mFormat == kLisp )
+   {
+      CommandContext LispyContext(
+         context.project,
+         std::make_unique<LispifiedCommandOutputTargets>( *context.pOutput.get() )
+         );
+      return ApplyInner( LispyContext );
+   }
+
+   if( mFormat == kBrief )
+   {
+      CommandContext BriefContext(
+         context.project,
+         std::make_unique<BriefCommandOutputTargets>( *context.pOutput.get() )
+         );
+      return ApplyInner( BriefContext );
+   }
+
+   return false;
+}
+
+bool GetAudioStatsCommand::ApplyInner(const CommandContext &context)
+{
+   auto &selectedRegion = ViewInfo::Get( context.project ).selectedRegion;
+   const double t0 = selectedRegion.t0();
+   const double t1 = selectedRegion.t1();
+   if (t0 >= t1)
+   {
+      context.Error(wxT("There is no selection!"));
+      return false;
+   }
+
+   auto &tracks = TrackList::Get( context.project );
+   auto range = tracks.Selected< const WaveTrack >() + &Track::IsLeader;
+
+   // Total samples of all channels, for the progress
+   double total = 0;
+   for (auto track : range)
+      total += TrackList::Channels( track ).size() *
+         (track->TimeToLongSamples( t1 ) - track->TimeToLongSamples( t0 ))
+            .as_double();
+   double done = 0;
+
+   context.StartArray();
+   for (auto track : range) {
+      const auto channels = TrackList::Channels( track );
+      const auto nChannels = channels.size();
+      const double start = std::max( t0, track->GetStartTime() );
+      const double end = std::min( t1, track->GetEndTime() );
+      const auto s0 = track->TimeToLongSamples( start );
+      const auto s1 = track->TimeToLongSamples( std::max( start, end ) );
+
+      // One cache per channel, reading ahead, so each sample is read once
+      std::vector< WaveTrackCache > caches( nChannels );
+      size_t blockSize = 0;
+      {
+         size_t ii = 0;
+         for (auto channel : channels) {
+            caches[ii].SetTrack( channel->SharedPointer< const WaveTrack >() );
+            caches[ii].SetReadAhead( true );
+            blockSize = std::max( blockSize, channel->GetMaxBlockSize() );
+            ++ii;
+         }
+      }
+
+      EBUR128 loudness( track->GetRate(), nChannels );
+      loudness.Initialize();
+      std::vector< const float* > buffers( nChannels );
+      float minimum = 0;
+      float maximum = 0;
+      double sum = 0;
+      double sumOfSquares = 0;
+
+      for (auto position = s0; position < s1;) {
+         const auto block = limitSampleBufferSize( blockSize, s1 - position );
+         for (size_t ii = 0; ii < nChannels; ++ii) {
+            // Each cache keeps its own buffer, valid until its next Get
+            const auto pSamples = reinterpret_cast< const float* >(
+               caches[ii].Get( floatSample, position, block, true ) );
+            buffers[ii] = pSamples;
+            for (size_t jj = 0; jj < block; ++jj) {
+               const float value = pSamples[jj];
+               minimum = std::min( minimum, value );
+               maximum = std::max( maximum, value );
+               sum += value;
+               sumOfSquares += double( value ) * value;
+            }
+         }
+         loudness.ProcessBuffers( buffers.data(), block );
+
+         position += block;
+         done += double( block ) * nChannels;
+         context.Progress( total > 0 ? done / total : 1.0 );
+      }
+      const float peak = std::max( -minimum, maximum );
+
+      const double count = (s1 - s0).as_double() * nChannels;
+      // An empty selection has no loudness
+      const double integrated = count > 0 ? loudness.IntegrativeLoudness() : 0;
+      context.StartStruct();
+      context.AddItem( track->GetName(), "name" );
+      context.AddItem( start, "start" );
+      context.AddItem( std::max( start, end ), "end" );
+      context.AddItem( (double)nChannels, "channels" );
+      context.AddItem( minimum, "min" );
+      context.AddItem( maximum, "max" );
+      context.AddItem( ToDB( peak, 20 ), "peak" );
+      context.AddItem(
+         ToDB( count > 0 ? sqrt( sumOfSquares / count ) : 0, 20 ), "rms" );
+      context.AddItem( count > 0 ? sum / count : 0, "dc" );
+      context.AddItem( ToDB( integrated, 10 ), "lufs" );
+      context.AddItem(
+         ToDB( loudness.MaxShortTermLoudness(), 10 ), "shortterm" );
+      context.AddItem( ToDB( loudness.TruePeak(), 20 ), "truepeak" );
+      context.EndStruct();
+   }
+   context.EndArray();
+
+   return true;
+}
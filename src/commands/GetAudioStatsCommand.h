@@ -0,0 +1,40 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   License: wxwidgets
+
+******************************************************************//**
+
+\file GetAudioStatsCommand.h
+\brief Declarations for GetAudioStatsCommand class
+
+*//*******************************************************************/
+
+#ifndef __GET_AUDIO_STATS_COMMAND__
+#define __GET_AUDIO_STATS_COMMAND__
+
+#include "Command.h"
+#include "CommandType.h"
+
+class GetAudioStatsCommand final : public AudacityCommand
+{
+public:
+   static const ComponentInterfaceSymbol Symbol;
+
+   // ComponentInterface overrides
+   ComponentInterfaceSymbol GetSymbol() override {return Symbol;};
+   TranslatableString GetDescription() override {return XO("Measures the peak, RMS and loudness of the selected audio.");};
+   bool DefineParams( ShuttleParams & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+
+   // AudacityCommand overrides
+   wxString ManualPage() override {return wxT("Extra_Menu:_Scriptables_II#get_audio_stats");};
+   bool Apply(const CommandContext &context) override;
+   bool ApplyInner(const CommandContext &context);
+
+public:
+   int mFormat;
+};
+
+#endif /* End of include guard: __GET_AUDIO_STATS_COMMAND__ */
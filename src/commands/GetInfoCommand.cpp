@@ -24,6 +24,8 @@ This class now lists
 #include "GetInfoCommand.h"
 
 #include "LoadCommands.h"
+#include "../AudioIOBase.h"
+#include "../BlockFileIOStats.h"
 #include "../Project.h"
 #include "CommandManager.h"
 #include "CommandTargets.h"
@@ -64,6 +66,8 @@ enum {
    kEnvelopes,
    kLabels,
    kBoxes,
+   kAudioIO,
+   kIOStats,
    nTypes
 };
 
@@ -78,6 +82,8 @@ static const EnumValueSymbol kTypes[nTypes] =
    { XO("Envelopes") },
    { XO("Labels") },
    { XO("Boxes") },
+   { wxT("AudioIO"), XO("Audio I/O") },
+   { wxT("IOStats"), XO("Block File I/O") },
 };
 
 enum {
@@ -158,6 +164,8 @@ bool GetInfoCommand::ApplyInner(const CommandContext &context)
       case kEnvelopes    : return SendEnvelopes( context );
       case kLabels       : return SendLabels( context );
       case kBoxes        : return SendBoxes( context );
+      case kAudioIO      : return SendAudioIO( context );
+      case kIOStats      : return SendIOStats( context );
       default:
          context.Status( "Command options not recognised" );
    }
@@ -497,6 +505,95 @@ bool GetInfoCommand::SendClips(const CommandContext &context)
    return true;
 }
 
+bool GetInfoCommand::SendAudioIO(const CommandContext &context)
+{
+   const auto snapshot = AudioIOBase::Get()->GetMetrics().GetSnapshot();
+
+   const auto sendTiming = [&]( const AudioIOMetrics::Timing &timing,
+      const wxString &name ){
+      context.StartField( name );
+      context.StartStruct();
+      context.AddItem( (double)timing.count, "count" );
+      context.AddItem( timing.totalMicroseconds / 1e6, "total" );
+      context.AddItem( timing.maxMicroseconds / 1e6, "longest" );
+      // Bucket ii counts durations under 2^(ii + FirstBucketLog2) us
+      context.StartField( "histogram" );
+      context.StartArray();
+      for (auto count : timing.histogram)
+         context.AddItem( (double)count );
+      context.EndArray();
+      context.EndField();
+      context.EndStruct();
+      context.EndField();
+   };
+
+   context.StartStruct();
+   context.AddItem( snapshot.rate, "rate" );
+   sendTiming( snapshot.callback, "callback" );
+   context.AddItem( (double)snapshot.lateCallbacks, "latecallbacks" );
+   sendTiming( snapshot.fillBuffers, "fillbuffers" );
+   context.AddItem( (double)snapshot.minPlaybackReady, "minplaybackready" );
+   context.AddItem( (double)snapshot.lastPlaybackReady, "playbackready" );
+   context.AddItem( (double)snapshot.maxCaptureAvail, "maxcaptureavail" );
+   context.AddItem( (double)snapshot.lastCaptureAvail, "captureavail" );
+   context.AddItem( (double)snapshot.inputUnderflows, "inputunderflows" );
+   context.AddItem( (double)snapshot.inputOverflows, "inputoverflows" );
+   context.AddItem( (double)snapshot.outputUnderflows, "outputunderflows" );
+   context.AddItem( (double)snapshot.outputOverflows, "outputoverflows" );
+   context.StartField( "xruns" );
+   context.StartArray();
+   for (const auto &xrun : snapshot.recentXruns) {
+      context.StartStruct();
+      context.AddItem( xrun.time, "time" );
+      context.AddItem( (double)xrun.flags, "flags" );
+      context.EndStruct();
+   }
+   context.EndArray();
+   context.EndField();
+   context.EndStruct();
+
+   return true;
+}
+
+bool GetInfoCommand::SendIOStats(const CommandContext &context)
+{
+   const auto snapshot = BlockFileIOStats::Get().GetSnapshot();
+
+   context.StartStruct();
+   context.AddItem( (double)snapshot.cacheHits, "cachehits" );
+   context.AddItem( (double)snapshot.cacheMisses, "cachemisses" );
+   for (unsigned kind = 0; kind < BlockFileIOStats::NKinds; ++kind) {
+      context.StartField(
+         BlockFileIOStats::GetName( BlockFileIOStats::Kind( kind ) ) );
+      context.StartStruct();
+      for (unsigned operation = 0;
+           operation < BlockFileIOStats::NOperations; ++operation) {
+         const auto &counts = snapshot.counts[kind][operation];
+         context.StartField( BlockFileIOStats::GetName(
+            BlockFileIOStats::Operation( operation ) ) );
+         context.StartStruct();
+         context.AddItem( (double)counts.count, "count" );
+         context.AddItem( (double)counts.bytes, "bytes" );
+         context.AddItem( counts.totalMicroseconds / 1e6, "total" );
+         context.AddItem( counts.maxMicroseconds / 1e6, "longest" );
+         // Bucket ii counts durations under 2^(ii + FirstBucketLog2) us
+         context.StartField( "histogram" );
+         context.StartArray();
+         for (auto count : counts.histogram)
+            context.AddItem( (double)count );
+         context.EndArray();
+         context.EndField();
+         context.EndStruct();
+         context.EndField();
+      }
+      context.EndStruct();
+      context.EndField();
+   }
+   context.EndStruct();
+
+   return true;
+}
+
 bool GetInfoCommand::SendEnvelopes(const CommandContext &context)
 {
    auto &tracks = TrackList::Get( context.project );
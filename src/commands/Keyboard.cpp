@@ -80,6 +80,22 @@ wxString NormalizedKeyString::Display(bool usesSpecialChars) const
    return newkey;
 }
 
+unsigned long long KeyEventToKeyCode(const wxKeyEvent & event)
+{
+   // The key code in the low bits, and above it, the modifiers examined by
+   // KeyEventToKeyString
+   unsigned long long code = static_cast<unsigned>(event.GetKeyCode());
+   if (event.ControlDown())
+      code |= 1ull << 32;
+   if (event.AltDown())
+      code |= 1ull << 33;
+   if (event.ShiftDown())
+      code |= 1ull << 34;
+   if (event.RawControlDown())
+      code |= 1ull << 35;
+   return code;
+}
+
 NormalizedKeyString KeyEventToKeyString(const wxKeyEvent & event)
 {
    wxString newStr;
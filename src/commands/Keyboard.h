@@ -37,4 +37,8 @@ namespace std
 
 NormalizedKeyString KeyEventToKeyString(const wxKeyEvent & keyEvent);
 
+// A number that determines KeyEventToKeyString( keyEvent ), and cheaper to
+// compute, without allocations, for indexing lookups of keystrokes
+unsigned long long KeyEventToKeyCode(const wxKeyEvent & keyEvent);
+
 #endif
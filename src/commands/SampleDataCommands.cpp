@@ -0,0 +1,203 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   File License: wxWidgets
+
+******************************************************************//**
+
+\file SampleDataCommands.cpp
+\brief Contains definitions for the GetSamplesCommand and SetSamplesCommand
+classes
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "SampleDataCommands.h"
+
+#include "LoadCommands.h"
+#include "../ViewInfo.h"
+#include "../WaveTrack.h"
+#include "../Shuttle.h"
+#include "../ShuttleGui.h"
+#include "CommandContext.h"
+
+#include <vector>
+#include <wx/ffile.h>
+
+namespace {
+
+// The selected wave channels and the sample range of the selection in the
+// first of them, or false after reporting what is wrong
+bool GetSampleSelection(const CommandContext &context,
+   std::vector<WaveTrack*> &channels, sampleCount &s0, sampleCount &s1)
+{
+   auto &selectedRegion = ViewInfo::Get( context.project ).selectedRegion;
+   const auto range =
+      TrackList::Get( context.project ).Selected< WaveTrack >();
+   channels.clear();
+   for (auto channel : range)
+      channels.push_back( channel );
+   if (channels.empty())
+   {
+      context.Error(wxT("No wave tracks selected!"));
+      return false;
+   }
+   s0 = channels[0]->TimeToLongSamples( selectedRegion.t0() );
+   s1 = channels[0]->TimeToLongSamples( selectedRegion.t1() );
+   if (s0 >= s1)
+   {
+      context.Error(wxT("There is no selection!"));
+      return false;
+   }
+   return true;
+}
+
+}
+
+const ComponentInterfaceSymbol GetSamplesCommand::Symbol
+{ XO("Get Samples") };
+
+namespace{ BuiltinCommandsModule::Registration< GetSamplesCommand > reg; }
+
+bool GetSamplesCommand::DefineParams( ShuttleParams & S ){
+   S.Define( mFileName, wxT("Filename"),  "samples.raw" );
+   return true;
+}
+
+void GetSamplesCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieTextBox(XO("File Name:"),mFileName);
+   }
+   S.EndMultiColumn();
+}
+
+bool GetSamplesCommand::Apply(const CommandContext & context)
+{
+   std::vector<WaveTrack*> channels;
+   sampleCount s0, s1;
+   if (!GetSampleSelection(context, channels, s0, s1))
+      return false;
+
+   wxFFile file( mFileName, wxT("wb") );
+   if (!file.IsOpened())
+   {
+      context.Error(wxT("Could not open the file for writing."));
+      return false;
+   }
+
+   // Read sequentially through a cache, with read-ahead, a block at a time
+   const auto length = s1 - s0;
+   for (size_t ii = 0; ii < channels.size(); ++ii)
+   {
+      WaveTrackCache cache{ channels[ii]->SharedPointer<const WaveTrack>() };
+      cache.SetReadAhead(true);
+      for (auto position = s0; position < s1;)
+      {
+         const auto block = limitSampleBufferSize(
+            channels[ii]->GetBestBlockSize(position), s1 - position );
+         const auto samples = cache.Get( floatSample, position, block, true );
+         if (!samples ||
+             file.Write( samples, block * sizeof(float) ) !=
+                block * sizeof(float))
+         {
+            context.Error(wxT("Could not write the samples."));
+            return false;
+         }
+         position += block;
+         context.Progress(
+            (ii + (position - s0).as_double() / length.as_double()) /
+            channels.size() );
+      }
+   }
+
+   context.Status(wxString::Format(wxT("%lu %lld"),
+      (unsigned long)channels.size(), length.as_long_long()));
+   return true;
+}
+
+
+
+const ComponentInterfaceSymbol SetSamplesCommand::Symbol
+{ XO("Set Samples") };
+
+namespace{ BuiltinCommandsModule::Registration< SetSamplesCommand > reg2; }
+
+bool SetSamplesCommand::DefineParams( ShuttleParams & S ){
+   S.Define( mFileName, wxT("Filename"),  "samples.raw" );
+   return true;
+}
+
+void SetSamplesCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieTextBox(XO("File Name:"),mFileName);
+   }
+   S.EndMultiColumn();
+}
+
+bool SetSamplesCommand::Apply(const CommandContext & context)
+{
+   std::vector<WaveTrack*> channels;
+   sampleCount s0, s1;
+   if (!GetSampleSelection(context, channels, s0, s1))
+      return false;
+
+   wxFFile file( mFileName, wxT("rb") );
+   if (!file.IsOpened())
+   {
+      context.Error(wxT("Could not open the file for reading."));
+      return false;
+   }
+
+   // The file must hold the whole selection for every channel
+   const auto length = s1 - s0;
+   const wxFileOffset expected =
+      length.as_long_long() * channels.size() * sizeof(float);
+   if (file.Length() != expected)
+   {
+      context.Error(wxString::Format(
+         wxT("Expected %lld bytes, for %lu channels of %lld samples."),
+         (long long)expected, (unsigned long)channels.size(),
+         length.as_long_long()));
+      return false;
+   }
+
+   // Write in the blocks the tracks are made of, so that each Set replaces
+   // whole block files where it can
+   Floats buffer;
+   size_t bufferSize = 0;
+   for (size_t ii = 0; ii < channels.size(); ++ii)
+   {
+      const auto channel = channels[ii];
+      for (auto position = s0; position < s1;)
+      {
+         const auto block = limitSampleBufferSize(
+            channel->GetBestBlockSize(position), s1 - position );
+         if (block > bufferSize)
+            buffer.reinit( bufferSize = block );
+         if (file.Read( buffer.get(), block * sizeof(float) ) !=
+                block * sizeof(float))
+         {
+            context.Error(wxT("Could not read the samples."));
+            return false;
+         }
+         channel->Set( (samplePtr)buffer.get(), floatSample, position, block );
+         position += block;
+         context.Progress(
+            (ii + (position - s0).as_double() / length.as_double()) /
+            channels.size() );
+      }
+   }
+
+   context.Status(wxString::Format(wxT("%lu %lld"),
+      (unsigned long)channels.size(), length.as_long_long()));
+   return true;
+}
@@ -0,0 +1,66 @@
+/**********************************************************************
+
+   Audacity: A Digital Audio Editor
+   Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+   File License: wxwidgets
+
+   SampleDataCommands.h
+
+******************************************************************//**
+
+\class GetSamplesCommand
+\brief Command for writing the samples of the selection to a raw file
+
+\class SetSamplesCommand
+\brief Command for replacing the samples of the selection from a raw file
+
+The file holds 32 bit floats in the byte order of the machine, for each
+selected wave channel in turn.  A file in shared memory, such as one in
+/dev/shm, lets another process read and write the audio of a project
+without export or import.
+
+*//*******************************************************************/
+
+#ifndef __SAMPLE_DATA_COMMANDS__
+#define __SAMPLE_DATA_COMMANDS__
+
+#include "Command.h"
+#include "CommandType.h"
+
+class GetSamplesCommand : public AudacityCommand
+{
+public:
+   static const ComponentInterfaceSymbol Symbol;
+
+   // ComponentInterface overrides
+   ComponentInterfaceSymbol GetSymbol() override {return Symbol;};
+   TranslatableString GetDescription() override {return XO("Writes the selected samples to a raw file.");};
+   bool DefineParams( ShuttleParams & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+   bool Apply(const CommandContext & context) override;
+
+   // AudacityCommand overrides
+   wxString ManualPage() override {return wxT("Extra_Menu:_Scriptables_II#get_samples");};
+public:
+   wxString mFileName;
+};
+
+class SetSamplesCommand : public AudacityCommand
+{
+public:
+   static const ComponentInterfaceSymbol Symbol;
+
+   // ComponentInterface overrides
+   ComponentInterfaceSymbol GetSymbol() override {return Symbol;};
+   TranslatableString GetDescription() override {return XO("Replaces the selected samples from a raw file.");};
+   bool DefineParams( ShuttleParams & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+   bool Apply(const CommandContext & context) override;
+
+   // AudacityCommand overrides
+   wxString ManualPage() override {return wxT("Extra_Menu:_Scriptables_II#set_samples");};
+public:
+   wxString mFileName;
+};
+
+#endif /* End of include guard: __SAMPLE_DATA_COMMANDS__ */
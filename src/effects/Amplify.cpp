@@ -184,6 +184,22 @@ bool EffectAmplify::LoadFactoryDefaults()
 
 // Effect implementation
 
+std::unique_ptr<Effect> EffectAmplify::MakeParallelProcessor()
+{
+   return std::make_unique<EffectAmplify>();
+}
+
+bool EffectAmplify::IsPointwise()
+{
+   return true;
+}
+
+void EffectAmplify::ProcessPointwise(
+   float *buffer, size_t count, sampleCount WXUNUSED(pos))
+{
+   ScaleSamples(buffer, count, mRatio);
+}
+
 bool EffectAmplify::Init()
 {
    mPeak = 0.0;
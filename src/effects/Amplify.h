@@ -58,6 +58,9 @@ public:
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
+   bool IsPointwise() override;
+   void ProcessPointwise(float *buffer, size_t count, sampleCount pos) override;
 
 private:
    // EffectAmplify implementation
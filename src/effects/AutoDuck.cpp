@@ -20,6 +20,7 @@
 #include "AutoDuck.h"
 #include "LoadEffects.h"
 
+#include <algorithm>
 #include <math.h>
 #include <float.h>
 
@@ -319,10 +320,54 @@ bool EffectAutoDuck::Process()
       while (pos < end)
       {
          const auto len = limitSampleBufferSize( kBufSize, end - pos );
-         
-         mControlTrack->Get((samplePtr)buf.get(), floatSample, pos, len);
 
-         for (auto i = pos; i < pos + len; i++)
+         // If the block summaries show the control signal so quiet that the
+         // window sum can't exceed the threshold anywhere in this buffer,
+         // don't read it, except for the samples left in the window
+         bool quiet = false;
+         if (len >= kRMSWindowSize)
+         {
+            const auto minMax = mControlTrack->GetSampleMinMax(pos, len);
+            const double peak = std::max(-minMax.first, minMax.second);
+            quiet = rmsSum + peak * peak * kRMSWindowSize < threshold;
+         }
+
+         if (quiet)
+         {
+            if (inDuckRegion)
+            {
+               if (curSamplesPause + len >= minSamplesPause)
+               {
+                  // the maximum pause is exceeded at this sample
+                  auto i = pos + (minSamplesPause - curSamplesPause) - 1;
+                  curSamplesPause = minSamplesPause;
+                  double duckRegionEnd =
+                     mControlTrack->LongSamplesToTime(i - curSamplesPause);
+
+                  regions.push_back(AutoDuckRegion(
+                     duckRegionStart - mOuterFadeDownLen,
+                     duckRegionEnd + mOuterFadeUpLen));
+
+                  inDuckRegion = false;
+               }
+               else
+                  curSamplesPause += len;
+            }
+
+            mControlTrack->Get((samplePtr)buf.get(), floatSample,
+               pos + len - kRMSWindowSize, kRMSWindowSize);
+            rmsSum = 0;
+            for (size_t i = 0; i < kRMSWindowSize; i++)
+            {
+               rmsWindow[i] = buf[i] * buf[i];
+               rmsSum += rmsWindow[i];
+            }
+            rmsPos = 0;
+         }
+         else
+            mControlTrack->Get((samplePtr)buf.get(), floatSample, pos, len);
+
+         for (auto i = pos; !quiet && i < pos + len; i++)
          {
             rmsSum -= rmsWindow[rmsPos];
             // i - pos is bounded by len:
@@ -221,6 +221,11 @@ bool EffectBassTreble::CheckWhetherSkipEffect()
 
 // Effect implementation
 
+std::unique_ptr<Effect> EffectBassTreble::MakeParallelProcessor()
+{
+   return std::make_unique<EffectBassTreble>();
+}
+
 void EffectBassTreble::PopulateOrExchange(ShuttleGui & S)
 {
    S.SetBorder(5);
@@ -324,29 +329,8 @@ void EffectBassTreble::InstanceInit(EffectBassTrebleState & data, float sampleRa
    data.hzBass = 250.0f;   // could be tunable in a more advanced version
    data.hzTreble = 4000.0f;   // could be tunable in a more advanced version
 
-   data.a0Bass = 1;
-   data.a1Bass = 0;
-   data.a2Bass = 0;
-   data.b0Bass = 0;
-   data.b1Bass = 0;
-   data.b2Bass = 0;
-
-   data.a0Treble = 1;
-   data.a1Treble = 0;
-   data.a2Treble = 0;
-   data.b0Treble = 0;
-   data.b1Treble = 0;
-   data.b2Treble = 0;
-
-   data.xn1Bass = 0;
-   data.xn2Bass = 0;
-   data.yn1Bass = 0;
-   data.yn2Bass = 0;
-
-   data.xn1Treble = 0;
-   data.xn2Treble = 0;
-   data.yn1Treble = 0;
-   data.yn2Treble = 0;
+   data.filters[0] = Biquad{};
+   data.filters[1] = Biquad{};
 
    data.bass = -1;
    data.treble = -1;
@@ -375,17 +359,17 @@ size_t EffectBassTreble::InstanceProcess(EffectBassTrebleState & data,
    // Compute coefficents of the low shelf biquand IIR filter
    if (data.bass != oldBass)
       Coefficents(data.hzBass, data.slope, mBass, data.samplerate, kBass,
-                  data.a0Bass, data.a1Bass, data.a2Bass,
-                  data.b0Bass, data.b1Bass, data.b2Bass);
+                  data.filters[0]);
 
    // Compute coefficents of the high shelf biquand IIR filter
    if (data.treble != oldTreble)
       Coefficents(data.hzTreble, data.slope, mTreble, data.samplerate, kTreble,
-                  data.a0Treble, data.a1Treble, data.a2Treble,
-                  data.b0Treble, data.b1Treble, data.b2Treble);
+                  data.filters[1]);
 
+   // Both shelves in one pass over the samples
+   Biquad::ProcessCascade(data.filters, 2, ibuf, obuf, blockLen);
    for (decltype(blockLen) i = 0; i < blockLen; i++) {
-      obuf[i] = DoFilter(data, ibuf[i]) * data.gain;
+      obuf[i] *= data.gain;
    }
 
    return blockLen;
@@ -397,9 +381,12 @@ size_t EffectBassTreble::InstanceProcess(EffectBassTrebleState & data,
 
 
 void EffectBassTreble::Coefficents(double hz, double slope, double gain, double samplerate, int type,
-                                   double& a0, double& a1, double& a2,
-                                   double& b0, double& b1, double& b2)
+                                   Biquad &filter)
 {
+   // The filter keeps its state, so that the sound goes on smoothly as the
+   // sliders move
+   double a0, a1, a2, b0, b1, b2;
+
    double w = 2 * M_PI * hz / samplerate;
    double a = exp(log(10.0) * gain / 40);
    double b = sqrt((a * a + 1) / slope - (pow((a - 1), 2)));
@@ -422,31 +409,14 @@ void EffectBassTreble::Coefficents(double hz, double slope, double gain, double
       a1 = 2 * ((a - 1) - (a + 1) * cos(w));
       a2 = (a + 1) - (a - 1) * cos(w) - b * sin(w);
    }
-}
 
-float EffectBassTreble::DoFilter(EffectBassTrebleState & data, float in)
-{
-   // Bass filter
-   float out = (data.b0Bass * in + data.b1Bass * data.xn1Bass + data.b2Bass * data.xn2Bass -
-         data.a1Bass * data.yn1Bass - data.a2Bass * data.yn2Bass) / data.a0Bass;
-   data.xn2Bass = data.xn1Bass;
-   data.xn1Bass = in;
-   data.yn2Bass = data.yn1Bass;
-   data.yn1Bass = out;
-
-   // Treble filter
-   in = out;
-   out = (data.b0Treble * in + data.b1Treble * data.xn1Treble + data.b2Treble * data.xn2Treble -
-         data.a1Treble * data.yn1Treble - data.a2Treble * data.yn2Treble) / data.a0Treble;
-   data.xn2Treble = data.xn1Treble;
-   data.xn1Treble = in;
-   data.yn2Treble = data.yn1Treble;
-   data.yn1Treble = out;
-
-   return out;
+   filter.fNumerCoeffs[Biquad::B0] = b0 / a0;
+   filter.fNumerCoeffs[Biquad::B1] = b1 / a0;
+   filter.fNumerCoeffs[Biquad::B2] = b2 / a0;
+   filter.fDenomCoeffs[Biquad::A1] = a1 / a0;
+   filter.fDenomCoeffs[Biquad::A2] = a2 / a0;
 }
 
-
 void EffectBassTreble::OnBassText(wxCommandEvent & WXUNUSED(evt))
 {
    double oldBass = mBass;
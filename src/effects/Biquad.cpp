@@ -11,11 +11,39 @@ Max Maisel
 
 #include "Biquad.h"
 #include "Audacity.h"
+#include <algorithm>
 #include <cmath>
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON, with double precision lanes.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_BIQUAD
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_BIQUAD
+#include <arm_neon.h>
+#endif
+
 #define square(a) ((a)*(a))
 #define PI M_PI
 
+namespace {
+   // Cascades longer than this are filtered in several passes
+   const size_t MaxFusedSections = (Biquad::MAX_Order + 1) / 2;
+
+   // Far below the quietest float sample, but far above the subnormal
+   // doubles, which are many times slower on some processors
+   const double DenormalThreshold = 1e-30;
+
+   void FlushDenormals(Biquad &section)
+   {
+      for (auto &state : section.fState)
+         if (std::fabs(state) < DenormalThreshold)
+            state = 0;
+   }
+}
+
 Biquad::Biquad()
 {
    fNumerCoeffs[B0] = 1;
@@ -28,16 +56,151 @@ Biquad::Biquad()
 
 void Biquad::Reset()
 {
-   fPrevIn = 0;
-   fPrevPrevIn = 0;
-   fPrevOut = 0;
-   fPrevPrevOut = 0;
+   fState[0] = 0;
+   fState[1] = 0;
 }
 
-void Biquad::Process(float* pfIn, float* pfOut, int iNumSamples)
+void Biquad::Process(const float* pfIn, float* pfOut, int iNumSamples)
 {
-   for (int i = 0; i < iNumSamples; i++)
-      *pfOut++ = ProcessOne(*pfIn++);
+   ProcessCascade(this, 1, pfIn, pfOut, std::max(0, iNumSamples));
+}
+
+void Biquad::ProcessCascade(Biquad *pSections, size_t nSections,
+   const float *pfIn, float *pfOut, size_t len)
+{
+   if (nSections == 0) {
+      if (pfOut != pfIn)
+         std::copy(pfIn, pfIn + len, pfOut);
+      return;
+   }
+
+   for (size_t first = 0; first < nSections; first += MaxFusedSections) {
+      const auto count = std::min(MaxFusedSections, nSections - first);
+
+      // Local copies, which the compiler may keep in registers, since the
+      // buffers cannot alias them
+      double b0[MaxFusedSections], b1[MaxFusedSections], b2[MaxFusedSections],
+         a1[MaxFusedSections], a2[MaxFusedSections],
+         s1[MaxFusedSections], s2[MaxFusedSections];
+      for (size_t ii = 0; ii < count; ++ii) {
+         const auto &section = pSections[first + ii];
+         b0[ii] = section.fNumerCoeffs[B0];
+         b1[ii] = section.fNumerCoeffs[B1];
+         b2[ii] = section.fNumerCoeffs[B2];
+         a1[ii] = section.fDenomCoeffs[A1];
+         a2[ii] = section.fDenomCoeffs[A2];
+         s1[ii] = section.fState[0];
+         s2[ii] = section.fState[1];
+      }
+
+      for (size_t i = 0; i < len; ++i) {
+         double value = pfIn[i];
+         for (size_t ii = 0; ii < count; ++ii) {
+            const double out = value * b0[ii] + s1[ii];
+            s1[ii] = value * b1[ii] - out * a1[ii] + s2[ii];
+            s2[ii] = value * b2[ii] - out * a2[ii];
+            value = out;
+         }
+         pfOut[i] = value;
+      }
+
+      for (size_t ii = 0; ii < count; ++ii) {
+         auto &section = pSections[first + ii];
+         section.fState[0] = s1[ii];
+         section.fState[1] = s2[ii];
+         FlushDenormals(section);
+      }
+
+      // Later passes filter the output of this one
+      pfIn = pfOut;
+   }
+}
+
+void Biquad::ProcessCascades(Biquad *const *ppSections, size_t nSections,
+   size_t nChannels,
+   const float *const *ppfIn, float *const *ppfOut, size_t len)
+{
+   size_t channel = 0;
+
+#if defined(USE_SSE2_BIQUAD) || defined(USE_NEON_BIQUAD)
+   // Filter two channels at once, one in each double precision lane, with
+   // the operations of ProcessCascade(), so the results are the same too
+#if defined(USE_SSE2_BIQUAD)
+   using Vec = __m128d;
+   auto Pair = [](double l, double r){ return _mm_set_pd(r, l); };
+   auto Mul = [](Vec a, Vec b){ return _mm_mul_pd(a, b); };
+   auto Add = [](Vec a, Vec b){ return _mm_add_pd(a, b); };
+   auto Sub = [](Vec a, Vec b){ return _mm_sub_pd(a, b); };
+   auto Low = [](Vec a){ return _mm_cvtsd_f64(a); };
+   auto High = [](Vec a){ return _mm_cvtsd_f64(_mm_unpackhi_pd(a, a)); };
+#else
+   using Vec = float64x2_t;
+   auto Pair = [](double l, double r){
+      return vsetq_lane_f64(r, vdupq_n_f64(l), 1); };
+   auto Mul = [](Vec a, Vec b){ return vmulq_f64(a, b); };
+   auto Add = [](Vec a, Vec b){ return vaddq_f64(a, b); };
+   auto Sub = [](Vec a, Vec b){ return vsubq_f64(a, b); };
+   auto Low = [](Vec a){ return vgetq_lane_f64(a, 0); };
+   auto High = [](Vec a){ return vgetq_lane_f64(a, 1); };
+#endif
+
+   for (; nSections > 0 && channel + 1 < nChannels; channel += 2) {
+      Biquad *const pLeft = ppSections[channel];
+      Biquad *const pRight = ppSections[channel + 1];
+      const float *pInLeft = ppfIn[channel], *pInRight = ppfIn[channel + 1];
+      float *const pOutLeft = ppfOut[channel];
+      float *const pOutRight = ppfOut[channel + 1];
+
+      for (size_t first = 0; first < nSections; first += MaxFusedSections) {
+         const auto count = std::min(MaxFusedSections, nSections - first);
+
+         Vec b0[MaxFusedSections], b1[MaxFusedSections], b2[MaxFusedSections],
+            a1[MaxFusedSections], a2[MaxFusedSections],
+            s1[MaxFusedSections], s2[MaxFusedSections];
+         for (size_t ii = 0; ii < count; ++ii) {
+            const Biquad &left = pLeft[first + ii];
+            const Biquad &right = pRight[first + ii];
+            b0[ii] = Pair(left.fNumerCoeffs[B0], right.fNumerCoeffs[B0]);
+            b1[ii] = Pair(left.fNumerCoeffs[B1], right.fNumerCoeffs[B1]);
+            b2[ii] = Pair(left.fNumerCoeffs[B2], right.fNumerCoeffs[B2]);
+            a1[ii] = Pair(left.fDenomCoeffs[A1], right.fDenomCoeffs[A1]);
+            a2[ii] = Pair(left.fDenomCoeffs[A2], right.fDenomCoeffs[A2]);
+            s1[ii] = Pair(left.fState[0], right.fState[0]);
+            s2[ii] = Pair(left.fState[1], right.fState[1]);
+         }
+
+         for (size_t i = 0; i < len; ++i) {
+            Vec value = Pair(pInLeft[i], pInRight[i]);
+            for (size_t ii = 0; ii < count; ++ii) {
+               const Vec out = Add(Mul(value, b0[ii]), s1[ii]);
+               s1[ii] = Add(Sub(Mul(value, b1[ii]), Mul(out, a1[ii])), s2[ii]);
+               s2[ii] = Sub(Mul(value, b2[ii]), Mul(out, a2[ii]));
+               value = out;
+            }
+            pOutLeft[i] = Low(value);
+            pOutRight[i] = High(value);
+         }
+
+         for (size_t ii = 0; ii < count; ++ii) {
+            Biquad &left = pLeft[first + ii];
+            Biquad &right = pRight[first + ii];
+            left.fState[0] = Low(s1[ii]);
+            right.fState[0] = High(s1[ii]);
+            left.fState[1] = Low(s2[ii]);
+            right.fState[1] = High(s2[ii]);
+            FlushDenormals(left);
+            FlushDenormals(right);
+         }
+
+         pInLeft = pOutLeft;
+         pInRight = pOutRight;
+      }
+   }
+#endif
+
+   for (; channel < nChannels; ++channel)
+      ProcessCascade(ppSections[channel], nSections,
+         ppfIn[channel], ppfOut[channel], len);
 }
 
 const double Biquad::s_fChebyCoeffs[MAX_Order][MAX_Order + 1] =
@@ -14,12 +14,27 @@ Max Maisel
 
 #include "MemoryX.h"
 
-/// \brief Represents a biquad digital filter.
+/// \brief Represents a biquad digital filter, in transposed direct form II.
 struct Biquad
 {
    Biquad();
    void Reset();
-   void Process(float* pfIn, float* pfOut, int iNumSamples);
+   void Process(const float* pfIn, float* pfOut, int iNumSamples);
+
+   /// Filter len samples through a cascade of nSections sections, in one
+   /// pass, without rounding between the sections.  pfIn and pfOut may be
+   /// the same.  States too small to hear are flushed to zero at the end,
+   /// so that silence after sound does not go on in slow subnormal
+   /// arithmetic.
+   static void ProcessCascade(Biquad *pSections, size_t nSections,
+      const float *pfIn, float *pfOut, size_t len);
+
+   /// The same for nChannels channels, each with its own cascade of
+   /// nSections sections, ppSections[channel]; pairs of channels are
+   /// filtered together in the lanes of SIMD registers where available
+   static void ProcessCascades(Biquad *const *ppSections, size_t nSections,
+      size_t nChannels,
+      const float *const *ppfIn, float *const *ppfOut, size_t len);
 
    enum
    {
@@ -33,28 +48,21 @@ struct Biquad
       MAX_Order = 10
    };
 
-   inline float ProcessOne(float fIn)
+   inline double ProcessOne(double fIn)
    {
       // Biquad must use double for all calculations. Otherwise some
       // filters may have catastrophic rounding errors!
-      double fOut = double(fIn) * fNumerCoeffs[B0] +
-            fPrevIn * fNumerCoeffs[B1] +
-            fPrevPrevIn * fNumerCoeffs[B2] -
-            fPrevOut * fDenomCoeffs[A1] -
-            fPrevPrevOut * fDenomCoeffs[A2];
-      fPrevPrevIn = fPrevIn;
-      fPrevIn = fIn;
-      fPrevPrevOut = fPrevOut;
-      fPrevOut = fOut;
+      const double fOut = fIn * fNumerCoeffs[B0] + fState[0];
+      fState[0] = fIn * fNumerCoeffs[B1] - fOut * fDenomCoeffs[A1] +
+         fState[1];
+      fState[1] = fIn * fNumerCoeffs[B2] - fOut * fDenomCoeffs[A2];
       return fOut;
    }
 
    double fNumerCoeffs[3]; // B0 B1 B2
    double fDenomCoeffs[2]; // A1 A2, A0 == 1.0
-   double fPrevIn;
-   double fPrevPrevIn;
-   double fPrevOut;
-   double fPrevPrevOut;
+   /// The two delays of the transposed direct form
+   double fState[2];
 
    enum kSubTypes
    {
@@ -29,9 +29,14 @@
 #include "LoadEffects.h"
 
 #include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 #include <wx/intl.h>
 #include <wx/slider.h>
+#include <wx/utils.h>
 #include <wx/valgen.h>
 
 #include "../Prefs.h"
@@ -177,30 +182,36 @@ bool EffectClickRemoval::Startup()
 bool EffectClickRemoval::Process()
 {
    this->CopyInputTracks(); // Set up mOutputTracks.
-   bool bGoodResult = true;
    mbDidSomething = false;
 
-   int count = 0;
+   std::vector<Job> jobs;
    for( auto track : mOutputTracks->Selected< WaveTrack >() ) {
       double trackStart = track->GetStartTime();
       double trackEnd = track->GetEndTime();
       double t0 = mT0 < trackStart? trackStart: mT0;
       double t1 = mT1 > trackEnd? trackEnd: mT1;
 
+      Job job{ track, 0, 0 };
       if (t1 > t0) {
-         auto start = track->TimeToLongSamples(t0);
+         job.start = track->TimeToLongSamples(t0);
          auto end = track->TimeToLongSamples(t1);
-         auto len = end - start;
+         job.len = end - job.start;
 
-         if (!ProcessOne(count, track, start, len))
+         if (job.len <= windowSize / 2)
          {
-            bGoodResult = false;
-            break;
+            Effect::MessageBox(
+               XO("Selection must be larger than %d samples.")
+                  .Format(windowSize / 2),
+               wxOK | wxICON_ERROR );
+            this->ReplaceProcessedTracks(false);
+            return false;
          }
       }
-
-      count++;
+      // Tracks outside the selection still count toward progress
+      jobs.push_back(job);
    }
+
+   bool bGoodResult = ProcessJobs(jobs);
    if (bGoodResult && !mbDidSomething) // Processing successful, but ineffective.
       Effect::MessageBox(
          XO("Algorithm not effective on this audio. Nothing changed."),
@@ -210,16 +221,95 @@ bool EffectClickRemoval::Process()
    return bGoodResult && mbDidSomething;
 }
 
-bool EffectClickRemoval::ProcessOne(int count, WaveTrack * track, sampleCount start, sampleCount len)
+bool EffectClickRemoval::ProcessJobs(const std::vector<Job> &jobs)
 {
-   if (len <= windowSize / 2)
+   const auto nJobs = jobs.size();
+   const auto nThreads =
+      std::min<size_t>(nJobs, std::thread::hardware_concurrency());
+   if (nThreads <= 1) {
+      int count = 0;
+      for (const auto &job : jobs) {
+         bool didSomething = false;
+         bool result = ProcessOne(job, [&](double frac) {
+            return TrackProgress(count, frac); }, didSomething);
+         mbDidSomething |= didSomething;
+         if (!result)
+            return false;
+         count++;
+      }
+      return true;
+   }
+
+   // The windows of one track overlap, each seeing the clicks removed by the
+   // one before, so only the tracks are independent; the main thread sums
+   // their progress
+   std::vector< std::atomic<double> > fractions(nJobs);
+   std::vector< char > didSomething(nJobs, 0);
+   std::atomic<bool> stopped{ false };
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::vector<std::exception_ptr> errors(nThreads);
    {
-      Effect::MessageBox(
-         XO("Selection must be larger than %d samples.")
-            .Format(windowSize / 2),
-         wxOK | wxICON_ERROR );
-      return false;
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the tracks go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for (auto &thread : threads)
+            thread.join();
+      } );
+      for (size_t ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back( [&, ii]{
+            try {
+               for (size_t jj = 0;
+                    !stopped.load() && (jj = next++) < nJobs;) {
+                  auto &fraction = fractions[jj];
+                  bool did = false;
+                  bool result = ProcessOne(jobs[jj],
+                     [&](double frac) -> bool {
+                        fraction.store(frac);
+                        return stopped.load(); }, did);
+                  didSomething[jj] = did;
+                  if (!result) {
+                     stopped.store(true);
+                     break;
+                  }
+                  ++nDone;
+               }
+            }
+            catch (...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      while (nDone.load() < nJobs && !stopped.load()) {
+         double sum = 0;
+         for (const auto &fraction : fractions)
+            sum += fraction.load();
+         if (TotalProgress(sum / nJobs))
+            stopped.store(true);
+         else
+            ::wxMilliSleep(10);
+      }
    }
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+   for (auto did : didSomething)
+      mbDidSomething |= (did != 0);
+   return nDone.load() == nJobs;
+}
+
+// Safe to call from a worker thread:  it touches only the job's track and
+// reports through progress
+bool EffectClickRemoval::ProcessOne(const Job &job,
+   const Progress &progress, bool &didSomething)
+{
+   const auto track = job.track;
+   const auto start = job.start;
+   const auto len = job.len;
+   if (len == 0)
+      return !progress(1.0);
 
    auto idealBlockLen = track->GetMaxBlockSize() * 4;
    if (idealBlockLen % windowSize != 0)
@@ -244,19 +334,18 @@ bool EffectClickRemoval::ProcessOne(int count, WaveTrack * track, sampleCount st
          for(auto j = wcopy; j < windowSize; j++)
             datawindow[j] = 0;
 
-         mbDidSomething |= RemoveClicks(windowSize, datawindow.get());
+         didSomething |= RemoveClicks(windowSize, datawindow.get());
 
          for(decltype(wcopy) j = 0; j < wcopy; j++)
            buffer[i+j] = datawindow[j];
       }
 
-      if (mbDidSomething) // RemoveClicks() actually did something.
+      if (didSomething) // RemoveClicks() actually did something.
          track->Set((samplePtr) buffer.get(), floatSample, start + s, block);
 
       s += block;
 
-      if (TrackProgress(count, s.as_double() /
-                               len.as_double())) {
+      if (progress(s.as_double() / len.as_double())) {
          bResult = false;
          break;
       }
@@ -265,39 +354,47 @@ bool EffectClickRemoval::ProcessOne(int count, WaveTrack * track, sampleCount st
    return bResult;
 }
 
-bool EffectClickRemoval::RemoveClicks(size_t len, float *buffer)
+bool EffectClickRemoval::RemoveClicks(size_t len, float *buffer) const
 {
    bool bResult = false; // This effect usually does nothing.
    size_t i;
    size_t j;
    int left = 0;
 
-   float msw;
    int ww;
-   int s2 = sep/2;
-   Floats ms_seq{ len };
-   Floats b2{ len };
 
+   /* Cheat by rounding sep up to a power of two... */
+   size_t span = 1;
+   while ((int)span < sep)
+      span *= 2;
+   int s2 = span/2;
+
+   if (len <= span)
+      return false;
+
+   Floats b2{ len };
    for( i=0; i<len; i++)
       b2[i] = buffer[i]*buffer[i];
 
-   /* Shortcut for rms - multiple passes through b2, accumulating
-    * as we go.
+   /* The mean square over span samples from each position, from prefix
+    * sums, instead of repeated passes through b2.  Double precision keeps
+    * the differences of large sums exact enough.
     */
-   for(i=0;i<len;i++)
-      ms_seq[i]=b2[i];
-
-   for(i=1; (int)i < sep; i *= 2) {
-      for(j=0;j<len-i; j++)
-         ms_seq[j] += ms_seq[j+i];
-   }
+   ArrayOf<double> prefix{ len + 1 };
+   prefix[0] = 0;
+   for( i=0; i<len; i++)
+      prefix[i+1] = prefix[i] + b2[i];
 
-   /* Cheat by truncating sep to next-lower power of two... */
-   sep = i;
+   /* The comparison of each window against the level around it needs only
+    * this much of the mean square; the loop is free of dependencies, so the
+    * compiler vectorizes it
+    */
+   const auto count = len - span;
+   Floats threshold{ count };
+   const double scale = mThresholdLevel / (10.0 * span);
+   for( i=0; i<count; i++ )
+      threshold[i] = (prefix[i+span] - prefix[i]) * scale;
 
-   for( i=0; i<len-sep; i++ ) {
-      ms_seq[i] /= sep;
-   }
    /* ww runs from about 4 to mClickWidth.  wrc is the reciprocal;
     * chosen so that integer roundoff doesn't clobber us.
     */
@@ -305,14 +402,21 @@ bool EffectClickRemoval::RemoveClicks(size_t len, float *buffer)
    for(wrc=mClickWidth/4; wrc>=1; wrc /= 2) {
       ww = mClickWidth/wrc;
 
-      for( i=0; i<len-sep; i++ ){
-         msw = 0;
-         for( j=0; (int)j<ww; j++) {
-            msw += b2[i+s2+j];
-         }
-         msw /= ww;
-
-         if(msw >= mThresholdLevel * ms_seq[i]/10) {
+      // A sliding sum of b2[i+s2 .. i+s2+ww), updated as i advances, and
+      // computed again where interpolation changes b2
+      auto windowSum = [&](size_t from) {
+         double sum = 0;
+         for( auto k = from; k < from + ww; k++ )
+            sum += b2[k];
+         return sum;
+      };
+      double sum = windowSum(s2);
+
+      for( i=0; i<count; i++ ){
+         if (i > 0)
+            sum += b2[i+s2+ww-1] - b2[i+s2-1];
+
+         if(sum >= ww * threshold[i]) {
             if( left == 0 ) {
                left = i+s2;
             }
@@ -326,6 +430,7 @@ bool EffectClickRemoval::RemoveClicks(size_t len, float *buffer)
                   b2[j] = buffer[j]*buffer[j];
                }
                left=0;
+               sum = windowSum(i+s2);
             } else if(left != 0) {
                left = 0;
             }
@@ -57,10 +57,20 @@ public:
    bool TransferDataFromWindow() override;
 
 private:
-   bool ProcessOne(int count, WaveTrack * track,
-                   sampleCount start, sampleCount len);
+   struct Job {
+      WaveTrack *track;
+      sampleCount start;
+      sampleCount len;
+   };
 
-   bool RemoveClicks(size_t len, float *buffer);
+   // Returns true to stop
+   using Progress = std::function< bool(double frac) >;
+
+   bool ProcessJobs(const std::vector<Job> &jobs);
+   bool ProcessOne(const Job &job, const Progress &progress,
+                   bool &didSomething);
+
+   bool RemoveClicks(size_t len, float *buffer) const;
 
    void OnWidthText(wxCommandEvent & evt);
    void OnThreshText(wxCommandEvent & evt);
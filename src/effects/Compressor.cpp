@@ -28,6 +28,7 @@
 #include "Compressor.h"
 #include "LoadEffects.h"
 
+#include <algorithm>
 #include <math.h>
 
 #include <wx/brush.h>
@@ -48,6 +49,17 @@
 #include "../WaveTrack.h"
 #include "../AllThemeResources.h"
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_COMPRESSOR
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_COMPRESSOR
+#include <arm_neon.h>
+#endif
+
 enum
 {
    ID_Threshold = 10000,
@@ -420,10 +432,12 @@ bool EffectCompressor::InitPass1()
    );
    mFollow1.reset();
    mFollow2.reset();
+   mGains.reset();
    // Allocate buffers for the envelope
    if(maxlen > 0) {
       mFollow1.reinit(maxlen);
       mFollow2.reinit(maxlen);
+      mGains.reinit(maxlen);
    }
    mFollowLen = maxlen;
 
@@ -466,9 +480,7 @@ bool EffectCompressor::TwoBufferProcessPass1
    }
 
    if(buffer1 != NULL) {
-      for (size_t i = 0; i < len1; i++) {
-         buffer1[i] = DoCompression(buffer1[i], mFollow1[i]);
-      }
+      Compress(buffer1, mFollow1.get(), len1);
    }
 
 
@@ -503,19 +515,40 @@ void EffectCompressor::FreshenCircle()
       mRMSSum += mCircle[i];
 }
 
-float EffectCompressor::AvgCircle(float value)
+void EffectCompressor::DetectLevels(
+   const float *buffer, float *levels, size_t len)
 {
-   float level;
-
-   // Calculate current level from root-mean-squared of
-   // circular buffer ("RMS")
-   mRMSSum -= mCircle[mCirclePos];
-   mCircle[mCirclePos] = value*value;
-   mRMSSum += mCircle[mCirclePos];
-   level = sqrt(mRMSSum/mCircleSize);
-   mCirclePos = (mCirclePos+1)%mCircleSize;
-
-   return level;
+   // Magnitudes, or squares for the RMS, a few samples at a time
+   size_t i = 0;
+#if defined(USE_SSE2_COMPRESSOR)
+   const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+   for (; i + 4 <= len; i += 4) {
+      const __m128 x = _mm_loadu_ps(buffer + i);
+      _mm_storeu_ps(levels + i,
+         mUsePeak ? _mm_and_ps(x, absMask) : _mm_mul_ps(x, x));
+   }
+#elif defined(USE_NEON_COMPRESSOR)
+   for (; i + 4 <= len; i += 4) {
+      const float32x4_t x = vld1q_f32(buffer + i);
+      vst1q_f32(levels + i, mUsePeak ? vabsq_f32(x) : vmulq_f32(x, x));
+   }
+#endif
+   for (; i < len; i++)
+      levels[i] = mUsePeak ? fabs(buffer[i]) : buffer[i] * buffer[i];
+
+   if (mUsePeak)
+      return;
+
+   // Calculate the level from the root-mean-square of the latest
+   // mCircleSize squares, kept in the circular buffer
+   for (i = 0; i < len; i++) {
+      mRMSSum -= mCircle[mCirclePos];
+      mCircle[mCirclePos] = levels[i];
+      mRMSSum += mCircle[mCirclePos];
+      levels[i] = sqrt(mRMSSum/mCircleSize);
+      if (++mCirclePos == mCircleSize)
+         mCirclePos = 0;
+   }
 }
 
 void EffectCompressor::Follow(float *buffer, float *env, size_t len, float *previous, size_t previous_len)
@@ -561,13 +594,13 @@ void EffectCompressor::Follow(float *buffer, float *env, size_t len, float *prev
       // to avoid accumulation of rounding errors
       FreshenCircle();
    }
+   // Find the levels of the whole buffer first, leaving them in env
+   DetectLevels(buffer, env, len);
+
    // First apply a peak detect with the requested decay rate
    last = mLastLevel;
    for(size_t i=0; i<len; i++) {
-      if(mUsePeak)
-         level = fabs(buffer[i]);
-      else // use RMS
-         level = AvgCircle(buffer[i]);
+      level = env[i];
       // Don't increase gain when signal is continuously below the noise floor
       if(level < mNoiseFloor) {
          mNoiseCounter++;
@@ -631,22 +664,66 @@ void EffectCompressor::Follow(float *buffer, float *env, size_t len, float *prev
    }
 }
 
-float EffectCompressor::DoCompression(float value, double env)
+void EffectCompressor::Compress(float *buffer, const float *env, size_t len)
 {
-   float out;
-   if(mUsePeak) {
-      // Peak values map 1.0 to 1.0 - 'upward' compression
-      out = value * pow(1.0/env, mCompression);
-   } else {
-      // With RMS-based compression don't change values below mThreshold - 'downward' compression
-      out = value * pow(mThreshold/env, mCompression);
+   // Peak values map 1.0 to 1.0 - 'upward' compression
+   // With RMS-based compression don't change values below mThreshold -
+   // 'downward' compression
+   const double reference = mUsePeak ? 1.0 : mThreshold;
+
+   // The envelope holds steady for long stretches, as at the threshold, so
+   // compute the gain again only where it changes
+   double *gains = mGains.get();
+   for (size_t i = 0; i < len; i++) {
+      if (i > 0 && env[i] == env[i - 1])
+         gains[i] = gains[i - 1];
+      else
+         gains[i] = pow(reference / env[i], mCompression);
    }
 
-   // Retain the maximum value for use in the normalization pass
-   if(mMax < fabs(out))
-      mMax = fabs(out);
+   // Apply the gains, and retain the maximum value for use in the
+   // normalization pass
+   float max = 0;
+   size_t i = 0;
+#if defined(USE_SSE2_COMPRESSOR)
+   const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+   __m128 max4 = _mm_setzero_ps();
+   for (; i + 4 <= len; i += 4) {
+      const __m128 x = _mm_loadu_ps(buffer + i);
+      const __m128d lo =
+         _mm_mul_pd(_mm_cvtps_pd(x), _mm_loadu_pd(gains + i));
+      const __m128d hi = _mm_mul_pd(
+         _mm_cvtps_pd(_mm_movehl_ps(x, x)), _mm_loadu_pd(gains + i + 2));
+      const __m128 out =
+         _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+      _mm_storeu_ps(buffer + i, out);
+      max4 = _mm_max_ps(max4, _mm_and_ps(out, absMask));
+   }
+   float maxes[4];
+   _mm_storeu_ps(maxes, max4);
+   max = std::max(std::max(maxes[0], maxes[1]), std::max(maxes[2], maxes[3]));
+#elif defined(USE_NEON_COMPRESSOR)
+   float32x4_t max4 = vdupq_n_f32(0);
+   for (; i + 4 <= len; i += 4) {
+      const float32x4_t x = vld1q_f32(buffer + i);
+      const float64x2_t lo =
+         vmulq_f64(vcvt_f64_f32(vget_low_f32(x)), vld1q_f64(gains + i));
+      const float64x2_t hi =
+         vmulq_f64(vcvt_high_f64_f32(x), vld1q_f64(gains + i + 2));
+      const float32x4_t out = vcvt_high_f32_f64(vcvt_f32_f64(lo), hi);
+      vst1q_f32(buffer + i, out);
+      max4 = vmaxq_f32(max4, vabsq_f32(out));
+   }
+   max = vmaxvq_f32(max4);
+#endif
+   for (; i < len; i++) {
+      const float out = buffer[i] * gains[i];
+      buffer[i] = out;
+      max = std::max(max, fabsf(out));
+   }
 
-   return out;
+   if(mMax < max)
+      mMax = max;
 }
 
 void EffectCompressor::OnSlider(wxCommandEvent & WXUNUSED(evt))
@@ -64,9 +64,9 @@ private:
    // EffectCompressor implementation
 
    void FreshenCircle();
-   float AvgCircle(float x);
+   void DetectLevels(const float *buffer, float *levels, size_t len);
    void Follow(float *buffer, float *env, size_t len, float *previous, size_t previous_len);
-   float DoCompression(float x, double env);
+   void Compress(float *buffer, const float *env, size_t len);
 
    void OnSlider(wxCommandEvent & evt);
    void UpdateUI();
@@ -95,6 +95,7 @@ private:
    double    mGain;
    double    mLastLevel;
    Floats mFollow1, mFollow2;
+   Doubles   mGains;
    size_t    mFollowLen;
 
    double    mMax;			//MJS
@@ -359,6 +359,11 @@ bool EffectDistortion::LoadFactoryPreset(int id)
 
 // Effect implementation
 
+std::unique_ptr<Effect> EffectDistortion::MakeParallelProcessor()
+{
+   return std::make_unique<EffectDistortion>();
+}
+
 void EffectDistortion::PopulateOrExchange(ShuttleGui & S)
 {
    S.AddSpace(0, 5);
@@ -542,9 +547,12 @@ void EffectDistortion::InstanceInit(EffectDistortionState & data, float sampleRa
    // DC block filter variables
    data.queuetotal = 0.0;
 
-   //std::queue<float>().swap(data.queuesamples);
-   while (!data.queuesamples.empty())
-      data.queuesamples.pop();
+   // Rolling average gives less offset at the start than an IIR filter.
+   const auto queueLength =
+      static_cast<size_t>(std::max(1.0, std::floor(sampleRate / 20.0)));
+   data.queuesamples.assign(queueLength, 0.0f);
+   data.queuestart = 0;
+   data.queuecount = 0;
 
    MakeTable();
 
@@ -572,55 +580,63 @@ size_t EffectDistortion::InstanceProcess(EffectDistortionState& data, float** in
    data.param1 = mParams.mParam1;
    data.repeats = mParams.mRepeats;
 
-   for (decltype(blockLen) i = 0; i < blockLen; i++) {
-      if (update && ((data.skipcount++) % skipsamples == 0)) {
-         MakeTable();
+   for (size_t i = 0; i < blockLen;) {
+      auto len = blockLen - i;
+      if (update) {
+         // While parameters change, remake the table every skipsamples
+         const auto phase =
+            static_cast<size_t>(data.skipcount.as_long_long() % skipsamples);
+         if (phase == 0)
+            MakeTable();
+         len = std::min<size_t>(len, skipsamples - phase);
+         data.skipcount += len;
       }
 
+      // Choose the pre-gain and the mix for the type once for the run;
+      // after MakeTable, which may change the make-up gain
+      bool preGain = false, mix = false;
+      double amount = 1.0, gain = 1.0, dry = 0.0;
       switch (mParams.mTableChoiceIndx)
       {
       case kHardClip:
+         // Pre-gain
+         preGain = true;
+         amount = 1 + p1;
          // Param2 = make-up gain.
-         obuf[i] = WaveShaper(ibuf[i]) * ((1 - p2) + (mMakeupGain * p2));
+         gain = (1 - p2) + (mMakeupGain * p2);
          break;
       case kSoftClip:
          // Param2 = make-up gain.
-         obuf[i] = WaveShaper(ibuf[i]) * ((1 - p2) + (mMakeupGain * p2));
+         gain = (1 - p2) + (mMakeupGain * p2);
          break;
       case kHalfSinCurve:
-         obuf[i] = WaveShaper(ibuf[i]) * p2;
-         break;
       case kExpCurve:
-         obuf[i] = WaveShaper(ibuf[i]) * p2;
-         break;
       case kLogCurve:
-         obuf[i] = WaveShaper(ibuf[i]) * p2;
-         break;
       case kCubic:
-         obuf[i] = WaveShaper(ibuf[i]) * p2;
-         break;
-      case kEvenHarmonics:
-         obuf[i] = WaveShaper(ibuf[i]);
-         break;
       case kSinCurve:
-         obuf[i] = WaveShaper(ibuf[i]) * p2;
-         break;
-      case kLeveller:
-         obuf[i] = WaveShaper(ibuf[i]);
-         break;
-      case kRectifier:
-         obuf[i] = WaveShaper(ibuf[i]);
+         gain = p2;
          break;
       case kHardLimiter:
          // Mix equivalent to LADSPA effect's "Wet / Residual" mix
-         obuf[i] = (WaveShaper(ibuf[i]) * (p1 - p2)) + (ibuf[i] * p2);
+         mix = true;
+         gain = p1 - p2;
+         dry = p2;
          break;
       default:
-         obuf[i] = WaveShaper(ibuf[i]);
-      }
-      if (mParams.mDCBlock) {
-         obuf[i] = DCFilter(data, obuf[i]);
+         break;
       }
+
+      if (mix)
+         WaveShaper<false, true>(ibuf + i, obuf + i, len, amount, gain, dry);
+      else if (preGain)
+         WaveShaper<true, false>(ibuf + i, obuf + i, len, amount, gain, dry);
+      else
+         WaveShaper<false, false>(ibuf + i, obuf + i, len, amount, gain, dry);
+
+      if (mParams.mDCBlock)
+         DCFilter(data, obuf + i, len);
+
+      i += len;
    }
 
    return blockLen;
@@ -1287,48 +1303,60 @@ void EffectDistortion::CopyHalfTable()
 }
 
 
-float EffectDistortion::WaveShaper(float sample)
+template<bool PreGain, bool Mix>
+void EffectDistortion::WaveShaper(const float *ibuf, float *obuf, size_t len,
+   double preGain, double gain, double dry) const
 {
-   float out;
-   int index;
-   double xOffset;
-   double amount = 1;
-
-   switch (mParams.mTableChoiceIndx)
-   {
-      // Do any pre-processing here
-      case kHardClip:
-         // Pre-gain
-         amount = mParams.mParam1 / 100.0;
-         sample *= 1+amount;
-         break;
-      default: break;
+   for (size_t i = 0; i < len; ++i) {
+      float sample = ibuf[i];
+      if (PreGain)
+         sample *= preGain;
+
+      int index = std::floor(sample * STEPS) + STEPS;
+      index = wxMax<int>(wxMin<int>(index, 2 * STEPS - 1), 0);
+      double xOffset = ((1 + sample) * STEPS) - index;
+      xOffset = wxMin<double>(wxMax<double>(xOffset, 0.0), 1.0);   // Clip at 0dB
+
+      // linear interpolation: y = y0 + (y1-y0)*(x-x0)
+      const float out =
+         mTable[index] + (mTable[index + 1] - mTable[index]) * xOffset;
+
+      if (Mix)
+         obuf[i] = (out * gain) + (ibuf[i] * dry);
+      else
+         obuf[i] = out * gain;
    }
-
-   index = std::floor(sample * STEPS) + STEPS;
-   index = wxMax<int>(wxMin<int>(index, 2 * STEPS - 1), 0);
-   xOffset = ((1 + sample) * STEPS) - index;
-   xOffset = wxMin<double>(wxMax<double>(xOffset, 0.0), 1.0);   // Clip at 0dB
-
-   // linear interpolation: y = y0 + (y1-y0)*(x-x0)
-   out = mTable[index] + (mTable[index + 1] - mTable[index]) * xOffset;
-
-   return out;
 }
 
 
-float EffectDistortion::DCFilter(EffectDistortionState& data, float sample)
+void EffectDistortion::DCFilter(
+   EffectDistortionState& data, float *buffer, size_t len)
 {
-   // Rolling average gives less offset at the start than an IIR filter.
-   const unsigned int queueLength = std::floor(data.samplerate / 20.0);
-
-   data.queuetotal += sample;
-   data.queuesamples.push(sample);
-
-   if (data.queuesamples.size() > queueLength) {
-      data.queuetotal -= data.queuesamples.front();
-      data.queuesamples.pop();
+   // Subtract the rolling average of the latest samples, kept in a ring
+   // buffer rather than a std::queue that allocates as it goes
+   auto &ring = data.queuesamples;
+   if (ring.empty()) {
+      ring.assign(static_cast<size_t>(
+         std::max(1.0, std::floor(data.samplerate / 20.0))), 0.0f);
+      data.queuestart = data.queuecount = 0;
+      data.queuetotal = 0.0;
    }
+   const auto queueLength = ring.size();
+
+   for (size_t i = 0; i < len; ++i) {
+      const float sample = buffer[i];
+      data.queuetotal += sample;
+      if (data.queuecount < queueLength) {
+         ring[(data.queuestart + data.queuecount) % queueLength] = sample;
+         ++data.queuecount;
+      }
+      else {
+         data.queuetotal -= ring[data.queuestart];
+         ring[data.queuestart] = sample;
+         if (++data.queuestart == queueLength)
+            data.queuestart = 0;
+      }
 
-   return sample - (data.queuetotal / data.queuesamples.size());
+      buffer[i] = sample - (data.queuetotal / data.queuecount);
+   }
 }
@@ -11,7 +11,7 @@
 #ifndef __AUDACITY_EFFECT_DISTORTION__
 #define __AUDACITY_EFFECT_DISTORTION__
 
-#include <queue>
+#include <vector>
 
 #include "Effect.h"
 
@@ -37,8 +37,10 @@ public:
    double      param2;
    int         repeats;
 
-   // DC block filter variables
-   std::queue<float> queuesamples;
+   // DC block filter variables:  a ring buffer of the latest samples
+   std::vector<float> queuesamples;
+   size_t queuestart;
+   size_t queuecount;
    double queuetotal;
 };
 
@@ -96,6 +98,7 @@ public:
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
 
 private:
 
@@ -136,8 +139,13 @@ private:
    void UpdateControlText(wxTextCtrl *textCtrl, wxString &string, bool enabled);
 
    void MakeTable();
-   float WaveShaper(float sample);
-   float DCFilter(EffectDistortionState & data, float sample);
+   // Look up len samples in the table, scaling the inputs first by preGain
+   // if PreGain; output is the result times gain, plus if Mix the input
+   // times dry.  Specialized so that the loop has no branches on the type.
+   template<bool PreGain, bool Mix>
+   void WaveShaper(const float *ibuf, float *obuf, size_t len,
+      double preGain, double gain, double dry) const;
+   void DCFilter(EffectDistortionState & data, float *buffer, size_t len);
 
    // Preset tables for gain lookup
 
@@ -572,10 +572,20 @@ bool EffectDtmf::MakeDtmfTone(float *buffer, size_t len, float fs, wxChar tone,
 
    // now generate the wave: 'last' is used to avoid phase errors
    // when inside the inner for loop of the Process() function.
+   // Rotate two phasors from the exact phases at the start of the buffer,
+   // rather than call sin twice for each sample
+   const double cosA = cos(A), sinA = sin(A);
+   const double cosB = cos(B), sinB = sin(B);
+   double cA = cos(A * last.as_double()), sA = sin(A * last.as_double());
+   double cB = cos(B * last.as_double()), sB = sin(B * last.as_double());
    for(decltype(len) i = 0; i < len; i++) {
-      buffer[i] = amplitude * 0.5 *
-         (sin( A * (i + last).as_double() ) +
-          sin( B * (i + last).as_double() ));
+      buffer[i] = amplitude * 0.5 * (sA + sB);
+      const double nextCA = cA * cosA - sA * sinA;
+      sA = sA * cosA + cA * sinA;
+      cA = nextCA;
+      const double nextCB = cB * cosB - sB * sinB;
+      sB = sB * cosB + cB * sinB;
+      cB = nextCB;
    }
 
    // generate a fade-in of duration 1/250th of second
@@ -10,6 +10,10 @@ Max Maisel
 
 #include "EBUR128.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 EBUR128::EBUR128(double rate, size_t channels)
    : mChannelCount(channels)
    , mRate(rate)
@@ -21,6 +25,36 @@ EBUR128::EBUR128(double rate, size_t channels)
    mWeightingFilter.reinit(mChannelCount, false);
    for(size_t channel = 0; channel < mChannelCount; ++channel)
       mWeightingFilter[channel] = CalcWeightingFilter(mRate);
+
+   // Windowed sinc interpolation to four times the rate, as suggested by
+   // ITU-R BS.1770 for the true peak, with each phase normalized to unity
+   // gain at DC.
+   const size_t length = TRUE_PEAK_PHASES * TRUE_PEAK_TAPS;
+   for(size_t phase = 0; phase < TRUE_PEAK_PHASES; ++phase)
+   {
+      double sum = 0;
+      double coeffs[TRUE_PEAK_TAPS];
+      for(size_t tap = 0; tap < TRUE_PEAK_TAPS; ++tap)
+      {
+         const size_t k = tap * TRUE_PEAK_PHASES + phase;
+         const double t =
+            (double(k) - (length - 1) / 2.0) / TRUE_PEAK_PHASES;
+         const double sinc = t == 0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+         const double window = 0.5 * (1 - cos(2 * M_PI * (k + 0.5) / length));
+         coeffs[tap] = sinc * window;
+         sum += coeffs[tap];
+      }
+      for(size_t tap = 0; tap < TRUE_PEAK_TAPS; ++tap)
+         mTruePeakCoeffs[phase][tap] = coeffs[tap] / sum;
+   }
+   mTruePeakHistory.reinit(mChannelCount);
+   mWeighted.reinit(mChannelCount);
+   for(size_t channel = 0; channel < mChannelCount; ++channel)
+   {
+      mTruePeakHistory[channel].reinit(TRUE_PEAK_TAPS - 1 + CHUNK_SIZE, true);
+      mWeighted[channel].reinit(CHUNK_SIZE);
+   }
+   mPower.reinit(CHUNK_SIZE);
 }
 
 void EBUR128::Initialize()
@@ -33,7 +67,15 @@ void EBUR128::Initialize()
    {
       mWeightingFilter[channel][0].Reset();
       mWeightingFilter[channel][1].Reset();
+      std::fill(mTruePeakHistory[channel].get(),
+         mTruePeakHistory[channel].get() + TRUE_PEAK_TAPS - 1, 0.0f);
    }
+   mSegmentSum = 0;
+   mSegmentLen = 0;
+   mSegmentRingPos = 0;
+   mSegmentCount = 0;
+   mMaxShortTerm = 0;
+   mTruePeak = 0;
 }
 
 // fs: sample rate
@@ -87,9 +129,11 @@ ArrayOf<Biquad> EBUR128::CalcWeightingFilter(double fs)
 
 void EBUR128::ProcessSampleFromChannel(float x_in, size_t channel)
 {
-   double value;
-   value = mWeightingFilter[channel][0].ProcessOne(x_in);
-   value = mWeightingFilter[channel][1].ProcessOne(value);
+   // Filter as WeightChannels() does
+   float weighted;
+   Biquad::ProcessCascade(mWeightingFilter[channel].get(), 2,
+      &x_in, &weighted, 1);
+   const double value = weighted;
    if(channel == 0)
       mBlockRingBuffer[mBlockRingPos] = value * value;
    else
@@ -98,10 +142,95 @@ void EBUR128::ProcessSampleFromChannel(float x_in, size_t channel)
       // As a result, stereo tracks appear about 3 LUFS louder, as specified.
       mBlockRingBuffer[mBlockRingPos] += value * value;
    }
+   UpdateTruePeak(channel, &x_in, 1);
+}
+
+void EBUR128::ProcessBuffers(const float *const *buffers, size_t len)
+{
+   std::vector<const float*> chunks(mChannelCount);
+   for(size_t offset = 0; offset < len; offset += CHUNK_SIZE)
+   {
+      const auto count = std::min<size_t>(CHUNK_SIZE, len - offset);
+      for(size_t channel = 0; channel < mChannelCount; ++channel)
+         chunks[channel] = buffers[channel] + offset;
+
+      WeightChannels(chunks.data(), count);
+      for(size_t channel = 0; channel < mChannelCount; ++channel)
+         UpdateTruePeak(channel, chunks[channel], count);
+      for(size_t i = 0; i < count; ++i)
+      {
+         mBlockRingBuffer[mBlockRingPos] = mPower[i];
+         NextSample();
+      }
+   }
+}
+
+/// Apply the weighting filters to len (at most CHUNK_SIZE) samples of each
+/// channel, and store the power summed over the channels in mPower,
+/// as ProcessSampleFromChannel() computes it
+void EBUR128::WeightChannels(const float *const *buffers, size_t len)
+{
+   // Filter all the channels in one call, pairs of them together
+   std::vector<Biquad*> filters(mChannelCount);
+   std::vector<float*> weighted(mChannelCount);
+   for(size_t channel = 0; channel < mChannelCount; ++channel)
+   {
+      filters[channel] = mWeightingFilter[channel].get();
+      weighted[channel] = mWeighted[channel].get();
+   }
+   Biquad::ProcessCascades(filters.data(), 2, mChannelCount,
+      buffers, weighted.data(), len);
+
+   for(size_t channel = 0; channel < mChannelCount; ++channel)
+   {
+      const float *pWeighted = weighted[channel];
+      for(size_t i = 0; i < len; ++i)
+      {
+         const double value = pWeighted[i];
+         if(channel == 0)
+            mPower[i] = value * value;
+         else
+            mPower[i] += value * value;
+      }
+   }
+}
+
+void EBUR128::UpdateTruePeak(size_t channel, const float *samples, size_t len)
+{
+   float *history = mTruePeakHistory[channel].get();
+   float peak = mTruePeak;
+   while(len > 0)
+   {
+      const auto count = std::min<size_t>(CHUNK_SIZE, len);
+      std::copy(samples, samples + count, history + TRUE_PEAK_TAPS - 1);
+      for(size_t i = 0; i < count; ++i)
+      {
+         // x[-j] is j samples before the current one
+         const float *x = history + i + TRUE_PEAK_TAPS - 1;
+         peak = std::max(peak, std::abs(x[0]));
+         for(size_t phase = 0; phase < TRUE_PEAK_PHASES; ++phase)
+         {
+            const float *coeffs = mTruePeakCoeffs[phase];
+            float sum = 0;
+            for(size_t tap = 0; tap < TRUE_PEAK_TAPS; ++tap)
+               sum += coeffs[tap] * x[-int(tap)];
+            peak = std::max(peak, std::abs(sum));
+         }
+      }
+      // Keep the latest samples for the next time
+      std::copy(history + count, history + count + TRUE_PEAK_TAPS - 1, history);
+      samples += count;
+      len -= count;
+   }
+   mTruePeak = peak;
 }
 
 void EBUR128::NextSample()
 {
+   mSegmentSum += mBlockRingBuffer[mBlockRingPos];
+   if(++mSegmentLen == mBlockOverlap)
+      AddSegment();
+
    ++mBlockRingPos;
    ++mBlockRingSize;
 
@@ -150,6 +279,41 @@ double EBUR128::IntegrativeLoudness()
    return 0.8529037031 * sum_v / sum_c;
 }
 
+double EBUR128::MaxShortTermLoudness()
+{
+   if(mSegmentCount >= SHORT_TERM_SEGMENTS)
+      return 0.8529037031 * mMaxShortTerm;
+
+   // Fewer than three seconds: the mean of all there is
+   double sum = mSegmentSum;
+   for(size_t i = 0; i < mSegmentCount; ++i)
+      sum += mSegmentRing[i];
+   const auto len = mSegmentCount * mBlockOverlap + mSegmentLen;
+   if(len == 0)
+      return 0;
+   return 0.8529037031 * sum / len;
+}
+
+/// Close a 100 ms segment, and measure the short-term loudness of the
+/// latest three seconds
+void EBUR128::AddSegment()
+{
+   mSegmentRing[mSegmentRingPos] = mSegmentSum;
+   mSegmentRingPos = (mSegmentRingPos + 1) % SHORT_TERM_SEGMENTS;
+   ++mSegmentCount;
+   mSegmentSum = 0;
+   mSegmentLen = 0;
+
+   if(mSegmentCount >= SHORT_TERM_SEGMENTS)
+   {
+      double sum = 0;
+      for(size_t i = 0; i < SHORT_TERM_SEGMENTS; ++i)
+         sum += mSegmentRing[i];
+      mMaxShortTerm = std::max(mMaxShortTerm,
+         sum / double(SHORT_TERM_SEGMENTS * mBlockOverlap));
+   }
+}
+
 void EBUR128::HistogramSums(size_t start_idx, double& sum_v, long int& sum_c)
 {
     double val;
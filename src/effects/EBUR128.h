@@ -28,13 +28,27 @@ public:
    void Initialize();
    void ProcessSampleFromChannel(float x_in, size_t channel);
    void NextSample();
+   /// Process len samples of each of the channels at once; the same as
+   /// ProcessSampleFromChannel() for each channel and NextSample() for each
+   /// sample, but faster
+   void ProcessBuffers(const float *const *buffers, size_t len);
    double IntegrativeLoudness();
+   /// Greatest loudness of any three second window, as a power like
+   /// IntegrativeLoudness(); of all the samples if fewer were processed
+   double MaxShortTermLoudness();
+   /// Greatest magnitude of the signal oversampled four times, of any channel
+   double TruePeak() const { return mTruePeak; }
    inline double IntegrativeLoudnessToLUFS(double loudness)
       { return 10 * log10(loudness); }
+   inline static double TruePeakToDBTP(double peak)
+      { return 20 * log10(peak); }
 
 private:
    void HistogramSums(size_t start_idx, double& sum_v, long int& sum_c);
    void AddBlockToHistogram(size_t validLen);
+   void AddSegment();
+   void WeightChannels(const float *const *buffers, size_t len);
+   void UpdateTruePeak(size_t channel, const float *samples, size_t len);
 
    static const size_t HIST_BIN_COUNT = 65536;
    /// EBU R128 absolute threshold
@@ -49,6 +63,30 @@ private:
    size_t mChannelCount;
    double mRate;
 
+   /// Power summed over the current 100 ms segment, and its length so far
+   double mSegmentSum;
+   size_t mSegmentLen;
+   /// Sums of the latest segments, a ring, for short-term loudness
+   static const size_t SHORT_TERM_SEGMENTS = 30;
+   double mSegmentRing[SHORT_TERM_SEGMENTS];
+   size_t mSegmentRingPos;
+   size_t mSegmentCount;
+   double mMaxShortTerm;
+
+   /// Polyphase interpolation filter for the true peak; for each channel
+   /// the last TRUE_PEAK_TAPS - 1 samples, then room for a chunk
+   static const size_t TRUE_PEAK_PHASES = 4;
+   static const size_t TRUE_PEAK_TAPS = 12;
+   static const size_t CHUNK_SIZE = 1024;
+   float mTruePeakCoeffs[TRUE_PEAK_PHASES][TRUE_PEAK_TAPS];
+   ArrayOf<Floats> mTruePeakHistory;
+   double mTruePeak;
+
+   /// Scratch for ProcessBuffers(): weighted samples of each channel and
+   /// their summed power
+   ArrayOf<Floats> mWeighted;
+   Doubles mPower;
+
    /// This is be an array of arrays of the type
    /// mWeightingFilter[CHANNEL][FILTER] with
    /// CHANNEL = LEFT/RIGHT (0/1) and
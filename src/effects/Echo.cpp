@@ -24,6 +24,7 @@
 #include "LoadEffects.h"
 
 #include <float.h>
+#include <algorithm>
 
 #include <wx/intl.h>
 
@@ -108,7 +109,19 @@ bool EffectEcho::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames
       if (requestedHistLen !=
             (histLen = static_cast<size_t>(requestedHistLen.as_long_long())))
          throw std::bad_alloc{};
-      history.reinit(histLen, true);
+
+      // Keep the buffer of an earlier track when it is big enough, and
+      // clear only the part of it that was written
+      if (histLen > histCapacity)
+      {
+         history.reset();
+         histCapacity = histDirty = 0;
+         history.reinit(histLen, true);
+         histCapacity = histLen;
+      }
+      else
+         std::fill(history.get(), history.get() + histDirty, 0.0f);
+      histDirty = 0;
    }
    catch ( const std::bad_alloc& ) {
       Effect::MessageBox( XO("Requested value exceeds memory capacity.") );
@@ -120,22 +133,40 @@ bool EffectEcho::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames
 
 bool EffectEcho::ProcessFinalize()
 {
-   history.reset();
+   // The buffer is kept for the next track, until End()
    return true;
 }
 
+void EffectEcho::End()
+{
+   history.reset();
+   histCapacity = histDirty = 0;
+}
+
 size_t EffectEcho::ProcessBlock(float **inBlock, float **outBlock, size_t blockLen)
 {
    float *ibuf = inBlock[0];
    float *obuf = outBlock[0];
 
-   for (decltype(blockLen) i = 0; i < blockLen; i++, histPos++)
+   const double gain = decay;
+
+   // In runs up to the end of the history, so that the loop has no test
+   // for the wrap around
+   for (decltype(blockLen) i = 0; i < blockLen;)
    {
       if (histPos == histLen)
       {
          histPos = 0;
       }
-      history[histPos] = obuf[i] = ibuf[i] + history[histPos] * decay;
+      const auto run = std::min(blockLen - i, histLen - histPos);
+      float *hist = history.get() + histPos;
+      for (decltype(blockLen) j = 0; j < run; j++)
+      {
+         hist[j] = obuf[i + j] = ibuf[i + j] + hist[j] * gain;
+      }
+      i += run;
+      histPos += run;
+      histDirty = std::max(histDirty, histPos);
    }
 
    return blockLen;
@@ -167,6 +198,13 @@ bool EffectEcho::SetAutomationParameters(CommandParameters & parms)
    return true;
 }
 
+// Effect implementation
+
+std::unique_ptr<Effect> EffectEcho::MakeParallelProcessor()
+{
+   return std::make_unique<EffectEcho>();
+}
+
 void EffectEcho::PopulateOrExchange(ShuttleGui & S)
 {
    S.AddSpace(0, 5);
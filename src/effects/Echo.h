@@ -49,6 +49,8 @@ public:
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
+   void End() override;
 
 private:
    // EffectEcho implementation
@@ -59,6 +61,10 @@ private:
    Floats history;
    size_t histPos;
    size_t histLen;
+   // Allocated length of history, which may exceed histLen
+   size_t histCapacity{ 0 };
+   // Length of the start of history that was written since it was cleared
+   size_t histDirty{ 0 };
 };
 
 #endif // __AUDACITY_EFFECT_ECHO__
@@ -21,15 +21,19 @@
 #include "../Experimental.h"
 
 #include <algorithm>
+#include <exception>
+#include <thread>
 
 #include <wx/defs.h>
 #include <wx/sizer.h>
 #include <wx/tokenzr.h>
+#include <wx/utils.h>
 
 #include "../AudioIO.h"
 #include "../LabelTrack.h"
 #include "../Mix.h"
 #include "../PluginManager.h"
+#include "../Profiler.h"
 #include "../ProjectAudioManager.h"
 #include "../ProjectSettings.h"
 #include "../ShuttleGui.h"
@@ -44,6 +48,7 @@
 #include "../widgets/NumericTextCtrl.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/ErrorDialog.h"
+#include "RealtimeEffectManager.h"
 
 #include <unordered_map>
 
@@ -404,6 +409,12 @@ bool Effect::RealtimeInitialize()
 
    mBlockSize = 512;
 
+   if (mStreamingPreview)
+   {
+      mPreviewProcessors.clear();
+      return true;
+   }
+
    return false;
 }
 
@@ -414,6 +425,34 @@ bool Effect::RealtimeAddProcessor(unsigned numChannels, float sampleRate)
       return mClient->RealtimeAddProcessor(numChannels, sampleRate);
    }
 
+   if (mStreamingPreview)
+   {
+      auto pProcessor = MakeParallelProcessor();
+      CommandParameters parms;
+      if (pProcessor &&
+          GetAutomationParameters(parms) &&
+          SetUpProcessor(*pProcessor, parms))
+      {
+         auto &processor = *pProcessor;
+         processor.mNumChannels = numChannels;
+         processor.mSampleCnt =
+            sampleCount((mT1 - mT0) * sampleRate + 0.5);
+         processor.SetSampleRate(sampleRate);
+         processor.mBlockSize = processor.SetBlockSize(mBlockSize);
+
+         ChannelName map[3] = {
+            ChannelNameMono, ChannelNameEOL, ChannelNameEOL };
+         if (numChannels > 1)
+         {
+            map[0] = ChannelNameFrontLeft;
+            map[1] = ChannelNameFrontRight;
+         }
+         if (!processor.ProcessInitialize(processor.mSampleCnt, map))
+            pProcessor.reset();
+      }
+      mPreviewProcessors.push_back(std::move(pProcessor));
+   }
+
    return true;
 }
 
@@ -424,6 +463,15 @@ bool Effect::RealtimeFinalize()
       return mClient->RealtimeFinalize();
    }
 
+   if (mStreamingPreview)
+   {
+      for (auto &pProcessor : mPreviewProcessors)
+         if (pProcessor)
+            pProcessor->ProcessFinalize();
+      mPreviewProcessors.clear();
+      return true;
+   }
+
    return false;
 }
 
@@ -463,6 +511,20 @@ size_t Effect::RealtimeProcess(int group,
       return mClient->RealtimeProcess(group, inbuf, outbuf, numSamples);
    }
 
+   if (mStreamingPreview)
+   {
+      if (group >= 0 && group < (int) mPreviewProcessors.size() &&
+          mPreviewProcessors[group])
+         return mPreviewProcessors[group]->ProcessBlock(
+            inbuf, outbuf, numSamples);
+
+      // The processor could not start; play the input unchanged
+      const auto chans = std::min(mNumAudioIn, mNumAudioOut);
+      for (size_t c = 0; c < chans; ++c)
+         std::copy(inbuf[c], inbuf[c] + numSamples, outbuf[c]);
+      return numSamples;
+   }
+
    return 0;
 }
 
@@ -1308,6 +1370,7 @@ bool Effect::DoEffect(double projectRate,
       };
       auto vr = valueRestorer( mProgress, &progress );
 
+      PROFILE_SCOPE("Effect::Process");
       returnVal = Process();
    }
 
@@ -1340,6 +1403,33 @@ int Effect::GetPass()
    return mPass;
 }
 
+std::unique_ptr<Effect> Effect::MakeParallelProcessor()
+{
+   if (mClient)
+   {
+      auto pClient = mClient->MakeParallelClient();
+      if (pClient)
+      {
+         auto pProcessor = std::make_unique<Effect>();
+         auto &client = *pClient;
+         pProcessor->mParallelClient = std::move(pClient);
+         if (pProcessor->Startup(&client))
+            return pProcessor;
+      }
+   }
+
+   return {};
+}
+
+bool Effect::IsPointwise()
+{
+   return false;
+}
+
+void Effect::ProcessPointwise(float *, size_t, sampleCount)
+{
+}
+
 bool Effect::InitPass1()
 {
    return true;
@@ -1381,16 +1471,20 @@ bool Effect::ProcessPass()
    bool bGoodResult = true;
    bool isGenerator = GetType() == EffectTypeGenerate;
 
-   FloatBuffers inBuffer, outBuffer;
-   ArrayOf<float *> inBufPos, outBufPos;
+   // Effects that can make more processors of themselves process the
+   // groups on worker threads, once all are found
+   std::unique_ptr<Effect> pProcessor;
+   if (GetType() == EffectTypeProcess &&
+       std::thread::hardware_concurrency() > 1)
+      pProcessor = MakeParallelProcessor();
+   std::vector<TrackGroup> groups;
 
-   ChannelName map[3];
+   GroupBuffers buffers;
 
    mBufferSize = 0;
    mBlockSize = 0;
 
    int count = 0;
-   bool clear = false;
 
    const bool multichannel = mNumAudioIn > 1;
    auto range = multichannel
@@ -1401,11 +1495,9 @@ bool Effect::ProcessPass()
          if (!left->GetSelected())
             return fallthrough();
 
-         sampleCount len = 0;
-         sampleCount start = 0;
-
-         mNumChannels = 0;
-         WaveTrack *right{};
+         TrackGroup group{ count, {}, 0, left, nullptr, 0, 0 };
+         auto &map = group.map;
+         auto &numChannels = group.numChannels;
 
          // Iterate either over one track which could be any channel,
          // or if multichannel, then over all channels of left,
@@ -1413,115 +1505,296 @@ bool Effect::ProcessPass()
          for (auto channel :
               TrackList::Channels(left).StartingWith(left)) {
             if (channel->GetChannel() == Track::LeftChannel)
-               map[mNumChannels] = ChannelNameFrontLeft;
+               map[numChannels] = ChannelNameFrontLeft;
             else if (channel->GetChannel() == Track::RightChannel)
-               map[mNumChannels] = ChannelNameFrontRight;
+               map[numChannels] = ChannelNameFrontRight;
             else
-               map[mNumChannels] = ChannelNameMono;
+               map[numChannels] = ChannelNameMono;
 
-            ++ mNumChannels;
-            map[mNumChannels] = ChannelNameEOL;
+            ++ numChannels;
+            map[numChannels] = ChannelNameEOL;
 
             if (! multichannel)
                break;
 
-            if (mNumChannels == 2) {
+            if (numChannels == 2) {
                // TODO: more-than-two-channels
-               right = channel;
-               clear = false;
+               group.right = channel;
                // Ignore other channels
                break;
             }
          }
 
          if (!isGenerator)
-         {
-            GetBounds(*left, right, &start, &len);
-            mSampleCnt = len;
+            GetBounds(*left, group.right, &group.start, &group.len);
+
+         if (pProcessor)
+            groups.push_back(group);
+         else {
+            // Go process the track(s)
+            bGoodResult = ProcessGroup(group, buffers);
+            if (!bGoodResult)
+               return;
          }
-         else
-            mSampleCnt = left->TimeToLongSamples(mDuration);
 
-         // Let the client know the sample rate
-         SetSampleRate(left->GetRate());
+         count++;
+      },
+      [&](Track *t) {
+         if (t->IsSyncLockSelected())
+            t->SyncLockAdjust(mT1, mT0 + mDuration);
+      }
+   );
 
-         // Get the block size the client wants to use
-         auto max = left->GetMaxBlockSize() * 2;
-         mBlockSize = SetBlockSize(max);
+   if (bGoodResult && !groups.empty())
+      bGoodResult = ProcessInParallel(groups, std::move(pProcessor));
 
-         // Calculate the buffer size to be at least the max rounded up to the clients
-         // selected block size.
-         const auto prevBufferSize = mBufferSize;
-         mBufferSize = ((max + (mBlockSize - 1)) / mBlockSize) * mBlockSize;
+   if (bGoodResult && GetType() == EffectTypeGenerate)
+   {
+      mT1 = mT0 + mDuration;
+   }
 
-         // If the buffer size has changed, then (re)allocate the buffers
-         if (prevBufferSize != mBufferSize)
-         {
-            // Always create the number of input buffers the client expects even if we don't have
-            // the same number of channels.
-            inBufPos.reinit( mNumAudioIn );
-            inBuffer.reinit( mNumAudioIn, mBufferSize );
+   return bGoodResult;
+}
 
-            // We won't be using more than the first 2 buffers, so clear the rest (if any)
-            for (size_t i = 2; i < mNumAudioIn; i++)
-            {
-               for (size_t j = 0; j < mBufferSize; j++)
-               {
-                  inBuffer[i][j] = 0.0;
-               }
-            }
+bool Effect::ProcessGroup(const TrackGroup &group, GroupBuffers &buffers)
+{
+   PROFILE_SCOPE("Effect::ProcessGroup");
+   auto left = group.left;
+   auto right = group.right;
+   auto &inBuffer = buffers.inBuffer;
+   auto &outBuffer = buffers.outBuffer;
+   auto &inBufPos = buffers.inBufPos;
+   auto &outBufPos = buffers.outBufPos;
 
-            // Always create the number of output buffers the client expects even if we don't have
-            // the same number of channels.
-            outBufPos.reinit( mNumAudioOut );
-            // Output buffers get an extra mBlockSize worth to give extra room if
-            // the plugin adds latency
-            outBuffer.reinit( mNumAudioOut, mBufferSize + mBlockSize );
-         }
+   mNumChannels = group.numChannels;
+   if (right)
+      buffers.clear = false;
 
-         // (Re)Set the input buffer positions
-         for (size_t i = 0; i < mNumAudioIn; i++)
-         {
-            inBufPos[i] = inBuffer[i].get();
-         }
+   if (GetType() != EffectTypeGenerate)
+      mSampleCnt = group.len;
+   else
+      mSampleCnt = left->TimeToLongSamples(mDuration);
 
-         // (Re)Set the output buffer positions
-         for (size_t i = 0; i < mNumAudioOut; i++)
-         {
-            outBufPos[i] = outBuffer[i].get();
-         }
+   // Let the client know the sample rate
+   SetSampleRate(left->GetRate());
+
+   if (GetType() == EffectTypeProcess && IsPointwise())
+      return ProcessGroupPointwise(group);
+
+   // Get the block size the client wants to use
+   auto max = left->GetMaxBlockSize() * 2;
+   mBlockSize = SetBlockSize(max);
+
+   // Calculate the buffer size to be at least the max rounded up to the clients
+   // selected block size.
+   const auto prevBufferSize = mBufferSize;
+   mBufferSize = ((max + (mBlockSize - 1)) / mBlockSize) * mBlockSize;
 
-         // Clear unused input buffers
-         if (!right && !clear && mNumAudioIn > 1)
+   // If the buffer size has changed, then (re)allocate the buffers
+   if (prevBufferSize != mBufferSize)
+   {
+      // Always create the number of input buffers the client expects even if we don't have
+      // the same number of channels.
+      inBufPos.reinit( mNumAudioIn );
+      inBuffer.reinit( mNumAudioIn, mBufferSize );
+
+      // We won't be using more than the first 2 buffers, so clear the rest (if any)
+      for (size_t i = 2; i < mNumAudioIn; i++)
+      {
+         for (size_t j = 0; j < mBufferSize; j++)
          {
-            for (size_t j = 0; j < mBufferSize; j++)
-            {
-               inBuffer[1][j] = 0.0;
-            }
-            clear = true;
+            inBuffer[i][j] = 0.0;
          }
+      }
 
-         // Go process the track(s)
-         bGoodResult = ProcessTrack(
-            count, map, left, right, start, len,
-            inBuffer, outBuffer, inBufPos, outBufPos);
-         if (!bGoodResult)
-            return;
+      // Always create the number of output buffers the client expects even if we don't have
+      // the same number of channels.
+      outBufPos.reinit( mNumAudioOut );
+      // Output buffers get an extra mBlockSize worth to give extra room if
+      // the plugin adds latency
+      outBuffer.reinit( mNumAudioOut, mBufferSize + mBlockSize );
+   }
 
-         count++;
-      },
-      [&](Track *t) {
-         if (t->IsSyncLockSelected())
-            t->SyncLockAdjust(mT1, mT0 + mDuration);
-      }
-   );
+   // (Re)Set the input buffer positions
+   for (size_t i = 0; i < mNumAudioIn; i++)
+   {
+      inBufPos[i] = inBuffer[i].get();
+   }
 
-   if (bGoodResult && GetType() == EffectTypeGenerate)
+   // (Re)Set the output buffer positions
+   for (size_t i = 0; i < mNumAudioOut; i++)
    {
-      mT1 = mT0 + mDuration;
+      outBufPos[i] = outBuffer[i].get();
    }
 
-   return bGoodResult;
+   // Clear unused input buffers
+   if (!right && !buffers.clear && mNumAudioIn > 1)
+   {
+      for (size_t j = 0; j < mBufferSize; j++)
+      {
+         inBuffer[1][j] = 0.0;
+      }
+      buffers.clear = true;
+   }
+
+   // Go process the track(s)
+   ChannelName map[3];
+   std::copy(group.map, group.map + 3, map);
+   return ProcessTrack(
+      group.count, map, left, right, group.start, group.len,
+      inBuffer, outBuffer, inBufPos, outBufPos);
+}
+
+bool Effect::ProcessGroupPointwise(const TrackGroup &group)
+{
+   // Samples between clips stay absent, as when ProcessTrack sets them
+   const auto len = group.len;
+   double done = 0;
+   const double total = len.as_double() * group.numChannels;
+   for (auto channel : { group.left, group.right }) {
+      if (!channel)
+         continue;
+      if (!channel->TransformSamples(group.start, len,
+         [&](float *buffer, size_t count, sampleCount pos) {
+            ProcessPointwise(buffer, count, pos);
+            done += count;
+            return !(group.numChannels > 1
+               ? TrackGroupProgress(group.count, done / total)
+               : TrackProgress(group.count, done / total));
+         }))
+         return false;
+   }
+   return true;
+}
+
+bool Effect::ProcessInParallel(
+   const std::vector<TrackGroup> &groups, std::unique_ptr<Effect> pFirst)
+{
+   const auto nGroups = groups.size();
+   const auto nThreads = std::min<size_t>(
+      nGroups, std::thread::hardware_concurrency());
+
+   std::vector< std::unique_ptr<Effect> > processors;
+   processors.push_back(std::move(pFirst));
+   while (processors.size() < nThreads) {
+      auto pProcessor = MakeParallelProcessor();
+      if (!pProcessor)
+         break;
+      processors.push_back(std::move(pProcessor));
+   }
+
+   // Give the processors the settings of this effect
+   CommandParameters parms;
+   if (!GetAutomationParameters(parms))
+      return false;
+   std::vector< std::atomic<double> > fractions(nGroups);
+   std::atomic<bool> stopped{ false };
+   for (auto &pProcessor : processors) {
+      auto &processor = *pProcessor;
+      if (!SetUpProcessor(processor, parms))
+         return false;
+      processor.mpParallelStopped = &stopped;
+   }
+
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::vector<std::exception_ptr> errors(processors.size());
+   {
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the tracks go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for (auto &thread : threads)
+            thread.join();
+      } );
+      for (size_t ii = 0; ii < processors.size(); ++ii)
+         threads.emplace_back( [&, ii]{
+            auto &processor = *processors[ii];
+            GroupBuffers buffers;
+            try {
+               for (size_t jj = 0;
+                    !stopped.load() && (jj = next++) < nGroups;) {
+                  processor.mpParallelFraction = &fractions[jj];
+                  if (!processor.ProcessGroup(groups[jj], buffers)) {
+                     stopped.store(true);
+                     break;
+                  }
+                  ++nDone;
+               }
+            }
+            catch (...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      const bool multichannel = mNumAudioIn > 1;
+      while (nDone.load() < nGroups && !stopped.load()) {
+         double sum = 0;
+         for (const auto &fraction : fractions)
+            sum += fraction.load();
+         if (multichannel
+             ? TrackGroupProgress(0, sum)
+             : TrackProgress(0, sum))
+            stopped.store(true);
+         else
+            ::wxMilliSleep(10);
+      }
+   }
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+
+   return nDone.load() == nGroups;
+}
+
+bool Effect::CanStreamPreview()
+{
+   // Effects with realtime support play through their own dialogs instead.
+   // The others need processors, which process each channel group of the
+   // premixed preview, the mix being valid only for linear effects.
+   if (mClient || SupportsRealtime() || GetType() != EffectTypeProcess ||
+       !mIsLinearEffect || mPreviewFullSelection)
+      return false;
+
+   return MakeParallelProcessor() != nullptr;
+}
+
+bool Effect::SetUpProcessor(Effect &processor, CommandParameters &parms)
+{
+   if (!processor.SetAutomationParameters(parms))
+      return false;
+   processor.mT0 = mT0;
+   processor.mT1 = mT1;
+   processor.mDuration = mDuration;
+   processor.mIsPreview = mIsPreview;
+   processor.mProjectRate = mProjectRate;
+   processor.mPass = mPass;
+   processor.mNumTracks = mNumTracks;
+   processor.mNumGroups = mNumGroups;
+   processor.mNumAudioIn = mNumAudioIn;
+   processor.mNumAudioOut = mNumAudioOut;
+   processor.mBufferSize = 0;
+   processor.mBlockSize = 0;
+   return true;
+}
+
+namespace {
+
+// The most samples from pos, not more than len, that end on a block boundary
+// of the track, or len if no boundary is in that range
+size_t BlockAlignedLength(const WaveTrack &track, sampleCount pos, size_t len)
+{
+   size_t result = 0;
+   while (result < len) {
+      const auto best = track.GetBestBlockSize(pos + result);
+      if (best > len - result)
+         break;
+      result += best;
+   }
+   return result > 0 ? result : len;
+}
+
 }
 
 bool Effect::ProcessTrack(int count,
@@ -1775,19 +2048,25 @@ bool Effect::ProcessTrack(int count,
       // Output buffers have filled
       else
       {
+         auto writeCnt = outputBufferCnt;
          if (isProcessor)
          {
+            // Write up to a block boundary of the track, keeping the rest
+            // for the next write, so that each block of the selection is
+            // replaced by a NEW block file just once
+            writeCnt = BlockAlignedLength(*left, outPos, outputBufferCnt);
+
             // Write them out
-            left->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
+            left->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, writeCnt);
             if (right)
             {
                if (chans >= 2)
                {
-                  right->Set((samplePtr) outBuffer[1].get(), floatSample, outPos, outputBufferCnt);
+                  right->Set((samplePtr) outBuffer[1].get(), floatSample, outPos, writeCnt);
                }
                else
                {
-                  right->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, outputBufferCnt);
+                  right->Set((samplePtr) outBuffer[0].get(), floatSample, outPos, writeCnt);
                }
             }
          }
@@ -1800,15 +2079,20 @@ bool Effect::ProcessTrack(int count,
             }
          }
 
-         // Reset the output buffer positions
+         // Move any samples not written to the start, and reset the output
+         // buffer positions after them
+         const auto remaining = outputBufferCnt - writeCnt;
          for (size_t i = 0; i < chans; i++)
          {
-            outBufPos[i] = outBuffer[i].get();
+            if (remaining > 0)
+               memmove(outBuffer[i].get(), outBuffer[i].get() + writeCnt,
+                       sizeof(float) * remaining);
+            outBufPos[i] = outBuffer[i].get() + remaining;
          }
 
          // Bump to the next track position
-         outPos += outputBufferCnt;
-         outputBufferCnt = 0;
+         outPos += writeCnt;
+         outputBufferCnt = remaining;
       }
 
       if (mNumChannels > 1)
@@ -2020,6 +2304,10 @@ bool Effect::TotalProgress(double frac, const TranslatableString &msg)
 
 bool Effect::TrackProgress(int whichTrack, double frac, const TranslatableString &msg)
 {
+   if (mpParallelFraction) {
+      mpParallelFraction->store(frac);
+      return mpParallelStopped->load();
+   }
    auto updateResult = (mProgress ?
       mProgress->Update(whichTrack + frac, (double) mNumTracks, msg) :
       ProgressResult::Success);
@@ -2028,6 +2316,10 @@ bool Effect::TrackProgress(int whichTrack, double frac, const TranslatableString
 
 bool Effect::TrackGroupProgress(int whichGroup, double frac, const TranslatableString &msg)
 {
+   if (mpParallelFraction) {
+      mpParallelFraction->store(frac);
+      return mpParallelStopped->load();
+   }
    auto updateResult = (mProgress ?
       mProgress->Update(whichGroup + frac, (double) mNumGroups, msg) :
       ProgressResult::Success);
@@ -2335,6 +2627,7 @@ void Effect::Preview(bool dryOnly)
       return;
 
    bool success = true;
+   const bool streaming = !dryOnly && CanStreamPreview();
 
    auto cleanup = finally( [&] {
 
@@ -2424,7 +2717,7 @@ void Effect::Preview(bool dryOnly)
    CountWaveTracks();
 
    // Apply effect
-   if (!dryOnly) {
+   if (!dryOnly && !streaming) {
       ProgressDialog progress{
          GetName(),
          XO("Preparing preview"),
@@ -2445,6 +2738,20 @@ void Effect::Preview(bool dryOnly)
       // than previewLen, so take the min.
       t1 = std::min(mT0 + previewLen, mT1);
 
+      // Or else let the effect process the mix as it plays, through the
+      // realtime effect path, so that playback begins at once
+      auto vr3 = valueRestorer( mStreamingPreview, streaming );
+      auto vr4 = valueRestorer( mIsPreview, true );
+      if (streaming) {
+         mNumAudioIn = GetAudioInCount();
+         mNumAudioOut = GetAudioOutCount();
+         RealtimeEffectManager::Get().RealtimeAddEffect(this);
+      }
+      auto cleanup3 = finally( [&] {
+         if (streaming)
+            RealtimeEffectManager::Get().RealtimeRemoveEffect(this);
+      } );
+
       // Start audio playing
       AudioIOStartStreamOptions options { pProject, rate };
       int token =
@@ -16,8 +16,11 @@
 
 #include "../Experimental.h"
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <set>
+#include <vector>
 
 #include <wx/defs.h>
 
@@ -303,6 +306,25 @@ protected:
    virtual bool InitPass2();
    virtual int GetPass();
 
+   // An effect processing tracks by ProcessBlock, that keeps all the state
+   // of that processing in the object, may return a NEW object of its own
+   // class here.  Then ProcessPass gives such objects, with the same
+   // settings, to worker threads, which process independent tracks or
+   // channel groups at once.  The default returns such an object for a
+   // client that gives MakeParallelClient, or else null, for processing the
+   // tracks one after another.
+   virtual std::unique_ptr<Effect> MakeParallelProcessor();
+
+   // An effect whose ProcessBlock makes each output sample from the input
+   // sample of the same channel and position alone, without latency, may
+   // return true here and do the same in ProcessPointwise.  Then tracks are
+   // transformed block by block in place of ProcessTrack, with no staging
+   // buffers.  The default returns false.
+   virtual bool IsPointwise();
+   // Transform count samples of one channel in place; pos counts from the
+   // start of the group, whose length is in mSampleCnt
+   virtual void ProcessPointwise(float *buffer, size_t count, sampleCount pos);
+
    // clean up any temporary memory, needed only per invocation of the
    // effect, after either successful or failed or exception-aborted processing.
    // Invoked inside a "finally" block so it must be no-throw.
@@ -343,6 +365,10 @@ protected:
    int GetNumWaveTracks() { return mNumTracks; }
    int GetNumWaveGroups() { return mNumGroups; }
 
+   // Whether this is one of the processors made by MakeParallelProcessor,
+   // running on a worker thread beside others
+   bool IsParallelProcessor() const { return mpParallelFraction != nullptr; }
+
    // Calculates the start time and length in samples for one or two channels
    void GetBounds(
       const WaveTrack &track, const WaveTrack *pRight,
@@ -483,6 +509,37 @@ protected:
  private:
    void CountWaveTracks();
 
+   // One track, or the channels of one track processed together
+   struct TrackGroup
+   {
+      int count;
+      ChannelName map[3];
+      unsigned numChannels;
+      WaveTrack *left;
+      WaveTrack *right;
+      sampleCount start;
+      sampleCount len;
+   };
+
+   // Buffers for ProcessTrack, reused from group to group
+   struct GroupBuffers
+   {
+      FloatBuffers inBuffer, outBuffer;
+      ArrayOf<float *> inBufPos, outBufPos;
+      bool clear{ false };
+   };
+
+   bool ProcessGroup(const TrackGroup &group, GroupBuffers &buffers);
+   bool ProcessGroupPointwise(const TrackGroup &group);
+   bool ProcessInParallel(const std::vector<TrackGroup> &groups,
+                          std::unique_ptr<Effect> pFirst);
+   // Give a processor made by MakeParallelProcessor the settings of this
+   // effect, which are in parms
+   bool SetUpProcessor(Effect &processor, CommandParameters &parms);
+   // Whether Preview can play the mix through processors of this effect as
+   // it goes, instead of rendering all first
+   bool CanStreamPreview();
+
    // Driver for client effects
    bool ProcessTrack(int count,
                      ChannelNames map,
@@ -523,6 +580,8 @@ private:
 
    // For client driver
    EffectClientInterface *mClient;
+   // The client of a processor made by MakeParallelProcessor, if it has one
+   std::unique_ptr<EffectClientInterface> mParallelClient;
    size_t mNumAudioIn;
    size_t mNumAudioOut;
 
@@ -530,6 +589,16 @@ private:
    size_t mBlockSize;
    unsigned mNumChannels;
 
+   // Set in the processors made by MakeParallelProcessor:  where the track
+   // progress goes, and whether the user has cancelled, instead of mProgress
+   std::atomic<double> *mpParallelFraction{};
+   const std::atomic<bool> *mpParallelStopped{};
+
+   // While Preview streams, the realtime methods drive these processors,
+   // one for each call of RealtimeAddProcessor, or null to pass audio through
+   bool mStreamingPreview{ false };
+   std::vector< std::unique_ptr<Effect> > mPreviewProcessors;
+
 public:
    const static wxString kUserPresetIdent;
    const static wxString kFactoryPresetIdent;
@@ -59,6 +59,9 @@
 #include "../Experimental.h"
 
 #include <math.h>
+#include <atomic>
+#include <exception>
+#include <thread>
 #include <vector>
 
 #include <wx/setup.h> // for wxUSE_* macros
@@ -97,6 +100,7 @@
 #include "../EnvelopeEditor.h"
 #include "../widgets/ErrorDialog.h"
 #include "../FFT.h"
+#include "../FFTConvolver.h"
 #include "../Prefs.h"
 #include "../Project.h"
 #include "../TrackArtist.h"
@@ -242,8 +246,7 @@ BEGIN_EVENT_TABLE(EffectEqualization, wxEvtHandler)
 END_EVENT_TABLE()
 
 EffectEqualization::EffectEqualization(int Options)
-   : mFFTBuffer{ windowSize }
-   , mFilterFuncR{ windowSize }
+   : mFilterFuncR{ windowSize }
    , mFilterFuncI{ windowSize }
 {
    mOptions = Options;
@@ -719,9 +722,18 @@ bool EffectEqualization::Process()
 #endif
    this->CopyInputTracks(); // Set up mOutputTracks.
    CalcFilter();
-   bool bGoodResult = true;
 
-   int count = 0;
+   // One kernel, shared by the convolvers of all tracks
+   const auto pKernel = std::make_shared<const FFTConvolutionKernel>(
+      mFilterImpulse.get(), mM);
+
+   struct Selection {
+      WaveTrack *track;
+      sampleCount start;
+      sampleCount len;
+      WaveTrack::Holder output;
+   };
+   std::vector<Selection> selections;
    for( auto track : mOutputTracks->Selected< WaveTrack >() ) {
       double trackStart = track->GetStartTime();
       double trackEnd = track->GetEndTime();
@@ -733,15 +745,72 @@ bool EffectEqualization::Process()
          auto end = track->TimeToLongSamples(t1);
          auto len = end - start;
 
-         if (!ProcessOne(count, track, start, len))
-         {
-            bGoodResult = false;
-            break;
-         }
+         // create a NEW WaveTrack to hold all of the output, including 'tails' each end
+         auto output = track->EmptyCopy();
+         track->ConvertToSampleFormat( floatSample );
+         selections.push_back( { track, start, len, output } );
+      }
+   }
+
+   // Filter the tracks on worker threads, while this thread updates the
+   // progress
+   const auto nSelections = selections.size();
+   const auto nThreads = std::min<size_t>(nSelections,
+      std::max(1u, std::thread::hardware_concurrency()));
+   std::vector< std::atomic<double> > fractions(nSelections);
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::atomic<bool> stopped{ false };
+   std::vector<std::exception_ptr> errors(nThreads);
+   {
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the tracks go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for (auto &thread : threads)
+            thread.join();
+      } );
+      for (size_t ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back( [&, ii]{
+            try {
+               for (size_t jj = 0;
+                    !stopped.load() && (jj = next++) < nSelections;) {
+                  const auto &selection = selections[jj];
+                  if (!FilterTrack(pKernel, *selection.track,
+                        selection.start, selection.len, *selection.output,
+                        [&](double fraction){
+                           fractions[jj].store(fraction);
+                           return !stopped.load();
+                        }))
+                     break;
+                  ++nDone;
+               }
+            }
+            catch (...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      while (nDone.load() < nSelections && !stopped.load()) {
+         double sum = 0;
+         for (const auto &fraction : fractions)
+            sum += fraction.load();
+         if (TotalProgress(sum / nSelections))
+            stopped.store(true);
+         else
+            ::wxMilliSleep(10);
       }
-
-      count++;
    }
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+
+   bool bGoodResult = nDone.load() == nSelections;
+   if (bGoodResult)
+      for (const auto &selection : selections)
+         ReplaceFiltered(*selection.track, selection.start, selection.len,
+            *selection.output);
 
    this->ReplaceProcessedTracks(bGoodResult);
    return bGoodResult;
@@ -1287,150 +1356,131 @@ bool EffectEqualization::TransferDataFromWindow()
 bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
                                     sampleCount start, sampleCount len)
 {
+   // The filter is as the last CalcFilter() made it
+   const auto pKernel = std::make_shared<const FFTConvolutionKernel>(
+      mFilterImpulse.get(), mM);
+
    // create a NEW WaveTrack to hold all of the output, including 'tails' each end
    auto output = t->EmptyCopy();
    t->ConvertToSampleFormat( floatSample );
 
-   wxASSERT(mM - 1 < windowSize);
-   size_t L = windowSize - (mM - 1);   //Process L samples at a go
-   auto s = start;
-   auto idealBlockLen = t->GetMaxBlockSize() * 4;
-   if (idealBlockLen % L != 0)
-      idealBlockLen += (L - (idealBlockLen % L));
-
-   Floats buffer{ idealBlockLen };
-
-   Floats window1{ windowSize };
-   Floats window2{ windowSize };
-   float *thisWindow = window1.get();
-   float *lastWindow = window2.get();
-
-   auto originalLen = len;
-
-   for(size_t i = 0; i < windowSize; i++)
-      lastWindow[i] = 0;
-
    TrackProgress(count, 0.);
-   bool bLoopSuccess = true;
-   size_t wcopy = 0;
-   int offset = (mM - 1) / 2;
+   if (!FilterTrack(pKernel, *t, start, len, *output,
+         [&](double fraction){ return !TrackProgress(count, fraction); }))
+      return false;
 
-   while (len != 0)
-   {
-      auto block = limitSampleBufferSize( idealBlockLen, len );
+   ReplaceFiltered(*t, start, len, *output);
+   return true;
+}
 
-      t->Get((samplePtr)buffer.get(), floatSample, s, block);
+bool EffectEqualization::FilterTrack(
+   const std::shared_ptr<const FFTConvolutionKernel> &pKernel,
+   const WaveTrack &t, sampleCount start, sampleCount len,
+   WaveTrack &output, const std::function<bool(double)> &progress) const
+{
+   FFTConvolver convolver{ pKernel };
+   // The convolver delays its output; discard that much at first, and
+   // feed it as many zeroes after the selection to get the 'tail'
+   size_t skip = convolver.GetLatency();
+   const auto total = len + (mM - 1) + skip;
 
-      for(size_t i = 0; i < block; i += L)   //go through block in lumps of length L
-      {
-         wcopy = std::min <size_t> (L, block - i);
-         for(size_t j = 0; j < wcopy; j++)
-            thisWindow[j] = buffer[i+j];   //copy the L (or remaining) samples
-         for(auto j = wcopy; j < windowSize; j++)
-            thisWindow[j] = 0;   //this includes the padding
+   const auto idealBlockLen = t.GetMaxBlockSize() * 4;
+   Floats buffer{ idealBlockLen };
 
-         Filter(windowSize, thisWindow);
+   auto s = start;
+   sampleCount done = 0;
+   while (done < total)
+   {
+      auto block = limitSampleBufferSize( idealBlockLen, total - done );
 
-         // Overlap - Add
-         for(size_t j = 0; (j < mM - 1) && (j < wcopy); j++)
-            buffer[i+j] = thisWindow[j] + lastWindow[L + j];
-         for(size_t j = mM - 1; j < wcopy; j++)
-            buffer[i+j] = thisWindow[j];
+      // Input, then zeroes after the selection
+      size_t read = 0;
+      if (done < len) {
+         read = limitSampleBufferSize( block, len - done );
+         t.Get((samplePtr)buffer.get(), floatSample, s, read);
+         s += read;
+      }
+      std::fill(buffer.get() + read, buffer.get() + block, 0.0f);
 
-         std::swap( thisWindow, lastWindow );
-      }  //next i, lump of this block
+      convolver.Process(buffer.get(), buffer.get(), block);
+      done += block;
 
-      output->Append((samplePtr)buffer.get(), floatSample, block);
-      len -= block;
-      s += block;
+      const auto discard = std::min(skip, block);
+      skip -= discard;
+      if (block > discard)
+         output.Append((samplePtr)(buffer.get() + discard), floatSample,
+                       block - discard);
 
-      if (TrackProgress(count, ( s - start ).as_double() /
-                        originalLen.as_double()))
-      {
-         bLoopSuccess = false;
-         break;
-      }
+      if (!progress( done.as_double() / total.as_double() ))
+         return false;
    }
 
-   if(bLoopSuccess)
-   {
-      // mM-1 samples of 'tail' left in lastWindow, get them now
-      if(wcopy < (mM - 1)) {
-         // Still have some overlap left to process
-         // (note that lastWindow and thisWindow have been exchanged at this point
-         //  so that 'thisWindow' is really the window prior to 'lastWindow')
-         size_t j = 0;
-         for(; j < mM - 1 - wcopy; j++)
-            buffer[j] = lastWindow[wcopy + j] + thisWindow[L + wcopy + j];
-         // And fill in the remainder after the overlap
-         for( ; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      } else {
-         for(size_t j = 0; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      }
-      output->Append((samplePtr)buffer.get(), floatSample, mM - 1);
-      output->Flush();
-
-      // now move the appropriate bit of the output back to the track
-      // (this could be enhanced in the future to use the tails)
-      double offsetT0 = t->LongSamplesToTime(offset);
-      double lenT = t->LongSamplesToTime(originalLen);
-      // 'start' is the sample offset in 't', the passed in track
-      // 'startT' is the equivalent time value
-      // 'output' starts at zero
-      double startT = t->LongSamplesToTime(start);
-
-      //output has one waveclip for the total length, even though
-      //t might have whitespace seperating multiple clips
-      //we want to maintain the original clip structure, so
-      //only paste the intersections of the NEW clip.
-
-      //Find the bits of clips that need replacing
-      std::vector<std::pair<double, double> > clipStartEndTimes;
-      std::vector<std::pair<double, double> > clipRealStartEndTimes; //the above may be truncated due to a clip being partially selected
-      for (const auto &clip : t->GetClips())
-      {
-         double clipStartT;
-         double clipEndT;
-
-         clipStartT = clip->GetStartTime();
-         clipEndT = clip->GetEndTime();
-         if( clipEndT <= startT )
-            continue;   // clip is not within selection
-         if( clipStartT >= startT + lenT )
-            continue;   // clip is not within selection
-
-         //save the actual clip start/end so that we can rejoin them after we paste.
-         clipRealStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
+   output.Flush();
+   return true;
+}
 
-         if( clipStartT < startT )  // does selection cover the whole clip?
-            clipStartT = startT; // don't copy all the NEW clip
-         if( clipEndT > startT + lenT )  // does selection cover the whole clip?
-            clipEndT = startT + lenT; // don't copy all the NEW clip
+void EffectEqualization::ReplaceFiltered(WaveTrack &t,
+   sampleCount start, sampleCount len, const WaveTrack &output) const
+{
+   int offset = (mM - 1) / 2;
+   auto originalLen = len;
 
-         //save them
-         clipStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
-      }
-      //now go thru and replace the old clips with NEW
-      for(unsigned int i = 0; i < clipStartEndTimes.size(); i++)
-      {
-         //remove the old audio and get the NEW
-         t->Clear(clipStartEndTimes[i].first,clipStartEndTimes[i].second);
-         auto toClipOutput = output->Copy(clipStartEndTimes[i].first-startT+offsetT0,clipStartEndTimes[i].second-startT+offsetT0);
-         //put the processed audio in
-         t->Paste(clipStartEndTimes[i].first, toClipOutput.get());
-         //if the clip was only partially selected, the Paste will have created a split line.  Join is needed to take care of this
-         //This is not true when the selection is fully contained within one clip (second half of conditional)
-         if( (clipRealStartEndTimes[i].first  != clipStartEndTimes[i].first ||
-            clipRealStartEndTimes[i].second != clipStartEndTimes[i].second) &&
-            !(clipRealStartEndTimes[i].first <= startT &&
-            clipRealStartEndTimes[i].second >= startT+lenT) )
-            t->Join(clipRealStartEndTimes[i].first,clipRealStartEndTimes[i].second);
-      }
+   // now move the appropriate bit of the output back to the track
+   // (this could be enhanced in the future to use the tails)
+   double offsetT0 = t.LongSamplesToTime(offset);
+   double lenT = t.LongSamplesToTime(originalLen);
+   // 'start' is the sample offset in 't', the passed in track
+   // 'startT' is the equivalent time value
+   // 'output' starts at zero
+   double startT = t.LongSamplesToTime(start);
+
+   //output has one waveclip for the total length, even though
+   //t might have whitespace seperating multiple clips
+   //we want to maintain the original clip structure, so
+   //only paste the intersections of the NEW clip.
+
+   //Find the bits of clips that need replacing
+   std::vector<std::pair<double, double> > clipStartEndTimes;
+   std::vector<std::pair<double, double> > clipRealStartEndTimes; //the above may be truncated due to a clip being partially selected
+   for (const auto &clip : t.GetClips())
+   {
+      double clipStartT;
+      double clipEndT;
+
+      clipStartT = clip->GetStartTime();
+      clipEndT = clip->GetEndTime();
+      if( clipEndT <= startT )
+         continue;   // clip is not within selection
+      if( clipStartT >= startT + lenT )
+         continue;   // clip is not within selection
+
+      //save the actual clip start/end so that we can rejoin them after we paste.
+      clipRealStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
+
+      if( clipStartT < startT )  // does selection cover the whole clip?
+         clipStartT = startT; // don't copy all the NEW clip
+      if( clipEndT > startT + lenT )  // does selection cover the whole clip?
+         clipEndT = startT + lenT; // don't copy all the NEW clip
+
+      //save them
+      clipStartEndTimes.push_back(std::pair<double,double>(clipStartT,clipEndT));
+   }
+   //now go thru and replace the old clips with NEW
+   for(unsigned int i = 0; i < clipStartEndTimes.size(); i++)
+   {
+      //remove the old audio and get the NEW
+      t.Clear(clipStartEndTimes[i].first,clipStartEndTimes[i].second);
+      auto toClipOutput = output.Copy(clipStartEndTimes[i].first-startT+offsetT0,clipStartEndTimes[i].second-startT+offsetT0);
+      //put the processed audio in
+      t.Paste(clipStartEndTimes[i].first, toClipOutput.get());
+      //if the clip was only partially selected, the Paste will have created a split line.  Join is needed to take care of this
+      //This is not true when the selection is fully contained within one clip (second half of conditional)
+      if( (clipRealStartEndTimes[i].first  != clipStartEndTimes[i].first ||
+         clipRealStartEndTimes[i].second != clipStartEndTimes[i].second) &&
+         !(clipRealStartEndTimes[i].first <= startT &&
+         clipRealStartEndTimes[i].second >= startT+lenT) )
+         t.Join(clipRealStartEndTimes[i].first,clipRealStartEndTimes[i].second);
    }
-
-   return bLoopSuccess;
 }
 
 bool EffectEqualization::CalcFilter()
@@ -1540,37 +1590,16 @@ bool EffectEqualization::CalcFilter()
       outr[i]=0.;
    }
 
+   //Keep the impulse response for the convolution
+   mFilterImpulse.reinit(mM);
+   std::copy(outr.get(), outr.get() + mM, mFilterImpulse.get());
+
    //Back to the frequency domain so we can use it
    RealFFT(mWindowSize, outr.get(), mFilterFuncR.get(), mFilterFuncI.get());
 
    return TRUE;
 }
 
-void EffectEqualization::Filter(size_t len, float *buffer)
-{
-   float re,im;
-   // Apply FFT
-   RealFFTf(buffer, hFFT.get());
-   //FFT(len, false, inr, NULL, outr, outi);
-
-   // Apply filter
-   // DC component is purely real
-   mFFTBuffer[0] = buffer[0] * mFilterFuncR[0];
-   for(size_t i = 1; i < (len / 2); i++)
-   {
-      re=buffer[hFFT->BitReversed[i]  ];
-      im=buffer[hFFT->BitReversed[i]+1];
-      mFFTBuffer[2*i  ] = re*mFilterFuncR[i] - im*mFilterFuncI[i];
-      mFFTBuffer[2*i+1] = re*mFilterFuncI[i] + im*mFilterFuncR[i];
-   }
-   // Fs/2 component is purely real
-   mFFTBuffer[1] = buffer[1] * mFilterFuncR[len/2];
-
-   // Inverse FFT and normalization
-   InverseRealFFTf(mFFTBuffer.get(), hFFT.get());
-   ReorderToTime(hFFT.get(), mFFTBuffer.get(), buffer);
-}
-
 //
 // Load external curves with fallback to default, then message
 //
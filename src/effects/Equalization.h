@@ -19,6 +19,8 @@
 
 #include <wx/setup.h> // for wxUSE_* macros
 
+#include <functional>
+
 #include "Effect.h"
 #include "../RealFFTf.h"
 
@@ -89,6 +91,7 @@ using EQCurveArray = std::vector<EQCurve>;
 
 #ifdef EXPERIMENTAL_EQ_SSE_THREADED
 class EffectEqualization48x;
+class FFTConvolutionKernel;
 #endif
 
 class EffectEqualization : public Effect,
@@ -149,8 +152,18 @@ private:
 
    bool ProcessOne(int count, WaveTrack * t,
                    sampleCount start, sampleCount len);
+   // Convolve the selection of t with the filter into output, which gets
+   // mM - 1 more samples.  Does not change this, so that tracks may be
+   // filtered on several threads.  progress gets the fraction done and
+   // returns false to stop.
+   bool FilterTrack(const std::shared_ptr<const FFTConvolutionKernel> &pKernel,
+                    const WaveTrack &t, sampleCount start, sampleCount len,
+                    WaveTrack &output,
+                    const std::function<bool(double)> &progress) const;
+   // Paste the filtered selection back into t, keeping its clips
+   void ReplaceFiltered(WaveTrack &t, sampleCount start, sampleCount len,
+                        const WaveTrack &output) const;
    bool CalcFilter();
-   void Filter(size_t len, float *buffer);
    
    void Flatten();
    void ForceRecalc();
@@ -208,7 +221,9 @@ private:
 private:
    int mOptions;
    HFFT hFFT;
-   Floats mFFTBuffer, mFilterFuncR, mFilterFuncI;
+   Floats mFilterFuncR, mFilterFuncI;
+   // The windowed impulse response, of length mM, that CalcFilter() makes
+   Floats mFilterImpulse;
    size_t mM;
    wxString mCurveName;
    bool mLin;
@@ -241,6 +256,7 @@ private:
    bool mBench;
    std::unique_ptr<EffectEqualization48x> mEffectEqualization48x;
    friend class EffectEqualization48x;
+class FFTConvolutionKernel;
 #endif
 
    wxSizer *szrC;
@@ -112,3 +112,23 @@ size_t EffectFade::ProcessBlock(float **inBlock, float **outBlock, size_t blockL
 
    return blockLen;
 }
+
+// Effect implementation
+
+std::unique_ptr<Effect> EffectFade::MakeParallelProcessor()
+{
+   return std::make_unique<EffectFade>(mFadeIn);
+}
+
+bool EffectFade::IsPointwise()
+{
+   return true;
+}
+
+void EffectFade::ProcessPointwise(float *buffer, size_t count, sampleCount pos)
+{
+   if (mFadeIn)
+      RampSamples(buffer, count, pos, 1, mSampleCnt);
+   else
+      RampSamples(buffer, count, mSampleCnt - 1 - pos, -1, mSampleCnt);
+}
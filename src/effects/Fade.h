@@ -36,6 +36,12 @@ public:
    bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
 
+   // Effect implementation
+
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
+   bool IsPointwise() override;
+   void ProcessPointwise(float *buffer, size_t count, sampleCount pos) override;
+
 private:
    // EffectFade implementation
 
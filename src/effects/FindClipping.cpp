@@ -198,6 +198,17 @@ bool EffectFindClipping::ProcessOne(LabelTrack * lt,
 
          block = limitSampleBufferSize( blockSize, len - s );
 
+         // Outside a run, a stretch without clipping changes nothing, and
+         // the block summaries can tell so without reading the samples
+         if (startrun == 0) {
+            auto pair = wt->GetSampleMinMax(start + s, block);
+            if (pair.second < MAX_AUDIO && pair.first > -MAX_AUDIO) {
+               s += block;
+               block = 0;
+               continue;
+            }
+         }
+
          wt->Get((samplePtr)buffer.get(), floatSample, start + s, block);
          ptr = buffer.get();
       }
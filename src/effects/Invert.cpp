@@ -82,3 +82,21 @@ size_t EffectInvert::ProcessBlock(float **inBlock, float **outBlock, size_t bloc
 
    return blockLen;
 }
+
+// Effect implementation
+
+std::unique_ptr<Effect> EffectInvert::MakeParallelProcessor()
+{
+   return std::make_unique<EffectInvert>();
+}
+
+bool EffectInvert::IsPointwise()
+{
+   return true;
+}
+
+void EffectInvert::ProcessPointwise(
+   float *buffer, size_t count, sampleCount WXUNUSED(pos))
+{
+   NegateSamples(buffer, count);
+}
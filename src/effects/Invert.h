@@ -38,6 +38,12 @@ public:
    unsigned GetAudioInCount() override;
    unsigned GetAudioOutCount() override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
+
+   // Effect implementation
+
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
+   bool IsPointwise() override;
+   void ProcessPointwise(float *buffer, size_t count, sampleCount pos) override;
 };
 
 #endif
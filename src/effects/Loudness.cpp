@@ -18,8 +18,12 @@
 #include "Loudness.h"
 
 #include <math.h>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 #include <wx/intl.h>
+#include <wx/utils.h>
 #include <wx/valgen.h>
 
 #include "../Internat.h"
@@ -186,6 +190,9 @@ bool EffectLoudness::Process()
    AllocBuffers();
    mProgressVal = 0;
 
+   // Find the selections first, so that they can all be measured at once
+   std::vector<WaveTrack*> tracks;
+   std::vector<Selection> selections;
    for(auto track : mOutputTracks->Selected<WaveTrack>()
        + (mStereoInd ? &Track::Any : &Track::IsLeader))
    {
@@ -193,41 +200,70 @@ bool EffectLoudness::Process()
       // PRL: No accounting for multiple channels ?
       double trackStart = track->GetStartTime();
       double trackEnd = track->GetEndTime();
+      double t0 = mT0 < trackStart? trackStart: mT0;
+      double t1 = mT1 > trackEnd? trackEnd: mT1;
+
+      auto range = mStereoInd
+         ? TrackList::SingletonRange(track)
+         : TrackList::Channels(track);
+
+      Selection selection;
+      for(auto channel : range)
+         selection.channels.push_back(channel);
+      selection.start = track->TimeToLongSamples(t0);
+      selection.end = track->TimeToLongSamples(t1);
+      tracks.push_back(track);
+      selections.push_back(std::move(selection));
+   }
+
+   std::vector<Measurement> measurements;
+   if(mNormalizeTo == kLoudness)
+   {
+      const auto msg = topMsg + XO("Analyzing...");
+      if(!Measure(selections, measurements,
+            [&](double fraction){ return !TotalProgress(fraction / 2, msg); }))
+      {
+         this->ReplaceProcessedTracks(false);
+         FreeBuffers();
+         return false;
+      }
+      mProgressVal = 0.5;
+   }
+
+   for(size_t ii = 0; ii < tracks.size(); ++ii)
+   {
+      auto track = tracks[ii];
+      double trackStart = track->GetStartTime();
+      double trackEnd = track->GetEndTime();
 
       // Set the current bounds to whichever left marker is
       // greater and whichever right marker is less:
       mCurT0 = mT0 < trackStart? trackStart: mT0;
       mCurT1 = mT1 > trackEnd? trackEnd: mT1;
 
+      // Abort if the right marker is not to the right of the left marker
+      if(mCurT1 <= mCurT0)
+      {
+         bGoodResult = false;
+         break;
+      }
+
       // Get the track rate
       mCurRate = track->GetRate();
 
-      wxString msg;
       auto trackName = track->GetName();
       mSteps = 2;
 
-      mProgressMsg =
-         topMsg + XO("Analyzing: %s").Format( trackName );
-
       auto range = mStereoInd
          ? TrackList::SingletonRange(track)
          : TrackList::Channels(track);
 
       mProcStereo = range.size() > 1;
 
-      if(mNormalizeTo == kLoudness)
-      {
-         mLoudnessProcessor.reset(safenew EBUR128(mCurRate, range.size()));
-         mLoudnessProcessor->Initialize();
-         if(!ProcessOne(range, true))
-         {
-            // Processing failed -> abort
-            bGoodResult = false;
-            break;
-         }
-      }
-      else // RMS
+      if(mNormalizeTo == kRMS)
       {
+         mProgressMsg =
+            topMsg + XO("Analyzing: %s").Format( trackName );
          size_t idx = 0;
          for(auto channel : range)
          {
@@ -244,7 +280,7 @@ bool EffectLoudness::Process()
       // Calculate normalization values the analysis results
       float extent;
       if(mNormalizeTo == kLoudness)
-         extent = mLoudnessProcessor->IntegrativeLoudness();
+         extent = measurements[ii].integrated;
       else // RMS
       {
          extent = mRMS[0];
@@ -255,7 +291,6 @@ bool EffectLoudness::Process()
 
       if(extent == 0.0)
       {
-         mLoudnessProcessor.reset();
          FreeBuffers();
          return false;
       }
@@ -273,7 +308,7 @@ bool EffectLoudness::Process()
       }
 
       mProgressMsg = topMsg + XO("Processing: %s").Format( trackName );
-      if(!ProcessOne(range, false))
+      if(!ProcessOne(range))
       {
          // Processing failed -> abort
          bGoodResult = false;
@@ -282,11 +317,110 @@ bool EffectLoudness::Process()
    }
 
    this->ReplaceProcessedTracks(bGoodResult);
-   mLoudnessProcessor.reset();
    FreeBuffers();
    return bGoodResult;
 }
 
+bool EffectLoudness::Measure(const std::vector<Selection> &selections,
+                             std::vector<Measurement> &measurements,
+                             const std::function<bool(double)> &progress)
+{
+   const auto nSelections = selections.size();
+   measurements.assign(nSelections, Measurement{});
+
+   // Progress counts the samples of every channel
+   double total = 0;
+   for(const auto &selection : selections)
+      if(selection.end > selection.start)
+         total += (selection.end - selection.start).as_double() *
+            selection.channels.size();
+
+   const auto nThreads = std::min<size_t>(nSelections,
+      std::max(1u, std::thread::hardware_concurrency()));
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::atomic<long long> samplesDone{ 0 };
+   std::atomic<bool> stopped{ false };
+   std::vector<std::exception_ptr> errors(nThreads);
+
+   // Each thread measures whole selections, one at a time
+   auto measure = [&](size_t ii) {
+      const auto &selection = selections[ii];
+      const auto nChannels = selection.channels.size();
+      const auto first = selection.channels[0];
+      EBUR128 processor(first->GetRate(), nChannels);
+      processor.Initialize();
+
+      size_t capacity = 0;
+      for(auto channel : selection.channels)
+         capacity = std::max(capacity, channel->GetMaxBlockSize());
+      std::vector<Floats> buffers(nChannels);
+      std::vector<const float*> pointers(nChannels);
+      for(size_t jj = 0; jj < nChannels; ++jj)
+      {
+         buffers[jj].reinit(capacity);
+         pointers[jj] = buffers[jj].get();
+      }
+
+      for(auto s = selection.start; s < selection.end;)
+      {
+         if(stopped.load())
+            return false;
+         const auto blockLen = limitSampleBufferSize(
+            limitSampleBufferSize(first->GetBestBlockSize(s), capacity),
+            selection.end - s);
+         for(size_t jj = 0; jj < nChannels; ++jj)
+            selection.channels[jj]->Get(
+               (samplePtr) buffers[jj].get(), floatSample, s, blockLen);
+         processor.ProcessBuffers(pointers.data(), blockLen);
+         samplesDone += blockLen * nChannels;
+         s += blockLen;
+      }
+
+      auto &measurement = measurements[ii];
+      measurement.integrated = processor.IntegrativeLoudness();
+      measurement.shortTerm = processor.MaxShortTermLoudness();
+      measurement.truePeak = processor.TruePeak();
+      return true;
+   };
+
+   {
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the tracks go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for(auto &thread : threads)
+            thread.join();
+      } );
+      for(size_t ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back( [&, ii]{
+            try {
+               for(size_t jj = 0;
+                   !stopped.load() && (jj = next++) < nSelections;)
+                  if(measure(jj))
+                     ++nDone;
+            }
+            catch(...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      while(nDone.load() < nSelections && !stopped.load())
+      {
+         if(!progress(total > 0 ? samplesDone.load() / total : 1.0))
+            stopped.store(true);
+         else
+            ::wxMilliSleep(10);
+      }
+   }
+   for(auto &error : errors)
+      if(error)
+         std::rethrow_exception(error);
+
+   return nDone.load() == nSelections;
+}
+
 void EffectLoudness::PopulateOrExchange(ShuttleGui & S)
 {
    S.StartVerticalLay(0);
@@ -423,9 +557,7 @@ bool EffectLoudness::GetTrackRMS(WaveTrack* track, float& rms)
 /// and executes ProcessData, on it...
 ///  uses mMult to normalize a track.
 ///  mMult must be set before this is called
-/// In analyse mode, it executes the selected analyse operation on it...
-///  mMult does not have to be set before this is called
-bool EffectLoudness::ProcessOne(TrackIterRange<WaveTrack> range, bool analyse)
+bool EffectLoudness::ProcessOne(TrackIterRange<WaveTrack> range)
 {
    WaveTrack* track = *range.begin();
 
@@ -458,17 +590,9 @@ bool EffectLoudness::ProcessOne(TrackIterRange<WaveTrack> range, bool analyse)
       LoadBufferBlock(range, s, blockLen);
 
       // Process the buffer.
-      if(analyse)
-      {
-         if(!AnalyseBufferBlock())
-            return false;
-      }
-      else
-      {
-         if(!ProcessBufferBlock())
-            return false;
-         StoreBufferBlock(range, s, blockLen);
-      }
+      if(!ProcessBufferBlock())
+         return false;
+      StoreBufferBlock(range, s, blockLen);
 
       // Increment s one blockfull of samples
       s += blockLen;
@@ -491,23 +615,6 @@ void EffectLoudness::LoadBufferBlock(TrackIterRange<WaveTrack> range,
    mTrackBufferLen = len;
 }
 
-/// Calculates sample sum (for DC) and EBU R128 weighted square sum
-/// (for loudness).
-bool EffectLoudness::AnalyseBufferBlock()
-{
-   for(size_t i = 0; i < mTrackBufferLen; i++)
-   {
-      mLoudnessProcessor->ProcessSampleFromChannel(mTrackBuffer[0][i], 0);
-      if(mProcStereo)
-         mLoudnessProcessor->ProcessSampleFromChannel(mTrackBuffer[1][i], 1);
-      mLoudnessProcessor->NextSample();
-   }
-
-   if(!UpdateProgress())
-      return false;
-   return true;
-}
-
 bool EffectLoudness::ProcessBufferBlock()
 {
    for(size_t i = 0; i < mTrackBufferLen; i++)
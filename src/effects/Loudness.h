@@ -11,6 +11,9 @@
 #ifndef __AUDACITY_EFFECT_LOUDNESS__
 #define __AUDACITY_EFFECT_LOUDNESS__
 
+#include <functional>
+#include <vector>
+
 #include <wx/checkbox.h>
 #include <wx/choice.h>
 #include <wx/event.h>
@@ -57,16 +60,41 @@ public:
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
 
-private:
    // EffectLoudness implementation
 
+   /// The channels of one track to be measured together, and the samples
+   struct Selection
+   {
+      std::vector<const WaveTrack*> channels;
+      sampleCount start;
+      sampleCount end;
+   };
+
+   /// EBU R128 statistics of one selection
+   struct Measurement
+   {
+      /// Gated integrated loudness, as a power; see EBUR128
+      double integrated;
+      /// Greatest short-term loudness, as a power
+      double shortTerm;
+      /// Greatest magnitude oversampled four times
+      double truePeak;
+   };
+
+   /// Measure all the selections at once, on worker threads, without
+   /// changing them.  progress is called on this thread with the fraction
+   /// done, and returns false to stop.
+   static bool Measure(const std::vector<Selection> &selections,
+                       std::vector<Measurement> &measurements,
+                       const std::function<bool(double)> &progress);
+
+private:
    void AllocBuffers();
    void FreeBuffers();
    bool GetTrackRMS(WaveTrack* track, float& rms);
-   bool ProcessOne(TrackIterRange<WaveTrack> range, bool analyse);
+   bool ProcessOne(TrackIterRange<WaveTrack> range);
    void LoadBufferBlock(TrackIterRange<WaveTrack> range,
                         sampleCount pos, size_t len);
-   bool AnalyseBufferBlock();
    bool ProcessBufferBlock();
    void StoreBufferBlock(TrackIterRange<WaveTrack> range,
                          sampleCount pos, size_t len);
@@ -94,7 +122,6 @@ private:
    float  mMult;
    float  mRatio;
    float  mRMS[2];
-   std::unique_ptr<EBUR128> mLoudnessProcessor;
 
    wxTextCtrl *mLevelTextCtrl;
    wxStaticText *mLeveldB;
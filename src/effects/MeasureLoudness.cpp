@@ -0,0 +1,126 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MeasureLoudness.cpp
+
+*******************************************************************//**
+
+\class EffectMeasureLoudness
+\brief An analyzer reporting the EBU R128 integrated and greatest
+short-term loudness, and the true peak, of the selected tracks, all
+measured at once, without changing them.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "MeasureLoudness.h"
+
+#include <math.h>
+
+#include <wx/intl.h>
+
+#include "EBUR128.h"
+#include "EffectManager.h"
+#include "LoadEffects.h"
+#include "Loudness.h"
+#include "../Track.h"
+#include "../WaveTrack.h"
+
+const ComponentInterfaceSymbol EffectMeasureLoudness::Symbol
+{ XO("Measure Loudness") };
+
+namespace{ BuiltinEffectsModule::Registration< EffectMeasureLoudness > reg; }
+
+EffectMeasureLoudness::EffectMeasureLoudness()
+{
+}
+
+EffectMeasureLoudness::~EffectMeasureLoudness()
+{
+}
+
+// ComponentInterface implementation
+
+ComponentInterfaceSymbol EffectMeasureLoudness::GetSymbol()
+{
+   return Symbol;
+}
+
+TranslatableString EffectMeasureLoudness::GetDescription()
+{
+   return XO("Measures the loudness and true peak of one or more tracks");
+}
+
+wxString EffectMeasureLoudness::ManualPage()
+{
+   return wxT("Loudness");
+}
+
+// EffectDefinitionInterface implementation
+
+EffectType EffectMeasureLoudness::GetType()
+{
+   return EffectTypeAnalyze;
+}
+
+bool EffectMeasureLoudness::IsInteractive()
+{
+   return false;
+}
+
+// Effect implementation
+
+bool EffectMeasureLoudness::Process()
+{
+   std::vector<const WaveTrack*> tracks;
+   std::vector<EffectLoudness::Selection> selections;
+   for(auto track : inputTracks()->Selected<const WaveTrack>()
+       + &Track::IsLeader)
+   {
+      double trackStart = track->GetStartTime();
+      double trackEnd = track->GetEndTime();
+      double t0 = mT0 < trackStart? trackStart: mT0;
+      double t1 = mT1 > trackEnd? trackEnd: mT1;
+      if(t1 <= t0)
+         continue;
+
+      EffectLoudness::Selection selection;
+      for(auto channel : TrackList::Channels(track))
+         selection.channels.push_back(channel);
+      selection.start = track->TimeToLongSamples(t0);
+      selection.end = track->TimeToLongSamples(t1);
+      tracks.push_back(track);
+      selections.push_back(std::move(selection));
+   }
+
+   std::vector<EffectLoudness::Measurement> measurements;
+   if(!EffectLoudness::Measure(selections, measurements,
+         [this](double fraction){ return !TotalProgress(fraction); }))
+      return false;
+
+   // Nothing changed, so there is nothing to undo
+   EffectManager::Get().SetSkipStateFlag(true);
+
+   if(tracks.empty())
+      return true;
+
+   TranslatableString report;
+   for(size_t ii = 0; ii < tracks.size(); ++ii)
+   {
+      const auto &measurement = measurements[ii];
+      // Loudness is a power, so 10 * log10, and the peak 20 * log10
+      report += XO(
+"%s:\n   Integrated loudness: %s LUFS\n   Maximum short-term loudness: %s LUFS\n   True peak: %s dBTP\n")
+         .Format(tracks[ii]->GetName(),
+            wxString::Format(wxT("%.1f"),
+               10 * log10(measurement.integrated)),
+            wxString::Format(wxT("%.1f"),
+               10 * log10(measurement.shortTerm)),
+            wxString::Format(wxT("%.1f"),
+               EBUR128::TruePeakToDBTP(measurement.truePeak)));
+   }
+   MessageBox(report, wxOK | wxCENTRE, XO("Loudness"));
+
+   return true;
+}
@@ -0,0 +1,38 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MeasureLoudness.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_EFFECT_MEASURE_LOUDNESS__
+#define __AUDACITY_EFFECT_MEASURE_LOUDNESS__
+
+#include "Effect.h"
+
+class EffectMeasureLoudness final : public Effect
+{
+public:
+   static const ComponentInterfaceSymbol Symbol;
+
+   EffectMeasureLoudness();
+   virtual ~EffectMeasureLoudness();
+
+   // ComponentInterface implementation
+
+   ComponentInterfaceSymbol GetSymbol() override;
+   TranslatableString GetDescription() override;
+   wxString ManualPage() override;
+
+   // EffectDefinitionInterface implementation
+
+   EffectType GetType() override;
+   bool IsInteractive() override;
+
+   // Effect implementation
+
+   bool Process() override;
+};
+
+#endif
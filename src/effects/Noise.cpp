@@ -18,6 +18,8 @@
 #include "LoadEffects.h"
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <wx/choice.h>
 #include <wx/intl.h>
@@ -69,6 +71,9 @@ EffectNoise::EffectNoise()
    SetLinearEffectFlag(true);
 
    y = z = buf0 = buf1 = buf2 = buf3 = buf4 = buf5 = buf6 = 0;
+
+   for (auto &word : mRandomState)
+      word = 0;
 }
 
 EffectNoise::~EffectNoise()
@@ -106,21 +111,66 @@ unsigned EffectNoise::GetAudioOutCount()
    return 1;
 }
 
+bool EffectNoise::ProcessInitialize(
+   sampleCount WXUNUSED(totalLen), ChannelNames WXUNUSED(chanMap))
+{
+   // Seed from rand(), as the noise used to come from it, making sure the
+   // state is not all zero
+   std::uint32_t any = 0;
+   for (auto &word : mRandomState) {
+      word = (std::uint32_t(rand()) << 16) ^ std::uint32_t(rand());
+      any |= word;
+   }
+   if (!any)
+      mRandomState[0] = 1;
+
+   return true;
+}
+
+void EffectNoise::FillWhite(float *buffer, size_t size)
+{
+   auto s0 = mRandomState[0], s1 = mRandomState[1],
+      s2 = mRandomState[2], s3 = mRandomState[3];
+   for (decltype(size) i = 0; i < size; i++)
+   {
+      // xoshiro128+; the high 23 bits are the best ones
+      const std::uint32_t result = s0 + s3;
+      const std::uint32_t t = s1 << 9;
+      s2 ^= s0;
+      s3 ^= s1;
+      s1 ^= s2;
+      s0 ^= s3;
+      s2 ^= t;
+      s3 = (s3 << 11) | (s3 >> 21);
+
+      // Make a float in [2, 4) from the bits, then shift it to [-1, 1)
+      const std::uint32_t bits = (result >> 9) | 0x40000000u;
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      buffer[i] = value - 3.0f;
+   }
+   mRandomState[0] = s0, mRandomState[1] = s1,
+      mRandomState[2] = s2, mRandomState[3] = s3;
+}
+
 size_t EffectNoise::ProcessBlock(float **WXUNUSED(inbuf), float **outbuf, size_t size)
 {
    float *buffer = outbuf[0];
 
    float white;
    float amplitude;
-   float div = ((float) RAND_MAX) / 2.0f;
+
+   // Make the white noise for the whole block first, then shape it in place
+   FillWhite(buffer, size);
 
    switch (mType)
    {
    default:
    case kWhite: // white
+       amplitude = mAmp;
        for (decltype(size) i = 0; i < size; i++)
        {
-          buffer[i] = mAmp * ((rand() / div) - 1.0f);
+          buffer[i] *= amplitude;
        }
        break;
 
@@ -131,7 +181,7 @@ size_t EffectNoise::ProcessBlock(float **WXUNUSED(inbuf), float **outbuf, size_t
       amplitude = mAmp * 0.129f;
       for (decltype(size) i = 0; i < size; i++)
       {
-         white = (rand() / div) - 1.0f;
+         white = buffer[i];
          buf0 = 0.99886f * buf0 + 0.0555179f * white;
          buf1 = 0.99332f * buf1 + 0.0750759f * white;
          buf2 = 0.96900f * buf2 + 0.1538520f * white;
@@ -158,7 +208,7 @@ size_t EffectNoise::ProcessBlock(float **WXUNUSED(inbuf), float **outbuf, size_t
  
       for (decltype(size) i = 0; i < size; i++)
       {
-         white = (rand() / div) - 1.0f;
+         white = buffer[i];
          z = leakage * y + white * scaling;
          y = fabs(z) > 1.0
             ? leakage * y - white * scaling
@@ -15,6 +15,8 @@
 
 #include "Effect.h"
 
+#include <cstdint>
+
 class NumericTextCtrl;
 class ShuttleGui;
 
@@ -39,6 +41,7 @@ public:
    // EffectClientInterface implementation
 
    unsigned GetAudioOutCount() override;
+   bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
    bool DefineParams( ShuttleParams & S ) override;
    bool GetAutomationParameters(CommandParameters & parms) override;
@@ -54,12 +57,18 @@ public:
 private:
    // EffectNoise implementation
 
+   // Fill the buffer with uniform white noise in [-1, 1)
+   void FillWhite(float *buffer, size_t size);
+
 private:
    int mType;
    double mAmp;
 
    float y, z, buf0, buf1, buf2, buf3, buf4, buf5, buf6;
 
+   // State of the xoshiro128+ generator, which is much cheaper than rand()
+   std::uint32_t mRandomState[4];
+
    NumericTextCtrl *mNoiseDurationT;
 };
 
@@ -50,11 +50,17 @@
 #include "../Prefs.h"
 #include "../RealFFTf.h"
 
+#include "../WaveClip.h"
 #include "../WaveTrack.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/valnum.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <thread>
 #include <vector>
 #include <math.h>
 
@@ -71,6 +77,18 @@
 #include <wx/valtext.h>
 #include <wx/textctrl.h>
 #include <wx/sizer.h>
+#include <wx/utils.h>
+
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_KERNELS
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
 
 // SPECTRAL_SELECTION not to affect this effect for now, as there might be no indication that it does.
 // [Discussed and agreed for v2.1 by Steve, Paul, Bill].
@@ -160,6 +178,239 @@ enum  NoiseReductionChoice {
    NRC_LEAVE_RESIDUE,
 };
 
+// Kernels for the loops over frequency bands.  Each is written once, in
+// terms of the overloads below for a vector of bands and for one band, which
+// finishes the remainder.  All give the same results, bit for bit, as the
+// loops over single bands did.
+
+#if defined(USE_SSE2_KERNELS)
+using VFloat = __m128;
+using VMask = __m128;
+enum : size_t { VLanes = 4 };
+#elif defined(USE_NEON_KERNELS)
+using VFloat = float32x4_t;
+using VMask = uint32x4_t;
+enum : size_t { VLanes = 4 };
+#else
+using VFloat = float;
+using VMask = bool;
+enum : size_t { VLanes = 1 };
+#endif
+
+template< typename V > V Load(const float *p);
+template< typename V > V Splat(float x);
+
+template<> inline float Load<float>(const float *p) { return *p; }
+template<> inline float Splat<float>(float x) { return x; }
+inline void Store(float *p, float x) { *p = x; }
+inline void StoreInterleaved(float *p, float x, float y)
+{
+   p[0] = x;
+   p[1] = y;
+}
+inline float Add(float x, float y) { return x + y; }
+inline float Mul(float x, float y) { return x * y; }
+inline float Div(float x, float y) { return x / y; }
+inline float Max(float x, float y) { return std::max(x, y); }
+inline float Min(float x, float y) { return std::min(x, y); }
+inline bool Less(float x, float y) { return x < y; }
+inline bool LessEqual(float x, float y) { return x <= y; }
+inline float Select(bool mask, float x, float y) { return mask ? x : y; }
+inline bool Any(bool mask) { return mask; }
+
+#if defined(USE_SSE2_KERNELS)
+template<> inline VFloat Load<VFloat>(const float *p) { return _mm_loadu_ps(p); }
+template<> inline VFloat Splat<VFloat>(float x) { return _mm_set1_ps(x); }
+inline void Store(float *p, VFloat x) { _mm_storeu_ps(p, x); }
+inline void StoreInterleaved(float *p, VFloat x, VFloat y)
+{
+   _mm_storeu_ps(p, _mm_unpacklo_ps(x, y));
+   _mm_storeu_ps(p + 4, _mm_unpackhi_ps(x, y));
+}
+inline VFloat Add(VFloat x, VFloat y) { return _mm_add_ps(x, y); }
+inline VFloat Mul(VFloat x, VFloat y) { return _mm_mul_ps(x, y); }
+inline VFloat Div(VFloat x, VFloat y) { return _mm_div_ps(x, y); }
+inline VFloat Max(VFloat x, VFloat y) { return _mm_max_ps(x, y); }
+inline VFloat Min(VFloat x, VFloat y) { return _mm_min_ps(x, y); }
+inline VMask Less(VFloat x, VFloat y) { return _mm_cmplt_ps(x, y); }
+inline VMask LessEqual(VFloat x, VFloat y) { return _mm_cmple_ps(x, y); }
+inline VFloat Select(VMask mask, VFloat x, VFloat y)
+{ return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y)); }
+inline bool Any(VMask mask) { return _mm_movemask_ps(mask) != 0; }
+#elif defined(USE_NEON_KERNELS)
+template<> inline VFloat Load<VFloat>(const float *p) { return vld1q_f32(p); }
+template<> inline VFloat Splat<VFloat>(float x) { return vdupq_n_f32(x); }
+inline void Store(float *p, VFloat x) { vst1q_f32(p, x); }
+inline void StoreInterleaved(float *p, VFloat x, VFloat y)
+{ vst2q_f32(p, (float32x4x2_t{ { x, y } })); }
+inline VFloat Add(VFloat x, VFloat y) { return vaddq_f32(x, y); }
+inline VFloat Mul(VFloat x, VFloat y) { return vmulq_f32(x, y); }
+inline VFloat Div(VFloat x, VFloat y) { return vdivq_f32(x, y); }
+inline VFloat Max(VFloat x, VFloat y) { return vmaxq_f32(x, y); }
+inline VFloat Min(VFloat x, VFloat y) { return vminq_f32(x, y); }
+inline VMask Less(VFloat x, VFloat y) { return vcltq_f32(x, y); }
+inline VMask LessEqual(VFloat x, VFloat y) { return vcleq_f32(x, y); }
+inline VFloat Select(VMask mask, VFloat x, VFloat y)
+{ return vbslq_f32(mask, x, y); }
+inline bool Any(VMask mask) { return vmaxvq_u32(mask) != 0; }
+#endif
+
+// out[ii] = x[ii] * y[ii]
+template< typename V >
+inline void MultiplyStep(const float *x, const float *y, float *out, size_t ii)
+{
+   Store(out + ii, Mul(Load<V>(x + ii), Load<V>(y + ii)));
+}
+
+void Multiply(const float *x, const float *y, float *out, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + VLanes <= len; ii += VLanes)
+      MultiplyStep<VFloat>(x, y, out, ii);
+   for (; ii < len; ++ii)
+      MultiplyStep<float>(x, y, out, ii);
+}
+
+// sums[ii] += x[ii]
+template< typename V >
+inline void AccumulateStep(const float *x, float *sums, size_t ii)
+{
+   Store(sums + ii, Add(Load<V>(sums + ii), Load<V>(x + ii)));
+}
+
+void Accumulate(const float *x, float *sums, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + VLanes <= len; ii += VLanes)
+      AccumulateStep<VFloat>(x, sums, ii);
+   for (; ii < len; ++ii)
+      AccumulateStep<float>(x, sums, ii);
+}
+
+// power[ii] = real[ii]^2 + imag[ii]^2
+template< typename V >
+inline void PowerStep(
+   const float *real, const float *imag, float *power, size_t ii)
+{
+   const auto re = Load<V>(real + ii);
+   const auto im = Load<V>(imag + ii);
+   Store(power + ii, Add(Mul(re, re), Mul(im, im)));
+}
+
+void ComputePower(
+   const float *real, const float *imag, float *power, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + VLanes <= len; ii += VLanes)
+      PowerStep<VFloat>(real, imag, power, ii);
+   for (; ii < len; ++ii)
+      PowerStep<float>(real, imag, power, ii);
+}
+
+// Interleave real[ii] * gains[ii] and imag[ii] * gains[ii] into out
+template< typename V >
+inline void ApplyGainsStep(const float *gains,
+   const float *real, const float *imag, float *out, size_t ii)
+{
+   const auto gain = Load<V>(gains + ii);
+   StoreInterleaved(out + 2 * ii,
+      Mul(Load<V>(real + ii), gain), Mul(Load<V>(imag + ii), gain));
+}
+
+void ApplyGains(const float *gains,
+   const float *real, const float *imag, float *out, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + VLanes <= len; ii += VLanes)
+      ApplyGainsStep<VFloat>(gains, real, imag, out, ii);
+   for (; ii < len; ++ii)
+      ApplyGainsStep<float>(gains, real, imag, out, ii);
+}
+
+// Raise each of gains to the decay of the corresponding one of from, but not
+// below floor; return whether any changed
+template< typename V >
+inline bool PropagateStep(const float *from, float *gains,
+   float factor, float floor, size_t ii)
+{
+   const auto gain = Load<V>(gains + ii);
+   const auto minimum =
+      Max(Splat<V>(floor), Mul(Load<V>(from + ii), Splat<V>(factor)));
+   Store(gains + ii, Max(gain, minimum));
+   return Any(Less(gain, minimum));
+}
+
+bool PropagateGains(const float *from, float *gains,
+   float factor, float floor, size_t len)
+{
+   bool changed = false;
+   size_t ii = 0;
+   for (; ii + VLanes <= len; ii += VLanes)
+      changed = PropagateStep<VFloat>(from, gains, factor, floor, ii)
+         || changed;
+   for (; ii < len; ++ii)
+      changed = PropagateStep<float>(from, gains, factor, floor, ii)
+         || changed;
+   return changed;
+}
+
+// Classify bands as noise when the second (or third) greatest power among
+// the rows is at most the threshold.  Noise keeps its gain and other bands
+// get 1, or, if isolating, noise gets 1 and other bands 0.
+template< typename V >
+inline void ClassifyStep(const float *const *rows, unsigned nRows,
+   bool useThird, const float *thresholds, bool isolate, float *gains,
+   size_t ii)
+{
+   auto greatest = Splat<V>(0), second = greatest, third = greatest;
+   for (unsigned jj = 0; jj < nRows; ++jj) {
+      // Equivalent to the comparisons in Classify(), for powers, which are
+      // not negative
+      const auto power = Load<V>(rows[jj] + ii);
+      third = Max(third, Min(second, power));
+      second = Max(second, Min(greatest, power));
+      greatest = Max(greatest, power);
+   }
+   const auto isNoise =
+      LessEqual(useThird ? third : second, Load<V>(thresholds + ii));
+   if (isolate)
+      Store(gains + ii, Select(isNoise, Splat<V>(1), Splat<V>(0)));
+   else
+      Store(gains + ii, Select(isNoise, Load<V>(gains + ii), Splat<V>(1)));
+}
+
+void ClassifyBands(const float *const *rows, unsigned nRows, bool useThird,
+   const float *thresholds, bool isolate, float *gains, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + VLanes <= len; ii += VLanes)
+      ClassifyStep<VFloat>(
+         rows, nRows, useThird, thresholds, isolate, gains, ii);
+   for (; ii < len; ++ii)
+      ClassifyStep<float>(
+         rows, nRows, useThird, thresholds, isolate, gains, ii);
+}
+
+// out[ii] is the mean of the 2 * radius + 1 values of x centered at ii, summed
+// in order; for ii in [radius, len - radius)
+template< typename V >
+inline void BoxMeanStep(const float *x, size_t radius, float *out, size_t ii)
+{
+   auto sum = Splat<V>(0);
+   for (size_t jj = ii - radius, end = ii + radius; jj <= end; ++jj)
+      sum = Add(sum, Load<V>(x + jj));
+   Store(out + ii, Div(sum, Splat<V>(2 * radius + 1)));
+}
+
+void BoxMean(const float *x, size_t radius, float *out, size_t len)
+{
+   size_t ii = radius;
+   for (; ii + radius + VLanes <= len; ii += VLanes)
+      BoxMeanStep<VFloat>(x, radius, out, ii);
+   for (; ii + radius < len; ++ii)
+      BoxMeanStep<float>(x, radius, out, ii);
+}
+
 } // namespace
 
 //----------------------------------------------------------------------------
@@ -272,11 +523,42 @@ public:
                 TrackList &tracks, double mT0, double mT1);
 
 private:
+   // A selected range of one track, to be reduced
+   struct Selection {
+      WaveTrack *track;
+      int count;
+      sampleCount start;
+      sampleCount len;
+   };
+
+   // A part of a selection that one thread reduces.  All but the first
+   // part of the selection read some samples before it, so that the
+   // history windows are warmed up as if the whole selection were reduced
+   // at once; all but the last read some samples past it, for lookahead.
+   struct Segment {
+      const Selection *pSelection;
+      sampleCount start; // first output sample
+      sampleCount end;   // past the last output sample
+      sampleCount readStart;
+      sampleCount readEnd;
+      WaveTrack::Holder outputTrack;
+   };
+
    bool ProcessOne(EffectNoiseReduction &effect,
                    Statistics &statistics,
                    TrackFactory &factory,
                    int count, WaveTrack *track,
                    sampleCount start, sampleCount len);
+   bool ProcessInParallel(EffectNoiseReduction &effect,
+                          Statistics &statistics,
+                          const std::vector<Selection> &selections,
+                          unsigned nThreads);
+   bool ProcessSegment(Statistics &statistics, Segment &segment,
+                       const std::atomic<bool> &stopped,
+                       std::atomic<long long> &samplesRead);
+   unsigned SegmentWarmUpSteps() const;
+   static void ReplaceSelection(WaveTrack &track, WaveTrack &outputTrack,
+                                sampleCount start, sampleCount len);
 
    void StartNewTrack();
    void ProcessSamples(Statistics &statistics,
@@ -285,13 +567,22 @@ private:
    void ApplyFreqSmoothing(FloatVector &gains);
    void GatherStatistics(Statistics &statistics);
    inline bool Classify(const Statistics &statistics, int band);
+   void ComputeThresholds(const Statistics &statistics);
    void ReduceNoise(const Statistics &statistics, WaveTrack *outputTrack);
    void RotateHistoryWindows();
    void FinishTrackStatistics(Statistics &statistics);
    void FinishTrack(Statistics &statistics, WaveTrack *outputTrack);
+   void AppendOutput(WaveTrack *outputTrack, const float *buffer);
 
 private:
 
+   // To make more workers alike, one for each thread
+   const Settings &mSettings;
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+   const double mF0;
+   const double mF1;
+#endif
+
    const bool mDoProfile;
 
    const double mSampleRate;
@@ -318,11 +609,19 @@ private:
    const size_t mStepSize;
    const int mMethod;
    const double mNewSensitivity;
+   // For each band, the greatest float not above the product of
+   // mNewSensitivity and the mean, so that floats compare with it as with
+   // the product; empty if Classify() must decide band by band
+   FloatVector mThresholds;
+   std::vector<const float*> mSpectrumRows;
 
 
    sampleCount       mInSampleCount;
    sampleCount       mOutStepCount;
    int                   mInWavePos;
+   // Output samples still to discard, then still to keep
+   sampleCount       mOutSkip;
+   sampleCount       mOutLimit;
 
    float     mOneBlockAttack;
    float     mOneBlockRelease;
@@ -672,6 +971,7 @@ bool EffectNoiseReduction::Worker::Process
 (EffectNoiseReduction &effect, Statistics &statistics, TrackFactory &factory,
  TrackList &tracks, double inT0, double inT1)
 {
+   std::vector<Selection> selections;
    int count = 0;
    for ( auto track : tracks.Selected< WaveTrack >() ) {
       if (track->GetRate() != mSampleRate) {
@@ -695,14 +995,29 @@ bool EffectNoiseReduction::Worker::Process
          auto end = track->TimeToLongSamples(t1);
          auto len = end - start;
 
-         if (!ProcessOne(effect, statistics, factory,
+         if (!mDoProfile)
+            // Reduce noise later, when all selections are checked
+            selections.push_back( { track, count, start, len } );
+         else if (!ProcessOne(effect, statistics, factory,
                          count, track, start, len))
             return false;
       }
       ++count;
    }
 
-   if (mDoProfile) {
+   if (!mDoProfile) {
+      // Profiling sums statistics in the order of tracks, so it stays on
+      // this thread, but tracks are reduced independently
+      const auto nThreads = std::max(1u, std::thread::hardware_concurrency());
+      if (nThreads > 1)
+         return ProcessInParallel(effect, statistics, selections, nThreads);
+      for (const auto &selection : selections)
+         if (!ProcessOne(effect, statistics, factory,
+                         selection.count, selection.track,
+                         selection.start, selection.len))
+            return false;
+   }
+   else {
       if (statistics.mTotalWindows == 0) {
          effect.Effect::MessageBox(
             XO("Selected noise profile is too short.") );
@@ -722,22 +1037,26 @@ void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
    if (mFreqSmoothingBins == 0)
       return;
 
-   {
-      float *pScratch = &mFreqSmoothingScratch[0];
-      std::fill(pScratch, pScratch + mSpectrumSize, 0.0f);
-   }
-
    for (size_t ii = 0; ii < mSpectrumSize; ++ii)
       gains[ii] = log(gains[ii]);
 
+   // Bands with all the neighbors
+   BoxMean(&gains[0], mFreqSmoothingBins, &mFreqSmoothingScratch[0],
+      mSpectrumSize);
+
    // ii must be signed
    for (int ii = 0; ii < (int)mSpectrumSize; ++ii) {
       const int j0 = std::max(0, ii - (int)mFreqSmoothingBins);
       const int j1 = std::min(mSpectrumSize - 1, ii + mFreqSmoothingBins);
+      if (j0 == ii - (int)mFreqSmoothingBins &&
+          j1 == ii + (int)mFreqSmoothingBins)
+         // Done above
+         continue;
+      float sum = 0;
       for(int jj = j0; jj <= j1; ++jj) {
-         mFreqSmoothingScratch[ii] += gains[jj];
+         sum += gains[jj];
       }
-      mFreqSmoothingScratch[ii] /= (j1 - j0 + 1);
+      mFreqSmoothingScratch[ii] = sum / (j1 - j0 + 1);
    }
 
    for (size_t ii = 0; ii < mSpectrumSize; ++ii)
@@ -750,7 +1069,13 @@ EffectNoiseReduction::Worker::Worker
 , double f0, double f1
 #endif
 )
-: mDoProfile(settings.mDoProfile)
+: mSettings(settings)
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+, mF0(f0)
+, mF1(f1)
+#endif
+
+, mDoProfile(settings.mDoProfile)
 
 , mSampleRate(sampleRate)
 
@@ -779,6 +1104,8 @@ EffectNoiseReduction::Worker::Worker
 , mInSampleCount(0)
 , mOutStepCount(0)
 , mInWavePos(0)
+, mOutSkip(0)
+, mOutLimit(0)
 {
 #ifdef EXPERIMENTAL_SPECTRAL_EDITING
    {
@@ -969,8 +1296,7 @@ void EffectNoiseReduction::Worker::FillFirstHistoryWindow()
 {
    // Transform samples to frequency domain, windowed as needed
    if (mInWindow.size() > 0)
-      for (size_t ii = 0; ii < mWindowSize; ++ii)
-         mFFTBuffer[ii] = mInWaveBuffer[ii] * mInWindow[ii];
+      Multiply(&mInWaveBuffer[0], &mInWindow[0], &mFFTBuffer[0], mWindowSize);
    else
       memmove(&mFFTBuffer[0], &mInWaveBuffer[0], mWindowSize * sizeof(float));
    RealFFTf(&mFFTBuffer[0], hFFT.get());
@@ -982,15 +1308,15 @@ void EffectNoiseReduction::Worker::FillFirstHistoryWindow()
    {
       float *pReal = &record.mRealFFTs[1];
       float *pImag = &record.mImagFFTs[1];
-      float *pPower = &record.mSpectrums[1];
       int *pBitReversed = &hFFT->BitReversed[1];
       const auto last = mSpectrumSize - 1;
       for (unsigned int ii = 1; ii < last; ++ii) {
          const int kk = *pBitReversed++;
-         const float realPart = *pReal++ = mFFTBuffer[kk];
-         const float imagPart = *pImag++ = mFFTBuffer[kk + 1];
-         *pPower++ = realPart * realPart + imagPart * imagPart;
+         *pReal++ = mFFTBuffer[kk];
+         *pImag++ = mFFTBuffer[kk + 1];
       }
+      ComputePower(&record.mRealFFTs[1], &record.mImagFFTs[1],
+         &record.mSpectrums[1], last - 1);
       // DC and Fs/2 bins need to be handled specially
       const float dc = mFFTBuffer[0];
       record.mRealFFTs[0] = dc;
@@ -1044,7 +1370,7 @@ void EffectNoiseReduction::Worker::FinishTrack
    // were input.
    // Well, not exactly, but not more than one step-size of extra samples
    // at the end.
-   // We'll DELETE them later in ProcessOne.
+   // AppendOutput discards them.
 
    FloatVector empty(mStepSize);
 
@@ -1053,17 +1379,32 @@ void EffectNoiseReduction::Worker::FinishTrack
    }
 }
 
+void EffectNoiseReduction::Worker::AppendOutput
+(WaveTrack *outputTrack, const float *buffer)
+{
+   // Discard the warm-up of a segment, and anything past the end
+   size_t len = mStepSize;
+   if (mOutSkip > 0) {
+      const auto skip = limitSampleBufferSize(len, mOutSkip);
+      buffer += skip;
+      len -= skip;
+      mOutSkip -= skip;
+   }
+   len = limitSampleBufferSize(len, mOutLimit);
+   if (len > 0) {
+      outputTrack->Append((samplePtr)buffer, floatSample, len);
+      mOutLimit -= len;
+   }
+}
+
 void EffectNoiseReduction::Worker::GatherStatistics(Statistics &statistics)
 {
    ++statistics.mTrackWindows;
 
    {
       // NEW statistics
-      const float *pPower = &mQueue[0]->mSpectrums[0];
-      float *pSum = &statistics.mSums[0];
-      for (size_t jj = 0; jj < mSpectrumSize; ++jj) {
-         *pSum++ += *pPower++;
-      }
+      Accumulate(&mQueue[0]->mSpectrums[0], &statistics.mSums[0],
+         mSpectrumSize);
    }
 
 #ifdef OLD_METHOD_AVAILABLE
@@ -1088,6 +1429,32 @@ void EffectNoiseReduction::Worker::GatherStatistics(Statistics &statistics)
 #endif
 }
 
+void EffectNoiseReduction::Worker::ComputeThresholds
+(const Statistics &statistics)
+{
+   mThresholds.clear();
+   // The methods that ClassifyBands() implements
+   if (!(mMethod == DM_SECOND_GREATEST ||
+         (mMethod == DM_MEDIAN &&
+          (mNWindowsToExamine == 3 || mNWindowsToExamine == 5))))
+      return;
+
+   mThresholds.resize(mSpectrumSize);
+   mSpectrumRows.resize(mNWindowsToExamine);
+   for (size_t jj = 0; jj < mSpectrumSize; ++jj) {
+      const double threshold = mNewSensitivity * statistics.mMeans[jj];
+      float &rounded = mThresholds[jj];
+      if (threshold >= std::numeric_limits<float>::max())
+         rounded = std::numeric_limits<float>::max();
+      else {
+         rounded = threshold;
+         if (rounded > threshold)
+            rounded = std::nextafter(
+               rounded, -std::numeric_limits<float>::max());
+      }
+   }
+}
+
 // Return true iff the given band of the "center" window looks like noise.
 // Examine the band in a few neighboring windows to decide.
 inline
@@ -1166,28 +1533,30 @@ void EffectNoiseReduction::Worker::ReduceNoise
    // or, if isolating noise, zero out the non-noise
    {
       float *pGain = &mQueue[mCenter]->mGains[0];
-      if (mNoiseReductionChoice == NRC_ISOLATE_NOISE) {
-         // All above or below the selected frequency range is non-noise
-         std::fill(pGain, pGain + mBinLow, 0.0f);
-         std::fill(pGain + mBinHigh, pGain + mSpectrumSize, 0.0f);
-         pGain += mBinLow;
-         for (int jj = mBinLow; jj < mBinHigh; ++jj) {
-               const bool isNoise = Classify(statistics, jj);
-            *pGain++ = isNoise ? 1.0 : 0.0;
-         }
-      }
-      else {
-         // All above or below the selected frequency range is non-noise
-         std::fill(pGain, pGain + mBinLow, 1.0f);
-         std::fill(pGain + mBinHigh, pGain + mSpectrumSize, 1.0f);
-         pGain += mBinLow;
+      const bool isolate = mNoiseReductionChoice == NRC_ISOLATE_NOISE;
+      // All above or below the selected frequency range is non-noise
+      const float nonNoise = isolate ? 0.0f : 1.0f;
+      std::fill(pGain, pGain + mBinLow, nonNoise);
+      std::fill(pGain + mBinHigh, pGain + mSpectrumSize, nonNoise);
+      pGain += mBinLow;
+      if (mThresholds.empty()) {
          for (int jj = mBinLow; jj < mBinHigh; ++jj) {
             const bool isNoise = Classify(statistics, jj);
-            if (!isNoise) 
+            if (isolate)
+               *pGain = isNoise ? 1.0 : 0.0;
+            else if (!isNoise)
                *pGain = 1.0;
             ++pGain;
          }
       }
+      else {
+         // The same, for many bands at once
+         for (unsigned ii = 0; ii < mNWindowsToExamine; ++ii)
+            mSpectrumRows[ii] = &mQueue[ii]->mSpectrums[mBinLow];
+         ClassifyBands(&mSpectrumRows[0], mNWindowsToExamine,
+            mMethod == DM_MEDIAN && mNWindowsToExamine == 5,
+            &mThresholds[mBinLow], isolate, pGain, mBinHigh - mBinLow);
+      }
    }
 
    if (mNoiseReductionChoice != NRC_ISOLATE_NOISE)
@@ -1197,36 +1566,25 @@ void EffectNoiseReduction::Worker::ReduceNoise
       // the decay curve, and their prior values.
 
       // First, the attack, which goes backward in time, which is,
-      // toward higher indices in the queue.
-      for (size_t jj = 0; jj < mSpectrumSize; ++jj) {
-         for (unsigned ii = mCenter + 1; ii < mHistoryLen; ++ii) {
-            const float minimum =
-               std::max(mNoiseAttenFactor,
-                        mQueue[ii - 1]->mGains[jj] * mOneBlockAttack);
-            float &gain = mQueue[ii]->mGains[jj];
-            if (gain < minimum)
-               gain = minimum;
-            else
-               // We can stop now, our attack curve is intersecting
-               // the decay curve of some window previously processed.
-               break;
-         }
+      // toward higher indices in the queue.  Windows are visited in turn
+      // for all bands; a band whose gain does not change would not change
+      // in any earlier window either, its decay curve already being above.
+      for (unsigned ii = mCenter + 1; ii < mHistoryLen; ++ii) {
+         if (!PropagateGains(&mQueue[ii - 1]->mGains[0],
+               &mQueue[ii]->mGains[0],
+               mOneBlockAttack, mNoiseAttenFactor, mSpectrumSize))
+            // We can stop now, our attack curve is intersecting
+            // the decay curve of some window previously processed,
+            // in all bands.
+            break;
       }
 
       // Now, release.  We need only look one window ahead.  This part will
       // be visited again when we examine the next window, and
       // carry the decay further.
-      {
-         float *pNextGain = &mQueue[mCenter - 1]->mGains[0];
-         const float *pThisGain = &mQueue[mCenter]->mGains[0];
-         for (int nn = mSpectrumSize; nn--;) {
-            *pNextGain =
-               std::max(*pNextGain,
-                        std::max(mNoiseAttenFactor,
-                                 *pThisGain++ * mOneBlockRelease));
-            ++pNextGain;
-         }
-      }
+      PropagateGains(&mQueue[mCenter]->mGains[0],
+         &mQueue[mCenter - 1]->mGains[0],
+         mOneBlockRelease, mNoiseAttenFactor, mSpectrumSize);
    }
 
 
@@ -1239,8 +1597,18 @@ void EffectNoiseReduction::Worker::ReduceNoise
          // Gains are not less than mNoiseAttenFactor
          ApplyFreqSmoothing(record.mGains);
 
+      // A window that the gains remove entirely, such as one with no noise
+      // when isolating noise or leaving the residue, or one outside the
+      // spectral selection, adds nothing to the overlap:  skip its inverse
+      // transform
+      const float silentGain =
+         mNoiseReductionChoice == NRC_LEAVE_RESIDUE ? 1.0f : 0.0f;
+      const bool silent = std::all_of(
+         record.mGains.begin(), record.mGains.end(),
+         [silentGain](float gain){ return gain == silentGain; });
+
       // Apply gain to FFT
-      {
+      if (!silent) {
          const float *pGain = &record.mGains[1];
          const float *pReal = &record.mRealFFTs[1];
          const float *pImag = &record.mImagFFTs[1];
@@ -1259,45 +1627,45 @@ void EffectNoiseReduction::Worker::ReduceNoise
             mFFTBuffer[1] = record.mImagFFTs[0] * (record.mGains[last] - 1.0);
          }
          else {
-            for (; nn--;) {
-               const double gain = *pGain++;
-               *pBuffer++ = *pReal++ * gain;
-               *pBuffer++ = *pImag++ * gain;
-            }
+            // Products of floats are exact in double, so it does not
+            // matter that these are not
+            ApplyGains(pGain, pReal, pImag, pBuffer, nn);
             mFFTBuffer[0] = record.mRealFFTs[0] * record.mGains[0];
             // The Fs/2 component is stored as the imaginary part of the DC component
             mFFTBuffer[1] = record.mImagFFTs[0] * record.mGains[last];
          }
       }
 
-      // Invert the FFT into the output buffer
-      InverseRealFFTf(&mFFTBuffer[0], hFFT.get());
-
-      // Overlap-add
-      if (mOutWindow.size() > 0) {
-         float *pOut = &mOutOverlapBuffer[0];
-         float *pWindow = &mOutWindow[0];
-         int *pBitReversed = &hFFT->BitReversed[0];
-         for (unsigned int jj = 0; jj < last; ++jj) {
-            int kk = *pBitReversed++;
-            *pOut++ += mFFTBuffer[kk] * (*pWindow++);
-            *pOut++ += mFFTBuffer[kk + 1] * (*pWindow++);
+      if (!silent) {
+         // Invert the FFT into the output buffer
+         InverseRealFFTf(&mFFTBuffer[0], hFFT.get());
+
+         // Overlap-add
+         if (mOutWindow.size() > 0) {
+            float *pOut = &mOutOverlapBuffer[0];
+            float *pWindow = &mOutWindow[0];
+            int *pBitReversed = &hFFT->BitReversed[0];
+            for (unsigned int jj = 0; jj < last; ++jj) {
+               int kk = *pBitReversed++;
+               *pOut++ += mFFTBuffer[kk] * (*pWindow++);
+               *pOut++ += mFFTBuffer[kk + 1] * (*pWindow++);
+            }
          }
-      }
-      else {
-         float *pOut = &mOutOverlapBuffer[0];
-         int *pBitReversed = &hFFT->BitReversed[0];
-         for (unsigned int jj = 0; jj < last; ++jj) {
-            int kk = *pBitReversed++;
-            *pOut++ += mFFTBuffer[kk];
-            *pOut++ += mFFTBuffer[kk + 1];
+         else {
+            float *pOut = &mOutOverlapBuffer[0];
+            int *pBitReversed = &hFFT->BitReversed[0];
+            for (unsigned int jj = 0; jj < last; ++jj) {
+               int kk = *pBitReversed++;
+               *pOut++ += mFFTBuffer[kk];
+               *pOut++ += mFFTBuffer[kk + 1];
+            }
          }
       }
 
       float *buffer = &mOutOverlapBuffer[0];
       if (mOutStepCount >= 0) {
          // Output the first portion of the overlap buffer, they're done
-         outputTrack->Append((samplePtr)buffer, floatSample, mStepSize);
+         AppendOutput(outputTrack, buffer);
       }
 
       // Shift the remainder over.
@@ -1314,6 +1682,10 @@ bool EffectNoiseReduction::Worker::ProcessOne
       return false;
 
    StartNewTrack();
+   mOutSkip = 0;
+   mOutLimit = len;
+   if (!mDoProfile)
+      ComputeThresholds(statistics);
 
    WaveTrack::Holder outputTrack;
    if(!mDoProfile)
@@ -1355,19 +1727,206 @@ bool EffectNoiseReduction::Worker::ProcessOne
    if (bLoopSuccess && !mDoProfile) {
       // Flush the output WaveTrack (since it's buffered)
       outputTrack->Flush();
-
-      // Take the output track and insert it in place of the original
-      // sample data (as operated on -- this may not match mT0/mT1)
-      double t0 = outputTrack->LongSamplesToTime(start);
-      double tLen = outputTrack->LongSamplesToTime(len);
-      // Filtering effects always end up with more data than they started with.  Delete this 'tail'.
-      outputTrack->HandleClear(tLen, outputTrack->GetEndTime(), false, false);
-      track->ClearAndPaste(t0, t0 + tLen, &*outputTrack, true, false);
+      ReplaceSelection(*track, *outputTrack, start, len);
    }
 
    return bLoopSuccess;
 }
 
+void EffectNoiseReduction::Worker::ReplaceSelection
+(WaveTrack &track, WaveTrack &outputTrack, sampleCount start, sampleCount len)
+{
+   // Take the output track and insert it in place of the original
+   // sample data (as operated on -- this may not match mT0/mT1)
+   double t0 = outputTrack.LongSamplesToTime(start);
+   double tLen = outputTrack.LongSamplesToTime(len);
+   // Filtering effects always end up with more data than they started with.  Delete this 'tail'.
+   outputTrack.HandleClear(tLen, outputTrack.GetEndTime(), false, false);
+   track.ClearAndPaste(t0, t0 + tLen, &outputTrack, true, false);
+}
+
+// How many steps into a segment, started from zero padding rather than from
+// the preceding audio, all windows are the same as when the whole selection
+// is reduced at once, so that the output is too, bit for bit; 0 if the
+// effect of the padding never dies out.
+unsigned EffectNoiseReduction::Worker::SegmentWarmUpSteps() const
+{
+   // The first mStepsPerWindow - 1 windows overlap the padding, which may
+   // change the classification of the centers examining them, and the
+   // overlap-add of the output
+   unsigned steps = mStepsPerWindow + mNWindowsToExamine;
+
+   if (mNoiseReductionChoice != NRC_ISOLATE_NOISE) {
+      // A gain raised by a different classification is then released into
+      // the following windows, until it decays to the attenuation factor.
+      // Count those steps in the same float arithmetic as ReduceNoise().
+      enum : unsigned { MaxReleaseSteps = 1 << 16 };
+      float gain = 1.0f;
+      unsigned releaseSteps = 0;
+      while (gain > mNoiseAttenFactor) {
+         if (++releaseSteps > MaxReleaseSteps)
+            return 0;
+         gain = gain * mOneBlockRelease;
+      }
+      steps += releaseSteps;
+   }
+
+   // The attack reaches only within the history, as does the lookahead
+   return steps;
+}
+
+bool EffectNoiseReduction::Worker::ProcessInParallel
+(EffectNoiseReduction &effect, Statistics &statistics,
+ const std::vector<Selection> &selections, unsigned nThreads)
+{
+   // Divide the selections into segments of about equal length, but not
+   // so short that warming up and lookahead cost much
+   const auto warmUp = SegmentWarmUpSteps() * mStepSize;
+   const auto lookahead = (mHistoryLen + mStepsPerWindow) * mStepSize;
+   enum : int { MinSegmentOverheads = 32, SegmentsPerThread = 2 };
+   sampleCount total = 0;
+   for (const auto &selection : selections)
+      total += selection.len;
+   sampleCount segmentLen = std::max(
+      sampleCount{ MinSegmentOverheads * (warmUp + lookahead) },
+      total / (SegmentsPerThread * nThreads));
+   // Segments begin at whole steps from the start of the selection
+   segmentLen = (segmentLen + mStepSize - 1) / mStepSize * mStepSize;
+
+   std::vector<Segment> segments;
+   for (const auto &selection : selections) {
+      const auto end = selection.start + selection.len;
+      auto start = selection.start;
+      while (start < end) {
+         Segment segment{ &selection, start, end, start, end, {} };
+         if (start > selection.start)
+            segment.readStart = start - warmUp;
+         if (warmUp > 0 && start + segmentLen + lookahead < end) {
+            segment.end = start + segmentLen;
+            segment.readEnd = segment.end + lookahead;
+         }
+         segment.outputTrack = selection.track->EmptyCopy();
+         segments.push_back(std::move(segment));
+         start = segments.back().end;
+      }
+   }
+
+   sampleCount toRead = 0;
+   for (const auto &segment : segments)
+      toRead += segment.readEnd - segment.readStart;
+
+   nThreads = unsigned(std::min<size_t>(nThreads, segments.size()));
+   std::vector<std::unique_ptr<Worker>> workers(nThreads);
+   for (auto &pWorker : workers)
+      pWorker = std::make_unique<Worker>(mSettings, mSampleRate
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+                                         , mF0, mF1
+#endif
+         );
+
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::atomic<bool> stopped{ false };
+   std::atomic<long long> samplesRead{ 0 };
+   std::vector<std::exception_ptr> errors(nThreads);
+   {
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the segments go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for (auto &thread : threads)
+            thread.join();
+      } );
+      // Statistics are only read when reducing noise, so they are shared
+      for (unsigned ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back( [&, ii]{
+            try {
+               for (size_t jj = 0;
+                    !stopped.load() && (jj = next++) < segments.size();) {
+                  if (!workers[ii]->ProcessSegment(
+                        statistics, segments[jj], stopped, samplesRead))
+                     break;
+                  ++nDone;
+               }
+            }
+            catch (...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      // Update the Progress meter, let user cancel
+      while (nDone.load() < segments.size() && !stopped.load()) {
+         if (effect.TotalProgress(
+               samplesRead.load() / toRead.as_double()))
+            stopped.store(true);
+         else
+            ::wxMilliSleep(10);
+      }
+   }
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+   if (nDone.load() < segments.size())
+      return false;
+
+   // Join the segments of each selection, and replace it
+   for (auto iter = segments.begin(); iter != segments.end();) {
+      auto &outputTrack = *iter->outputTrack;
+      const auto &selection = *iter->pSelection;
+      auto clip = outputTrack.GetClipByIndex(0);
+      while (++iter != segments.end() && iter->pSelection == &selection)
+         clip->Paste(clip->GetEndTime(),
+                     iter->outputTrack->GetClipByIndex(0));
+      ReplaceSelection(*selection.track, outputTrack,
+                       selection.start, selection.len);
+   }
+
+   return true;
+}
+
+bool EffectNoiseReduction::Worker::ProcessSegment
+(Statistics &statistics, Segment &segment,
+ const std::atomic<bool> &stopped, std::atomic<long long> &samplesRead)
+{
+   const auto &selection = *segment.pSelection;
+   const auto track = selection.track;
+   const bool last = segment.end == selection.start + selection.len;
+
+   StartNewTrack();
+   mOutSkip = segment.start - segment.readStart;
+   mOutLimit = segment.end - segment.start;
+   ComputeThresholds(statistics);
+
+   auto bufferSize = track->GetMaxBlockSize();
+   FloatVector buffer(bufferSize);
+
+   auto samplePos = segment.readStart;
+   while (samplePos < segment.readEnd) {
+      if (stopped.load())
+         return false;
+
+      const auto blockSize = limitSampleBufferSize(
+         track->GetBestBlockSize(samplePos),
+         segment.readEnd - samplePos
+      );
+      track->Get((samplePtr)&buffer[0], floatSample, samplePos, blockSize);
+      samplePos += blockSize;
+
+      mInSampleCount += blockSize;
+      ProcessSamples(statistics, segment.outputTrack.get(), blockSize,
+                     &buffer[0]);
+      samplesRead += blockSize;
+   }
+
+   // Only the end of the selection is padded; other segments already read
+   // far enough past their ends
+   if (last)
+      FinishTrack(statistics, segment.outputTrack.get());
+   segment.outputTrack->Flush();
+   return true;
+}
+
 //----------------------------------------------------------------------------
 // EffectNoiseReduction::Dialog
 //----------------------------------------------------------------------------
@@ -22,10 +22,14 @@
 #include "../Experimental.h"
 
 #include <math.h>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 #include <wx/checkbox.h>
 #include <wx/intl.h>
 #include <wx/stattext.h>
+#include <wx/utils.h>
 #include <wx/valgen.h>
 
 #include "../Prefs.h"
@@ -173,30 +177,9 @@ bool EffectNormalize::Process()
    if (mGain == false && mDC == false)
       return true;
 
-   float ratio;
-   if( mGain )
-   {
-      // same value used for all tracks
-      ratio = DB_TO_LINEAR(TrapDouble(mPeakLevel, MIN_PeakLevel, MAX_PeakLevel));
-   }
-   else {
-      ratio = 1.0;
-   }
-
    //Iterate over each track
    this->CopyInputTracks(); // Set up mOutputTracks.
-   bool bGoodResult = true;
-   double progress = 0;
-   TranslatableString topMsg;
-   if(mDC && mGain)
-      topMsg = XO("Removing DC offset and Normalizing...\n");
-   else if(mDC && !mGain)
-      topMsg = XO("Removing DC offset...\n");
-   else if(!mDC && mGain)
-      topMsg = XO("Normalizing without removing DC offset...\n");
-   else if(!mDC && !mGain)
-      topMsg = XO("Not doing anything...\n");   // shouldn't get here
-
+   std::vector<Job> jobs;
    for ( auto track : mOutputTracks->Selected< WaveTrack >()
             + ( mStereoInd ? &Track::Any : &Track::IsLeader ) ) {
       //Get start and end times from track
@@ -206,82 +189,24 @@ bool EffectNormalize::Process()
 
       //Set the current bounds to whichever left marker is
       //greater and whichever right marker is less:
-      mCurT0 = mT0 < trackStart? trackStart: mT0;
-      mCurT1 = mT1 > trackEnd? trackEnd: mT1;
-
-      auto range = mStereoInd
-         ? TrackList::SingletonRange(track)
-         : TrackList::Channels(track);
+      Job job;
+      job.t0 = mT0 < trackStart? trackStart: mT0;
+      job.t1 = mT1 > trackEnd? trackEnd: mT1;
 
       // Process only if the right marker is to the right of the left marker
-      if (mCurT1 > mCurT0) {
-         wxString trackName = track->GetName();
-
-         float extent;
-         // Will compute a maximum
-         extent = std::numeric_limits<float>::lowest();
-         std::vector<float> offsets;
-
-         auto msg = (range.size() == 1)
-            // mono or 'stereo tracks independently'
-            ? topMsg +
-               XO("Analyzing: %s").Format( trackName )
-            : topMsg +
-               // TODO: more-than-two-channels-message
-               XO("Analyzing first track of stereo pair: %s").Format( trackName );
-         
-         // Analysis loop over channels collects offsets and extent
-         for (auto channel : range) {
-            float offset = 0;
-            float extent2 = 0;
-            bGoodResult =
-               AnalyseTrack( channel, msg, progress, offset, extent2 );
-            if ( ! bGoodResult )
-               goto break2;
-            extent = std::max( extent, extent2 );
-            offsets.push_back(offset);
-            // TODO: more-than-two-channels-message
-            msg = topMsg +
-               XO("Analyzing second track of stereo pair: %s").Format( trackName );
-         }
-
-         // Compute the multiplier using extent
-         if( (extent > 0) && mGain ) {
-            mMult = ratio / extent;
-         }
-         else
-            mMult = 1.0;
-
-         if (range.size() == 1) {
-            if (TrackList::Channels(track).size() == 1)
-               // really mono
-               msg = topMsg +
-                  XO("Processing: %s").Format( trackName );
-            else
-               //'stereo tracks independently'
-               // TODO: more-than-two-channels-message
-               msg = topMsg +
-                  XO("Processing stereo channels independently: %s").Format( trackName );
-         }
-         else
-            msg = topMsg +
-               // TODO: more-than-two-channels-message
-               XO("Processing first track of stereo pair: %s").Format( trackName );
-
-         // Use multiplier in the second, processing loop over channels
-         auto pOffset = offsets.begin();
-         for (auto channel : range) {
-            if (false ==
-                (bGoodResult = ProcessOne(channel, msg, progress, *pOffset++)) )
-               goto break2;
-            // TODO: more-than-two-channels-message
-            msg = topMsg +
-               XO("Processing second track of stereo pair: %s").Format( trackName );
-         }
+      if (job.t1 > job.t0) {
+         auto range = mStereoInd
+            ? TrackList::SingletonRange(track)
+            : TrackList::Channels(track);
+         for (auto channel : range)
+            job.channels.push_back(channel);
+         job.name = track->GetName();
+         job.reallyMono = TrackList::Channels(track).size() == 1;
+         jobs.push_back(std::move(job));
       }
    }
 
-   break2:
+   bool bGoodResult = ProcessJobs(jobs);
 
    this->ReplaceProcessedTracks(bGoodResult);
    return bGoodResult;
@@ -363,32 +288,218 @@ bool EffectNormalize::TransferDataFromWindow()
 
 // EffectNormalize implementation
 
-bool EffectNormalize::AnalyseTrack(const WaveTrack * track, const TranslatableString &msg,
-                                   double &progress, float &offset, float &extent)
+TranslatableString EffectNormalize::TopMessage() const
 {
-   bool result = true;
-   float min, max;
+   TranslatableString topMsg;
+   if(mDC && mGain)
+      topMsg = XO("Removing DC offset and Normalizing...\n");
+   else if(mDC && !mGain)
+      topMsg = XO("Removing DC offset...\n");
+   else if(!mDC && mGain)
+      topMsg = XO("Normalizing without removing DC offset...\n");
+   else if(!mDC && !mGain)
+      topMsg = XO("Not doing anything...\n");   // shouldn't get here
+   return topMsg;
+}
 
+bool EffectNormalize::ProcessJobs(const std::vector<Job> &jobs)
+{
    if(mGain)
    {
-      // Since we need complete summary data, we need to block until the OD tasks are done for this track
+      // Since we need complete summary data, we need to block until the OD tasks are done for these tracks
       // This is needed for track->GetMinMax
       // TODO: should we restrict the flags to just the relevant block files (for selections)
-      while (ProjectFileManager::GetODFlags( *track )) {
-         // update the gui
-         if (ProgressResult::Cancelled == mProgress->Update(
-            0, XO("Waiting for waveform to finish computing...")) )
+      for (const auto &job : jobs)
+         for (auto channel : job.channels)
+            while (ProjectFileManager::GetODFlags( *channel )) {
+               // update the gui
+               if (ProgressResult::Cancelled == mProgress->Update(
+                  0, XO("Waiting for waveform to finish computing...")) )
+                  return false;
+               wxMilliSleep(100);
+            }
+   }
+
+   // Each pass over a channel counts one toward the total
+   const double total = 2.0 * GetNumWaveTracks();
+   const auto nJobs = jobs.size();
+   const auto nThreads =
+      std::min<size_t>(nJobs, std::thread::hardware_concurrency());
+   if (nThreads <= 1) {
+      double progress = 0;
+      for (const auto &job : jobs) {
+         if (!ProcessJob(job,
+               [&](double passes, const TranslatableString &msg) {
+                  return TotalProgress((progress + passes) / total, msg); }))
             return false;
-         wxMilliSleep(100);
+         progress += 2.0 * job.channels.size();
       }
+      return true;
+   }
 
+   // The jobs touch disjoint channels and keep all of their state on the
+   // stack, so they are independent; the main thread sums their progress,
+   // as a macro step over many tracks would otherwise normalize them one
+   // at a time
+   const auto topMsg = TopMessage();
+   std::vector< std::atomic<double> > passes(nJobs);
+   std::atomic<bool> stopped{ false };
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::vector<std::exception_ptr> errors(nThreads);
+   {
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the tracks go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for (auto &thread : threads)
+            thread.join();
+      } );
+      for (size_t ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back( [&, ii]{
+            try {
+               for (size_t jj = 0;
+                    !stopped.load() && (jj = next++) < nJobs;) {
+                  auto &done = passes[jj];
+                  if (!ProcessJob(jobs[jj],
+                        [&](double count, const TranslatableString &) -> bool {
+                           done.store(count);
+                           return stopped.load(); })) {
+                     stopped.store(true);
+                     break;
+                  }
+                  ++nDone;
+               }
+            }
+            catch (...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      while (nDone.load() < nJobs && !stopped.load()) {
+         double sum = 0;
+         for (const auto &done : passes)
+            sum += done.load();
+         if (TotalProgress(sum / total, topMsg))
+            stopped.store(true);
+         else
+            ::wxMilliSleep(10);
+      }
+   }
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
+   return nDone.load() == nJobs;
+}
+
+// Safe to call from a worker thread:  it touches only the job's channels
+// and reports through progress
+bool EffectNormalize::ProcessJob(
+   const Job &job, const ProgressFunction &progress)
+{
+   float ratio;
+   if( mGain )
+   {
+      // same value used for all tracks
+      ratio = DB_TO_LINEAR(TrapDouble(mPeakLevel, MIN_PeakLevel, MAX_PeakLevel));
+   }
+   else {
+      ratio = 1.0;
+   }
+
+   const auto topMsg = TopMessage();
+
+   const auto &trackName = job.name;
+   const auto nChannels = job.channels.size();
+   double pass = 0;
+   TranslatableString msg;
+   const auto passProgress = [&](double frac) {
+      return progress(pass + frac, msg);
+   };
+
+   float extent;
+   // Will compute a maximum
+   extent = std::numeric_limits<float>::lowest();
+   std::vector<float> offsets;
+
+   msg = (nChannels == 1)
+      // mono or 'stereo tracks independently'
+      ? topMsg +
+         XO("Analyzing: %s").Format( trackName )
+      : topMsg +
+         // TODO: more-than-two-channels-message
+         XO("Analyzing first track of stereo pair: %s").Format( trackName );
+
+   // Analysis loop over channels collects offsets and extent
+   for (auto channel : job.channels) {
+      float offset = 0;
+      float extent2 = 0;
+      if ( ! AnalyseTrack( channel, job, passProgress, offset, extent2 ) )
+         return false;
+      extent = std::max( extent, extent2 );
+      offsets.push_back(offset);
+      ++pass;
+      // TODO: more-than-two-channels-message
+      msg = topMsg +
+         XO("Analyzing second track of stereo pair: %s").Format( trackName );
+   }
+
+   // Compute the multiplier using extent
+   float mult;
+   if( (extent > 0) && mGain ) {
+      mult = ratio / extent;
+   }
+   else
+      mult = 1.0;
+
+   if (nChannels == 1) {
+      if (job.reallyMono)
+         // really mono
+         msg = topMsg +
+            XO("Processing: %s").Format( trackName );
+      else
+         //'stereo tracks independently'
+         // TODO: more-than-two-channels-message
+         msg = topMsg +
+            XO("Processing stereo channels independently: %s").Format( trackName );
+   }
+   else
+      msg = topMsg +
+         // TODO: more-than-two-channels-message
+         XO("Processing first track of stereo pair: %s").Format( trackName );
+
+   // Use multiplier in the second, processing loop over channels
+   auto pOffset = offsets.begin();
+   pass = nChannels;
+   for (auto channel : job.channels) {
+      if ( ! ProcessOne( channel, job, mult, *pOffset++, passProgress ) )
+         return false;
+      ++pass;
+      // TODO: more-than-two-channels-message
+      msg = topMsg +
+         XO("Processing second track of stereo pair: %s").Format( trackName );
+   }
+
+   return true;
+}
+
+bool EffectNormalize::AnalyseTrack(const WaveTrack * track, const Job &job,
+   const PassProgress &progress, float &offset, float &extent)
+{
+   bool result = true;
+   float min, max;
+
+   if(mGain)
+   {
+      // ProcessJobs waited for the OD tasks, so the summary data are complete
       // set mMin, mMax.  No progress bar here as it's fast.
-      auto pair = track->GetMinMax(mCurT0, mCurT1); // may throw
+      auto pair = track->GetMinMax(job.t0, job.t1); // may throw
       min = pair.first, max = pair.second;
 
       if(mDC)
       {
-         result = AnalyseTrackData(track, msg, progress, offset);
+         result = AnalyseTrackData(track, job, progress, offset);
          min += offset;
          max += offset;
       }
@@ -396,7 +507,7 @@ bool EffectNormalize::AnalyseTrack(const WaveTrack * track, const TranslatableSt
    else if(mDC)
    {
       min = -1.0, max = 1.0;   // sensible defaults?
-      result = AnalyseTrackData(track, msg, progress, offset);
+      result = AnalyseTrackData(track, job, progress, offset);
       min += offset;
       max += offset;
    }
@@ -413,14 +524,14 @@ bool EffectNormalize::AnalyseTrack(const WaveTrack * track, const TranslatableSt
 
 //AnalyseTrackData() takes a track, transforms it to bunch of buffer-blocks,
 //and executes selected AnalyseOperation on it...
-bool EffectNormalize::AnalyseTrackData(const WaveTrack * track, const TranslatableString &msg,
-                                double &progress, float &offset)
+bool EffectNormalize::AnalyseTrackData(const WaveTrack * track, const Job &job,
+   const PassProgress &progress, float &offset)
 {
    bool rc = true;
 
    //Transform the marker timepoints to samples
-   auto start = track->TimeToLongSamples(mCurT0);
-   auto end = track->TimeToLongSamples(mCurT1);
+   auto start = track->TimeToLongSamples(job.t0);
+   auto end = track->TimeToLongSamples(job.t1);
 
    //Get the length of the buffer (as double). len is
    //used simply to calculate a progress meter, so it is easier
@@ -431,7 +542,7 @@ bool EffectNormalize::AnalyseTrackData(const WaveTrack * track, const Translatab
    //be shorter than the length of the track being processed.
    Floats buffer{ track->GetMaxBlockSize() };
 
-   mSum   = 0.0; // dc offset inits
+   double sum = 0.0; // dc offset inits
 
    sampleCount blockSamples;
    sampleCount totalSamples = 0;
@@ -452,40 +563,37 @@ bool EffectNormalize::AnalyseTrackData(const WaveTrack * track, const Translatab
       totalSamples += blockSamples;
 
       //Process the buffer.
-      AnalyseDataDC(buffer.get(), block);
+      AnalyseDataDC(buffer.get(), block, sum);
 
       //Increment s one blockfull of samples
       s += block;
 
       //Update the Progress meter
-      if (TotalProgress(progress +
-                        ((s - start).as_double() / len)/double(2*GetNumWaveTracks()), msg)) {
+      if (progress((s - start).as_double() / len)) {
          rc = false; //lda .. break, not return, so that buffer is deleted
          break;
       }
    }
    if( totalSamples > 0 )
-      offset = -mSum / totalSamples.as_double();  // calculate actual offset (amount that needs to be added on)
+      offset = -sum / totalSamples.as_double();  // calculate actual offset (amount that needs to be added on)
    else
       offset = 0.0;
 
-   progress += 1.0/double(2*GetNumWaveTracks());
    //Return true because the effect processing succeeded ... unless cancelled
    return rc;
 }
 
 //ProcessOne() takes a track, transforms it to bunch of buffer-blocks,
 //and executes ProcessData, on it...
-// uses mMult and offset to normalize a track.
-// mMult must be set before this is called
-bool EffectNormalize::ProcessOne(
-   WaveTrack * track, const TranslatableString &msg, double &progress, float offset)
+// uses mult and offset to normalize a track.
+bool EffectNormalize::ProcessOne(WaveTrack * track, const Job &job,
+   float mult, float offset, const PassProgress &progress)
 {
    bool rc = true;
 
    //Transform the marker timepoints to samples
-   auto start = track->TimeToLongSamples(mCurT0);
-   auto end = track->TimeToLongSamples(mCurT1);
+   auto start = track->TimeToLongSamples(job.t0);
+   auto end = track->TimeToLongSamples(job.t1);
 
    //Get the length of the buffer (as double). len is
    //used simply to calculate a progress meter, so it is easier
@@ -511,7 +619,7 @@ bool EffectNormalize::ProcessOne(
       track->Get((samplePtr) buffer.get(), floatSample, s, block);
 
       //Process the buffer.
-      ProcessData(buffer.get(), block, offset);
+      ProcessData(buffer.get(), block, offset, mult);
 
       //Copy the newly-changed samples back onto the track.
       track->Set((samplePtr) buffer.get(), floatSample, s, block);
@@ -520,29 +628,27 @@ bool EffectNormalize::ProcessOne(
       s += block;
 
       //Update the Progress meter
-      if (TotalProgress(progress +
-                        ((s - start).as_double() / len)/double(2*GetNumWaveTracks()), msg)) {
+      if (progress((s - start).as_double() / len)) {
          rc = false; //lda .. break, not return, so that buffer is deleted
          break;
       }
    }
-   progress += 1.0/double(2*GetNumWaveTracks());
 
    //Return true because the effect processing succeeded ... unless cancelled
    return rc;
 }
 
 /// @see AnalyseDataLoudnessDC
-void EffectNormalize::AnalyseDataDC(float *buffer, size_t len)
+void EffectNormalize::AnalyseDataDC(const float *buffer, size_t len, double &sum)
 {
    for(decltype(len) i = 0; i < len; i++)
-      mSum += (double)buffer[i];
+      sum += (double)buffer[i];
 }
 
-void EffectNormalize::ProcessData(float *buffer, size_t len, float offset)
+void EffectNormalize::ProcessData(float *buffer, size_t len, float offset, float mult)
 {
    for(decltype(len) i = 0; i < len; i++) {
-      float adjFrame = (buffer[i] + offset) * mMult;
+      float adjFrame = (buffer[i] + offset) * mult;
       buffer[i] = adjFrame;
    }
 }
@@ -58,14 +58,31 @@ public:
 private:
    // EffectNormalize implementation
 
-   bool ProcessOne(
-      WaveTrack * t, const TranslatableString &msg, double& progress, float offset);
-   bool AnalyseTrack(const WaveTrack * track, const TranslatableString &msg,
-                     double &progress, float &offset, float &extent);
-   bool AnalyseTrackData(const WaveTrack * track, const TranslatableString &msg, double &progress,
-                     float &offset);
-   void AnalyseDataDC(float *buffer, size_t len);
-   void ProcessData(float *buffer, size_t len, float offset);
+   // One track, or the channels of one, normalized together
+   struct Job {
+      std::vector<WaveTrack*> channels;
+      double t0, t1;
+      wxString name;
+      bool reallyMono;
+   };
+   // Like TotalProgress, but counting passes over channels of the job, two
+   // for each channel; returns true to stop
+   using ProgressFunction =
+      std::function< bool(double passes, const TranslatableString &msg) >;
+   // Progress of one pass over one channel; returns true to stop
+   using PassProgress = std::function< bool(double frac) >;
+
+   TranslatableString TopMessage() const;
+   bool ProcessJobs(const std::vector<Job> &jobs);
+   bool ProcessJob(const Job &job, const ProgressFunction &progress);
+   bool ProcessOne(WaveTrack * t, const Job &job, float mult, float offset,
+      const PassProgress &progress);
+   bool AnalyseTrack(const WaveTrack * track, const Job &job,
+      const PassProgress &progress, float &offset, float &extent);
+   bool AnalyseTrackData(const WaveTrack * track, const Job &job,
+      const PassProgress &progress, float &offset);
+   static void AnalyseDataDC(const float *buffer, size_t len, double &sum);
+   static void ProcessData(float *buffer, size_t len, float offset, float mult);
 
    void OnUpdateUI(wxCommandEvent & evt);
    void UpdateUI();
@@ -76,11 +93,6 @@ private:
    bool   mDC;
    bool   mStereoInd;
 
-   double mCurT0;
-   double mCurT1;
-   float  mMult;
-   double mSum;
-
    wxCheckBox *mGainCheckBox;
    wxCheckBox *mDCCheckBox;
    wxTextCtrl *mLevelTextCtrl;
@@ -19,6 +19,10 @@
 #include "LoadEffects.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
 
 #include <math.h>
 #include <float.h>
@@ -29,12 +33,24 @@
 #include "../Shuttle.h"
 #include "../ShuttleGui.h"
 #include "../FFT.h"
+#include "../RealFFTf.h"
 #include "../widgets/valnum.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../Prefs.h"
 
 #include "../WaveTrack.h"
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_PAULSTRETCH
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_PAULSTRETCH
+#include <arm_neon.h>
+#endif
+
 // Define keys, defaults, minimums, and maximums for the effect parameters
 //
 //     Name    Type     Key                     Def      Min      Max      Scale
@@ -50,14 +66,27 @@ public:
    //in_bufsize is also a half of a FFT buffer (in samples)
    virtual ~PaulStretch();
 
-   void process(float *smps, size_t nsmps);
+   /// Scratch space for process_window, one for each thread
+   struct Workspace
+   {
+      explicit Workspace(size_t poolsize);
+      Floats fft_buf, ifft_buf;
+   };
+
+   /// Transform poolsize samples of input, randomize the phases by the
+   /// generator seeded with seed, and transform back into poolsize samples
+   /// of window; depends on nothing else, so windows may be computed on
+   /// several threads at once
+   void process_window(const float *pool, float *window, unsigned seed,
+      Workspace &workspace) const;
+
+   /// Overlap the next window with the previous one, filling out_buf
+   void overlap_add(const float *window);
 
    size_t get_nsamples();//how many samples are required to be added in the pool next time
    size_t get_nsamples_for_fill();//how many samples are required to be added for a complete buffer refill (at start of the song or after seek)
 
 private:
-   void process_spectrum(float *WXUNUSED(freq)) {};
-
    const float samplerate;
    const float rap;
    const size_t in_bufsize;
@@ -73,11 +102,14 @@ public:
    const size_t poolsize;//how many samples are inside the input_pool size (need to know how many samples to fill when seeking)
 
 private:
-   const Floats in_pool;//de marimea in_bufsize
-
    double remained_samples;//how many fraction of samples has remained (0..1)
 
-   const Floats fft_smps, fft_c, fft_s, fft_freq, fft_tmp;
+   const HFFT hFFT;
+   // Sine and cosine of each of the random phases
+   enum : size_t { phase_count = 0x8000 };
+   const Floats phase_sin, phase_cos;
+   // Crossfade from the previous window, and amplitude, of each output sample
+   const Floats overlap, amplitude;
 };
 
 //
@@ -344,55 +376,125 @@ bool EffectPaulstretch::ProcessOne(WaveTrack *track,double t0,double t1,int coun
 
       PaulStretch stretch(amount, stretch_buf_size, track->GetRate());
 
-      auto nget = stretch.get_nsamples_for_fill();
-
-      auto bufsize = stretch.poolsize;
-      Floats buffer0{ bufsize };
-      float *bufferptr0 = buffer0.get();
-      bool first_time = true;
-
-      const auto fade_len = std::min<size_t>(100, bufsize / 2 - 1);
+      const auto poolsize = stretch.poolsize;
+      const auto fade_len = std::min<size_t>(100, poolsize / 2 - 1);
       bool cancelled = false;
 
+      // Windows are computed in batches on as many threads, but are
+      // overlapped, blended and appended in order, so that only a batch of
+      // them is ever in memory.  Each window transforms the poolsize samples
+      // of the selection before its end; the first only primes the overlap
+      // of the second, which takes the same samples.
+      // Two windows for each thread, but not much more than 32 MB of them
+      const size_t batchSize = std::max<size_t>(1, std::min<size_t>(
+         2 * std::thread::hardware_concurrency(),
+         (32 * 1024 * 1024 / sizeof(float)) / poolsize));
+      const size_t nThreads = std::max<size_t>(1,
+         std::min<size_t>(batchSize, std::thread::hardware_concurrency()));
+      std::vector<PaulStretch::Workspace> workspaces;
+      workspaces.reserve(nThreads);
+      for (size_t ii = 0; ii < nThreads; ++ii)
+         workspaces.emplace_back(poolsize);
+      Floats windows{ batchSize * poolsize };
+      Floats input;
+      size_t inputSize = 0;
+      std::vector<sampleCount> ends;
+
       {
          Floats fade_track_smps{ fade_len };
-         decltype(len) s=0;
-
-         while (s < len) {
-            track->Get((samplePtr)bufferptr0, floatSample, start + s, nget);
-            stretch.process(buffer0.get(), nget);
+         size_t nWindows = 0;
+         sampleCount windowEnd = stretch.get_nsamples_for_fill();
+         bool last = false;
+
+         while (!last) {
+            // Find the windows of the next batch
+            const auto first = nWindows;
+            ends.clear();
+            while (ends.size() < batchSize && !last) {
+               if (nWindows >= 2)
+                  windowEnd += stretch.get_nsamples();
+               ends.push_back(windowEnd);
+               ++nWindows;
+               last = nWindows >= 2 && windowEnd >= len;
+            }
 
-            if (first_time) {
-               stretch.process(buffer0.get(), 0);
+            // Get all of their input
+            const auto inputStart = ends.front() - poolsize;
+            const auto nInput = (ends.back() - inputStart).as_size_t();
+            if (nInput > inputSize) {
+               input.reinit(nInput);
+               inputSize = nInput;
+            }
+            track->Get((samplePtr)input.get(), floatSample,
+               start + inputStart, nInput);
+
+            // Compute the windows
+            const auto nBatch = ends.size();
+            auto compute = [&](size_t jj, PaulStretch::Workspace &workspace) {
+               const auto offset = (ends[jj] - poolsize - inputStart).as_size_t();
+               stretch.process_window(&input[offset], &windows[jj * poolsize],
+                  (count + 1) * 0x10001u + first + jj, workspace);
             };
-
-            s += nget;
-
-            if (first_time){//blend the the start of the selection
-               track->Get((samplePtr)fade_track_smps.get(), floatSample, start, fade_len);
-               first_time = false;
-               for (size_t i = 0; i < fade_len; i++){
-                  float fi = (float)i / (float)fade_len;
-                  stretch.out_buf[i] =
-                     stretch.out_buf[i] * fi + (1.0 - fi) * fade_track_smps[i];
+            const auto nWorkers = std::min(nThreads, nBatch);
+            if (nWorkers == 1)
+               for (size_t jj = 0; jj < nBatch; ++jj)
+                  compute(jj, workspaces[0]);
+            else {
+               std::atomic<size_t> next{ 0 };
+               std::vector<std::exception_ptr> errors(nWorkers);
+               {
+                  std::vector<std::thread> threads;
+                  auto cleanup = finally( [&] {
+                     for (auto &thread : threads)
+                        thread.join();
+                  } );
+                  for (size_t ii = 0; ii < nWorkers; ++ii)
+                     threads.emplace_back( [&, ii]{
+                        try {
+                           for (size_t jj; (jj = next++) < nBatch;)
+                              compute(jj, workspaces[ii]);
+                        }
+                        catch (...) {
+                           errors[ii] = std::current_exception();
+                        }
+                     } );
                }
+               for (auto &error : errors)
+                  if (error)
+                     std::rethrow_exception(error);
             }
-            if (s >= len){//blend the end of the selection
-               track->Get((samplePtr)fade_track_smps.get(), floatSample, end - fade_len, fade_len);
-               for (size_t i = 0; i < fade_len; i++){
-                  float fi = (float)i / (float)fade_len;
-                  auto i2 = bufsize / 2 - 1 - i;
-                  stretch.out_buf[i2] =
-                     stretch.out_buf[i2] * fi + (1.0 - fi) *
-                     fade_track_smps[fade_len - 1 - i];
+
+            // Overlap the windows in order, and append the output
+            for (size_t jj = 0; jj < nBatch; ++jj) {
+               stretch.overlap_add(&windows[jj * poolsize]);
+               const auto index = first + jj;
+               if (index == 0)
+                  continue;
+
+               if (index == 1){//blend the the start of the selection
+                  track->Get((samplePtr)fade_track_smps.get(), floatSample, start, fade_len);
+                  for (size_t i = 0; i < fade_len; i++){
+                     float fi = (float)i / (float)fade_len;
+                     stretch.out_buf[i] =
+                        stretch.out_buf[i] * fi + (1.0 - fi) * fade_track_smps[i];
+                  }
+               }
+               if (last && jj == nBatch - 1){//blend the end of the selection
+                  track->Get((samplePtr)fade_track_smps.get(), floatSample, end - fade_len, fade_len);
+                  for (size_t i = 0; i < fade_len; i++){
+                     float fi = (float)i / (float)fade_len;
+                     auto i2 = poolsize / 2 - 1 - i;
+                     stretch.out_buf[i2] =
+                        stretch.out_buf[i2] * fi + (1.0 - fi) *
+                        fade_track_smps[fade_len - 1 - i];
+                  }
                }
-            }
 
-            outputTrack->Append((samplePtr)stretch.out_buf.get(), floatSample, stretch.out_bufsize);
+               outputTrack->Append((samplePtr)stretch.out_buf.get(), floatSample, stretch.out_bufsize);
+            }
 
-            nget = stretch.get_nsamples();
             if (TrackProgress(count,
-               s.as_double() / len.as_double()
+               std::min(1.0, windowEnd.as_double() / len.as_double())
             )) {
                cancelled = true;
                break;
@@ -427,95 +529,111 @@ PaulStretch::PaulStretch(float rap_, size_t in_bufsize_, float samplerate_ )
    , out_buf { out_bufsize }
    , old_out_smp_buf { out_bufsize * 2, true }
    , poolsize { in_bufsize_ * 2 }
-   , in_pool { poolsize, true }
    , remained_samples { 0.0 }
-   , fft_smps { poolsize, true }
-   , fft_c { poolsize, true }
-   , fft_s { poolsize, true }
-   , fft_freq { poolsize, true }
-   , fft_tmp { poolsize }
+   , hFFT { GetFFT(poolsize) }
+   , phase_sin { phase_count }
+   , phase_cos { phase_count }
+   , overlap { out_bufsize }
+   , amplitude { out_bufsize }
 {
+   // The random phases are multiples of 2 pi / phase_count
+   float inv_2p15_2pi = 1.0 / 16384.0 * (float)M_PI;
+   for (size_t i = 0; i < phase_count; i++) {
+      float phase = i * inv_2p15_2pi;
+      phase_sin[i] = sin(phase);
+      phase_cos[i] = cos(phase);
+   }
+
+   float tmp = 1.0 / (float) out_bufsize * M_PI;
+   float hinv_sqrt2 = 0.853553390593f;//(1.0+1.0/sqrt(2))*0.5;
+
+   float ampfactor = 1.0;
+   if (rap < 1.0)
+      ampfactor = rap * 0.707;
+   else
+      ampfactor = (out_bufsize / (float)poolsize) * 4.0;
+
+   for (size_t i = 0; i < out_bufsize; i++) {
+      overlap[i] = 0.5 + 0.5 * cos(i * tmp);
+      amplitude[i] =
+         (hinv_sqrt2 - (1.0 - hinv_sqrt2) * cos(i * 2.0 * tmp)) * ampfactor;
+   }
 }
 
 PaulStretch::~PaulStretch()
 {
 }
 
-void PaulStretch::process(float *smps, size_t nsmps)
+PaulStretch::Workspace::Workspace(size_t poolsize)
+   : fft_buf { poolsize }
+   , ifft_buf { poolsize }
 {
-   //add NEW samples to the pool
-   if ((smps != NULL) && (nsmps != 0)) {
-      if (nsmps > poolsize) {
-         nsmps = poolsize;
-      }
-      int nleft = poolsize - nsmps;
-
-      //move left the samples from the pool to make room for NEW samples
-      for (int i = 0; i < nleft; i++)
-         in_pool[i] = in_pool[i + nsmps];
-
-      //add NEW samples to the pool
-      for (size_t i = 0; i < nsmps; i++)
-         in_pool[i + nleft] = smps[i];
-   }
-
-   //get the samples from the pool
-   for (size_t i = 0; i < poolsize; i++)
-      fft_smps[i] = in_pool[i];
-   WindowFunc(eWinFuncHanning, poolsize, fft_smps.get());
-
-   RealFFT(poolsize, fft_smps.get(), fft_c.get(), fft_s.get());
+}
 
-   for (size_t i = 0; i < poolsize / 2; i++)
-      fft_freq[i] = sqrt(fft_c[i] * fft_c[i] + fft_s[i] * fft_s[i]);
-   process_spectrum(fft_freq.get());
+void PaulStretch::process_window(const float *pool, float *window,
+   unsigned seed, Workspace &workspace) const
+{
+   float *fft_buf = workspace.fft_buf.get();
+   float *ifft_buf = workspace.ifft_buf.get();
 
+   std::copy(pool, pool + poolsize, fft_buf);
+   WindowFunc(eWinFuncHanning, poolsize, fft_buf);
+   RealFFTf(fft_buf, hFFT.get());
 
    //put randomize phases to frequencies and do a IFFT
-   float inv_2p15_2pi = 1.0 / 16384.0 * (float)M_PI;
+   unsigned random = seed * 2654435761u + 1;
    for (size_t i = 1; i < poolsize / 2; i++) {
-      unsigned int random = (rand()) & 0x7fff;
-      float phase = random * inv_2p15_2pi;
-      float s = fft_freq[i] * sin(phase);
-      float c = fft_freq[i] * cos(phase);
-
-      fft_c[i] = fft_c[poolsize - i] = c;
-
-      fft_s[i] = s; fft_s[poolsize - i] = -s;
-   }
-   fft_c[0] = fft_s[0] = 0.0;
-   fft_c[poolsize / 2] = fft_s[poolsize / 2] = 0.0;
-
-   FFT(poolsize, true, fft_c.get(), fft_s.get(), fft_smps.get(), fft_tmp.get());
-
-   float max = 0.0, max2 = 0.0;
-   for (size_t i = 0; i < poolsize; i++) {
-      max = std::max(max, fabsf(fft_tmp[i]));
-      max2 = std::max(max2, fabsf(fft_smps[i]));
+      const auto k = hFFT->BitReversed[i];
+      const float re = fft_buf[k], im = fft_buf[k + 1];
+      const float freq = sqrt(re * re + im * im);
+
+      // Take the high bits of a linear congruential generator
+      random = random * 1664525u + 1013904223u;
+      const auto phase = (random >> 16) & (phase_count - 1);
+      ifft_buf[2 * i] = freq * phase_cos[phase];
+      ifft_buf[2 * i + 1] = freq * phase_sin[phase];
    }
+   // No DC, nor Fs/2, which goes in the imaginary part of the DC
+   ifft_buf[0] = ifft_buf[1] = 0.0;
 
+   InverseRealFFTf(ifft_buf, hFFT.get());
+   ReorderToTime(hFFT.get(), ifft_buf, window);
+}
 
+void PaulStretch::overlap_add(const float *window)
+{
    //make the output buffer
-   float tmp = 1.0 / (float) out_bufsize * M_PI;
-   float hinv_sqrt2 = 0.853553390593f;//(1.0+1.0/sqrt(2))*0.5;
-
-   float ampfactor = 1.0;
-   if (rap < 1.0)
-      ampfactor = rap * 0.707;
-   else
-      ampfactor = (out_bufsize / (float)poolsize) * 4.0;
-
-   for (size_t i = 0; i < out_bufsize; i++) {
-      float a = (0.5 + 0.5 * cos(i * tmp));
-      float out = fft_smps[i + out_bufsize] * (1.0 - a) + old_out_smp_buf[i] * a;
-      out_buf[i] =
-         out * (hinv_sqrt2 - (1.0 - hinv_sqrt2) * cos(i * 2.0 * tmp)) *
-         ampfactor;
+   const float *current = window + out_bufsize;
+   const float *old = old_out_smp_buf.get();
+   const float *a = overlap.get();
+   const float *amp = amplitude.get();
+   float *out = out_buf.get();
+
+   size_t i = 0;
+#if defined(USE_SSE2_PAULSTRETCH)
+   const __m128 one = _mm_set1_ps(1.0f);
+   for (; i + 4 <= out_bufsize; i += 4) {
+      const __m128 a4 = _mm_loadu_ps(a + i);
+      const __m128 sum = _mm_add_ps(
+         _mm_mul_ps(_mm_loadu_ps(current + i), _mm_sub_ps(one, a4)),
+         _mm_mul_ps(_mm_loadu_ps(old + i), a4));
+      _mm_storeu_ps(out + i, _mm_mul_ps(sum, _mm_loadu_ps(amp + i)));
+   }
+#elif defined(USE_NEON_PAULSTRETCH)
+   const float32x4_t one = vdupq_n_f32(1.0f);
+   for (; i + 4 <= out_bufsize; i += 4) {
+      const float32x4_t a4 = vld1q_f32(a + i);
+      const float32x4_t sum = vmlaq_f32(
+         vmulq_f32(vld1q_f32(current + i), vsubq_f32(one, a4)),
+         vld1q_f32(old + i), a4);
+      vst1q_f32(out + i, vmulq_f32(sum, vld1q_f32(amp + i)));
    }
+#endif
+   for (; i < out_bufsize; i++)
+      out[i] = (current[i] * (1.0f - a[i]) + old[i] * a[i]) * amp[i];
 
    //copy the current output buffer to old buffer
-   for (size_t i = 0; i < out_bufsize * 2; i++)
-      old_out_smp_buf[i] = fft_smps[i];
+   std::copy(window, window + out_bufsize * 2, old_out_smp_buf.get());
 }
 
 size_t PaulStretch::get_nsamples()
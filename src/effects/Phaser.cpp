@@ -26,6 +26,8 @@
 #include "../Experimental.h"
 
 #include <math.h>
+#include <algorithm>
+#include <vector>
 
 #include <wx/intl.h>
 #include <wx/slider.h>
@@ -62,6 +64,40 @@ Param( OutGain,   double,  wxT("Gain"),      -6.0,    -30.0,    30.0,    1   );
 // How many samples are processed before recomputing the lfo value again
 #define lfoskipsamples 20
 
+namespace {
+
+// Entries of the table of the LFO over one cycle
+constexpr size_t LFOTableSize = 1024;
+
+// The shaped LFO, from 0 to 1, at the phase theta in radians, by linear
+// interpolation in a table computed once
+double LFOShape(double theta)
+{
+   static const std::vector<double> table = []{
+      // One more entry, so that interpolation needs no wrap around
+      std::vector<double> result(LFOTableSize + 1);
+      for (size_t i = 0; i <= LFOTableSize; i++)
+      {
+         //compute sine between 0 and 1
+         const double value =
+            (1.0 + cos(2 * M_PI * i / LFOTableSize)) / 2.0;
+
+         // change lfo shape
+         result[i] = expm1(value * phaserlfoshape) / expm1(phaserlfoshape);
+      }
+      return result;
+   }();
+
+   double cycles = theta / (2 * M_PI);
+   cycles -= floor(cycles);
+   const double position = cycles * LFOTableSize;
+   const auto index = std::min(LFOTableSize - 1, size_t(position));
+   const double frac = position - index;
+   return table[index] + frac * (table[index + 1] - table[index]);
+}
+
+}
+
 //
 // EffectPhaser
 //
@@ -253,6 +289,11 @@ bool EffectPhaser::SetAutomationParameters(CommandParameters & parms)
 
 // Effect implementation
 
+std::unique_ptr<Effect> EffectPhaser::MakeParallelProcessor()
+{
+   return std::make_unique<EffectPhaser>();
+}
+
 void EffectPhaser::PopulateOrExchange(ShuttleGui & S)
 {
    S.SetBorder(5);
@@ -392,6 +433,7 @@ void EffectPhaser::InstanceInit(EffectPhaserState & data, float sampleRate)
 
    data.skipcount = 0;
    data.gain = 0;
+   data.gainStep = 0;
    data.fbout = 0;
    data.laststages = 0;
    data.outgain = 0;
@@ -414,39 +456,65 @@ size_t EffectPhaser::InstanceProcess(EffectPhaserState & data, float **inBlock,
    data.phase = mPhase * M_PI / 180;
    data.outgain = DB_TO_LINEAR(mOutGain);
 
-   for (decltype(blockLen) i = 0; i < blockLen; i++)
+   // The gain of the LFO, from the table, at the given count of samples
+   const auto lfoGain = [&](sampleCount count) {
+      return 1.0 -
+         LFOShape(count.as_double() * data.lfoskip + data.phase)
+            / 255.0 * mDepth;
+   };
+
+   // Keep the state in locals through the loop
+   const int stages = mStages;
+   const double feedback = mFeedback / 101.0;  // Feedback must be less than 100% to avoid infinite gain.
+   const double wet = data.outgain * mDryWet / 255;
+   const double dry = data.outgain * (255 - mDryWet) / 255;
+   double old[NUM_STAGES];
+   std::copy(data.old, data.old + stages, old);
+   double gain = data.gain;
+   double gainStep = data.gainStep;
+   double fbout = data.fbout;
+
+   for (decltype(blockLen) i = 0; i < blockLen;)
    {
-      double in = ibuf[i];
-
-      double m = in + data.fbout * mFeedback / 101;  // Feedback must be less than 100% to avoid infinite gain.
+      if (data.skipcount % lfoskipsamples == 0)
+      {
+         // Go linearly from the gain of this step of the LFO to that of the
+         // next, instead of jumping
+         gain = lfoGain(data.skipcount + 1);
+         gainStep =
+            (lfoGain(data.skipcount + 1 + lfoskipsamples) - gain)
+               / lfoskipsamples;
+      }
 
-      if (((data.skipcount++) % lfoskipsamples) == 0)
+      // Samples up to the next step of the LFO
+      const auto run = std::min<size_t>(blockLen - i,
+         lfoskipsamples - (data.skipcount % lfoskipsamples).as_size_t());
+      for (auto end = i + run; i < end; i++)
       {
-         //compute sine between 0 and 1
-         data.gain =
-            (1.0 +
-             cos(data.skipcount.as_double() * data.lfoskip
-                 + data.phase)) / 2.0;
+         double in = ibuf[i];
 
-         // change lfo shape
-         data.gain = expm1(data.gain * phaserlfoshape) / expm1(phaserlfoshape);
+         double m = in + fbout * feedback;
 
-         // attenuate the lfo
-         data.gain = 1.0 - data.gain / 255.0 * mDepth;
-      }
+         // phasing routine
+         for (int j = 0; j < stages; j++)
+         {
+            double tmp = old[j];
+            old[j] = gain * tmp + m;
+            m = tmp - gain * old[j];
+         }
+         fbout = m;
+         gain += gainStep;
 
-      // phasing routine
-      for (int j = 0; j < mStages; j++)
-      {
-         double tmp = data.old[j];
-         data.old[j] = data.gain * tmp + m;
-         m = tmp - data.gain * data.old[j];
+         obuf[i] = (float) (m * wet + in * dry);
       }
-      data.fbout = m;
-
-      obuf[i] = (float) (data.outgain * (m * mDryWet + in * (255 - mDryWet)) / 255);
+      data.skipcount += run;
    }
 
+   std::copy(old, old + stages, data.old);
+   data.gain = gain;
+   data.gainStep = gainStep;
+   data.fbout = fbout;
+
    return blockLen;
 }
 
@@ -32,6 +32,7 @@ public:
    sampleCount skipcount;
    double old[NUM_STAGES]; // must be as large as MAX_STAGES
    double gain;
+   double gainStep; // per sample, until the next step of the LFO
    double fbout;
    double outgain;
    double lfoskip;
@@ -80,6 +81,7 @@ public:
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
 
 private:
    // EffectPhaser implementation
@@ -15,9 +15,14 @@
 
 #include "audacity/EffectInterface.h"
 #include "MemoryX.h"
+#include "../RealtimeSafety.h"
 
+#include <algorithm>
 #include <atomic>
-#include <wx/time.h>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <wx/utils.h>
 
 class RealtimeEffectState
 {
@@ -33,13 +38,26 @@ public:
       unsigned chans, float **inbuf, float **outbuf, size_t numSamples);
    bool IsRealtimeActive();
 
+   void AddCPUTime(std::chrono::steady_clock::duration duration)
+   { mCPUTime += duration.count(); }
+   std::chrono::steady_clock::duration GetCPUTime() const
+   { return std::chrono::steady_clock::duration{ mCPUTime.load() }; }
+   void ResetCPUTime() { mCPUTime = 0; }
+
 private:
    EffectClientInterface &mEffect;
 
+   // Set while a thread is in RealtimeProcess, which other threads may call
+   // for other groups
+   std::atomic_flag mProcessing = ATOMIC_FLAG_INIT;
+
    std::vector<int> mGroupProcessor;
    int mCurrentProcessor;
 
    std::atomic<int> mRealtimeSuspendCount{ 1 };    // Effects are initially suspended
+
+   // Ticks of steady_clock spent in RealtimeProcess
+   std::atomic<std::chrono::steady_clock::rep> mCPUTime{ 0 };
 };
 
 RealtimeEffectManager & RealtimeEffectManager::Get()
@@ -59,6 +77,29 @@ RealtimeEffectManager::RealtimeEffectManager()
 
 RealtimeEffectManager::~RealtimeEffectManager()
 {
+   StopWorkers();
+   delete mpChain.exchange(nullptr);
+}
+
+void RealtimeEffectManager::PublishChain()
+{
+   auto pChain = std::make_unique<Chain>();
+   for (auto &state : mStates)
+      pChain->push_back(state.get());
+
+   std::unique_ptr<const Chain> pOld{ mpChain.exchange(pChain.release()) };
+
+   // The audio thread may still be going through the old chain
+   Synchronize();
+}
+
+void RealtimeEffectManager::Synchronize()
+{
+   // The audio thread counts itself in before it looks at the chain or the
+   // suspension, so once the count is seen zero, any later processing sees
+   // what was stored before
+   while (mReaders.load() > 0)
+      ::wxMilliSleep(1);
 }
 
 #if defined(EXPERIMENTAL_EFFECTS_RACK)
@@ -96,6 +137,7 @@ void RealtimeEffectManager::RealtimeSetEffects(const EffectArray & effects)
    // Get rid of the old chain
    // And install the NEW one
    mStates.swap( newStates );
+   PublishChain();
 
    // Allow RealtimeProcess() to, well, process 
    RealtimeResume();
@@ -114,12 +156,11 @@ bool RealtimeEffectManager::RealtimeIsSuspended()
 
 void RealtimeEffectManager::RealtimeAddEffect(EffectClientInterface *effect)
 {
-   // Block RealtimeProcess()
-   RealtimeSuspend();
+   wxCriticalSectionLocker locker{ mRealtimeLock };
 
    // Add to list of active effects
-   mStates.emplace_back( std::make_unique< RealtimeEffectState >( *effect ) );
-   auto &state = mStates.back();
+   auto pState = std::make_unique< RealtimeEffectState >( *effect );
+   auto &state = *pState;
 
    // Initialize effect if realtime is already active
    if (mRealtimeActive)
@@ -130,26 +171,24 @@ void RealtimeEffectManager::RealtimeAddEffect(EffectClientInterface *effect)
       // Add the required processors
       for (size_t i = 0, cnt = mRealtimeChans.size(); i < cnt; i++)
       {
-         state->RealtimeAddProcessor(i, mRealtimeChans[i], mRealtimeRates[i]);
+         state.RealtimeAddProcessor(i, mRealtimeChans[i], mRealtimeRates[i]);
       }
    }
-   
 
-   // Allow RealtimeProcess() to, well, process 
-   RealtimeResume();
+   // Effects are initially suspended; let this one process, unless all are
+   // suspended, before the audio thread can see it.  The others go on
+   // processing meanwhile.
+   if (!mRealtimeSuspended)
+      state.RealtimeResume();
+
+   mStates.push_back( std::move( pState ) );
+   PublishChain();
 }
 
 void RealtimeEffectManager::RealtimeRemoveEffect(EffectClientInterface *effect)
 {
-   // Block RealtimeProcess()
-   RealtimeSuspend();
+   wxCriticalSectionLocker locker{ mRealtimeLock };
 
-   if (mRealtimeActive)
-   {
-      // Cleanup realtime processing
-      effect->RealtimeFinalize();
-   }
-      
    // Remove from list of active effects
    auto end = mStates.end();
    auto found = std::find_if( mStates.begin(), end,
@@ -157,11 +196,19 @@ void RealtimeEffectManager::RealtimeRemoveEffect(EffectClientInterface *effect)
          return &state->GetEffect() == effect;
       }
    );
-   if (found != end)
-      mStates.erase(found);
+   if (found == end)
+      return;
+   auto pState = std::move( *found );
+   mStates.erase(found);
 
-   // Allow RealtimeProcess() to, well, process 
-   RealtimeResume();
+   // After this, the audio thread is done with the effect
+   PublishChain();
+
+   if (mRealtimeActive)
+   {
+      // Cleanup realtime processing
+      effect->RealtimeFinalize();
+   }
 }
 
 void RealtimeEffectManager::RealtimeInitialize(double rate)
@@ -177,12 +224,17 @@ void RealtimeEffectManager::RealtimeInitialize(double rate)
    // initialize newly added effects
    mRealtimeActive = true;
 
+   mScratch.clear();
+
    // Tell each effect to get ready for action
    for (auto &state : mStates) {
       state->GetEffect().SetSampleRate(rate);
       state->GetEffect().RealtimeInitialize();
+      state->ResetCPUTime();
    }
 
+   StartWorkers();
+
    // Get things moving
    RealtimeResume();
 }
@@ -194,6 +246,24 @@ void RealtimeEffectManager::RealtimeAddProcessor(int group, unsigned chans, floa
 
    mRealtimeChans.push_back(chans);
    mRealtimeRates.push_back(rate);
+
+   // Allocate the buffers now, before the audio thread needs them
+   if (group >= 0) {
+      if (mScratch.size() <= size_t(group))
+         mScratch.resize(group + 1);
+      auto &scratch = mScratch[group];
+      // Round up to a cache line of 64 bytes; ScratchFrames is a multiple
+      // of one
+      enum : size_t { LineFloats = 64 / sizeof(float) };
+      scratch.chans = chans;
+      scratch.storage.reinit(chans * ScratchFrames + LineFloats - 1);
+      const auto address = reinterpret_cast<uintptr_t>(scratch.storage.get());
+      const auto misalignment = (address / sizeof(float)) % LineFloats;
+      scratch.first = scratch.storage.get() +
+         (misalignment ? LineFloats - misalignment : 0);
+      scratch.ibuf.reinit(chans);
+      scratch.obuf.reinit(chans);
+   }
 }
 
 void RealtimeEffectManager::RealtimeFinalize()
@@ -203,6 +273,7 @@ void RealtimeEffectManager::RealtimeFinalize()
 
    // It is now safe to clean up
    mRealtimeLatency = 0;
+   StopWorkers();
 
    // Tell each effect to clean up as well
    for (auto &state : mStates)
@@ -211,6 +282,7 @@ void RealtimeEffectManager::RealtimeFinalize()
    // Reset processor parameters
    mRealtimeChans.clear();
    mRealtimeRates.clear();
+   mScratch.clear();
 
    // No longer active
    mRealtimeActive = false;
@@ -218,35 +290,29 @@ void RealtimeEffectManager::RealtimeFinalize()
 
 void RealtimeEffectManager::RealtimeSuspend()
 {
-   mRealtimeLock.Enter();
+   wxCriticalSectionLocker locker{ mRealtimeLock };
 
    // Already suspended...bail
    if (mRealtimeSuspended)
-   {
-      mRealtimeLock.Leave();
       return;
-   }
 
-   // Show that we aren't going to be doing anything
+   // Show that we aren't going to be doing anything, and wait for any
+   // processing that had begun
    mRealtimeSuspended = true;
+   Synchronize();
 
    // And make sure the effects don't either
    for (auto &state : mStates)
       state->RealtimeSuspend();
-
-   mRealtimeLock.Leave();
 }
 
 void RealtimeEffectManager::RealtimeResume()
 {
-   mRealtimeLock.Enter();
+   wxCriticalSectionLocker locker{ mRealtimeLock };
 
    // Already running...bail
    if (!mRealtimeSuspended)
-   {
-      mRealtimeLock.Leave();
       return;
-   }
 
    // Tell the effects to get ready for more action
    for (auto &state : mStates)
@@ -254,8 +320,6 @@ void RealtimeEffectManager::RealtimeResume()
 
    // And we should too
    mRealtimeSuspended = false;
-
-   mRealtimeLock.Leave();
 }
 
 //
@@ -263,21 +327,22 @@ void RealtimeEffectManager::RealtimeResume()
 //
 void RealtimeEffectManager::RealtimeProcessStart()
 {
-   // Protect ourselves from the main thread
-   mRealtimeLock.Enter();
+   // Announce ourselves to the main thread, which won't reclaim the chain
+   // meanwhile; never wait for it
+   ++mReaders;
+   auto cleanup = finally( [this]{ --mReaders; } );
 
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended.
-   if (!mRealtimeSuspended)
+   const auto pChain = mpChain.load();
+   if (!mRealtimeSuspended && pChain)
    {
-      for (auto &state : mStates)
+      for (auto pState : *pChain)
       {
-         if (state->IsRealtimeActive())
-            state->GetEffect().RealtimeProcessStart();
+         if (pState->IsRealtimeActive())
+            pState->GetEffect().RealtimeProcessStart();
       }
    }
-
-   mRealtimeLock.Leave();
 }
 
 //
@@ -285,69 +350,79 @@ void RealtimeEffectManager::RealtimeProcessStart()
 //
 size_t RealtimeEffectManager::RealtimeProcess(int group, unsigned chans, float **buffers, size_t numSamples)
 {
-   // Protect ourselves from the main thread
-   mRealtimeLock.Enter();
+   // Announce ourselves to the main thread, which won't reclaim the chain
+   // meanwhile; never wait for it
+   ++mReaders;
+   auto cleanup = finally( [this]{ --mReaders; } );
 
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended, so allow the samples to pass as-is.
-   if (mRealtimeSuspended || mStates.empty())
+   const auto pChain = mpChain.load();
+   if (mRealtimeSuspended || !pChain || pChain->empty())
+   {
+      return numSamples;
+   }
+
+   // Buffers were allocated in RealtimeAddProcessor
+   if (group < 0 || size_t(group) >= mScratch.size() ||
+       mScratch[group].chans < chans)
    {
-      mRealtimeLock.Leave();
       return numSamples;
    }
+   auto &scratch = mScratch[group];
+   float **ibuf = scratch.ibuf.get();
+   float **obuf = scratch.obuf.get();
 
    // Remember when we started so we can calculate the amount of latency we
    // are introducing
-   wxMilliClock_t start = wxGetUTCTimeMillis();
+   using Clock = std::chrono::steady_clock;
+   const auto start = Clock::now();
 
-   // Allocate the in/out buffer arrays
-   float **ibuf = (float **) alloca(chans * sizeof(float *));
-   float **obuf = (float **) alloca(chans * sizeof(float *));
-
-   // And populate the input with the buffers we've been given while allocating
-   // NEW output buffers
-   for (unsigned int i = 0; i < chans; i++)
+   for (size_t offset = 0; offset < numSamples; offset += ScratchFrames)
    {
-      ibuf[i] = buffers[i];
-      obuf[i] = (float *) alloca(numSamples * sizeof(float));
-   }
+      const auto count = std::min<size_t>(numSamples - offset, ScratchFrames);
 
-   // Now call each effect in the chain while swapping buffer pointers to feed the
-   // output of one effect as the input to the next effect
-   size_t called = 0;
-   for (auto &state : mStates)
-   {
-      if (state->IsRealtimeActive())
+      // Populate the input with the buffers we've been given, and the
+      // output with the scratch buffers
+      for (unsigned int i = 0; i < chans; i++)
       {
-         state->RealtimeProcess(group, chans, ibuf, obuf, numSamples);
-         called++;
+         ibuf[i] = buffers[i] + offset;
+         obuf[i] = scratch.first + i * ScratchFrames;
       }
 
-      for (unsigned int j = 0; j < chans; j++)
+      // Now call each effect in the chain while swapping buffer pointers to
+      // feed the output of one effect as the input to the next effect
+      size_t called = 0;
+      for (auto pState : *pChain)
       {
-         float *temp;
-         temp = ibuf[j];
-         ibuf[j] = obuf[j];
-         obuf[j] = temp;
+         if (pState->IsRealtimeActive())
+         {
+            const auto effectStart = Clock::now();
+            pState->RealtimeProcess(group, chans, ibuf, obuf, count);
+            pState->AddCPUTime(Clock::now() - effectStart);
+            called++;
+         }
+
+         for (unsigned int j = 0; j < chans; j++)
+            std::swap(ibuf[j], obuf[j]);
       }
-   }
 
-   // Once we're done, we might wind up with the last effect storing its results
-   // in the temporary buffers.  If that's the case, we need to copy it over to
-   // the caller's buffers.  This happens when the number of effects proccessed
-   // is odd.
-   if (called & 1)
-   {
-      for (unsigned int i = 0; i < chans; i++)
+      // Once we're done, we might wind up with the last effect storing its
+      // results in the scratch buffers.  If that's the case, we need to copy
+      // it over to the caller's buffers.  This happens when the number of
+      // effects proccessed is odd.
+      if (called & 1)
       {
-         memcpy(buffers[i], ibuf[i], numSamples * sizeof(float));
+         for (unsigned int i = 0; i < chans; i++)
+         {
+            memcpy(buffers[i] + offset, ibuf[i], count * sizeof(float));
+         }
       }
    }
 
    // Remember the latency
-   mRealtimeLatency = (int) (wxGetUTCTimeMillis() - start).GetValue();
-
-   mRealtimeLock.Leave();
+   mRealtimeLatency = (int) std::chrono::duration_cast<
+      std::chrono::milliseconds >(Clock::now() - start).count();
 
    //
    // This is wrong...needs to handle tails
@@ -360,21 +435,22 @@ size_t RealtimeEffectManager::RealtimeProcess(int group, unsigned chans, float *
 //
 void RealtimeEffectManager::RealtimeProcessEnd()
 {
-   // Protect ourselves from the main thread
-   mRealtimeLock.Enter();
+   // Announce ourselves to the main thread, which won't reclaim the chain
+   // meanwhile; never wait for it
+   ++mReaders;
+   auto cleanup = finally( [this]{ --mReaders; } );
 
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended.
-   if (!mRealtimeSuspended)
+   const auto pChain = mpChain.load();
+   if (!mRealtimeSuspended && pChain)
    {
-      for (auto &state : mStates)
+      for (auto pState : *pChain)
       {
-         if (state->IsRealtimeActive())
-            state->GetEffect().RealtimeProcessEnd();
+         if (pState->IsRealtimeActive())
+            pState->GetEffect().RealtimeProcessEnd();
       }
    }
-
-   mRealtimeLock.Leave();
 }
 
 int RealtimeEffectManager::GetRealtimeLatency()
@@ -382,6 +458,103 @@ int RealtimeEffectManager::GetRealtimeLatency()
    return mRealtimeLatency;
 }
 
+double RealtimeEffectManager::GetRealtimeCPUTime(EffectClientInterface *effect)
+{
+   wxCriticalSectionLocker locker{ mRealtimeLock };
+
+   for (auto &state : mStates)
+      if (&state->GetEffect() == effect)
+         return std::chrono::duration<double>(state->GetCPUTime()).count();
+   return 0.0;
+}
+
+void RealtimeEffectManager::StartWorkers()
+{
+   StopWorkers();
+
+   // A few threads are enough to keep up with playback of many tracks; leave
+   // a core for the audio thread itself
+   const auto nCores = std::thread::hardware_concurrency();
+   const auto nWorkers = std::min(3u, nCores > 1 ? nCores - 1 : 0u);
+   for (unsigned ii = 0; ii < nWorkers; ++ii)
+      mWorkers.emplace_back( [this]{
+         unsigned generation = 0;
+         while (true) {
+            {
+               std::unique_lock<std::mutex> lock{ mWorkMutex };
+               mWorkCondition.wait( lock, [&]{
+                  return mStopWorkers || mWorkGeneration != generation; } );
+               if (mStopWorkers)
+                  return;
+               generation = mWorkGeneration;
+               ++mBusyWorkers;
+            }
+            DoJobs();
+            --mBusyWorkers;
+         }
+      } );
+}
+
+void RealtimeEffectManager::StopWorkers()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mWorkMutex };
+      mStopWorkers = true;
+   }
+   mWorkCondition.notify_all();
+   for (auto &worker : mWorkers)
+      worker.join();
+   mWorkers.clear();
+   mStopWorkers = false;
+}
+
+void RealtimeEffectManager::DoJobs()
+{
+   for (size_t ii; (ii = mNextJob++) < mNJobs.load();) {
+      const auto &job = mpJobs.load()[ii];
+      RealtimeProcess(job.group, job.chans, job.buffers, job.numSamples);
+      ++mJobsDone;
+   }
+}
+
+//
+// This will be called in a different thread than the main GUI thread.
+//
+void RealtimeEffectManager::RealtimeProcessJobs(const Job *jobs, size_t nJobs)
+{
+   if (mWorkers.empty() || nJobs < 2) {
+      for (size_t ii = 0; ii < nJobs; ++ii)
+         RealtimeProcess(jobs[ii].group, jobs[ii].chans,
+            jobs[ii].buffers, jobs[ii].numSamples);
+      return;
+   }
+
+   {
+      // A worker late for the previous jobs may still be looking at their
+      // counters; let it finish before reusing them.  The workers hold the
+      // lock only in waking, so this waits little.
+      RealtimeSafety::Exemption exemption;
+      std::unique_lock<std::mutex> lock{ mWorkMutex };
+      while (mBusyWorkers.load() > 0) {
+         lock.unlock();
+         std::this_thread::yield();
+         lock.lock();
+      }
+      mNJobs = 0;
+      mpJobs = jobs;
+      mNextJob = 0;
+      mJobsDone = 0;
+      mNJobs = nJobs;
+      ++mWorkGeneration;
+   }
+   mWorkCondition.notify_all();
+
+   // Work too, and then wait for the jobs still being done by the workers
+   DoJobs();
+   while (mJobsDone.load() < nJobs)
+      std::this_thread::yield();
+}
+
 RealtimeEffectState::RealtimeEffectState( EffectClientInterface &effect )
    : mEffect{ effect }
 {
@@ -506,6 +679,13 @@ size_t RealtimeEffectState::RealtimeProcess(int group,
 
    int processor = mGroupProcessor[group];
 
+   // One group at a time, because effects may share state among the
+   // processors of the groups
+   while (mProcessing.test_and_set(std::memory_order_acquire))
+      std::this_thread::yield();
+   auto cleanup = finally( [this]{
+      mProcessing.clear(std::memory_order_release); } );
+
    // Call the client until we run out of input or output channels
    while (ichans > 0 && ochans > 0)
    {
@@ -11,10 +11,16 @@
 #ifndef __AUDACITY_REALTIME_EFFECT_MANAGER__
 #define __AUDACITY_REALTIME_EFFECT_MANAGER__
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <wx/thread.h>
 
+#include "MemoryX.h"
+
 class EffectClientInterface;
 class RealtimeEffectState;
 
@@ -41,18 +47,86 @@ public:
    size_t RealtimeProcess(int group, unsigned chans, float **buffers, size_t numSamples);
    void RealtimeProcessEnd();
    int GetRealtimeLatency();
+   // Seconds of the audio thread (and workers) spent in the effect since
+   // RealtimeInitialize, over all groups; 0 if it is not in the chain
+   double GetRealtimeCPUTime(EffectClientInterface *effect);
+
+   // Arguments of a call to RealtimeProcess
+   struct Job
+   {
+      int group;
+      unsigned chans;
+      float **buffers;
+      size_t numSamples;
+   };
+   // Whether RealtimeProcessJobs has worker threads to share the jobs with
+   bool RealtimeHasWorkers() const { return !mWorkers.empty(); }
+   // Do RealtimeProcess for each of the jobs, on the workers and on this
+   // thread at once, returning when all are done.  Each effect still
+   // processes only one group at a time.
+   void RealtimeProcessJobs(const Job *jobs, size_t nJobs);
 
 private:
    RealtimeEffectManager();
    ~RealtimeEffectManager();
 
+   // The effects as the audio thread sees them:  never changed once
+   // published, but replaced whole
+   using Chain = std::vector< RealtimeEffectState* >;
+
+   // Publish a NEW chain of the effects in mStates, and delete the old one
+   // once the audio thread can no longer be using it
+   void PublishChain();
+   // Wait until the audio thread is out of any processing that began before
+   void Synchronize();
+
+   // Buffers for the output of the effects of one group, preallocated so
+   // that processing allocates nothing
+   struct GroupScratch
+   {
+      unsigned chans{ 0 };
+      // chans buffers of ScratchFrames each, starting on a cache line
+      Floats storage;
+      float *first{ nullptr };
+      ArrayOf<float*> ibuf;
+      ArrayOf<float*> obuf;
+   };
+   // Longer buffers are processed in pieces this long
+   enum : size_t { ScratchFrames = 4096 };
+
+   void StartWorkers();
+   void StopWorkers();
+   // Take jobs until there are no more
+   void DoJobs();
+
+   // Serializes the changes made by other threads; the audio thread never
+   // takes it, but only counts itself in mReaders
    wxCriticalSection mRealtimeLock;
    std::vector< std::unique_ptr<RealtimeEffectState> > mStates;
-   int mRealtimeLatency;
-   bool mRealtimeSuspended;
+   std::atomic<const Chain*> mpChain{ nullptr };
+   std::atomic<int> mReaders{ 0 };
+   std::atomic<int> mRealtimeLatency;
+   std::atomic<bool> mRealtimeSuspended;
    bool mRealtimeActive;
    std::vector<unsigned> mRealtimeChans;
    std::vector<double> mRealtimeRates;
+   // Indexed by group
+   std::vector<GroupScratch> mScratch;
+
+   // Threads that share the jobs of RealtimeProcessJobs, from
+   // RealtimeInitialize to RealtimeFinalize
+   std::vector<std::thread> mWorkers;
+   std::mutex mWorkMutex;
+   std::condition_variable mWorkCondition;
+   // Guarded by mWorkMutex, which the workers hold only to wait for jobs
+   unsigned mWorkGeneration{ 0 };
+   bool mStopWorkers{ false };
+   // Workers that have taken up a generation of jobs
+   std::atomic<int> mBusyWorkers{ 0 };
+   std::atomic<const Job*> mpJobs{ nullptr };
+   std::atomic<size_t> mNJobs{ 0 };
+   std::atomic<size_t> mNextJob{ 0 };
+   std::atomic<size_t> mJobsDone{ 0 };
 };
 
 #endif
@@ -32,6 +32,7 @@
 #include "../LabelTrack.h"
 #include "../Shuttle.h"
 #include "../ShuttleGui.h"
+#include "../WaveClip.h"
 #include "../WaveTrack.h"
 #include "../widgets/NumericTextCtrl.h"
 #include "../widgets/valnum.h"
@@ -144,6 +145,21 @@ bool EffectRepeat::Process()
             return;
 
          auto dest = track->Copy(mT0, mT1);
+         auto &destTrack = static_cast<WaveTrack&>(*dest);
+         if (destTrack.GetNumClips() == 1) {
+            auto clip = destTrack.GetClipByIndex(0);
+            if (clip->GetOffset() == 0 && clip->GetNumSamples() == len) {
+               // The selection is one stretch of one clip:  repeat it within
+               // the copy, sharing its blocks, and paste only once
+               clip->Repeat(repeatCount - 1);
+               track->Paste(tc, dest.get());
+               tc += tLen * repeatCount;
+               if (tc > maxDestLen)
+                  maxDestLen = tc;
+               nTrack++;
+               return;
+            }
+         }
          for(int j=0; j<repeatCount; j++)
          {
             if (TrackProgress(nTrack, j / repeatCount)) // TrackProgress returns true on Cancel.
@@ -18,6 +18,8 @@
 #include "Reverb.h"
 #include "LoadEffects.h"
 
+#include <thread>
+
 #include <wx/arrstr.h>
 #include <wx/checkbox.h>
 #include <wx/intl.h>
@@ -135,6 +137,7 @@ EffectReverb::EffectReverb()
 
 EffectReverb::~EffectReverb()
 {
+   FreeReverbs();
 }
 
 // ComponentInterface implementation
@@ -175,16 +178,47 @@ unsigned EffectReverb::GetAudioOutCount()
 
 static size_t BLOCK = 16384;
 
+static bool SameSettings(
+   const EffectReverb::Params &a, const EffectReverb::Params &b)
+{
+   // The parameters that reverb_create uses
+   return a.mRoomSize == b.mRoomSize &&
+      a.mPreDelay == b.mPreDelay &&
+      a.mReverberance == b.mReverberance &&
+      a.mHfDamping == b.mHfDamping &&
+      a.mToneLow == b.mToneLow &&
+      a.mToneHigh == b.mToneHigh &&
+      a.mWetGain == b.mWetGain &&
+      a.mStereoWidth == b.mStereoWidth;
+}
+
 bool EffectReverb::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames chanMap)
 {
    bool isStereo = false;
-   mNumChans = 1;
+   unsigned numChans = 1;
    if (chanMap && chanMap[0] != ChannelNameEOL && chanMap[1] == ChannelNameFrontRight)
    {
       isStereo = true;
-      mNumChans = 2;
+      numChans = 2;
    }
 
+   // The reverbs of the previous track serve again, cleared, if they were
+   // made the same way; their delay lines are allocated only once
+   if (mP && numChans == mNumChans && mSampleRate == mCreatedRate &&
+       SameSettings(mParams, mCreatedParams))
+   {
+      for (unsigned int i = 0; i < mNumChans; i++)
+      {
+         reverb_clear(&mP[i].reverb, mSampleRate, mParams.mPreDelay);
+      }
+      return true;
+   }
+
+   FreeReverbs();
+   mNumChans = numChans;
+   mCreatedRate = mSampleRate;
+   mCreatedParams = mParams;
+
    mP = (Reverb_priv_t *) calloc(sizeof(*mP), mNumChans);
 
    for (unsigned int i = 0; i < mNumChans; i++)
@@ -208,16 +242,33 @@ bool EffectReverb::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelName
 
 bool EffectReverb::ProcessFinalize()
 {
+   // The reverbs are kept for the next track, until End()
+   return true;
+}
+
+void EffectReverb::End()
+{
+   FreeReverbs();
+}
+
+void EffectReverb::FreeReverbs()
+{
+   if (!mP)
+      return;
+
    for (unsigned int i = 0; i < mNumChans; i++)
    {
       reverb_delete(&mP[i].reverb);
    }
 
    free(mP);
-
-   return true;
+   mP = nullptr;
 }
 
+// Chunks at least this long are worth starting a thread for the second
+// channel of a stereo track
+static const size_t MinParallelLen = 4096;
+
 size_t EffectReverb::ProcessBlock(float **inBlock, float **outBlock, size_t blockLen)
 {
    float *ichans[2] = {NULL, NULL};
@@ -231,17 +282,36 @@ size_t EffectReverb::ProcessBlock(float **inBlock, float **outBlock, size_t bloc
    
    float const dryMult = mParams.mWetOnly ? 0 : dB_to_linear(mParams.mDryGain);
 
+   const bool parallel = mNumChans == 2 && !IsParallelProcessor() &&
+      std::thread::hardware_concurrency() > 1;
+
    auto remaining = blockLen;
 
    while (remaining)
    {
       auto len = std::min(remaining, decltype(remaining)(BLOCK));
-      for (unsigned int c = 0; c < mNumChans; c++)
+      auto process = [&](unsigned int c)
       {
          // Write the input samples to the reverb fifo.  Returned value is the address of the
          // fifo buffer which contains a copy of the input samples.
          mP[c].dry = (float *) fifo_write(&mP[c].reverb.input_fifo, len, ichans[c]);
          reverb_process(&mP[c].reverb, len);
+      };
+
+      // Each channel has its own reverb state, so the second can run on
+      // another core, unless the cores are busy with other tracks already
+      if (parallel && len >= MinParallelLen)
+      {
+         std::thread thread{ process, 1u };
+         process(0);
+         thread.join();
+      }
+      else
+      {
+         for (unsigned int c = 0; c < mNumChans; c++)
+         {
+            process(c);
+         }
       }
 
       if (mNumChans == 2)
@@ -366,6 +436,11 @@ bool EffectReverb::LoadFactoryPreset(int id)
 
 // Effect implementation
 
+std::unique_ptr<Effect> EffectReverb::MakeParallelProcessor()
+{
+   return std::make_unique<EffectReverb>();
+}
+
 bool EffectReverb::Startup()
 {
    wxString base = wxT("/Effects/Reverb/");
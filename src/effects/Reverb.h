@@ -72,10 +72,14 @@ public:
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
+   void End() override;
 
 private:
    // EffectReverb implementation
 
+   void FreeReverbs();
+
    void SetTitle(const wxString & name = {});
 
 #define SpinSliderHandlers(n) \
@@ -96,7 +100,10 @@ private:
 
 private:
    unsigned mNumChans {};
-   Reverb_priv_t *mP;
+   Reverb_priv_t *mP {};
+   // The settings that made the reverbs in mP
+   double mCreatedRate {};
+   Params mCreatedParams {};
 
    Params mParams;
 
@@ -199,6 +199,26 @@ static void filter_array_process(filter_array_t * p,
    }
 }
 
+static void filter_clear(filter_t * p)
+{
+   memset(p->buffer, 0, p->size * sizeof(*p->buffer));
+   p->ptr = p->buffer;
+   p->store = 0;
+}
+
+/* Back to the state filter_array_create left, without allocating */
+static void filter_array_clear(filter_array_t * p)
+{
+   size_t i;
+
+   for (i = 0; i < array_length(comb_lengths); ++i)
+      filter_clear(&p->comb[i]);
+   for (i = 0; i < array_length(allpass_lengths); ++i)
+      filter_clear(&p->allpass[i]);
+   for (i = 0; i < array_length(p->one_pole); ++i)
+      p->one_pole[i].i1 = p->one_pole[i].o1 = 0;
+}
+
 static void filter_array_delete(filter_array_t * p)
 {
    size_t i;
@@ -258,6 +278,18 @@ static void reverb_process(reverb_t * p, size_t length)
    fifo_read(&p->input_fifo, length, NULL);
 }
 
+/* Back to the state reverb_create left, for the same settings */
+static void reverb_clear(reverb_t * p, double sample_rate_Hz,
+      double pre_delay_ms)
+{
+   size_t i, delay = pre_delay_ms / 1000 * sample_rate_Hz + .5;
+
+   fifo_clear(&p->input_fifo);
+   memset(fifo_write(&p->input_fifo, delay, 0), 0, delay * sizeof(float));
+   for (i = 0; i < 2 && p->out[i]; ++i)
+      filter_array_clear(p->chan + i);
+}
+
 static void reverb_delete(reverb_t * p)
 {
    size_t i;
@@ -172,7 +172,7 @@ bool EffectReverse::ProcessOneWave(int count, WaveTrack * track, sampleCount sta
          auto revEnd = (clipEnd >= end)? end: clipEnd;
          auto revLen = revEnd - revStart;
          if (revEnd >= revStart) {
-            if(!ProcessOneClip(count, track, revStart, revLen, start, end)) // reverse the clip
+            if(!ProcessOneClip(count, clip, revStart, revLen, start, end)) // reverse the clip
             {
                rValue = false;
                break;
@@ -211,45 +211,16 @@ bool EffectReverse::ProcessOneWave(int count, WaveTrack * track, sampleCount sta
    return rValue;
 }
 
-bool EffectReverse::ProcessOneClip(int count, WaveTrack *track,
+bool EffectReverse::ProcessOneClip(int count, WaveClip *clip,
                                sampleCount start, sampleCount len,
                                sampleCount originalStart, sampleCount originalEnd)
 {
-   bool rc = true;
-   // keep track of two blocks whose data we will swap
-   auto first = start;
-
-   auto blockSize = track->GetMaxBlockSize();
-   float tmp;
-   Floats buffer1{ blockSize };
-   Floats buffer2{ blockSize };
+   // The sequence reverses the samples in their own format, block by block,
+   // sharing blocks of constant value such as silence
+   clip->ReverseSamples(start - clip->GetStartSample(), len);
 
    auto originalLen = originalEnd - originalStart;
-
-   while (len > 1) {
-      auto block =
-         limitSampleBufferSize( track->GetBestBlockSize(first), len / 2 );
-      auto second = first + (len - block);
-
-      track->Get((samplePtr)buffer1.get(), floatSample, first, block);
-      track->Get((samplePtr)buffer2.get(), floatSample, second, block);
-      for (decltype(block) i = 0; i < block; i++) {
-         tmp = buffer1[i];
-         buffer1[i] = buffer2[block-i-1];
-         buffer2[block-i-1] = tmp;
-      }
-      track->Set((samplePtr)buffer1.get(), floatSample, first, block);
-      track->Set((samplePtr)buffer2.get(), floatSample, second, block);
-
-      len -= 2 * block;
-      first += block;
-
-      if( TrackProgress(count, 2 * ( first - originalStart ).as_double() /
-                        originalLen.as_double() ) ) {
-         rc = false;
-         break;
-      }
-   }
-
-   return rc;
+   // TrackProgress returns true on Cancel
+   return !TrackProgress(count,
+      ( start + len - originalStart ).as_double() / originalLen.as_double() );
 }
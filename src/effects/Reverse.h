@@ -15,6 +15,8 @@
 
 #include "Effect.h"
 
+class WaveClip;
+
 class EffectReverse final : public Effect
 {
 public:
@@ -40,7 +42,7 @@ public:
 private:
    // EffectReverse implementation
 
-   bool ProcessOneClip(int count, WaveTrack* track,
+   bool ProcessOneClip(int count, WaveClip* clip,
                    sampleCount start, sampleCount len, sampleCount originalStart, sampleCount originalEnd);
    bool ProcessOneWave(int count, WaveTrack* track, sampleCount start, sampleCount len);
  };
@@ -18,6 +18,11 @@ effect that uses SoundTouch to do its processing (ChangeTempo
 #include "SoundTouchEffect.h"
 
 #include <math.h>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+#include <wx/utils.h>
 
 #include "../LabelTrack.h"
 #include "../WaveTrack.h"
@@ -66,11 +71,11 @@ bool EffectSoundTouch::ProcessNoteTrack(NoteTrack *nt, const TimeWarper &warper)
 }
 #endif
 
-bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
+bool EffectSoundTouch::ProcessWithTimeWarper(InitFunction initer,
+                                             const TimeWarper &warper)
 {
-   // Assumes that mSoundTouch has already been initialized
-   // by the subclass for subclass-specific parameters. The
-   // time warper should also be set.
+   // The time warper should already be set for the subclass-specific
+   // parameters that initer gives to each SoundTouch.
 
    // Check if this effect will alter the selection length; if so, we need
    // to operate on sync-lock selected tracks.
@@ -87,6 +92,9 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
    mCurTrackNum = 0;
    m_maxNewLength = 0.0;
 
+   // Wave tracks are gathered, to be processed together afterwards
+   std::vector<WaveJob> jobs;
+
    mOutputTracks->Leaders().VisitWhile( bGoodResult,
       [&]( LabelTrack *lt, const Track::Fallthrough &fallthrough ) {
          if ( !(lt->GetSelected() || (mustSync && lt->IsSyncLockSelected())) )
@@ -133,30 +141,14 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
                t = rightTrack->GetEndTime();
                t = wxMin(mT1, t);
                mCurT1 = wxMax(mCurT1, t);
+            }
 
-               //Transform the marker timepoints to samples
-               auto start = leftTrack->TimeToLongSamples(mCurT0);
-               auto end = leftTrack->TimeToLongSamples(mCurT1);
-
-               //Inform soundtouch there's 2 channels
-               mSoundTouch->setChannels(2);
-
-               //ProcessStereo() (implemented below) processes a stereo track
-               if (!ProcessStereo(leftTrack, rightTrack, start, end, warper))
-                  bGoodResult = false;
+            // Make the output tracks here, not on the worker threads
+            jobs.push_back({ leftTrack, rightTrack, mCurT0, mCurT1,
+               mCurTrackNum, leftTrack->EmptyCopy(),
+               rightTrack ? rightTrack->EmptyCopy() : nullptr });
+            if ( rightTrack )
                mCurTrackNum++; // Increment for rightTrack, too.
-            } else {
-               //Transform the marker timepoints to samples
-               auto start = leftTrack->TimeToLongSamples(mCurT0);
-               auto end = leftTrack->TimeToLongSamples(mCurT1);
-
-               //Inform soundtouch there's a single channel
-               mSoundTouch->setChannels(1);
-
-               //ProcessOne() (implemented below) processes a single track
-               if (!ProcessOne(leftTrack, start, end, warper))
-                  bGoodResult = false;
-            }
          }
          mCurTrackNum++;
       },
@@ -167,6 +159,9 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
       }
    );
 
+   if (bGoodResult)
+      bGoodResult = ProcessWaveJobs(initer, jobs, warper);
+
    if (bGoodResult)
       ReplaceProcessedTracks(bGoodResult);
 
@@ -176,20 +171,118 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
    return bGoodResult;
 }
 
-void EffectSoundTouch::End()
+bool EffectSoundTouch::ProcessWaveJobs(const InitFunction &initer,
+   std::vector<WaveJob> &jobs, const TimeWarper &warper)
 {
-   mSoundTouch.reset();
+   const auto process =
+      [&](WaveJob &job, const ProgressFunction &progress) -> bool {
+      soundtouch::SoundTouch soundTouch;
+      initer(&soundTouch);
+      soundTouch.setSampleRate((unsigned int)(job.left->GetRate() + 0.5));
+      if (job.right) {
+         //Inform soundtouch there's 2 channels
+         soundTouch.setChannels(2);
+         return ProcessStereo(soundTouch, job, progress);
+      }
+      else {
+         //Inform soundtouch there's a single channel
+         soundTouch.setChannels(1);
+         return ProcessOne(soundTouch, job, progress);
+      }
+   };
+
+   const auto nJobs = jobs.size();
+   const auto nThreads =
+      std::min<size_t>(nJobs, std::thread::hardware_concurrency());
+   if (nThreads <= 1) {
+      for (auto &job : jobs)
+         if (!process(job, [this](int whichTrack, double frac) {
+               return TrackProgress(whichTrack, frac); }))
+            return false;
+   }
+   else {
+      // Each SoundTouch holds the state of only one job, so the jobs are
+      // independent; the main thread sums their progress
+      std::vector< std::atomic<double> > fractions(nJobs);
+      std::atomic<bool> stopped{ false };
+      std::atomic<size_t> next{ 0 };
+      std::atomic<size_t> nDone{ 0 };
+      std::vector<std::exception_ptr> errors(nThreads);
+      {
+         std::vector<std::thread> threads;
+         // Whatever happens, wait for the threads before the tracks go away
+         auto cleanup = finally( [&] {
+            stopped.store(true);
+            for (auto &thread : threads)
+               thread.join();
+         } );
+         for (size_t ii = 0; ii < nThreads; ++ii)
+            threads.emplace_back( [&, ii]{
+               try {
+                  for (size_t jj = 0;
+                       !stopped.load() && (jj = next++) < nJobs;) {
+                     auto &job = jobs[jj];
+                     auto &fraction = fractions[jj];
+                     if (!process(job, [&](int whichTrack, double frac) -> bool {
+                           fraction.store(whichTrack - job.trackNum + frac);
+                           return stopped.load(); })) {
+                        stopped.store(true);
+                        break;
+                     }
+                     ++nDone;
+                  }
+               }
+               catch (...) {
+                  errors[ii] = std::current_exception();
+                  stopped.store(true);
+               }
+            } );
+
+         while (nDone.load() < nJobs && !stopped.load()) {
+            double sum = 0;
+            for (const auto &fraction : fractions)
+               sum += fraction.load();
+            if (TotalProgress(sum / GetNumWaveTracks()))
+               stopped.store(true);
+            else
+               ::wxMilliSleep(10);
+         }
+      }
+      for (auto &error : errors)
+         if (error)
+            std::rethrow_exception(error);
+      if (nDone.load() < nJobs)
+         return false;
+   }
+
+   // Take the output tracks and insert them in place of the original
+   // sample data
+   for (auto &job : jobs) {
+      job.left->ClearAndPaste(
+         job.t0, job.t1, job.outputLeft.get(), false, true, &warper);
+      m_maxNewLength = wxMax(m_maxNewLength, job.outputLeft->GetEndTime());
+      if (job.right) {
+         job.right->ClearAndPaste(
+            job.t0, job.t1, job.outputRight.get(), false, true, &warper);
+         m_maxNewLength =
+            wxMax(m_maxNewLength, job.outputRight->GetEndTime());
+      }
+   }
+
+   return true;
 }
 
 //ProcessOne() takes a track, transforms it to bunch of buffer-blocks,
 //and executes ProcessSoundTouch on these blocks
-bool EffectSoundTouch::ProcessOne(WaveTrack *track,
-                                  sampleCount start, sampleCount end,
-                                  const TimeWarper &warper)
+bool EffectSoundTouch::ProcessOne(soundtouch::SoundTouch &soundTouch,
+   WaveJob &job, const ProgressFunction &progress)
 {
-   mSoundTouch->setSampleRate((unsigned int)(track->GetRate()+0.5));
+   const auto track = job.left;
+   const auto outputTrack = job.outputLeft.get();
 
-   auto outputTrack = track->EmptyCopy();
+   //Transform the marker timepoints to samples
+   auto start = track->TimeToLongSamples(job.t0);
+   auto end = track->TimeToLongSamples(job.t1);
 
    //Get the length of the buffer (as double). len is
    //used simple to calculate a progress meter, so it is easier
@@ -213,13 +306,13 @@ bool EffectSoundTouch::ProcessOne(WaveTrack *track,
          track->Get((samplePtr)buffer.get(), floatSample, s, block);
 
          //Add samples to SoundTouch
-         mSoundTouch->putSamples(buffer.get(), block);
+         soundTouch.putSamples(buffer.get(), block);
 
          //Get back samples from SoundTouch
-         unsigned int outputCount = mSoundTouch->numSamples();
+         unsigned int outputCount = soundTouch.numSamples();
          if (outputCount > 0) {
             Floats buffer2{ outputCount };
-            mSoundTouch->receiveSamples(buffer2.get(), outputCount);
+            soundTouch.receiveSamples(buffer2.get(), outputCount);
             outputTrack->Append((samplePtr)buffer2.get(), floatSample, outputCount);
          }
 
@@ -227,17 +320,17 @@ bool EffectSoundTouch::ProcessOne(WaveTrack *track,
          s += block;
 
          //Update the Progress meter
-         if (TrackProgress(mCurTrackNum, (s - start).as_double() / len))
+         if (progress(job.trackNum, (s - start).as_double() / len))
             return false;
       }
 
       // Tell SoundTouch to finish processing any remaining samples
-      mSoundTouch->flush();   // this should only be used for changeTempo - it dumps data otherwise with pRateTransposer->clear();
+      soundTouch.flush();   // this should only be used for changeTempo - it dumps data otherwise with pRateTransposer->clear();
 
-      unsigned int outputCount = mSoundTouch->numSamples();
+      unsigned int outputCount = soundTouch.numSamples();
       if (outputCount > 0) {
          Floats buffer2{ outputCount };
-         mSoundTouch->receiveSamples(buffer2.get(), outputCount);
+         soundTouch.receiveSamples(buffer2.get(), outputCount);
          outputTrack->Append((samplePtr)buffer2.get(), floatSample, outputCount);
       }
 
@@ -245,25 +338,21 @@ bool EffectSoundTouch::ProcessOne(WaveTrack *track,
       outputTrack->Flush();
    }
 
-   // Take the output track and insert it in place of the original
-   // sample data
-   track->ClearAndPaste(mCurT0, mCurT1, outputTrack.get(), false, true, &warper);
-
-   double newLength = outputTrack->GetEndTime();
-   m_maxNewLength = wxMax(m_maxNewLength, newLength);
-
    //Return true because the effect processing succeeded.
    return true;
 }
 
-bool EffectSoundTouch::ProcessStereo(
-   WaveTrack* leftTrack, WaveTrack* rightTrack,
-   sampleCount start, sampleCount end, const TimeWarper &warper)
+bool EffectSoundTouch::ProcessStereo(soundtouch::SoundTouch &soundTouch,
+   WaveJob &job, const ProgressFunction &progress)
 {
-   mSoundTouch->setSampleRate((unsigned int)(leftTrack->GetRate() + 0.5));
+   const auto leftTrack = job.left;
+   const auto rightTrack = job.right;
+   const auto outputLeftTrack = job.outputLeft.get();
+   const auto outputRightTrack = job.outputRight.get();
 
-   auto outputLeftTrack = leftTrack->EmptyCopy();
-   auto outputRightTrack = rightTrack->EmptyCopy();
+   //Transform the marker timepoints to samples
+   auto start = leftTrack->TimeToLongSamples(job.t0);
+   auto end = leftTrack->TimeToLongSamples(job.t1);
 
    //Get the length of the buffer (as double). len is
    //used simple to calculate a progress meter, so it is easier
@@ -302,19 +391,19 @@ bool EffectSoundTouch::ProcessStereo(
          }
 
          //Add samples to SoundTouch
-         mSoundTouch->putSamples(soundTouchBuffer.get(), blockSize);
+         soundTouch.putSamples(soundTouchBuffer.get(), blockSize);
 
          //Get back samples from SoundTouch
-         unsigned int outputCount = mSoundTouch->numSamples();
+         unsigned int outputCount = soundTouch.numSamples();
          if (outputCount > 0)
-            this->ProcessStereoResults(outputCount, outputLeftTrack.get(), outputRightTrack.get());
+            this->ProcessStereoResults(soundTouch, outputCount, outputLeftTrack, outputRightTrack);
 
          //Increment sourceSampleCount one blockfull of samples
          sourceSampleCount += blockSize;
 
          //Update the Progress meter
-         // mCurTrackNum is left track. Include right track.
-         int nWhichTrack = mCurTrackNum;
+         // job.trackNum is left track. Include right track.
+         int nWhichTrack = job.trackNum;
          double frac = (sourceSampleCount - start).as_double() / len;
          if (frac < 0.5)
             frac *= 2.0; // Show twice as far for each track, because we're doing 2 at once.
@@ -324,45 +413,33 @@ bool EffectSoundTouch::ProcessStereo(
             frac -= 0.5;
             frac *= 2.0; // Show twice as far for each track, because we're doing 2 at once.
          }
-         if (TrackProgress(nWhichTrack, frac))
+         if (progress(nWhichTrack, frac))
             return false;
       }
 
       // Tell SoundTouch to finish processing any remaining samples
-      mSoundTouch->flush();
+      soundTouch.flush();
 
-      unsigned int outputCount = mSoundTouch->numSamples();
+      unsigned int outputCount = soundTouch.numSamples();
       if (outputCount > 0)
-         this->ProcessStereoResults(outputCount, outputLeftTrack.get(), outputRightTrack.get());
+         this->ProcessStereoResults(soundTouch, outputCount, outputLeftTrack, outputRightTrack);
 
       // Flush the output WaveTracks (since they're buffered, too)
       outputLeftTrack->Flush();
       outputRightTrack->Flush();
    }
 
-   // Take the output tracks and insert in place of the original
-   // sample data.
-   leftTrack->ClearAndPaste(
-      mCurT0, mCurT1, outputLeftTrack.get(), false, true, &warper);
-   rightTrack->ClearAndPaste(
-      mCurT0, mCurT1, outputRightTrack.get(), false, true, &warper);
-
-   // Track the longest result length
-   double newLength = outputLeftTrack->GetEndTime();
-   m_maxNewLength = wxMax(m_maxNewLength, newLength);
-   newLength = outputRightTrack->GetEndTime();
-   m_maxNewLength = wxMax(m_maxNewLength, newLength);
-
    //Return true because the effect processing succeeded.
    return true;
 }
 
-bool EffectSoundTouch::ProcessStereoResults(const size_t outputCount,
+bool EffectSoundTouch::ProcessStereoResults(soundtouch::SoundTouch &soundTouch,
+                                            const size_t outputCount,
                                             WaveTrack* outputLeftTrack,
                                             WaveTrack* outputRightTrack)
 {
    Floats outputSoundTouchBuffer{ outputCount * 2 };
-   mSoundTouch->receiveSamples(outputSoundTouchBuffer.get(), outputCount);
+   soundTouch.receiveSamples(outputSoundTouchBuffer.get(), outputCount);
 
    // Dis-interleave outputSoundTouchBuffer into separate track buffers.
    Floats outputLeftBuffer{ outputCount };
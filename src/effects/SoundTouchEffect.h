@@ -21,6 +21,10 @@
 
 #include "Effect.h"
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 // forward declaration of a class defined in SoundTouch.h
 // which is not included here
 namespace soundtouch { class SoundTouch; }
@@ -33,10 +37,6 @@ class EffectSoundTouch /* not final */ : public Effect
 {
 public:
    
-   // Effect implementation
-
-   void End() override;
-
    // EffectSoundTouch implementation
 
 #ifdef USE_MIDI
@@ -48,9 +48,11 @@ public:
 protected:
    // Effect implementation
 
-   bool ProcessWithTimeWarper(const TimeWarper &warper);
+   // Gives a NEW SoundTouch the subclass-specific parameters; it may be
+   // called once for each track or stereo pair, on worker threads
+   using InitFunction = std::function< void(soundtouch::SoundTouch *soundtouch) >;
+   bool ProcessWithTimeWarper(InitFunction initer, const TimeWarper &warper);
 
-   std::unique_ptr<soundtouch::SoundTouch> mSoundTouch;
    double mCurT0;
    double mCurT1;
 
@@ -59,13 +61,29 @@ private:
 #ifdef USE_MIDI
    bool ProcessNoteTrack(NoteTrack *track, const TimeWarper &warper);
 #endif
-   bool ProcessOne(
-      WaveTrack * t, sampleCount start, sampleCount end,
-      const TimeWarper &warper);
-   bool ProcessStereo(WaveTrack* leftTrack, WaveTrack* rightTrack,
-                     sampleCount start, sampleCount end,
-                      const TimeWarper &warper);
-   bool ProcessStereoResults(const size_t outputCount,
+
+   // A mono track or stereo pair to process, and the tracks for its output
+   struct WaveJob {
+      WaveTrack *left;
+      WaveTrack *right; // null if mono
+      double t0, t1;
+      int trackNum;
+      std::shared_ptr<WaveTrack> outputLeft;
+      std::shared_ptr<WaveTrack> outputRight;
+   };
+   // Like TrackProgress; returns true to stop
+   using ProgressFunction = std::function< bool(int whichTrack, double frac) >;
+
+   // Process the jobs, in parallel if there are several, then paste the
+   // results into the tracks
+   bool ProcessWaveJobs(const InitFunction &initer,
+      std::vector<WaveJob> &jobs, const TimeWarper &warper);
+   bool ProcessOne(soundtouch::SoundTouch &soundTouch,
+      WaveJob &job, const ProgressFunction &progress);
+   bool ProcessStereo(soundtouch::SoundTouch &soundTouch,
+      WaveJob &job, const ProgressFunction &progress);
+   bool ProcessStereoResults(soundtouch::SoundTouch &soundTouch,
+                              const size_t outputCount,
                               WaveTrack* outputLeftTrack,
                               WaveTrack* outputRightTrack);
 
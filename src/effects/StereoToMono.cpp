@@ -17,7 +17,13 @@
 #include "StereoToMono.h"
 #include "LoadEffects.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
 #include <wx/intl.h>
+#include <wx/utils.h>
 
 #include "../Project.h"
 #include "../WaveTrack.h"
@@ -81,91 +87,154 @@ bool EffectStereoToMono::Process()
    this->CopyInputTracks(); // Set up mOutputTracks.
    bool bGoodResult = true;
 
-   auto trackRange = mOutputTracks->SelectedLeaders< WaveTrack >();
-   bool refreshIter = false;
-
-   int count = 0;
-   while ( trackRange.first != trackRange.second ) {
-      mLeftTrack = *trackRange.first;
-      auto channels = TrackList::Channels( mLeftTrack );
-      if (channels.size() != 2) {
+   // Find all the stereo tracks first:  downmixing them is independent, and
+   // only replacing their channels changes the list
+   std::vector<Downmix> downmixes;
+   for (auto leftTrack : mOutputTracks->SelectedLeaders< WaveTrack >()) {
+      auto channels = TrackList::Channels( leftTrack );
+      if (channels.size() != 2)
          // TODO: more-than-two-channels
-         ++ trackRange.first;
          continue;
-      }
 
-      mRightTrack = * channels.rbegin();
-
-      if ((mLeftTrack->GetRate() == mRightTrack->GetRate())) {
-         auto leftTrackStart = mLeftTrack->TimeToLongSamples(mLeftTrack->GetStartTime());
-         auto rightTrackStart = mRightTrack->TimeToLongSamples(mRightTrack->GetStartTime());
-         mStart = wxMin(leftTrackStart, rightTrackStart);
+      auto rightTrack = * channels.rbegin();
+      if (leftTrack->GetRate() != rightTrack->GetRate())
+         continue;
 
-         auto leftTrackEnd = mLeftTrack->TimeToLongSamples(mLeftTrack->GetEndTime());
-         auto rightTrackEnd = mRightTrack->TimeToLongSamples(mRightTrack->GetEndTime());
-         mEnd = wxMax(leftTrackEnd, rightTrackEnd);
+      auto leftTrackStart = leftTrack->TimeToLongSamples(leftTrack->GetStartTime());
+      auto rightTrackStart = rightTrack->TimeToLongSamples(rightTrack->GetStartTime());
+      auto leftTrackEnd = leftTrack->TimeToLongSamples(leftTrack->GetEndTime());
+      auto rightTrackEnd = rightTrack->TimeToLongSamples(rightTrack->GetEndTime());
+
+      auto mono = leftTrack->EmptyCopy();
+      mono->ConvertToSampleFormat( floatSample );
+      downmixes.push_back( { leftTrack, rightTrack,
+         wxMin(leftTrackStart, rightTrackStart),
+         wxMax(leftTrackEnd, rightTrackEnd),
+         std::move( mono ), true } );
+   }
 
-         bGoodResult = ProcessOne(count);
-         if (!bGoodResult)
+   if (downmixes.size() > 1 && std::thread::hardware_concurrency() > 1)
+      bGoodResult = ProcessInParallel(downmixes);
+   else {
+      int count = 0;
+      for (auto &downmix : downmixes) {
+         if (!ProcessOne(downmix, [&](double fraction){
+               return TrackProgress(count, 2. * fraction); })) {
+            bGoodResult = false;
             break;
-
-         // The right channel has been deleted, so we must restart from the beginning
-         refreshIter = true;
+         }
+         ++count;
       }
+   }
 
-      if (refreshIter) {
-         trackRange = mOutputTracks->SelectedLeaders< WaveTrack >();
-         refreshIter = false;
+   if (bGoodResult)
+      for (const auto &downmix : downmixes) {
+         ReplaceChannels(downmix);
+         bGoodResult = bGoodResult && downmix.good;
       }
-      else
-         ++trackRange.first;
-
-      count++;
-   }
 
    this->ReplaceProcessedTracks(bGoodResult);
    return bGoodResult;
 }
 
-bool EffectStereoToMono::ProcessOne(int count)
+bool EffectStereoToMono::ProcessOne(
+   Downmix &downmix, const std::function<bool(double)> &progress)
 {
-   float  curLeftFrame;
-   float  curRightFrame;
-   float  curMonoFrame;
-
-   auto idealBlockLen = mLeftTrack->GetMaxBlockSize() * 2;
-   auto index = mStart;
-   Floats leftBuffer { idealBlockLen };
-   Floats rightBuffer{ idealBlockLen };
-   bool bResult = true;
-
-   auto outTrack = mLeftTrack->EmptyCopy();
-   outTrack->ConvertToSampleFormat( floatSample );
-
-   while (index < mEnd) {
-      bResult &= mLeftTrack->Get((samplePtr)leftBuffer.get(), floatSample, index, idealBlockLen);
-      bResult &= mRightTrack->Get((samplePtr)rightBuffer.get(), floatSample, index, idealBlockLen);
-      auto limit = limitSampleBufferSize( idealBlockLen, mEnd - index );
-      for (decltype(limit) i = 0; i < limit; ++i) {
-         index++;
-         curLeftFrame = leftBuffer[i];
-         curRightFrame = rightBuffer[i];
-         curMonoFrame = (curLeftFrame + curRightFrame) / 2.0;
-         leftBuffer[i] = curMonoFrame;
-      }
-      outTrack->Append((samplePtr)leftBuffer.get(), floatSample, limit);
-      if (TrackProgress(count, 2.*(index.as_double() / (mEnd - mStart).as_double())))
+   auto &left = *downmix.left;
+   auto &right = *downmix.right;
+   auto &mono = *downmix.mono;
+   const auto start = downmix.start;
+   const auto end = downmix.end;
+
+   // Append a whole block of the output at once, so none waits in the
+   // append buffer of its clip
+   const auto blockLen = mono.GetMaxBlockSize();
+   Floats leftBuffer { blockLen };
+   Floats rightBuffer{ blockLen };
+
+   auto index = start;
+   while (index < end) {
+      auto limit = limitSampleBufferSize( blockLen, end - index );
+      downmix.good &= left.Get((samplePtr)leftBuffer.get(), floatSample, index, limit);
+      downmix.good &= right.Get((samplePtr)rightBuffer.get(), floatSample, index, limit);
+      AverageSamples(leftBuffer.get(), rightBuffer.get(), leftBuffer.get(), limit);
+      mono.Append((samplePtr)leftBuffer.get(), floatSample, limit);
+      index += limit;
+      if (progress((index - start).as_double() / (end - start).as_double()))
          return false;
    }
+   mono.Flush();
+
+   return true;
+}
+
+bool EffectStereoToMono::ProcessInParallel(std::vector<Downmix> &downmixes)
+{
+   const auto nDownmixes = downmixes.size();
+   const auto nThreads = std::min<size_t>(
+      nDownmixes, std::thread::hardware_concurrency());
+
+   std::vector< std::atomic<double> > fractions(nDownmixes);
+   std::atomic<bool> stopped{ false };
+   std::atomic<size_t> next{ 0 };
+   std::atomic<size_t> nDone{ 0 };
+   std::vector<std::exception_ptr> errors(nThreads);
+   {
+      std::vector<std::thread> threads;
+      // Whatever happens, wait for the threads before the tracks go away
+      auto cleanup = finally( [&] {
+         stopped.store(true);
+         for (auto &thread : threads)
+            thread.join();
+      } );
+      for (size_t ii = 0; ii < nThreads; ++ii)
+         threads.emplace_back( [&, ii]{
+            try {
+               for (size_t jj = 0;
+                    !stopped.load() && (jj = next++) < nDownmixes;) {
+                  auto &fraction = fractions[jj];
+                  if (!ProcessOne(downmixes[jj], [&](double done){
+                        fraction.store(done);
+                        return stopped.load(); })) {
+                     stopped.store(true);
+                     break;
+                  }
+                  ++nDone;
+               }
+            }
+            catch (...) {
+               errors[ii] = std::current_exception();
+               stopped.store(true);
+            }
+         } );
+
+      while (nDone.load() < nDownmixes && !stopped.load()) {
+         double sum = 0;
+         for (const auto &fraction : fractions)
+            sum += fraction.load();
+         if (TrackProgress(0, 2. * sum))
+            stopped.store(true);
+         else
+            ::wxMilliSleep(10);
+      }
+   }
+   for (auto &error : errors)
+      if (error)
+         std::rethrow_exception(error);
 
-   double minStart = wxMin(mLeftTrack->GetStartTime(), mRightTrack->GetStartTime());
-   mLeftTrack->Clear(mLeftTrack->GetStartTime(), mLeftTrack->GetEndTime());
-   outTrack->Flush();
-   mLeftTrack->Paste(minStart, outTrack.get());
-   mOutputTracks->GroupChannels( *mLeftTrack,  1 );
-   mOutputTracks->Remove(mRightTrack);
+   return nDone.load() == nDownmixes;
+}
 
-   return bResult;
+void EffectStereoToMono::ReplaceChannels(const Downmix &downmix)
+{
+   auto leftTrack = downmix.left;
+   auto rightTrack = downmix.right;
+   // Pasting shares the NEW blocks, rather than copying them again
+   double minStart = wxMin(leftTrack->GetStartTime(), rightTrack->GetStartTime());
+   leftTrack->Clear(leftTrack->GetStartTime(), leftTrack->GetEndTime());
+   leftTrack->Paste(minStart, downmix.mono.get());
+   mOutputTracks->GroupChannels( *leftTrack,  1 );
+   mOutputTracks->Remove(rightTrack);
 }
 
 bool EffectStereoToMono::IsHidden()
@@ -13,6 +13,9 @@
 
 #include "Effect.h"
 
+#include <functional>
+#include <vector>
+
 class EffectStereoToMono final : public Effect
 {
 public:
@@ -44,13 +47,24 @@ public:
 private:
    // EffectStereoToMono implementation
 
-   bool ProcessOne(int count);
-
-private:
-   sampleCount mStart;
-   sampleCount mEnd;
-   WaveTrack *mLeftTrack;
-   WaveTrack *mRightTrack;
+   struct Downmix
+   {
+      WaveTrack *left;
+      WaveTrack *right;
+      sampleCount start;
+      sampleCount end;
+      std::shared_ptr<WaveTrack> mono;
+      bool good;
+   };
+
+   // Average the channels into downmix.mono; stops when progress, given the
+   // fraction done, returns true
+   static bool ProcessOne(
+      Downmix &downmix, const std::function<bool(double)> &progress);
+   // Downmix independent stereo tracks on worker threads
+   bool ProcessInParallel(std::vector<Downmix> &downmixes);
+   // Replace the channels with the mono track
+   void ReplaceChannels(const Downmix &downmix);
 };
 
 #endif
@@ -211,48 +211,74 @@ size_t EffectToneGen::ProcessBlock(float **WXUNUSED(inBlock), float **outBlock,
       BlendedFrequency = mFrequency[0] + frequencyQuantum * doubleSample;
    }
 
-   // synth loop
-   for (decltype(blockLen) i = 0; i < blockLen; i++)
+   if (mWaveform == kSine && frequencyQuantum == 0.0)
    {
-      switch (mWaveform)
+      // A steady sine:  rotate a phasor rather than call sin for each
+      // sample, starting each block from the exact phase so that rounding
+      // errors cannot accumulate
+      const double phase = pre2PI * mPositionInCycles / mSampleRate;
+      const double step = pre2PI * BlendedFrequency / mSampleRate;
+      const double cosStep = cos(step), sinStep = sin(step);
+      double c = cos(phase), s = sin(phase);
+      for (decltype(blockLen) i = 0; i < blockLen; i++)
       {
-      case kSine:
-         f = sin(pre2PI * mPositionInCycles / mSampleRate);
-         break;
-      case kSquare:
-         f = (modf(mPositionInCycles / mSampleRate, &throwaway) < 0.5) ? 1.0 : -1.0;
-         break;
-      case kSawtooth:
-         f = (2.0 * modf(mPositionInCycles / mSampleRate + 0.5, &throwaway)) - 1.0;
-         break;
-      case kSquareNoAlias:    // Good down to 110Hz @ 44100Hz sampling.
-         //do fundamental (k=1) outside loop
-         b = (1.0 + cos((pre2PI * BlendedFrequency) / mSampleRate)) / pre4divPI;  //scaling
-         f = pre4divPI * sin(pre2PI * mPositionInCycles / mSampleRate);
-         for (k = 3; (k < 200) && (k * BlendedFrequency < mSampleRate / 2.0); k += 2)
-         {
-            //Hann Window in freq domain
-            a = 1.0 + cos((pre2PI * k * BlendedFrequency) / mSampleRate);
-            //calc harmonic, apply window, scale to amplitude of fundamental
-            f += a * sin(pre2PI * mPositionInCycles / mSampleRate * k) / (b * k);
-         }
+         buffer[i] = (float) (BlendedAmplitude * s);
+         const double nextC = c * cosStep - s * sinStep;
+         s = s * cosStep + c * sinStep;
+         c = nextC;
+         BlendedAmplitude += amplitudeQuantum;
       }
-      // insert value in buffer
-      buffer[i] = (float) (BlendedAmplitude * f);
-      // update freq,amplitude
-      mPositionInCycles += BlendedFrequency;
-      BlendedAmplitude += amplitudeQuantum;
-      if (mInterpolation == kLogarithmic)
-      {
-         BlendedLogFrequency += frequencyQuantum;
-         BlendedFrequency = pow(10.0, BlendedLogFrequency);
-      }
-      else
+      mPositionInCycles += BlendedFrequency * blockLen;
+   }
+   else
+   {
+      // synth loop
+      for (decltype(blockLen) i = 0; i < blockLen; i++)
       {
-         BlendedFrequency += frequencyQuantum;
+         switch (mWaveform)
+         {
+         case kSine:
+            f = sin(pre2PI * mPositionInCycles / mSampleRate);
+            break;
+         case kSquare:
+            f = (modf(mPositionInCycles / mSampleRate, &throwaway) < 0.5) ? 1.0 : -1.0;
+            break;
+         case kSawtooth:
+            f = (2.0 * modf(mPositionInCycles / mSampleRate + 0.5, &throwaway)) - 1.0;
+            break;
+         case kSquareNoAlias:    // Good down to 110Hz @ 44100Hz sampling.
+            //do fundamental (k=1) outside loop
+            b = (1.0 + cos((pre2PI * BlendedFrequency) / mSampleRate)) / pre4divPI;  //scaling
+            f = pre4divPI * sin(pre2PI * mPositionInCycles / mSampleRate);
+            for (k = 3; (k < 200) && (k * BlendedFrequency < mSampleRate / 2.0); k += 2)
+            {
+               //Hann Window in freq domain
+               a = 1.0 + cos((pre2PI * k * BlendedFrequency) / mSampleRate);
+               //calc harmonic, apply window, scale to amplitude of fundamental
+               f += a * sin(pre2PI * mPositionInCycles / mSampleRate * k) / (b * k);
+            }
+         }
+         // insert value in buffer
+         buffer[i] = (float) (BlendedAmplitude * f);
+         // update freq,amplitude
+         mPositionInCycles += BlendedFrequency;
+         BlendedAmplitude += amplitudeQuantum;
+         if (mInterpolation == kLogarithmic)
+         {
+            BlendedLogFrequency += frequencyQuantum;
+            BlendedFrequency = pow(10.0, BlendedLogFrequency);
+         }
+         else
+         {
+            BlendedFrequency += frequencyQuantum;
+         }
       }
    }
 
+   // Keep the position within one second of cycles, which changes no
+   // waveform, so that long tones do not lose precision
+   mPositionInCycles = fmod(mPositionInCycles, mSampleRate);
+
    // update external placeholder
    mSample += blockLen;
 
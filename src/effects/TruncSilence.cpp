@@ -688,6 +688,20 @@ bool EffectTruncSilence::Analyze(RegionList& silenceList,
       // Limit size of current block if we've reached the end
       auto count = limitSampleBufferSize( blockLen, end - *index );
 
+      // Inside a silent region, first ask the block summaries whether all of
+      // the next stretch is silent too, which needs no reading of samples
+      if (*silentFrame > 0 &&
+          !(inputLength && ((outLength >= previewLen) ||
+               (outLength > wt->TimeToLongSamples(*minInputLength))))) {
+         const auto minMax = wt->GetSampleMinMax(*index, count);
+         if (std::max(-minMax.first, minMax.second) <
+                truncDbSilenceThreshold) {
+            *silentFrame += count;
+            *index += count;
+            continue;
+         }
+      }
+
       // Fill buffer
       wt->Get((samplePtr)(buffer.get()), floatSample, *index, count);
 
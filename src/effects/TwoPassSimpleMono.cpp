@@ -15,6 +15,11 @@ Inherit from it if your effect needs to pass twice over the data.
 It does the first pass on all selected tracks before going back and
 doing the second pass over all selected tracks.
 
+When a second pass follows, the first keeps what it computes for float
+tracks in memory, up to a limit, and the second pass works on that instead
+of reading the track again.  Whatever the second pass does not take is
+written to the tracks at the end.
+
 *//*******************************************************************/
 
 
@@ -23,10 +28,19 @@ doing the second pass over all selected tracks.
 
 #include "../WaveTrack.h"
 
+namespace {
+// Limit of the samples, of all tracks, that the first pass keeps for the
+// second:  64 MB
+const size_t MaxCachedSamples = 1 << 24;
+}
+
 bool EffectTwoPassSimpleMono::Process()
 {
     mPass = 0;
     mSecondPassDisabled = false;
+    mCache.clear();
+    mCacheRemaining = MaxCachedSamples;
+    auto cleanup = finally( [this]{ mCache.clear(); } );
 
     InitPass1();
     this->CopyInputTracks(); // Set up mOutputTracks.
@@ -39,6 +53,11 @@ bool EffectTwoPassSimpleMono::Process()
             bGoodResult = ProcessPass();
     }
 
+    // Write what the second pass did not take, or all of it, if there was
+    // no second pass
+    if (bGoodResult)
+        FlushCache();
+
     this->ReplaceProcessedTracks(bGoodResult);
     return bGoodResult;
 }
@@ -102,21 +121,62 @@ bool EffectTwoPassSimpleMono::ProcessOne(WaveTrack * track,
    auto len = (end - start).as_double();
    auto maxblock = track->GetMaxBlockSize();
 
+   // The second pass works in place on what the first one left in the
+   // cache.  The first pass keeps its results there, instead of writing
+   // them, if a second pass follows and they fit; only for float tracks,
+   // so that the second pass sees the samples just as the track would hold
+   // them.
+   if (mCache.size() <= (size_t)mCurTrackNum)
+      mCache.resize(mCurTrackNum + 1);
+   auto &cache = mCache[mCurTrackNum];
+   const bool fromCache = mPass == 1 && cache.track == track &&
+      cache.start == start && cache.samples.size() == end - start;
+   const bool toCache = mPass == 0 && !mSecondPassDisabled &&
+      track->GetSampleFormat() == floatSample &&
+      end - start <= mCacheRemaining;
+   if (toCache) {
+      cache.track = track;
+      cache.start = start;
+      cache.samples.clear();
+      cache.samples.reserve( (end - start).as_size_t() );
+      mCacheRemaining -= (end - start).as_size_t();
+   }
+
    //Initiate a processing buffer.  This buffer will (most likely)
    //be shorter than the length of the track being processed.
-   Floats buffer1{ maxblock };
-   Floats buffer2{ maxblock };
+   Floats buffer1, buffer2;
+   if (!fromCache) {
+      buffer1.reinit( maxblock );
+      buffer2.reinit( maxblock );
+   }
+
+   // Get samples from the cache or the track, in buffer if from the track
+   auto get = [&](Floats &buffer, sampleCount s, size_t samples) -> float * {
+      if (fromCache)
+         return &cache.samples[ (s - start).as_size_t() ];
+      track->Get((samplePtr) buffer.get(), floatSample, s, samples);
+      return buffer.get();
+   };
+   // Keep the processed samples for the second pass, or write them
+   auto put = [&](float *pSamples, sampleCount s, size_t samples) {
+      if (toCache)
+         cache.samples.insert(
+            cache.samples.end(), pSamples, pSamples + samples);
+      else
+         track->Set((samplePtr) pSamples, floatSample, s, samples);
+   };
+
    auto samples1 =  limitSampleBufferSize(
       std::min( maxblock, track->GetBestBlockSize(start) ), end - start );
 
    //Get the samples from the track and put them in the buffer
-   track->Get((samplePtr) buffer1.get(), floatSample, start, samples1);
+   auto pBuffer1 = get(buffer1, start, samples1);
 
    // Process the first buffer with a NULL previous buffer
    if (mPass == 0)
-      ret = TwoBufferProcessPass1(NULL, 0, buffer1.get(), samples1);
+      ret = TwoBufferProcessPass1(NULL, 0, pBuffer1, samples1);
    else
-      ret = TwoBufferProcessPass2(NULL, 0, buffer1.get(), samples1);
+      ret = TwoBufferProcessPass2(NULL, 0, pBuffer1, samples1);
    if (!ret)
       //Return false because the effect failed.
       return false;
@@ -132,20 +192,20 @@ bool EffectTwoPassSimpleMono::ProcessOne(WaveTrack * track,
       );
 
       //Get the samples from the track and put them in the buffer
-      track->Get((samplePtr)buffer2.get(), floatSample, s, samples2);
+      auto pBuffer2 = get(buffer2, s, samples2);
 
       //Process the buffer.  If it fails, clean up and exit.
       if (mPass == 0)
-         ret = TwoBufferProcessPass1(buffer1.get(), samples1, buffer2.get(), samples2);
+         ret = TwoBufferProcessPass1(pBuffer1, samples1, pBuffer2, samples2);
       else
-         ret = TwoBufferProcessPass2(buffer1.get(), samples1, buffer2.get(), samples2);
+         ret = TwoBufferProcessPass2(pBuffer1, samples1, pBuffer2, samples2);
       if (!ret)
          //Return false because the effect failed.
          return false;
 
       //Processing succeeded. copy the newly-changed samples back
       //onto the track.
-      track->Set((samplePtr)buffer1.get(), floatSample, s - samples1, samples1);
+      put(pBuffer1, s - samples1, samples1);
 
       //Increment s one blockfull of samples
       s += samples2;
@@ -165,15 +225,16 @@ bool EffectTwoPassSimpleMono::ProcessOne(WaveTrack * track,
 
       // Rotate the buffers
       buffer1.swap(buffer2);
+      pBuffer1 = pBuffer2;
 
       std::swap(samples1, samples2);
    }
 
    // Send the last buffer with a NULL pointer for the current buffer
    if (mPass == 0)
-      ret = TwoBufferProcessPass1(buffer1.get(), samples1, NULL, 0);
+      ret = TwoBufferProcessPass1(pBuffer1, samples1, NULL, 0);
    else
-      ret = TwoBufferProcessPass2(buffer1.get(), samples1, NULL, 0);
+      ret = TwoBufferProcessPass2(pBuffer1, samples1, NULL, 0);
 
    if (!ret)
       //Return false because the effect failed.
@@ -181,12 +242,26 @@ bool EffectTwoPassSimpleMono::ProcessOne(WaveTrack * track,
 
    //Processing succeeded. copy the newly-changed samples back
    //onto the track.
-   track->Set((samplePtr)buffer1.get(), floatSample, s - samples1, samples1);
+   put(pBuffer1, s - samples1, samples1);
+
+   // The second pass is done with the cache of the track
+   if (fromCache)
+      std::vector<float>{}.swap(cache.samples);
 
    //Return true because the effect processing succeeded.
    return true;
 }
 
+void EffectTwoPassSimpleMono::FlushCache()
+{
+   for (auto &cache : mCache) {
+      if (!cache.samples.empty())
+         cache.track->Set((samplePtr) cache.samples.data(), floatSample,
+            cache.start, cache.samples.size());
+      std::vector<float>{}.swap(cache.samples);
+   }
+}
+
 bool EffectTwoPassSimpleMono::NewTrackPass1()
 {
    return true;
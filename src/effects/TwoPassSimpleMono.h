@@ -14,6 +14,7 @@
 
 #include "SimpleMono.h"
 
+#include <vector>
 
 class WaveTrack;
 
@@ -30,6 +31,8 @@ protected:
    // Override these methods if you need to initialize something
    // before each pass. Return None if processing should stop.
    // These should not depend on mOutputTracks having been set up via CopyInputTracks().
+   // Nor should they read the tracks before the second pass:  the results
+   // of the first may be kept apart, until the end.
    bool InitPass1() override;
    bool InitPass2() override;
 
@@ -79,6 +82,19 @@ private:
    bool ProcessOne(WaveTrack * t,
                    sampleCount start, sampleCount end);
    bool ProcessPass() override;
+   // Write to the tracks what the first pass left in the cache
+   void FlushCache();
+
+   // The samples of a track that the first pass keeps for the second,
+   // instead of writing them only to read them again
+   struct CachedSamples {
+      WaveTrack *track;
+      sampleCount start;
+      std::vector<float> samples;
+   };
+   // Indexed by mCurTrackNum
+   std::vector<CachedSamples> mCache;
+   size_t mCacheRemaining;
 };
 
 #endif
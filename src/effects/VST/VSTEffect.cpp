@@ -95,7 +95,21 @@
 
 #include "audacity/ConfigInterface.h"
 
+#include <algorithm>
 #include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_DENORMALS
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__GNUC__)
+#define USE_NEON_DENORMALS
+#endif
 
 // Put this inclusion last.  On Linux it makes some unfortunate pollution of
 // preprocessor macro name space that interferes with other headers.
@@ -504,6 +518,113 @@ PluginPaths VSTEffectsModule::FindPluginPaths(PluginManagerInterface & pm)
    return { files.begin(), files.end() };
 }
 
+namespace {
+
+// Runs a checking process without waiting for it, collecting its output
+class VSTScanProcess final : public wxProcess
+{
+public:
+   VSTScanProcess()
+   {
+      Redirect();
+   }
+
+   bool IsActive() const
+   {
+      return mActive;
+   }
+
+   // Read what is available, so that the process never blocks on a full pipe
+   void Drain()
+   {
+      auto s = GetInputStream();
+      while (s && s->CanRead())
+      {
+         char buffer[4096];
+         s->Read(buffer, WXSIZEOF(buffer));
+         mBytes.append(buffer, s->LastRead());
+      }
+   }
+
+   void OnTerminate(int WXUNUSED( pid ), int WXUNUSED( status )) override
+   {
+      Drain();
+      mActive = false;
+   }
+
+   wxString GetOutput() const
+   {
+      // Decode as the synchronous check in DiscoverPluginsAtPath does
+      wxString output;
+      wxStringOutputStream ss(&output);
+      ss.Write(mBytes.data(), mBytes.size());
+      return output;
+   }
+
+private:
+   std::string mBytes;
+   bool mActive{ true };
+};
+
+}
+
+void VSTEffectsModule::PrepareDiscovery(const PluginPaths & paths)
+{
+   // Each plugin is loaded by another instance of Audacity, as in
+   // DiscoverPluginsAtPath, so that a crashing plugin does not take this one
+   // down; but several run at once
+   mPrefetched.clear();
+
+   const auto &cmdpath = PlatformCompatibility::GetExecutablePath();
+   const size_t nWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+   struct Scan
+   {
+      PluginPath path;
+      std::unique_ptr<VSTScanProcess> pProcess;
+   };
+   std::vector<Scan> running;
+
+   size_t next = 0;
+   while (next < paths.size() || !running.empty())
+   {
+      while (next < paths.size() && running.size() < nWorkers)
+      {
+         const auto &path = paths[next++];
+         if (mPrefetched.count(path))
+         {
+            continue;
+         }
+
+         wxString cmd;
+         cmd.Printf(wxT("\"%s\" %s \"%s;0\""), cmdpath, VSTCMDKEY, path);
+
+         auto pProcess = std::make_unique<VSTScanProcess>();
+         if (wxExecute(cmd, wxEXEC_ASYNC, pProcess.get()) == 0)
+         {
+            // DiscoverPluginsAtPath will try again, and report the failure
+            continue;
+         }
+         running.push_back({ path, std::move(pProcess) });
+      }
+
+      wxMilliSleep(10);
+      wxTheApp->Yield(true);
+
+      for (auto iter = running.begin(); iter != running.end();)
+      {
+         iter->pProcess->Drain();
+         if (iter->pProcess->IsActive())
+         {
+            ++iter;
+            continue;
+         }
+         mPrefetched[iter->path] = iter->pProcess->GetOutput();
+         iter = running.erase(iter);
+      }
+   }
+}
+
 unsigned VSTEffectsModule::DiscoverPluginsAtPath(
    const PluginPath & path, TranslatableString &errMsg,
    const RegistrationCallback &callback)
@@ -527,27 +648,38 @@ unsigned VSTEffectsModule::DiscoverPluginsAtPath(
    {
       wxString effectID = effectTzr.GetNextToken();
 
-      wxString cmd;
-      cmd.Printf(wxT("\"%s\" %s \"%s;%s\""), cmdpath, VSTCMDKEY, path, effectID);
-
       VSTSubProcess proc;
-      try
+      wxString output;
+
+      // The first check of the path may have been done already
+      auto prefetched = mPrefetched.find(path);
+      if (effectID == wxT("0") && prefetched != mPrefetched.end())
       {
-         int flags = wxEXEC_SYNC | wxEXEC_NODISABLE;
-#if defined(__WXMSW__)
-         flags += wxEXEC_NOHIDE;
-#endif
-         wxExecute(cmd, flags, &proc);
+         output = prefetched->second;
+         mPrefetched.erase(prefetched);
       }
-      catch (...)
+      else
       {
-         wxLogMessage(_("VST plugin registration failed for %s\n"), path);
-         error = true;
-      }
+         wxString cmd;
+         cmd.Printf(wxT("\"%s\" %s \"%s;%s\""), cmdpath, VSTCMDKEY, path, effectID);
 
-      wxString output;
-      wxStringOutputStream ss(&output);
-      proc.GetInputStream()->Read(ss);
+         try
+         {
+            int flags = wxEXEC_SYNC | wxEXEC_NODISABLE;
+#if defined(__WXMSW__)
+            flags += wxEXEC_NOHIDE;
+#endif
+            wxExecute(cmd, flags, &proc);
+         }
+         catch (...)
+         {
+            wxLogMessage(_("VST plugin registration failed for %s\n"), path);
+            error = true;
+         }
+
+         wxStringOutputStream ss(&output);
+         proc.GetInputStream()->Read(ss);
+      }
 
       int keycount = 0;
       bool haveBegin = false;
@@ -2582,9 +2714,54 @@ intptr_t VSTEffect::callDispatcher(int opcode,
    return mAEffect->dispatcher(mAEffect, opcode, index, value, ptr, opt);
 }
 
+namespace {
+
+// Flushes denormal results and inputs to zero while the plugin runs, as
+// other hosts do.  Decaying tails of feedback filters and reverbs otherwise
+// enter the denormal range, where every operation may cost a hundred times
+// more.  The previous mode is restored, so that the rest of Audacity and
+// the plugin's own threads are not affected.
+class DenormalsAreZero
+{
+public:
+   DenormalsAreZero()
+   {
+#if defined(USE_SSE2_DENORMALS)
+      // Flush to zero, and denormals are zero
+      mSaved = _mm_getcsr();
+      _mm_setcsr(mSaved | 0x8040);
+#elif defined(USE_NEON_DENORMALS)
+      // The FZ bit, which on AArch64 governs both
+      uint64_t fpcr;
+      __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+      mSaved = fpcr;
+      fpcr |= (uint64_t(1) << 24);
+      __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+#endif
+   }
+   ~DenormalsAreZero()
+   {
+#if defined(USE_SSE2_DENORMALS)
+      _mm_setcsr(mSaved);
+#elif defined(USE_NEON_DENORMALS)
+      __asm__ __volatile__("msr fpcr, %0" : : "r"(mSaved));
+#endif
+   }
+
+private:
+#if defined(USE_SSE2_DENORMALS)
+   unsigned int mSaved;
+#elif defined(USE_NEON_DENORMALS)
+   uint64_t mSaved;
+#endif
+};
+
+}
+
 void VSTEffect::callProcessReplacing(float **inputs,
                                      float **outputs, int sampleframes)
 {
+   DenormalsAreZero daz;
    mAEffect->processReplacing(mAEffect, inputs, outputs, sampleframes);
 }
 
@@ -19,6 +19,8 @@
 #include "../../SampleFormat.h"
 #include "../../xml/XMLTagHandler.h"
 
+#include <map>
+
 class wxSizerItem;
 class wxSlider;
 class wxStaticText;
@@ -430,6 +432,7 @@ public:
       const RegistrationCallback &callback)
          override;
 
+   void PrepareDiscovery(const PluginPaths & paths) override;
    bool IsPluginValid(const PluginPath & path, bool bFast) override;
 
    ComponentInterface *CreateInstance(const PluginPath & path) override;
@@ -442,6 +445,10 @@ public:
 private:
    ModuleManagerInterface *mModMan;
    PluginPath mPath;
+
+   // Output of the checking processes run by PrepareDiscovery, not yet
+   // used by DiscoverPluginsAtPath
+   std::map<PluginPath, wxString> mPrefetched;
 };
 
 #endif // USE_VST
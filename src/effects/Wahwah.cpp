@@ -25,6 +25,7 @@
 #include "../Experimental.h"
 
 #include <math.h>
+#include <algorithm>
 
 #include <wx/intl.h>
 #include <wx/slider.h>
@@ -237,6 +238,11 @@ bool EffectWahwah::SetAutomationParameters(CommandParameters & parms)
 
 // Effect implementation
 
+std::unique_ptr<Effect> EffectWahwah::MakeParallelProcessor()
+{
+   return std::make_unique<EffectWahwah>();
+}
+
 void EffectWahwah::PopulateOrExchange(ShuttleGui & S)
 {
    S.SetBorder(5);
@@ -355,11 +361,11 @@ void EffectWahwah::InstanceInit(EffectWahwahState & data, float sampleRate)
    data.yn1 = 0;
    data.yn2 = 0;
    data.b0 = 0;
-   data.b1 = 0;
-   data.b2 = 0;
-   data.a0 = 0;
    data.a1 = 0;
    data.a2 = 0;
+   data.b0Step = 0;
+   data.a1Step = 0;
+   data.a2Step = 0;
 
    data.depth = mDepth / 100.0;
    data.freqofs = mFreqOfs / 100.0;
@@ -367,12 +373,60 @@ void EffectWahwah::InstanceInit(EffectWahwahState & data, float sampleRate)
    data.outgain = DB_TO_LINEAR(mOutGain);
 }
 
+void EffectWahwah::UpdateTable()
+{
+   if (!mTable.empty() && mTableDepth == mDepth &&
+       mTableFreqOfs == mFreqOfs && mTableRes == mRes)
+      return;
+
+   const double depth = mDepth / 100.0;
+   const double freqofs = mFreqOfs / 100.0;
+
+   // One more entry, so that interpolation needs no wrap around
+   mTable.resize(TableSize + 1);
+   for (size_t i = 0; i <= TableSize; i++)
+   {
+      double frequency = (1 + cos(2 * M_PI * i / TableSize)) / 2;
+      frequency = frequency * depth * (1 - freqofs) + freqofs;
+      frequency = exp((frequency - 1) * 6);
+      const double omega = M_PI * frequency;
+      const double sn = sin(omega);
+      const double cs = cos(omega);
+      const double alpha = sn / (2 * mRes);
+
+      // Normalized by a0; b1 is twice b0 and b2 equals b0
+      const double a0 = 1 + alpha;
+      auto &coefficients = mTable[i];
+      coefficients.b0 = (1 - cs) / 2 / a0;
+      coefficients.a1 = -2 * cs / a0;
+      coefficients.a2 = (1 - alpha) / a0;
+   }
+
+   mTableDepth = mDepth;
+   mTableFreqOfs = mFreqOfs;
+   mTableRes = mRes;
+}
+
+auto EffectWahwah::LookUp(double theta) const -> Coefficients
+{
+   double cycles = theta / (2 * M_PI);
+   cycles -= floor(cycles);
+   const double position = cycles * TableSize;
+   const auto index = std::min(TableSize - 1, size_t(position));
+   const double frac = position - index;
+   const auto &c0 = mTable[index];
+   const auto &c1 = mTable[index + 1];
+   return {
+      c0.b0 + frac * (c1.b0 - c0.b0),
+      c0.a1 + frac * (c1.a1 - c0.a1),
+      c0.a2 + frac * (c1.a2 - c0.a2),
+   };
+}
+
 size_t EffectWahwah::InstanceProcess(EffectWahwahState & data, float **inBlock, float **outBlock, size_t blockLen)
 {
    float *ibuf = inBlock[0];
    float *obuf = outBlock[0];
-   double frequency, omega, sn, cs, alpha;
-   double in, out;
 
    data.lfoskip = mFreq * 2 * M_PI / data.samplerate;
    data.depth = mDepth / 100.0;
@@ -381,36 +435,57 @@ size_t EffectWahwah::InstanceProcess(EffectWahwahState & data, float **inBlock,
    data.phase = mPhase * M_PI / 180.0;
    data.outgain = DB_TO_LINEAR(mOutGain);
 
-   for (decltype(blockLen) i = 0; i < blockLen; i++)
-   {
-      in = (double) ibuf[i];
+   UpdateTable();
+
+   // Keep the state in locals through the loop
+   double xn1 = data.xn1, xn2 = data.xn2, yn1 = data.yn1, yn2 = data.yn2;
+   double b0 = data.b0, a1 = data.a1, a2 = data.a2;
+   double b0Step = data.b0Step, a1Step = data.a1Step, a2Step = data.a2Step;
+   const double outgain = data.outgain;
 
-      if ((data.skipcount++) % lfoskipsamples == 0)
+   for (decltype(blockLen) i = 0; i < blockLen;)
+   {
+      if (data.skipcount % lfoskipsamples == 0)
       {
-         frequency = (1 + cos(data.skipcount * data.lfoskip + data.phase)) / 2;
-         frequency = frequency * data.depth * (1 - data.freqofs) + data.freqofs;
-         frequency = exp((frequency - 1) * 6);
-         omega = M_PI * frequency;
-         sn = sin(omega);
-         cs = cos(omega);
-         alpha = sn / (2 * mRes);
-         data.b0 = (1 - cs) / 2;
-         data.b1 = 1 - cs;
-         data.b2 = (1 - cs) / 2;
-         data.a0 = 1 + alpha;
-         data.a1 = -2 * cs;
-         data.a2 = 1 - alpha;
-      };
-      out = (data.b0 * in + data.b1 * data.xn1 + data.b2 * data.xn2 - data.a1 * data.yn1 - data.a2 * data.yn2) / data.a0;
-      data.xn2 = data.xn1;
-      data.xn1 = in;
-      data.yn2 = data.yn1;
-      data.yn1 = out;
-      out *= data.outgain;
-
-      obuf[i] = (float) out;
+         // Go linearly from the coefficients of this step of the LFO to
+         // those of the next, instead of jumping.  The filters between two
+         // stable ones are stable, because the set of stable (a1, a2) is
+         // convex.
+         const auto start =
+            LookUp((data.skipcount + 1) * data.lfoskip + data.phase);
+         const auto end = LookUp(
+            (data.skipcount + 1 + lfoskipsamples) * data.lfoskip + data.phase);
+         b0 = start.b0, a1 = start.a1, a2 = start.a2;
+         b0Step = (end.b0 - start.b0) / lfoskipsamples;
+         a1Step = (end.a1 - start.a1) / lfoskipsamples;
+         a2Step = (end.a2 - start.a2) / lfoskipsamples;
+      }
+
+      // Samples up to the next step of the LFO
+      const auto run = std::min<size_t>(blockLen - i,
+         lfoskipsamples - data.skipcount % lfoskipsamples);
+      for (auto end = i + run; i < end; i++)
+      {
+         const double in = ibuf[i];
+         const double out =
+            b0 * (in + 2 * xn1 + xn2) - a1 * yn1 - a2 * yn2;
+         xn2 = xn1;
+         xn1 = in;
+         yn2 = yn1;
+         yn1 = out;
+         b0 += b0Step;
+         a1 += a1Step;
+         a2 += a2Step;
+
+         obuf[i] = (float) (out * outgain);
+      }
+      data.skipcount += run;
    }
 
+   data.xn1 = xn1, data.xn2 = xn2, data.yn1 = yn1, data.yn2 = yn2;
+   data.b0 = b0, data.a1 = a1, data.a2 = a2;
+   data.b0Step = b0Step, data.a1Step = a1Step, data.a2Step = a2Step;
+
    return blockLen;
 }
 
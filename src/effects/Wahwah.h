@@ -33,7 +33,11 @@ public:
    double lfoskip;
    unsigned long skipcount;
    double xn1, xn2, yn1, yn2;
-   double b0, b1, b2, a0, a1, a2;
+   // The lowpass filter, normalized, with b1 = 2 * b0 and b2 = b0; and
+   // the changes of its coefficients per sample, until the next step of
+   // the LFO
+   double b0, a1, a2;
+   double b0Step, a1Step, a2Step;
 };
 
 class EffectWahwah final : public Effect
@@ -77,6 +81,7 @@ public:
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
+   std::unique_ptr<Effect> MakeParallelProcessor() override;
 
 private:
    // EffectWahwah implementation
@@ -84,6 +89,17 @@ private:
    void InstanceInit(EffectWahwahState & data, float sampleRate);
    size_t InstanceProcess(EffectWahwahState & data, float **inBlock, float **outBlock, size_t blockLen);
 
+   // The filter at a phase of the LFO
+   struct Coefficients
+   {
+      double b0, a1, a2;
+   };
+   // Compute the table of the filter over one cycle of the LFO, if the
+   // parameters changed
+   void UpdateTable();
+   // Interpolate in the table at the phase theta in radians
+   Coefficients LookUp(double theta) const;
+
    void OnFreqSlider(wxCommandEvent & evt);
    void OnPhaseSlider(wxCommandEvent & evt);
    void OnDepthSlider(wxCommandEvent & evt);
@@ -102,6 +118,12 @@ private:
    EffectWahwahState mMaster;
    std::vector<EffectWahwahState> mSlaves;
 
+   static constexpr size_t TableSize = 1024;
+   std::vector<Coefficients> mTable;
+   int mTableDepth{};
+   int mTableFreqOfs{};
+   double mTableRes{};
+
    /* Parameters:
    mFreq - LFO frequency
    mPhase - LFO startphase in RADIANS - useful for stereo WahWah
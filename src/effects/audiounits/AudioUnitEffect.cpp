@@ -67,6 +67,10 @@
 #define PRESET_LOCAL_PATH wxT("/Library/Audio/Presets")
 #define PRESET_USER_PATH wxT("~/Library/Audio/Presets")
 
+// The most frames per slice that SetBlockSize asks of a unit; offline
+// processing renders fewer, longer slices than realtime does
+#define MAX_FRAMES_PER_SLICE 8192
+
 struct CFReleaser
    { void operator () (const void *p) const { if (p) CFRelease(p); } };
 template <typename T>
@@ -1157,6 +1161,37 @@ void AudioUnitEffect::SetSampleRate(double rate)
 
 size_t AudioUnitEffect::SetBlockSize(size_t maxBlockSize)
 {
+   // Never less than the unit wanted, which realtime processing relies on
+   UInt32 blockSize = std::min<size_t>(maxBlockSize, MAX_FRAMES_PER_SLICE);
+   if (blockSize <= mBlockSize)
+   {
+      return mBlockSize;
+   }
+
+   // The unit takes a NEW maximum only while uninitialized
+   const bool wasInitialized = mUnitInitialized;
+   if (wasInitialized)
+   {
+      AudioUnitUninitialize(mUnit);
+      mUnitInitialized = false;
+   }
+
+   OSStatus result = AudioUnitSetProperty(mUnit,
+                                          kAudioUnitProperty_MaximumFramesPerSlice,
+                                          kAudioUnitScope_Global,
+                                          0,
+                                          &blockSize,
+                                          sizeof(blockSize));
+   if (result == noErr)
+   {
+      mBlockSize = blockSize;
+   }
+
+   if (wasInitialized && AudioUnitInitialize(mUnit) == noErr)
+   {
+      mUnitInitialized = true;
+   }
+
    return mBlockSize;
 }
 
@@ -1211,11 +1246,27 @@ bool AudioUnitEffect::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelN
 {
    OSStatus result;
 
-   mInputList.reinit( mAudioIns );
-   mInputList[0].mNumberBuffers = mAudioIns;
-   
-   mOutputList.reinit( mAudioOuts );
-   mOutputList[0].mNumberBuffers = mAudioOuts;
+   // The buffer lists last as long as the effect; ProcessBlock only points
+   // them at each block
+   if (!mInputList || mInputList[0].mNumberBuffers != mAudioIns)
+   {
+      mInputList.reinit( mAudioIns );
+      mInputList[0].mNumberBuffers = mAudioIns;
+      for (size_t i = 0; i < mAudioIns; i++)
+      {
+         mInputList[0].mBuffers[i].mNumberChannels = 1;
+      }
+   }
+
+   if (!mOutputList || mOutputList[0].mNumberBuffers != mAudioOuts)
+   {
+      mOutputList.reinit( mAudioOuts );
+      mOutputList[0].mNumberBuffers = mAudioOuts;
+      for (size_t i = 0; i < mAudioOuts; i++)
+      {
+         mOutputList[0].mBuffers[i].mNumberChannels = 1;
+      }
+   }
 
    memset(&mTimeStamp, 0, sizeof(AudioTimeStamp));
    mTimeStamp.mSampleTime = 0; // This is a double-precision number that should
@@ -1259,9 +1310,6 @@ bool AudioUnitEffect::ProcessFinalize()
 {
    mReady = false;
 
-   mOutputList.reset();
-   mInputList.reset();
-
    return true;
 }
 
@@ -1269,14 +1317,13 @@ size_t AudioUnitEffect::ProcessBlock(float **inBlock, float **outBlock, size_t b
 {
    for (size_t i = 0; i < mAudioIns; i++)
    {
-      mInputList[0].mBuffers[i].mNumberChannels = 1;
       mInputList[0].mBuffers[i].mData = inBlock[i];
       mInputList[0].mBuffers[i].mDataByteSize = sizeof(float) * blockLen;
    }
 
+   // The unit may change the sizes of the output buffers, so set them again
    for (size_t i = 0; i < mAudioOuts; i++)
    {
-      mOutputList[0].mBuffers[i].mNumberChannels = 1;
       mOutputList[0].mBuffers[i].mData = outBlock[i];
       mOutputList[0].mBuffers[i].mDataByteSize = sizeof(float) * blockLen;
    }
@@ -1301,6 +1348,15 @@ size_t AudioUnitEffect::ProcessBlock(float **inBlock, float **outBlock, size_t b
    return blockLen;
 }
 
+std::unique_ptr<EffectClientInterface> AudioUnitEffect::MakeParallelClient()
+{
+   // A slave, as for realtime processing, but with a host of its own; the
+   // host passes the settings.  Give it the whole name, so that the host
+   // finds the configuration of this effect.
+   return std::make_unique<AudioUnitEffect>(
+      mPath, mVendor + wxT(": ") + mName, mComponent, this);
+}
+
 bool AudioUnitEffect::RealtimeInitialize()
 {
    mMasterIn.reinit(mAudioIns, mBlockSize, true);
@@ -26,6 +26,7 @@ effects from this one class.
 #include "LadspaEffect.h"       // This class's header file
 
 #include <float.h>
+#include <mutex>
 
 #if !defined(__WXMSW__)
 #include <dlfcn.h>
@@ -1001,6 +1002,13 @@ size_t LadspaEffect::ProcessBlock(float **inBlock, float **outBlock, size_t bloc
    return blockLen;
 }
 
+std::unique_ptr<EffectClientInterface> LadspaEffect::MakeParallelClient()
+{
+   // Loading the library again only counts a reference to it.  The NEW
+   // effect has its own instance and control ports.
+   return std::make_unique<LadspaEffect>(mPath, mIndex);
+}
+
 bool LadspaEffect::RealtimeInitialize()
 {
    return true;
@@ -1667,8 +1675,16 @@ bool LadspaEffect::SaveParameters(const RegistryPath & group)
    return mHost->SetPrivateConfig(group, wxT("Parameters"), parms);
 }
 
+namespace {
+// Offline processing may make instances on several threads at once, but
+// plugins need not expect it
+std::mutex sInstanceMutex;
+}
+
 LADSPA_Handle LadspaEffect::InitInstance(float sampleRate)
 {
+   std::lock_guard<std::mutex> lock{ sInstanceMutex };
+
    /* Instantiate the plugin */
    LADSPA_Handle handle = mData->instantiate(mData, sampleRate);
    if (!handle)
@@ -1702,6 +1718,8 @@ LADSPA_Handle LadspaEffect::InitInstance(float sampleRate)
 
 void LadspaEffect::FreeInstance(LADSPA_Handle handle)
 {
+   std::lock_guard<std::mutex> lock{ sInstanceMutex };
+
    if (mData->deactivate)
    {
       mData->deactivate(handle);
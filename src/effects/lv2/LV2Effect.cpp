@@ -32,7 +32,6 @@
 #include <wx/dialog.h>
 #include <wx/crt.h>
 #include <wx/log.h>
-#include <wx/msgqueue.h>
 
 #ifdef __WXMAC__
 #include <wx/evtloop.h>
@@ -77,6 +76,9 @@
 // Define a reasonable default sequence size in bytes
 #define DEFAULT_SEQSIZE 8192
 
+// Define the size in bytes of the rings of worker requests and responses
+#define WORKER_RINGSIZE 8192
+
 // Define the static URI map
 URIDMap LV2Effect::gURIDMap;
 
@@ -1074,6 +1076,8 @@ size_t LV2Effect::ProcessBlock(float **inbuf, float **outbuf, size_t size)
 
    LilvInstance *instance = mProcess->GetInstance();
 
+   StageControls();
+
    int i = 0;
    int o = 0;
    for (auto & port : mAudioPorts)
@@ -1244,6 +1248,9 @@ bool LV2Effect::RealtimeResume()
 
 bool LV2Effect::RealtimeProcessStart()
 {
+   // The same values for the master and all slaves in this cycle
+   StageControls();
+
    int i = 0;
    for (auto & port : mAudioPorts)
    {
@@ -2015,10 +2022,14 @@ LV2Wrapper *LV2Effect::InitInstance(float sampleRate)
       // then connect the port to a dummy field since slave output port
       // values are unwanted as the master values will be used.
       //
-      // Otherwise, connect it to the real value field.
+      // Otherwise, connect it to the real value field, or for input, to
+      // the copy of it that is staged before each run.
+      port->mCur = port->mVal;
       lilv_instance_connect_port(instance,
                                  port->mIndex,
-                                 !port->mIsInput && mMaster
+                                 port->mIsInput
+                                 ? &port->mCur
+                                 : mMaster
                                  ? &port->mDmy
                                  : &port->mVal);
    }
@@ -2061,6 +2072,18 @@ void LV2Effect::FreeInstance(LV2Wrapper *wrapper)
    delete wrapper;
 }
 
+void LV2Effect::StageControls()
+{
+   // Changes made meanwhile by the interface take effect at the next run
+   for (auto & port : mControlPorts)
+   {
+      if (port->mIsInput)
+      {
+         port->mCur = port->mVal;
+      }
+   }
+}
+
 bool LV2Effect::BuildFancy()
 {
    // Set the native UI type
@@ -3275,6 +3298,8 @@ LV2Wrapper::LV2Wrapper(LV2Effect *effect)
    mFreeWheeling = false;
    mLatency = 0.0;
    mStopWorker = false;
+   mRequests = NULL;
+   mResponses = NULL;
 }
 
 LV2Wrapper::~LV2Wrapper()
@@ -3285,9 +3310,7 @@ LV2Wrapper::~LV2Wrapper()
       if (thread && thread->IsAlive())
       {
          mStopWorker = true;
-
-         LV2Work work = {0, NULL};
-         mRequests.Post(work);
+         mRequestsPending.Post();
 
          thread->Wait();
       }
@@ -3301,6 +3324,16 @@ LV2Wrapper::~LV2Wrapper()
       lilv_instance_free(mInstance);
       mInstance = NULL;
    }
+
+   if (mRequests)
+   {
+      zix_ring_free(mRequests);
+   }
+
+   if (mResponses)
+   {
+      zix_ring_free(mResponses);
+   }
 }
 
 LilvInstance *LV2Wrapper::Instantiate(const LilvPlugin *plugin,
@@ -3372,11 +3405,18 @@ LilvInstance *LV2Wrapper::Instantiate(const LilvPlugin *plugin,
 
    if (mWorkerInterface)
    {
+      // Allocate everything here, so that nothing need be while processing
+      mRequests = zix_ring_new(WORKER_RINGSIZE);
+      zix_ring_mlock(mRequests);
+      mResponses = zix_ring_new(WORKER_RINGSIZE);
+      zix_ring_mlock(mResponses);
+      mRequestBuffer.resize(WORKER_RINGSIZE);
+      mResponseBuffer.resize(WORKER_RINGSIZE);
+
       if (CreateThread() == wxTHREAD_NO_ERROR)
       {
          GetThread()->Run();
       }
-
    }
 
    return mInstance;
@@ -3435,20 +3475,26 @@ void LV2Wrapper::ConnectPorts(float **inbuf, float **outbuf)
 
 void *LV2Wrapper::Entry()
 {
-   LV2Work work;
-
-   while (mRequests.Receive(work) == wxMSGQUEUE_NO_ERROR)
+   // The semaphore is posted once for each request, and once more to stop
+   while (mRequestsPending.Wait() == wxSEMA_NO_ERROR)
    {
       if (mStopWorker)
       {
          break;
       }
 
+      uint32_t size;
+      if (zix_ring_read(mRequests, &size, sizeof(size)) != sizeof(size))
+      {
+         continue;
+      }
+      zix_ring_read(mRequests, mRequestBuffer.data(), size);
+
       mWorkerInterface->work(mHandle,
                              respond,
                              this,
-                             work.size,
-                             work.data);
+                             size,
+                             mRequestBuffer.data());
    }
 
    return (void *) 0;
@@ -3458,11 +3504,12 @@ void LV2Wrapper::SendResponses()
 {
    if (mWorkerInterface)
    {
-      LV2Work work;
+      uint32_t size;
 
-      while (mResponses.ReceiveTimeout(0, work) == wxMSGQUEUE_NO_ERROR)
+      while (zix_ring_read(mResponses, &size, sizeof(size)) == sizeof(size))
       {
-         mWorkerInterface->work_response(mHandle, work.size, work.data);
+         zix_ring_read(mResponses, mResponseBuffer.data(), size);
+         mWorkerInterface->work_response(mHandle, size, mResponseBuffer.data());
       }
 
       if (mWorkerInterface->end_run)
@@ -3482,6 +3529,11 @@ LV2_Worker_Status LV2Wrapper::schedule_work(LV2_Worker_Schedule_Handle handle,
 
 LV2_Worker_Status LV2Wrapper::ScheduleWork(uint32_t size, const void *data)
 {
+   if (!mWorkerInterface)
+   {
+      return LV2_WORKER_ERR_UNKNOWN;
+   }
+
    if (mFreeWheeling)
    {
       return mWorkerInterface->work(mHandle,
@@ -3491,9 +3543,15 @@ LV2_Worker_Status LV2Wrapper::ScheduleWork(uint32_t size, const void *data)
                                     data);
    }
 
-   LV2Work work = {size, data};
+   // The data need not outlive this call, so copy it into the ring
+   if (zix_ring_write_space(mRequests) < sizeof(size) + size)
+   {
+      return LV2_WORKER_ERR_NO_SPACE;
+   }
 
-   mRequests.Post(work);
+   zix_ring_write(mRequests, &size, sizeof(size));
+   zix_ring_write(mRequests, data, size);
+   mRequestsPending.Post();
 
    return LV2_WORKER_SUCCESS;
 }
@@ -3508,9 +3566,13 @@ LV2_Worker_Status LV2Wrapper::respond(LV2_Worker_Respond_Handle handle,
 
 LV2_Worker_Status LV2Wrapper::Respond(uint32_t size, const void *data)
 {
-   LV2Work work = {size, data};
+   if (zix_ring_write_space(mResponses) < sizeof(size) + size)
+   {
+      return LV2_WORKER_ERR_NO_SPACE;
+   }
 
-   mResponses.Post(work);
+   zix_ring_write(mResponses, &size, sizeof(size));
+   zix_ring_write(mResponses, data, size);
 
    return LV2_WORKER_SUCCESS;
 }
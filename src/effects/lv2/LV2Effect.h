@@ -18,7 +18,6 @@ class wxArrayString;
 #include <vector>
 
 #include <wx/event.h> // to inherit
-#include <wx/msgqueue.h>
 #include <wx/thread.h>
 #include <wx/timer.h>
 
@@ -191,6 +190,7 @@ public:
       mMax = 0.0;
       mDef = 0.0;
       mVal = 0.0;
+      mCur = 0.0;
       mLst = 0.0;
       mTmp = 0.0;
       mDmy = 0.0;
@@ -214,6 +214,9 @@ public:
    float mMax;
    float mDef;
    float mVal;
+   // Input ports are connected to this copy of mVal, which is updated only
+   // between runs, so that the plugin never sees a value change partway
+   float mCur;
    float mLst;
    float mTmp;
    float mDmy;
@@ -346,6 +349,8 @@ private:
 
    LV2Wrapper *InitInstance(float sampleRate);
    void FreeInstance(LV2Wrapper *wrapper);
+   // Copy the values of input control ports to what the instances read
+   void StageControls();
 
    static uint32_t uri_to_id(LV2_URI_Map_Callback_Data callback_data,
                              const char *map,
@@ -587,13 +592,6 @@ inline wxString LilvString(LilvNode *node, bool free)
 
 class LV2Wrapper : public wxThreadHelper
 {
-public:
-   typedef struct LV2Work
-   {
-      uint32_t size;
-      const void *data;
-   } LV2Work;
-
 public:
    LV2Wrapper(LV2Effect *effect);
    virtual ~LV2Wrapper();
@@ -636,8 +634,14 @@ private:
    LilvInstance *mInstance;
    LV2_Handle mHandle;
 
-   wxMessageQueue<LV2Work> mRequests;
-   wxMessageQueue<LV2Work> mResponses;
+   // Lock-free rings of work requests from the processing thread to the
+   // worker thread, and of responses back; each message is its size followed
+   // by a copy of its data, which the plugin need not keep
+   ZixRing *mRequests;
+   ZixRing *mResponses;
+   wxSemaphore mRequestsPending;
+   std::vector<uint8_t> mRequestBuffer;
+   std::vector<uint8_t> mResponseBuffer;
 
    // Options extension
    LV2_Options_Interface *mOptionsInterface;
@@ -12,6 +12,7 @@
 
 #include "LoadNyquist.h"
 
+#include <wx/filename.h>
 #include <wx/log.h>
 
 #include "Nyquist.h"
@@ -192,12 +193,19 @@ bool NyquistEffectsModule::AutoRegisterPlugins(PluginManagerInterface & pm)
          PluginManagerInterface::DefaultRegistrationCallback);
    }
 
+   // List the directories once, not once for each shipped effect; only the
+   // effects not yet in the registry are parsed
+   pm.FindFilesInPathList(wxT("*.ny"), pathList, files);
    for (size_t i = 0; i < WXSIZEOF(kShippedEffects); i++)
    {
-      files.clear();
-      pm.FindFilesInPathList(kShippedEffects[i], pathList, files);
       for (size_t j = 0, cnt = files.size(); j < cnt; j++)
       {
+         if (!wxFileName(files[j]).GetFullName().IsSameAs(
+               kShippedEffects[i], wxFileName::IsCaseSensitive()))
+         {
+            continue;
+         }
+
          if (!pm.IsPluginRegistered(files[j]))
          {
             // No checking of error ?
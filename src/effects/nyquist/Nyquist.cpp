@@ -874,6 +874,11 @@ bool NyquistEffect::Process()
          wxString prevlocale = wxSetlocale(LC_NUMERIC, NULL);
          wxSetlocale(LC_NUMERIC, wxString(wxT("C")));
 
+         // The interpreter and the sound library keep all their state in
+         // globals, so there is one of it per process, initialized afresh
+         // for each track in turn.  That is why this effect does not
+         // override MakeParallelProcessor, and tracks must not be given to
+         // it on other threads.
          nyx_init();
          nyx_set_os_callback(StaticOSCallback, (void *)this);
          nyx_capture_output(StaticOutputCallback, (void *)this);
@@ -1342,14 +1347,18 @@ bool NyquistEffect::ProcessOne()
       cmd += mCmd;
    }
 
-   // Put the fetch buffers in a clean initial state
-   for (size_t i = 0; i < mCurNumChannels; i++)
-      mCurBuffer[i].Free();
+   // Put the fetch caches in a clean initial state
+   for (size_t i = 0; i < mCurNumChannels; i++) {
+      if (mCurTrack[i]) {
+         mCurCache[i].SetTrack( mCurTrack[i]->SharedPointer<const WaveTrack>() );
+         mCurCache[i].SetReadAhead(true);
+      }
+   }
 
    // Guarantee release of memory when done
    auto cleanup = finally( [&] {
       for (size_t i = 0; i < mCurNumChannels; i++)
-         mCurBuffer[i].Free();
+         mCurCache[i].SetTrack( {} );
    } );
 
    // Evaluate the expression, which may invoke the get callback, but often does
@@ -1505,9 +1514,8 @@ bool NyquistEffect::ProcessOne()
       outputTrack[i] = mCurTrack[i]->EmptyCopy();
       outputTrack[i]->SetRate( rate );
 
-      // Clean the initial buffer states again for the get callbacks
-      // -- is this really needed?
-      mCurBuffer[i].Free();
+      mOutputBuffer[i].reinit( outputTrack[i]->GetMaxBlockSize() );
+      mOutputBufferLen[i] = 0;
    }
 
    // Now fully evaluate the sound
@@ -1516,8 +1524,20 @@ bool NyquistEffect::ProcessOne()
       auto vr0 = valueRestorer( mOutputTrack[0], outputTrack[0].get() );
       auto vr1 = valueRestorer( mOutputTrack[1], outputTrack[1].get() );
       success = nyx_get_audio(StaticPutCallback, (void *)this);
+
+      // Append what the put callback has not yet
+      for (int i = 0; success && i < outChannels; i++) {
+         outputTrack[i]->Append(
+            (samplePtr)mOutputBuffer[i].get(), floatSample,
+            mOutputBufferLen[i]);
+         mOutputBufferLen[i] = 0;
+      }
    }
 
+   // Stop reading ahead before the input tracks are changed below
+   for (size_t i = 0; i < mCurNumChannels; i++)
+      mCurCache[i].SetTrack( {} );
+
    // See if GetCallback found read errors
    {
       auto pException = mpException;
@@ -2285,45 +2305,21 @@ int NyquistEffect::StaticGetCallback(float *buffer, int channel,
 int NyquistEffect::GetCallback(float *buffer, int ch,
                                long start, long len, long WXUNUSED(totlen))
 {
-   if (mCurBuffer[ch].ptr()) {
-      if ((mCurStart[ch] + start) < mCurBufferStart[ch] ||
-          (mCurStart[ch] + start)+len >
-          mCurBufferStart[ch]+mCurBufferLen[ch]) {
-         mCurBuffer[ch].Free();
-      }
-   }
-
-   if (!mCurBuffer[ch].ptr()) {
-      mCurBufferStart[ch] = (mCurStart[ch] + start);
-      mCurBufferLen[ch] = mCurTrack[ch]->GetBestBlockSize(mCurBufferStart[ch]);
-
-      if (mCurBufferLen[ch] < (size_t) len) {
-         mCurBufferLen[ch] = mCurTrack[ch]->GetIdealBlockSize();
-      }
-
-      mCurBufferLen[ch] =
-         limitSampleBufferSize( mCurBufferLen[ch],
-                                mCurStart[ch] + mCurLen - mCurBufferStart[ch] );
-
-      mCurBuffer[ch].Allocate(mCurBufferLen[ch], floatSample);
-      try {
-         mCurTrack[ch]->Get(
-            mCurBuffer[ch].ptr(), floatSample,
-            mCurBufferStart[ch], mCurBufferLen[ch]);
-      }
-      catch ( ... ) {
-         // Save the exception object for re-throw when out of the library
-         mpException = std::current_exception();
+   try {
+      // The cache reads whole blocks, ahead of the requests
+      const auto pSamples = mCurCache[ch].Get(
+         floatSample, mCurStart[ch] + start, len, true);
+      if (!pSamples)
          return -1;
-      }
+      CopySamples(pSamples, floatSample,
+                  (samplePtr)buffer, floatSample,
+                  len);
+   }
+   catch ( ... ) {
+      // Save the exception object for re-throw when out of the library
+      mpException = std::current_exception();
+      return -1;
    }
-
-   // We have guaranteed above that this is nonnegative and bounded by
-   // mCurBufferLen[ch]:
-   auto offset = ( mCurStart[ch] + start - mCurBufferStart[ch] ).as_size_t();
-   CopySamples(mCurBuffer[ch].ptr() + offset*SAMPLE_SIZE(floatSample), floatSample,
-               (samplePtr)buffer, floatSample,
-               len);
 
    if (ch == 0) {
       double progress = mScale *
@@ -2366,7 +2362,23 @@ int NyquistEffect::PutCallback(float *buffer, int channel,
          }
       }
 
-      mOutputTrack[channel]->Append((samplePtr)buffer, floatSample, len);
+      // Gather the output into whole blocks before appending it
+      auto &outputBuffer = mOutputBuffer[channel];
+      auto &outputLen = mOutputBufferLen[channel];
+      const auto blockSize = mOutputTrack[channel]->GetMaxBlockSize();
+      size_t done = 0;
+      while (done < (size_t) len) {
+         const auto count = std::min(blockSize - outputLen, (size_t) len - done);
+         memcpy(&outputBuffer[outputLen], buffer + done,
+            count * sizeof(float));
+         outputLen += count;
+         done += count;
+         if (outputLen == blockSize) {
+            mOutputTrack[channel]->Append(
+               (samplePtr)outputBuffer.get(), floatSample, outputLen);
+            outputLen = 0;
+         }
+      }
 
       return 0; // success
    }, MakeSimpleGuard( -1 ) ); // translate all exceptions into failure
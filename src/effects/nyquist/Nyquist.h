@@ -12,6 +12,7 @@
 #define __AUDACITY_EFFECT_NYQUIST__
 
 #include "../Effect.h"
+#include "../../WaveTrack.h"
 
 #include "nyx.h"
 
@@ -258,11 +259,13 @@ private:
    double            mProgressTot;
    double            mScale;
 
-   SampleBuffer      mCurBuffer[2];
-   sampleCount       mCurBufferStart[2];
-   size_t            mCurBufferLen[2];
+   // Read ahead of the get callback, which mostly asks for the next samples
+   WaveTrackCache    mCurCache[2];
 
    WaveTrack        *mOutputTrack[2];
+   // The put callback appends whole blocks of these to the output tracks
+   Floats            mOutputBuffer[2];
+   size_t            mOutputBufferLen[2];
 
    wxArrayString     mCategories;
 
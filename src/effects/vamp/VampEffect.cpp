@@ -34,6 +34,13 @@
 #include <wx/intl.h>
 #include <wx/scrolwin.h>
 #include <wx/version.h>
+#include <wx/utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
 
 
 #include "../../ShuttleGui.h"
@@ -341,6 +348,121 @@ bool VampEffect::Init()
    return true;
 }
 
+// The work for one track group:  its own instance of the plugin, and the
+// features it found, kept until all groups are done
+struct VampEffect::Analysis
+{
+   const WaveTrack *left{};
+   const WaveTrack *right{};
+   unsigned channels{ 1 };
+   sampleCount start{ 0 };
+   sampleCount len{ 0 };
+   // Either mPlugin, or an instance owned here
+   Vamp::Plugin *plugin{};
+   std::unique_ptr<Vamp::Plugin> instance;
+   LabelTrack *ltrack{};
+   Vamp::Plugin::FeatureList features;
+};
+
+std::unique_ptr<Vamp::Plugin> VampEffect::MakeInstance()
+{
+   // A Vamp plugin can be initialised only once, so each track group needs
+   // its own instance, with the settings of mPlugin
+   Vamp::HostExt::PluginLoader *loader = Vamp::HostExt::PluginLoader::getInstance();
+   std::unique_ptr<Vamp::Plugin> plugin{
+      loader->loadPlugin(mKey, mRate, Vamp::HostExt::PluginLoader::ADAPT_ALL) };
+   if (!plugin)
+      return {};
+
+   if (!mPlugin->getPrograms().empty())
+      plugin->selectProgram(mPlugin->getCurrentProgram());
+   for (const auto &parameter : mPlugin->getParameterDescriptors())
+      plugin->setParameter(parameter.identifier,
+         mPlugin->getParameter(parameter.identifier));
+
+   return plugin;
+}
+
+// Safe to call from a worker thread:  it touches only the analysis, reads
+// the tracks through caches, and reports through progress
+bool VampEffect::Analyze(Analysis &analysis, size_t step, size_t block,
+   const std::function<bool(double)> &progress)
+{
+   auto &plugin = *analysis.plugin;
+   const auto channels = analysis.channels;
+   const auto start = analysis.start;
+   const auto originalLen = analysis.len;
+   auto len = originalLen;
+
+   // The plugin asks for the samples in order, so read ahead of it
+   WaveTrackCache caches[2];
+   const WaveTrack *tracks[2] = { analysis.left, analysis.right };
+   for (unsigned c = 0; c < channels; ++c) {
+      caches[c].SetTrack(tracks[c]->SharedPointer<const WaveTrack>());
+      caches[c].SetReadAhead(true);
+   }
+
+   FloatBuffers data{ channels, block };
+
+   auto pos = start;
+
+   while (len != 0)
+   {
+      const auto request = limitSampleBufferSize( block, len );
+
+      for (unsigned c = 0; c < channels; ++c)
+      {
+         auto samples = reinterpret_cast<const float *>(
+            caches[c].Get(floatSample, pos, request, true));
+         std::copy(samples, samples + request, data[c].get());
+      }
+
+      if (request < block)
+      {
+         for (unsigned int c = 0; c < channels; ++c)
+         {
+            for (decltype(block) i = request; i < block; ++i)
+            {
+               data[c][i] = 0.f;
+            }
+         }
+      }
+
+      // UNSAFE_SAMPLE_COUNT_TRUNCATION
+      // Truncation in case of very long tracks!
+      Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(
+         long( pos.as_long_long() ),
+         (int)(mRate + 0.5)
+      );
+
+      Vamp::Plugin::FeatureSet features = plugin.process(
+         reinterpret_cast< float** >( data.get() ), timestamp);
+      AppendFeatures(analysis.features, features);
+
+      if (len > (int)step)
+      {
+         len -= step;
+      }
+      else
+      {
+         len = 0;
+      }
+
+      pos += step;
+
+      if (!progress(
+            (pos - start).as_double() / originalLen.as_double() ))
+      {
+         return false;
+      }
+   }
+
+   Vamp::Plugin::FeatureSet features = plugin.getRemainingFeatures();
+   AppendFeatures(analysis.features, features);
+
+   return true;
+}
+
 bool VampEffect::Process()
 {
    if (!mPlugin)
@@ -348,10 +470,7 @@ bool VampEffect::Process()
       return false;
    }
 
-   int count = 0;
-
    bool multiple = false;
-   unsigned prevTrackChannels = 0;
 
    if (GetNumWaveGroups() > 1)
    {
@@ -362,164 +481,160 @@ bool VampEffect::Process()
       multiple = true;
    }
 
+   size_t step = mPlugin->getPreferredStepSize();
+   size_t block = mPlugin->getPreferredBlockSize();
+
+   if (block == 0)
+   {
+      if (step != 0)
+      {
+         block = step;
+      }
+      else
+      {
+         block = 1024;
+      }
+   }
+
+   if (step == 0)
+   {
+      step = block;
+   }
+
    std::vector<std::shared_ptr<Effect::AddedAnalysisTrack>> addedTracks;
+   std::vector<Analysis> analyses;
 
    for (auto leader : inputTracks()->Leaders<const WaveTrack>())
    {
       auto channelGroup = TrackList::Channels(leader);
-      auto left = *channelGroup.first++;
 
-      unsigned channels = 1;
+      Analysis analysis;
+      analysis.left = *channelGroup.first++;
 
       // channelGroup now contains all but the first channel
-      const WaveTrack *right =
+      analysis.right =
          channelGroup.size() ? *channelGroup.first++ : nullptr;
-      if (right)
-         channels = 2;
+      if (analysis.right)
+         analysis.channels = 2;
 
-      sampleCount start = 0;
-      sampleCount len = 0;
-      GetBounds(*left, right, &start, &len);
+      GetBounds(*analysis.left, analysis.right,
+         &analysis.start, &analysis.len);
 
       // TODO: more-than-two-channels
 
-      size_t step = mPlugin->getPreferredStepSize();
-      size_t block = mPlugin->getPreferredBlockSize();
-
-      bool initialiseRequired = true;
-
-      if (block == 0)
+      // The first group uses mPlugin itself, the others copies of it
+      if (analyses.empty())
+         analysis.plugin = mPlugin.get();
+      else
       {
-         if (step != 0)
-         {
-            block = step;
-         }
-         else
+         analysis.instance = MakeInstance();
+         analysis.plugin = analysis.instance.get();
+         if (!analysis.plugin)
          {
-            block = 1024;
+            Effect::MessageBox( XO("Sorry, failed to load Vamp Plug-in.") );
+            return false;
          }
       }
 
-      if (step == 0)
-      {
-         step = block;
-      }
-
-      if (prevTrackChannels > 0)
-      {
-         // Plugin has already been initialised, so if the number of
-         // channels remains the same, we only need to do a reset.
-         // Otherwise we need to re-construct the whole plugin,
-         // because a Vamp plugin can't be re-initialised.
-         if (prevTrackChannels == channels)
-         {
-            mPlugin->reset();
-            initialiseRequired = false;
-         }
-         else
-         {
-            //!!! todo: retain parameters previously set
-            Init();
-         }
-      }
+      analyses.push_back(std::move(analysis));
+   }
 
-      if (initialiseRequired)
+   for (auto &analysis : analyses)
+   {
+      if (!analysis.plugin->initialise(analysis.channels, step, block))
       {
-         if (!mPlugin->initialise(channels, step, block))
-         {
-            Effect::MessageBox(
-               XO("Sorry, Vamp Plug-in failed to initialize.") );
-            return false;
-         }
+         Effect::MessageBox(
+            XO("Sorry, Vamp Plug-in failed to initialize.") );
+         return false;
       }
 
       const auto effectName = GetSymbol().Translation();
       addedTracks.push_back(AddAnalysisTrack(
          multiple
-         ? wxString::Format( _("%s: %s"), left->GetName(), effectName )
+         ? wxString::Format( _("%s: %s"),
+            analysis.left->GetName(), effectName )
          : effectName
       ));
-      LabelTrack *ltrack = addedTracks.back()->get();
-
-      FloatBuffers data{ channels, block };
-
-      auto originalLen = len;
-
-      auto pos = start;
+      analysis.ltrack = addedTracks.back()->get();
+   }
 
-      while (len != 0)
+   const auto nGroups = analyses.size();
+   const auto nThreads =
+      std::min<size_t>(nGroups, std::thread::hardware_concurrency());
+   if (nThreads <= 1)
+   {
+      int count = 0;
+      for (auto &analysis : analyses)
       {
-         const auto request = limitSampleBufferSize( block, len );
-
-         if (left)
-         {
-            left->Get((samplePtr)data[0].get(), floatSample, pos, request);
-         }
-
-         if (right)
-         {
-            right->Get((samplePtr)data[1].get(), floatSample, pos, request);
-         }
-
-         if (request < block)
-         {
-            for (unsigned int c = 0; c < channels; ++c)
-            {
-               for (decltype(block) i = request; i < block; ++i)
-               {
-                  data[c][i] = 0.f;
+         const bool stereo = analysis.channels > 1;
+         if (!Analyze(analysis, step, block, [&](double frac) {
+               return !(stereo
+                  ? TrackGroupProgress(count, frac)
+                  : TrackProgress(count, frac)); }))
+            return false;
+         ++count;
+      }
+   }
+   else
+   {
+      // Each group has its own plugin instance and caches, so the groups
+      // are independent; the main thread sums their progress
+      std::vector< std::atomic<double> > fractions(nGroups);
+      std::atomic<bool> stopped{ false };
+      std::atomic<size_t> next{ 0 };
+      std::atomic<size_t> nDone{ 0 };
+      std::vector<std::exception_ptr> errors(nThreads);
+      {
+         std::vector<std::thread> threads;
+         // Whatever happens, wait for the threads before the tracks go away
+         auto cleanup = finally( [&] {
+            stopped.store(true);
+            for (auto &thread : threads)
+               thread.join();
+         } );
+         for (size_t ii = 0; ii < nThreads; ++ii)
+            threads.emplace_back( [&, ii]{
+               try {
+                  for (size_t jj = 0;
+                       !stopped.load() && (jj = next++) < nGroups;) {
+                     auto &fraction = fractions[jj];
+                     if (!Analyze(analyses[jj], step, block,
+                           [&](double frac) -> bool {
+                              fraction.store(frac);
+                              return !stopped.load(); })) {
+                        stopped.store(true);
+                        break;
+                     }
+                     ++nDone;
+                  }
                }
-            }
-         }
-
-         // UNSAFE_SAMPLE_COUNT_TRUNCATION
-         // Truncation in case of very long tracks!
-         Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(
-            long( pos.as_long_long() ),
-            (int)(mRate + 0.5)
-         );
-
-         Vamp::Plugin::FeatureSet features = mPlugin->process(
-            reinterpret_cast< float** >( data.get() ), timestamp);
-         AddFeatures(ltrack, features);
-
-         if (len > (int)step)
-         {
-            len -= step;
-         }
-         else
-         {
-            len = 0;
-         }
-
-         pos += step;
-
-         if (channels > 1)
-         {
-            if (TrackGroupProgress(count,
-                  (pos - start).as_double() /
-                  originalLen.as_double() ))
-            {
-               return false;
-            }
-         }
-         else
-         {
-            if (TrackProgress(count,
-                  (pos - start).as_double() /
-                  originalLen.as_double() ))
-            {
-               return false;
-            }
+               catch (...) {
+                  errors[ii] = std::current_exception();
+                  stopped.store(true);
+               }
+            } );
+
+         while (nDone.load() < nGroups && !stopped.load()) {
+            double sum = 0;
+            for (const auto &fraction : fractions)
+               sum += fraction.load();
+            if (TotalProgress(sum / nGroups))
+               stopped.store(true);
+            else
+               ::wxMilliSleep(10);
          }
       }
-
-      Vamp::Plugin::FeatureSet features = mPlugin->getRemainingFeatures();
-      AddFeatures(ltrack, features);
-
-      prevTrackChannels = channels;
+      for (auto &error : errors)
+         if (error)
+            std::rethrow_exception(error);
+      if (nDone.load() < nGroups)
+         return false;
    }
 
+   // Labels are added in track order, only after all groups are done
+   for (auto &analysis : analyses)
+      AddFeatures(analysis.ltrack, analysis.features);
+
    // All completed without cancellation, so commit the addition of tracks now
    for (auto &addedTrack : addedTracks)
       addedTrack->Commit();
@@ -717,11 +832,18 @@ bool VampEffect::TransferDataFromWindow()
 
 // VampEffect implementation
 
+void VampEffect::AppendFeatures(Vamp::Plugin::FeatureList &list,
+                                Vamp::Plugin::FeatureSet &features)
+{
+   auto &output = features[mOutput];
+   list.insert(list.end(), output.begin(), output.end());
+}
+
 void VampEffect::AddFeatures(LabelTrack *ltrack,
-                             Vamp::Plugin::FeatureSet &features)
+                             const Vamp::Plugin::FeatureList &features)
 {
-   for (Vamp::Plugin::FeatureList::iterator fli = features[mOutput].begin();
-        fli != features[mOutput].end(); ++fli)
+   for (Vamp::Plugin::FeatureList::const_iterator fli = features.begin();
+        fli != features.end(); ++fli)
    {
       Vamp::RealTime ftime0 = fli->timestamp;
       double ltime0 = ftime0.sec + (double(ftime0.nsec) / 1000000000.0);
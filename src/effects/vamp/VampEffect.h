@@ -19,6 +19,8 @@
 
 #include "../Effect.h"
 
+#include <functional>
+
 class wxStaticText;
 class wxSlider;
 class wxChoice;
@@ -73,7 +75,16 @@ public:
 private:
    // VampEffect implementation
 
-   void AddFeatures(LabelTrack *track, Vamp::Plugin::FeatureSet & features);
+   struct Analysis;
+
+   std::unique_ptr<Vamp::Plugin> MakeInstance();
+   bool Analyze(Analysis &analysis, size_t step, size_t block,
+                const std::function<bool(double)> &progress);
+
+   void AppendFeatures(Vamp::Plugin::FeatureList &list,
+                       Vamp::Plugin::FeatureSet & features);
+   void AddFeatures(LabelTrack *track,
+                    const Vamp::Plugin::FeatureList & features);
 
    void UpdateFromPlugin();
 
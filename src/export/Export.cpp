@@ -73,6 +73,59 @@
 #include "../widgets/HelpSystem.h"
 #include "../widgets/ProgressDialog.h"
 
+//----------------------------------------------------------------------------
+// ConcurrentExport
+//----------------------------------------------------------------------------
+
+namespace {
+thread_local ConcurrentExport *sCurrentExport = nullptr;
+}
+
+ConcurrentExport::ConcurrentExport(
+   std::mutex &setupMutex, WaveTrackConstArray tracks)
+   : mSetupLock{ setupMutex, std::defer_lock }
+   , mTracks{ std::move( tracks ) }
+   , mRequest{ static_cast<unsigned>( ProgressResult::Success ) }
+{
+}
+
+ConcurrentExport::Scope::Scope( ConcurrentExport &concurrentExport )
+   : mExport{ concurrentExport }
+{
+   wxASSERT( !sCurrentExport );
+   mExport.mSetupLock.lock();
+   sCurrentExport = &mExport;
+}
+
+ConcurrentExport::Scope::~Scope()
+{
+   sCurrentExport = nullptr;
+   mExport.EndSetup();
+}
+
+ConcurrentExport *ConcurrentExport::Current()
+{
+   return sCurrentExport;
+}
+
+void ConcurrentExport::Request(ProgressResult result)
+{
+   mRequest.store( static_cast<unsigned>( result ) );
+}
+
+void ConcurrentExport::EndSetup()
+{
+   if (mSetupLock.owns_lock())
+      mSetupLock.unlock();
+}
+
+ProgressResult ConcurrentExport::Update(double current, double total)
+{
+   if (total > 0)
+      mFraction.store( std::max( 0.0, std::min( 1.0, current / total ) ) );
+   return static_cast<ProgressResult>( mRequest.load() );
+}
+
 //----------------------------------------------------------------------------
 // ExportPlugin
 //----------------------------------------------------------------------------
@@ -90,6 +143,11 @@ bool ExportPlugin::CheckFileName(wxFileName & WXUNUSED(filename), int WXUNUSED(f
   return true;
 }
 
+bool ExportPlugin::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return false;
+}
+
 /** \brief Add a NEW entry to the list of formats this plug-in can export
  *
  * To configure the format use SetFormat, SetCanMetaData etc with the index of
@@ -228,18 +286,24 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
 {
    WaveTrackConstArray inputTracks;
 
-   bool anySolo = !(( tracks.Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
-
-   auto range = tracks.Any< const WaveTrack >()
-      + (selectionOnly ? &Track::IsSelected : &Track::Any )
-      - ( anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute);
-   for (auto pTrack: range)
-      inputTracks.push_back(
-         pTrack->SharedPointer< const WaveTrack >() );
+   const auto pConcurrentExport = ConcurrentExport::Current();
+   if (pConcurrentExport && !pConcurrentExport->GetTracks().empty())
+      // The selection is not for worker threads to use
+      inputTracks = pConcurrentExport->GetTracks();
+   else {
+      bool anySolo = !(( tracks.Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
+
+      auto range = tracks.Any< const WaveTrack >()
+         + (selectionOnly ? &Track::IsSelected : &Track::Any )
+         - ( anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute);
+      for (auto pTrack: range)
+         inputTracks.push_back(
+            pTrack->SharedPointer< const WaveTrack >() );
+   }
    const auto timeTrack = *tracks.Any<const TimeTrack>().begin();
    auto envelope = timeTrack ? timeTrack->GetEnvelope() : nullptr;
    // MB: the stop time should not be warped, this was a bug.
-   return std::make_unique<Mixer>(inputTracks,
+   auto mixer = std::make_unique<Mixer>(inputTracks,
                   // Throw, to stop exporting, if read fails:
                   true,
                   Mixer::WarpOptions(envelope),
@@ -247,11 +311,21 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
                   numOutChannels, outBufferSize, outInterleaved,
                   outRate, outFormat,
                   highQuality, mixerSpec);
+   // Concurrent exports already keep the processors busy
+   if (!pConcurrentExport)
+      mixer->ProcessTracksInParallel();
+   return mixer;
 }
 
 void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
    const TranslatableString &title, const TranslatableString &message)
 {
+   if (auto pConcurrentExport = ConcurrentExport::Current()) {
+      // No dialog on a worker thread; setup is done, let others proceed
+      pConcurrentExport->EndSetup();
+      return;
+   }
+
    if (!pDialog)
       pDialog = std::make_unique<ProgressDialog>( title, message );
    else {
@@ -268,6 +342,14 @@ void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
       pDialog, Verbatim( title.GetName() ), message );
 }
 
+ProgressResult ExportPlugin::UpdateProgress(
+   std::unique_ptr<ProgressDialog> &pDialog, double current, double total)
+{
+   if (auto pConcurrentExport = ConcurrentExport::Current())
+      return pConcurrentExport->Update( current, total );
+   return pDialog->Update( current, total );
+}
+
 //----------------------------------------------------------------------------
 // Export
 //----------------------------------------------------------------------------
@@ -11,7 +11,9 @@
 #ifndef __AUDACITY_EXPORT__
 #define __AUDACITY_EXPORT__
 
+#include <atomic>
 #include <functional>
+#include <mutex>
 #include <vector>
 #include <wx/filename.h> // member variable
 #include "audacity/Types.h"
@@ -40,6 +42,57 @@ using WaveTrackConstArray = std::vector < std::shared_ptr < const WaveTrack > >;
 enum class ProgressResult : unsigned;
 class wxFileNameWrapper;
 
+//----------------------------------------------------------------------------
+// ConcurrentExport
+//----------------------------------------------------------------------------
+/// \brief Lets ExportPlugin::Export() run on a worker thread, as
+/// ExportMultipleDialog does for plug-ins that CanExportConcurrently().
+///
+/// While one is installed on a thread by a Scope, the plug-in shows no
+/// progress dialog but reports here, its mixer takes the given tracks
+/// instead of the selection, and all of its preparation up to
+/// InitProgress() holds the setup mutex, so that reading preferences, setting
+/// up libraries and plug-in state is never done by two exports at once.
+class AUDACITY_DLL_API ConcurrentExport
+{
+public:
+   /// Empty tracks means all unmuted tracks, as usual
+   ConcurrentExport(std::mutex &setupMutex, WaveTrackConstArray tracks = {});
+
+   class AUDACITY_DLL_API Scope
+   {
+   public:
+      /// Installs concurrentExport for this thread, taking the setup mutex
+      explicit Scope( ConcurrentExport &concurrentExport );
+      ~Scope();
+      Scope( const Scope& ) = delete;
+      Scope &operator=( const Scope& ) = delete;
+   private:
+      ConcurrentExport &mExport;
+   };
+
+   /// The object installed for this thread, or null
+   static ConcurrentExport *Current();
+
+   /// How much of the export is done, from 0 to 1; from any thread
+   double GetFraction() const { return mFraction.load(); }
+
+   /// Make the export stop or cancel at its next progress update; from any
+   /// thread
+   void Request(ProgressResult result);
+
+   // For ExportPlugin
+   void EndSetup();
+   ProgressResult Update(double current, double total);
+   const WaveTrackConstArray &GetTracks() const { return mTracks; }
+
+private:
+   std::unique_lock<std::mutex> mSetupLock;
+   const WaveTrackConstArray mTracks;
+   std::atomic<double> mFraction{ 0.0 };
+   std::atomic<unsigned> mRequest;
+};
+
 class AUDACITY_DLL_API FormatInfo
 {
    public:
@@ -102,6 +155,15 @@ public:
     * of channels in exported file. -1 for unspecified */
    virtual int SetNumExportChannels() { return -1; }
 
+   /** \brief Whether Export() of the subformat may run on a worker thread,
+    * under a ConcurrentExport::Scope.
+    *
+    * Such plug-ins report progress only through InitProgress() and
+    * UpdateProgress(), choose tracks only through CreateMixer(), and show
+    * messages only with AudacityMessageBox(), which any thread may call.
+    * Each concurrent export uses its own plug-in object. */
+   virtual bool CanExportConcurrently(int subformat);
+
    /** \brief called to export audio into a file.
     *
     * @param pDialog To be initialized with pointer to a NEW ProgressDialog if
@@ -148,6 +210,11 @@ protected:
    static void InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
          const wxFileNameWrapper &title, const TranslatableString &message);
 
+   // Update the dialog made by InitProgress(), or, in a concurrent export,
+   // report to the ConcurrentExport
+   static ProgressResult UpdateProgress(std::unique_ptr<ProgressDialog> &pDialog,
+         double current, double total);
+
 private:
    std::vector<FormatInfo> mFormatInfos;
 };
@@ -15,6 +15,14 @@
 
 #include "../ProjectSettings.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <wx/app.h>
 #include <wx/button.h>
 #include <wx/cmdline.h>
@@ -273,6 +281,160 @@ private:
    int mStatus;
 };
 
+// Writes the buffers given to it to the standard input of the command, on
+// a thread of its own, so that the mixing goes on while the command reads,
+// and the command reads while the next block is mixed
+class ExportCLWriter
+{
+public:
+   explicit ExportCLWriter(wxOutputStream &os)
+      : mOS{ os }
+   {
+      mThread = std::thread( [this]{ Run(); } );
+   }
+
+   ExportCLWriter(const ExportCLWriter&) PROHIBITED;
+   ExportCLWriter &operator=(const ExportCLWriter&) PROHIBITED;
+
+   ~ExportCLWriter()
+   {
+      Stop();
+   }
+
+   // An empty buffer, perhaps one already written, to fill and Put
+   std::vector<char> GetBuffer()
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      std::vector<char> result;
+      if (!mFree.empty()) {
+         result.swap(mFree.back());
+         mFree.pop_back();
+      }
+      result.clear();
+      return result;
+   }
+
+   bool HasRoom()
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      return mQueue.size() < QueueLength;
+   }
+
+   // Wait at most the given time for room in the queue, or for the end
+   void WaitForRoom(std::chrono::milliseconds timeout)
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mCondition.wait_for(lock, timeout, [this]{
+         return mDone || mQueue.size() < QueueLength; });
+   }
+
+   void Put(std::vector<char> &&buffer)
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mQueue.push_back(std::move(buffer));
+      }
+      mCondition.notify_all();
+   }
+
+   // No more buffers will come; the thread ends when all are written
+   void Finish()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mFinished = true;
+      }
+      mCondition.notify_all();
+   }
+
+   // Whether the thread ended, because all was written or writing failed
+   bool IsDone()
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      return mDone;
+   }
+
+   bool Failed()
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      return mFailed;
+   }
+
+   // Abandon the buffers not yet written, and wait for the thread
+   void Stop()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mStopped = true;
+      }
+      mCondition.notify_all();
+      if (mThread.joinable())
+         mThread.join();
+   }
+
+private:
+   // Buffers that may wait to be written
+   static constexpr size_t QueueLength = 4;
+
+   void Run()
+   {
+      bool failed = false;
+      while (!failed) {
+         std::vector<char> buffer;
+         {
+            std::unique_lock<std::mutex> lock{ mMutex };
+            mCondition.wait(lock, [this]{
+               return mStopped || mFinished || !mQueue.empty(); });
+            if (mStopped || mQueue.empty())
+               break;
+            buffer.swap(mQueue.front());
+            mQueue.pop_front();
+         }
+         mCondition.notify_all();
+
+         const char *data = buffer.data();
+         size_t numBytes = buffer.size();
+         while (numBytes > 0 && !mStopped.load()) {
+            // Don't write too much at once...pipes may not be able to handle it
+            mOS.Write(data, std::min<size_t>(numBytes, 4096));
+            if (!mOS.IsOk()) {
+               failed = true;
+               break;
+            }
+            const auto written = mOS.LastWrite();
+            if (written == 0)
+               // The command is slow to read
+               std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            numBytes -= written;
+            data += written;
+         }
+
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mFree.push_back(std::move(buffer));
+      }
+
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mFailed = failed;
+         mDone = true;
+      }
+      mCondition.notify_all();
+   }
+
+   wxOutputStream &mOS;
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque< std::vector<char> > mQueue;
+   std::vector< std::vector<char> > mFree;
+   bool mFinished{ false };
+   bool mDone{ false };
+   bool mFailed{ false };
+   std::atomic<bool> mStopped{ false };
+
+   std::thread mThread;
+};
+
 //----------------------------------------------------------------------------
 // ExportCL
 //----------------------------------------------------------------------------
@@ -512,8 +674,6 @@ ProgressResult ExportCL::Export(AudacityProject *project,
                             true,
                             mixerSpec);
 
-   size_t numBytes = 0;
-   samplePtr mixed = NULL;
    auto updateResult = ProgressResult::Success;
 
    {
@@ -522,6 +682,9 @@ ProgressResult ExportCL::Export(AudacityProject *project,
          process.CloseOutput();
       } );
 
+      // Destroyed before closeIt, so that the writing ends first
+      ExportCLWriter writer{ *os };
+
       // Prepare the progress display
       InitProgress( pDialog, XO("Export"),
          selectionOnly
@@ -529,46 +692,49 @@ ProgressResult ExportCL::Export(AudacityProject *project,
             : XO("Exporting the audio using command-line encoder") );
       auto &progress = *pDialog;
 
+      bool mixedAll = false;
+
       // Start piping the mixed data to the command
-      while (updateResult == ProgressResult::Success && process.IsActive() && os->IsOk()) {
-         // Capture any stdout and stderr from the command
+      while (updateResult == ProgressResult::Success && process.IsActive()) {
+         // Capture any stdout and stderr from the command; this does not
+         // wait for the command
          Drain(process.GetInputStream(), &output);
          Drain(process.GetErrorStream(), &output);
 
+         if (writer.IsDone()) {
+            if (writer.Failed())
+               updateResult = ProgressResult::Cancelled;
+            break;
+         }
+
          // Need to mix another block
-         if (numBytes == 0) {
+         if (!mixedAll && writer.HasRoom()) {
             auto numSamples = mixer->Process(maxBlockLen);
             if (numSamples == 0) {
-               break;
+               mixedAll = true;
+               writer.Finish();
+               continue;
             }
 
-            mixed = mixer->GetBuffer();
-            numBytes = numSamples * channels;
+            auto mixed = mixer->GetBuffer();
+            const auto numFloats = numSamples * channels;
 
             // Byte-swapping is neccesary on big-endian machines, since
             // WAV files are little-endian
 #if wxBYTE_ORDER == wxBIG_ENDIAN
             float *buffer = (float *) mixed;
-            for (int i = 0; i < numBytes; i++) {
+            for (int i = 0; i < numFloats; i++) {
                buffer[i] = wxUINT32_SWAP_ON_BE(buffer[i]);
             }
 #endif
-            numBytes *= SAMPLE_SIZE(floatSample);
-         }
-
-         // Don't write too much at once...pipes may not be able to handle it
-         size_t bytes = wxMin(numBytes, 4096);
-         numBytes -= bytes;
-
-         while (bytes > 0) {
-            os->Write(mixed, bytes);
-            if (!os->IsOk()) {
-               updateResult = ProgressResult::Cancelled;
-               break;
-            }
-            bytes -= os->LastWrite();
-            mixed += os->LastWrite();
+            auto block = writer.GetBuffer();
+            block.insert(block.end(),
+               mixed, mixed + numFloats * SAMPLE_SIZE(floatSample));
+            writer.Put(std::move(block));
          }
+         else
+            // The command is slower than the mixer
+            writer.WaitForRoom(std::chrono::milliseconds(10));
 
          // Update the progress display
          updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
@@ -116,6 +116,9 @@ public:
    /// Encodes audio
    bool EncodeAudioFrame(int16_t *pFrame, size_t frameSize);
 
+   /// Encodes one frame of default_frame_size samples and writes the packet
+   bool EncodeWholeFrame(int16_t *pFrame);
+
    /// Flushes audio encoder
    bool Finalize();
 
@@ -603,6 +606,13 @@ bool ExportFFmpeg::InitCodecs(AudacityProject *project)
       mEncFormatCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
    }
 
+   // Let encoders that can use several threads do so
+   if (codec->capabilities &
+       (AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS)) {
+      mEncAudioCodecCtx->thread_count = 0; // as many as there are cores
+      mEncAudioCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+   }
+
    // Open the codec.
    int rc = avcodec_open2(mEncAudioCodecCtx.get(), codec, &options);
    if (rc < 0)
@@ -659,12 +669,34 @@ bool ExportFFmpeg::InitCodecs(AudacityProject *project)
    return true;
 }
 
+// Fill the frame from interleaved 16 bit samples, for a packed or planar
+// format.  The format is chosen outside of the loops over the samples, so
+// that the compiler can vectorize them.
+template< typename Sample, typename Convert >
+static void fill_frame_samples(AVFrame *frame, int channels, bool planar,
+   const int16_t *src, const Convert &convert)
+{
+   const int nb_samples = frame->nb_samples;
+   if (!planar) {
+      auto dst = reinterpret_cast<Sample*>(frame->data[0]);
+      for (int i = 0, n = nb_samples * channels; i < n; i++)
+         dst[i] = convert(src[i]);
+   }
+   else {
+      for (int ch = 0; ch < channels; ch++) {
+         auto dst = reinterpret_cast<Sample*>(frame->data[ch]);
+         for (int i = 0; i < nb_samples; i++)
+            dst[i] = convert(src[ch + i*channels]);
+      }
+   }
+}
+
 // Returns 0 if no more output, 1 if more output, negative if error
 static int encode_audio(AVCodecContext *avctx, AVPacket *pkt, int16_t *audio_samples, int nb_samples)
 {
    // Assume *pkt is already initialized.
 
-   int i, ch, buffer_size, ret, got_output = 0;
+   int buffer_size, ret, got_output = 0;
    AVMallocHolder<uint8_t> samples;
    AVFrameHolder frame;
 
@@ -710,41 +742,38 @@ static int encode_audio(AVCodecContext *avctx, AVPacket *pkt, int16_t *audio_sam
          return ret;
       }
 
-      for (ch = 0; ch < avctx->channels; ch++) {
-         for (i = 0; i < frame->nb_samples; i++) {
-            switch(avctx->sample_fmt) {
-            case AV_SAMPLE_FMT_U8:
-               ((uint8_t*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels]/258 + 128;
-               break;
-            case AV_SAMPLE_FMT_U8P:
-               ((uint8_t*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels]/258 + 128;
-               break;
-            case AV_SAMPLE_FMT_S16:
-               ((int16_t*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels];
-               break;
-            case AV_SAMPLE_FMT_S16P:
-               ((int16_t*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels];
-               break;
-            case AV_SAMPLE_FMT_S32:
-               ((int32_t*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels]<<16;
-               break;
-            case AV_SAMPLE_FMT_S32P:
-               ((int32_t*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels]<<16;
-               break;
-            case AV_SAMPLE_FMT_FLT:
-               ((float*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels] / 32767.0;
-               break;
-            case AV_SAMPLE_FMT_FLTP:
-               ((float*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels] / 32767.;
-               break;
-            case AV_SAMPLE_FMT_NONE:
-            case AV_SAMPLE_FMT_DBL:
-            case AV_SAMPLE_FMT_DBLP:
-            case AV_SAMPLE_FMT_NB:
-               wxASSERT(false);
-               break;
-            }
-         }
+      const int channels = avctx->channels;
+      switch(avctx->sample_fmt) {
+      case AV_SAMPLE_FMT_U8:
+      case AV_SAMPLE_FMT_U8P:
+         fill_frame_samples<uint8_t>(frame.get(), channels,
+            avctx->sample_fmt == AV_SAMPLE_FMT_U8P, audio_samples,
+            [](int16_t sample) -> uint8_t { return sample/258 + 128; });
+         break;
+      case AV_SAMPLE_FMT_S16:
+      case AV_SAMPLE_FMT_S16P:
+         fill_frame_samples<int16_t>(frame.get(), channels,
+            avctx->sample_fmt == AV_SAMPLE_FMT_S16P, audio_samples,
+            [](int16_t sample) -> int16_t { return sample; });
+         break;
+      case AV_SAMPLE_FMT_S32:
+      case AV_SAMPLE_FMT_S32P:
+         fill_frame_samples<int32_t>(frame.get(), channels,
+            avctx->sample_fmt == AV_SAMPLE_FMT_S32P, audio_samples,
+            [](int16_t sample) -> int32_t { return sample<<16; });
+         break;
+      case AV_SAMPLE_FMT_FLT:
+      case AV_SAMPLE_FMT_FLTP:
+         fill_frame_samples<float>(frame.get(), channels,
+            avctx->sample_fmt == AV_SAMPLE_FMT_FLTP, audio_samples,
+            [](int16_t sample) -> float { return sample / 32767.0; });
+         break;
+      case AV_SAMPLE_FMT_NONE:
+      case AV_SAMPLE_FMT_DBL:
+      case AV_SAMPLE_FMT_DBLP:
+      case AV_SAMPLE_FMT_NB:
+         wxASSERT(false);
+         break;
       }
    }
 
@@ -895,14 +924,6 @@ bool ExportFFmpeg::EncodeAudioFrame(int16_t *pFrame, size_t frameSize)
 
    nBytesToWrite = frameSize;
    pRawSamples  = (uint8_t*)pFrame;
-   if (av_fifo_realloc2(mEncAudioFifo.get(), av_fifo_size(mEncAudioFifo.get()) + frameSize) < 0)
-      return false;
-
-   // Put the raw audio samples into the FIFO.
-   ret = av_fifo_generic_write(mEncAudioFifo.get(), pRawSamples, nBytesToWrite,NULL);
-
-   if(ret != nBytesToWrite)
-      return false;
 
    if (nAudioFrameSizeOut > mEncAudioFifoOutBufSiz) {
       AudacityMessageBox(
@@ -913,48 +934,77 @@ bool ExportFFmpeg::EncodeAudioFrame(int16_t *pFrame, size_t frameSize)
       return false;
    }
 
+   // While nothing waits in the FIFO, encode whole frames straight from the
+   // mixer's buffer; only what is left over is copied into the FIFO
+   if (av_fifo_size(mEncAudioFifo.get()) == 0) {
+      while (nBytesToWrite >= nAudioFrameSizeOut) {
+         if (!EncodeWholeFrame(reinterpret_cast<int16_t*>(pRawSamples)))
+            return false;
+         pRawSamples += nAudioFrameSizeOut;
+         nBytesToWrite -= nAudioFrameSizeOut;
+      }
+      if (nBytesToWrite == 0)
+         return true;
+   }
+
+   if (av_fifo_realloc2(mEncAudioFifo.get(), av_fifo_size(mEncAudioFifo.get()) + nBytesToWrite) < 0)
+      return false;
+
+   // Put the raw audio samples into the FIFO.
+   ret = av_fifo_generic_write(mEncAudioFifo.get(), pRawSamples, nBytesToWrite,NULL);
+
+   if(ret != nBytesToWrite)
+      return false;
+
    // Read raw audio samples out of the FIFO in nAudioFrameSizeOut byte-sized groups to encode.
    while ( av_fifo_size(mEncAudioFifo.get()) >= nAudioFrameSizeOut)
    {
       ret = av_fifo_generic_read(mEncAudioFifo.get(), mEncAudioFifoOutBuf.get(), nAudioFrameSizeOut, NULL);
 
-      AVPacketEx pkt;
-
-      ret= encode_audio(mEncAudioCodecCtx.get(),
-         &pkt,                          // out
-         mEncAudioFifoOutBuf.get(), // in
-         default_frame_size);
-      if (ret < 0)
-      {
-         AudacityMessageBox(
-            XO("FFmpeg : ERROR - Can't encode audio frame."),
-            XO("FFmpeg Error"),
-            wxOK|wxCENTER|wxICON_EXCLAMATION
-         );
+      if (!EncodeWholeFrame(mEncAudioFifoOutBuf.get()))
          return false;
-      }
-      if (ret == 0)
-         continue;
+   }
+   return true;
+}
 
-      // Rescale from the codec time_base to the AVStream time_base.
-      if (pkt.pts != int64_t(AV_NOPTS_VALUE))
-         pkt.pts = av_rescale_q(pkt.pts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
-      if (pkt.dts != int64_t(AV_NOPTS_VALUE))
-         pkt.dts = av_rescale_q(pkt.dts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
-      //wxLogDebug(wxT("FFmpeg : (%d) Writing audio frame with PTS: %lld."), mEncAudioCodecCtx->frame_number, (long long) pkt.pts);
+bool ExportFFmpeg::EncodeWholeFrame(int16_t *pFrame)
+{
+   AVPacketEx pkt;
 
-      pkt.stream_index = mEncAudioStream->index;
+   int ret= encode_audio(mEncAudioCodecCtx.get(),
+      &pkt,                          // out
+      pFrame,                        // in
+      default_frame_size);
+   if (ret < 0)
+   {
+      AudacityMessageBox(
+         XO("FFmpeg : ERROR - Can't encode audio frame."),
+         XO("FFmpeg Error"),
+         wxOK|wxCENTER|wxICON_EXCLAMATION
+      );
+      return false;
+   }
+   if (ret == 0)
+      return true;
 
-      // Write the encoded audio frame to the output file.
-      if ((ret = av_interleaved_write_frame(mEncFormatCtx.get(), &pkt)) < 0)
-      {
-         AudacityMessageBox(
-            XO("FFmpeg : ERROR - Failed to write audio frame to file."),
-            XO("FFmpeg Error"),
-            wxOK|wxCENTER|wxICON_EXCLAMATION
-         );
-         return false;
-      }
+   // Rescale from the codec time_base to the AVStream time_base.
+   if (pkt.pts != int64_t(AV_NOPTS_VALUE))
+      pkt.pts = av_rescale_q(pkt.pts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
+   if (pkt.dts != int64_t(AV_NOPTS_VALUE))
+      pkt.dts = av_rescale_q(pkt.dts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
+   //wxLogDebug(wxT("FFmpeg : (%d) Writing audio frame with PTS: %lld."), mEncAudioCodecCtx->frame_number, (long long) pkt.pts);
+
+   pkt.stream_index = mEncAudioStream->index;
+
+   // Write the encoded audio frame to the output file.
+   if ((ret = av_interleaved_write_frame(mEncFormatCtx.get(), &pkt)) < 0)
+   {
+      AudacityMessageBox(
+         XO("FFmpeg : ERROR - Failed to write audio frame to file."),
+         XO("FFmpeg Error"),
+         wxOK|wxCENTER|wxICON_EXCLAMATION
+      );
+      return false;
    }
    return true;
 }
@@ -1004,7 +1054,9 @@ ProgressResult ExportFFmpeg::Export(AudacityProject *project,
       return ProgressResult::Cancelled;
    }
 
-   size_t pcmBufferSize = 1024;
+   // Larger buffers let more whole frames be encoded from the mixer's
+   // buffer directly, with fewer calls to mix and to update the progress
+   size_t pcmBufferSize = 8192;
 
    auto mixer = CreateMixer(tracks, selectionOnly,
       t0, t1,
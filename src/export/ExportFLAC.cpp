@@ -23,6 +23,13 @@ and libvorbis examples, Monty <monty@xiph.org>
 #ifdef USE_LIBFLAC
 
 #include "Export.h"
+#include "ExportPipeline.h"
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <thread>
+#include <vector>
 
 #include <wx/progdlg.h>
 #include <wx/ffile.h>
@@ -133,6 +140,12 @@ void ExportFLACOptions::PopulateOrExchange(ShuttleGui & S)
          S.EndMultiColumn();
       }
       S.EndHorizontalLay();
+      S.StartHorizontalLay(wxCENTER);
+      {
+         S.TieCheckBox( XO("Encode on several processors"),
+            {wxT("/FileFormats/FLACParallel"), false});
+      }
+      S.EndHorizontalLay();
    }
    S.EndVerticalLay();
 
@@ -204,6 +217,366 @@ using FLAC__StreamMetadataHandle = std::unique_ptr<
    FLAC__StreamMetadata, FLAC__StreamMetadataDeleter
 >;
 
+// Apply the settings common to the whole file and to each segment of it
+template< typename Encoder >
+static bool ConfigureEncoder(Encoder &encoder, unsigned numChannels,
+   double rate, unsigned bitsPerSample, long levelPref)
+{
+   // Duplicate the flac command line compression levels
+   if (levelPref < 0 || levelPref > 8) {
+      levelPref = 5;
+   }
+
+   bool success =
+   encoder.set_channels(numChannels) &&
+   encoder.set_sample_rate(lrint(rate)) &&
+   encoder.set_bits_per_sample(bitsPerSample) &&
+   encoder.set_do_exhaustive_model_search(flacLevels[levelPref].do_exhaustive_model_search) &&
+   encoder.set_do_escape_coding(flacLevels[levelPref].do_escape_coding);
+
+   if (numChannels != 2) {
+      success = success &&
+      encoder.set_do_mid_side_stereo(false) &&
+      encoder.set_loose_mid_side_stereo(false);
+   }
+   else {
+      success = success &&
+      encoder.set_do_mid_side_stereo(flacLevels[levelPref].do_mid_side_stereo) &&
+      encoder.set_loose_mid_side_stereo(flacLevels[levelPref].loose_mid_side_stereo);
+   }
+
+   return success &&
+   encoder.set_qlp_coeff_precision(flacLevels[levelPref].qlp_coeff_precision) &&
+   encoder.set_min_residual_partition_order(flacLevels[levelPref].min_residual_partition_order) &&
+   encoder.set_max_residual_partition_order(flacLevels[levelPref].max_residual_partition_order) &&
+   encoder.set_rice_parameter_search_dist(flacLevels[levelPref].rice_parameter_search_dist) &&
+   encoder.set_max_lpc_order(flacLevels[levelPref].max_lpc_order);
+}
+
+#ifndef LEGACY_FLAC
+//----------------------------------------------------------------------------
+// Encoding on several processors
+//----------------------------------------------------------------------------
+
+// FLAC frames are independent of one another, but for their numbers.  So
+// segments of the audio, each a whole number of blocks, may be encoded by
+// separate encoders at once, each as a stream of its own, and their frames
+// renumbered and written one after another as a single stream.
+
+namespace {
+
+enum : size_t {
+   FLACBlockSize = 4096,
+   FLACBlocksPerSegment = 64,
+   FLACSegmentSize = FLACBlockSize * FLACBlocksPerSegment,
+};
+
+// The CRC-8 of frame headers and the CRC-16 of whole frames
+struct FLACCrcTables
+{
+   FLACCrcTables()
+   {
+      for (unsigned ii = 0; ii < 256; ++ii) {
+         unsigned crc8 = ii, crc16 = ii << 8;
+         for (int bit = 0; bit < 8; ++bit) {
+            crc8 = (crc8 << 1) ^ ((crc8 & 0x80) ? 0x07 : 0);
+            crc16 = (crc16 << 1) ^ ((crc16 & 0x8000) ? 0x8005 : 0);
+         }
+         crc8Table[ii] = crc8 & 0xFF;
+         crc16Table[ii] = crc16 & 0xFFFF;
+      }
+   }
+
+   FLAC__uint8 Crc8(const FLAC__byte *data, size_t len) const
+   {
+      FLAC__uint8 crc = 0;
+      while (len--)
+         crc = crc8Table[crc ^ *data++];
+      return crc;
+   }
+
+   FLAC__uint16 Crc16(const FLAC__byte *data, size_t len) const
+   {
+      unsigned crc = 0;
+      while (len--)
+         crc = ((crc << 8) & 0xFFFF) ^ crc16Table[(crc >> 8) ^ *data++];
+      return crc;
+   }
+
+   FLAC__uint8 crc8Table[256];
+   FLAC__uint16 crc16Table[256];
+};
+
+const FLACCrcTables &GetCrcTables()
+{
+   static const FLACCrcTables tables;
+   return tables;
+}
+
+/// Encodes one segment into memory, as a stream of its own
+class FLACSegmentEncoder final : public FLAC::Encoder::Stream
+{
+public:
+   struct Frame {
+      size_t offset, size;
+      unsigned samples;
+   };
+
+   std::vector<FLAC__byte> header; ///< The metadata, as the encoder wrote it
+   std::vector<FLAC__byte> data;   ///< The frames, end to end
+   std::vector<Frame> frames;
+
+protected:
+   ::FLAC__StreamEncoderWriteStatus write_callback(const FLAC__byte buffer[],
+      size_t bytes, unsigned samples, unsigned WXUNUSED(current_frame)) override
+   {
+      try {
+         // libFLAC writes each frame with one call, and metadata with no
+         // samples
+         if (samples == 0)
+            header.insert(header.end(), buffer, buffer + bytes);
+         else {
+            frames.push_back({ data.size(), bytes, samples });
+            data.insert(data.end(), buffer, buffer + bytes);
+         }
+      }
+      catch( ... ) {
+         return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+      }
+      return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+   }
+};
+
+struct FLACSegment
+{
+   explicit FLACSegment(unsigned numChannels)
+      : samples{ numChannels, FLACSegmentSize, true }
+   {}
+
+   ArraysOf<FLAC__int32> samples;
+   size_t len{ 0 };
+   FLACSegmentEncoder encoder;
+};
+
+/// Encode a segment; metadata is given only for the first one
+bool EncodeSegment(FLACSegment &segment, unsigned numChannels,
+   double rate, unsigned bitsPerSample, long levelPref,
+   FLAC__StreamMetadata **metadata, unsigned numMetadata)
+{
+   auto &encoder = segment.encoder;
+   if (!(ConfigureEncoder(encoder, numChannels, rate, bitsPerSample, levelPref) &&
+         encoder.set_blocksize(FLACBlockSize) &&
+         (numMetadata == 0 || encoder.set_metadata(metadata, numMetadata))))
+      return false;
+
+   if (encoder.init() != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+      return false;
+
+   const bool processed = segment.len == 0 || encoder.process(
+      reinterpret_cast<FLAC__int32**>( segment.samples.get() ),
+      segment.len );
+   return encoder.finish() && processed;
+}
+
+/// Writes the frames of encoded segments, in order, as one stream, and
+/// completes its STREAMINFO and SEEKTABLE
+class FLACSegmentWriter
+{
+public:
+   /// Seek points are made for each multiple of seekInterval samples
+   FLACSegmentWriter(wxFFile &file, FLAC__uint64 seekInterval)
+      : mFile{ file }
+      , mSeekInterval{ seekInterval }
+   {}
+
+   bool Write(const FLACSegmentEncoder &encoder)
+   {
+      const bool first = mHeader.empty();
+      if (first && !(ReadHeader(encoder.header) && WriteBytes(mHeader)))
+         return false;
+
+      for (const auto &frame : encoder.frames) {
+         if (first)
+            // Numbered as it should be already
+            mFrame.assign(
+               encoder.data.begin() + frame.offset,
+               encoder.data.begin() + frame.offset + frame.size);
+         else if (!Renumber(&encoder.data[frame.offset], frame.size))
+            return false;
+
+         NoteSeekPoint(frame.samples);
+         if (!WriteBytes(mFrame))
+            return false;
+
+         const auto size = static_cast<unsigned>(mFrame.size());
+         mMinFrameSize = std::min(mMinFrameSize, size);
+         mMaxFrameSize = std::max(mMaxFrameSize, size);
+         ++mNumFrames;
+         mSamples += frame.samples;
+         mBytes += size;
+      }
+      return true;
+   }
+
+   /// Rewrite the metadata with what is known now
+   bool Finish()
+   {
+      if (mHeader.empty())
+         return false;
+
+      const auto info = &mHeader[mStreamInfo];
+      if (mNumFrames == 0)
+         mMinFrameSize = mMaxFrameSize = 0;
+      PutBigEndian(info + 4, mMinFrameSize, 3);
+      PutBigEndian(info + 7, mMaxFrameSize, 3);
+      // Total samples are 36 bits, the last of them in the lower half of
+      // byte 13; zero means unknown
+      const auto total =
+         mSamples < (FLAC__uint64{ 1 } << 36) ? mSamples : 0;
+      info[13] = (info[13] & 0xF0) | ((total >> 32) & 0x0F);
+      PutBigEndian(info + 14, total, 4);
+      // The signature of the whole stream can't be made from those of the
+      // segments; zero means there is none
+      std::fill(info + 18, info + 34, 0);
+
+      return mFile.Seek(0) && WriteBytes(mHeader) && mFile.Flush();
+   }
+
+private:
+   bool ReadHeader(const std::vector<FLAC__byte> &header)
+   {
+      mHeader = header;
+      // Find the STREAMINFO and SEEKTABLE blocks, after "fLaC"
+      size_t pos = 4;
+      bool last = false;
+      while (!last && pos + 4 <= mHeader.size()) {
+         last = (mHeader[pos] & 0x80) != 0;
+         const auto type = mHeader[pos] & 0x7F;
+         const size_t length =
+            (mHeader[pos + 1] << 16) | (mHeader[pos + 2] << 8) | mHeader[pos + 3];
+         pos += 4;
+         if (type == FLAC__METADATA_TYPE_STREAMINFO &&
+             length == FLAC__STREAM_METADATA_STREAMINFO_LENGTH)
+            mStreamInfo = pos;
+         else if (type == FLAC__METADATA_TYPE_SEEKTABLE) {
+            mSeekTable = pos;
+            mNumSeekPoints = length / FLAC__STREAM_METADATA_SEEKPOINT_LENGTH;
+         }
+         pos += length;
+      }
+      return last && pos == mHeader.size() && mStreamInfo > 0;
+   }
+
+   // Copy a frame of another segment, with the next frame number and
+   // recomputed CRCs
+   bool Renumber(const FLAC__byte *frame, size_t size)
+   {
+      // The frame number follows four bytes of sync code and parameters, and
+      // is coded like UTF-8
+      if (size < 8)
+         return false;
+      size_t numberLength = 1;
+      if (frame[4] & 0x80) {
+         while (numberLength < 7 && (frame[4] & (0x80 >> numberLength)))
+            ++numberLength;
+         if (numberLength < 2 || numberLength > 6)
+            return false;
+      }
+
+      // Blocksize and sample rate codes that mean more bytes follow
+      size_t more = 0;
+      const auto blocksizeCode = frame[2] >> 4, rateCode = frame[2] & 0x0F;
+      if (blocksizeCode == 6)
+         more += 1;
+      else if (blocksizeCode == 7)
+         more += 2;
+      if (rateCode == 12)
+         more += 1;
+      else if (rateCode == 13 || rateCode == 14)
+         more += 2;
+
+      const auto crc8Pos = 4 + numberLength + more;
+      if (crc8Pos + 3 > size)
+         return false;
+
+      mFrame.assign(frame, frame + 4);
+      const auto number = mNumFrames;
+      if (number < 0x80)
+         mFrame.push_back(number);
+      else {
+         unsigned continuations = 1;
+         while (continuations < 5 && (number >> (6 * continuations)) >=
+                (0x40u >> continuations))
+            ++continuations;
+         mFrame.push_back(((0xFF00u >> (continuations + 1)) & 0xFF) |
+            (number >> (6 * continuations)));
+         while (continuations--)
+            mFrame.push_back(0x80 | ((number >> (6 * continuations)) & 0x3F));
+      }
+      mFrame.insert(mFrame.end(),
+         frame + 4 + numberLength, frame + crc8Pos);
+
+      const auto &tables = GetCrcTables();
+      mFrame.push_back(tables.Crc8(mFrame.data(), mFrame.size()));
+      mFrame.insert(mFrame.end(), frame + crc8Pos + 1, frame + size - 2);
+      const auto crc16 = tables.Crc16(mFrame.data(), mFrame.size());
+      mFrame.push_back(crc16 >> 8);
+      mFrame.push_back(crc16 & 0xFF);
+      return true;
+   }
+
+   // Point to the next frame if it holds the next multiple of the interval
+   void NoteSeekPoint(unsigned samples)
+   {
+      bool noted = false;
+      while (mNextSeekSample < mSamples + samples) {
+         // Points must differ, so one frame gets only one
+         if (!noted && mSeekPointsUsed < mNumSeekPoints) {
+            const auto point = &mHeader[mSeekTable +
+               mSeekPointsUsed++ * FLAC__STREAM_METADATA_SEEKPOINT_LENGTH];
+            PutBigEndian(point, mSamples, 8);
+            PutBigEndian(point + 8, mBytes, 8);
+            PutBigEndian(point + 16, samples, 2);
+            noted = true;
+         }
+         mNextSeekSample += mSeekInterval;
+      }
+   }
+
+   bool WriteBytes(const std::vector<FLAC__byte> &bytes)
+   {
+      return mFile.Write(bytes.data(), bytes.size()) == bytes.size();
+   }
+
+   static void PutBigEndian(FLAC__byte *dest, FLAC__uint64 value, int nBytes)
+   {
+      while (nBytes--) {
+         dest[nBytes] = value & 0xFF;
+         value >>= 8;
+      }
+   }
+
+   wxFFile &mFile;
+   const FLAC__uint64 mSeekInterval;
+
+   std::vector<FLAC__byte> mHeader;
+   size_t mStreamInfo{ 0 };
+   size_t mSeekTable{ 0 };
+   size_t mNumSeekPoints{ 0 };
+   size_t mSeekPointsUsed{ 0 };
+   FLAC__uint64 mNextSeekSample{ 0 };
+
+   std::vector<FLAC__byte> mFrame;
+   FLAC__uint32 mNumFrames{ 0 };
+   FLAC__uint64 mSamples{ 0 };
+   FLAC__uint64 mBytes{ 0 };
+   unsigned mMinFrameSize{ ~0u };
+   unsigned mMaxFrameSize{ 0 };
+};
+
+}
+#endif
+
 class ExportFLAC final : public ExportPlugin
 {
 public:
@@ -224,10 +597,28 @@ public:
                const Tags *metadata = NULL,
                int subformat = 0) override;
 
+   bool CanExportConcurrently(int subformat) override;
+
 private:
 
    bool GetMetadata(AudacityProject *project, const Tags *tags);
 
+#ifndef LEGACY_FLAC
+   // Like Export(), encoding segments on several threads at once
+   ProgressResult ExportInParallel(std::unique_ptr<ProgressDialog> &pDialog,
+               const TrackList &tracks,
+               unsigned numChannels,
+               const wxFileNameWrapper &fName,
+               bool selectionOnly,
+               double t0,
+               double t1,
+               MixerSpec *mixerSpec,
+               double rate,
+               sampleFormat format,
+               unsigned bitsPerSample,
+               long levelPref);
+#endif
+
    // Should this be a stack variable instead in Export?
    FLAC__StreamMetadataHandle mMetadata;
 };
@@ -268,70 +659,52 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
 
    auto bitDepthPref = FLACBitDepth.Read();
 
-   FLAC::Encoder::File encoder;
-
-   bool success = true;
-   success = success &&
-#ifdef LEGACY_FLAC
-   encoder.set_filename(OSOUTPUT(fName)) &&
-#endif
-   encoder.set_channels(numChannels) &&
-   encoder.set_sample_rate(lrint(rate));
+   sampleFormat format;
+   unsigned bitsPerSample;
+   if (bitDepthPref == wxT("24")) {
+      format = int24Sample;
+      bitsPerSample = 24;
+   } else { //convert float to 16 bits
+      format = int16Sample;
+      bitsPerSample = 16;
+   }
 
    // See note in GetMetadata() about a bug in libflac++ 1.1.2
-   if (success && !GetMetadata(project, metadata)) {
+   if (!GetMetadata(project, metadata)) {
       // TODO: more precise message
       AudacityMessageBox( XO("Unable to export") );
       return ProgressResult::Cancelled;
    }
 
-   if (success && mMetadata) {
-      // set_metadata expects an array of pointers to metadata and a size.
-      // The size is 1.
-      FLAC__StreamMetadata *p = mMetadata.get();
-      success = encoder.set_metadata(&p, 1);
-   }
-
    auto cleanup1 = finally( [&] {
       mMetadata.reset(); // need this?
    } );
 
-   sampleFormat format;
-   if (bitDepthPref == wxT("24")) {
-      format = int24Sample;
-      success = success && encoder.set_bits_per_sample(24);
-   } else { //convert float to 16 bits
-      format = int16Sample;
-      success = success && encoder.set_bits_per_sample(16);
-   }
+#ifndef LEGACY_FLAC
+   // Not when other exports already keep the processors busy
+   if (gPrefs->Read(wxT("/FileFormats/FLACParallel"), false) &&
+       !ConcurrentExport::Current())
+      return ExportInParallel(pDialog, tracks, numChannels, fName,
+         selectionOnly, t0, t1, mixerSpec,
+         rate, format, bitsPerSample, levelPref);
+#endif
 
+   FLAC::Encoder::File encoder;
 
-   // Duplicate the flac command line compression levels
-   if (levelPref < 0 || levelPref > 8) {
-      levelPref = 5;
-   }
+   bool success = true;
    success = success &&
-   encoder.set_do_exhaustive_model_search(flacLevels[levelPref].do_exhaustive_model_search) &&
-   encoder.set_do_escape_coding(flacLevels[levelPref].do_escape_coding);
+#ifdef LEGACY_FLAC
+   encoder.set_filename(OSOUTPUT(fName)) &&
+#endif
+   ConfigureEncoder(encoder, numChannels, rate, bitsPerSample, levelPref);
 
-   if (numChannels != 2) {
-      success = success &&
-      encoder.set_do_mid_side_stereo(false) &&
-      encoder.set_loose_mid_side_stereo(false);
-   }
-   else {
-      success = success &&
-      encoder.set_do_mid_side_stereo(flacLevels[levelPref].do_mid_side_stereo) &&
-      encoder.set_loose_mid_side_stereo(flacLevels[levelPref].loose_mid_side_stereo);
+   if (success && mMetadata) {
+      // set_metadata expects an array of pointers to metadata and a size.
+      // The size is 1.
+      FLAC__StreamMetadata *p = mMetadata.get();
+      success = encoder.set_metadata(&p, 1);
    }
 
-   success = success &&
-   encoder.set_qlp_coeff_precision(flacLevels[levelPref].qlp_coeff_precision) &&
-   encoder.set_min_residual_partition_order(flacLevels[levelPref].min_residual_partition_order) &&
-   encoder.set_max_residual_partition_order(flacLevels[levelPref].max_residual_partition_order) &&
-   encoder.set_rice_parameter_search_dist(flacLevels[levelPref].rice_parameter_search_dist) &&
-   encoder.set_max_lpc_order(flacLevels[levelPref].max_lpc_order);
-
    if (!success) {
       // TODO: more precise message
       AudacityMessageBox( XO("Unable to export") );
@@ -372,10 +745,11 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
       }
    } );
 
-   auto mixer = CreateMixer(tracks, selectionOnly,
+   ExportPipeline mixer{ CreateMixer(tracks, selectionOnly,
                             t0, t1,
                             numChannels, SAMPLES_PER_RUN, false,
-                            rate, format, true, mixerSpec);
+                            rate, format, true, mixerSpec),
+                         SAMPLES_PER_RUN };
 
    ArraysOf<FLAC__int32> tmpsmplbuf{ numChannels, SAMPLES_PER_RUN, true };
 
@@ -383,16 +757,15 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
       selectionOnly
          ? XO("Exporting the selected audio as FLAC")
          : XO("Exporting the audio as FLAC") );
-   auto &progress = *pDialog;
 
    while (updateResult == ProgressResult::Success) {
-      auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
+      auto samplesThisRun = mixer.Process();
       if (samplesThisRun == 0) { //stop encoding
          break;
       }
       else {
          for (size_t i = 0; i < numChannels; i++) {
-            samplePtr mixed = mixer->GetBuffer(i);
+            samplePtr mixed = mixer.GetBuffer(i);
             if (format == int24Sample) {
                for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
                   tmpsmplbuf[i][j] = ((int *)mixed)[j];
@@ -413,8 +786,8 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
             break;
          }
          if (updateResult == ProgressResult::Success)
-            updateResult =
-               progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+            updateResult = UpdateProgress(
+               pDialog, mixer.MixGetCurrentTime() - t0, t1 - t0);
       }
    }
 
@@ -435,6 +808,157 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    return updateResult;
 }
 
+#ifndef LEGACY_FLAC
+ProgressResult ExportFLAC::ExportInParallel(
+   std::unique_ptr<ProgressDialog> &pDialog,
+   const TrackList &tracks,
+   unsigned numChannels,
+   const wxFileNameWrapper &fName,
+   bool selectionOnly,
+   double t0,
+   double t1,
+   MixerSpec *mixerSpec,
+   double rate,
+   sampleFormat format,
+   unsigned bitsPerSample,
+   long levelPref)
+{
+   auto updateResult = ProgressResult::Success;
+
+   // A seek point each ten seconds, as the flac program makes; places are
+   // kept for as many as the expected length needs
+   const auto seekInterval = std::max<FLAC__uint64>( 1, lrint( rate * 10 ) );
+   const auto expectedSamples =
+      static_cast<FLAC__uint64>( std::max( 0.0, (t1 - t0) * rate ) );
+   FLAC__StreamMetadataHandle seekTable{
+      ::FLAC__metadata_object_new(FLAC__METADATA_TYPE_SEEKTABLE) };
+   if (!seekTable ||
+       !::FLAC__metadata_object_seektable_template_append_placeholders(
+          seekTable.get(), expectedSamples / seekInterval + 1 )) {
+      // TODO: more precise message
+      AudacityMessageBox( XO("Unable to export") );
+      return ProgressResult::Cancelled;
+   }
+
+   wxFFile f;     // will be closed when it goes out of scope
+   const auto path = fName.GetFullPath();
+   if (!f.Open(path, wxT("w+b"))) {
+      AudacityMessageBox( XO("FLAC export couldn't open %s").Format( path ) );
+      return ProgressResult::Cancelled;
+   }
+
+   ExportPipeline mixer{ CreateMixer(tracks, selectionOnly,
+                            t0, t1,
+                            numChannels, SAMPLES_PER_RUN, false,
+                            rate, format, true, mixerSpec),
+                         SAMPLES_PER_RUN };
+
+   InitProgress( pDialog, fName,
+      selectionOnly
+         ? XO("Exporting the selected audio as FLAC")
+         : XO("Exporting the audio as FLAC") );
+
+   // Segments being encoded, oldest first; the future destroyed first waits
+   // for its thread to be done with the segment
+   struct Pending {
+      std::unique_ptr<FLACSegment> pSegment;
+      std::future<bool> encoded;
+   };
+   std::deque<Pending> pending;
+   const size_t maxPending =
+      std::max( 1u, std::thread::hardware_concurrency() );
+   FLACSegmentWriter writer{ f, seekInterval };
+
+   auto writeOldest = [&]{
+      auto &oldest = pending.front();
+      const bool ok =
+         oldest.encoded.get() && writer.Write(oldest.pSegment->encoder);
+      pending.pop_front();
+      return ok;
+   };
+
+   auto segment = std::make_unique<FLACSegment>(numChannels);
+   bool first = true;
+   auto submit = [&]{
+      while (pending.size() >= maxPending)
+         if (!writeOldest())
+            return false;
+
+      const auto pToEncode = segment.get();
+      const bool withMetadata = first;
+      pending.push_back({ std::move(segment), std::async(std::launch::async,
+         [this, &seekTable, pToEncode, withMetadata,
+          numChannels, rate, bitsPerSample, levelPref]{
+            FLAC__StreamMetadata *metadata[] =
+               { seekTable.get(), mMetadata.get() };
+            return EncodeSegment(*pToEncode, numChannels,
+               rate, bitsPerSample, levelPref,
+               metadata, !withMetadata ? 0 : mMetadata ? 2 : 1);
+         }) });
+      segment = std::make_unique<FLACSegment>(numChannels);
+      first = false;
+      return true;
+   };
+
+   bool ok = true;
+   while (ok && updateResult == ProgressResult::Success) {
+      auto samplesThisRun = mixer.Process();
+      if (samplesThisRun == 0) { //stop encoding
+         break;
+      }
+      for (size_t done = 0; ok && done < samplesThisRun;) {
+         const auto count = std::min(samplesThisRun - done,
+            FLACSegmentSize - segment->len);
+         for (size_t i = 0; i < numChannels; i++) {
+            samplePtr mixed = mixer.GetBuffer(i);
+            const auto dest = segment->samples[i].get() + segment->len;
+            if (format == int24Sample) {
+               for (size_t j = 0; j < count; j++) {
+                  dest[j] = ((int *)mixed)[done + j];
+               }
+            }
+            else {
+               for (size_t j = 0; j < count; j++) {
+                  dest[j] = ((short *)mixed)[done + j];
+               }
+            }
+         }
+         segment->len += count;
+         done += count;
+         if (segment->len == FLACSegmentSize)
+            ok = submit();
+      }
+      if (ok)
+         updateResult = UpdateProgress(
+            pDialog, mixer.MixGetCurrentTime() - t0, t1 - t0);
+   }
+
+   if (ok && (updateResult == ProgressResult::Success ||
+              updateResult == ProgressResult::Stopped)) {
+      // The first segment makes the metadata, so is needed even if empty
+      if (segment->len > 0 || first)
+         ok = submit();
+      while (ok && !pending.empty())
+         ok = writeOldest();
+      ok = ok && writer.Finish();
+   }
+
+   if (!ok) {
+      // TODO: more precise message
+      AudacityMessageBox( XO("Unable to export") );
+      return ProgressResult::Cancelled;
+   }
+
+   return updateResult;
+}
+#endif
+
+bool ExportFLAC::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   // libFLAC encoders are independent; mMetadata is used only in setup
+   return true;
+}
+
 void ExportFLAC::OptionsCreate(ShuttleGui &S, int format)
 {
    S.AddWindow( safenew ExportFLACOptions{ S.GetParent(), format } );
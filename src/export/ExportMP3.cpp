@@ -95,6 +95,7 @@
 #include "../wxFileNameWrapper.h"
 
 #include "Export.h"
+#include "ExportPipeline.h"
 
 #include <lame/lame.h>
 
@@ -1909,10 +1910,11 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
    wxASSERT(buffer);
 
    {
-      auto mixer = CreateMixer(tracks, selectionOnly,
+      ExportPipeline mixer{ CreateMixer(tracks, selectionOnly,
          t0, t1,
          channels, inSamples, true,
-         rate, int16Sample, true, mixerSpec);
+         rate, int16Sample, true, mixerSpec),
+         (size_t) inSamples };
 
       TranslatableString title;
       if (rmode == MODE_SET) {
@@ -1938,13 +1940,13 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
       auto &progress = *pDialog;
 
       while (updateResult == ProgressResult::Success) {
-         auto blockLen = mixer->Process(inSamples);
+         auto blockLen = mixer.Process();
 
          if (blockLen == 0) {
             break;
          }
 
-         short *mixed = (short *)mixer->GetBuffer();
+         short *mixed = (short *)mixer.GetBuffer();
 
          if ((int)blockLen < inSamples) {
             if (channels > 1) {
@@ -1978,7 +1980,7 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
             break;
          }
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+         updateResult = progress.Update(mixer.MixGetCurrentTime() - t0, t1 - t0);
       }
    }
 
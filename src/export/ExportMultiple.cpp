@@ -18,7 +18,12 @@
 #include "../Audacity.h"
 #include "ExportMultiple.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include <wx/defs.h>
+#include <wx/app.h>
 #include <wx/button.h>
 #include <wx/checkbox.h>
 #include <wx/choice.h>
@@ -37,6 +42,7 @@
 #include <wx/stattext.h>
 #include <wx/textctrl.h>
 #include <wx/textdlg.h>
+#include <wx/utils.h>
 
 #include "../DirManager.h"
 #include "../FileFormats.h"
@@ -56,7 +62,6 @@
 #include "../widgets/ProgressDialog.h"
 
 
-namespace {
 /** \brief A private class used to store the information needed to do an
     * export.
     *
@@ -70,13 +75,14 @@ namespace {
       double t0;           /**< Start time for the export */
       double t1;           /**< End time for the export */
       unsigned channels;   /**< Number of channels for ExportMultipleByTrack */
+      WaveTrackConstArray tracks; /**< Channels to mix for a concurrent
+                                    ExportMultipleByTrack, else empty */
    };  // end of ExportKit declaration
    /* we are going to want an set of these kits, and don't know how many until
     * runtime. I would dearly like to use a std::vector, but it seems that
     * this isn't done anywhere else in Audacity, presumably for a reason?, so
     * I'm stuck with wxArrays, which are much harder, as well as non-standard.
     */
-}
 
 /* define our dynamic array of export settings */
 
@@ -94,7 +100,8 @@ enum {
    ByNameID,
    ByNumberID,
    PrefixID,
-   OverwriteID
+   OverwriteID,
+   ConcurrentID
 };
 
 //
@@ -419,6 +426,10 @@ void ExportMultipleDialog::PopulateOrExchange(ShuttleGui& S)
       mOverwrite = S.Id(OverwriteID).TieCheckBox(XO("Overwrite existing files"),
                                                  {wxT("/Export/OverwriteExisting"),
                                                   false});
+      mConcurrent = S.Id(ConcurrentID)
+         .TieCheckBox(XO("Export several files at once"),
+                      {wxT("/Export/MultipleInParallel"),
+                       false});
    }
    S.EndHorizontalLay();
 
@@ -853,6 +864,9 @@ ProgressResult ExportMultipleDialog::ExportMultipleByLabel(bool byName,
       l++;  // next label, count up one
    }
 
+   if (ExportConcurrently())
+      return DoConcurrentExports(exportSettings);
+
    auto ok = ProgressResult::Success;   // did it work?
    int count = 0; // count the number of sucessful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
@@ -905,10 +919,13 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
    wxString name;    // used to hold file name whilst we mess with it
    wxString title;   // un-messed-with title of file for tagging with
 
+   const bool concurrent = ExportConcurrently();
+
    /* Remember which tracks were selected, and set them to unselected */
    SelectionStateChanger changer{ mSelectionState, *mTracks };
-   for (auto tr : mTracks->Selected<WaveTrack>())
-      tr->SetSelected(false);
+   if (!concurrent)
+      for (auto tr : mTracks->Selected<WaveTrack>())
+         tr->SetSelected(false);
 
    bool anySolo = !(( mTracks->Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
 
@@ -928,6 +945,13 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
                   tr->GetPan() == 0.0))
          setting.channels = 2;
 
+      // Concurrent exports mix these, instead of selecting them
+      setting.tracks.clear();
+      if (concurrent)
+         for (auto channel : channels)
+            setting.tracks.push_back(
+               channel->SharedPointer< const WaveTrack >() );
+
       // Get name and title
       title = tr->GetName();
       if( title.empty() )
@@ -994,6 +1018,9 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
    }
    // end of user-interactive data gathering loop, start of export processing
    // loop
+   if (concurrent)
+      return DoConcurrentExports(exportSettings);
+
    int count = 0; // count the number of sucessful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
    std::unique_ptr<ProgressDialog> pDialog;
@@ -1049,8 +1076,6 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
                               double t1,
                               const Tags &tags)
 {
-   wxFileName name;
-
    wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (inName.GetFullName()));
    wxLogDebug(wxT("Channels: %i, Start: %lf, End: %lf "), channels, t0, t1);
    if (selectedOnly)
@@ -1059,10 +1084,41 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
       wxLogDebug(wxT("Whole Project"));
 
    wxFileName backup;
+   wxString fullPath;
+   if (!PrepareExport(inName, backup, fullPath))
+      return ProgressResult::Cancelled;
+
+   ProgressResult success = ProgressResult::Cancelled;
+   auto cleanup = finally( [&] {
+      FinishExport(success, backup, fullPath);
+   } );
+
+   // Call the format export routine
+   success = mPlugins[mPluginIndex]->Export(mProject,
+                                            pDialog,
+                                                channels,
+                                                fullPath,
+                                                selectedOnly,
+                                                t0,
+                                                t1,
+                                                NULL,
+                                                &tags,
+                                                mSubFormatIndex);
+
+   return success;
+}
+
+bool ExportMultipleDialog::PrepareExport(const wxFileName &inName,
+                                         wxFileName &backup,
+                                         wxString &fullPath)
+{
+   wxFileName name;
+
+   backup.Clear();
    if (mOverwrite->GetValue()) {
       // Make sure we don't overwrite (corrupt) alias files
       if (!DirManager::Get( *mProject ).EnsureSafeFilename(inName)) {
-         return ProgressResult::Cancelled;
+         return false;
       }
       name = inName;
       backup.Assign(name);
@@ -1085,50 +1141,208 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
       }
    }
 
-   ProgressResult success = ProgressResult::Cancelled;
-   const wxString fullPath{name.GetFullPath()};
+   fullPath = name.GetFullPath();
+   return true;
+}
 
-   auto cleanup = finally( [&] {
-      bool ok =
-         success == ProgressResult::Stopped ||
-         success == ProgressResult::Success;
-      if (backup.IsOk()) {
-         if ( ok )
-            // Remove backup
-            ::wxRemoveFile(backup.GetFullPath());
-         else {
-            // Restore original
-            ::wxRemoveFile(fullPath);
-            ::wxRenameFile(backup.GetFullPath(), fullPath);
-         }
-      }
+void ExportMultipleDialog::FinishExport(ProgressResult success,
+                                        const wxFileName &backup,
+                                        const wxString &fullPath)
+{
+   bool ok =
+      success == ProgressResult::Stopped ||
+      success == ProgressResult::Success;
+   if (backup.IsOk()) {
+      if ( ok )
+         // Remove backup
+         ::wxRemoveFile(backup.GetFullPath());
       else {
-         if ( ! ok )
-            // Remove any new, and only partially written, file.
-            ::wxRemoveFile(fullPath);
+         // Restore original
+         ::wxRemoveFile(fullPath);
+         ::wxRenameFile(backup.GetFullPath(), fullPath);
       }
-   } );
-
-   // Call the format export routine
-   success = mPlugins[mPluginIndex]->Export(mProject,
-                                            pDialog,
-                                                channels,
-                                                fullPath,
-                                                selectedOnly,
-                                                t0,
-                                                t1,
-                                                NULL,
-                                                &tags,
-                                                mSubFormatIndex);
+   }
+   else {
+      if ( ! ok )
+         // Remove any new, and only partially written, file.
+         ::wxRemoveFile(fullPath);
+   }
 
-   if (success == ProgressResult::Success || success == ProgressResult::Stopped) {
+   if (ok)
       mExported.push_back(fullPath);
-   }
 
    Refresh();
    Update();
+}
 
-   return success;
+bool ExportMultipleDialog::ExportConcurrently() const
+{
+   return mConcurrent->GetValue() &&
+      mPlugins[mPluginIndex]->CanExportConcurrently(mSubFormatIndex);
+}
+
+ProgressResult ExportMultipleDialog::DoConcurrentExports(
+   const std::vector<ExportKit> &exportSettings)
+{
+   // One of these for each file being exported
+   struct Job {
+      Job( AudacityProject &project, std::mutex &setupMutex,
+           const ExportKit &kit )
+         : exporter{ project }
+         , concurrentExport{ setupMutex, kit.tracks }
+         , setting{ kit }
+      {}
+
+      // Own plug-in objects, so that no two exports share one
+      Exporter exporter;
+      ConcurrentExport concurrentExport;
+      const ExportKit &setting;
+      wxFileName backup;
+      wxString fullPath;
+      std::thread thread;
+      std::atomic<bool> done{ false };
+      ProgressResult result{ ProgressResult::Cancelled };
+      std::exception_ptr exception;
+   };
+
+   std::mutex setupMutex;
+   std::vector<std::unique_ptr<Job>> running;
+   std::exception_ptr exception;
+   size_t nDone = 0;
+
+   std::vector<const ExportKit*> todo;
+   for (const auto &setting : exportSettings) {
+      // Bug 1440 fix.
+      if( !setting.destfile.GetName().empty() )
+         todo.push_back(&setting);
+   }
+   const size_t nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+   ProgressDialog progress{ XO("Export Multiple"),
+      XO("Exporting %lld files").Format( (long long) todo.size() ) };
+
+   // Collect the finished jobs on this thread, which alone may touch files
+   // and the dialog; returns the first result that was not success
+   auto reap = [&]( bool all ) {
+      auto result = ProgressResult::Success;
+      for (auto iter = running.begin(); iter != running.end();) {
+         auto &job = **iter;
+         if (!all && !job.done.load()) {
+            ++iter;
+            continue;
+         }
+         // Message boxes from workers run here, so keep handling them while
+         // waiting
+         while (!job.done.load()) {
+            wxTheApp->ProcessPendingEvents();
+            wxMilliSleep(10);
+         }
+         job.thread.join();
+         FinishExport(job.result, job.backup, job.fullPath);
+         if (job.exception && !exception)
+            exception = job.exception;
+         if (result == ProgressResult::Success)
+            result = job.result;
+         ++nDone;
+         iter = running.erase(iter);
+      }
+      return result;
+   };
+
+   // Whatever happens, wait for the threads before the jobs are destroyed
+   auto cleanup = finally( [&] {
+      for (auto &pJob : running)
+         pJob->concurrentExport.Request(ProgressResult::Cancelled);
+      GuardedCall( [&]{ reap( true ); } );
+   } );
+
+   auto ok = ProgressResult::Success;
+   auto next = todo.begin();
+   while (next != todo.end() || !running.empty()) {
+      // Keep the processors busy
+      while (next != todo.end() && running.size() < nThreads) {
+         auto pJob = std::make_unique<Job>( *mProject, setupMutex, **next++ );
+         auto &job = *pJob;
+         if (!PrepareExport(job.setting.destfile, job.backup, job.fullPath)) {
+            ok = ProgressResult::Cancelled;
+            break;
+         }
+         auto plugin = job.exporter.GetPlugins()[mPluginIndex].get();
+         job.thread = std::thread( [this, &job, plugin] {
+            try {
+               ConcurrentExport::Scope scope{ job.concurrentExport };
+               std::unique_ptr<ProgressDialog> pDialog;
+               job.result = plugin->Export(mProject, pDialog,
+                  job.setting.channels, job.fullPath,
+                  false, job.setting.t0, job.setting.t1,
+                  NULL, &job.setting.filetags, mSubFormatIndex);
+            }
+            catch( ... ) {
+               job.result = ProgressResult::Failed;
+               job.exception = std::current_exception();
+            }
+            job.done.store( true );
+         } );
+         running.push_back( std::move( pJob ) );
+      }
+      if (ok != ProgressResult::Success)
+         break;
+
+      const auto result = reap( false );
+      if (result != ProgressResult::Success &&
+          result != ProgressResult::Stopped) {
+         ok = result;
+         break;
+      }
+      if (running.empty() && next == todo.end())
+         break;
+
+      double fraction = nDone;
+      for (const auto &pJob : running)
+         fraction += pJob->concurrentExport.GetFraction();
+      auto request = progress.Update( fraction, (double) todo.size() );
+
+      if (request == ProgressResult::Stopped) {
+         // Let the files in progress end where they are, then ask as
+         // DoExport() would
+         for (auto &pJob : running)
+            pJob->concurrentExport.Request(ProgressResult::Stopped);
+         reap( true );
+         ok = ProgressResult::Stopped;
+         if (next == todo.end())
+            break;
+         AudacityMessageDialog dlgMessage(
+            nullptr,
+            XO("Continue to export remaining files?"),
+            XO("Export"),
+            wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
+         if (dlgMessage.ShowModal() != wxID_YES ) {
+            // User decided not to continue - bail out!
+            break;
+         }
+         ok = ProgressResult::Success;
+         progress.Reinit();
+      }
+      else if (request != ProgressResult::Success) {
+         ok = request;
+         break;
+      }
+      else {
+         // Show any messages from the workers
+         wxTheApp->ProcessPendingEvents();
+         wxMilliSleep(10);
+      }
+   }
+
+   // After a cancel or failure, abandon the files still in progress
+   for (auto &pJob : running)
+      pJob->concurrentExport.Request(ProgressResult::Cancelled);
+   reap( true );
+
+   if (exception)
+      std::rethrow_exception(exception);
+
+   return ok;
 }
 
 wxString ExportMultipleDialog::MakeFileName(const wxString &input)
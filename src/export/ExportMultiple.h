@@ -24,6 +24,7 @@ class wxStaticText;
 class wxTextCtrl;
 
 class AudacityProject;
+class ExportKit;
 class LabelTrack;
 class SelectionState;
 class ShuttleGui;
@@ -79,6 +80,24 @@ private:
                  double t0,
                  double t1,
                  const Tags &tags);
+   /** \brief Export a set of files on several threads at once, with one
+    * progress dialog for all of them
+    *
+    * Used instead of repeated DoExport() calls when the user asks for it and
+    * the selected plug-in CanExportConcurrently().  Each file is mixed from
+    * the tracks of its ExportKit, or from all unmuted tracks if none. */
+   ProgressResult DoConcurrentExports(const std::vector<ExportKit> &exportSettings);
+   /** \brief Choose the file name actually written for one export, making a
+    * backup of any file that will be overwritten
+    *
+    * @return false if the export must not be done */
+   bool PrepareExport(const wxFileName &inName,
+                      wxFileName &backup, wxString &fullPath);
+   /** \brief Clean up after one export done to a file chosen by
+    * PrepareExport(), and record it if it succeeded */
+   void FinishExport(ProgressResult success,
+                     const wxFileName &backup, const wxString &fullPath);
+   bool ExportConcurrently() const;
    /** \brief Takes an arbitrary text string and converts it to a form that can
     * be used as a file name, if necessary prompting the user to edit the file
     * name produced */
@@ -154,6 +173,7 @@ private:
    wxTextCtrl    *mPrefix;
 
    wxCheckBox    *mOverwrite;
+   wxCheckBox    *mConcurrent; /**< Check box to export several files at once */
 
    wxButton      *mCancel;
    wxButton      *mExport;
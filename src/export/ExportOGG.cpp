@@ -20,6 +20,7 @@
 #ifdef USE_LIBVORBIS
 
 #include "Export.h"
+#include "ExportPipeline.h"
 
 #include <wx/log.h>
 #include <wx/slider.h>
@@ -143,6 +144,8 @@ public:
                const Tags *metadata = NULL,
                int subformat = 0) override;
 
+   bool CanExportConcurrently(int subformat) override;
+
 private:
 
    bool FillComment(AudacityProject *project, vorbis_comment *comment, const Tags *metadata);
@@ -275,20 +278,20 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    }
 
    {
-      auto mixer = CreateMixer(tracks, selectionOnly,
+      ExportPipeline mixer{ CreateMixer(tracks, selectionOnly,
          t0, t1,
          numChannels, SAMPLES_PER_RUN, false,
-         rate, floatSample, true, mixerSpec);
+         rate, floatSample, true, mixerSpec),
+         SAMPLES_PER_RUN };
 
       InitProgress( pDialog, fName,
          selectionOnly
             ? XO("Exporting the selected audio as Ogg Vorbis")
             : XO("Exporting the audio as Ogg Vorbis") );
-      auto &progress = *pDialog;
 
       while (updateResult == ProgressResult::Success && !eos) {
          float **vorbis_buffer = vorbis_analysis_buffer(&dsp, SAMPLES_PER_RUN);
-         auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
+         auto samplesThisRun = mixer.Process();
 
          int err;
          if (samplesThisRun == 0) {
@@ -298,7 +301,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
          else {
 
             for (size_t i = 0; i < numChannels; i++) {
-               float *temp = (float *)mixer->GetBuffer(i);
+               float *temp = (float *)mixer.GetBuffer(i);
                memcpy(vorbis_buffer[i], temp, sizeof(float)*SAMPLES_PER_RUN);
             }
 
@@ -355,7 +358,8 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
             break;
          }
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+         updateResult = UpdateProgress(
+            pDialog, mixer.MixGetCurrentTime() - t0, t1 - t0);
       }
    }
 
@@ -368,6 +372,11 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    return updateResult;
 }
 
+bool ExportOGG::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return true;
+}
+
 void ExportOGG::OptionsCreate(ShuttleGui &S, int format)
 {
    S.AddWindow( safenew ExportOGGOptions{ S.GetParent(), format } );
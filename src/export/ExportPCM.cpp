@@ -37,6 +37,7 @@
 #include "../wxFileNameWrapper.h"
 
 #include "Export.h"
+#include "ExportPipeline.h"
 
 #ifdef USE_LIBID3TAG
    #include <id3tag.h>
@@ -414,6 +415,7 @@ public:
    wxString GetFormat(int index) override;
    FileExtension GetExtension(int index) override;
    unsigned GetMaxChannels(int index) override;
+   bool CanExportConcurrently(int subformat) override;
 
 private:
    void ReportTooBigError(wxWindow * pParent);
@@ -456,8 +458,12 @@ void ExportPCM::ReportTooBigError(wxWindow * pParent)
       XO("You have attempted to Export a WAV or AIFF file which would be greater than 4GB.\n"
       "Audacity cannot do this, the Export was abandoned.");
 
-   ShowErrorDialog(pParent, XO("Error Exporting"), message,
-                  wxT("Size_limits_for_WAV_and_AIFF_files"));
+   if (!wxIsMainThread())
+      // Concurrent export; the error dialog can't be made on this thread
+      AudacityMessageBox( message, XO("Error Exporting") );
+   else
+      ShowErrorDialog(pParent, XO("Error Exporting"), message,
+                     wxT("Size_limits_for_WAV_and_AIFF_files"));
 
 // This alternative error dialog was to cover the possibility we could not 
 // compute the size in advance.
@@ -611,7 +617,8 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
          // Test for 4 Gibibytes, rather than 4 Gigabytes
          if( byteCount > 4.295e9)
          {
-            ReportTooBigError( wxTheApp->GetTopWindow() );
+            ReportTooBigError(
+               wxIsMainThread() ? wxTheApp->GetTopWindow() : nullptr );
             return ProgressResult::Failed;
          }
       }
@@ -619,26 +626,26 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
 
       {
          wxASSERT(info.channels >= 0);
-         auto mixer = CreateMixer(tracks, selectionOnly,
+         ExportPipeline mixer{ CreateMixer(tracks, selectionOnly,
                                   t0, t1,
                                   info.channels, maxBlockLen, true,
-                                  rate, format, true, mixerSpec);
+                                  rate, format, true, mixerSpec),
+                               maxBlockLen };
 
          InitProgress( pDialog, fName,
             (selectionOnly
                ? XO("Exporting the selected audio as %s")
                : XO("Exporting the audio as %s"))
                .Format( formatStr ) );
-         auto &progress = *pDialog;
 
          while (updateResult == ProgressResult::Success) {
             sf_count_t samplesWritten;
-            size_t numSamples = mixer->Process(maxBlockLen);
+            size_t numSamples = mixer.Process();
 
             if (numSamples == 0)
                break;
 
-            samplePtr mixed = mixer->GetBuffer();
+            samplePtr mixed = mixer.GetBuffer();
 
             if (format == int16Sample)
                samplesWritten = SFCall<sf_count_t>(sf_writef_short, sf.get(), (short *)mixed, numSamples);
@@ -659,7 +666,8 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
                break;
             }
             
-            updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+            updateResult = UpdateProgress(
+               pDialog, mixer.MixGetCurrentTime() - t0, t1 - t0);
          }
       }
       
@@ -1070,6 +1078,11 @@ unsigned ExportPCM::GetMaxChannels(int index)
    return si.channels - 1;
 }
 
+bool ExportPCM::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return true;
+}
+
 static Exporter::RegisteredExportPlugin sRegisteredPlugin{ "PCM",
    []{ return std::make_unique< ExportPCM >(); }
 };
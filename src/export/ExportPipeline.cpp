@@ -0,0 +1,135 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ExportPipeline.cpp
+
+*******************************************************************//**
+
+\class ExportPipeline
+\brief Overlaps mixing with encoding, mixing on a thread of its own.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "ExportPipeline.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../Mix.h"
+
+ExportPipeline::ExportPipeline(
+   std::unique_ptr<Mixer> mixer, size_t maxSamples, size_t depth)
+   : mMixer{ std::move( mixer ) }
+   , mMaxSamples{ maxSamples }
+   , mBlocks( std::max<size_t>( 1, depth ) )
+   , mTime{ mMixer->MixGetCurrentTime() }
+{
+   const auto numChannels = mMixer->GetNumChannels();
+   const auto interleaved = mMixer->IsInterleaved();
+   const auto numBuffers = interleaved ? 1 : numChannels;
+   const auto bufferLen = interleaved ? maxSamples * numChannels : maxSamples;
+   for (auto &block : mBlocks) {
+      block.buffers.reinit( numBuffers );
+      for (unsigned ii = 0; ii < numBuffers; ++ii)
+         block.buffers[ii].Allocate( bufferLen, mMixer->GetFormat() );
+   }
+
+   mThread = std::thread( [this]{ Produce(); } );
+}
+
+ExportPipeline::~ExportPipeline()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mStopping = true;
+   }
+   mCondition.notify_all();
+   mThread.join();
+}
+
+void ExportPipeline::Produce()
+{
+   const auto numChannels = mMixer->GetNumChannels();
+   const auto interleaved = mMixer->IsInterleaved();
+   const auto numBuffers = interleaved ? 1 : numChannels;
+   const auto sampleSize =
+      SAMPLE_SIZE( mMixer->GetFormat() ) * (interleaved ? numChannels : 1);
+
+   while (true) {
+      Block *pBlock;
+      {
+         std::unique_lock<std::mutex> lock{ mMutex };
+         mCondition.wait( lock, [this]{
+            return mStopping || mFilled < mBlocks.size(); } );
+         if (mStopping)
+            return;
+         // Only this thread writes the block past the filled ones
+         pBlock = &mBlocks[ (mHead + mFilled) % mBlocks.size() ];
+      }
+
+      size_t count;
+      try {
+         count = mMixer->Process( mMaxSamples );
+         for (unsigned ii = 0; ii < numBuffers; ++ii)
+            memcpy( pBlock->buffers[ii].ptr(),
+               mMixer->GetBuffer( ii ), count * sampleSize );
+         pBlock->count = count;
+         pBlock->time = mMixer->MixGetCurrentTime();
+      }
+      catch( ... ) {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mException = std::current_exception();
+         mFinished = true;
+         mCondition.notify_all();
+         return;
+      }
+
+      std::lock_guard<std::mutex> lock{ mMutex };
+      if (count == 0)
+         mFinished = true;
+      else
+         ++mFilled;
+      mCondition.notify_all();
+      if (mFinished)
+         return;
+   }
+}
+
+size_t ExportPipeline::Process()
+{
+   std::unique_lock<std::mutex> lock{ mMutex };
+
+   // Give back the run taken last time
+   if (mCurrent) {
+      mCurrent = nullptr;
+      mHead = (mHead + 1) % mBlocks.size();
+      --mFilled;
+      mCondition.notify_all();
+   }
+
+   mCondition.wait( lock, [this]{ return mFinished || mFilled > 0; } );
+   if (mFilled == 0) {
+      if (mException) {
+         auto exception = mException;
+         mException = nullptr;
+         std::rethrow_exception( exception );
+      }
+      return 0;
+   }
+
+   mCurrent = &mBlocks[ mHead ];
+   mTime = mCurrent->time;
+   return mCurrent->count;
+}
+
+samplePtr ExportPipeline::GetBuffer()
+{
+   return mCurrent->buffers[0].ptr();
+}
+
+samplePtr ExportPipeline::GetBuffer(int channel)
+{
+   return mCurrent->buffers[channel].ptr();
+}
@@ -0,0 +1,86 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ExportPipeline.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_EXPORT_PIPELINE__
+#define __AUDACITY_EXPORT_PIPELINE__
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../MemoryX.h"
+#include "../SampleFormat.h"
+
+class Mixer;
+
+/// \brief Runs a Mixer on a thread of its own, a few runs ahead of the
+/// exporter that encodes its output.
+///
+/// Offers the parts of the Mixer interface that exporters use.  Mixing and
+/// encoding then overlap, and neither waits for the other while the queue of
+/// mixed runs between them is neither empty nor full.  The runs are copied
+/// into a fixed ring of buffers, so nothing is allocated after construction.
+class AUDACITY_DLL_API ExportPipeline
+{
+public:
+   enum : size_t { DefaultDepth = 4 };
+
+   /// Start mixing at once, in runs of at most maxSamples, keeping at most
+   /// depth runs ready
+   ExportPipeline(std::unique_ptr<Mixer> mixer, size_t maxSamples,
+                  size_t depth = DefaultDepth);
+   ExportPipeline( const ExportPipeline& ) = delete;
+   ExportPipeline &operator=( const ExportPipeline& ) = delete;
+
+   /// Stops the mixing thread, discarding any runs not yet taken
+   ~ExportPipeline();
+
+   /// Wait for the next run, as from Mixer::Process(maxSamples).
+   /// Returns 0 when there are no more samples.  Rethrows any exception from
+   /// mixing, once the runs mixed before it are taken.
+   size_t Process();
+
+   /// Buffers of the run returned by the last Process(), laid out as
+   /// the Mixer's are; valid until the next Process()
+   samplePtr GetBuffer();
+   samplePtr GetBuffer(int channel);
+
+   /// Mixer::MixGetCurrentTime() as of the run returned by the last Process()
+   double MixGetCurrentTime() const { return mTime; }
+
+private:
+   struct Block {
+      ArrayOf<SampleBuffer> buffers;
+      size_t count{ 0 };
+      double time{ 0 };
+   };
+
+   void Produce();
+
+   const std::unique_ptr<Mixer> mMixer;
+   const size_t mMaxSamples;
+   std::vector<Block> mBlocks;
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   // mBlocks is a ring; the mFilled blocks from mHead are mixed, and the
+   // first of them is mCurrent if the consumer holds it
+   size_t mHead{ 0 };
+   size_t mFilled{ 0 };
+   Block *mCurrent{ nullptr };
+   bool mFinished{ false };
+   bool mStopping{ false };
+   std::exception_ptr mException;
+
+   double mTime;
+   std::thread mThread;
+};
+
+#endif
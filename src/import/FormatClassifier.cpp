@@ -16,12 +16,21 @@ The classifier operates in the frequency domain and exploits
 the low-pass-like spectral behaviour of natural audio signals 
 for classification of the sample format and the used endianness.
 
+The start of the file is read into memory once.  Each format is then tried
+as mono and as stereo on threads of their own, each with its own reader of
+that memory, meter and buffers.
+
 *//*******************************************************************/
 #include "FormatClassifier.h"
 
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cfloat>
+#include <exception>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 #include <cstdio>
 
@@ -29,10 +38,35 @@ for classification of the sample format and the used endianness.
 
 #include "sndfile.h"
 
-FormatClassifier::FormatClassifier(const char* filename) :
-   mReader(filename),
-   mMeter(cSiglen)
+struct FormatClassifier::Workspace
+{
+   Workspace(const uint8_t* data, size_t size)
+      : mReader(data, size)
+      , mMeter(cSiglen)
+   {}
+
+   MultiFormatReader    mReader;
+   SpecPowerCalculation mMeter;
+
+   Floats               mSigBuffer{ cSiglen };
+   Floats               mAuxBuffer{ cSiglen };
+   ArrayOf<uint8_t> mRawBuffer{ cSiglen * 8 };
+};
+
+FormatClassifier::FormatClassifier(const char* filename)
 {
+   // Read all that the classes may need, once
+   {
+      FILE* fid = fopen(filename, "rb");
+      if (fid == NULL)
+      {
+         throw std::runtime_error("Error opening file");
+      }
+      mData.reinit(cMaxRead);
+      mDataSize = fread(mData.get(), 1, cMaxRead, fid);
+      fclose(fid);
+   }
+
    // Define the classification classes
    for ( auto endianness : {
       MachineEndianness::Little,
@@ -129,54 +163,63 @@ unsigned FormatClassifier::GetResultChannels()
 
 void FormatClassifier::Run()
 {
-   // Calc the mono feature vector
-   for (unsigned int n = 0; n < mClasses.size(); n++)
-   {
-      // Read the signal
-      ReadSignal(mClasses[n], 1);
+   // Calc the mono, then the stereo feature vector, one entry for
+   // each job
+   const size_t nClasses = mClasses.size();
+   const size_t nJobs = 2 * nClasses;
+   const auto doJob = [&](Workspace &ws, size_t job) {
+      const size_t n = job % nClasses;
+      if (job < nClasses)
+         mMonoFeat[n] = CalcFeature(ws, mClasses[n], 1);
+      else
+         mStereoFeat[n] = CalcFeature(ws, mClasses[n], 2);
+   };
+
 #ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
-      mpWriter->WriteSignal(mSigBuffer, cSiglen);
+   // Write the signals in order
+   const unsigned nThreads = 1;
+#else
+   const unsigned nThreads = unsigned( std::min<size_t>(nJobs,
+      std::max(1u, std::thread::hardware_concurrency())) );
 #endif
 
-      // Do some simple preprocessing
-      // Remove DC offset
-      float smean = Mean(mSigBuffer.get(), cSiglen);
-      Sub(mSigBuffer.get(), smean, cSiglen);
-      // Normalize to +- 1.0
-      Abs(mSigBuffer.get(), mAuxBuffer.get(), cSiglen);
-      float smax = Max(mAuxBuffer.get(), cSiglen);
-      Div(mSigBuffer.get(), smax, cSiglen);
-
-      // Now actually fill the feature vector
-      // Low to high band power ratio
-      float pLo = mMeter.CalcPower(mSigBuffer.get(), 0.15f, 0.3f);
-      float pHi = mMeter.CalcPower(mSigBuffer.get(), 0.45f, 0.1f);
-      mMonoFeat[n] = pLo / pHi;
+   if (nThreads <= 1)
+   {
+      Workspace ws(mData.get(), mDataSize);
+      for (size_t job = 0; job < nJobs; job++)
+      {
+         doJob(ws, job);
+      }
    }
-
-   // Calc the stereo feature vector
-   for (unsigned int n = 0; n < mClasses.size(); n++)
+   else
    {
-      // Read the signal
-      ReadSignal(mClasses[n], 2);
-#ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
-      mpWriter->WriteSignal(mSigBuffer, cSiglen);
-#endif
-
-      // Do some simple preprocessing
-      // Remove DC offset
-      float smean = Mean(mSigBuffer.get(), cSiglen);
-      Sub(mSigBuffer.get(), smean, cSiglen);
-      // Normalize to +- 1.0
-      Abs(mSigBuffer.get(), mAuxBuffer.get(), cSiglen);
-      float smax = Max(mAuxBuffer.get(), cSiglen);
-      Div(mSigBuffer.get(), smax, cSiglen);
-
-      // Now actually fill the feature vector
-      // Low to high band power ratio
-      float pLo = mMeter.CalcPower(mSigBuffer.get(), 0.15f, 0.3f);
-      float pHi = mMeter.CalcPower(mSigBuffer.get(), 0.45f, 0.1f);
-      mStereoFeat[n] = pLo / pHi;
+      std::atomic<size_t> next{ 0 };
+      std::vector<std::exception_ptr> errors(nThreads);
+      {
+         std::vector<std::thread> threads;
+         auto cleanup = finally([&] {
+            for (auto &thread : threads)
+               thread.join();
+         });
+         for (unsigned ii = 0; ii < nThreads; ii++)
+         {
+            threads.emplace_back([&, ii] {
+               try {
+                  Workspace ws(mData.get(), mDataSize);
+                  for (size_t job; (job = next++) < nJobs;)
+                     doJob(ws, job);
+               }
+               catch (...) {
+                  errors[ii] = std::current_exception();
+               }
+            });
+         }
+      }
+      for (auto &error : errors)
+      {
+         if (error)
+            std::rethrow_exception(error);
+      }
    }
 
    // Get the results
@@ -197,35 +240,63 @@ void FormatClassifier::Run()
 
 }
 
-void FormatClassifier::ReadSignal(FormatClassT format, size_t stride)
+float FormatClassifier::CalcFeature(
+   Workspace &ws, FormatClassT format, size_t stride)
+{
+   // Read the signal
+   ReadSignal(ws, format, stride);
+#ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
+   mpWriter->WriteSignal(ws.mSigBuffer.get(), cSiglen);
+#endif
+
+   // Do some simple preprocessing
+   // Remove DC offset
+   float smean = Mean(ws.mSigBuffer.get(), cSiglen);
+   Sub(ws.mSigBuffer.get(), smean, cSiglen);
+   // Normalize to +- 1.0
+   Abs(ws.mSigBuffer.get(), ws.mAuxBuffer.get(), cSiglen);
+   float smax = Max(ws.mAuxBuffer.get(), cSiglen);
+   Div(ws.mSigBuffer.get(), smax, cSiglen);
+
+   // Now actually fill the feature vector
+   // Low to high band power ratio
+   float pLo = ws.mMeter.CalcPower(ws.mSigBuffer.get(), 0.15f, 0.3f);
+   float pHi = ws.mMeter.CalcPower(ws.mSigBuffer.get(), 0.45f, 0.1f);
+   return pLo / pHi;
+}
+
+void FormatClassifier::ReadSignal(
+   Workspace &ws, FormatClassT format, size_t stride)
 {
    size_t actRead = 0;
    unsigned int n = 0;
+   auto &reader = ws.mReader;
+   const auto rawBuffer = ws.mRawBuffer.get();
 
-   mReader.Reset();
+   reader.Reset();
 
    // Do a dummy read of 1024 bytes to skip potential header information
-   mReader.ReadSamples(mRawBuffer.get(), 1024, MultiFormatReader::Uint8, MachineEndianness::Little);
+   reader.ReadSamples(rawBuffer, 1024, MultiFormatReader::Uint8, MachineEndianness::Little);
 
    do
    {
-      actRead = mReader.ReadSamples(mRawBuffer.get(), cSiglen, stride, format.format, format.endian);
+      actRead = reader.ReadSamples(rawBuffer, cSiglen, stride, format.format, format.endian);
 
       if (n == 0)
       {
-         ConvertSamples(mRawBuffer.get(), mSigBuffer.get(), format);
+         ConvertSamples(rawBuffer, ws.mSigBuffer.get(), format);
       }
       else
       {
          if (actRead == cSiglen)
          {
-            ConvertSamples(mRawBuffer.get(), mAuxBuffer.get(), format);
+            ConvertSamples(rawBuffer, ws.mAuxBuffer.get(), format);
 
             // Integrate signals
-            Add(mSigBuffer.get(), mAuxBuffer.get(), cSiglen);
+            Add(ws.mSigBuffer.get(), ws.mAuxBuffer.get(), cSiglen);
 
             // Do some dummy reads to break signal coherence
-            mReader.ReadSamples(mRawBuffer.get(), n + 1, stride, format.format, format.endian);
+            reader.ReadSamples(rawBuffer, n + 1, stride, format.format, format.endian);
          }
       }
 
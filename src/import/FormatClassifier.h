@@ -72,19 +72,22 @@ private:
 
    static const size_t cSiglen = 512;
    static const size_t cNumInts = 32;
+   // Bytes of the file that ReadSignal may read, for the widest format
+   // and stride:  the skipped header, then the signals and dummy reads
+   static const size_t cMaxRead = 1024 + cNumInts * (cSiglen + cNumInts) * 2 * 8;
+
+   struct Workspace;
 
    FormatVectorT        mClasses;
-   MultiFormatReader    mReader;
-   SpecPowerCalculation mMeter;
+
+   // The start of the file, read once and shared by all threads
+   ArrayOf<uint8_t>     mData;
+   size_t               mDataSize { 0 };
 
 #ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
    std::unique_ptr<DebugWriter> mpWriter;
 #endif
 
-   Floats               mSigBuffer{ cSiglen };
-   Floats               mAuxBuffer{ cSiglen };
-   ArrayOf<uint8_t> mRawBuffer{ cSiglen * 8 };
-
    Floats               mMonoFeat;
    Floats               mStereoFeat;
    
@@ -100,7 +103,8 @@ public:
    unsigned GetResultChannels();
 private:
    void Run();
-   void ReadSignal(FormatClassT format, size_t stride);
+   float CalcFeature(Workspace &ws, FormatClassT format, size_t stride);
+   void ReadSignal(Workspace &ws, FormatClassT format, size_t stride);
    void ConvertSamples(void* in, float* out, FormatClassT format);
 
    void Add(float* in1, float* in2, size_t len);
@@ -449,7 +449,8 @@ bool Importer::Import( AudacityProject &project,
                      TrackFactory *trackFactory,
                      TrackHolders &tracks,
                      Tags *tags,
-                     TranslatableString &errorMessage)
+                     TranslatableString &errorMessage,
+                     std::unique_ptr<ImportFileHandle> *pDeferred)
 {
    AudacityProject *pProj = &project;
    auto cleanup = valueRestorer( pProj->mbBusyImporting, true );
@@ -643,6 +644,12 @@ bool Importer::Import( AudacityProject &project,
          else
             inFile->SetStreamUsage(0,TRUE);
 
+         if (pDeferred && inFile->CanImportConcurrently()) {
+            // The caller imports it, maybe on another thread
+            *pDeferred = std::move( inFile );
+            return true;
+         }
+
          auto res = inFile->Import(trackFactory, tracks, tags);
 
          if (res == ProgressResult::Success || res == ProgressResult::Stopped)
@@ -894,6 +901,63 @@ void ImportStreamDialog::OnCancel(wxCommandEvent & WXUNUSED(event))
    EndModal( wxID_CANCEL );
 }
 
+//----------------------------------------------------------------------------
+// ConcurrentImport
+//----------------------------------------------------------------------------
+
+namespace {
+thread_local ConcurrentImport *sCurrentImport = nullptr;
+}
+
+ConcurrentImport::ConcurrentImport(std::mutex &setupMutex)
+   : mSetupLock{ setupMutex, std::defer_lock }
+   , mRequest{ static_cast<unsigned>( ProgressResult::Success ) }
+{
+}
+
+ConcurrentImport::Scope::Scope( ConcurrentImport &concurrentImport )
+   : mImport{ concurrentImport }
+{
+   wxASSERT( !sCurrentImport );
+   mImport.mSetupLock.lock();
+   sCurrentImport = &mImport;
+}
+
+ConcurrentImport::Scope::~Scope()
+{
+   sCurrentImport = nullptr;
+   mImport.EndSetup();
+}
+
+ConcurrentImport *ConcurrentImport::Current()
+{
+   return sCurrentImport;
+}
+
+void ConcurrentImport::Request(ProgressResult result)
+{
+   mRequest.store( static_cast<unsigned>( result ) );
+}
+
+void ConcurrentImport::EndSetup()
+{
+   if (mSetupLock.owns_lock())
+      mSetupLock.unlock();
+}
+
+ProgressResult ConcurrentImport::Update(double current, double total)
+{
+   // The tracks are made by now; let other imports proceed
+   EndSetup();
+   if (total > 0)
+      mFraction.store( std::max( 0.0, std::min( 1.0, current / total ) ) );
+   return static_cast<ProgressResult>( mRequest.load() );
+}
+
+//----------------------------------------------------------------------------
+// ImportFileHandle
+//----------------------------------------------------------------------------
+
 ImportFileHandle::ImportFileHandle(const FilePath & filename)
 :  mFilename(filename)
 {
@@ -903,8 +967,24 @@ ImportFileHandle::~ImportFileHandle()
 {
 }
 
+bool ImportFileHandle::CanImportConcurrently()
+{
+   return false;
+}
+
+ProgressResult ImportFileHandle::UpdateProgress(double current, double total)
+{
+   if (auto pConcurrentImport = ConcurrentImport::Current())
+      return pConcurrentImport->Update( current, total );
+   return mProgress->Update( current, total );
+}
+
 void ImportFileHandle::CreateProgress()
 {
+   if (ConcurrentImport::Current())
+      // No dialog on a worker thread
+      return;
+
    wxFileName ff( mFilename );
 
    auto title = XO("Importing %s").Format( GetFileDescription() );
@@ -164,12 +164,16 @@ public:
     std::unique_ptr<ExtImportItem> CreateDefaultImportItem();
 
    // if false, the import failed and errorMessage will be set.
+   // If pDeferred is not null and the importer chosen for the file
+   // CanImportConcurrently(), the opened handle is stored there instead of
+   // being imported, and tracks and tags are untouched.
    bool Import( AudacityProject &project,
               const FilePath &fName,
               TrackFactory *trackFactory,
               TrackHolders &tracks,
               Tags *tags,
-              TranslatableString &errorMessage);
+              TranslatableString &errorMessage,
+              std::unique_ptr<ImportFileHandle> *pDeferred = nullptr);
 
 private:
    static Importer mInstance;
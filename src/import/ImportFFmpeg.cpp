@@ -158,6 +158,12 @@ static const auto exts = {
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 
 #ifdef EXPERIMENTAL_OD_FFMPEG
 #include "../ondemand/ODDecodeFFmpegTask.h"
@@ -165,6 +171,41 @@ static const auto exts = {
 
 extern FFmpegLibs *FFmpegLibsInst();
 
+namespace {
+
+// Packets read ahead for each stream that is decoded on its own thread
+const size_t MaxQueuedPackets = 64;
+
+/// Packets of one stream, passed from the thread that reads the file to the
+/// one that decodes the stream
+struct PacketQueue
+{
+   std::mutex mutex;
+   std::condition_variable condition;
+   std::deque<AVPacketEx> packets;
+   bool finished{ false }; // no more packets will come
+   bool stopping{ false }; // give up on the packets not yet decoded
+   std::exception_ptr exception;
+};
+
+// Separate the first nDst of the srcChannels interleaved in src, each into
+// its own buffer, converting each sample; one channel at a time, in a loop
+// with no branches
+template<typename In, typename Out, typename Convert>
+void DeinterleaveConverting(const uint8_t *src, size_t srcChannels,
+   const samplePtr *dst, size_t nDst, size_t len, Convert convert)
+{
+   const auto in = reinterpret_cast<const In*>(src);
+   for (size_t chn = 0; chn < nDst; ++chn) {
+      const auto out = reinterpret_cast<Out*>(dst[chn]);
+      auto pIn = in + chn;
+      for (size_t ii = 0; ii < len; ++ii, pIn += srcChannels)
+         out[ii] = convert(*pIn);
+   }
+}
+
+}
+
 class FFmpegImportFileHandle;
 
 /// A representative of FFmpeg loader in
@@ -225,6 +266,22 @@ public:
    ///\param sc - stream context
    ProgressResult WriteData(streamContext *sc);
 
+   ///! Appends the decoded samples to the stream's WaveTracks; may be called
+   ///! on the stream's own decoding thread
+   ///\param sc - stream context
+   ///\param streamid - index of the stream in mScs and mChannels
+   void AppendDecoded(streamContext *sc, int streamid);
+
+   ///! Updates the progress indicator for a packet read
+   ///\param frameNumber - how many frames of the stream were read
+   ProgressResult UpdateProgress(
+      const streamContext *sc, const AVPacket &pkt, int frameNumber);
+
+   ///! Reads the file on this thread and decodes each stream on a thread of
+   ///! its own
+   ///\return import status, as from WriteData
+   ProgressResult DecodeStreamsInParallel();
+
    ///! Writes extracted metadata to tags object
    ///\param avf - file context
    ///\ tags - Audacity tags object
@@ -423,6 +480,10 @@ bool FFmpegImportFileHandle::InitCodecs()
             continue;
          }
 
+         // Let the decoder use threads of its own, if it can
+         sc->m_codecCtx->thread_count = 0;
+         sc->m_codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
          if (avcodec_open2(sc->m_codecCtx, codec, NULL) < 0)
          {
             wxLogError(wxT("FFmpeg : avcodec_open() failed. Index[%02d], Codec[%02x - %s]"),i,id,name);
@@ -632,6 +693,11 @@ ProgressResult FFmpegImportFileHandle::Import(TrackFactory *trackFactory,
    } else {
 #endif
 
+   // Streams of a file with several are decoded at once
+   if (mNumStreams > 1)
+      res = DecodeStreamsInParallel();
+   else {
+
    // Read next frame.
    for (streamContext *sc; (sc = ReadNextFrame()) != NULL && (res == ProgressResult::Success);)
    {
@@ -654,21 +720,21 @@ ProgressResult FFmpegImportFileHandle::Import(TrackFactory *trackFactory,
       }
    }
 
-   // Flush the decoders.
+   // Flush the decoders, which may hold several frames when they use
+   // threads
    if ((mNumStreams != 0) && (res == ProgressResult::Success || res == ProgressResult::Stopped))
    {
       for (int i = 0; i < mNumStreams; i++)
       {
          auto sc = scs[i].get();
          sc->m_pkt.emplace();
-         if (DecodeFrame(sc, true) == 0)
-         {
+         while (DecodeFrame(sc, true) == 0 && sc->m_frameValid)
             WriteData(sc);
-
-            sc->m_pkt.reset();
-         }
+         sc->m_pkt.reset();
       }
    }
+
+   } // else -- mNumStreams > 1
 #ifdef EXPERIMENTAL_OD_FFMPEG
    } // else -- !mUsingOD == true
 #endif   //EXPERIMENTAL_OD_FFMPEG
@@ -709,9 +775,8 @@ ProgressResult FFmpegImportFileHandle::WriteData(streamContext *sc)
 {
    // Find the stream index in mScs array
    int streamid = -1;
-   auto iter = mChannels.begin();
    auto scs = mScs->get();
-   for (int i = 0; i < mNumStreams; ++iter, ++i)
+   for (int i = 0; i < mNumStreams; ++i)
    {
       if (scs[i].get() == sc)
       {
@@ -725,92 +790,219 @@ ProgressResult FFmpegImportFileHandle::WriteData(streamContext *sc)
       return ProgressResult::Success;
    }
 
-   // Allocate the buffer to store audio.
-   auto insamples = sc->m_decodedAudioSamplesValidSiz / sc->m_samplesize;
-   size_t nChannels = std::min(sc->m_stream->codec->channels, sc->m_initialchannels);
+   AppendDecoded(sc, streamid);
 
-   ArraysOf<uint8_t> tmp{ nChannels, sc->m_osamplesize * (insamples / nChannels) };
+   return UpdateProgress(sc, *sc->m_pkt, sc->m_codecCtx->frame_number);
+}
 
-   // Separate the channels and convert input sample format to 16-bit
-   uint8_t *in = sc->m_decodedAudioSamples.get();
-   int index = 0;
-   unsigned int pos = 0;
-   while (pos < insamples)
+void FFmpegImportFileHandle::AppendDecoded(streamContext *sc, int streamid)
+{
+   // Allocate the buffer to store audio.
+   const size_t channels = sc->m_stream->codec->channels;
+   const size_t nChannels = std::min<size_t>(channels, sc->m_initialchannels);
+   if (nChannels == 0)
+      return;
+   const size_t frames =
+      sc->m_decodedAudioSamplesValidSiz / sc->m_samplesize / channels;
+
+   ArraysOf<uint8_t> tmp{ nChannels, sc->m_osamplesize * frames };
+   std::vector<samplePtr> dst(nChannels);
+   for (size_t chn = 0; chn < nChannels; ++chn)
+      dst[chn] = (samplePtr)tmp[chn].get();
+
+   // Separate the channels and convert input sample format to 16-bit or
+   // float
+   const uint8_t *in = sc->m_decodedAudioSamples.get();
+   switch (sc->m_samplefmt)
    {
-      for (size_t chn = 0; (int)chn < sc->m_stream->codec->channels; chn++)
-      {
-         if (chn < nChannels)
-         {
-            switch (sc->m_samplefmt)
-            {
-               case AV_SAMPLE_FMT_U8:
-               case AV_SAMPLE_FMT_U8P:
-                  ((int16_t *)tmp[chn].get())[index] = (int16_t) (*(uint8_t *)in - 0x80) << 8;
-               break;
-
-               case AV_SAMPLE_FMT_S16:
-               case AV_SAMPLE_FMT_S16P:
-                  ((int16_t *)tmp[chn].get())[index] = (int16_t) *(int16_t *)in;
-               break;
-
-               case AV_SAMPLE_FMT_S32:
-               case AV_SAMPLE_FMT_S32P:
-                  ((float *)tmp[chn].get())[index] = (float) *(int32_t *)in * (1.0 / (1u << 31));
-               break;
-
-               case AV_SAMPLE_FMT_FLT:
-               case AV_SAMPLE_FMT_FLTP:
-                  ((float *)tmp[chn].get())[index] = (float) *(float *)in;
-               break;
-
-               case AV_SAMPLE_FMT_DBL:
-               case AV_SAMPLE_FMT_DBLP:
-                  ((float *)tmp[chn].get())[index] = (float) *(double *)in;
-               break;
-
-               default:
-                  wxLogError(wxT("Stream %d has unrecognized sample format %d."), streamid, sc->m_samplefmt);
-                  return ProgressResult::Success;
-               break;
-            }
-         }
-         in += sc->m_samplesize;
-         pos++;
-      }
-      index++;
+      case AV_SAMPLE_FMT_U8:
+      case AV_SAMPLE_FMT_U8P:
+         DeinterleaveConverting<uint8_t, int16_t>(
+            in, channels, dst.data(), nChannels, frames,
+            [](uint8_t sample){ return (int16_t) ((sample - 0x80) * 256); });
+      break;
+
+      case AV_SAMPLE_FMT_S16:
+      case AV_SAMPLE_FMT_S16P:
+         DeinterleaveSamples((samplePtr)in, int16Sample,
+            channels, dst.data(), nChannels, frames);
+      break;
+
+      case AV_SAMPLE_FMT_S32:
+      case AV_SAMPLE_FMT_S32P:
+         DeinterleaveConverting<int32_t, float>(
+            in, channels, dst.data(), nChannels, frames,
+            [](int32_t sample){
+               return (float) ((float) sample * (1.0 / (1u << 31))); });
+      break;
+
+      case AV_SAMPLE_FMT_FLT:
+      case AV_SAMPLE_FMT_FLTP:
+         DeinterleaveSamples((samplePtr)in, floatSample,
+            channels, dst.data(), nChannels, frames);
+      break;
+
+      case AV_SAMPLE_FMT_DBL:
+      case AV_SAMPLE_FMT_DBLP:
+         DeinterleaveConverting<double, float>(
+            in, channels, dst.data(), nChannels, frames,
+            [](double sample){ return (float) sample; });
+      break;
+
+      default:
+         wxLogError(wxT("Stream %d has unrecognized sample format %d."), streamid, sc->m_samplefmt);
+         return;
+      break;
    }
 
    // Write audio into WaveTracks
-   auto iter2 = iter->begin();
-   for (size_t chn=0; chn < nChannels; ++iter2, ++chn)
+   auto &stream = mChannels[streamid];
+   for (size_t chn = 0; chn < nChannels; ++chn)
    {
-      iter2->get()->Append((samplePtr)tmp[chn].get(), sc->m_osamplefmt, index);
+      stream[chn]->Append(dst[chn], sc->m_osamplefmt, frames);
    }
+}
 
+ProgressResult FFmpegImportFileHandle::UpdateProgress(
+   const streamContext *sc, const AVPacket &pkt, int frameNumber)
+{
    // Try to update the progress indicator (and see if user wants to cancel)
-   auto updateResult = ProgressResult::Success;
    int64_t filesize = avio_size(mFormatContext->pb);
    // PTS (presentation time) is the proper way of getting current position
-   if (sc->m_pkt->pts != int64_t(AV_NOPTS_VALUE) && mFormatContext->duration != int64_t(AV_NOPTS_VALUE))
+   if (pkt.pts != int64_t(AV_NOPTS_VALUE) && mFormatContext->duration != int64_t(AV_NOPTS_VALUE))
    {
-      mProgressPos = sc->m_pkt->pts * sc->m_stream->time_base.num / sc->m_stream->time_base.den;
+      mProgressPos = pkt.pts * sc->m_stream->time_base.num / sc->m_stream->time_base.den;
       mProgressLen = (mFormatContext->duration > 0 ? mFormatContext->duration / AV_TIME_BASE: 1);
    }
    // When PTS is not set, use number of frames and number of current frame
-   else if (sc->m_stream->nb_frames > 0 && sc->m_codecCtx->frame_number > 0 && sc->m_codecCtx->frame_number <= sc->m_stream->nb_frames)
+   else if (sc->m_stream->nb_frames > 0 && frameNumber > 0 && frameNumber <= sc->m_stream->nb_frames)
    {
-      mProgressPos = sc->m_codecCtx->frame_number;
+      mProgressPos = frameNumber;
       mProgressLen = sc->m_stream->nb_frames;
    }
    // When number of frames is unknown, use position in file
-   else if (filesize > 0 && sc->m_pkt->pos > 0 && sc->m_pkt->pos <= filesize)
+   else if (filesize > 0 && pkt.pos > 0 && pkt.pos <= filesize)
    {
-      mProgressPos = sc->m_pkt->pos;
+      mProgressPos = pkt.pos;
       mProgressLen = filesize;
    }
-   updateResult = mProgress->Update(mProgressPos, mProgressLen != 0 ? mProgressLen : 1);
+   return mProgress->Update(mProgressPos, mProgressLen != 0 ? mProgressLen : 1);
+}
+
+ProgressResult FFmpegImportFileHandle::DecodeStreamsInParallel()
+{
+   const auto scs = mScs->get();
+   std::vector<PacketQueue> queues(mNumStreams);
+   std::vector<std::thread> threads;
+
+   // Each stream has its own codec context and tracks, so that nothing but
+   // its queue is shared
+   auto decodeStream = [this, scs, &queues](int s) {
+      auto sc = scs[s].get();
+      auto &queue = queues[s];
+      try {
+         while (true) {
+            {
+               std::unique_lock<std::mutex> lock{ queue.mutex };
+               queue.condition.wait(lock, [&]{
+                  return queue.stopping || queue.finished ||
+                     !queue.packets.empty(); });
+               if (queue.stopping)
+                  return;
+               if (queue.packets.empty())
+                  break;
+               sc->m_pkt.emplace(std::move(queue.packets.front()));
+               queue.packets.pop_front();
+            }
+            queue.condition.notify_all();
+
+            sc->m_pktDataPtr = sc->m_pkt->data;
+            sc->m_pktRemainingSiz = sc->m_pkt->size;
+            while (sc->m_pktRemainingSiz > 0)
+            {
+               if (DecodeFrame(sc, false) < 0)
+                  break;
+               if (sc->m_frameValid)
+                  AppendDecoded(sc, s);
+            }
+            sc->m_pkt.reset();
+         }
+
+         sc->m_pkt.emplace();
+         while (DecodeFrame(sc, true) == 0 && sc->m_frameValid)
+            AppendDecoded(sc, s);
+         sc->m_pkt.reset();
+      }
+      catch (...) {
+         std::lock_guard<std::mutex> lock{ queue.mutex };
+         queue.exception = std::current_exception();
+         queue.stopping = true;
+         queue.condition.notify_all();
+      }
+   };
+
+   auto joinThreads = [&](bool stop) {
+      for (auto &queue : queues) {
+         std::lock_guard<std::mutex> lock{ queue.mutex };
+         if (stop)
+            queue.stopping = true;
+         else
+            queue.finished = true;
+         queue.condition.notify_all();
+      }
+      for (auto &thread : threads)
+         thread.join();
+      threads.clear();
+   };
+   auto cleanup = finally([&]{ joinThreads(true); });
+
+   for (int s = 0; s < mNumStreams; ++s)
+      threads.emplace_back(decodeStream, s);
+
+   auto res = ProgressResult::Success;
+   std::vector<int> frameNumbers(mNumStreams);
+   while (res == ProgressResult::Success)
+   {
+      AVPacketEx pkt;
+      if (av_read_frame(mFormatContext, &pkt) < 0)
+         break;
+
+      int s = 0;
+      while (s < mNumStreams && scs[s]->m_stream->index != pkt.stream_index)
+         ++s;
+      // Off-stream packet. Don't panic, just skip it.
+      if (s == mNumStreams)
+         continue;
+
+      // The packet may use the demuxer's buffers, which the next read reuses
+      if (av_dup_packet(&pkt) < 0)
+         continue;
+
+      res = UpdateProgress(scs[s].get(), pkt, ++frameNumbers[s]);
+
+      auto &queue = queues[s];
+      {
+         std::unique_lock<std::mutex> lock{ queue.mutex };
+         queue.condition.wait(lock, [&]{
+            return queue.stopping || queue.packets.size() < MaxQueuedPackets; });
+         // Stop reading if the stream's decoding failed
+         if (queue.stopping)
+            break;
+         queue.packets.push_back(std::move(pkt));
+      }
+      queue.condition.notify_all();
+   }
 
-   return updateResult;
+   if (res == ProgressResult::Cancelled || res == ProgressResult::Failed)
+      return res;
+
+   // Let the decoders finish with what was read
+   joinThreads(false);
+   for (auto &queue : queues)
+      if (queue.exception)
+         std::rethrow_exception(queue.exception);
+
+   return res;
 }
 
 void FFmpegImportFileHandle::WriteMetadata(Tags *tags)
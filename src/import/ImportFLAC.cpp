@@ -153,6 +153,7 @@ public:
    ByteCount GetFileUncompressedBytes() override;
    ProgressResult Import(TrackFactory *trackFactory, TrackHolders &outTracks,
               Tags *tags) override;
+   bool CanImportConcurrently() override { return true; }
 
    wxInt32 GetStreamCount() override { return 1; }
 
@@ -274,7 +275,7 @@ FLAC__StreamDecoderWriteStatus MyFLACFile::write_callback(const FLAC__Frame *fra
 
       mFile->mSamplesDone += frame->header.blocksize;
 
-      mFile->mUpdateResult = mFile->mProgress->Update((wxULongLong_t) mFile->mSamplesDone, mFile->mNumSamples != 0 ? (wxULongLong_t)mFile->mNumSamples : 1);
+      mFile->mUpdateResult = mFile->UpdateProgress((wxULongLong_t) mFile->mSamplesDone, mFile->mNumSamples != 0 ? (wxULongLong_t)mFile->mNumSamples : 1);
       if (mFile->mUpdateResult != ProgressResult::Success)
       {
          return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
@@ -489,7 +490,7 @@ ProgressResult FLACImportFileHandle::Import(TrackFactory *trackFactory,
                blockLen
             );
 
-         mUpdateResult = mProgress->Update(
+         mUpdateResult = UpdateProgress(
             i.as_long_long(),
             fileTotalFrames.as_long_long()
          );
@@ -70,6 +70,11 @@ static Importer::RegisteredUnusableImportPlugin registered{
 #include <wx/timer.h>
 #include <wx/intl.h>
 
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
 #include "../WaveTrack.h"
 
 // PRL:  include these last,
@@ -85,24 +90,263 @@ extern "C" {
 }
 
 #define INPUT_BUFFER_SIZE 65535
-#define PROGRESS_SCALING_FACTOR 100000
-
-/* this is a private structure we can use for whatever we like, and it will get
- * passed to each of the callback routines, allowing us to keep track of
- * things. */
-struct private_data {
-   wxFile *file;            /* the file containing the mp3 data we're feeding the encoder */
-   ArrayOf<unsigned char> inputBuffer{ static_cast<unsigned int>(INPUT_BUFFER_SIZE) };
-   int inputBufferFill;     /* amount of data in inputBuffer */
-   TrackFactory *trackFactory;
-   NewChannelGroup channels;
-   ProgressDialog *progress;
-   unsigned numChannels;
-   ProgressResult updateResult;
-   bool id3checked;
-   bool eof;      /* having supplied both underlying file and guard pad data */
+
+namespace {
+
+// Frames are decoded in runs of this many, as many runs at once as there
+// are processors
+const size_t FramesPerRun = 256;
+
+// A layer III frame may take its main data from up to 511 bytes of the
+// frames before it, which is at most the whole frame but for its header,
+// CRC and side information.  Decoding of a run starts early enough to fill
+// this bit reservoir, and then decodes two more frames without output, to
+// fill the overlap of the hybrid filterbank and the history of the
+// synthesis filterbank, so that the output is exactly as decoding from the
+// start of the file would give.
+const size_t ReservoirBytes = 511;
+const size_t FrameOverhead = 4 + 2 + 32;
+const size_t PrimingFrames = 2;
+
+/// Where each frame begins in the file
+struct FrameIndex
+{
+   std::vector<wxFileOffset> offsets;
+   // Where each buffer of input ends, the last after the guard bytes past
+   // the end of the file.  libmad regains sync differently after damage
+   // depending on where its buffers end, so runs are fed the same buffers.
+   std::vector<wxFileOffset> bufferEnds;
+   wxFileOffset end;
+   bool failed;
+};
+
+/// The input and the output of the decoding of a run of frames
+struct Run
+{
+   // Indices of the frames to output, and of the first to decode
+   size_t first, last, prime;
+   ArrayOf<unsigned char> input;
+   size_t inputLength;
+
+   // Of the first frame output
+   unsigned channels;
+   unsigned sampleRate;
+   // libmad always synthesizes two channels
+   std::vector<float> samples[2];
+   bool failed;
 };
 
+/// Finds the frames by decoding only their headers, buffering the input
+/// just as it is buffered when decoding, so that libmad finds the same
+/// frames either way
+ProgressResult ScanFrames(
+   wxFile &file, ProgressDialog &progress, double progressScale,
+   FrameIndex &index)
+{
+   ArrayOf<unsigned char> buffer{ static_cast<unsigned int>(INPUT_BUFFER_SIZE) };
+   int bufferFill = 0;
+   // Offset in the file of the start of the buffer
+   wxFileOffset base = file.Tell();
+   // having supplied both underlying file and guard pad data
+   bool eof = false;
+
+   const wxULongLong_t length = file.Length() != 0 ? file.Length() : 1;
+   index.offsets.clear();
+   index.bufferEnds.clear();
+   index.end = file.Length();
+   index.failed = false;
+
+   mad_stream stream;
+   mad_header header;
+   mad_stream_init(&stream);
+   mad_header_init(&header);
+   auto cleanup = finally([&]{
+      mad_header_finish(&header);
+      mad_stream_finish(&stream);
+   });
+
+   do {
+      const auto result = progress.Update(
+         (wxULongLong_t)(progressScale * file.Tell()), length);
+      if (result != ProgressResult::Success)
+         return result;
+
+      if (eof)
+         return ProgressResult::Success;
+
+      /* "Each time you refill your buffer, you need to preserve the data in
+       *  your existing buffer from stream.next_frame to the end."
+       *           -- Rob Leslie, on the mad-dev mailing list */
+      int unconsumedBytes = 0;
+      if (stream.next_frame) {
+         /* we must use bufferFill instead of INPUT_BUFFER_SIZE here because
+            the final buffer of the file may be only partially filled */
+         base += stream.next_frame - buffer.get();
+         unconsumedBytes = buffer.get() + bufferFill - stream.next_frame;
+         if (unconsumedBytes > 0)
+            memmove(buffer.get(), stream.next_frame, unconsumedBytes);
+      }
+
+      if (file.Eof() &&
+          (unconsumedBytes + MAD_BUFFER_GUARD < INPUT_BUFFER_SIZE)) {
+         /* supply the requisite MAD_BUFFER_GUARD zero bytes to ensure
+            the final frame gets decoded properly, then finish */
+         memset(buffer.get() + unconsumedBytes, 0, MAD_BUFFER_GUARD);
+         mad_stream_buffer(
+            &stream, buffer.get(), MAD_BUFFER_GUARD + unconsumedBytes);
+         index.bufferEnds.push_back(
+            base + MAD_BUFFER_GUARD + std::max(0, unconsumedBytes));
+         eof = true;
+      }
+      else {
+         auto read = file.Read(buffer.get() + unconsumedBytes,
+            INPUT_BUFFER_SIZE - unconsumedBytes);
+         if (read == wxInvalidOffset)
+            read = 0;
+         mad_stream_buffer(&stream, buffer.get(), read + unconsumedBytes);
+         bufferFill = int(read + unconsumedBytes);
+         index.bufferEnds.push_back(base + bufferFill);
+      }
+
+      while (true) {
+         if (mad_header_decode(&header, &stream) == -1) {
+            if (!MAD_RECOVERABLE(stream.error))
+               break;
+            continue;
+         }
+         index.offsets.push_back(base + (stream.this_frame - buffer.get()));
+      }
+   } while (stream.error == MAD_ERROR_BUFLEN);
+
+   // As when decoding stops for an error that it can't recover from
+   index.failed = true;
+   return ProgressResult::Success;
+}
+
+/// The first frame to decode, for output from the given one
+size_t PrimingStart(const FrameIndex &index, size_t first)
+{
+   if (first <= PrimingFrames)
+      return 0;
+   auto prime = first - PrimingFrames;
+   size_t bytes = 0;
+   while (prime > 0 && bytes < ReservoirBytes) {
+      --prime;
+      const size_t size = index.offsets[prime + 1] - index.offsets[prime];
+      bytes += size > FrameOverhead ? size - FrameOverhead : 0;
+   }
+   return prime;
+}
+
+/// Reads the frames of the run, and the guard bytes after them that
+/// libmad needs, which are zero at the end of the file
+bool ReadRun(wxFile &file, const FrameIndex &index, Run &run)
+{
+   const auto nFrames = index.offsets.size();
+   const auto begin = index.offsets[run.prime];
+   const auto end = run.last < nFrames
+      ? index.offsets[run.last] + MAD_BUFFER_GUARD
+      : index.end + MAD_BUFFER_GUARD;
+   const size_t toRead = std::min(end, index.end) - begin;
+   run.inputLength = end - begin;
+   run.input.reinit(run.inputLength, true);
+   return file.Seek(begin) != wxInvalidOffset &&
+      file.Read(run.input.get(), toRead) == (ssize_t)toRead;
+}
+
+/* convert libmad's fixed point representation to float, with a loop
+ * simple enough for the compiler to vectorize; multiplying by a power of
+ * two gives exactly what dividing would */
+void ConvertSamples(const mad_fixed_t *input, float *output, size_t len)
+{
+   const float scale = 1.0f / (float)(1L << MAD_F_FRACBITS);
+   for (size_t ii = 0; ii < len; ++ii)
+      output[ii] = input[ii] * scale;
+}
+
+/// Decodes the run from its input, which may be done on any thread
+void DecodeRun(const FrameIndex &index, Run &run)
+{
+   run.channels = 0;
+   run.sampleRate = 0;
+   for (auto &samples : run.samples)
+      samples.clear();
+
+   mad_stream stream;
+   mad_frame frame;
+   mad_synth synth;
+   mad_stream_init(&stream);
+   mad_frame_init(&frame);
+   mad_synth_init(&synth);
+   auto cleanup = finally([&]{
+      mad_synth_finish(&synth);
+      mad_frame_finish(&frame);
+      mad_stream_finish(&stream);
+   });
+
+   const unsigned char *const input = run.input.get();
+   const auto base = index.offsets[run.prime];
+   const auto inputEnd = base + (wxFileOffset)run.inputLength;
+   // Begin with the buffer that decoding from the start would have there
+   auto bufferEnd = std::upper_bound(
+      index.bufferEnds.begin(), index.bufferEnds.end(), base);
+   auto start = input;
+   auto cursor = run.prime;
+   bool done = false;
+   while (!done && bufferEnd != index.bufferEnds.end()) {
+      const auto end = std::min(*bufferEnd++, inputEnd);
+      mad_stream_buffer(&stream, start, end - (base + (start - input)));
+      done = (end == inputEnd);
+
+      while (true) {
+         if (mad_frame_decode(&frame, &stream) == -1) {
+            if (!MAD_RECOVERABLE(stream.error))
+               break;
+            continue;
+         }
+
+         // Which frame this is
+         const auto offset = base + (stream.this_frame - input);
+         while (cursor < run.last && index.offsets[cursor] < offset)
+            ++cursor;
+         if (cursor >= run.last) {
+            stream.error = MAD_ERROR_BUFLEN;
+            done = true;
+            break;
+         }
+
+         mad_synth_frame(&synth, &frame);
+         if (cursor < run.first)
+            // Priming only
+            continue;
+
+         const auto &pcm = synth.pcm;
+         if (!run.channels) {
+            run.channels = pcm.channels;
+            run.sampleRate = pcm.samplerate;
+         }
+         for (unsigned chn = 0; chn < 2; ++chn) {
+            auto &samples = run.samples[chn];
+            const auto size = samples.size();
+            samples.resize(size + pcm.length);
+            ConvertSamples(
+               pcm.samples[chn], samples.data() + size, pcm.length);
+         }
+      }
+
+      if (stream.error != MAD_ERROR_BUFLEN)
+         break;
+      // Keep what is unconsumed, as when a buffer is refilled
+      start = stream.next_frame;
+   }
+
+   // The input of each run ends where the next frame's header would need
+   // more, so anything else is an error that libmad can't recover from
+   run.failed = (stream.error != MAD_ERROR_BUFLEN);
+}
+
+}
+
 class MP3ImportPlugin final : public ImportPlugin
 {
 public:
@@ -150,27 +394,8 @@ private:
    void ImportID3(Tags *tags);
 
    std::unique_ptr<wxFile> mFile;
-   void *mUserData;
-   mad_decoder mDecoder;
 };
 
-/* The MAD callbacks */
-enum mad_flow input_cb(void *_data, struct mad_stream *stream);
-enum mad_flow output_cb(void *_data,
-                        struct mad_header const *header,
-                        struct mad_pcm *pcm);
-enum mad_flow error_cb(void *_data, struct mad_stream *stream,
-                       struct mad_frame *frame);
-
-/* convert libmad's fixed point representation to 16 bit signed integers. This
- * code is taken verbatim from minimad.c. */
-
-inline float scale(mad_fixed_t sample)
-{
-   return (float) (sample / (float) (1L << MAD_F_FRACBITS));
-}
-
-
 TranslatableString MP3ImportPlugin::GetPluginFormatDescription()
 {
    return DESC;
@@ -209,50 +434,110 @@ ProgressResult MP3ImportFileHandle::Import(
 
    CreateProgress();
 
-   /* Prepare decoder data, initialize decoder */
+#ifdef USE_LIBID3TAG
+   {
+      // Skip any ID3v2 tag, which ImportID3 reads
+      unsigned char query[ID3_TAG_QUERYSIZE] = {};
+      mFile->Read(query, ID3_TAG_QUERYSIZE);
+      int len = id3_tag_query(query, ID3_TAG_QUERYSIZE);
+      mFile->Seek(len > 0 ? len : 0, wxFromStart);
+   }
+#endif
+
+   /* Find all the frames first, which takes a small part of the time, so
+    * that runs of them can be decoded independently */
 
-   private_data privateData;
-   privateData.file        = mFile.get();
-   privateData.inputBufferFill = 0;
-   privateData.progress    = mProgress.get();
-   privateData.updateResult= ProgressResult::Success;
-   privateData.id3checked  = false;
-   privateData.numChannels = 0;
-   privateData.trackFactory= trackFactory;
-   privateData.eof         = false;
+   const double ScanShare = 0.1;
+   FrameIndex index;
+   auto updateResult = ScanFrames(*mFile, *mProgress, ScanShare, index);
+   if (updateResult != ProgressResult::Success || index.failed)
+      return updateResult;
 
-   mad_decoder_init(&mDecoder, &privateData, input_cb, 0, 0, output_cb, error_cb, 0);
+   const auto nFrames = index.offsets.size();
+   const wxULongLong_t length = index.end != 0 ? index.end : 1;
+   const unsigned nThreads = std::max(1u, std::thread::hardware_concurrency());
+   std::vector<Run> runs(nThreads);
 
-   /* and send the decoder on its way! */
+   NewChannelGroup channels;
+   unsigned numChannels = 0;
+
+   for (size_t first = 0; first < nFrames;) {
+      // Read the input for a run on each thread, going through the file in
+      // order
+      size_t nRuns = 0;
+      for (; nRuns < nThreads && first < nFrames; ++nRuns) {
+         auto &run = runs[nRuns];
+         run.first = first;
+         run.last = first = std::min(first + FramesPerRun, nFrames);
+         run.prime = PrimingStart(index, run.first);
+         if (!ReadRun(*mFile, index, run))
+            return ProgressResult::Failed;
+      }
 
-   bool res = (mad_decoder_run(&mDecoder, MAD_DECODER_MODE_SYNC) == 0) &&
-              (privateData.numChannels > 0) &&
-              !(privateData.updateResult == ProgressResult::Cancelled) &&
-              !(privateData.updateResult == ProgressResult::Failed);
+      std::vector<std::exception_ptr> errors(nRuns);
+      std::vector<std::thread> threads;
+      threads.reserve(nRuns - 1);
+      for (size_t ii = 1; ii < nRuns; ++ii)
+         threads.emplace_back([&, ii]{
+            try { DecodeRun(index, runs[ii]); }
+            catch (...) { errors[ii] = std::current_exception(); }
+         });
+      try { DecodeRun(index, runs[0]); }
+      catch (...) { errors[0] = std::current_exception(); }
+      for (auto &thread : threads)
+         thread.join();
+      for (auto &error : errors)
+         if (error)
+            std::rethrow_exception(error);
+
+      // Append the runs in order
+      for (size_t ii = 0; ii < nRuns; ++ii) {
+         auto &run = runs[ii];
+         if (run.failed)
+            return ProgressResult::Failed;
+
+         /* If this is the first run with output, we need to create the
+          * WaveTracks that will hold the data.  We do this now because now
+          * is the first moment when we know how many channels there are. */
+         if (channels.empty() && run.channels) {
+            auto format = QualityPrefs::SampleFormatChoice();
+            // libmad can glitch on the number of channels later; the first
+            // frame decides
+            numChannels = std::min(run.channels, 2u);
+            channels.resize(numChannels);
+            for (auto &channel : channels)
+               channel = trackFactory->NewWaveTrack(format, run.sampleRate);
+         }
 
-   mad_decoder_finish(&mDecoder);
+         for (unsigned chn = 0; chn < numChannels; ++chn)
+            channels[chn]->Append((samplePtr)run.samples[chn].data(),
+               floatSample, run.samples[chn].size());
+      }
 
-   if (!res) {
-      /* failure */
-      /* wxPrintf("failure\n"); */
-      return (privateData.updateResult);
+      const auto done = first < nFrames ? index.offsets[first] : index.end;
+      updateResult = mProgress->Update(
+         (wxULongLong_t)(length * ScanShare + done * (1 - ScanShare)), length);
+      if (updateResult != ProgressResult::Success)
+         return updateResult;
    }
 
+   if (channels.empty())
+      /* failure */
+      return updateResult;
+
    /* success */
-   /* wxPrintf("success\n"); */
 
       /* copy the WaveTrack pointers into the Track pointer list that
        * we are expected to fill */
-   for(const auto &channel : privateData.channels) {
+   for(const auto &channel : channels) {
       channel->Flush();
    }
-   if (!privateData.channels.empty())
-      outTracks.push_back(std::move(privateData.channels));
+   outTracks.push_back(std::move(channels));
 
    /* Read in any metadata */
    ImportID3(tags);
 
-   return privateData.updateResult;
+   return updateResult;
 }
 
 static Importer::RegisteredImportPlugin registered{ "MP3",
@@ -390,164 +675,4 @@ void MP3ImportFileHandle::ImportID3(Tags *tags)
 #endif // ifdef USE_LIBID3TAG
 }
 
-//
-//   MAD Callbacks
-//
-
-/* The input callback is called when the decoder wants more data. */
-
-enum mad_flow input_cb(void *_data, struct mad_stream *stream)
-{
-   struct private_data *data = (struct private_data *)_data;
-
-   data->updateResult = data->progress->Update((wxULongLong_t)data->file->Tell(),
-                                             (wxULongLong_t)data->file->Length() != 0 ?
-                                             (wxULongLong_t)data->file->Length() : 1);
-   if(data->updateResult != ProgressResult::Success)
-      return MAD_FLOW_STOP;
-
-   if (data->eof) {
-      /* different from data->File->Eof(), this means the underlying
-         file has reached eof *and* we have subsequently supplied the
-         final padding zeros */
-      return MAD_FLOW_STOP;
-   }
-
-#ifdef USE_LIBID3TAG
-   if (!data->id3checked) {
-      data->file->Read(data->inputBuffer.get(), ID3_TAG_QUERYSIZE);
-      int len = id3_tag_query(data->inputBuffer.get(), ID3_TAG_QUERYSIZE);
-      if (len > 0) {
-         data->file->Seek(len, wxFromStart);
-      }
-      else {
-         data->file->Seek(0);
-      }
-
-      data->id3checked = true;
-   }
-#endif
-
-   /* "Each time you refill your buffer, you need to preserve the data in
-    *  your existing buffer from stream.next_frame to the end.
-    *
-    *  This usually amounts to calling memmove() on this unconsumed portion
-    *  of the buffer and appending NEW data after it, before calling
-    *  mad_stream_buffer()"
-    *           -- Rob Leslie, on the mad-dev mailing list */
-
-   int unconsumedBytes;
-   if(stream->next_frame ) {
-      /* we must use inputBufferFill instead of INPUT_BUFFER_SIZE here
-         because the final buffer of the file may be only partially
-         filled, and we would otherwise be providing too much input
-         after eof */
-      unconsumedBytes = data->inputBuffer.get() + data->inputBufferFill
-         - stream->next_frame;
-      if (unconsumedBytes > 0)
-         memmove(data->inputBuffer.get(), stream->next_frame, unconsumedBytes);
-   }
-   else
-      unconsumedBytes = 0;
-
-   if (data->file->Eof() &&
-       (unconsumedBytes + MAD_BUFFER_GUARD < INPUT_BUFFER_SIZE)) {
-       
-      /* supply the requisite MAD_BUFFER_GUARD zero bytes to ensure
-         the final frame gets decoded properly, then finish */
-       
-      memset(data->inputBuffer.get() + unconsumedBytes, 0, MAD_BUFFER_GUARD);
-      mad_stream_buffer
-          (stream, data->inputBuffer.get(), MAD_BUFFER_GUARD + unconsumedBytes);
-      
-      data->eof = true; /* so on next call, we will tell mad to stop */
-      
-      return MAD_FLOW_CONTINUE;
-   }
-
-   off_t read = data->file->Read(data->inputBuffer.get() + unconsumedBytes,
-                                 INPUT_BUFFER_SIZE - unconsumedBytes);
-
-   mad_stream_buffer(stream, data->inputBuffer.get(), read + unconsumedBytes);
-
-   data->inputBufferFill = int(read + unconsumedBytes);
-
-   return MAD_FLOW_CONTINUE;
-}
-
-/* The output callback is called every time the decoder has finished decoding
- * a frame, allowing us to use the decoded data */
-
-enum mad_flow output_cb(void *_data,
-                        struct mad_header const * WXUNUSED(header),
-                        struct mad_pcm *pcm)
-{
-   // Don't C++ exceptions propagate through mad
-   return GuardedCall< mad_flow > ( [&] {
-      int samplerate;
-      struct private_data *data = (struct private_data *)_data;
-
-      samplerate= pcm->samplerate;
-      auto channels  = pcm->channels;
-      const auto samples   = pcm->length;
-
-      /* If this is the first run, we need to create the WaveTracks that
-       * will hold the data.  We do this now because now is the first
-       * moment when we know how many channels there are. */
-
-      if(data->channels.empty()) {
-         data->channels.resize(channels);
-
-         auto format = QualityPrefs::SampleFormatChoice();
-
-         for(auto &channel: data->channels)
-            channel = data->trackFactory->NewWaveTrack(format, samplerate);
-
-         data->numChannels = channels;
-      }
-      else {
-         // This is not the first run, protect us from libmad glitching
-         // on the number of channels
-         channels = data->numChannels;
-      }
-
-      /* TODO: get rid of this by adding fixed-point support to SampleFormat.
-       * For now, we allocate temporary float buffers to convert the fixed
-       * point samples into something we can feed to the WaveTrack.  Allocating
-       * big blocks of data like this isn't a great idea, but it's temporary.
-       */
-      FloatBuffers channelBuffers{ channels, samples };
-      for(size_t smpl = 0; smpl < samples; smpl++)
-         for(int chn = 0; chn < channels; chn++)
-            channelBuffers[chn][smpl] = scale(pcm->samples[chn][smpl]);
-
-      for(int chn = 0; chn < channels; chn++)
-         data->channels[chn]->Append((samplePtr)channelBuffers[chn].get(),
-                                     floatSample,
-                                     samples);
-
-      return MAD_FLOW_CONTINUE;
-   }, MakeSimpleGuard(MAD_FLOW_BREAK) );
-}
-
-enum mad_flow error_cb(void * WXUNUSED(_data), struct mad_stream * WXUNUSED(stream),
-                       struct mad_frame * WXUNUSED(frame))
-{
-/* enum mad_flow {
-     MAD_FLOW_CONTINUE = 0x0000,
-     MAD_FLOW_STOP     = 0x0010,
-     MAD_FLOW_BREAK    = 0x0011,
-     MAD_FLOW_IGNORE   = 0x0020
-   }; */
-   /*
-   wxPrintf("decoding error 0x%04x (%s)\n",
-      stream->error, mad_stream_errorstr(stream));
-   */
-
-   return MAD_FLOW_CONTINUE;
-
-   /* return MAD_FLOW_BREAK; */
-}
-
-
 #endif                          /* defined(USE_LIBMAD) */
@@ -74,9 +74,36 @@ static Importer::RegisteredUnusableImportPlugin registered{
 
 #include <vorbis/vorbisfile.h>
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
 
+namespace {
+
+// Samples per channel in each run decoded ahead, and how many runs may wait
+// to be appended
+const size_t SamplesPerRun = 65536;
+const size_t MaxQueuedRuns = 8;
+
+/// Samples of one logical bitstream, decoded ahead of appending
+struct DecodedRun
+{
+   int bitstream{ -1 };
+   size_t length{ 0 };
+   std::vector< std::vector<float> > channels;
+   // Where decoding was after the run, for progress
+   double time{ 0 };
+   double totalTime{ 0 };
+};
+
+}
+
 class OggImportPlugin final : public ImportPlugin
 {
 public:
@@ -126,6 +153,7 @@ public:
    ByteCount GetFileUncompressedBytes() override;
    ProgressResult Import(TrackFactory *trackFactory, TrackHolders &outTracks,
               Tags *tags) override;
+   bool CanImportConcurrently() override { return true; }
 
    wxInt32 GetStreamCount() override
    {
@@ -263,91 +291,159 @@ ProgressResult OggImportFileHandle::Import(
          channel = trackFactory->NewWaveTrack(mFormat, vi->rate);
    }
 
-   /* The number of bytes to get from the codec in each run */
-#define CODEC_TRANSFER_SIZE 4096u
-
    /* The number of samples to read between calls to the callback.
     * Balance between responsiveness of the GUI and throughput of import. */
 #define SAMPLES_PER_CALLBACK 100000
 
-   auto updateResult = ProgressResult::Success;
-   long bytesRead = 0;
-   {
-      ArrayOf<short> mainBuffer{ CODEC_TRANSFER_SIZE };
+   // You would think that the stream would already be seeked to 0, and
+   // indeed it is if the file is legit.  But I had several ogg files on
+   // my hard drive that have malformed headers, and this added call
+   // causes them to be read correctly.  Otherwise they have lots of
+   // zeros inserted at the beginning
+   ov_pcm_seek(mVorbisFile.get(), 0);
+
+   // Decode on a thread of its own, a few runs ahead of the appending here.
+   // Only that thread uses mVorbisFile until it is joined.
+   std::mutex mutex;
+   std::condition_variable condition;
+   std::deque<DecodedRun> runs;
+   bool finished = false;
+   bool stopping = false;
+   long readError = 0;
+   std::exception_ptr exception;
+
+   const auto vorbisFile = mVorbisFile.get();
+   auto decode = [&]{
+      try {
+         DecodedRun run;
+         // Returns false if appending has stopped
+         auto push = [&]{
+            if (run.length == 0)
+               return true;
+            run.time = ov_time_tell(vorbisFile);
+            run.totalTime = ov_time_total(vorbisFile, run.bitstream);
+            {
+               std::unique_lock<std::mutex> lock{ mutex };
+               condition.wait(lock, [&]{
+                  return stopping || runs.size() < MaxQueuedRuns; });
+               if (stopping)
+                  return false;
+               runs.push_back(std::move(run));
+            }
+            condition.notify_all();
+            run = DecodedRun{};
+            return true;
+         };
+
+         while (true) {
+            float **pcm = nullptr;
+            int bitstream = 0;
+            /* get data from the decoder */
+            const long samplesRead = ov_read_float(vorbisFile, &pcm,
+               SamplesPerRun, &bitstream);
+
+            if (samplesRead == OV_HOLE) {
+               wxFileName ff(mFilename);
+               wxLogError(wxT("Ogg Vorbis importer: file %s is malformed, ov_read() reported a hole"),
+                  ff.GetFullName());
+               /* http://lists.xiph.org/pipermail/vorbis-dev/2001-February/003223.html
+                * is the justification for doing this - best effort for malformed file,
+                * hence the message.
+                */
+               continue;
+            }
+            else if (samplesRead < 0) {
+               /* Malformed Ogg Vorbis file. */
+               /* TODO: Return some sort of meaningful error. */
+               wxLogError(wxT("Ogg Vorbis importer: ov_read() returned error %i"),
+                  samplesRead);
+               readError = samplesRead;
+               break;
+            }
+            else if (samplesRead == 0)
+               break;
+
+            // The samples are valid only until the next call, so copy them
+            // into the run, starting another at a new bitstream
+            if (bitstream != run.bitstream && !push())
+               return;
+            if (run.bitstream != bitstream) {
+               run.bitstream = bitstream;
+               run.channels.resize(vorbisFile->vi[bitstream].channels);
+            }
+            for (size_t c = 0; c < run.channels.size(); ++c)
+               run.channels[c].insert(run.channels[c].end(),
+                  pcm[c], pcm[c] + samplesRead);
+            run.length += samplesRead;
 
-      /* determine endianness (clever trick courtesy of Nicholas Devillard,
-       * (http://www.eso.org/~ndevilla/endian/) */
-      int testvar = 1, endian;
-      if (*(char *)&testvar)
-         endian = 0;  // little endian
-      else
-         endian = 1;  // big endian
-
-      /* number of samples currently in each channel's buffer */
-      long samplesRead = 0;
-      int bitstream = 0;
-      int samplesSinceLastCallback = 0;
-
-      // You would think that the stream would already be seeked to 0, and
-      // indeed it is if the file is legit.  But I had several ogg files on
-      // my hard drive that have malformed headers, and this added call
-      // causes them to be read correctly.  Otherwise they have lots of
-      // zeros inserted at the beginning
-      ov_pcm_seek(mVorbisFile.get(), 0);
-
-      do {
-         /* get data from the decoder */
-         bytesRead = ov_read(mVorbisFile.get(), (char *)mainBuffer.get(),
-            CODEC_TRANSFER_SIZE,
-            endian,
-            2,    // word length (2 for 16 bit samples)
-            1,    // signed
-            &bitstream);
-
-         if (bytesRead == OV_HOLE) {
-            wxFileName ff(mFilename);
-            wxLogError(wxT("Ogg Vorbis importer: file %s is malformed, ov_read() reported a hole"),
-               ff.GetFullName());
-            /* http://lists.xiph.org/pipermail/vorbis-dev/2001-February/003223.html
-             * is the justification for doing this - best effort for malformed file,
-             * hence the message.
-             */
-            continue;
+            if (run.length >= SamplesPerRun && !push())
+               return;
          }
-         else if (bytesRead < 0) {
-            /* Malformed Ogg Vorbis file. */
-            /* TODO: Return some sort of meaningful error. */
-            wxLogError(wxT("Ogg Vorbis importer: ov_read() returned error %i"),
-               bytesRead);
+         push();
+      }
+      catch (...) {
+         std::lock_guard<std::mutex> lock{ mutex };
+         exception = std::current_exception();
+      }
+      {
+         std::lock_guard<std::mutex> lock{ mutex };
+         finished = true;
+      }
+      condition.notify_all();
+   };
+
+   std::thread thread{ decode };
+   auto joinThread = [&]{
+      {
+         std::lock_guard<std::mutex> lock{ mutex };
+         stopping = true;
+      }
+      condition.notify_all();
+      if (thread.joinable())
+         thread.join();
+   };
+   auto cleanup = finally(joinThread);
+
+   auto updateResult = ProgressResult::Success;
+   int samplesSinceLastCallback = 0;
+   while (updateResult == ProgressResult::Success) {
+      DecodedRun run;
+      {
+         std::unique_lock<std::mutex> lock{ mutex };
+         condition.wait(lock, [&]{ return finished || !runs.empty(); });
+         if (runs.empty())
             break;
-         }
+         run = std::move(runs.front());
+         runs.pop_front();
+      }
+      condition.notify_all();
 
-         samplesRead = bytesRead / mVorbisFile->vi[bitstream].channels / sizeof(short);
-
-         /* give the data to the wavetracks */
-         auto iter = mChannels.begin();
-         std::advance(iter, bitstream);
-         if (mStreamUsage[bitstream] != 0)
-         {
-            auto iter2 = iter->begin();
-            for (int c = 0; c < mVorbisFile->vi[bitstream].channels; ++iter2, ++c)
-               iter2->get()->Append((char *)(mainBuffer.get() + c),
-               int16Sample,
-               samplesRead,
-               mVorbisFile->vi[bitstream].channels);
-         }
+      /* give the data to the wavetracks */
+      auto iter = mChannels.begin();
+      std::advance(iter, run.bitstream);
+      if (mStreamUsage[run.bitstream] != 0)
+      {
+         auto iter2 = iter->begin();
+         for (size_t c = 0; c < run.channels.size() && iter2 != iter->end();
+              ++iter2, ++c)
+            iter2->get()->Append((samplePtr)run.channels[c].data(),
+               floatSample,
+               run.length);
+      }
 
-         samplesSinceLastCallback += samplesRead;
-         if (samplesSinceLastCallback > SAMPLES_PER_CALLBACK) {
-            updateResult = mProgress->Update(ov_time_tell(mVorbisFile.get()),
-               ov_time_total(mVorbisFile.get(), bitstream));
-            samplesSinceLastCallback -= SAMPLES_PER_CALLBACK;
-         }
-      } while (updateResult == ProgressResult::Success && bytesRead != 0);
+      samplesSinceLastCallback += run.length;
+      if (samplesSinceLastCallback > SAMPLES_PER_CALLBACK) {
+         updateResult = UpdateProgress(run.time, run.totalTime);
+         samplesSinceLastCallback -= SAMPLES_PER_CALLBACK;
+      }
    }
 
+   joinThread();
+   if (exception)
+      std::rethrow_exception(exception);
+
    auto res = updateResult;
-   if (bytesRead < 0)
+   if (readError < 0)
      res = ProgressResult::Failed;
 
    if (res == ProgressResult::Failed || res == ProgressResult::Cancelled) {
@@ -60,6 +60,9 @@
 #include "ImportPlugin.h"
 
 #include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
 
 #ifdef USE_LIBID3TAG
    #include <id3tag.h>
@@ -102,6 +105,7 @@ public:
    ByteCount GetFileUncompressedBytes() override;
    ProgressResult Import(TrackFactory *trackFactory, TrackHolders &outTracks,
               Tags *tags) override;
+   bool CanImportConcurrently() override;
 
    wxInt32 GetStreamCount() override { return 1; }
 
@@ -397,6 +401,16 @@ static wxString AskCopyOrEdit()
 }
 #endif
 
+bool PCMImportFileHandle::CanImportConcurrently()
+{
+#ifdef EXPERIMENTAL_OD_DATA
+   // Import() may ask whether to copy the file or edit it in place
+   return false;
+#else
+   return true;
+#endif
+}
+
 #ifdef USE_LIBID3TAG
 struct id3_tag_deleter {
    void operator () (id3_tag *p) const { if (p) id3_tag_delete(p); }
@@ -480,7 +494,7 @@ ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
             );
 
          if (++updateCounter == 50) {
-            updateResult = mProgress->Update(
+            updateResult = UpdateProgress(
                i.as_long_long(),
                fileTotalFrames.as_long_long()
             );
@@ -491,7 +505,7 @@ ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
       }
 
       // One last update for completion
-      updateResult = mProgress->Update(
+      updateResult = UpdateProgress(
          fileTotalFrames.as_long_long(),
          fileTotalFrames.as_long_long()
       );
@@ -534,25 +548,66 @@ ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
       if (maxBlock < 1)
          return ProgressResult::Failed;
 
-      SampleBuffer srcbuffer, buffer;
+      // Read as short or float; 24 bit int is imported as float and the
+      // append function converts it.  This is how PCMAliasBlockFile works
+      // too.
+      const auto readFormat =
+         (mFormat == int16Sample) ? int16Sample : floatSample;
+
+      // The channels are independent, so their appends, which compute the
+      // summaries of the new blocks and write them, go to worker threads,
+      // while the next block is read
+      const unsigned nThreads = unsigned( std::min<size_t>(mInfo.channels,
+         std::max(1u, std::thread::hardware_concurrency())) );
+      // Each block is appended from one set of channel buffers while the
+      // next is read into the other, so at most one block is in flight
+      const int nSets = (nThreads > 1) ? 2 : 1;
+
+      // One buffer for each channel, so that all are separated in one pass
+      SampleBuffer srcbuffer;
+      std::vector<SampleBuffer> buffers(nSets * mInfo.channels);
+      std::vector<samplePtr> bufferPtrs(nSets * mInfo.channels);
       wxASSERT(mInfo.channels >= 0);
-      while (NULL == srcbuffer.Allocate(maxBlock * mInfo.channels, mFormat).ptr() ||
-             NULL == buffer.Allocate(maxBlock, mFormat).ptr())
+      while (NULL == srcbuffer.Allocate(maxBlock * mInfo.channels, readFormat).ptr() ||
+             std::any_of(buffers.begin(), buffers.end(),
+                [&](SampleBuffer &buffer){
+                   return NULL == buffer.Allocate(maxBlock, readFormat).ptr(); }))
       {
          maxBlock /= 2;
          if (maxBlock < 1)
             return ProgressResult::Failed;
       }
+      for (size_t ii = 0; ii < buffers.size(); ++ii)
+         bufferPtrs[ii] = buffers[ii].ptr();
+
+      std::vector<std::thread> threads;
+      std::vector<std::exception_ptr> errors(nThreads);
+      const auto joinThreads = [&]{
+         for (auto &thread : threads)
+            thread.join();
+         threads.clear();
+      };
+      // Don't leave the workers running if an exception escapes
+      auto cleanup = finally(joinThreads);
+      const auto finishAppends = [&]{
+         joinThreads();
+         for (auto &error : errors)
+            if (error) {
+               auto copy = error;
+               error = nullptr;
+               std::rethrow_exception(copy);
+            }
+      };
 
       decltype(fileTotalFrames) framescompleted = 0;
 
       long block;
+      int set = 0;
       do {
          block = maxBlock;
 
-         if (mFormat == int16Sample)
+         if (readFormat == int16Sample)
             block = SFCall<sf_count_t>(sf_readf_short, mFile.get(), (short *)srcbuffer.ptr(), block);
-         //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile works too.
          else
             block = SFCall<sf_count_t>(sf_readf_float, mFile.get(), (float *)srcbuffer.ptr(), block);
 
@@ -562,25 +617,34 @@ ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
          }
 
          if (block) {
-            auto iter = channels.begin();
-            for(int c=0; c<mInfo.channels; ++iter, ++c) {
-               if (mFormat==int16Sample) {
-                  for(int j=0; j<block; j++)
-                     ((short *)buffer.ptr())[j] =
-                        ((short *)srcbuffer.ptr())[mInfo.channels*j+c];
-               }
-               else {
-                  for(int j=0; j<block; j++)
-                     ((float *)buffer.ptr())[j] =
-                        ((float *)srcbuffer.ptr())[mInfo.channels*j+c];
-               }
-
-               iter->get()->Append(buffer.ptr(), (mFormat == int16Sample)?int16Sample:floatSample, block);
+            const auto ptrs = &bufferPtrs[set * mInfo.channels];
+            DeinterleaveSamples(srcbuffer.ptr(), readFormat, mInfo.channels,
+               ptrs, mInfo.channels, block);
+
+            // Appends of the previous block must finish first, to keep each
+            // track's blocks in order
+            finishAppends();
+
+            if (nThreads > 1) {
+               const size_t len = block;
+               for (unsigned ii = 0; ii < nThreads; ++ii)
+                  threads.emplace_back([&, ii, ptrs, len]{
+                     try {
+                        for (int c = mInfo.channels * ii / nThreads,
+                             end = mInfo.channels * (ii + 1) / nThreads;
+                             c < end; ++c)
+                           channels[c]->Append(ptrs[c], readFormat, len);
+                     }
+                     catch (...) { errors[ii] = std::current_exception(); }
+                  });
+               set = (set + 1) % nSets;
             }
+            else
+               channels[0]->Append(ptrs[0], readFormat, block);
             framescompleted += block;
          }
 
-         updateResult = mProgress->Update(
+         updateResult = UpdateProgress(
             framescompleted.as_long_long(),
             fileTotalFrames.as_long_long()
          );
@@ -588,6 +652,8 @@ ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
             break;
 
       } while (block > 0);
+
+      finishAppends();
    }
 
    if (updateResult == ProgressResult::Failed || updateResult == ProgressResult::Cancelled) {
@@ -50,6 +50,9 @@ but little else.
 #include "audacity/Types.h"
 #include "../Internat.h"
 
+#include <atomic>
+#include <mutex>
+
 #include "ImportRaw.h" // defines TrackHolders
 
 class AudacityProject;
@@ -109,6 +112,52 @@ protected:
 };
 
 
+/// \brief Lets ImportFileHandle::Import() run on a worker thread, as
+/// ProjectFileManager::ImportFiles() does for handles that
+/// CanImportConcurrently().
+///
+/// While one is installed on a thread by a Scope, the handle shows no
+/// progress dialog but reports here, and all of its work up to the first
+/// progress update holds the setup mutex, so that making tracks and reading
+/// preferences are never done by two imports at once.
+class AUDACITY_DLL_API ConcurrentImport
+{
+public:
+   explicit ConcurrentImport(std::mutex &setupMutex);
+
+   class AUDACITY_DLL_API Scope
+   {
+   public:
+      /// Installs concurrentImport for this thread, taking the setup mutex
+      explicit Scope( ConcurrentImport &concurrentImport );
+      ~Scope();
+      Scope( const Scope& ) = delete;
+      Scope &operator=( const Scope& ) = delete;
+   private:
+      ConcurrentImport &mImport;
+   };
+
+   /// The object installed for this thread, or null
+   static ConcurrentImport *Current();
+
+   /// How much of the import is done, from 0 to 1; from any thread
+   double GetFraction() const { return mFraction.load(); }
+
+   /// Make the import stop or cancel at its next progress update; from any
+   /// thread
+   void Request(ProgressResult result);
+
+   // For ImportFileHandle
+   ProgressResult Update(double current, double total);
+
+private:
+   void EndSetup();
+
+   std::unique_lock<std::mutex> mSetupLock;
+   std::atomic<double> mFraction{ 0.0 };
+   std::atomic<unsigned> mRequest;
+};
+
 class ImportFileHandle /* not final */
 {
 public:
@@ -142,6 +191,11 @@ public:
    virtual ProgressResult Import(TrackFactory *trackFactory, TrackHolders &outTracks,
                       Tags *tags) = 0;
 
+   // Whether Import() may run on a worker thread, under a
+   // ConcurrentImport::Scope.  Such importers report progress only
+   // through UpdateProgress(), and ask nothing of the user.
+   virtual bool CanImportConcurrently();
+
    // Return number of elements in stream list
    virtual wxInt32 GetStreamCount() = 0;
 
@@ -152,6 +206,10 @@ public:
    virtual void SetStreamUsage(wxInt32 StreamID, bool Use) = 0;
 
 protected:
+   // Update the dialog made by CreateProgress(), or, in a concurrent import,
+   // report to the ConcurrentImport
+   ProgressResult UpdateProgress(double current, double total);
+
    FilePath mFilename;
    std::unique_ptr<ProgressDialog> mProgress;
 };
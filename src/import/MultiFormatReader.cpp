@@ -39,6 +39,9 @@ MachineEndianness::MachineEndianness()
 
 MultiFormatReader::MultiFormatReader(const char* filename)
    : mpFid(NULL)
+   , mpData(NULL)
+   , mDataSize(0)
+   , mDataPos(0)
 {
    mpFid = fopen(filename, "rb");
       
@@ -48,6 +51,14 @@ MultiFormatReader::MultiFormatReader(const char* filename)
    }
 }
 
+MultiFormatReader::MultiFormatReader(const uint8_t* data, size_t size)
+   : mpFid(NULL)
+   , mpData(data)
+   , mDataSize(size)
+   , mDataPos(0)
+{
+}
+
 MultiFormatReader::~MultiFormatReader()
 {
    if (mpFid != NULL)
@@ -62,6 +73,7 @@ void MultiFormatReader::Reset()
    {
       rewind(mpFid);
    }
+   mDataPos = 0;
 }
 
 size_t MultiFormatReader::ReadSamples(void* buffer, size_t len,
@@ -112,7 +124,21 @@ size_t MultiFormatReader::Read(void* buffer, size_t size, size_t len, size_t str
    size_t actRead = 0;
    uint8_t* pWork = (uint8_t*) buffer;
    
-   if (stride > 1)
+   if (mpFid == NULL)
+   {
+      // Read from memory, skipping the gaps as fseek would
+      for (size_t n = 0; n < len; n++)
+      {
+         if (mDataPos >= mDataSize || mDataSize - mDataPos < size)
+         {
+            break;
+         }
+         memcpy(&(pWork[n*size]), &(mpData[mDataPos]), size);
+         actRead++;
+         mDataPos += stride * size;
+      }
+   }
+   else if (stride > 1)
    {
       // There are gaps between consecutive samples,
       // so do a scattered read
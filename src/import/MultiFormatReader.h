@@ -49,6 +49,10 @@ private:
 class MultiFormatReader
 {
    FILE* mpFid;   
+   // Instead of the file, the reader may read from memory that it does not own
+   const uint8_t* mpData;
+   size_t mDataSize;
+   size_t mDataPos;
    MachineEndianness mEnd;
    uint8_t mSwapBuffer[8];
 
@@ -66,6 +70,9 @@ public:
    } FormatT;
    
    MultiFormatReader(const char* filename);
+   /// Read the given bytes, like the contents of a file; they must outlive
+   /// the reader
+   MultiFormatReader(const uint8_t* data, size_t size);
    ~MultiFormatReader();
 
    void Reset();
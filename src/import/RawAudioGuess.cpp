@@ -23,6 +23,12 @@
 #include <string.h>
 #include <math.h>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
 #include <wx/defs.h>
 #include <wx/ffile.h>
 
@@ -286,6 +292,79 @@ static void Extract(bool bits16,
    *len2 = dataCount2;
 }
 
+namespace {
+struct FloatCandidate
+{
+   unsigned prec;
+   int endian;
+   size_t offset;
+
+   unsigned finiteVotes;
+   unsigned maxminVotes;
+   float smoothAvg;
+};
+}
+
+// Count the votes of the tests for one candidate floating-point format
+static void ScoreFloatFormat(FloatCandidate &candidate,
+                             unsigned numTests, const ArrayOf<char> rawData[],
+                             size_t dataSize, float *data1, float *data2)
+{
+   size_t len1;
+   size_t len2;
+   unsigned finiteVotes = 0;
+   unsigned maxminVotes = 0;
+   float smoothAvg = 0;
+
+   for(unsigned test = 0; test < numTests; test++) {
+      float min, max;
+
+      ExtractFloats(candidate.prec == 1, candidate.endian == 1,
+                    true, /* stereo */
+                    candidate.offset,
+                    rawData[test].get(), dataSize,
+                    data1, data2, &len1, &len2);
+
+      size_t i = 0;
+      for(; i < len1; i++)
+         // This code is testing for NaNs.
+         // We'd like to know if all data is finite.
+         if (!(data1[i]>=0 || data1[i]<=0) ||
+             !(data2[i]>=0 || data2[i]<=0))
+            break;
+      if (i == len1)
+         // all data is finite.
+         finiteVotes++;
+
+      min = data1[0];
+      max = data1[0];
+      for(i = 1; i < len1; i++) {
+         if (data1[i]<min)
+            min = data1[i];
+         if (data1[i]>max)
+            max = data1[i];
+      }
+      for(i = 1; i < len2; i++) {
+         if (data2[i]<min)
+            min = data2[i];
+         if (data2[i]>max)
+            max = data2[i];
+      }
+
+      if (min < -0.01 && min >= -100000 &&
+          max > 0.01 && max <= 100000)
+         maxminVotes++;
+
+      smoothAvg += SecondDStat(data1, len1) / max;
+   }
+
+   smoothAvg /= numTests;
+
+   candidate.finiteVotes = finiteVotes;
+   candidate.maxminVotes = maxminVotes;
+   candidate.smoothAvg = smoothAvg;
+}
+
 static int GuessFloatFormats(unsigned numTests, const ArrayOf<char> rawData[], size_t dataSize,
                              size_t *out_offset, unsigned *out_channels)
 {
@@ -324,81 +403,75 @@ static int GuessFloatFormats(unsigned numTests, const ArrayOf<char> rawData[], s
     * because big-endian floats actually still look and act
     * like floats when you interpret them as little-endian
     * floats with a 1-byte offset.
+    *
+    * The candidates are independent, so they are scored on
+    * several threads, each with its own buffers; then the best
+    * is chosen in the same order as before.
     */
 
-   for(unsigned int prec = 0; prec < 2; prec++) {
-      for(int endian = 0; endian < 2; endian++) {
-         for(size_t offset = 0; offset < (4 * prec + 4); offset++) {
-            unsigned finiteVotes = 0;
-            unsigned maxminVotes = 0;
-            float smoothAvg = 0;
-
-           #if RAW_GUESS_DEBUG
-            wxFprintf(af, "prec=%d endian=%d offset=%d\n",
-                    prec, endian, (int)offset);
-           #endif
-
-            for(unsigned test = 0; test < numTests; test++) {
-               float min, max;
-
-               ExtractFloats(prec == 1, endian == 1,
-                             true, /* stereo */
-                             offset,
-                             rawData[test].get(), dataSize,
-                             data1.get(), data2.get(), &len1, &len2);
-
-               size_t i = 0;
-               for(; i < len1; i++)
-                  // This code is testing for NaNs.
-                  // We'd like to know if all data is finite.
-                  if (!(data1[i]>=0 || data1[i]<=0) ||
-                      !(data2[i]>=0 || data2[i]<=0))
-                     break;
-               if (i == len1)
-                  // all data is finite.
-                  finiteVotes++;
-
-               min = data1[0];
-               max = data1[0];
-               for(i = 1; i < len1; i++) {
-                  if (data1[i]<min)
-                     min = data1[i];
-                  if (data1[i]>max)
-                     max = data1[i];
+   std::vector<FloatCandidate> candidates;
+   for(unsigned int prec = 0; prec < 2; prec++)
+      for(int endian = 0; endian < 2; endian++)
+         for(size_t offset = 0; offset < (4 * prec + 4); offset++)
+            candidates.push_back({ prec, endian, offset, 0, 0, 0 });
+
+   const unsigned nThreads = unsigned( std::min<size_t>(candidates.size(),
+      std::max(1u, std::thread::hardware_concurrency())) );
+   if (nThreads <= 1) {
+      for (auto &candidate : candidates)
+         ScoreFloatFormat(candidate, numTests, rawData, dataSize,
+                          data1.get(), data2.get());
+   }
+   else {
+      std::atomic<size_t> next{ 0 };
+      std::vector<std::exception_ptr> errors(nThreads);
+      {
+         std::vector<std::thread> threads;
+         auto cleanup = finally([&]{
+            for (auto &thread : threads)
+               thread.join();
+         });
+         for (unsigned ii = 0; ii < nThreads; ii++)
+            threads.emplace_back([&, ii]{
+               try {
+                  ArrayOf<float> buffer1{ dataSize + 4 };
+                  ArrayOf<float> buffer2{ dataSize + 4 };
+                  for (size_t jj; (jj = next++) < candidates.size();)
+                     ScoreFloatFormat(candidates[jj], numTests, rawData,
+                                      dataSize, buffer1.get(), buffer2.get());
                }
-               for(i = 1; i < len2; i++) {
-                  if (data2[i]<min)
-                     min = data2[i];
-                  if (data2[i]>max)
-                     max = data2[i];
+               catch (...) {
+                  errors[ii] = std::current_exception();
                }
+            });
+      }
+      for (auto &error : errors)
+         if (error)
+            std::rethrow_exception(error);
+   }
 
-               if (min < -0.01 && min >= -100000 &&
-                   max > 0.01 && max <= 100000)
-                  maxminVotes++;
-
-               smoothAvg += SecondDStat(data1.get(), len1) / max;
-            }
-
-            smoothAvg /= numTests;
+   for (const auto &candidate : candidates) {
+      const auto finiteVotes = candidate.finiteVotes;
+      const auto maxminVotes = candidate.maxminVotes;
+      const auto smoothAvg = candidate.smoothAvg;
 
-           #if RAW_GUESS_DEBUG
-            wxFprintf(af, "finite: %ud/%ud maxmin: %ud/%ud smooth: %f\n",
-                    finiteVotes, numTests, maxminVotes, numTests,
-                    smoothAvg);
-           #endif
+     #if RAW_GUESS_DEBUG
+      wxFprintf(af, "prec=%d endian=%d offset=%d\n",
+              candidate.prec, candidate.endian, (int)candidate.offset);
+      wxFprintf(af, "finite: %ud/%ud maxmin: %ud/%ud smooth: %f\n",
+              finiteVotes, numTests, maxminVotes, numTests,
+              smoothAvg);
+     #endif
 
-            if (finiteVotes > numTests/2 &&
-                finiteVotes > numTests-2 &&
-                maxminVotes > numTests/2 &&
-                smoothAvg < bestSmoothAvg) {
+      if (finiteVotes > numTests/2 &&
+          finiteVotes > numTests-2 &&
+          maxminVotes > numTests/2 &&
+          smoothAvg < bestSmoothAvg) {
 
-               bestSmoothAvg = smoothAvg;
-               bestOffset = offset;
-               bestPrec = prec;
-               bestEndian = endian;
-            }
-         }
+         bestSmoothAvg = smoothAvg;
+         bestOffset = candidate.offset;
+         bestPrec = candidate.prec;
+         bestEndian = candidate.endian;
       }
    }
 
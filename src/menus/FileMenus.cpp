@@ -401,10 +401,10 @@ void OnImport(const CommandContext &context)
       wxString fileName = selectedFiles[ff];
 
       FileNames::UpdateDefaultPath(FileNames::Operation::Open, fileName);
-
-      ProjectFileManager::Get( project ).Import(fileName);
    }
 
+   ProjectFileManager::Get( project ).ImportFiles(selectedFiles);
+
    window.ZoomAfterImport(nullptr);
 }
 
@@ -9,6 +9,7 @@
 #include "../AllThemeResources.h"
 #include "../AudacityLogger.h"
 #include "../AudioIOBase.h"
+#include "../BlockFileIOStats.h"
 #include "../CommonCommandFlags.h"
 #include "../CrashReport.h"
 #include "../Dependencies.h"
@@ -18,8 +19,11 @@
 #include "../Prefs.h"
 #include "../Project.h"
 #include "../ProjectSelectionManager.h"
+#include "../RealtimeSafety.h"
+#include "../RealtimeScheduling.h"
 #include "../ShuttleGui.h"
 #include "../SplashDialog.h"
+#include "../StartupTimer.h"
 #include "../Theme.h"
 #include "../commands/CommandContext.h"
 #include "../commands/CommandManager.h"
@@ -334,6 +338,9 @@ void OnAudioDeviceInfo(const CommandContext &context)
    auto &project = context.project;
    auto gAudioIO = AudioIOBase::Get();
    wxString info = gAudioIO->GetDeviceInfo();
+   info += gAudioIO->GetMetrics().Report();
+   info += RealtimeScheduling::Report();
+   info += RealtimeSafety::Report();
    ShowDiagnostics( project, info,
       XO("Audio Device Info"), wxT("deviceinfo.txt") );
 }
@@ -349,6 +356,20 @@ void OnMidiDeviceInfo(const CommandContext &context)
 }
 #endif
 
+void OnStartupTimes(const CommandContext &context)
+{
+   auto &project = context.project;
+   ShowDiagnostics( project, StartupTimer::Report(),
+      XO("Startup Times"), wxT("startuptimes.txt") );
+}
+
+void OnBlockFileIO(const CommandContext &context)
+{
+   auto &project = context.project;
+   ShowDiagnostics( project, BlockFileIOStats::Get().Report(),
+      XO("Block File I/O"), wxT("blockfileio.txt") );
+}
+
 void OnShowLog( const CommandContext &context )
 {
    auto logger = AudacityLogger::Get();
@@ -531,6 +552,10 @@ BaseItemSharedPtr HelpMenu()
                FN(OnMidiDeviceInfo),
                AudioIONotBusyFlag() ),
       #endif
+            Command( wxT("StartupTimes"), XXO("&Startup Times..."),
+               FN(OnStartupTimes), AlwaysEnabledFlag ),
+            Command( wxT("BlockFileIO"), XXO("&Block File I/O..."),
+               FN(OnBlockFileIO), AlwaysEnabledFlag ),
             Command( wxT("Log"), XXO("Show &Log..."), FN(OnShowLog),
                AlwaysEnabledFlag ),
       #if defined(EXPERIMENTAL_CRASH_REPORT)
@@ -1002,6 +1002,9 @@ BaseItemSharedPtr ExtraScriptablesIIMenu()
       Command( wxT("CompareAudio"), XXO("Compare Audio..."),
          FN(OnAudacityCommand),
          AudioIONotBusyFlag() ),
+      Command( wxT("GetAudioStats"), XXO("Get Audio Stats..."),
+         FN(OnAudacityCommand),
+         AudioIONotBusyFlag() ),
       // i18n-hint: Screenshot in the help menu has a much bigger dialog.
       Command( wxT("Screenshot"), XXO("Screenshot (short format)..."),
          FN(OnAudacityCommand),
@@ -802,18 +802,22 @@ void OnResample(const CommandContext &context)
 
    int ndx = 0;
    auto flags = UndoPush::AUTOSAVE;
-   for (auto wt : tracks.Selected< WaveTrack >())
+   for (auto leader : tracks.SelectedLeaders< WaveTrack >())
    {
       auto msg = XO("Resampling track %d").Format( ++ndx );
 
       ProgressDialog progress(XO("Resample"), msg);
 
-      // The resampling of a track may be stopped by the user.  This might
-      // leave a track with multiple clips in a partially resampled state.
-      // But the thrown exception will cause rollback in the application
-      // level handler.
+      // The resampling of a track may be stopped by the user.  The clips
+      // of its selected channels are then left unchanged, and the thrown
+      // exception will cause rollback in the application level handler.
 
-       wt->Resample(newRate, &progress);
+      // Resample the selected channels together, in parallel
+      std::vector< WaveTrack* > channels;
+      for (auto wt : TrackList::Channels( leader ))
+         if (wt->GetSelected())
+            channels.push_back( wt );
+      WaveTrack::Resample(channels, newRate, &progress);
 
       // Each time a track is successfully, completely resampled,
       // commit that to the undo stack.  The second and later times,
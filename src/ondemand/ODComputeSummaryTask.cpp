@@ -294,4 +294,7 @@ void ODComputeSummaryTask::OrderBlockFiles
          // Let it be deleted and forget about it.
       }
    }
+
+   //then blocks on screen go first
+   PrioritizeDemandedBlocks(mBlockFiles);
 }
@@ -244,6 +244,8 @@ void ODDecodeTask::OrderBlockFiles
       }
    }
 
+   //then blocks on screen, and of the play head's and the selection's regions, go first
+   PrioritizeDemandedBlocks(mBlockFiles);
 }
 
 
@@ -257,6 +259,14 @@ void ODDecodeTask::DemandTrackUpdate(WaveTrack* track, double seconds)
       ODTask::DemandTrackUpdate(track,seconds);
 }
 
+void ODDecodeTask::DemandTrackRange(
+   WaveTrack* track, DemandKind kind, double t0, double t1)
+{
+   //likewise, decoders that can't seek can only go in order
+   if(SeekingAllowed())
+      ODTask::DemandTrackRange(track,kind,t0,t1);
+}
+
 
 ///there could be the ODDecodeBlockFiles of several FLACs in one track (after copy and pasting)
 ///so we keep a list of decoders that keep track of the file names, etc, and check the blocks against them.
@@ -49,6 +49,8 @@ class ODDecodeTask /* not final */ : public ODTask
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    ///this is overridden from ODTask because certain classes don't allow users to seek sometimes, or not at all.
    void DemandTrackUpdate(WaveTrack* track, double seconds) override;
+   void DemandTrackRange(
+      WaveTrack* track, DemandKind kind, double t0, double t1) override;
 
    ///Return the task name
    const char* GetTaskName() override { return "ODDecodeTask"; }
@@ -21,6 +21,7 @@ ODTask requests and internals.
 #include "ODWaveTrackTaskQueue.h"
 #include "../Project.h"
 #include <NonGuiThread.h>
+#include <algorithm>
 #include <wx/utils.h>
 #include <wx/wx.h>
 #include <wx/thread.h>
@@ -34,13 +35,17 @@ ODTask requests and internals.
 class ODTaskThread {
  public:
    typedef int ExitCode;
-   ODTaskThread(ODTask* task);
+   ODTaskThread();
    /*ExitCode*/ void Entry();
    void Create() {}
    void Delete() {
       mDestroy = true;
       pthread_join(mThread, NULL);
    }
+   // Wait for the worker loop to exit; then the object can be deleted
+   void Wait() {
+      pthread_join(mThread, NULL);
+   }
    bool TestDestroy() { return mDestroy; }
    void Sleep(int ms) {
       struct timespec spec;
@@ -72,8 +77,6 @@ class ODTaskThread {
    int mPriority;
    bool mDestroy;
    pthread_t mThread;
-
-   ODTask* mTask;
 };
 
 #else
@@ -81,26 +84,24 @@ class ODTaskThread {
 class ODTaskThread final : public wxThread
 {
 public:
-   ///Constructs a ODTaskThread
-   ///@param task the task to be launched as an
-   ODTaskThread(ODTask* task);
+   ///Constructs a ODTaskThread, one of the pool of workers that the
+   ///ODManager keeps for the life of the application
+   ODTaskThread();
 
 
 protected:
-   ///Executes a part of the task
+   ///Executes parts of tasks until the ODManager terminates
    void* Entry() override;
-   ODTask* mTask;
 
 };
 
 #endif
 
-ODTaskThread::ODTaskThread(ODTask* task)
+ODTaskThread::ODTaskThread()
 #ifndef __WXMAC__
-: wxThread()
+: wxThread(wxTHREAD_JOINABLE)
 #endif
 {
-   mTask=task;
 #ifdef __WXMAC__
    mDestroy = false;
    mThread = NULL;
@@ -118,12 +119,18 @@ void *ODTaskThread::Entry()
 {
    //TODO: Figure out why this has no effect at all.
    //wxThread::This()->SetPriority( 40);
-   //Do at least 5 percent of the task
-   mTask->DoSome(0.05f);
+   auto pMan = ODManager::Instance();
+   while (auto task = pMan->WaitForTask())
+   {
+      //Do at least 5 percent of the task
+      task->DoSome(0.05f);
 
-   //release the thread count so that the ODManager knows how many active threads are alive.
-   ODManager::Instance()->DecrementCurrentThreads();
+      //release the thread count so that the ODManager knows how many active threads are alive.
+      pMan->DecrementCurrentThreads();
 
+      //let the manager loop see whether the task is complete
+      pMan->SignalTaskQueueLoop();
+   }
 
 #ifndef __WXMAC__
    return NULL;
@@ -164,6 +171,7 @@ ODManager::ODManager()
 
    //must set up the queue condition
    mQueueNotEmptyCond = std::make_unique<ODCondition>(&mQueueNotEmptyCondLock);
+   mTasksAvailableCond = std::make_unique<ODCondition>(&mTasksMutex);
 }
 
 //private destructor - DELETE with static method Quit()
@@ -173,6 +181,18 @@ ODManager::~ODManager()
    mTerminate = true;
    mTerminateMutex.Unlock();
 
+   //Wake all idle workers so they see the termination, and wait for those
+   //still busy to finish their current part of a task
+   mTasksMutex.Lock();
+   mTasksAvailableCond->Broadcast();
+   mTasksMutex.Unlock();
+   for (auto worker : mWorkers)
+   {
+      worker->Wait();
+      delete worker;
+   }
+   mWorkers.clear();
+
    //This while loop waits for ODTasks to finish and the DELETE removes all tasks from the Queue.
    //This function is called from the main audacity event thread, so there should not be more requests for pMan
    mTerminatedMutex.Lock();
@@ -183,6 +203,7 @@ ODManager::~ODManager()
 
       //signal the queue not empty condition since the ODMan thread will wait on the queue condition
       mQueueNotEmptyCondLock.Lock();
+      mQueuesChanged = true;
       mQueueNotEmptyCond->Signal();
       mQueueNotEmptyCondLock.Unlock();
 
@@ -198,19 +219,21 @@ ODManager::~ODManager()
 ///Adds a task to running queue.  Thread-safe.
 void ODManager::AddTask(ODTask* task)
 {
-   mTasksMutex.Lock();
-   mTasks.push_back(task);
-   mTasksMutex.Unlock();
-   //signal the queue not empty condition.
    bool paused;
 
    mPauseLock.Lock();
    paused=mPause;
    mPauseLock.Unlock();
 
-   //don't signal if we are paused since if we wake up the loop it will start processing other tasks while paused
+   mTasksMutex.Lock();
+   mTasks.push_back(task);
+   //wake one idle worker, unless paused; Resume wakes them all
    if(!paused)
-      mQueueNotEmptyCond->Signal();
+      mTasksAvailableCond->Signal();
+   mTasksMutex.Unlock();
+
+   //signal the queue not empty condition.
+   SignalTaskQueueLoop();
 }
 
 void ODManager::SignalTaskQueueLoop()
@@ -222,7 +245,52 @@ void ODManager::SignalTaskQueueLoop()
    mPauseLock.Unlock();
    //don't signal if we are paused
    if(!paused)
+   {
+      ODLocker locker{ &mQueueNotEmptyCondLock };
+      mQueuesChanged = true;
       mQueueNotEmptyCond->Signal();
+   }
+}
+
+///Blocks a worker thread until there is a task to run, and returns it;
+///returns null when the manager is terminating.  Tasks whose tracks have
+///had a recent demand (as from the viewport or play head) go first, then
+///tasks with regions demanded, as for tracks on screen, then the rest.
+ODTask* ODManager::WaitForTask()
+{
+   ODLocker locker{ &mTasksMutex };
+   while (true)
+   {
+      mTerminateMutex.Lock();
+      bool terminate = mTerminate;
+      mTerminateMutex.Unlock();
+      if (terminate)
+         return nullptr;
+
+      mPauseLock.Lock();
+      bool paused = mPause;
+      mPauseLock.Unlock();
+
+      if (!paused && !mTasks.empty())
+      {
+         auto iter = std::find_if(mTasks.begin(), mTasks.end(),
+            [](ODTask *task){ return task->GetNeedsODUpdate(); });
+         if (iter == mTasks.end())
+            iter = std::find_if(mTasks.begin(), mTasks.end(),
+               [](ODTask *task){ return task->HasDemand(); });
+         if (iter == mTasks.end())
+            iter = mTasks.begin();
+         auto task = *iter;
+         mTasks.erase(iter);
+
+         mCurrentThreadsMutex.Lock();
+         mCurrentThreads++;
+         mCurrentThreadsMutex.Unlock();
+         return task;
+      }
+
+      mTasksAvailableCond->Wait();
+   }
 }
 
 ///removes a task from the active task queue
@@ -319,7 +387,17 @@ bool ODManager::IsInstanceCreated()
 void ODManager::Init()
 {
    mCurrentThreads = 0;
-   mMaxThreads = 5;
+   //one worker per core, kept for the life of the manager, rather than a
+   //NEW thread for each part of a task
+   mMaxThreads = std::max(2, wxThread::GetCPUCount());
+
+   for (int i = 0; i < mMaxThreads; ++i)
+   {
+      auto worker = safenew ODTaskThread;
+      worker->Create();
+      worker->Run();
+      mWorkers.push_back(worker);
+   }
 
    //   wxLogDebug(wxT("Initializing ODManager...Creating manager thread"));
    // This is a detached thread, so it deletes itself when it finishes
@@ -345,8 +423,6 @@ void ODManager::DecrementCurrentThreads()
 ///Main loop for managing threads and tasks.
 void ODManager::Start()
 {
-   bool tasksInArray;
-   bool paused;
    int  numQueues=0;
 
    mNeedsDraw=0;
@@ -364,48 +440,13 @@ void ODManager::Start()
       //we should look at our WaveTrack queues to see if we can process a NEW task to the running queue.
       UpdateQueues();
 
-      //start some threads if necessary
-
-      mTasksMutex.Lock();
-      tasksInArray = mTasks.size()>0;
-      mTasksMutex.Unlock();
-
-      mPauseLock.Lock();
-      paused=mPause;
-      mPauseLock.Unlock();
-
-      mCurrentThreadsMutex.Lock();
-      // keep adding tasks if there is work to do, up to the limit.
-      while(!paused && tasksInArray && (mCurrentThreads < mMaxThreads))
-      {
-         mCurrentThreads++;
-         mCurrentThreadsMutex.Unlock();
-
-         mTasksMutex.Lock();
-         //detach a NEW thread.
-         // This is a detached thread, so it deletes itself when it finishes
-         // ... except on Mac where we we don't use wxThread for reasons unexplained
-         auto thread = safenew ODTaskThread(mTasks[0]);//task);
-         //thread->SetPriority(10);//default is 50.
-         thread->Create();
-         thread->Run();
-
-         mTasks.erase(mTasks.begin());
-         tasksInArray = mTasks.size()>0;
-         mTasksMutex.Unlock();
-
-         mCurrentThreadsMutex.Lock();
-      }
-
-      mCurrentThreadsMutex.Unlock();
-      //use a conditon variable to block here instead of a sleep.
-
-      // JKC: If there are no tasks ready to run, or we're paused then
-      // we wait for there to be tasks in the queue.
+      //the workers take tasks as they are added; wait until one is added,
+      //or a worker finishes part of one, to check the queues again.
       {
          ODLocker locker{ &mQueueNotEmptyCondLock };
-         if( (!tasksInArray) || paused)
+         if (!mQueuesChanged)
             mQueueNotEmptyCond->Wait();
+         mQueuesChanged = false;
       }
 
       //if there is some ODTask running, then there will be something in the queue.  If so then redraw to show progress
@@ -447,8 +488,13 @@ void ODManager::Pauser::Pause(bool pause)
       pMan->mPauseLock.Unlock();
 
       if(!pause)
-         //we should check the queue again.
-         pMan->mQueueNotEmptyCond->Signal();
+      {
+         //we should check the queue again, and the workers may run again.
+         pMan->mTasksMutex.Lock();
+         pMan->mTasksAvailableCond->Broadcast();
+         pMan->mTasksMutex.Unlock();
+         pMan->SignalTaskQueueLoop();
+      }
    }
    else
    {
@@ -564,6 +610,17 @@ void ODManager::DemandTrackUpdate(WaveTrack* track, double seconds)
    }
    mQueuesMutex.Unlock();
 }
+///makes the tasks associated with this Waveform process a region of it first
+void ODManager::DemandTrackRange(
+   WaveTrack* track, ODTask::DemandKind kind, double t0, double t1)
+{
+   mQueuesMutex.Lock();
+   for(unsigned int i=0;i<mQueues.size();i++)
+   {
+      mQueues[i]->DemandTrackRange(track,kind,t0,t1);
+   }
+   mQueuesMutex.Unlock();
+}
 
 ///remove tasks from ODWaveTrackTaskQueues that have been done.  Schedules NEW ones if they exist
 ///Also remove queues that have become empty.
@@ -20,6 +20,7 @@ number of threads.
 #define __AUDACITY_ODMANAGER__
 
 #include <vector>
+#include "ODTask.h" // for DemandKind
 #include "ODTaskThread.h"
 #include <wx/event.h> // for DECLARE_EXPORTED_EVENT_TYPE
 
@@ -42,6 +43,7 @@ class TranslatableString;
 class Track;
 class WaveTrack;
 class ODWaveTrackTaskQueue;
+class ODTaskThread;
 class ODManager final
 {
  public:
@@ -60,6 +62,15 @@ class ODManager final
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    void DemandTrackUpdate(WaveTrack* track, double seconds);
 
+   ///makes the tasks associated with this Waveform process a region of it first,
+   ///as for the selection or the play head
+   void DemandTrackRange(
+      WaveTrack* track, ODTask::DemandKind kind, double t0, double t1);
+
+   ///Called from the worker threads to get the next task to work on.  Blocks while there is none.
+   ///Returns null when the manager is terminating.  Thread-safe.
+   ODTask* WaitForTask();
+
    ///Reduces the count of current threads running.  Meant to be called when ODTaskThreads end in their own threads.  Thread-safe.
    void DecrementCurrentThreads();
 
@@ -151,6 +162,11 @@ class ODManager final
    std::vector<ODTask*> mTasks;
    //mutex for above variable
    ODLock mTasksMutex;
+   //signalled when a task is added, for the workers waiting on the above mutex
+   std::unique_ptr<ODCondition> mTasksAvailableCond;
+
+   //the fixed pool of worker threads that take from mTasks
+   std::vector<ODTaskThread*> mWorkers;
 
    //global pause switch for OD
    volatile bool mPause;
@@ -158,12 +174,12 @@ class ODManager final
 
    volatile int mNeedsDraw;
 
-   ///Number of threads currently running.   Accessed thru multiple threads
+   ///Number of workers currently busy with a task.   Accessed thru multiple threads
    volatile int mCurrentThreads;
    //mutex for above variable
    ODLock mCurrentThreadsMutex;
 
-   ///Maximum number of threads allowed out.
+   ///Number of worker threads in the pool.
    int mMaxThreads;
 
    volatile bool mTerminate;
@@ -175,6 +191,8 @@ class ODManager final
    //for the queue not empty comdition
    ODLock         mQueueNotEmptyCondLock;
    std::unique_ptr<ODCondition> mQueueNotEmptyCond;
+   //guarded by the above lock, so that signals are not lost
+   bool mQueuesChanged{ false };
 
 #ifdef __WXMAC__
 
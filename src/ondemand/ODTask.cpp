@@ -25,8 +25,7 @@ in a background thread.
 #include "../WaveTrack.h"
 #include "../Project.h"
 #include "../UndoManager.h"
-//temporarily commented out till it is added to all projects
-//#include "../Profiler.h"
+#include "../Profiler.h"
 
 
 wxDEFINE_EVENT(EVT_ODTASK_COMPLETE, wxCommandEvent);
@@ -35,6 +34,8 @@ wxDEFINE_EVENT(EVT_ODTASK_COMPLETE, wxCommandEvent);
 ODTask::ODTask()
 : mDemandSample(0)
 {
+   for (auto &range : mDemandRanges)
+      range = { 0, 0 };
 
    static int sTaskNumber=0;
    mPercentComplete=0;
@@ -70,6 +71,7 @@ void ODTask::TerminateAndBlock()
 /// will do the smallest unit of work possible
 void ODTask::DoSome(float amountWork)
 {
+   PROFILE_SCOPE("ODTask::DoSome");
    SetIsRunning(true);
    mBlockUntilTerminateMutex.Lock();
 
@@ -336,6 +338,50 @@ void ODTask::DemandTrackUpdate(WaveTrack* track, double seconds)
 
 }
 
+///@param track the track to update
+///@param kind which demand this region replaces
+///@param t0, t1 the region in the track, in seconds
+void ODTask::DemandTrackRange(
+   WaveTrack* track, DemandKind kind, double t0, double t1)
+{
+   bool demandChanged=false;
+   mWaveTrackMutex.Lock();
+   for(size_t i=0;i<mWaveTracks.size();i++)
+   {
+      if ( track == mWaveTracks[i].lock().get() )
+      {
+         const auto rate = track->GetRate();
+         DemandRange range{ sampleCount(t0 * rate), sampleCount(t1 * rate) };
+         if (!(range.first < range.second))
+            range = { 0, 0 };
+         mDemandSampleMutex.Lock();
+         demandChanged = !(range == mDemandRanges[kind]);
+         mDemandRanges[kind] = range;
+         mDemandSampleMutex.Unlock();
+         break;
+      }
+   }
+   mWaveTrackMutex.Unlock();
+
+   if(demandChanged)
+      SetNeedsODUpdate();
+}
+
+auto ODTask::GetDemandRanges() const -> std::vector<DemandRange>
+{
+   mDemandSampleMutex.Lock();
+   std::vector<DemandRange> result(
+      mDemandRanges, mDemandRanges + nDemandKinds);
+   mDemandSampleMutex.Unlock();
+   return result;
+}
+
+bool ODTask::HasDemand() const
+{
+   const auto ranges = GetDemandRanges();
+   return std::any_of(ranges.begin(), ranges.end(),
+      [](const DemandRange &range){ return range.first < range.second; });
+}
 
 void ODTask::StopUsingWaveTrack(WaveTrack* track)
 {
@@ -25,6 +25,8 @@ in a background thread.
 
 #include "../BlockFile.h"
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <wx/event.h> // to declare custom event type
 class AudacityProject;
@@ -95,6 +97,18 @@ class ODTask /* not final */
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    virtual void DemandTrackUpdate(WaveTrack* track, double seconds);
 
+   ///Regions of a track that the user is waiting for, most urgent first
+   enum DemandKind : unsigned {
+      eDemandView,
+      eDemandPlayHead,
+      eDemandSelection,
+      nDemandKinds
+   };
+
+   ///Makes the task process the blocks of the track between t0 and t1 before the rest,
+   ///after those of more urgent kinds.  An empty region withdraws the demand of that kind.
+   virtual void DemandTrackRange(WaveTrack* track, DemandKind kind, double t0, double t1);
+
    bool IsComplete();
 
    void TerminateAndBlock();
@@ -107,6 +121,13 @@ class ODTask /* not final */
 
    virtual void SetDemandSample(sampleCount sample);
 
+   ///A demanded region in samples; empty if first >= second
+   using DemandRange = std::pair<sampleCount, sampleCount>;
+   ///The demanded regions, indexed by DemandKind
+   std::vector<DemandRange> GetDemandRanges() const;
+   ///Whether any region is demanded, as for tracks on screen
+   bool HasDemand() const;
+
    ///does an od update and then recalculates the data.
    virtual void RecalculatePercentComplete();
 
@@ -145,6 +166,13 @@ class ODTask /* not final */
 
    void SetIsRunning(bool value);
 
+   ///Moves the blocks that meet demanded regions to the front, those of the more urgent
+   ///kinds first and each kind in time order, and keeps the order of the rest.
+   ///Subclasses call this at the end of ordering their blocks.
+   template< typename BlockFileType >
+   void PrioritizeDemandedBlocks(
+      std::vector< std::weak_ptr< BlockFileType > > &blocks) const;
+
 
 
    int   mTaskNumber;
@@ -161,6 +189,7 @@ class ODTask /* not final */
    ODLock     mWaveTrackMutex;
 
    sampleCount mDemandSample;
+   DemandRange mDemandRanges[nDemandKinds];
    mutable ODLock      mDemandSampleMutex;
 
    volatile bool mIsRunning;
@@ -176,5 +205,48 @@ class ODTask /* not final */
 
 };
 
+template< typename BlockFileType >
+void ODTask::PrioritizeDemandedBlocks(
+   std::vector< std::weak_ptr< BlockFileType > > &blocks) const
+{
+   const auto ranges = GetDemandRanges();
+   if (std::none_of(ranges.begin(), ranges.end(),
+         [](const DemandRange &range){ return range.first < range.second; }))
+      return;
+
+   struct Entry {
+      unsigned kind;
+      sampleCount start;
+      std::weak_ptr< BlockFileType > block;
+   };
+   std::vector<Entry> entries;
+   entries.reserve(blocks.size());
+   for (auto &block : blocks) {
+      Entry entry{ nDemandKinds, 0, block };
+      if (auto ptr = block.lock()) {
+         entry.start = ptr->GetGlobalStart();
+         const auto end = ptr->GetGlobalEnd();
+         for (unsigned kind = 0; kind < nDemandKinds; ++kind) {
+            const auto &range = ranges[kind];
+            if (entry.start < range.second && range.first < end) {
+               entry.kind = kind;
+               break;
+            }
+         }
+      }
+      entries.push_back(entry);
+   }
+
+   std::stable_sort(entries.begin(), entries.end(),
+      [](const Entry &a, const Entry &b){
+         if (a.kind != b.kind)
+            return a.kind < b.kind;
+         return a.kind < nDemandKinds && a.start < b.start;
+      });
+
+   for (size_t ii = 0; ii < entries.size(); ++ii)
+      blocks[ii] = entries[ii].block;
+}
+
 #endif
 
@@ -11,7 +11,7 @@
 ******************************************************************//**
 
 \class ODTaskThread
-\brief A thread that executes a part of the task specfied by an ODTask.
+\brief One of the pool of ODManager threads that execute parts of ODTasks.
 
 *//*******************************************************************/
 
@@ -187,6 +187,21 @@ void ODWaveTrackTaskQueue::DemandTrackUpdate(WaveTrack* track, double seconds)
    }
 }
 
+///makes the tasks associated with this Waveform process a region of it first
+void ODWaveTrackTaskQueue::DemandTrackRange(
+   WaveTrack* track, ODTask::DemandKind kind, double t0, double t1)
+{
+   if(track)
+   {
+      mTracksMutex.Lock();
+      for(unsigned int i=0;i<mTasks.size();i++)
+      {
+         mTasks[i]->DemandTrackRange(track,kind,t0,t1);
+      }
+
+      mTracksMutex.Unlock();
+   }
+}
 
 //Replaces all instances of a wavetracck with a NEW one (effectively transferes the task.)
 void ODWaveTrackTaskQueue::ReplaceWaveTrack(Track *oldTrack,
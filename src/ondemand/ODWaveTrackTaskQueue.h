@@ -23,11 +23,11 @@ tasks associated with a WaveTrack.
 #define __AUDACITY_ODWAVETRACKTASKQUEUE__
 
 #include <vector>
+#include "ODTask.h" // for DemandKind
 #include "ODTaskThread.h"
 #include "../Internat.h" // for TranslatableString
 class Track;
 class WaveTrack;
-class ODTask;
 /// A class representing a modular task to be used with the On-Demand structures.
 class ODWaveTrackTaskQueue final
 {
@@ -48,6 +48,10 @@ class ODWaveTrackTaskQueue final
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    void DemandTrackUpdate(WaveTrack* track, double seconds);
 
+   ///makes the tasks associated with this Waveform process a region of it first
+   void DemandTrackRange(
+      WaveTrack* track, ODTask::DemandKind kind, double t0, double t1);
+
    ///replaces all instances of a WaveTrack within this task with another.
    void ReplaceWaveTrack(Track *oldTrack,
       const std::shared_ptr<Track> &newTrack);
@@ -27,29 +27,36 @@ other settings.
 
 #include "RecordingPrefs.h"
 
+#include <math.h>
 #include <wx/defs.h>
 
 #include <wx/choice.h>
 #include <wx/intl.h>
 #include <wx/log.h>
 #include <wx/textctrl.h>
+#include <wx/utils.h>
 
 #include "portaudio.h"
 
+#include "../AudioIOBase.h"
+#include "../LatencyMeasurement.h"
 #include "../Prefs.h"
 #include "../ShuttleGui.h"
 #include "../DeviceManager.h"
+#include "../widgets/AudacityMessageBox.h"
 
 enum {
    HostID = 10000,
    PlayID,
    RecordID,
-   ChannelsID
+   ChannelsID,
+   MeasureID
 };
 
 BEGIN_EVENT_TABLE(DevicePrefs, PrefsPanel)
    EVT_CHOICE(HostID, DevicePrefs::OnHost)
    EVT_CHOICE(RecordID, DevicePrefs::OnDevice)
+   EVT_BUTTON(MeasureID, DevicePrefs::OnMeasure)
 END_EVENT_TABLE()
 
 DevicePrefs::DevicePrefs(wxWindow * parent, wxWindowID winid)
@@ -183,10 +190,9 @@ void DevicePrefs::PopulateOrExchange(ShuttleGui & S)
    {
       S.StartThreeColumn();
       {
-         wxTextCtrl *w;
          // only show the following controls if we use Portaudio v19, because
          // for Portaudio v18 we always use default buffer sizes
-         w = S
+         mLatencyDuration = S
             .NameSuffix(XO("milliseconds"))
             .TieNumericTextBox(XO("&Buffer length:"),
                                  {wxT("/AudioIO/LatencyDuration"),
@@ -194,7 +200,7 @@ void DevicePrefs::PopulateOrExchange(ShuttleGui & S)
                                  9);
          S.AddUnits(XO("milliseconds"));
 
-         w = S
+         mLatencyCorrection = S
             .NameSuffix(XO("milliseconds"))
             .TieNumericTextBox(XO("&Latency compensation:"),
                                  {wxT("/AudioIO/LatencyCorrection"),
@@ -203,6 +209,14 @@ void DevicePrefs::PopulateOrExchange(ShuttleGui & S)
          S.AddUnits(XO("milliseconds"));
       }
       S.EndThreeColumn();
+
+      S.Id(MeasureID).AddButton(XO("&Measure Round Trip..."), wxALIGN_LEFT);
+
+      // Takes effect with the next stream; Help > Diagnostics tells whether
+      // the system allowed it
+      S.TieCheckBox(
+         XO("Use real-time &priority and locked memory (pro audio)"),
+         {wxT("/AudioIO/ProAudioMode"), false});
    }
    S.EndStatic();
    S.EndScroller();
@@ -385,6 +399,77 @@ void DevicePrefs::OnDevice(wxCommandEvent & WXUNUSED(event))
    Layout();
 }
 
+void DevicePrefs::OnMeasure(wxCommandEvent & WXUNUSED(event))
+{
+   const auto title = XO("Measure Round Trip");
+   if (AudioIOBase::Get()->IsBusy()) {
+      AudacityMessageBox(
+         XO("Stop playing and recording before measuring the round trip."),
+         title,
+         wxOK | wxICON_EXCLAMATION);
+      return;
+   }
+
+   const auto playMap = SelectedMap(mPlay);
+   const auto recordMap = SelectedMap(mRecord);
+   if (!playMap || !recordMap)
+      return;
+
+   double bufferLength;
+   if (!mLatencyDuration->GetValue().ToDouble(&bufferLength))
+      bufferLength = DEFAULT_LATENCY_DURATION;
+   const double rate =
+      gPrefs->ReadDouble(wxT("/SamplingRate/DefaultProjectSampleRate"),
+         AudioIOBase::GetOptimalSupportedSampleRate());
+
+   if (AudacityMessageBox(
+         XO(
+"Connect the playback output to the recording input with a cable, and turn\n\
+down any speakers.  A short burst of noise will be played and recorded."),
+         title,
+         wxOK | wxCANCEL | wxICON_INFORMATION) != wxOK)
+      return;
+
+   double roundTrip, reported;
+   TranslatableString error;
+   bool success;
+   {
+      wxBusyCursor busy;
+      success = LatencyMeasurement::Measure(
+         playMap->deviceIndex, recordMap->deviceIndex, rate, bufferLength,
+         roundTrip, reported, error);
+   }
+   if (!success) {
+      AudacityMessageBox(error, title, wxOK | wxICON_ERROR);
+      return;
+   }
+
+   // Recording is shifted earlier by the round trip
+   const double correction = -1000.0 * roundTrip;
+   LatencyMeasurement::Store(playMap->hostString,
+      playMap->deviceString, recordMap->deviceString,
+      bufferLength, correction);
+   mLatencyCorrection->SetValue(wxString::Format(wxT("%.3f"), correction));
+
+   AudacityMessageBox(
+      XO(
+"The round trip takes %.3f milliseconds, %lld samples at %.0f Hz.\n\
+PortAudio estimated %.3f milliseconds.\n\n\
+Recording with these devices and this buffer length will be compensated by\n\
+the measurement rather than by what is entered.")
+         .Format( 1000.0 * roundTrip, (long long) llrint(roundTrip * rate),
+            rate, 1000.0 * reported ),
+      title,
+      wxOK | wxICON_INFORMATION);
+}
+
+DeviceSourceMap *DevicePrefs::SelectedMap(wxChoice *choice)
+{
+   if (choice->GetCount() == 0 || choice->GetSelection() == wxNOT_FOUND)
+      return nullptr;
+   return (DeviceSourceMap *) choice->GetClientData(choice->GetSelection());
+}
+
 bool DevicePrefs::Commit()
 {
    ShuttleGui S(this, eIsSavingToPrefs);
@@ -419,6 +504,22 @@ bool DevicePrefs::Commit()
                     mChannels->GetSelection() + 1);
    }
 
+   // A compensation edited by hand replaces any measurement of the devices
+   const auto playMap = SelectedMap(mPlay);
+   if (playMap && map) {
+      double measured;
+      const auto bufferLength = gPrefs->ReadDouble(
+         wxT("/AudioIO/LatencyDuration"), DEFAULT_LATENCY_DURATION);
+      const auto entered = gPrefs->ReadDouble(
+         wxT("/AudioIO/LatencyCorrection"), DEFAULT_LATENCY_CORRECTION);
+      if (LatencyMeasurement::Lookup(playMap->hostString,
+             playMap->deviceString, map->deviceString,
+             bufferLength, measured) &&
+          fabs(measured - entered) > 0.0005)
+         LatencyMeasurement::Forget(playMap->hostString,
+            playMap->deviceString, map->deviceString);
+   }
+
    return true;
 }
 
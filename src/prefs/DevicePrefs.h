@@ -17,7 +17,9 @@
 #include "PrefsPanel.h"
 
 class wxChoice;
+class wxTextCtrl;
 class ShuttleGui;
+struct DeviceSourceMap;
 class wxArrayStringEx;
 
 #define DEVICE_PREFS_PLUGIN_SYMBOL ComponentInterfaceSymbol{ XO("Device") }
@@ -40,6 +42,9 @@ class DevicePrefs final : public PrefsPanel
 
    void OnHost(wxCommandEvent & e);
    void OnDevice(wxCommandEvent & e);
+   void OnMeasure(wxCommandEvent & e);
+
+   static DeviceSourceMap *SelectedMap(wxChoice *choice);
 
    TranslatableStrings mHostNames;
    wxArrayStringEx mHostLabels;
@@ -53,6 +58,8 @@ class DevicePrefs final : public PrefsPanel
    wxChoice *mPlay;
    wxChoice *mRecord;
    wxChoice *mChannels;
+   wxTextCtrl *mLatencyDuration;
+   wxTextCtrl *mLatencyCorrection;
 
    DECLARE_EVENT_TABLE()
 };
@@ -32,6 +32,8 @@
 #include <wx/filename.h>
 #include <wx/utils.h>
 
+#include "../BlockSampleCache.h"
+#include "../CacheBudget.h"
 #include "../FileNames.h"
 #include "../Prefs.h"
 #include "../ShuttleGui.h"
@@ -116,7 +118,46 @@ void DirectoriesPrefs::PopulateOrExchange(ShuttleGui & S)
          S.Prop(10).AddSpace( 10 );
          S.Id(ChooseButtonID).Prop(0).AddButton(XO("C&hoose..."));
       }
+      S.EndHorizontalLay();
+
+      S.TieCheckBox(XO("&Write recorded audio to disk in the background"),
+                    {wxT("/Directories/WriteBehind"),
+                     false});
+      S.TieCheckBox(XO("Store new audio in a few large &pack files"),
+                    {wxT("/Directories/PackBlockFiles"),
+                     false});
+      S.TieCheckBox(XO("&Compress new audio losslessly"),
+                    {wxT("/Directories/CompressBlockFiles"),
+                     false});
+      S.TieCheckBox(XO("Store identical blocks of new audio only &once"),
+                    {wxT("/Directories/ShareIdenticalBlocks"),
+                     false});
+      S.TieCheckBox(XO("&Edit audio without copying the rest of each block"),
+                    {wxT("/Directories/RangeBlockFiles"),
+                     false});
+      S.TieCheckBox(XO("&Merge short blocks of edited audio while idle"),
+                    {wxT("/Directories/CompactSequences"),
+                     false});
+      S.TieCheckBox(XO("Read wave&form summaries in the background on opening"),
+                    {wxT("/Directories/PrefetchSummaries"),
+                     false});
+      S.TieCheckBox(XO("Save projects in a compact &binary format"),
+                    {wxT("/FileFormats/BinaryProjectFiles"),
+                     false});
 
+      S.StartTwoColumn();
+      {
+         S.TieIntegerTextBox(XO("Memory for recently read &audio (MB):"),
+                             {wxT("/Directories/SampleCacheMB"), 256},
+                             9);
+         S.TieIntegerTextBox(XO("Memory for waveform displays (MB):"),
+                             {wxT("/Directories/WaveformCacheMB"), 64},
+                             9);
+         S.TieIntegerTextBox(XO("Memory for spectrogram displays (MB):"),
+                             {wxT("/Directories/SpectrogramCacheMB"), 512},
+                             9);
+      }
+      S.EndTwoColumn();
    }
    S.EndStatic();
 
@@ -133,6 +174,9 @@ void DirectoriesPrefs::PopulateOrExchange(ShuttleGui & S)
          S.TieIntegerTextBox(XO("Mi&nimum Free Memory (MB):"),
                              {wxT("/Directories/CacheLowMem"), 16},
                              9);
+         S.TieIntegerTextBox(XO("Memory for recorded audio (MB):"),
+                             {wxT("/Directories/RecordCacheMB"), 1024},
+                             9);
       }
       S.EndTwoColumn();
 
@@ -285,6 +329,8 @@ bool DirectoriesPrefs::Commit()
 {
    ShuttleGui S(this, eIsSavingToPrefs);
    PopulateOrExchange(S);
+   CacheBudget::UpdatePrefs();
+   BlockSampleCache::UpdatePrefs();
 
    return true;
 }
@@ -96,18 +96,21 @@ void ImportExportPrefs::PopulateOrExchange(ShuttleGui & S)
    S.SetBorder(2);
    S.StartScroller();
 
-#ifdef EXPERIMENTAL_OD_DATA
    S.StartStatic(XO("When importing audio files"));
    {
+#ifdef EXPERIMENTAL_OD_DATA
       S.StartRadioButtonGroup(FileFormatsCopyOrEditSetting);
       {
          S.TieRadioButton();
          S.TieRadioButton();
       }
       S.EndRadioButtonGroup();
+#endif
+      S.TieCheckBox(XO("Import several &files at once"),
+                    {wxT("/AudioFiles/ImportInParallel"),
+                     false});
    }
    S.EndStatic();
-#endif
    S.StartStatic(XO("When exporting tracks to an audio file"));
    {
       S.StartRadioButtonGroup(ImportExportPrefs::ExportDownMixSetting);
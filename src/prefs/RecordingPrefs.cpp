@@ -140,6 +140,24 @@ void RecordingPrefs::PopulateOrExchange(ShuttleGui & S)
                      -gPrefs->Read(ENV_DB_KEY, ENV_DB_RANGE));
       }
       S.EndMultiColumn();
+
+      S.StartThreeColumn();
+      {
+         S.NameSuffix(XO("milliseconds"))
+            .TieIntegerTextBox(XO("&Resume after sound for:"),
+                               {wxT("/AudioIO/SoundActivationAttack"),
+                                0},
+                               9);
+         S.AddUnits(XO("milliseconds"));
+
+         S.NameSuffix(XO("milliseconds"))
+            .TieIntegerTextBox(XO("&Pause after silence for:"),
+                               {wxT("/AudioIO/SoundActivationHold"),
+                                500},
+                               9);
+         S.AddUnits(XO("milliseconds"));
+      }
+      S.EndThreeColumn();
    }
    S.EndStatic();
 
@@ -27,6 +27,7 @@ Paul Licameli
 #include "../Prefs.h"
 
 #include <cmath>
+#include <mutex>
 
 #include "../widgets/AudacityMessageBox.h"
 
@@ -368,27 +369,28 @@ namespace
          window[ii] = 0.0;
          window[fftLen - ii - 1] = 0.0;
       }
-      // Default rectangular window in the middle
-      for (; ii < endOfWindow; ++ii)
-         window[ii] = 1.0;
-      // Overwrite middle as needed
+      // Fill the middle from the shared tables
+      const float *table = nullptr;
       switch (which) {
       case WINDOW:
-         NewWindowFunc(windowType, windowSize, extra, window.get() + padding);
-         break;
       case TWINDOW:
-         NewWindowFunc(windowType, windowSize, extra, window.get() + padding);
-         {
-            for (int jj = padding, multiplier = -(int)windowSize / 2; jj < (int)endOfWindow; ++jj, ++multiplier)
-               window[jj] *= multiplier;
-         }
+         table = GetWindowTable(windowType, windowSize, extra);
          break;
       case DWINDOW:
-         DerivativeOfWindowFunc(windowType, windowSize, extra, window.get() + padding);
+         table = GetWindowTable(windowType, windowSize, extra, true);
          break;
       default:
          wxASSERT(false);
       }
+      if (table)
+         std::copy(table, table + windowSize, window.get() + padding);
+      else
+         for (; ii < endOfWindow; ++ii)
+            window[ii] = 1.0;
+      if (which == TWINDOW) {
+         for (int jj = padding, multiplier = -(int)windowSize / 2; jj < (int)endOfWindow; ++jj, ++multiplier)
+            window[jj] *= multiplier;
+      }
       // Scale the window function to give 0dB spectrum for 0dB sine tone
       if (which == WINDOW) {
          scale = 0.0;
@@ -402,8 +404,13 @@ namespace
    }
 }
 
+// Tracks sharing the default settings may be prepared for drawing on
+// several threads at once; see TrackView::PrepareDraw
+static std::mutex sCacheWindowsMutex;
+
 void SpectrogramSettings::CacheWindows() const
 {
+   std::lock_guard<std::mutex> lock{ sCacheWindowsMutex };
    if (hFFT == NULL || window == NULL) {
 
       double scale;
@@ -150,11 +150,11 @@ PrefsPanel::Registration sAttachment{ "TracksBehaviors",
 // SyncLock.
 bool GetEditClipsCanMove()
 {
-   bool mIsSyncLocked;
-   gPrefs->Read(wxT("/GUI/SyncLockTracks"), &mIsSyncLocked, false);
-   if( mIsSyncLocked )
+   static const Setting<bool> SyncLockTracks{
+      wxT("/GUI/SyncLockTracks"), false };
+   if( SyncLockTracks.Read() )
       return true;
-   bool editClipsCanMove;
-   gPrefs->Read(wxT("/GUI/EditClipCanMove"), &editClipsCanMove, true);
-   return editClipsCanMove;
+   return EditClipsCanMove.Read();
 }
+
+Setting<bool> EditClipsCanMove{ wxT("/GUI/EditClipCanMove"), true };
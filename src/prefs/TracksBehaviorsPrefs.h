@@ -17,6 +17,7 @@
 #include "PrefsPanel.h"
 
 class ChoiceSetting;
+template< typename T > class Setting;
 class ShuttleGui;
 class wxArrayStringEx;
 
@@ -42,6 +43,7 @@ class TracksBehaviorsPrefs final : public PrefsPanel
 };
 
 extern ChoiceSetting TracksBehaviorsSolo;
+extern Setting<bool> EditClipsCanMove;
 
 bool GetEditClipsCanMove();
 
@@ -612,7 +612,7 @@ void SelectionBar::OnIdle( wxIdleEvent &evt )
    auto &projectAudioIO = ProjectAudioIO::Get( project );
    if ( projectAudioIO.IsAudioActive() ){
       auto gAudioIO = AudioIOBase::Get();
-      audioTime = gAudioIO->GetStreamTime();
+      audioTime = gAudioIO->GetAudibleStreamTime();
    }
    else {
       const auto &playRegion = ViewInfo::Get( project ).playRegion;
@@ -390,7 +390,7 @@ void TimerToolBar::OnIdle( wxIdleEvent &evt )
    auto &projectAudioIO = ProjectAudioIO::Get( project );
    if ( projectAudioIO.IsAudioActive() ){
       auto gAudioIO = AudioIOBase::Get();
-      audioTime = gAudioIO->GetStreamTime();
+      audioTime = gAudioIO->GetAudibleStreamTime();
    }
    else {
       const auto &playRegion = ViewInfo::Get( project ).playRegion;
@@ -43,6 +43,8 @@ Paul Licameli split from TrackPanel.cpp
 #include <wx/frame.h>
 #include <wx/menu.h>
 
+#include <unordered_map>
+
 LabelTrackView::LabelTrackView( const std::shared_ptr<Track> &pTrack )
    : CommonTrackView{ pTrack }
 {
@@ -164,6 +166,13 @@ int LabelTrackView::mTextHeight;
 
 int LabelTrackView::mFontHeight=-1;
 
+namespace {
+// Widths of label titles in the label font, so that repaints need not
+// measure all titles again
+std::unordered_map< wxString, int > sTextWidths;
+const size_t MaxTextWidths = 100000;
+}
+
 void LabelTrackView::ResetFlags()
 {
    mInitialCursorPos = 1;
@@ -193,6 +202,7 @@ wxFont LabelTrackView::GetFont(const wxString &faceName, int size)
 void LabelTrackView::ResetFont()
 {
    mFontHeight = -1;
+   sTextWidths.clear();
    wxString facename = gPrefs->Read(wxT("/GUI/LabelFontFacename"), wxT(""));
    int size = gPrefs->Read(wxT("/GUI/LabelFontSize"), DefaultFontSize);
    msFont = GetFont(facename, size);
@@ -696,6 +706,20 @@ namespace {
 #include "../../../TrackPanelDrawingContext.h"
 #include "LabelTextHandle.h"
 
+/// Whether anything drawn for the label, as laid out by ComputeLayout,
+/// falls within the LabelTrack rectangle r.
+bool LabelTrackView::IsVisible( const LabelStruct &ls, const wxRect & r )
+{
+   int left = std::min( ls.x, ls.x1 );
+   int right = std::max( ls.x, ls.x1 );
+   if( ls.y != -1 ) {
+      // Allow for the glyphs and for text wider than the label
+      left = std::min( left, ls.xText ) - mIconWidth;
+      right = std::max( right, ls.xText + ls.width ) + mIconWidth;
+   }
+   return right >= r.x && left <= r.x + r.width;
+}
+
 /// Draw calls other functions to draw the LabelTrack.
 ///   @param  dc the device context
 ///   @param  r  the LabelTrack rectangle.
@@ -724,12 +748,17 @@ void LabelTrackView::Draw
 
    wxCoord textWidth, textHeight;
 
-   // Get the text widths.
-   // TODO: Make more efficient by only re-computing when a
-   // text label title changes.
+   // Get the text widths, measuring only titles not seen before with this
+   // font
    for (const auto &labelStruct : mLabels) {
-      dc.GetTextExtent(labelStruct.title, &textWidth, &textHeight);
-      labelStruct.width = textWidth;
+      auto iter = sTextWidths.find( labelStruct.title );
+      if ( iter == sTextWidths.end() ) {
+         if ( sTextWidths.size() >= MaxTextWidths )
+            sTextWidths.clear();
+         dc.GetTextExtent(labelStruct.title, &textWidth, &textHeight);
+         iter = sTextWidths.emplace( labelStruct.title, textWidth ).first;
+      }
+      labelStruct.width = iter->second;
    }
 
    // TODO: And this only needs to be done once, but we
@@ -741,6 +770,15 @@ void LabelTrackView::Draw
    dc.GetTextExtent(wxT("Demo Text x^y"), &textWidth, &textHeight);
    mTextHeight = (int)textHeight;
    ComputeLayout( r, zoomInfo );
+
+   // The rows depend on all labels, but only those intersecting the
+   // rectangle need drawing
+   std::vector< int > visible;
+   { int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+      if ( IsVisible( labelStruct, r ) )
+         visible.push_back( i );
+   }}
+
    dc.SetTextForeground(theTheme.Colour( clrLabelTrackText));
    dc.SetBackgroundMode(wxTRANSPARENT);
    dc.SetBrush(AColor::labelTextNormalBrush);
@@ -751,19 +789,19 @@ void LabelTrackView::Draw
    // so that the correct things overpaint each other.
 
    // Draw vertical lines that show where the end positions are.
-   for (const auto &labelStruct : mLabels)
-      DrawLines( dc, labelStruct, r );
+   for (const auto i : visible)
+      DrawLines( dc, mLabels[i], r );
 
    // Draw the end glyphs.
-   { int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+   for (const auto i : visible) {
       GlyphLeft=0;
       GlyphRight=1;
       if( pHit && i == pHit->mMouseOverLabelLeft )
          GlyphLeft = (pHit->mEdge & 4) ? 6:9;
       if( pHit && i == pHit->mMouseOverLabelRight )
          GlyphRight = (pHit->mEdge & 4) ? 7:4;
-      DrawGlyphs( dc, labelStruct, r, GlyphLeft, GlyphRight );
-   }}
+      DrawGlyphs( dc, mLabels[i], r, GlyphLeft, GlyphRight );
+   }
 
    auto &project = *artist->parent->GetProject();
 
@@ -774,7 +812,7 @@ void LabelTrackView::Draw
       auto target = dynamic_cast<LabelTextHandle*>(context.target.get());
       highlightTrack = target && target->GetTrack().get() == this;
 #endif
-      int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+      for (const auto i : visible) {
          bool highlight = false;
 #ifdef EXPERIMENTAL_TRACK_PANEL_HIGHLIGHTING
          highlight = highlightTrack && target->GetLabelNum() == i;
@@ -785,7 +823,7 @@ void LabelTrackView::Draw
             dc.SetBrush( AColor::labelTextEditBrush );
          else if ( highlight )
             dc.SetBrush( AColor::uglyBrush );
-         DrawTextBox( dc, labelStruct, r );
+         DrawTextBox( dc, mLabels[i], r );
 
          if (highlight || selected)
             dc.SetBrush(AColor::labelTextNormalBrush);
@@ -802,13 +840,13 @@ void LabelTrackView::Draw
    }
 
    // Draw the text and the label boxes.
-   { int i = -1; for (const auto &labelStruct : mLabels) { ++i;
+   for (const auto i : visible) {
       if( GetSelectedIndex( project ) == i )
          dc.SetBrush(AColor::labelTextEditBrush);
-      DrawText( dc, labelStruct, r );
+      DrawText( dc, mLabels[i], r );
       if( GetSelectedIndex( project ) == i )
          dc.SetBrush(AColor::labelTextNormalBrush);
-   }}
+   }
 
    // Draw the cursor, if there is one.
    if( mDrawCursor && HasSelection( project ) )
@@ -462,237 +462,232 @@ void DrawNoteTrack(TrackPanelDrawingContext &context,
    // We want to draw in seconds, so we need to convert to seconds
    seq->convert_to_seconds();
 
-   Alg_iterator iterator(seq, false);
-   iterator.begin();
-   //for every event
-   Alg_event_ptr evt;
-   while (0 != (evt = iterator.next())) {
-      if (evt->get_type() == 'n') { // 'n' means a note
-         Alg_note_ptr note = (Alg_note_ptr) evt;
-         // if the note's channel is visible
-         if (track->IsVisibleChan(evt->chan)) {
-            double xx = note->time + track->GetOffset();
-            double x1 = xx + note->dur;
-            if (xx < h1 && x1 > h) { // omit if outside box
-               const char *shape = NULL;
-               if (note->loud > 0.0 || 0 == (shape = IsShape(note))) {
-                  wxRect nr; // "note rectangle"
-                  nr.y = data.PitchToY(note->pitch);
-                  nr.height = data.GetPitchHeight(1);
-
-                  nr.x = TIME_TO_X(xx);
-                  nr.width = TIME_TO_X(x1) - nr.x;
-
-                  if (nr.x + nr.width >= rect.x && nr.x < rect.x + rect.width) {
-                     if (nr.x < rect.x) {
-                        nr.width -= (rect.x - nr.x);
-                        nr.x = rect.x;
+   // for every note that may be in view
+   std::vector< Alg_note_ptr > notes;
+   track->FindNotes( h, h1, notes );
+   for (const auto note : notes) {
+      // if the note's channel is visible
+      if (track->IsVisibleChan(note->chan)) {
+         double xx = note->time + track->GetOffset();
+         double x1 = xx + note->dur;
+         if (xx < h1 && x1 > h) { // omit if outside box
+            const char *shape = NULL;
+            if (note->loud > 0.0 || 0 == (shape = IsShape(note))) {
+               wxRect nr; // "note rectangle"
+               nr.y = data.PitchToY(note->pitch);
+               nr.height = data.GetPitchHeight(1);
+
+               nr.x = TIME_TO_X(xx);
+               nr.width = TIME_TO_X(x1) - nr.x;
+
+               if (nr.x + nr.width >= rect.x && nr.x < rect.x + rect.width) {
+                  if (nr.x < rect.x) {
+                     nr.width -= (rect.x - nr.x);
+                     nr.x = rect.x;
+                  }
+                  if (nr.x + nr.width > rect.x + rect.width) // clip on right
+                     nr.width = rect.x + rect.width - nr.x;
+
+                  if (nr.y + nr.height < rect.y + marg + 3) {
+                      // too high for window
+                      nr.y = rect.y;
+                      nr.height = marg;
+                      dc.SetBrush(*wxBLACK_BRUSH);
+                      dc.SetPen(*wxBLACK_PEN);
+                      dc.DrawRectangle(nr);
+                  } else if (nr.y >= rect.y + rect.height - marg - 1) {
+                      // too low for window
+                      nr.y = rect.y + rect.height - marg;
+                      nr.height = marg;
+                      dc.SetBrush(*wxBLACK_BRUSH);
+                      dc.SetPen(*wxBLACK_PEN);
+                      dc.DrawRectangle(nr);
+                  } else {
+                     if (nr.y + nr.height > rect.y + rect.height - marg)
+                        nr.height = rect.y + rect.height - nr.y;
+                     if (nr.y < rect.y + marg) {
+                        int offset = rect.y + marg - nr.y;
+                        nr.height -= offset;
+                        nr.y += offset;
                      }
-                     if (nr.x + nr.width > rect.x + rect.width) // clip on right
-                        nr.width = rect.x + rect.width - nr.x;
-
-                     if (nr.y + nr.height < rect.y + marg + 3) {
-                         // too high for window
-                         nr.y = rect.y;
-                         nr.height = marg;
-                         dc.SetBrush(*wxBLACK_BRUSH);
-                         dc.SetPen(*wxBLACK_PEN);
-                         dc.DrawRectangle(nr);
-                     } else if (nr.y >= rect.y + rect.height - marg - 1) {
-                         // too low for window
-                         nr.y = rect.y + rect.height - marg;
-                         nr.height = marg;
-                         dc.SetBrush(*wxBLACK_BRUSH);
-                         dc.SetPen(*wxBLACK_PEN);
-                         dc.DrawRectangle(nr);
-                     } else {
-                        if (nr.y + nr.height > rect.y + rect.height - marg)
-                           nr.height = rect.y + rect.height - nr.y;
-                        if (nr.y < rect.y + marg) {
-                           int offset = rect.y + marg - nr.y;
-                           nr.height -= offset;
-                           nr.y += offset;
-                        }
-                        // nr.y += rect.y;
-                        if (muted)
-                           AColor::LightMIDIChannel(&dc, note->chan + 1);
-                        else
-                           AColor::MIDIChannel(&dc, note->chan + 1);
-                        dc.DrawRectangle(nr);
-                        if (data.GetPitchHeight(1) > 2) {
-                           AColor::LightMIDIChannel(&dc, note->chan + 1);
-                           AColor::Line(dc, nr.x, nr.y, nr.x + nr.width-2, nr.y);
-                           AColor::Line(dc, nr.x, nr.y, nr.x, nr.y + nr.height-2);
-                           AColor::DarkMIDIChannel(&dc, note->chan + 1);
-                           AColor::Line(dc, nr.x+nr.width-1, nr.y,
-                                 nr.x+nr.width-1, nr.y+nr.height-1);
-                           AColor::Line(dc, nr.x, nr.y+nr.height-1,
-                                 nr.x+nr.width-1, nr.y+nr.height-1);
-                        }
-//                        }
+                     // nr.y += rect.y;
+                     if (muted)
+                        AColor::LightMIDIChannel(&dc, note->chan + 1);
+                     else
+                        AColor::MIDIChannel(&dc, note->chan + 1);
+                     dc.DrawRectangle(nr);
+                     if (data.GetPitchHeight(1) > 2) {
+                        AColor::LightMIDIChannel(&dc, note->chan + 1);
+                        AColor::Line(dc, nr.x, nr.y, nr.x + nr.width-2, nr.y);
+                        AColor::Line(dc, nr.x, nr.y, nr.x, nr.y + nr.height-2);
+                        AColor::DarkMIDIChannel(&dc, note->chan + 1);
+                        AColor::Line(dc, nr.x+nr.width-1, nr.y,
+                              nr.x+nr.width-1, nr.y+nr.height-1);
+                        AColor::Line(dc, nr.x, nr.y+nr.height-1,
+                              nr.x+nr.width-1, nr.y+nr.height-1);
                      }
+//                        }
                   }
-               } else if (shape) {
-                  // draw a shape according to attributes
-                  // add 0.5 to pitch because pitches are plotted with
-                  // height = PITCH_HEIGHT; thus, the center is raised
-                  // by PITCH_HEIGHT * 0.5
-                  int yy = data.PitchToY(note->pitch);
-                  long linecolor = LookupIntAttribute(note, linecolori, -1);
-                  long linethick = LookupIntAttribute(note, linethicki, 1);
-                  long fillcolor = -1;
-                  long fillflag = 0;
-
-                  // set default color to be that of channel
-                  AColor::MIDIChannel(&dc, note->chan+1);
-                  if (shape != text) {
-                     if (linecolor != -1)
-                        dc.SetPen(wxPen(wxColour(RED(linecolor),
-                              GREEN(linecolor),
-                              BLUE(linecolor)),
-                              linethick, wxPENSTYLE_SOLID));
+               }
+            } else if (shape) {
+               // draw a shape according to attributes
+               // add 0.5 to pitch because pitches are plotted with
+               // height = PITCH_HEIGHT; thus, the center is raised
+               // by PITCH_HEIGHT * 0.5
+               int yy = data.PitchToY(note->pitch);
+               long linecolor = LookupIntAttribute(note, linecolori, -1);
+               long linethick = LookupIntAttribute(note, linethicki, 1);
+               long fillcolor = -1;
+               long fillflag = 0;
+
+               // set default color to be that of channel
+               AColor::MIDIChannel(&dc, note->chan+1);
+               if (shape != text) {
+                  if (linecolor != -1)
+                     dc.SetPen(wxPen(wxColour(RED(linecolor),
+                           GREEN(linecolor),
+                           BLUE(linecolor)),
+                           linethick, wxPENSTYLE_SOLID));
+               }
+               if (shape != line) {
+                  fillcolor = LookupIntAttribute(note, fillcolori, -1);
+                  fillflag = LookupLogicalAttribute(note, filll, false);
+
+                  if (fillcolor != -1)
+                     dc.SetBrush(wxBrush(wxColour(RED(fillcolor),
+                           GREEN(fillcolor),
+                           BLUE(fillcolor)),
+                           wxBRUSHSTYLE_SOLID));
+                  if (!fillflag) dc.SetBrush(*wxTRANSPARENT_BRUSH);
+               }
+               int y1 = data.PitchToY(LookupRealAttribute(note, y1r, note->pitch));
+               if (shape == line) {
+                  // extreme zooms caues problems under windows, so we have to do some
+                  // clipping before calling display routine
+                  if (xx < h) { // clip line on left
+                     yy = (int)((yy + (y1 - yy) * (h - xx) / (x1 - xx)) + 0.5);
+                     xx = h;
                   }
-                  if (shape != line) {
-                     fillcolor = LookupIntAttribute(note, fillcolori, -1);
-                     fillflag = LookupLogicalAttribute(note, filll, false);
-
-                     if (fillcolor != -1)
-                        dc.SetBrush(wxBrush(wxColour(RED(fillcolor),
-                              GREEN(fillcolor),
-                              BLUE(fillcolor)),
-                              wxBRUSHSTYLE_SOLID));
-                     if (!fillflag) dc.SetBrush(*wxTRANSPARENT_BRUSH);
+                  if (x1 > h1) { // clip line on right
+                     y1 = (int)((yy + (y1 - yy) * (h1 - xx) / (x1 - xx)) + 0.5);
+                     x1 = h1;
                   }
-                  int y1 = data.PitchToY(LookupRealAttribute(note, y1r, note->pitch));
-                  if (shape == line) {
-                     // extreme zooms caues problems under windows, so we have to do some
-                     // clipping before calling display routine
-                     if (xx < h) { // clip line on left
-                        yy = (int)((yy + (y1 - yy) * (h - xx) / (x1 - xx)) + 0.5);
-                        xx = h;
-                     }
-                     if (x1 > h1) { // clip line on right
-                        y1 = (int)((yy + (y1 - yy) * (h1 - xx) / (x1 - xx)) + 0.5);
-                        x1 = h1;
-                     }
-                     AColor::Line(dc, TIME_TO_X(xx), yy, TIME_TO_X(x1), y1);
-                  } else if (shape == rectangle) {
-                     if (xx < h) { // clip on left, leave 10 pixels to spare
-                        xx = X_TO_TIME(rect.x - (linethick + 10));
-                     }
-                     if (x1 > h1) { // clip on right, leave 10 pixels to spare
-                        xx = X_TO_TIME(rect.x + rect.width + linethick + 10);
-                     }
-                     dc.DrawRectangle(TIME_TO_X(xx), yy, TIME_TO_X(x1) - TIME_TO_X(xx), y1 - yy + 1);
-                  } else if (shape == triangle) {
-                     wxPoint points[3];
-                     points[0].x = TIME_TO_X(xx);
-                     CLIP(points[0].x);
-                     points[0].y = yy;
-                     points[1].x = TIME_TO_X(LookupRealAttribute(note, x1r, note->pitch));
-                     CLIP(points[1].x);
-                     points[1].y = y1;
-                     points[2].x = TIME_TO_X(LookupRealAttribute(note, x2r, xx));
-                     CLIP(points[2].x);
-                     points[2].y = data.PitchToY(LookupRealAttribute(note, y2r, note->pitch));
-                     dc.DrawPolygon(3, points);
-                  } else if (shape == polygon) {
-                     wxPoint points[20]; // upper bound of 20 sides
-                     points[0].x = TIME_TO_X(xx);
-                     CLIP(points[0].x);
-                     points[0].y = yy;
-                     points[1].x = TIME_TO_X(LookupRealAttribute(note, x1r, xx));
-                     CLIP(points[1].x);
-                     points[1].y = y1;
-                     points[2].x = TIME_TO_X(LookupRealAttribute(note, x2r, xx));
-                     CLIP(points[2].x);
-                     points[2].y = data.PitchToY(LookupRealAttribute(note, y2r, note->pitch));
-                     int n = 3;
-                     while (n < 20) {
-                        char name[8];
-                        sprintf(name, "x%dr", n);
-                        Alg_attribute attr = symbol_table.insert_string(name);
-                        double xn = LookupRealAttribute(note, attr, -1000000.0);
-                        if (xn == -1000000.0) break;
-                        points[n].x = TIME_TO_X(xn);
-                        CLIP(points[n].x);
-                        sprintf(name, "y%dr", n - 1);
-                        attr = symbol_table.insert_string(name);
-                        double yn = LookupRealAttribute(note, attr, -1000000.0);
-                        if (yn == -1000000.0) break;
-                        points[n].y = data.PitchToY(yn);
-                        n++;
-                     }
-                     dc.DrawPolygon(n, points);
-                  } else if (shape == oval) {
-                     int ix = TIME_TO_X(xx);
-                     CLIP(ix);
-                     int ix1 = TIME_TO_X(x1) - TIME_TO_X(xx);
-                     if (ix1 > CLIP_MAX * 2) ix1 = CLIP_MAX * 2; // CLIP a width
-                     dc.DrawEllipse(ix, yy, ix1, y1 - yy + 1);
-                  } else if (shape == text) {
-                     if (linecolor != -1)
-                        dc.SetTextForeground(wxColour(RED(linecolor),
-                              GREEN(linecolor),
-                              BLUE(linecolor)));
-                     // if no color specified, copy color from brush
-                     else dc.SetTextForeground(dc.GetBrush().GetColour());
-
-                     // This seems to have no effect, so I commented it out. -RBD
-                     //if (fillcolor != -1)
-                     //  dc.SetTextBackground(wxColour(RED(fillcolor),
-                     //                                GREEN(fillcolor),
-                     //                                BLUE(fillcolor)));
-                     //// if no color specified, copy color from brush
-                     //else dc.SetTextBackground(dc.GetPen().GetColour());
-
-                     const char *font = LookupAtomAttribute(note, fonta, NULL);
-                     const char *weight = LookupAtomAttribute(note, weighta, NULL);
-                     int size = LookupIntAttribute(note, sizei, 8);
-                     const char *justify = LookupStringAttribute(note, justifys, "ld");
-                     wxFont wxfont;
-                     wxfont.SetFamily(font == roman ? wxFONTFAMILY_ROMAN :
-                        (font == swiss ? wxFONTFAMILY_SWISS :
-                           (font == modern ? wxFONTFAMILY_MODERN : wxFONTFAMILY_DEFAULT)));
-                     wxfont.SetStyle(wxFONTSTYLE_NORMAL);
-                     wxfont.SetWeight(weight == bold ? wxFONTWEIGHT_BOLD : wxFONTWEIGHT_NORMAL);
-                     wxfont.SetPointSize(size);
-                     dc.SetFont(wxfont);
-
-                     // now do justification
-                     const char *s = LookupStringAttribute(note, texts, "");
-                     wxCoord textWidth, textHeight;
-                     dc.GetTextExtent(wxString::FromUTF8(s), &textWidth, &textHeight);
-                     long hoffset = 0;
-                     long voffset = -textHeight; // default should be baseline of text
-
-                     if (strlen(justify) != 2) justify = "ld";
-
-                     if (justify[0] == 'c') hoffset = -(textWidth/2);
-                     else if (justify[0] == 'r') hoffset = -textWidth;
-
-                     if (justify[1] == 't') voffset = 0;
-                     else if (justify[1] == 'c') voffset = -(textHeight/2);
-                     else if (justify[1] == 'b') voffset = -textHeight;
-                     if (fillflag) {
-                        // It should be possible to do this with background color,
-                        // but maybe because of the transfer mode, no background is
-                        // drawn. To fix this, just draw a rectangle:
-                        dc.SetPen(wxPen(wxColour(RED(fillcolor),
-                              GREEN(fillcolor),
-                              BLUE(fillcolor)),
-                              1, wxPENSTYLE_SOLID));
-                        dc.DrawRectangle(TIME_TO_X(xx) + hoffset, yy + voffset,
-                              textWidth, textHeight);
-                     }
-                     dc.DrawText(LAT1CTOWX(s), TIME_TO_X(xx) + hoffset, yy + voffset);
+                  AColor::Line(dc, TIME_TO_X(xx), yy, TIME_TO_X(x1), y1);
+               } else if (shape == rectangle) {
+                  if (xx < h) { // clip on left, leave 10 pixels to spare
+                     xx = X_TO_TIME(rect.x - (linethick + 10));
+                  }
+                  if (x1 > h1) { // clip on right, leave 10 pixels to spare
+                     xx = X_TO_TIME(rect.x + rect.width + linethick + 10);
+                  }
+                  dc.DrawRectangle(TIME_TO_X(xx), yy, TIME_TO_X(x1) - TIME_TO_X(xx), y1 - yy + 1);
+               } else if (shape == triangle) {
+                  wxPoint points[3];
+                  points[0].x = TIME_TO_X(xx);
+                  CLIP(points[0].x);
+                  points[0].y = yy;
+                  points[1].x = TIME_TO_X(LookupRealAttribute(note, x1r, note->pitch));
+                  CLIP(points[1].x);
+                  points[1].y = y1;
+                  points[2].x = TIME_TO_X(LookupRealAttribute(note, x2r, xx));
+                  CLIP(points[2].x);
+                  points[2].y = data.PitchToY(LookupRealAttribute(note, y2r, note->pitch));
+                  dc.DrawPolygon(3, points);
+               } else if (shape == polygon) {
+                  wxPoint points[20]; // upper bound of 20 sides
+                  points[0].x = TIME_TO_X(xx);
+                  CLIP(points[0].x);
+                  points[0].y = yy;
+                  points[1].x = TIME_TO_X(LookupRealAttribute(note, x1r, xx));
+                  CLIP(points[1].x);
+                  points[1].y = y1;
+                  points[2].x = TIME_TO_X(LookupRealAttribute(note, x2r, xx));
+                  CLIP(points[2].x);
+                  points[2].y = data.PitchToY(LookupRealAttribute(note, y2r, note->pitch));
+                  int n = 3;
+                  while (n < 20) {
+                     char name[8];
+                     sprintf(name, "x%dr", n);
+                     Alg_attribute attr = symbol_table.insert_string(name);
+                     double xn = LookupRealAttribute(note, attr, -1000000.0);
+                     if (xn == -1000000.0) break;
+                     points[n].x = TIME_TO_X(xn);
+                     CLIP(points[n].x);
+                     sprintf(name, "y%dr", n - 1);
+                     attr = symbol_table.insert_string(name);
+                     double yn = LookupRealAttribute(note, attr, -1000000.0);
+                     if (yn == -1000000.0) break;
+                     points[n].y = data.PitchToY(yn);
+                     n++;
+                  }
+                  dc.DrawPolygon(n, points);
+               } else if (shape == oval) {
+                  int ix = TIME_TO_X(xx);
+                  CLIP(ix);
+                  int ix1 = TIME_TO_X(x1) - TIME_TO_X(xx);
+                  if (ix1 > CLIP_MAX * 2) ix1 = CLIP_MAX * 2; // CLIP a width
+                  dc.DrawEllipse(ix, yy, ix1, y1 - yy + 1);
+               } else if (shape == text) {
+                  if (linecolor != -1)
+                     dc.SetTextForeground(wxColour(RED(linecolor),
+                           GREEN(linecolor),
+                           BLUE(linecolor)));
+                  // if no color specified, copy color from brush
+                  else dc.SetTextForeground(dc.GetBrush().GetColour());
+
+                  // This seems to have no effect, so I commented it out. -RBD
+                  //if (fillcolor != -1)
+                  //  dc.SetTextBackground(wxColour(RED(fillcolor),
+                  //                                GREEN(fillcolor),
+                  //                                BLUE(fillcolor)));
+                  //// if no color specified, copy color from brush
+                  //else dc.SetTextBackground(dc.GetPen().GetColour());
+
+                  const char *font = LookupAtomAttribute(note, fonta, NULL);
+                  const char *weight = LookupAtomAttribute(note, weighta, NULL);
+                  int size = LookupIntAttribute(note, sizei, 8);
+                  const char *justify = LookupStringAttribute(note, justifys, "ld");
+                  wxFont wxfont;
+                  wxfont.SetFamily(font == roman ? wxFONTFAMILY_ROMAN :
+                     (font == swiss ? wxFONTFAMILY_SWISS :
+                        (font == modern ? wxFONTFAMILY_MODERN : wxFONTFAMILY_DEFAULT)));
+                  wxfont.SetStyle(wxFONTSTYLE_NORMAL);
+                  wxfont.SetWeight(weight == bold ? wxFONTWEIGHT_BOLD : wxFONTWEIGHT_NORMAL);
+                  wxfont.SetPointSize(size);
+                  dc.SetFont(wxfont);
+
+                  // now do justification
+                  const char *s = LookupStringAttribute(note, texts, "");
+                  wxCoord textWidth, textHeight;
+                  dc.GetTextExtent(wxString::FromUTF8(s), &textWidth, &textHeight);
+                  long hoffset = 0;
+                  long voffset = -textHeight; // default should be baseline of text
+
+                  if (strlen(justify) != 2) justify = "ld";
+
+                  if (justify[0] == 'c') hoffset = -(textWidth/2);
+                  else if (justify[0] == 'r') hoffset = -textWidth;
+
+                  if (justify[1] == 't') voffset = 0;
+                  else if (justify[1] == 'c') voffset = -(textHeight/2);
+                  else if (justify[1] == 'b') voffset = -textHeight;
+                  if (fillflag) {
+                     // It should be possible to do this with background color,
+                     // but maybe because of the transfer mode, no background is
+                     // drawn. To fix this, just draw a rectangle:
+                     dc.SetPen(wxPen(wxColour(RED(fillcolor),
+                           GREEN(fillcolor),
+                           BLUE(fillcolor)),
+                           1, wxPENSTYLE_SOLID));
+                     dc.DrawRectangle(TIME_TO_X(xx) + hoffset, yy + voffset,
+                           textWidth, textHeight);
                   }
+                  dc.DrawText(LAT1CTOWX(s), TIME_TO_X(xx) + hoffset, yy + voffset);
                }
             }
          }
       }
    }
-   iterator.end();
    // draw black line between top/bottom margins and the track
    dc.SetPen(*wxBLACK_PEN);
    AColor::Line(dc, rect.x, rect.y + marg, rect.x + rect.width, rect.y + marg);
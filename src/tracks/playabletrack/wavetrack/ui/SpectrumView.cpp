@@ -27,6 +27,7 @@ Paul Licameli split from WaveTrackView.cpp
 #include "../../../../WaveTrack.h"
 #include "../../../../prefs/SpectrogramSettings.h"
 
+#include <algorithm>
 #include <wx/dcmemory.h>
 #include <wx/graphics.h>
 
@@ -37,6 +38,41 @@ static WaveTrackSubView::Type sType{
 
 static WaveTrackSubViewType::RegisteredType reg{ sType };
 
+struct SpectrumClipImage
+{
+   // Everything the colors of the image depend on, besides the spectrum
+   // pixel cache of the clip
+   struct Key {
+      wxRect mid;
+      double h, zoom;
+      int leftOffset, hiddenLeftOffset;
+      double tOffset, rate;
+      sampleCount ssel0, ssel1;
+      double freqLo, freqHi;
+      bool isSpectral, isGrayscale;
+      unsigned gradientGeneration;
+
+      bool operator == (const Key &other) const
+      {
+         return mid == other.mid &&
+            h == other.h && zoom == other.zoom &&
+            leftOffset == other.leftOffset &&
+            hiddenLeftOffset == other.hiddenLeftOffset &&
+            tOffset == other.tOffset && rate == other.rate &&
+            ssel0 == other.ssel0 && ssel1 == other.ssel1 &&
+            freqLo == other.freqLo && freqHi == other.freqHi &&
+            isSpectral == other.isSpectral &&
+            isGrayscale == other.isGrayscale &&
+            gradientGeneration == other.gradientGeneration;
+      }
+   };
+
+   std::weak_ptr<const WaveClip> clip;
+   // Meaningful only while the bitmap is
+   Key key;
+   wxBitmap bitmap;
+};
+
 SpectrumView::~SpectrumView() = default;
 
 bool SpectrumView::IsSpectral() const
@@ -93,37 +129,16 @@ std::shared_ptr<TrackVRulerControls> SpectrumView::DoGetVRulerControls()
 namespace
 {
 
-static inline float findValue
-(const float *spectrum, float bin0, float bin1, unsigned nBins,
- bool autocorrelation, int gain, int range)
-{
-   float value;
-
-
-#if 0
-   // Averaging method
-   if ((int)(bin1) == (int)(bin0)) {
-      value = spectrum[(int)(bin0)];
-   } else {
-      float binwidth= bin1 - bin0;
-      value = spectrum[(int)(bin0)] * (1.f - bin0 + (int)bin0);
-
-      bin0 = 1 + (int)(bin0);
-      while (bin0 < (int)(bin1)) {
-         value += spectrum[(int)(bin0)];
-         bin0 += 1.0;
-      }
-      // Do not reference past end of freq array.
-      if ((int)(bin1) >= (int)nBins) {
-         bin1 -= 1.0;
-      }
+// findValue takes the maximum of these bins for a pixel row, and no
+// apportionment of any single bins over multiple pixel rows (see Bug971).
+// They depend only on the row, so drawing finds them once for all columns.
+struct RowBins {
+   int index, limitIndex;
+};
 
-      value += spectrum[(int)(bin1)] * (bin1 - (int)(bin1));
-      value /= binwidth;
-   }
-#else
-   // Maximum method, and no apportionment of any single bins over multiple pixel rows
-   // See Bug971
+static inline RowBins findRowBins
+(float bin0, float bin1, unsigned nBins, bool autocorrelation)
+{
    int index, limitIndex;
    if (autocorrelation) {
       // bin = 2 * nBins / (nBins - 1 - array_index);
@@ -139,10 +154,17 @@ static inline float findValue
       index = std::min<int>(nBins - 1, (int)(floor(0.5 + bin0)));
       limitIndex = std::min<int>(nBins, (int)(floor(0.5 + bin1)));
    }
-   value = spectrum[index];
-   while (++index < limitIndex)
+   return { index, limitIndex };
+}
+
+static inline float findValue
+(const float *spectrum, RowBins rowBins,
+ bool autocorrelation, int gain, int range)
+{
+   auto index = rowBins.index;
+   float value = spectrum[index];
+   while (++index < rowBins.limitIndex)
       value = std::max(value, spectrum[index]);
-#endif
    if (!autocorrelation) {
       // Last step converts dB to a 0.0-1.0 range
       value = (value + range + gain) / (double)range;
@@ -174,7 +196,8 @@ ChooseColorSet( float bin0, float bin1, float selBinLo,
 void DrawClipSpectrum(TrackPanelDrawingContext &context,
                                    WaveTrackCache &waveTrackCache,
                                    const WaveClip *clip,
-                                   const wxRect & rect)
+                                   const wxRect & rect,
+                                   SpectrumClipImage &clipImage)
 {
    auto &dc = context.dc;
    const auto artist = TrackArtist::Get( context );
@@ -197,6 +220,7 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    // The "hiddenMid" rect contains the part of the display actually
    // containing the waveform, as it appears without the fisheye.  If it's empty, we're done.
    if (hiddenMid.width <= 0) {
+      clipImage.bitmap = wxBitmap{};
       return;
    }
 
@@ -237,19 +261,6 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
 
    dc.SetPen(*wxTRANSPARENT_PEN);
 
-   // We draw directly to a bit image in memory,
-   // and then paint this directly to our offscreen
-   // bitmap.  Note that this could be optimized even
-   // more, but for now this is not bad.  -dmazzoni
-   wxImage image((int)mid.width, (int)mid.height);
-   if (!image.IsOk())
-      return;
-#ifdef EXPERIMENTAL_SPECTROGRAM_OVERLAY
-   image.SetAlpha();
-   unsigned char *alpha = image.GetAlpha();
-#endif
-   unsigned char *data = image.GetData();
-
    const auto half = settings.GetFFTLength() / 2;
    const double binUnit = rate / (2 * half);
    const float *freq = 0;
@@ -287,6 +298,11 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
       bins[yy] = nextBin;
    }
 
+   // The bins shown in each row are the same in every column
+   std::vector<RowBins> rowBins(hiddenMid.height);
+   for (int yy = 0; yy < hiddenMid.height; ++yy)
+      rowBins[yy] = findRowBins(bins[yy], bins[yy + 1], nBins, autocorrelation);
+
 #ifdef EXPERIMENTAL_FFT_Y_GRID
    const float
       log2 = logf(2.0f),
@@ -308,7 +324,8 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    }
 #endif //EXPERIMENTAL_FFT_Y_GRID
 
-   if (!updated && clip->mSpecPxCache->valid &&
+   const bool pixelsReused =
+      !updated && clip->mSpecPxCache->valid &&
       ((int)clip->mSpecPxCache->len == hiddenMid.height * hiddenMid.width)
       && scaleType == clip->mSpecPxCache->scaleType
       && gain == clip->mSpecPxCache->gain
@@ -324,7 +341,8 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    && numberOfMaxima == artist->findNotesNOld
    && findNotesQuantize == artist->findNotesQuantizeOld
 #endif
-   ) {
+   ;
+   if (pixelsReused) {
       // Wave clip's spectrum cache is up to date,
       // and so is the spectrum pixel cache
    }
@@ -436,12 +454,9 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
 #endif //EXPERIMENTAL_FIND_NOTES
 
          for (int yy = 0; yy < hiddenMid.height; ++yy) {
-            const float bin     = bins[yy];
-            const float nextBin = bins[yy+1];
-
             if (settings.scaleType != SpectrogramSettings::stLogarithmic) {
                const float value = findValue
-                  (freq + nBins * xx, bin, nextBin, nBins, autocorrelation, gain, range);
+                  (freq + nBins * xx, rowBins[yy], autocorrelation, gain, range);
                clip->mSpecPxCache->values[xx * hiddenMid.height + yy] = value;
             }
             else {
@@ -457,7 +472,7 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
                      if (inMaximum) {
                         float i1 = maxima1[it];
                         if (yy + 1 <= i1) {
-                           value = findValue(freq + x0, bin, nextBin, nBins, autocorrelation, gain, range);
+                           value = findValue(freq + x0, rowBins[yy], autocorrelation, gain, range);
                            if (value < findNotesMinA)
                               value = minColor;
                         }
@@ -478,7 +493,7 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
 #endif //EXPERIMENTAL_FIND_NOTES
                {
                   value = findValue
-                     (freq + nBins * xx, bin, nextBin, nBins, autocorrelation, gain, range);
+                     (freq + nBins * xx, rowBins[yy], autocorrelation, gain, range);
                }
                clip->mSpecPxCache->values[xx * hiddenMid.height + yy] = value;
             } // logF
@@ -525,9 +540,54 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    if (!AColor::gradient_inited)
       AColor::PreComputeGradient();
 
+   // If the pixels are the same, and so is everything else that colors
+   // them, the image drawn last time will do
+   const SpectrumClipImage::Key key{
+      mid, zoomInfo.h, zoomInfo.GetZoom(), leftOffset, hiddenLeftOffset,
+      tOffset, rate, ssel0, ssel1, freqLo, freqHi,
+      isSpectral, isGrayscale, AColor::gradient_generation };
+   if (pixelsReused && hidden &&
+       clipImage.bitmap.IsOk() && clipImage.key == key) {
+      wxMemoryDC memDC;
+      memDC.SelectObject(clipImage.bitmap);
+      dc.Blit(mid.x, mid.y, mid.width, mid.height,
+         &memDC, 0, 0, wxCOPY, FALSE);
+      params.DrawClipEdges( dc, rect );
+      return;
+   }
+
+   // We draw directly to a bit image in memory,
+   // and then paint this directly to our offscreen
+   // bitmap.  Note that this could be optimized even
+   // more, but for now this is not bad.  -dmazzoni
+   wxImage image((int)mid.width, (int)mid.height);
+   if (!image.IsOk())
+      return;
+#ifdef EXPERIMENTAL_SPECTROGRAM_OVERLAY
+   image.SetAlpha();
+   unsigned char *alpha = image.GetAlpha();
+#endif
+   unsigned char *data = image.GetData();
+
    // left pixel column of the fisheye
    int fisheyeLeft = zoomInfo.GetFisheyeLeftBoundary(-leftOffset);
 
+   // For spectral selection, determine what colour
+   // set to use for each row.  We use a darker selection if
+   // in both spectral range and time range.  Only the dashes of the
+   // edges vary with the column.
+   using ColorGradientChoices = std::vector<AColor::ColorGradientChoice>;
+   ColorGradientChoices unselectedChoices(
+      hiddenMid.height, AColor::ColorGradientUnselected);
+   ColorGradientChoices dashChoices(hiddenMid.height);
+   ColorGradientChoices gapChoices(hiddenMid.height);
+   for (int yy = 0; yy < hiddenMid.height; ++yy) {
+      dashChoices[yy] = ChooseColorSet(bins[yy], bins[yy + 1],
+         selBinLo, selBinCenter, selBinHi, 0, isSpectral);
+      gapChoices[yy] = ChooseColorSet(bins[yy], bins[yy + 1],
+         selBinLo, selBinCenter, selBinHi, 1, isSpectral);
+   }
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -557,28 +617,22 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
 
       bool maybeSelected = ssel0 <= w0 && w1 < ssel1;
 
-      for (int yy = 0; yy < hiddenMid.height; ++yy) {
-         const float bin     = bins[yy];
-         const float nextBin = bins[yy+1];
+      // If we are in the time selected range, then we may use a different color set.
+      const int dashCount = (xx + leftOffset - hiddenLeftOffset) / DASH_LENGTH;
+      const auto &choices = !maybeSelected ? unselectedChoices
+         : (0 == dashCount % 2) ? dashChoices
+         : gapChoices;
 
-         // For spectral selection, determine what colour
-         // set to use.  We use a darker selection if
-         // in both spectral range and time range.
-
-         AColor::ColorGradientChoice selected = AColor::ColorGradientUnselected;
-
-         // If we are in the time selected range, then we may use a different color set.
-         if (maybeSelected)
-            selected =
-               ChooseColorSet(bin, nextBin, selBinLo, selBinCenter, selBinHi,
-                  (xx + leftOffset - hiddenLeftOffset) / DASH_LENGTH, isSpectral);
+      const float *const cached = uncached ? nullptr
+         : &clip->mSpecPxCache->values[correctedX * hiddenMid.height];
 
+      for (int yy = 0; yy < hiddenMid.height; ++yy) {
          const float value = uncached
-            ? findValue(uncached, bin, nextBin, nBins, autocorrelation, gain, range)
-            : clip->mSpecPxCache->values[correctedX * hiddenMid.height + yy];
+            ? findValue(uncached, rowBins[yy], autocorrelation, gain, range)
+            : cached[yy];
 
          unsigned char rv, gv, bv;
-         GetColorGradient(value, selected, isGrayscale, &rv, &gv, &bv);
+         GetColorGradient(value, choices[yy], isGrayscale, &rv, &gv, &bv);
 
 #ifdef EXPERIMENTAL_FFT_Y_GRID
          if (fftYGrid && yGrid[yy]) {
@@ -602,11 +656,21 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
 
    wxBitmap converted = wxBitmap(image);
 
-   wxMemoryDC memDC;
+   {
+      wxMemoryDC memDC;
+
+      memDC.SelectObject(converted);
 
-   memDC.SelectObject(converted);
+      dc.Blit(mid.x, mid.y, mid.width, mid.height, &memDC, 0, 0, wxCOPY, FALSE);
+   }
 
-   dc.Blit(mid.x, mid.y, mid.width, mid.height, &memDC, 0, 0, wxCOPY, FALSE);
+   // Fisheye columns are computed anew each time, so keep no image of them
+   if (hidden) {
+      clipImage.key = key;
+      clipImage.bitmap = converted;
+   }
+   else
+      clipImage.bitmap = wxBitmap{};
 
    // Draw clip edges, as also in waveform view, which improves the appearance
    // of split views
@@ -626,12 +690,59 @@ void SpectrumView::DoDraw( TrackPanelDrawingContext &context,
       context, rect, track, blankSelectedBrush, blankBrush );
 
    WaveTrackCache cache(track->SharedPointer<const WaveTrack>());
-   for (const auto &clip: track->GetClips())
-      DrawClipSpectrum( context, cache, clip.get(), rect );
+
+   // Keep the images only of the clips drawn this time
+   decltype(mClipImages) clipImages;
+   for (const auto &clip: track->GetClips()) {
+      const auto end = mClipImages.end();
+      auto iter = std::find_if(mClipImages.begin(), end,
+         [&](const std::unique_ptr<SpectrumClipImage> &pImage){
+            return pImage && pImage->clip.lock() == clip; });
+      clipImages.push_back( iter == end
+         ? std::make_unique<SpectrumClipImage>()
+         : std::move(*iter) );
+      auto &clipImage = *clipImages.back();
+      clipImage.clip = clip;
+      DrawClipSpectrum( context, cache, clip.get(), rect, clipImage );
+   }
+   mClipImages.swap(clipImages);
 
    DrawBoldBoundaries( context, track, rect );
 }
 
+void SpectrumView::PrepareDraw(
+   TrackPanelDrawingContext &context, const wxRect &rect )
+{
+   const auto pTrack = FindTrack();
+   if (!pTrack)
+      return;
+   const auto wt = std::static_pointer_cast<const WaveTrack>(
+      pTrack->SubstitutePendingChangedTrack());
+
+   const auto artist = TrackArtist::Get( context );
+   const auto &selectedRegion = *artist->pSelectedRegion;
+   const auto &zoomInfo = *artist->pZoomInfo;
+
+   // Compute the columns that DrawClipSpectrum will ask for, so that it
+   // finds them in the clip's cache
+   WaveTrackCache cache(wt);
+   for (const auto &clip : wt->GetClips()) {
+      const ClipParameters params{
+         true, wt.get(), clip.get(), rect, selectedRegion, zoomInfo };
+      if (params.hiddenMid.width <= 0)
+         continue;
+
+      const float *freq = 0;
+      const sampleCount *where = 0;
+      if (clip->GetSpectrogram(cache, freq, where,
+            (size_t)params.hiddenMid.width, params.t0,
+            params.averagePixelsPerSample * params.rate))
+         // Else DrawClipSpectrum, seeing the columns cached, would take the
+         // old pixels for them
+         clip->mSpecPxCache->valid = false;
+   }
+}
+
 void SpectrumView::Draw(
    TrackPanelDrawingContext &context, const wxRect &rect, unsigned iPass )
 {
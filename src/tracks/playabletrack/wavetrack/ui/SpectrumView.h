@@ -14,6 +14,7 @@ Paul Licameli split from WaveTrackView.h
 #include "WaveTrackView.h" // to inherit
 
 class WaveTrack;
+struct SpectrumClipImage;
 
 class SpectrumView final : public WaveTrackSubView
 {
@@ -31,15 +32,22 @@ public:
    bool IsSpectral() const override;
 
 private:
+   void PrepareDraw(
+      TrackPanelDrawingContext &context, const wxRect &rect ) override;
+
    // TrackPanelDrawable implementation
    void Draw(
       TrackPanelDrawingContext &context,
       const wxRect &rect, unsigned iPass ) override;
 
-   static void DoDraw( TrackPanelDrawingContext &context,
+   void DoDraw( TrackPanelDrawingContext &context,
       const WaveTrack *track,
       const wxRect & rect );
 
+   // The image last drawn of each visible clip, so that repainting one
+   // that has not changed is only a blit
+   std::vector< std::unique_ptr< SpectrumClipImage > > mClipImages;
+
    std::vector<UIHandlePtr> DetailedHitTest(
       const TrackPanelMouseState &state,
       const AudacityProject *pProject, int currentTool, bool bMultiTool )
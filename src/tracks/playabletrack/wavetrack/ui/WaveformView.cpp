@@ -35,6 +35,11 @@ Paul Licameli split from WaveTrackView.cpp
 
 #include <wx/graphics.h>
 #include <wx/dc.h>
+#include <wx/dcmemory.h>
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
 
 static WaveTrackSubView::Type sType{
    WaveTrackViewConstants::Waveform,
@@ -315,12 +320,248 @@ void FindWavePortions
    }
 }
 
+// Whether some portion outside any fisheye shows samples, not min/max/rms,
+// and so needs no wave display
+bool ShowsIndividualSamples(
+   const std::vector<WavePortion> &portions, double rate)
+{
+   // Require at least 1/2 pixel per sample for drawing individual samples.
+   const double threshold1 = 0.5 * rate;
+   return std::any_of(portions.begin(), portions.end(),
+      [&](const WavePortion &portion){
+         return !portion.inFisheye && portion.averageZoom > threshold1; });
+}
+
+namespace {
+
+// Geometry of one pixel column of the min/max/rms display, in pixels
+// relative to the top of the drawing rectangle
+struct WaveColumn
+{
+   int h1, h2;
+   int r1, r2;
+   bool clipped;
+
+   bool operator == (const WaveColumn &other) const
+   {
+      return h1 == other.h1 && h2 == other.h2 &&
+         r1 == other.r1 && r2 == other.r2 &&
+         clipped == other.clipped;
+   }
+};
+
+using WaveColumns = std::vector<WaveColumn>;
+
+struct WaveColumnPens
+{
+   const wxPen &samplePen;
+   const wxPen &rmsPen;
+   const wxPen &clippedPen;
+};
+
+// Draw columns [begin, end) with column x0 appearing at xOrigin + x0.
+// Columns with bl <= -1 get the on-demand loading pattern instead.
+void DrawWaveColumns(
+   wxDC &dc, const WaveColumn columns[], const int *bl,
+   const WaveColumnPens &pens,
+   const wxPen &loadingPen, const wxPen &altLoadingPen,
+   int begin, int end, int xOrigin, int yOrigin, int height,
+   long pixAnimOffset)
+{
+   bool drawStripes = true;
+   bool drawWaveform = true;
+
+   dc.SetPen(pens.samplePen);
+   for (int x0 = begin; x0 < end; ++x0) {
+      int xx = xOrigin + x0;
+      const auto &column = columns[x0];
+      if (bl && bl[x0] <= -1) {
+         if (drawStripes) {
+            // TODO:unify with buffer drawing.
+            dc.SetPen((bl[x0] % 2) ? altLoadingPen : loadingPen);
+            for (int yy = 0; yy < height / 25 + 1; ++yy) {
+               // we are drawing over the buffer, but I think DrawLine takes care of this.
+               AColor::Line(dc,
+                            xx,
+                            yOrigin + 25 * yy + (x0 /*+pixAnimOffset*/) % 25,
+                            xx,
+                            yOrigin + 25 * yy + (x0 /*+pixAnimOffset*/) % 25 + 6); //take the min so we don't draw past the edge
+            }
+         }
+
+         // draw a dummy waveform - some kind of sinusoid.  We want to animate it so the user knows it's a dummy.  Use the second's unit of a get time function.
+         // Lets use a triangle wave for now since it's easier - I don't want to use sin() or make a wavetable just for this.
+         if (drawWaveform) {
+            int triX;
+            dc.SetPen(loadingPen);
+            triX = fabs((double)((x0 + pixAnimOffset) % (2 * height)) - height) + height;
+            for (int yy = 0; yy < height; ++yy) {
+               if ((yy + triX) % height == 0) {
+                  dc.DrawPoint(xx, yOrigin + yy);
+               }
+            }
+         }
+
+         // Restore the pen for remaining pixel columns!
+         dc.SetPen(pens.samplePen);
+      }
+      else {
+         AColor::Line(dc, xx, yOrigin + column.h2, xx, yOrigin + column.h1);
+      }
+   }
+
+   // Stroke rms over the min-max
+   dc.SetPen(pens.rmsPen);
+   for (int x0 = begin; x0 < end; ++x0) {
+      int xx = xOrigin + x0;
+      const auto &column = columns[x0];
+      if (bl && bl[x0] <= -1) {
+      }
+      else if (column.r1 != column.r2) {
+         AColor::Line(dc, xx, yOrigin + column.r2, xx, yOrigin + column.r1);
+      }
+   }
+
+   // Draw the clipping lines
+   bool penSet = false;
+   for (int x0 = begin; x0 < end; ++x0) {
+      if (columns[x0].clipped) {
+         if (!penSet) {
+            dc.SetPen(pens.clippedPen);
+            penSet = true;
+         }
+         int xx = xOrigin + x0;
+         AColor::Line(dc, xx, yOrigin, xx, yOrigin + height);
+      }
+   }
+}
+
+// Bitmaps of already drawn runs of columns, so that scrolling mostly blits.
+// A tile is found again only by the exact column geometry and pens it was
+// drawn from, so a change of samples, zoom, envelope or colours simply
+// misses the cache and no explicit invalidation is needed.
+class WaveTileCache
+{
+public:
+   // Columns per tile, counted from the pixel position of time zero
+   enum : int { TileWidth = 256 };
+
+   // Bound on the total area of cached bitmaps
+   enum : size_t { MaxPixels = 16 * 1024 * 1024 };
+
+   // Never used by the artist's pens, so it can serve as transparency
+   static const wxColour &MaskColour()
+   {
+      static const wxColour colour{ 255, 0, 255 };
+      return colour;
+   }
+
+   struct Key
+   {
+      int height;
+      wxUint32 sampleColour, rmsColour, clippedColour;
+      WaveColumns columns;
+
+      bool operator == (const Key &other) const
+      {
+         return height == other.height &&
+            sampleColour == other.sampleColour &&
+            rmsColour == other.rmsColour &&
+            clippedColour == other.clippedColour &&
+            columns == other.columns;
+      }
+
+      size_t Hash() const
+      {
+         // FNV-1a
+         size_t result = 2166136261u;
+         const auto mix = [&](size_t value){
+            result = (result ^ value) * 16777619u;
+         };
+         mix(height);
+         mix(sampleColour);
+         mix(rmsColour);
+         mix(clippedColour);
+         for (const auto &column : columns) {
+            mix(column.h1);
+            mix(column.h2);
+            mix(column.r1);
+            mix(column.r2);
+            mix(column.clipped);
+         }
+         return result;
+      }
+   };
+
+   static WaveTileCache &Get()
+   {
+      static WaveTileCache theCache;
+      return theCache;
+   }
+
+   // Returns null if not found
+   const wxBitmap *Find(const Key &key, size_t hash)
+   {
+      const auto range = mIndex.equal_range(hash);
+      for (auto iter = range.first; iter != range.second; ++iter) {
+         const auto entry = iter->second;
+         if (entry->key == key) {
+            // Most recently used goes to the front
+            mEntries.splice(mEntries.begin(), mEntries, entry);
+            return &entry->bitmap;
+         }
+      }
+      return nullptr;
+   }
+
+   const wxBitmap &Store(Key &&key, size_t hash, wxBitmap &&bitmap)
+   {
+      mPixels += size_t(bitmap.GetWidth()) * bitmap.GetHeight();
+      mEntries.push_front({ hash, std::move(key), std::move(bitmap) });
+      mIndex.emplace(hash, mEntries.begin());
+
+      // Evict least recently used tiles, but never the one just made
+      while (mPixels > MaxPixels && mEntries.size() > 1) {
+         const auto last = std::prev(mEntries.end());
+         const auto range = mIndex.equal_range(last->hash);
+         for (auto iter = range.first; iter != range.second; ++iter) {
+            if (iter->second == last) {
+               mIndex.erase(iter);
+               break;
+            }
+         }
+         mPixels -=
+            size_t(last->bitmap.GetWidth()) * last->bitmap.GetHeight();
+         mEntries.erase(last);
+      }
+
+      return mEntries.front().bitmap;
+   }
+
+private:
+   struct Entry
+   {
+      size_t hash;
+      Key key;
+      wxBitmap bitmap;
+   };
+   using Entries = std::list<Entry>;
+
+   Entries mEntries;
+   std::unordered_multimap<size_t, Entries::iterator> mIndex;
+   size_t mPixels{ 0 };
+};
+
+}
+
+// tileOrigin is the horizontal pixel position of time zero, which fixes
+// the tile boundaries in the cache independently of scrolling
 void DrawMinMaxRMS(
    TrackPanelDrawingContext &context, const wxRect & rect, const double env[],
    float zoomMin, float zoomMax,
    bool dB, float dBRange,
    const float *min, const float *max, const float *rms, const int *bl,
-   bool /* showProgress */, bool muted)
+   bool /* showProgress */, bool muted, wxInt64 tileOrigin)
 {
    auto &dc = context.dc;
 
@@ -330,47 +571,28 @@ void DrawMinMaxRMS(
    int lasth2 = std::numeric_limits<int>::min();
    int h1;
    int h2;
-   ArrayOf<int> r1{ size_t(rect.width) };
-   ArrayOf<int> r2{ size_t(rect.width) };
-   ArrayOf<int> clipped;
-   int clipcnt = 0;
+   WaveColumns columns( rect.width );
 
    const auto artist = TrackArtist::Get( context );
    const auto bShowClipping = artist->mShowClipping;
-   if (bShowClipping) {
-      clipped.reinit( size_t(rect.width) );
-   }
 
    long pixAnimOffset = (long)fabs((double)(wxDateTime::Now().GetTicks() * -10)) +
       wxDateTime::Now().GetMillisecond() / 100; //10 pixels a second
 
-   bool drawStripes = true;
-   bool drawWaveform = true;
-
-   const auto &muteSamplePen = artist->muteSamplePen;
-   const auto &samplePen = artist->samplePen;
-
-   dc.SetPen(muted ? muteSamplePen : samplePen);
+   bool anyLoading = false;
    for (int x0 = 0; x0 < rect.width; ++x0) {
-      int xx = rect.x + x0;
+      auto &column = columns[x0];
+      column.clipped = false;
       double v;
       v = min[x0] * env[x0];
-      if (clipped && bShowClipping && (v <= -MAX_AUDIO))
-      {
-         if (clipcnt == 0 || clipped[clipcnt - 1] != xx) {
-            clipped[clipcnt++] = xx;
-         }
-      }
+      if (bShowClipping && (v <= -MAX_AUDIO))
+         column.clipped = true;
       h1 = GetWaveYPos(v, zoomMin, zoomMax,
                        rect.height, dB, true, dBRange, true);
 
       v = max[x0] * env[x0];
-      if (clipped && bShowClipping && (v >= MAX_AUDIO))
-      {
-         if (clipcnt == 0 || clipped[clipcnt - 1] != xx) {
-            clipped[clipcnt++] = xx;
-         }
-      }
+      if (bShowClipping && (v >= MAX_AUDIO))
+         column.clipped = true;
       h2 = GetWaveYPos(v, zoomMin, zoomMax,
                        rect.height, dB, true, dBRange, true);
 
@@ -386,82 +608,126 @@ void DrawMinMaxRMS(
       }
       lasth1 = h1;
       lasth2 = h2;
+      column.h1 = h1;
+      column.h2 = h2;
 
-      r1[x0] = GetWaveYPos(-rms[x0] * env[x0], zoomMin, zoomMax,
+      auto &r1 = column.r1;
+      auto &r2 = column.r2;
+      r1 = GetWaveYPos(-rms[x0] * env[x0], zoomMin, zoomMax,
                           rect.height, dB, true, dBRange, true);
-      r2[x0] = GetWaveYPos(rms[x0] * env[x0], zoomMin, zoomMax,
+      r2 = GetWaveYPos(rms[x0] * env[x0], zoomMin, zoomMax,
                           rect.height, dB, true, dBRange, true);
       // Make sure the rms isn't larger than the waveform min/max
-      if (r1[x0] > h1 - 1) {
-         r1[x0] = h1 - 1;
+      if (r1 > h1 - 1) {
+         r1 = h1 - 1;
       }
-      if (r2[x0] < h2 + 1) {
-         r2[x0] = h2 + 1;
+      if (r2 < h2 + 1) {
+         r2 = h2 + 1;
       }
-      if (r2[x0] > r1[x0]) {
-         r2[x0] = r1[x0];
+      if (r2 > r1) {
+         r2 = r1;
       }
 
-      if (bl[x0] <= -1) {
-         if (drawStripes) {
-            // TODO:unify with buffer drawing.
-            dc.SetPen((bl[x0] % 2) ? muteSamplePen : samplePen);
-            for (int yy = 0; yy < rect.height / 25 + 1; ++yy) {
-               // we are drawing over the buffer, but I think DrawLine takes care of this.
-               AColor::Line(dc,
-                            xx,
-                            rect.y + 25 * yy + (x0 /*+pixAnimOffset*/) % 25,
-                            xx,
-                            rect.y + 25 * yy + (x0 /*+pixAnimOffset*/) % 25 + 6); //take the min so we don't draw past the edge
-            }
-         }
+      if (bl[x0] <= -1)
+         anyLoading = true;
+   }
 
-         // draw a dummy waveform - some kind of sinusoid.  We want to animate it so the user knows it's a dummy.  Use the second's unit of a get time function.
-         // Lets use a triangle wave for now since it's easier - I don't want to use sin() or make a wavetable just for this.
-         if (drawWaveform) {
-            int triX;
-            dc.SetPen(samplePen);
-            triX = fabs((double)((x0 + pixAnimOffset) % (2 * rect.height)) - rect.height) + rect.height;
-            for (int yy = 0; yy < rect.height; ++yy) {
-               if ((yy + triX) % rect.height == 0) {
-                  dc.DrawPoint(xx, rect.y + yy);
-               }
-            }
-         }
+   const auto &muteSamplePen = artist->muteSamplePen;
+   const auto &samplePen = artist->samplePen;
+   const WaveColumnPens pens{
+      muted ? muteSamplePen : samplePen,
+      muted ? artist->muteRmsPen : artist->rmsPen,
+      muted ? artist->muteClippedPen : artist->clippedPen,
+   };
 
-         // Restore the pen for remaining pixel columns!
-         dc.SetPen(muted ? muteSamplePen : samplePen);
-      }
-      else {
-         AColor::Line(dc, xx, rect.y + h2, xx, rect.y + h1);
-      }
+   // Only the screen buffer gets tiles; printing and other devices still
+   // receive plain lines.  The loading pattern is animated, so those
+   // columns are never cached.
+   const auto &mask = WaveTileCache::MaskColour();
+   const bool useTiles = wxDynamicCast(&dc, wxMemoryDC) &&
+      pens.samplePen.GetColour() != mask &&
+      pens.rmsPen.GetColour() != mask &&
+      pens.clippedPen.GetColour() != mask;
+   if (!useTiles) {
+      DrawWaveColumns(dc, columns.data(), anyLoading ? bl : nullptr,
+         pens, samplePen, muteSamplePen, 0, rect.width, rect.x, rect.y, rect.height,
+         pixAnimOffset);
+      return;
    }
 
-   // Stroke rms over the min-max
-   const auto &muteRmsPen = artist->muteRmsPen;
-   const auto &rmsPen = artist->rmsPen;
-
-   dc.SetPen(muted ? muteRmsPen : rmsPen);
-   for (int x0 = 0; x0 < rect.width; ++x0) {
-      int xx = rect.x + x0;
-      if (bl[x0] <= -1) {
+   // Lines may reach one pixel beyond either edge of the rectangle, so
+   // tiles are two pixels taller
+   const int tileHeight = rect.height + 2;
+   auto &cache = WaveTileCache::Get();
+   const int tileWidth = WaveTileCache::TileWidth;
+   const wxInt64 firstColumn = rect.x - tileOrigin;
+   for (int begin = 0; begin < rect.width;) {
+      const auto phase = int(
+         ((firstColumn + begin) % tileWidth + tileWidth) % tileWidth);
+      const int end = std::min(rect.width, begin + tileWidth - phase);
+      bool whole = (phase == 0 && end - begin == tileWidth);
+      if (whole && anyLoading)
+         whole = std::none_of(bl + begin, bl + end,
+            [](int b){ return b <= -1; });
+
+      if (!whole) {
+         // Partial tiles at the edges are cheap enough to draw directly
+         DrawWaveColumns(dc, columns.data(), anyLoading ? bl : nullptr,
+            pens, samplePen, muteSamplePen, begin, end, rect.x, rect.y, rect.height,
+            pixAnimOffset);
+         begin = end;
+         continue;
       }
-      else if (r1[x0] != r2[x0]) {
-         AColor::Line(dc, xx, rect.y + r2[x0], xx, rect.y + r1[x0]);
+
+      WaveTileCache::Key key{ rect.height,
+         pens.samplePen.GetColour().GetRGB(),
+         pens.rmsPen.GetColour().GetRGB(),
+         pens.clippedPen.GetColour().GetRGB(),
+         WaveColumns( columns.begin() + begin, columns.begin() + end ) };
+      const auto hash = key.Hash();
+      auto pBitmap = cache.Find(key, hash);
+      if (!pBitmap) {
+         wxBitmap bitmap{ tileWidth, tileHeight };
+         {
+            wxMemoryDC memDC;
+            memDC.SelectObject(bitmap);
+            memDC.SetBackground(wxBrush(mask));
+            memDC.Clear();
+            DrawWaveColumns(memDC, key.columns.data(), nullptr,
+               pens, samplePen, muteSamplePen, 0, tileWidth, 0, 1, rect.height,
+               pixAnimOffset);
+            memDC.SelectObject(wxNullBitmap);
+         }
+         bitmap.SetMask(safenew wxMask(bitmap, mask));
+         pBitmap = &cache.Store(std::move(key), hash, std::move(bitmap));
       }
+      dc.DrawBitmap(*pBitmap, rect.x + begin, rect.y - 1, true);
+      begin = end;
    }
+}
 
-   // Draw the clipping lines
-   if (clipcnt) {
-      const auto &muteClippedPen = artist->muteClippedPen;
-      const auto &clippedPen = artist->clippedPen;
+// Find the samples of the clip to be drawn individually in a rectangle of
+// the given width; return false if there are none
+bool FindIndividualSamples(const ZoomInfo &zoomInfo, const WaveClip *clip,
+                           int leftOffset, int width,
+                           sampleCount &s0, size_t &slen)
+{
+   const double toffset = clip->GetOffset();
+   double rate = clip->GetRate();
+   const double t0 = std::max(0.0, zoomInfo.PositionToTime(0, -leftOffset) - toffset);
+   s0 = sampleCount(floor(t0 * rate));
+   const auto snSamples = clip->GetNumSamples();
+   if (s0 > snSamples)
+      return false;
 
-      dc.SetPen(muted ? muteClippedPen : clippedPen);
-      while (--clipcnt >= 0) {
-         int xx = clipped[clipcnt];
-         AColor::Line(dc, xx, rect.y, xx, rect.y + rect.height);
-      }
-   }
+   const double t1 = zoomInfo.PositionToTime(width - 1, -leftOffset) - toffset;
+   const auto s1 = sampleCount(ceil(t1 * rate));
+
+   // Assume size_t will not overflow, else we wouldn't be here drawing the
+   // few individual samples
+   slen = std::min(snSamples - s0, s1 - s0 + 1).as_size_t();
+
+   return slen > 0;
 }
 
 void DrawIndividualSamples(TrackPanelDrawingContext &context,
@@ -478,26 +744,15 @@ void DrawIndividualSamples(TrackPanelDrawingContext &context,
 
    const double toffset = clip->GetOffset();
    double rate = clip->GetRate();
-   const double t0 = std::max(0.0, zoomInfo.PositionToTime(0, -leftOffset) - toffset);
-   const auto s0 = sampleCount(floor(t0 * rate));
-   const auto snSamples = clip->GetNumSamples();
-   if (s0 > snSamples)
-      return;
-
-   const double t1 = zoomInfo.PositionToTime(rect.width - 1, -leftOffset) - toffset;
-   const auto s1 = sampleCount(ceil(t1 * rate));
-
-   // Assume size_t will not overflow, else we wouldn't be here drawing the
-   // few individual samples
-   auto slen = std::min(snSamples - s0, s1 - s0 + 1).as_size_t();
-
-   if (slen <= 0)
+   sampleCount s0;
+   size_t slen;
+   if (!FindIndividualSamples(zoomInfo, clip, leftOffset, rect.width,
+                              s0, slen))
       return;
 
+   // Usually finds the samples that PrepareDraw already fetched
    Floats buffer{ size_t(slen) };
-   clip->GetSamples((samplePtr)buffer.get(), floatSample, s0, slen,
-                    // Suppress exceptions in this drawing operation:
-                    false);
+   clip->GetDisplaySamples(buffer.get(), s0, slen);
 
    ArrayOf<int> xpos{ size_t(slen) };
    ArrayOf<int> ypos{ size_t(slen) };
@@ -765,14 +1020,7 @@ void DrawClipWaveform(TrackPanelDrawingContext &context,
    const double threshold2 = 3 * rate;
 
    {
-      bool showIndividualSamples = false;
-      for (unsigned ii = 0; !showIndividualSamples && ii < nPortions; ++ii) {
-         const WavePortion &portion = portions[ii];
-         showIndividualSamples =
-            !portion.inFisheye && portion.averageZoom > threshold1;
-      }
-
-      if (!showIndividualSamples) {
+      if (!ShowsIndividualSamples(portions, rate)) {
          // The WaveClip class handles the details of computing the shape
          // of the waveform.  The only way GetWaveDisplay will fail is if
          // there's a serious error, like some of the waveform data can't
@@ -870,7 +1118,8 @@ void DrawClipWaveform(TrackPanelDrawingContext &context,
                zoomMin, zoomMax,
                dB, dBRange,
                useMin, useMax, useRms, useBl,
-               isLoadingOD, muted );
+               isLoadingOD, muted,
+               rect.x + zoomInfo.TimeToPosition(0.0) );
          }
          else {
             bool highlight = false;
@@ -1003,6 +1252,62 @@ void WaveformView::DoDraw(TrackPanelDrawingContext &context,
    }
 }
 
+void WaveformView::PrepareDraw(
+   TrackPanelDrawingContext &context, const wxRect &rect )
+{
+   const auto pTrack = FindTrack();
+   if (!pTrack)
+      return;
+   const auto wt = std::static_pointer_cast<const WaveTrack>(
+      pTrack->SubstitutePendingChangedTrack());
+
+   const auto artist = TrackArtist::Get( context );
+   const auto &selectedRegion = *artist->pSelectedRegion;
+   const auto &zoomInfo = *artist->pZoomInfo;
+
+   // Compute the columns that DrawClipWaveform will ask for, so that it
+   // finds them in the clip's cache
+   for (const auto &clip : wt->GetClips()) {
+      const ClipParameters params{
+         false, wt.get(), clip.get(), rect, selectedRegion, zoomInfo };
+      if (params.hiddenMid.width <= 0)
+         continue;
+
+      std::vector<WavePortion> portions;
+      FindWavePortions(portions, rect, zoomInfo, params);
+      if (ShowsIndividualSamples(portions, params.rate)) {
+         // Read the samples that DrawIndividualSamples will draw, portion by
+         // portion as in DrawClipWaveform
+         const double threshold1 = 0.5 * params.rate;
+         int leftOffset = params.leftOffset;
+         for (auto &portion : portions) {
+            const bool showIndividualSamples =
+               portion.averageZoom > threshold1;
+            if (portion.inFisheye && !showIndividualSamples)
+               // Its width on screen is not known until drawing
+               break;
+            wxRect rectPortion = portion.rect;
+            rectPortion.Intersect(params.mid);
+            sampleCount s0;
+            size_t slen;
+            if (showIndividualSamples && rectPortion.width > 0 &&
+                FindIndividualSamples(zoomInfo, clip.get(),
+                   leftOffset, rectPortion.width, s0, slen)) {
+               Floats buffer{ slen };
+               clip->GetDisplaySamples(buffer.get(), s0, slen);
+            }
+            leftOffset += rectPortion.width;
+         }
+         continue;
+      }
+
+      WaveDisplay display(params.hiddenMid.width);
+      bool isLoadingOD = false;
+      clip->GetWaveDisplay(display, params.t0,
+         params.averagePixelsPerSample * params.rate, isLoadingOD);
+   }
+}
+
 void WaveformView::Draw(
    TrackPanelDrawingContext &context, const wxRect &rect, unsigned iPass )
 {
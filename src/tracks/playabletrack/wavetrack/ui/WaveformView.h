@@ -32,6 +32,9 @@ public:
 
 
 private:
+   void PrepareDraw(
+      TrackPanelDrawingContext &context, const wxRect &rect ) override;
+
    // TrackPanelDrawable implementation
    void Draw(
       TrackPanelDrawingContext &context,
@@ -100,24 +100,34 @@ void PlayIndicatorOverlayBase::Draw(OverlayPanel &panel, wxDC &dc)
    if(auto tp = dynamic_cast<TrackPanel*>(&panel)) {
       wxASSERT(mIsMaster);
 
-      // Draw indicator in all visible tracks
-      tp->VisitCells( [&]( const wxRect &rect, TrackPanelCell &cell ) {
-         const auto pTrackView = dynamic_cast<TrackView*>(&cell);
-         if (pTrackView) pTrackView->FindTrack()->TypeSwitch(
-            [](LabelTrack *) {
-               // Don't draw the indicator in label tracks
-            },
-            [&](Track *) {
-               // Draw the NEW indicator in its NEW location
-               // AColor::Line includes both endpoints so use GetBottom()
-               AColor::Line(dc,
-                            mLastIndicatorX,
-                            rect.GetTop(),
-                            mLastIndicatorX,
-                            rect.GetBottom());
-            }
-         );
-      } );
+      // The cells are where they were when last drawn, so the visit of all
+      // of them need not be repeated on every timer tick
+      if (!mHaveSpans || mSpansDrawCount != tp->GetDrawCount()) {
+         mSpans.clear();
+         const auto panelRect = tp->GetClientRect();
+         tp->VisitCells( [&]( const wxRect &rect, TrackPanelCell &cell ) {
+            const auto pTrackView = dynamic_cast<TrackView*>(&cell);
+            if (pTrackView && rect.Intersects(panelRect))
+               pTrackView->FindTrack()->TypeSwitch(
+                  [](LabelTrack *) {
+                     // Don't draw the indicator in label tracks
+                  },
+                  [&](Track *) {
+                     // AColor::Line includes both endpoints so use
+                     // GetBottom()
+                     mSpans.emplace_back( rect.GetTop(), rect.GetBottom() );
+                  }
+               );
+         } );
+         mSpansDrawCount = tp->GetDrawCount();
+         mHaveSpans = true;
+      }
+
+      // Draw the NEW indicator in its NEW location, in all visible tracks
+      for (const auto &span : mSpans)
+         AColor::Line(dc,
+                      mLastIndicatorX, span.first,
+                      mLastIndicatorX, span.second);
    }
    else if(auto ruler = dynamic_cast<AdornedRulerPanel*>(&panel)) {
       wxASSERT(!mIsMaster);
@@ -11,6 +11,7 @@ Paul Licameli split from TrackPanel.cpp
 #ifndef __AUDACITY_PLAY_INDICATOR_OVERLAY__
 #define __AUDACITY_PLAY_INDICATOR_OVERLAY__
 
+#include <vector>
 #include <wx/event.h> // to inherit
 #include "../../MemoryX.h"
 #include "../../ClientData.h"
@@ -44,6 +45,13 @@ protected:
    int mNewIndicatorX { -1 };
    bool mNewIsCapturing { false };
    bool mLastIsCapturing { false };
+
+private:
+   // Tops and bottoms of the track panel cells that show the indicator,
+   // found again only when the panel's cells have been redrawn
+   std::vector< std::pair< int, int > > mSpans;
+   unsigned mSpansDrawCount { 0 };
+   bool mHaveSpans { false };
 };
 
 // Master object for track panel, creates the other object for the ruler
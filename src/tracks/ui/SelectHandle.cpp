@@ -1245,6 +1245,8 @@ void SelectHandle::AssignSelection
       pTrack->TypeSwitch( [&](WaveTrack *wt) {
          ODManager::Instance()->DemandTrackUpdate(wt, sel0);
          //sel0 is sometimes less than mSelStart
+         ODManager::Instance()->DemandTrackRange(
+            wt, ODTask::eDemandSelection, sel0, sel1);
       });
 }
 
@@ -119,6 +119,10 @@ bool TrackView::IsSpectral() const
    return false;
 }
 
+void TrackView::PrepareDraw( TrackPanelDrawingContext &, const wxRect & )
+{
+}
+
 void TrackView::DoSetMinimized(bool isMinimized)
 {
    mMinimized = isMinimized;
@@ -76,6 +76,13 @@ public:
    // default is false
    virtual bool IsSpectral() const;
 
+   // New virtual function.  Called before the drawing passes of each
+   // painting of the panel, maybe on a worker thread, and at the same time
+   // as for views of other tracks, to compute what Draw will need into the
+   // track's caches.  It must not use context.dc.  The default does nothing.
+   virtual void PrepareDraw(
+      TrackPanelDrawingContext &context, const wxRect &rect );
+
    virtual void DoSetMinimized( bool isMinimized );
 
 protected:
@@ -11,7 +11,23 @@
 #include "AudacityMessageBox.h"
 #include "../Internat.h"
 
+#include <future>
+#include <wx/app.h>
+
 TranslatableString AudacityMessageBoxCaptionStr()
 {
    return XO("Message");
 }
+
+int AudacityMessageBoxFromWorkerThread(
+   const TranslatableString& message, const TranslatableString& caption,
+   long style)
+{
+   std::promise<int> answer;
+   auto future = answer.get_future();
+   wxTheApp->CallAfter( [&]{
+      answer.set_value( ::wxMessageBox(
+         message.Translation(), caption.Translation(), style ) );
+   } );
+   return future.get();
+}
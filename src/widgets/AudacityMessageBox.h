@@ -12,10 +12,18 @@
 #define __AUDACITY_MESSAGE_BOX__
 
 #include <wx/msgdlg.h>
+#include <wx/thread.h> // for wxIsMainThread
 #include "../Internat.h"
 
 extern TranslatableString AudacityMessageBoxCaptionStr();
 
+// Shows the box from the main thread, for AudacityMessageBox called on any
+// other thread, which waits for the answer.  The main thread must be
+// processing pending events, as when it waits for a worker thread.
+extern int AudacityMessageBoxFromWorkerThread(
+   const TranslatableString& message, const TranslatableString& caption,
+   long style);
+
 // Do not use wxMessageBox!!  Its default window title does not translate!
 inline int AudacityMessageBox(const TranslatableString& message,
    const TranslatableString& caption = AudacityMessageBoxCaptionStr(),
@@ -23,6 +31,9 @@ inline int AudacityMessageBox(const TranslatableString& message,
    wxWindow *parent = NULL,
    int x = wxDefaultCoord, int y = wxDefaultCoord)
 {
+   if (!wxIsMainThread())
+      // A window of the main thread can't be a parent from here
+      return AudacityMessageBoxFromWorkerThread(message, caption, style);
    return ::wxMessageBox(message.Translation(), caption.Translation(),
       style, parent, x, y);
 }
@@ -44,6 +44,7 @@
 #include "../Experimental.h"
 
 #include <algorithm>
+#include <string.h>
 #include <wx/setup.h> // for wxUSE_* macros
 #include <wx/wxcrtvararg.h>
 #include <wx/app.h>
@@ -63,6 +64,17 @@
 
 #include <math.h>
 
+// SSE2 is part of every x86-64 processor; on 32 bit x86 it must be enabled
+// at compile time.  AArch64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_METER
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_NEON_METER
+#include <arm_neon.h>
+#endif
+
 #include "../AudioIO.h"
 #include "../AColor.h"
 #include "../ImageManipulation.h"
@@ -204,19 +216,24 @@ MeterUpdateQueue::~MeterUpdateQueue()
 {
 }
 
+// Call only from the thread that reads the queue
 void MeterUpdateQueue::Clear()
 {
-   mStart = 0;
-   mEnd = 0;
+   mStart.store(mEnd.load(std::memory_order_acquire),
+      std::memory_order_release);
 }
 
 // Add a message to the end of the queue.  Return false if the
 // queue was full.
 bool MeterUpdateQueue::Put(MeterUpdateMsg &msg)
 {
+   // Only the audio thread writes mEnd, and only the main thread mStart
+   const int end = mEnd.load(std::memory_order_relaxed);
+   const int start = mStart.load(std::memory_order_acquire);
+
    // mStart can be greater than mEnd because it is all mod mBufferSize
-   wxASSERT( (mEnd + mBufferSize - mStart) >= 0 );
-   int len = (mEnd + mBufferSize - mStart) % mBufferSize;
+   wxASSERT( (end + mBufferSize - start) >= 0 );
+   int len = (end + mBufferSize - start) % mBufferSize;
 
    // Never completely fill the queue, because then the
    // state is ambiguous (mStart==mEnd)
@@ -225,8 +242,9 @@ bool MeterUpdateQueue::Put(MeterUpdateMsg &msg)
 
    //wxLogDebug(wxT("Put: %s"), msg.toString());
 
-   mBuffer[mEnd] = msg;
-   mEnd = (mEnd+1)%mBufferSize;
+   mBuffer[end] = msg;
+   // Publish the message only once it is written
+   mEnd.store((end+1)%mBufferSize, std::memory_order_release);
 
    return true;
 }
@@ -235,13 +253,15 @@ bool MeterUpdateQueue::Put(MeterUpdateMsg &msg)
 // Return false if the queue was empty.
 bool MeterUpdateQueue::Get(MeterUpdateMsg &msg)
 {
-   int len = (mEnd + mBufferSize - mStart) % mBufferSize;
+   const int start = mStart.load(std::memory_order_relaxed);
+   const int end = mEnd.load(std::memory_order_acquire);
+   int len = (end + mBufferSize - start) % mBufferSize;
 
    if (len == 0)
       return false;
 
-   msg = mBuffer[mStart];
-   mStart = (mStart+1)%mBufferSize;
+   msg = mBuffer[start];
+   mStart.store((start+1)%mBufferSize, std::memory_order_release);
 
    return true;
 }
@@ -417,6 +437,7 @@ void MeterPanel::UpdatePrefs()
    mMeterRefreshRate =
       std::max(MIN_REFRESH_RATE, std::min(MAX_REFRESH_RATE,
          gPrefs->Read(Key(wxT("RefreshRate")), 30)));
+   UpdateFramesPerUpdate();
    mGradient = gPrefs->Read(Key(wxT("Bars")), wxT("Gradient")) == wxT("Gradient");
    mDB = gPrefs->Read(Key(wxT("Type")), wxT("dB")) == wxT("dB");
    mMeterDisabled = gPrefs->Read(Key(wxT("Disabled")), (long)0);
@@ -915,6 +936,9 @@ void MeterPanel::Reset(double sampleRate, bool resetClipping)
 {
    mT = 0;
    mRate = sampleRate;
+   UpdateFramesPerUpdate();
+   // Let the audio thread forget what it began to accumulate
+   mDiscardPending.store(true);
    for (int j = 0; j < kMaxMeterBars; j++)
    {
       ResetBar(&mBar[j], resetClipping);
@@ -951,6 +975,13 @@ static int intmax(int a, int b)
    return a>b? a: b;
 }
 
+void MeterPanel::UpdateFramesPerUpdate()
+{
+   // With no rate yet, deliver every buffer
+   mFramesPerUpdate.store(mRate > 0 && mMeterRefreshRate > 0
+      ? int(mRate / mMeterRefreshRate) : 0);
+}
+
 static float ClipZeroToOne(float z)
 {
    if (z > 1.0)
@@ -971,26 +1002,97 @@ static float ToDB(float v, float range)
    return ClipZeroToOne((db + range) / range);
 }
 
+// Peak magnitude and sum of squares of each of the first num channels of
+// interleaved data
+static void MeasureChannels(const float *sampleData, unsigned numChannels,
+   unsigned num, int numFrames, float *peaks, float *squares)
+{
+   for (unsigned int j = 0; j < num; j++)
+      peaks[j] = squares[j] = 0;
+
+   int i = 0;
+#if defined(USE_SSE2_METER) || defined(USE_NEON_METER)
+   // With one or two channels, each lane of a vector always holds samples
+   // of the same channel
+   if (numChannels == 1 || numChannels == 2) {
+      const int total = numFrames * numChannels;
+      float lanePeaks[4], laneSquares[4];
+      int k = 0;
+#if defined(USE_SSE2_METER)
+      const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+      __m128 vPeak = _mm_setzero_ps();
+      __m128 vSquares = _mm_setzero_ps();
+      for (; k + 4 <= total; k += 4) {
+         const __m128 x = _mm_loadu_ps(sampleData + k);
+         vPeak = _mm_max_ps(vPeak, _mm_and_ps(x, absMask));
+         vSquares = _mm_add_ps(vSquares, _mm_mul_ps(x, x));
+      }
+      _mm_storeu_ps(lanePeaks, vPeak);
+      _mm_storeu_ps(laneSquares, vSquares);
+#else
+      float32x4_t vPeak = vdupq_n_f32(0);
+      float32x4_t vSquares = vdupq_n_f32(0);
+      for (; k + 4 <= total; k += 4) {
+         const float32x4_t x = vld1q_f32(sampleData + k);
+         vPeak = vmaxq_f32(vPeak, vabsq_f32(x));
+         vSquares = vmlaq_f32(vSquares, x, x);
+      }
+      vst1q_f32(lanePeaks, vPeak);
+      vst1q_f32(laneSquares, vSquares);
+#endif
+      for (unsigned int lane = 0; lane < 4; lane++) {
+         const auto j = lane % numChannels;
+         if (j < num) {
+            peaks[j] = std::max(peaks[j], lanePeaks[lane]);
+            squares[j] += laneSquares[lane];
+         }
+      }
+      i = k / numChannels;
+   }
+#endif
+
+   const float *sptr = sampleData + i * numChannels;
+   for (; i < numFrames; i++) {
+      for (unsigned int j = 0; j < num; j++) {
+         peaks[j] = std::max(peaks[j], fabsf(sptr[j]));
+         squares[j] += sptr[j] * sptr[j];
+      }
+      sptr += numChannels;
+   }
+}
+
 void MeterPanel::UpdateDisplay(unsigned numChannels, int numFrames, float *sampleData)
 {
-   float *sptr = sampleData;
    auto num = std::min(numChannels, mNumBars);
-   MeterUpdateMsg msg;
+   MeterUpdateMsg &msg = mPending;
 
-   memset(&msg, 0, sizeof(msg));
-   msg.numFrames = numFrames;
+   if (mDiscardPending.exchange(false)) {
+      memset(&msg, 0, sizeof(msg));
+      for (unsigned int j = 0; j < kMaxMeterBars; j++)
+         mPendingSquares[j] = 0;
+   }
+
+   float peaks[kMaxMeterBars], squares[kMaxMeterBars];
+   MeasureChannels(sampleData, numChannels, num, numFrames, peaks, squares);
 
-   for(int i=0; i<numFrames; i++) {
-      for(unsigned int j=0; j<num; j++) {
-         msg.peak[j] = floatMax(msg.peak[j], fabs(sptr[j]));
-         msg.rms[j] += sptr[j]*sptr[j];
-
-         // In addition to looking for mNumPeakSamplesToClip peaked
-         // samples in a row, also send the number of peaked samples
-         // at the head and tail, in case there's a run of peaked samples
-         // that crosses block boundaries
-         if (fabs(sptr[j])>=MAX_AUDIO) {
-            if (msg.headPeakCount[j]==i)
+   for (unsigned int j = 0; j < num; j++) {
+      msg.peak[j] = floatMax(msg.peak[j], peaks[j]);
+      mPendingSquares[j] += squares[j];
+
+      // In addition to looking for mNumPeakSamplesToClip peaked
+      // samples in a row, also send the number of peaked samples
+      // at the head and tail, in case there's a run of peaked samples
+      // that crosses message boundaries.  Count them only if there could
+      // be any.
+      if (peaks[j] < MAX_AUDIO) {
+         if (numFrames > 0)
+            msg.tailPeakCount[j] = 0;
+         continue;
+      }
+      const float *sptr = sampleData + j;
+      for (int i = 0; i < numFrames; i++, sptr += numChannels) {
+         if (fabsf(*sptr) >= MAX_AUDIO) {
+            if (msg.headPeakCount[j] == msg.numFrames + i)
                msg.headPeakCount[j]++;
             msg.tailPeakCount[j]++;
             if (msg.tailPeakCount[j] > mNumPeakSamplesToClip)
@@ -999,58 +1101,41 @@ void MeterPanel::UpdateDisplay(unsigned numChannels, int numFrames, float *sampl
          else
             msg.tailPeakCount[j] = 0;
       }
-      sptr += numChannels;
    }
-   for(unsigned int j=0; j<mNumBars; j++)
-      msg.rms[j] = sqrt(msg.rms[j]/numFrames);
+   msg.numFrames += numFrames;
+
+   // Deliver no more often than the display refreshes
+   if (msg.numFrames < mFramesPerUpdate.load(std::memory_order_relaxed))
+      return;
+
+   for (unsigned int j = 0; j < mNumBars; j++)
+      msg.rms[j] = sqrt(mPendingSquares[j] / msg.numFrames);
 
    mQueue.Put(msg);
+
+   memset(&msg, 0, sizeof(msg));
+   for (unsigned int j = 0; j < kMaxMeterBars; j++)
+      mPendingSquares[j] = 0;
 }
 
-// Vaughan, 2010-11-29: This not currently used. See comments in MixerTrackCluster::UpdateMeter().
-//void MeterPanel::UpdateDisplay(int numChannels, int numFrames,
-//                           // Need to make these double-indexed arrays if we handle more than 2 channels.
-//                           float* maxLeft, float* rmsLeft,
-//                           float* maxRight, float* rmsRight,
-//                           const size_t kSampleCount)
-//{
-//   int i, j;
-//   int num = intmin(numChannels, mNumBars);
-//   MeterUpdateMsg msg;
-//
-//   msg.numFrames = kSampleCount;
-//   for(j=0; j<mNumBars; j++) {
-//      msg.peak[j] = 0.0;
-//      msg.rms[j] = 0.0;
-//      msg.clipping[j] = false;
-//      msg.headPeakCount[j] = 0;
-//      msg.tailPeakCount[j] = 0;
-//   }
-//
-//   for(i=0; i<numFrames; i++) {
-//      for(j=0; j<num; j++) {
-//         msg.peak[j] = floatMax(msg.peak[j], ((j == 0) ? maxLeft[i] : maxRight[i]));
-//         msg.rms[j] = floatMax(msg.rms[j], ((j == 0) ? rmsLeft[i] : rmsRight[i]));
-//
-//         // In addition to looking for mNumPeakSamplesToClip peaked
-//         // samples in a row, also send the number of peaked samples
-//         // at the head and tail, in case there's a run
-//         // of peaked samples that crosses block boundaries.
-//         if (fabs((j == 0) ? maxLeft[i] : maxRight[i]) >= MAX_AUDIO)
-//         {
-//            if (msg.headPeakCount[j]==i)
-//               msg.headPeakCount[j]++;
-//            msg.tailPeakCount[j]++;
-//            if (msg.tailPeakCount[j] > mNumPeakSamplesToClip)
-//               msg.clipping[j] = true;
-//         }
-//         else
-//            msg.tailPeakCount[j] = 0;
-//      }
-//   }
-//
-//   mQueue.Put(msg);
-//}
+void MeterPanel::UpdateDisplay(unsigned numChannels, int numFrames,
+                               const float *peaks, const float *rms,
+                               const unsigned *clipped)
+{
+   auto num = std::min(numChannels, mNumBars);
+   MeterUpdateMsg msg;
+
+   memset(&msg, 0, sizeof(msg));
+   msg.numFrames = numFrames;
+   for (unsigned int j = 0; j < num; j++) {
+      msg.peak[j] = std::min(peaks[j], 1.0f);
+      msg.rms[j] = std::min(rms[j], 1.0f);
+      // Runs of clipped samples are not known, only how many there were
+      msg.clipping[j] = clipped[j] > (unsigned)mNumPeakSamplesToClip;
+   }
+
+   mQueue.Put(msg);
+}
 
 void MeterPanel::OnMeterUpdate(wxTimerEvent & WXUNUSED(event))
 {
@@ -16,6 +16,7 @@
 #ifndef __AUDACITY_METER__
 #define __AUDACITY_METER__
 
+#include <atomic>
 #include <wx/setup.h> // for wxUSE_* macros
 #include <wx/brush.h> // member variable
 #include <wx/defs.h>
@@ -80,8 +81,10 @@ class MeterUpdateQueue
    void Clear();
 
  private:
-   int              mStart;
-   int              mEnd;
+   // A single producer, single consumer queue:  only the writer changes
+   // mEnd, and only the reader mStart
+   std::atomic<int> mStart{ 0 };
+   std::atomic<int> mEnd{ 0 };
    size_t           mBufferSize;
    ArrayOf<MeterUpdateMsg> mBuffer{mBufferSize};
 };
@@ -152,17 +155,15 @@ class MeterPanel final : public MeterPanelBase, private PrefsListener
     * to the second sample of channel (numChannels). The last sample in the
     * array will be the (numFrames) sample for channel (numChannels).
     *
-    * The second overload is for ease of use in MixerBoard.
+    * The second overload is for ease of use in MixerBoard, which has the
+    * levels of numFrames frames already measured, with the count of
+    * clipped samples in each channel.  It is called on the main thread.
     */
    void UpdateDisplay(unsigned numChannels,
                       int numFrames, float *sampleData) override;
-
-   // Vaughan, 2010-11-29: This not currently used. See comments in MixerTrackCluster::UpdateMeter().
-   //void UpdateDisplay(int numChannels, int numFrames,
-   //                     // Need to make these double-indexed max and min arrays if we handle more than 2 channels.
-   //                     float* maxLeft, float* rmsLeft,
-   //                     float* maxRight, float* rmsRight,
-   //                     const size_t kSampleCount);
+   void UpdateDisplay(unsigned numChannels, int numFrames,
+                      const float *peaks, const float *rms,
+                      const unsigned *clipped);
 
    /** \brief Find out if the level meter is disabled or not.
     *
@@ -250,6 +251,17 @@ class MeterPanel final : public MeterPanelBase, private PrefsListener
    double    mT;
    double    mRate;
    long      mMeterRefreshRate;
+
+   void UpdateFramesPerUpdate();
+   // UpdateDisplay accumulates over buffers, on the audio thread, until it
+   // has this many frames, so that messages come at about the refresh rate
+   std::atomic<int> mFramesPerUpdate{ 0 };
+   // Set by Reset on the main thread, to make the audio thread forget what
+   // it has accumulated
+   std::atomic<bool> mDiscardPending{ true };
+   // Touched only by the audio thread; rms holds nothing until delivery
+   MeterUpdateMsg mPending;
+   double    mPendingSquares[kMaxMeterBars];
    long      mMeterDisabled; //is used as a bool, needs long for easy gPrefs...
 
    bool      mMonitoring;
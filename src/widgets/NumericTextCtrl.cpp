@@ -311,17 +311,12 @@ public:
    NumericField &operator = ( const NumericField & ) = default;
    //NumericField( NumericField && ) = default;
    //NumericField &operator = ( NumericField && ) = default;
-   void CreateDigitFormatStr()
+   void ComputeDigits()
    {
       if (range > 1)
          digits = (int)ceil(log10(range-1.0));
       else
          digits = 5; // hack: default
-      if (zeropad && range>1)
-         formatStr.Printf(wxT("%%0%dd"), digits); // ex. "%03d" if digits is 3
-      else {
-         formatStr.Printf(wxT("%%0%dd"), digits);
-      }
    }
    bool frac; // is it a fractional field
    int base;  // divide by this (multiply, after decimal point)
@@ -333,7 +328,6 @@ public:
    int labelX; // x-position of the label on-screen
    bool zeropad;
    wxString label;
-   wxString formatStr;
    wxString str;
 };
 
@@ -830,7 +824,7 @@ void NumericConverter::ParseFormatString(
    }
 
    for(i = 0; i < mFields.size(); i++) {
-      mFields[i].CreateDigitFormatStr();
+      mFields[i].ComputeDigits();
    }
 
    int pos = 0;
@@ -894,6 +888,30 @@ void NumericConverter::ValueToControls()
    ValueToControls(mValue);
 }
 
+namespace {
+
+// Characters of the digit boxes that NumericTextCtrl renders in advance
+const wxChar *const DigitGlyphChars = wxT("0123456789-");
+
+// Append value, which is not negative, with at least the given number of
+// digits, padding with zeroes; as "%0*d" would, without parsing a format
+// for each field of each readout at each update during playback
+void AppendDigits(wxString &str, int value, int digits)
+{
+   wxChar buffer[16];
+   int n = 0;
+   do {
+      buffer[n++] = static_cast<wxChar>(wxT('0') + value % 10);
+      value /= 10;
+   } while (value > 0);
+   for (int ii = n; ii < digits; ++ii)
+      str += wxT('0');
+   while (n > 0)
+      str += buffer[--n];
+}
+
+}
+
 void NumericConverter::ValueToControls(double rawValue, bool nearest /* = true */)
 {
    //rawValue = 4.9995f; Only for testing!
@@ -990,14 +1008,10 @@ void NumericConverter::ValueToControls(double rawValue, bool nearest /* = true *
          }
       }
 
-      wxString field;
-      if (value < 0) {
-         for (int ii = 0; ii < mFields[i].digits; ++ii)
-            field += wxT("-");
-      }
+      if (value < 0)
+         mValueString.append(mFields[i].digits, wxT('-'));
       else
-         field = wxString::Format(mFields[i].formatStr, value);
-      mValueString += field;
+         AppendDigits(mValueString, value, mFields[i].digits);
       mValueString += mFields[i].label;
    }
 }
@@ -1585,9 +1599,42 @@ bool NumericTextCtrl::Layout()
                     (mHeight / 2) - 2,
                     mButtonWidth - 2);
    }
+   memDC.SelectObject(wxNullBitmap);
+
+   // Render the characters of unfocused digits once, to be copied at each
+   // paint, instead of measuring and drawing text
+   mDigitGlyphs.clear();
+   memDC.SetFont(*mDigitFont);
+   theTheme.SetBrushColour( Brush, clrTimeBack );
+   for (const auto ch : wxString{ DigitGlyphChars }) {
+      wxBitmap glyph(std::max(1, mDigitBoxW), std::max(1, mDigitBoxH), 24);
+      memDC.SelectObject(glyph);
+      memDC.SetBrush(Brush);
+      memDC.SetPen(*wxTRANSPARENT_PEN);
+      memDC.DrawRectangle(0, 0, mDigitBoxW, mDigitBoxH);
+      memDC.SetTextForeground(theTheme.Colour( clrTimeFont ));
+      memDC.SetTextBackground(theTheme.Colour( clrTimeBack ));
+      memDC.DrawText(wxString{ ch },
+         (mDigitBoxW - mDigitW)/2, (mDigitBoxH - mDigitH)/2);
+      memDC.SelectObject(wxNullBitmap);
+      mDigitGlyphs.push_back(glyph);
+   }
+   memDC.SetBrush( wxNullBrush );
+
+   // The digits may have moved
+   mRefreshAll = true;
    return true;
 }
 
+const wxBitmap *NumericTextCtrl::FindDigitGlyph(wxChar ch) const
+{
+   const wxString chars{ DigitGlyphChars };
+   const auto index = chars.find(ch);
+   if (index == wxString::npos || index >= mDigitGlyphs.size())
+      return nullptr;
+   return &mDigitGlyphs[index];
+}
+
 void NumericTextCtrl::Fit()
 {
    wxSize sz = GetSize();
@@ -1632,17 +1679,27 @@ void NumericTextCtrl::OnPaint(wxPaintEvent & WXUNUSED(event))
    int i;
    for(i = 0; i < (int)mDigits.size(); i++) {
       wxRect box = mDigits[i].digitBox;
-      if (focused && mFocusedDigit == i) {
+      // Usually only the digits that changed need painting
+      if (!IsExposed(box))
+         continue;
+      const bool focusedDigit = focused && mFocusedDigit == i;
+      int pos = mDigits[i].pos;
+      const auto glyph = (focusedDigit || pos >= (int)mValueString.length())
+         ? nullptr : FindDigitGlyph(mValueString[pos]);
+      if (glyph) {
+         dc.DrawBitmap(*glyph, box.x, box.y);
+         continue;
+      }
+      if (focusedDigit) {
          dc.DrawRectangle(box);
          dc.SetTextForeground(theTheme.Colour( clrTimeFontFocus ));
          dc.SetTextBackground(theTheme.Colour( clrTimeBackFocus ));
       }
-      int pos = mDigits[i].pos;
       wxString digit = mValueString.Mid(pos, 1);
       int x = box.x + (mDigitBoxW - mDigitW)/2;
       int y = box.y + (mDigitBoxH - mDigitH)/2;
       dc.DrawText(digit, x, y);
-      if (focused && mFocusedDigit == i) {
+      if (focusedDigit) {
          dc.SetTextForeground(theTheme.Colour( clrTimeFont ));
          dc.SetTextBackground(theTheme.Colour( clrTimeBack ));
       }
@@ -2004,7 +2061,29 @@ void NumericTextCtrl::ValueToControls()
       // playing, only one of the NumericTextCtrl actually changes
       // (the audio position). We save CPU by updating the control
       // only when needed.
-      Refresh(false);
+      // Repaint only the boxes of the digits that changed, unless the
+      // layout changed, or something besides digits did
+      bool all = mRefreshAll ||
+         mValueString.length() != previousValueString.length();
+      if (!all) {
+         size_t changed = 0, changedDigits = 0;
+         for (size_t ii = 0; ii < mValueString.length(); ++ii)
+            changed += (mValueString[ii] != previousValueString[ii]);
+         for (const auto &digit : mDigits)
+            if (digit.pos < (int)mValueString.length() &&
+                mValueString[digit.pos] != previousValueString[digit.pos])
+               ++changedDigits;
+         all = changed != changedDigits;
+      }
+      if (all) {
+         mRefreshAll = false;
+         Refresh(false);
+      }
+      else {
+         for (const auto &digit : mDigits)
+            if (mValueString[digit.pos] != previousValueString[digit.pos])
+               RefreshRect(digit.digitBox, false);
+      }
    }
 }
 
@@ -21,6 +21,7 @@
 #include "../../include/audacity/ComponentInterface.h"
 #include <vector>
 #include <wx/setup.h> // for wxUSE_* macros
+#include <wx/bitmap.h> // member
 #include <wx/defs.h>
 #include <wx/control.h> // to inherit
 
@@ -247,12 +248,19 @@ private:
 
    void Updated(bool keyup = false);
 
+   // The pre-rendered character, or null if it is not among them
+   const wxBitmap *FindDigitGlyph(wxChar ch) const;
+
 private:
 
    bool           mMenuEnabled;
    bool           mReadOnly;
 
    std::unique_ptr<wxBitmap> mBackgroundBitmap;
+   // The characters of DigitGlyphChars, each drawn in a digit box
+   std::vector<wxBitmap> mDigitGlyphs;
+   // Set by Layout, so that the next change of value repaints everything
+   bool           mRefreshAll{ true };
 
    std::unique_ptr<wxFont> mDigitFont, mLabelFont;
    int            mDigitBoxW;
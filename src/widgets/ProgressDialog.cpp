@@ -1077,6 +1077,7 @@ void ProgressDialog::Reinit()
    mStartTime = wxGetUTCTimeMillis().GetValue();
    mLastUpdate = mStartTime;
    mYieldTimer = mStartTime;
+   mPendingMessage = {};
    mCancel = false;
    mStop = false;
 
@@ -1330,11 +1331,25 @@ ProgressResult ProgressDialog::Update(
    wxLongLong_t now = wxGetUTCTimeMillis().GetValue();
    wxLongLong_t elapsed = now - mStartTime;
 
+   // Keep the latest message for the next repaint
+   if (!message.empty())
+   {
+      mPendingMessage = message;
+   }
+
    if (elapsed < 500)
    {
       return ProgressResult::Success;
    }
 
+   // Callers in tight loops may report far more often than anyone can see.
+   // Repaint and look for clicks on the buttons only as often as we yield,
+   // so that in between, an update costs no more than reading the clock.
+   if ((now - mYieldTimer <= 50) && (value < 1000))
+   {
+      return ProgressResult::Success;
+   }
+
    if (mIsTransparent)
    {
       SetTransparent(255);
@@ -1354,7 +1369,8 @@ ProgressResult ProgressDialog::Update(
    wxLongLong_t estimate = elapsed * 1000ll / value;
    wxLongLong_t remains = (estimate + mStartTime) - now;
 
-   SetMessage(message);
+   SetMessage(mPendingMessage);
+   mPendingMessage = {};
 
    if (value != mLastValue)
    {
@@ -1397,10 +1413,9 @@ ProgressResult ProgressDialog::Update(
 
    // Nyquist effects call Update on every callback, but YieldFor is
    // quite slow on Linux / Mac, so don't call too frequently. (bug 1575)
-   if ((now - mYieldTimer > 50) || (value == 1000)) {
-      wxEventLoopBase::GetActive()->YieldFor(wxEVT_CATEGORY_UI | wxEVT_CATEGORY_USER_INPUT | wxEVT_CATEGORY_TIMER);
-      mYieldTimer = now;
-   }
+   // The test above already limits the rate.
+   wxEventLoopBase::GetActive()->YieldFor(wxEVT_CATEGORY_UI | wxEVT_CATEGORY_USER_INPUT | wxEVT_CATEGORY_TIMER);
+   mYieldTimer = now;
 
    return ProgressResult::Success;
 }
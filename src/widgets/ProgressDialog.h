@@ -147,6 +147,8 @@ private:
    std::unique_ptr<wxWindowDisabler> mDisable;
 
    wxStaticText *mMessage{} ;
+   // The latest message given to Update, not yet shown
+   TranslatableString mPendingMessage;
    int mLastW{ 0 };
    int mLastH{ 0 };
 
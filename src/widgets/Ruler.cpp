@@ -62,6 +62,9 @@ array of Ruler::Label.
 #include <wx/dcclient.h>
 #include <wx/dcscreen.h>
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "../AColor.h"
 #include "../AllThemeResources.h"
 #include "../Envelope.h"
@@ -288,7 +291,7 @@ void Ruler::SetFonts(const wxFont &minorFont, const wxFont &majorFont, const wxF
    FindFontHeights( height, mpUserFonts->lead, dc, majorFont );
 
    mpFonts.reset();
-   mpFonts.reset();
+   mpTextExtents.reset();
    Invalidate();
 }
 
@@ -756,9 +759,50 @@ TranslatableString LabelString(
 
 }; // struct Ruler::TickSizes
 
+// Remembers the measurements of label strings, separately for each font
+struct Ruler::TextExtents {
+   struct Extent { wxCoord width, height, descent, leading; };
+
+   const Extent &Get( wxDC &dc, const wxFont &font, const wxString &str )
+   {
+      // There are at most three fonts, so search linearly
+      auto iter = std::find_if( mEntries.begin(), mEntries.end(),
+         [&]( const Entry &entry ){ return entry.font == font; } );
+      if ( iter == mEntries.end() ) {
+         if ( mEntries.size() >= MaxFonts )
+            mEntries.clear();
+         iter = mEntries.insert( mEntries.end(), Entry{ font, {} } );
+      }
+
+      auto &extents = iter->extents;
+      auto found = extents.find( str );
+      if ( found != extents.end() )
+         return found->second;
+
+      // Don't grow without bound while scrolling through a long project
+      if ( extents.size() >= MaxEntries )
+         extents.clear();
+
+      Extent extent;
+      dc.GetTextExtent( str,
+         &extent.width, &extent.height, &extent.descent, &extent.leading );
+      return extents.emplace( str, extent ).first->second;
+   }
+
+private:
+   static constexpr size_t MaxFonts = 3;
+   static constexpr size_t MaxEntries = 4096;
+
+   struct Entry {
+      wxFont font;
+      std::unordered_map< wxString, Extent > extents;
+   };
+   std::vector< Entry > mEntries;
+};
+
 auto Ruler::MakeTick(
    Label lab,
-   wxDC &dc, wxFont font,
+   wxDC &dc, wxFont font, TextExtents &extents,
    std::vector<bool> &bits,
    int left, int top, int spacing, int lead,
    bool flip, int orientation )
@@ -772,11 +816,11 @@ auto Ruler::MakeTick(
 
    dc.SetFont( font );
 
-   wxCoord strW, strH, strD, strL;
    auto str = lab.text;
    // Do not put the text into results until we are sure it does not overlap
    lab.text = {};
-   dc.GetTextExtent(str.Translation(), &strW, &strH, &strD, &strL);
+   const auto &extent = extents.Get( dc, font, str.Translation() );
+   const wxCoord strW = extent.width, strH = extent.height;
 
    int strPos, strLen, strLeft, strTop;
    if ( orientation == wxHORIZONTAL ) {
@@ -872,6 +916,7 @@ struct Ruler::Updater {
 
    const bool mCustom = mRuler.mCustom;
    const Fonts &mFonts = *mRuler.mpFonts;
+   TextExtents &mTextExtents = *mRuler.mpTextExtents;
    const bool mLog = mRuler.mLog;
    const double mHiddenMin = mRuler.mHiddenMin;
    const double mHiddenMax = mRuler.mHiddenMax;
@@ -945,7 +990,7 @@ bool Ruler::Updater::Tick( wxDC &dc,
 
    const auto result = MakeTick(
       lab,
-      dc, font,
+      dc, font, mTextExtents,
       outputs.bits,
       mLeft, mTop, mSpacing, mFonts.lead,
       mFlip,
@@ -974,7 +1019,7 @@ bool Ruler::Updater::TickCustom( wxDC &dc, int labelIdx, wxFont font,
    const auto result = MakeTick(
       lab,
 
-      dc, font,
+      dc, font, mTextExtents,
       outputs.bits,
       mLeft, mTop, mSpacing, mFonts.lead,
       mFlip,
@@ -1378,6 +1423,8 @@ void Ruler::UpdateCache(
    // tick positions and font size.
 
    ChooseFonts( dc );
+   if ( !mpTextExtents )
+      mpTextExtents = std::make_unique< TextExtents >();
    mpCache = std::make_unique< Cache >();
    auto &cache = *mpCache;
 
@@ -193,9 +193,11 @@ private:
 
    Bits mUserBits;
 
+   struct TextExtents;
+
    static std::pair< wxRect, Label > MakeTick(
       Label lab,
-      wxDC &dc, wxFont font,
+      wxDC &dc, wxFont font, TextExtents &extents,
       std::vector<bool> &bits,
       int left, int top, int spacing, int lead,
       bool flip, int orientation );
@@ -203,6 +205,10 @@ private:
    struct Cache;
    mutable std::unique_ptr<Cache> mpCache;
 
+   // Survives Invalidate(), so that scrolling and zooming need not measure
+   // again the label strings already seen
+   mutable std::unique_ptr<TextExtents> mpTextExtents;
+
    // Returns 'zero' label coordinate (for grid drawing)
    int FindZero( const Labels &labels ) const;
 
@@ -31,6 +31,7 @@ the general functionality for creating XML in UTF8 encoding.
 #include <wx/ffile.h>
 #include <wx/intl.h>
 
+#include <stdio.h>
 #include <string.h>
 
 //table for xml encoding compatibility with expat decoding
@@ -74,21 +75,52 @@ XMLWriter::~XMLWriter()
 {
 }
 
+namespace {
+
+// Append the UTF-8 encoding of str to out.  Names and most values are
+// ASCII, which needs no conversion buffer.
+void AppendUTF8(std::string &out, const wxString &str)
+{
+   const auto length = str.length();
+   const auto oldSize = out.size();
+   out.resize(oldSize + length);
+   auto dst = &out[oldSize];
+   auto src = str.wc_str();
+   for (size_t i = 0; i < length; ++i) {
+      const auto c = src[i];
+      if (c >= 0x80) {
+         out.resize(oldSize);
+         const auto utf8 = str.utf8_str();
+         out.append(utf8.data(), utf8.length());
+         return;
+      }
+      dst[i] = static_cast<char>(c);
+   }
+}
+
+void AppendTabs(std::string &out, int count)
+{
+   if (count > 0)
+      out.append(count, '\t');
+}
+
+}
+
 void XMLWriter::StartTag(const wxString &name)
 // may throw
 {
-   int i;
+   auto &out = mScratch;
+   out.clear();
 
    if (mInTag) {
-      Write(wxT(">\n"));
+      out += ">\n";
       mInTag = false;
    }
 
-   for (i = 0; i < mDepth; i++) {
-      Write(wxT("\t"));
-   }
-
-   Write(wxString::Format(wxT("<%s"), name));
+   AppendTabs(out, mDepth);
+   out += '<';
+   AppendUTF8(out, name);
+   WriteUTF8(out.data(), out.size());
 
    mTagstack.insert(mTagstack.begin(), name);
    mHasKids[0] = true;
@@ -100,24 +132,25 @@ void XMLWriter::StartTag(const wxString &name)
 void XMLWriter::EndTag(const wxString &name)
 // may throw
 {
-   int i;
-
    if (mTagstack.size() > 0) {
       if (mTagstack[0] == name) {
+         auto &out = mScratch;
+         out.clear();
          if (mHasKids[1]) {  // There will always be at least 2 at this point
             if (mInTag) {
-               Write(wxT("/>\n"));
+               out += "/>\n";
             }
             else {
-               for (i = 0; i < mDepth - 1; i++) {
-                  Write(wxT("\t"));
-               }
-               Write(wxString::Format(wxT("</%s>\n"), name));
+               AppendTabs(out, mDepth - 1);
+               out += "</";
+               AppendUTF8(out, name);
+               out += ">\n";
             }
          }
          else {
-            Write(wxT(">\n"));
+            out += ">\n";
          }
+         WriteUTF8(out.data(), out.size());
          mTagstack.erase( mTagstack.begin() );
          mHasKids.erase(mHasKids.begin());
       }
@@ -127,12 +160,31 @@ void XMLWriter::EndTag(const wxString &name)
    mInTag = false;
 }
 
+void XMLWriter::WriteAttrUTF8(
+   const wxString &name, const char *value, size_t length)
+// may throw from WriteUTF8()
+{
+   auto &out = mScratch;
+   out.clear();
+   out += ' ';
+   AppendUTF8(out, name);
+   out += "=\"";
+   out.append(value, length);
+   out += '"';
+   WriteUTF8(out.data(), out.size());
+}
+
 void XMLWriter::WriteAttr(const wxString &name, const wxString &value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%s\""),
-      name,
-      XMLEsc(value)));
+   auto &out = mScratch;
+   out.clear();
+   out += ' ';
+   AppendUTF8(out, name);
+   out += "=\"";
+   AppendUTF8(out, XMLEsc(value));
+   out += '"';
+   WriteUTF8(out.data(), out.size());
 }
 
 void XMLWriter::WriteAttr(const wxString &name, const wxChar *value)
@@ -141,60 +193,59 @@ void XMLWriter::WriteAttr(const wxString &name, const wxChar *value)
    WriteAttr(name, wxString(value));
 }
 
+// Numbers need no escaping, and are formatted without wxString
+
 void XMLWriter::WriteAttr(const wxString &name, int value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%d\""),
-      name,
-      value));
+   char buffer[32];
+   const auto length = snprintf(buffer, sizeof(buffer), "%d", value);
+   WriteAttrUTF8(name, buffer, length);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, bool value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%d\""),
-      name,
-      value));
+   WriteAttrUTF8(name, value ? "1" : "0", 1);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, long value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%ld\""),
-      name,
-      value));
+   char buffer[32];
+   const auto length = snprintf(buffer, sizeof(buffer), "%ld", value);
+   WriteAttrUTF8(name, buffer, length);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, long long value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%lld\""),
-      name,
-      value));
+   char buffer[32];
+   const auto length = snprintf(buffer, sizeof(buffer), "%lld", value);
+   WriteAttrUTF8(name, buffer, length);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, size_t value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%lld\""),
-      name,
-      (long long) value));
+   char buffer[32];
+   const auto length =
+      snprintf(buffer, sizeof(buffer), "%lld", (long long) value);
+   WriteAttrUTF8(name, buffer, length);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, float value, int digits)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%s\""),
-      name,
-      Internat::ToString(value, digits)));
+   const auto utf8 = Internat::ToString(value, digits).utf8_str();
+   WriteAttrUTF8(name, utf8.data(), utf8.length());
 }
 
 void XMLWriter::WriteAttr(const wxString &name, double value, int digits)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%s\""),
-      name,
-      Internat::ToString(value, digits)));
+   const auto utf8 = Internat::ToString(value, digits).utf8_str();
+   WriteAttrUTF8(name, utf8.data(), utf8.length());
 }
 
 void XMLWriter::WriteData(const wxString &value)
@@ -221,12 +272,34 @@ void XMLWriter::WriteSubTree(const wxString &value)
    Write(value);
 }
 
+void XMLWriter::WriteUTF8(const char *data, size_t length)
+// may throw from Write()
+{
+   Write(wxString::FromUTF8(data, length));
+}
+
 // See http://www.w3.org/TR/REC-xml for reference
 wxString XMLWriter::XMLEsc(const wxString & s)
 {
-   wxString result;
    int len = s.length();
 
+   // Most values are printable ASCII without markup characters; return
+   // those without building a copy one character at a time
+   {
+      const auto chars = s.wc_str();
+      int i = 0;
+      for (; i < len; ++i) {
+         const auto c = chars[i];
+         if (c < 0x20 || c > 0x7E || c == wxT('\'') || c == wxT('"') ||
+             c == wxT('&') || c == wxT('<') || c == wxT('>'))
+            break;
+      }
+      if (i == len)
+         return s;
+   }
+
+   wxString result;
+
    for(int i=0; i<len; i++) {
       wxUChar c = s.GetChar(i);
 
@@ -330,6 +403,8 @@ XMLFileWriter::~XMLFileWriter()
    // Don't let a destructor throw!
    GuardedCall( [&] {
       if (!mCommitted) {
+         // Discard the output, not flush it to a file removed anyway
+         mOutput.clear();
          auto fileName = GetName();
          if ( IsOpened() )
             CloseWithoutEndingTags();
@@ -385,6 +460,8 @@ void XMLFileWriter::PostCommit()
 void XMLFileWriter::CloseWithoutEndingTags()
 // may throw
 {
+   FlushOutput();
+
    // Before closing, we first flush it, because if Flush() fails because of a
    // "disk full" condition, we can still at least try to close the file.
    if (!wxFFile::Flush())
@@ -398,10 +475,53 @@ void XMLFileWriter::CloseWithoutEndingTags()
       ThrowException( GetName(), mCaption );
 }
 
+// Enough that writing the file is not dominated by calls into the library
+static const size_t OutputBufferSize = 1 << 18;
+
 void XMLFileWriter::Write(const wxString &data)
 // may throw
 {
-   if (!wxFFile::Write(data, wxConvUTF8) || Error())
+   AppendUTF8(mOutput, data);
+   if (mOutput.size() >= OutputBufferSize)
+      FlushOutput();
+}
+
+void XMLFileWriter::WriteUTF8(const char *data, size_t length)
+// may throw
+{
+   mOutput.append(data, length);
+   if (mOutput.size() >= OutputBufferSize)
+      FlushOutput();
+}
+
+void XMLFileWriter::WriteBytes(const void *data, size_t length)
+// may throw
+{
+   if (length < OutputBufferSize) {
+      WriteUTF8(static_cast<const char *>(data), length);
+      return;
+   }
+
+   // Large blocks go directly to the file, after what is buffered
+   FlushOutput();
+   if (wxFFile::Write(data, length) != length || Error())
+   {
+      wxFFile::Close();
+      ThrowException( GetName(), mCaption );
+   }
+}
+
+void XMLFileWriter::FlushOutput()
+// may throw
+{
+   if (mOutput.empty())
+      return;
+
+   const auto length = mOutput.size();
+   const bool good =
+      wxFFile::Write(mOutput.data(), length) == length && !Error();
+   mOutput.clear();
+   if (!good)
    {
       // When writing fails, we try to close the file before throwing the
       // exception, so it can at least be deleted.
@@ -410,6 +530,18 @@ void XMLFileWriter::Write(const wxString &data)
    }
 }
 
+void XMLFileWriter::WriteSubTreeUTF8(const std::string &value)
+// may throw
+{
+   if (mInTag) {
+      Write(wxT(">\n"));
+      mInTag = false;
+      mHasKids[0] = true;
+   }
+
+   WriteBytes(value.data(), value.size());
+}
+
 ///
 /// XMLStringWriter class
 ///
@@ -10,6 +10,7 @@
 #ifndef __AUDACITY_XML_XML_FILE_WRITER__
 #define __AUDACITY_XML_XML_FILE_WRITER__
 
+#include <string>
 #include <vector>
 #include <wx/ffile.h> // to inherit
 
@@ -55,15 +56,30 @@ class AUDACITY_DLL_API XMLWriter /* not final */ {
 
    // Escape a string, replacing certain characters with their
    // XML encoding, i.e. '<' becomes '&lt;'
+   // Returns s itself when nothing needs escaping
    wxString XMLEsc(const wxString & s);
 
+   // For writing a subtree separately, indented as it will be in the whole
+   int GetDepth() const { return mDepth; }
+   void SetDepth(int depth) { mDepth = depth; }
+
  protected:
 
+   /// Write text already encoded as UTF-8; the default converts it for
+   /// Write, which subclasses may avoid
+   virtual void WriteUTF8(const char *data, size_t length);
+
    bool mInTag;
    int mDepth;
    wxArrayString mTagstack;
    std::vector<int> mHasKids;
 
+ private:
+   // Write the attribute with a value that needs no escaping
+   void WriteAttrUTF8(const wxString &name, const char *value, size_t length);
+
+   // Reused for each tag and attribute
+   std::string mScratch;
 };
 
 ///
@@ -106,10 +122,23 @@ class AUDACITY_DLL_API XMLFileWriter final : private wxFFile, public XMLWriter {
    /// Write to file. Might throw.
    void Write(const wxString &data) override;
 
+   /// Write bytes unconverted, for a binary encoding. Might throw.
+   void WriteBytes(const void *data, size_t length);
+
+   /// Like WriteSubTree, for text already encoded as UTF-8. Might throw.
+   void WriteSubTreeUTF8(const std::string &value);
+
    FilePath GetBackupName() const { return mBackupName; }
 
+ protected:
+   /// Buffer the text. Might throw.
+   void WriteUTF8(const char *data, size_t length) override;
+
  private:
 
+   /// Write out the buffered output. Might throw.
+   void FlushOutput();
+
    void ThrowException(
       const wxFileName &fileName, const TranslatableString &caption)
    {
@@ -127,6 +156,10 @@ class AUDACITY_DLL_API XMLFileWriter final : private wxFFile, public XMLWriter {
 
    wxFFile mBackupFile;
 
+   // Output not yet written to the file, so that the many small writes of
+   // tags and attributes make few calls to it
+   std::string mOutput;
+
    bool mCommitted{ false };
 };
 